@@ -7,9 +7,12 @@ using namespace cgv::base;
 struct test_listener : public base, public registration_listener
 {
 	static std::vector<base_ptr> tests;
+	/// whether benchmarks are executed in addition to the tests
+	static bool run_benchmarks;
 	void register_object(base_ptr object, const std::string& options)
 	{
-		if (object->get_interface<test>())
+		test* t = object->get_interface<test>();
+		if (t && (run_benchmarks || !t->is_benchmark()))
 			tests.push_back(object);
 	}
 	void unregister_object(base_ptr object, const std::string& options)
@@ -46,12 +49,21 @@ struct test_listener : public base, public registration_listener
 };
 
 std::vector<base_ptr> test_listener::tests;
+bool test_listener::run_benchmarks = false;
 
 int main(int argc, char** argv)
 {
+	// the argument "benchmark" enables the registered benchmarks, all other arguments are processed as commands
+	std::vector<char*> args;
+	for (int ai = 0; ai < argc; ++ai) {
+		if (ai > 0 && std::string(argv[ai]) == "benchmark")
+			test_listener::run_benchmarks = true;
+		else
+			args.push_back(argv[ai]);
+	}
 	register_object(new test_listener());
 	enable_registration();
-	process_command_line_args(argc, argv);
+	process_command_line_args(int(args.size()), args.data());
 	bool res = test_listener::perform_tests();
 #if _MSC_VER >= 1600
 	std::cin.get();
@@ -4,6 +4,7 @@
 #include "group.h"
 #include <cgv/reflect/get_reflection_handler.h>
 #include <cgv/reflect/set_reflection_handler.h>
+#include <cgv/reflect/reflection_index.h>
 #include <cgv/type/variant.h>
 #include <cgv/utils/tokenizer.h>
 #include <cgv/utils/scan.h>
@@ -177,9 +178,39 @@ bool base::call_void(const std::string& method,
 }
 
 
+/// return pointer to member and its reflection traits if the property is found in the reflection index of the type of the instance
+static void* find_indexed_member(base* instance, const std::string& property, abst_reflection_traits*& rt)
+{
+	if (!instance->use_reflection_index())
+		return 0;
+	// offsets are relative to the most derived object, which is the same for all instances of a type
+	const void* object_ptr = dynamic_cast<const void*>(instance);
+	const reflection_index& index = reflection_index::get_type_index(typeid(*instance), object_ptr,
+		[instance](reflection_handler& rh) { return instance->self_reflect(rh); });
+	const reflection_index::entry* e = index.find(property);
+	if (!e)
+		return 0;
+	rt = e->rt;
+	return reflection_index::get_member_ptr(object_ptr, *e);
+}
+
+/// return whether the default implementations of set_void, get_void and find_member_ptr can use the reflection index of the type
+bool base::use_reflection_index() const
+{
+	return false;
+}
+
 /// abstract interface for the setter, by default it simply returns false
 bool base::set_void(const std::string& property, const std::string& value_type, const void* value_ptr)
 {
+	// indexed members are set without reflection and all other paths are resolved by a set reflection handler
+	abst_reflection_traits* rt;
+	if (void* member_ptr = find_indexed_member(this, property, rt)) {
+		if (!set_reflection_handler::set_member_value(member_ptr, rt, value_type, value_ptr))
+			return false;
+		on_set(member_ptr);
+		return true;
+	}
 	set_reflection_handler ssrh(property, value_type, value_ptr);
 	self_reflect(ssrh);
 	if (ssrh.found_valid_target()) {
@@ -214,6 +245,9 @@ void base::on_set(void* member_ptr)
 /// abstract interface for the getter, by default it simply returns false
 bool base::get_void(const std::string& property, const std::string& value_type, void* value_ptr)
 {
+	abst_reflection_traits* rt;
+	if (void* member_ptr = find_indexed_member(this, property, rt))
+		return get_reflection_handler::get_member_value(member_ptr, rt, value_type, value_ptr);
 	get_reflection_handler gsrh(property, value_type, value_ptr);
 	self_reflect(gsrh);
 	if (gsrh.found_valid_target())
@@ -359,6 +393,12 @@ bool base::is_property(const std::string& property_name, std::string* type_name)
     property is copied to the referenced string.*/
 void* base::find_member_ptr(const std::string& property_name, std::string* type_name)
 {
+	abst_reflection_traits* rt;
+	if (void* member_ptr = find_indexed_member(this, property_name, rt)) {
+		if (type_name)
+			*type_name = rt->get_type_name();
+		return member_ptr;
+	}
 	find_reflection_handler fsrh(property_name);
 	self_reflect(fsrh);
 	if (!fsrh.found_target())
@@ -368,5 +408,51 @@ void* base::find_member_ptr(const std::string& property_name, std::string* type_
 	return fsrh.get_member_ptr();
 }
 
+/// return a handle to a property that allows repeated access without looking up the property again
+property_handle base::get_property_handle(const std::string& property)
+{
+	abst_reflection_traits* rt;
+	// traits of indexed members are owned by the index, which is never destructed
+	if (void* member_ptr = find_indexed_member(this, property, rt))
+		return property_handle(this, member_ptr, std::shared_ptr<abst_reflection_traits>(rt, [](abst_reflection_traits*) {}));
+	find_reflection_handler fsrh(property);
+	self_reflect(fsrh);
+	if (!fsrh.found_target())
+		return property_handle();
+	return property_handle(this, fsrh.get_member_ptr(), std::shared_ptr<abst_reflection_traits>(fsrh.get_reflection_traits()->clone()));
+}
+
+/// construct invalid handle
+property_handle::property_handle() : instance(0), member_ptr(0)
+{
+}
+
+/// construct from instance, member pointer and reflection traits of member
+property_handle::property_handle(base* _instance, void* _member_ptr, const std::shared_ptr<abst_reflection_traits>& _rt)
+	: instance(_instance), member_ptr(_member_ptr), rt(_rt)
+{
+}
+
+/// return type name of member or empty string for invalid handles
+std::string property_handle::get_type_name() const
+{
+	return rt ? rt->get_type_name() : std::string();
+}
+
+/// set property from value of given type and return whether this was possible
+bool property_handle::set_void(const std::string& value_type, const void* value_ptr)
+{
+	if (!member_ptr || !set_reflection_handler::set_member_value(member_ptr, rt.get(), value_type, value_ptr))
+		return false;
+	instance->on_set(member_ptr);
+	return true;
+}
+
+/// copy property to value of given type and return whether this was possible
+bool property_handle::get_void(const std::string& value_type, void* value_ptr) const
+{
+	return member_ptr && get_reflection_handler::get_member_value(member_ptr, rt.get(), value_type, value_ptr);
+}
+
 	}
 }
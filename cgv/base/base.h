@@ -4,6 +4,7 @@
 #include <cgv/reflect/reflection_handler.h>
 #include <cgv/data/ref_ptr.h>
 #include <iostream>
+#include <memory>
 
 #include <cgv/type/lib_begin.h>
 
@@ -32,6 +33,7 @@ class CGV_API base;
 class CGV_API named;
 class CGV_API node;
 class CGV_API group;
+class CGV_API property_handle;
 
 /// ref counted pointer to base
 typedef data::ref_ptr<base, true> base_ptr;
@@ -166,6 +168,16 @@ public:
 	    uses the self_reflect() method to find a member with the given property as name. If
 		not found, the get_void method returns false. */
 	virtual bool get_void(const std::string& property, const std::string& value_type, void* value_ptr);
+	//! return whether the default implementations of set_void, get_void and find_member_ptr can use the reflection index of the type
+	/*! The index (see cgv::reflect::reflection_index) is built once per type from self_reflect() and avoids
+	    the reflection of all members on each access. Types opt in by overloading this method to return true,
+		which is only valid if self_reflect() reflects the same members of the instance independent of its state and
+		does not reflect members of other objects. The default returns false. */
+	virtual bool use_reflection_index() const;
+	//! return a handle to a property that allows repeated access without looking up the property again.
+	/*! If the property is not found, the returned handle is invalid. The handle bypasses overloaded
+	    set_void and get_void methods and stays valid as long as the member does not change its location. */
+	property_handle get_property_handle(const std::string& property);
 	//! abstract interface to call an action
 	/*! , i.e. a class method based on the action name and 
 	    the given parameters. The default implementation uses the self_reflect() method to
@@ -207,6 +219,51 @@ public:
 	//@}
 };
 
+/** pre-resolved access to a property of an instance, which is returned by base::get_property_handle() and avoids
+    the lookup of the property in repeated set and get calls, for example when a property is animated in each frame.
+	The set methods perform the conversions of base::set_void() and call base::on_set(). */
+class CGV_API property_handle
+{
+protected:
+	base* instance;
+	void* member_ptr;
+	std::shared_ptr<cgv::reflect::abst_reflection_traits> rt;
+public:
+	/// construct invalid handle
+	property_handle();
+	/// construct from instance, member pointer and reflection traits of member
+	property_handle(base* _instance, void* _member_ptr, const std::shared_ptr<cgv::reflect::abst_reflection_traits>& _rt);
+	/// return whether the handle refers to a property
+	bool is_valid() const { return member_ptr != 0; }
+	/// return pointer to member
+	void* get_member_ptr() const { return member_ptr; }
+	/// return type name of member or empty string for invalid handles
+	std::string get_type_name() const;
+	/// set property from value of given type and return whether this was possible
+	bool set_void(const std::string& value_type, const void* value_ptr);
+	/// copy property to value of given type and return whether this was possible
+	bool get_void(const std::string& value_type, void* value_ptr) const;
+	/// set property, where values of the type of a fundamental member are assigned without conversion
+	template <typename T>
+	bool set(const T& value) {
+		if (rt && cgv::type::info::is_fundamental(rt->get_type_id()) && rt->get_type_id() == cgv::type::info::type_id<T>::get_id()) {
+			*static_cast<T*>(member_ptr) = value;
+			instance->on_set(member_ptr);
+			return true;
+		}
+		return set_void(cgv::type::info::type_name<T>::get_name(), &value);
+	}
+	/// query property, where values of the type of a fundamental member are copied without conversion
+	template <typename T>
+	bool get(T& value) const {
+		if (rt && cgv::type::info::is_fundamental(rt->get_type_id()) && rt->get_type_id() == cgv::type::info::type_id<T>::get_id()) {
+			value = *static_cast<const T*>(member_ptr);
+			return true;
+		}
+		return get_void(cgv::type::info::type_name<T>::get_name(), &value);
+	}
+};
+
 template <typename T>
 inline data::ref_ptr<T, true> cast_helper_base::cast_of_base(base* b)
 {
@@ -795,7 +795,12 @@ bool process_gui_file(const std::string& file_name)
 	return false;
 }
 
-test::test(const std::string& _test_name, bool (*_test_func)()) : test_name(_test_name), test_func(_test_func) {}
+test::test(const std::string& _test_name, bool (*_test_func)(), bool _benchmark) : test_name(_test_name), test_func(_test_func), benchmark(_benchmark) {}
+
+bool test::is_benchmark() const
+{
+	return benchmark;
+}
 
 std::string test::get_test_name() const
 {
@@ -819,6 +824,11 @@ test_registration::test_registration(const std::string& _test_name, bool (*_test
 	register_object(base_ptr(new test(_test_name, _test_func)), "");
 }
 
+benchmark_registration::benchmark_registration(const std::string& _benchmark_name, bool (*_benchmark_func)())
+{
+	register_object(base_ptr(new test(_benchmark_name, _benchmark_func, true)), "");
+}
+
 /// construct
 factory::factory(const std::string& _created_type_name, bool _singleton, const std::string& _object_options)
 	: created_type_name(_created_type_name), is_singleton(_singleton), object_options(_object_options)
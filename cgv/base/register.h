@@ -375,9 +375,13 @@ protected:
 	std::string test_name;
 	/// pointer to test function
 	bool (*test_func)();
+	/// whether the test function is a benchmark
+	bool benchmark;
 public:
 	/// constructor for a test structure
-	test(const std::string& _test_name, bool (*_test_func)());
+	test(const std::string& _test_name, bool (*_test_func)(), bool _benchmark = false);
+	/// return whether the test function is a benchmark, which is only executed on request
+	bool is_benchmark() const;
 	/// implementation of the type name function of the base class
 	std::string get_type_name() const;
 	/// access to name of test function
@@ -406,6 +410,13 @@ struct CGV_API test_registration
 	/// the constructor creates a test structure and registeres the test
 	test_registration(const std::string& _test_name, bool (*_test_func)());
 };
+
+/// declare an instance of benchmark_registration as static variable in order to register a benchmark in a test plugin, which the tester only executes when called with the argument "benchmark"
+struct CGV_API benchmark_registration
+{
+	/// the constructor creates a test structure marked as benchmark and registeres it
+	benchmark_registration(const std::string& _benchmark_name, bool (*_benchmark_func)());
+};
 //@}
 
 
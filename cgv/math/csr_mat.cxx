@@ -0,0 +1,158 @@
+#include "csr_mat.h"
+#include <cgv/utils/parallel_for.h>
+#include <algorithm>
+
+namespace cgv {
+	namespace math {
+
+namespace {
+	/// minimum number of non zero elements processed per thread
+	const size_t min_chunk_size = 65536;
+
+	/// split rows into nr_chunks ranges with similar numbers of entries according to the row offsets
+	void split_rows(const std::vector<size_t>& row_offsets, unsigned nr_chunks, std::vector<unsigned>& row_bounds)
+	{
+		unsigned nr_rows = unsigned(row_offsets.size() - 1);
+		row_bounds.resize(nr_chunks + 1);
+		row_bounds[0] = 0;
+		for (unsigned c = 1; c < nr_chunks; ++c) {
+			size_t target = row_offsets.back()*c / nr_chunks;
+			unsigned r = unsigned(std::lower_bound(row_offsets.begin(), row_offsets.end(), target) - row_offsets.begin());
+			row_bounds[c] = std::max(row_bounds[c - 1], std::min(r, nr_rows));
+		}
+		row_bounds[nr_chunks] = nr_rows;
+	}
+}
+
+csr_mat::csr_mat() : nr_rows(0), nr_cols(0), row_offsets(1, 0)
+{
+}
+
+void csr_mat::assemble(unsigned _nr_rows, unsigned _nr_cols, const std::vector<triplet>& triplets, bool sum_duplicates)
+{
+	nr_rows = _nr_rows;
+	nr_cols = _nr_cols;
+	// counting sort by row keeps the order of triplets within each row
+	row_offsets.assign(size_t(nr_rows) + 1, 0);
+	for (const auto& t : triplets)
+		++row_offsets[t.row + 1];
+	for (unsigned r = 0; r < nr_rows; ++r)
+		row_offsets[r + 1] += row_offsets[r];
+	std::vector<std::pair<unsigned, double> > entries(triplets.size());
+	std::vector<size_t> pos(row_offsets.begin(), row_offsets.end() - 1);
+	for (const auto& t : triplets)
+		entries[pos[t.row]++] = std::make_pair(t.col, t.value);
+	// sort rows stably by column and merge duplicates in place
+	unsigned nr_chunks = cgv::utils::get_nr_chunks(triplets.size(), min_chunk_size, 0);
+	std::vector<unsigned> row_bounds;
+	split_rows(row_offsets, nr_chunks, row_bounds);
+	std::vector<size_t> row_sizes(nr_rows);
+	cgv::utils::parallel_for_tasks(nr_chunks, [&](unsigned c) {
+		for (unsigned r = row_bounds[c]; r < row_bounds[c + 1]; ++r) {
+			auto begin = entries.begin() + row_offsets[r], end = entries.begin() + row_offsets[r + 1];
+			std::stable_sort(begin, end, [](const std::pair<unsigned, double>& a, const std::pair<unsigned, double>& b) { return a.first < b.first; });
+			auto out = begin;
+			for (auto e = begin; e != end; ++e) {
+				if (out != begin && (out - 1)->first == e->first) {
+					if (sum_duplicates)
+						(out - 1)->second += e->second;
+					else
+						(out - 1)->second = e->second;
+				}
+				else
+					*out++ = *e;
+			}
+			row_sizes[r] = out - begin;
+		}
+	});
+	// compact rows
+	size_t nr_entries = 0;
+	for (unsigned r = 0; r < nr_rows; ++r) {
+		size_t begin = row_offsets[r];
+		row_offsets[r] = nr_entries;
+		for (size_t i = 0; i < row_sizes[r]; ++i)
+			entries[nr_entries++] = entries[begin + i];
+	}
+	row_offsets[nr_rows] = nr_entries;
+	col_indices.resize(nr_entries);
+	values.resize(nr_entries);
+	for (size_t i = 0; i < nr_entries; ++i) {
+		col_indices[i] = entries[i].first;
+		values[i] = entries[i].second;
+	}
+}
+
+void csr_mat::clear()
+{
+	nr_rows = nr_cols = 0;
+	row_offsets.assign(1, 0);
+	col_indices.clear();
+	values.clear();
+}
+
+double csr_mat::operator () (unsigned r, unsigned c) const
+{
+	size_t i = find_entry(r, c);
+	return i == size_t(-1) ? 0.0 : values[i];
+}
+
+size_t csr_mat::find_entry(unsigned r, unsigned c) const
+{
+	auto begin = col_indices.begin() + row_offsets[r], end = col_indices.begin() + row_offsets[r + 1];
+	auto iter = std::lower_bound(begin, end, c);
+	if (iter == end || *iter != c)
+		return size_t(-1);
+	return iter - col_indices.begin();
+}
+
+bool csr_mat::has_same_pattern(const csr_mat& M) const
+{
+	return nr_rows == M.nr_rows && nr_cols == M.nr_cols && row_offsets == M.row_offsets && col_indices == M.col_indices;
+}
+
+void csr_mat::extract_diagonal(std::vector<double>& diagonal) const
+{
+	diagonal.resize(std::min(nr_rows, nr_cols));
+	for (unsigned r = 0; r < diagonal.size(); ++r)
+		diagonal[r] = (*this)(r, r);
+}
+
+void csr_mat::compute_row_chunks(unsigned nr_chunks, std::vector<unsigned>& row_bounds) const
+{
+	split_rows(row_offsets, nr_chunks, row_bounds);
+}
+
+void csr_mat::multiply(const double* x, double* y, unsigned row_begin, unsigned row_end) const
+{
+	const size_t* offsets = &row_offsets[0];
+	const unsigned* cols = col_indices.empty() ? 0 : &col_indices[0];
+	const double* vals = values.empty() ? 0 : &values[0];
+	for (unsigned r = row_begin; r < row_end; ++r) {
+		double sum = 0;
+		for (size_t i = offsets[r]; i < offsets[r + 1]; ++i)
+			sum += vals[i] * x[cols[i]];
+		y[r] = sum;
+	}
+}
+
+void csr_mat::multiply(const double* x, double* y, unsigned nr_threads) const
+{
+	unsigned nr_chunks = cgv::utils::get_nr_chunks(get_nr_non_zeros(), min_chunk_size, nr_threads);
+	if (nr_chunks == 1) {
+		multiply(x, y, 0, nr_rows);
+		return;
+	}
+	std::vector<unsigned> row_bounds;
+	compute_row_chunks(nr_chunks, row_bounds);
+	cgv::utils::parallel_for_tasks(nr_chunks, [&](unsigned c) { multiply(x, y, row_bounds[c], row_bounds[c + 1]); });
+}
+
+void csr_mat::multiply(const std::vector<double>& x, std::vector<double>& y, unsigned nr_threads) const
+{
+	y.resize(nr_rows);
+	if (nr_rows > 0)
+		multiply(&x[0], &y[0], nr_threads);
+}
+
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "lib_begin.h"
+
+namespace cgv {
+	namespace math {
+
+/** sparse matrix in compressed sparse row form, which is assembled from (row, column, value) triplets. Column indices
+    are sorted within each row. Matrix vector products are computed in parallel over row ranges of equal numbers of
+	non zero elements. */
+class CGV_API csr_mat
+{
+public:
+	/// matrix entry used for assembly
+	struct triplet
+	{
+		unsigned row, col;
+		double value;
+		/// construct uninitialized triplet
+		triplet() {}
+		/// construct triplet from row, column and value
+		triplet(unsigned _row, unsigned _col, double _value) : row(_row), col(_col), value(_value) {}
+	};
+protected:
+	/// number of rows and columns
+	unsigned nr_rows, nr_cols;
+	/// index of first entry of each row plus final entry with number of non zero elements
+	std::vector<size_t> row_offsets;
+	/// column index of each entry
+	std::vector<unsigned> col_indices;
+	/// value of each entry
+	std::vector<double> values;
+public:
+	/// construct empty matrix
+	csr_mat();
+	/** assemble matrix of given dimensions from triplets. Triplets with the same row and column are summed up if
+	    sum_duplicates is true and otherwise the last one in the triplet vector defines the value. */
+	void assemble(unsigned _nr_rows, unsigned _nr_cols, const std::vector<triplet>& triplets, bool sum_duplicates = true);
+	/// clear matrix
+	void clear();
+	/// return number of rows
+	unsigned get_nr_rows() const { return nr_rows; }
+	/// return number of columns
+	unsigned get_nr_cols() const { return nr_cols; }
+	/// return number of non zero elements
+	size_t get_nr_non_zeros() const { return col_indices.size(); }
+	/// return row offsets with nr_rows+1 entries
+	const std::vector<size_t>& get_row_offsets() const { return row_offsets; }
+	/// return column indices of entries
+	const std::vector<unsigned>& get_col_indices() const { return col_indices; }
+	/// return values of entries
+	const std::vector<double>& get_values() const { return values; }
+	/// return values to update the matrix without changing its pattern
+	std::vector<double>& ref_values() { return values; }
+	/// return entry in row r and column c, which is 0 for entries not in the pattern
+	double operator () (unsigned r, unsigned c) const;
+	/// return index of entry in row r and column c or -1 if it is not in the pattern
+	size_t find_entry(unsigned r, unsigned c) const;
+	/// check whether M has the same dimensions and non zero pattern
+	bool has_same_pattern(const csr_mat& M) const;
+	/// extract the diagonal of the matrix
+	void extract_diagonal(std::vector<double>& diagonal) const;
+	/// split rows into nr_chunks ranges with similar numbers of non zero elements and store the nr_chunks+1 range bounds
+	void compute_row_chunks(unsigned nr_chunks, std::vector<unsigned>& row_bounds) const;
+	/// compute y = A*x for the rows in [row_begin,row_end)
+	void multiply(const double* x, double* y, unsigned row_begin, unsigned row_end) const;
+	/// compute y = A*x with nr_threads threads, 0 for one per hardware thread, where small matrices are multiplied sequentially
+	void multiply(const double* x, double* y, unsigned nr_threads = 0) const;
+	/// compute y = A*x and resize y to the number of rows
+	void multiply(const std::vector<double>& x, std::vector<double>& y, unsigned nr_threads = 0) const;
+};
+
+	}
+}
+
+#include <cgv/config/lib_end.h>
@@ -0,0 +1,843 @@
+#include "sparse_solver.h"
+#include <cgv/utils/parallel_for.h>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cmath>
+
+namespace cgv {
+	namespace math {
+
+namespace {
+	/// marker for missing indices
+	const unsigned none = unsigned(-1);
+	/// minimum number of items processed per thread in vector operations
+	const size_t min_chunk_size = 32768;
+	/// maximum number of vertices in the leaves of the nested dissection
+	const unsigned nd_leaf_size = 64;
+
+	/// compute adjacency lists of the symmetrized pattern of A without diagonal entries
+	void build_adjacency(const csr_mat& A, std::vector<size_t>& offsets, std::vector<unsigned>& adjacency)
+	{
+		unsigned n = A.get_nr_rows();
+		const std::vector<size_t>& row_offsets = A.get_row_offsets();
+		const std::vector<unsigned>& cols = A.get_col_indices();
+		offsets.assign(size_t(n) + 1, 0);
+		for (unsigned r = 0; r < n; ++r)
+			for (size_t i = row_offsets[r]; i < row_offsets[r + 1]; ++i)
+				if (cols[i] != r) {
+					++offsets[r + 1];
+					++offsets[cols[i] + 1];
+				}
+		for (unsigned r = 0; r < n; ++r)
+			offsets[r + 1] += offsets[r];
+		adjacency.resize(offsets[n]);
+		std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+		for (unsigned r = 0; r < n; ++r)
+			for (size_t i = row_offsets[r]; i < row_offsets[r + 1]; ++i)
+				if (cols[i] != r) {
+					adjacency[pos[r]++] = cols[i];
+					adjacency[pos[cols[i]]++] = r;
+				}
+		// remove entries that appear in both triangles
+		size_t nr_entries = 0;
+		for (unsigned r = 0; r < n; ++r) {
+			auto begin = adjacency.begin() + offsets[r], end = adjacency.begin() + offsets[r + 1];
+			std::sort(begin, end);
+			size_t size = std::unique(begin, end) - begin;
+			offsets[r] = nr_entries;
+			std::copy(begin, begin + size, adjacency.begin() + nr_entries);
+			nr_entries += size;
+		}
+		offsets[n] = nr_entries;
+		adjacency.resize(nr_entries);
+	}
+	/** compute nested dissection ordering of a graph, where each region is split by the middle level of a breadth
+	    first search from a pseudo peripheral vertex. Separator vertices without neighbors in the next level are moved
+		to the first part. Regions are ordered as first part, second part and separator. */
+	void compute_nested_dissection(const std::vector<size_t>& offsets, const std::vector<unsigned>& adjacency, std::vector<unsigned>& order)
+	{
+		unsigned n = unsigned(offsets.size() - 1);
+		order.resize(n);
+		for (unsigned v = 0; v < n; ++v)
+			order[v] = v;
+		std::vector<unsigned> region(n, 0), level(n, none), queue, level_begin, part;
+		queue.reserve(n);
+		struct task { unsigned begin, end, region; };
+		std::vector<task> tasks;
+		tasks.push_back({ 0, n, 0 });
+		unsigned nr_regions = 1;
+		while (!tasks.empty()) {
+			task t = tasks.back();
+			tasks.pop_back();
+			unsigned size = t.end - t.begin;
+			// breadth first search within the region that appends to the queue and returns the number of levels
+			auto bfs = [&](unsigned root) -> unsigned {
+				size_t first = queue.size();
+				level_begin.clear();
+				level[root] = 0;
+				queue.push_back(root);
+				for (size_t i = first; i < queue.size(); ++i) {
+					unsigned v = queue[i];
+					if (level_begin.size() == level[v])
+						level_begin.push_back(unsigned(i - first));
+					for (size_t j = offsets[v]; j < offsets[v + 1]; ++j) {
+						unsigned w = adjacency[j];
+						if (region[w] == t.region && level[w] == none) {
+							level[w] = level[v] + 1;
+							queue.push_back(w);
+						}
+					}
+				}
+				level_begin.push_back(unsigned(queue.size() - first));
+				return unsigned(level_begin.size() - 1);
+			};
+			auto reset_levels = [&]() {
+				for (unsigned i = t.begin; i < t.end; ++i)
+					level[order[i]] = none;
+			};
+			reset_levels();
+			queue.clear();
+			unsigned nr_levels = bfs(order[t.begin]);
+			if (queue.size() < size) {
+				// split region into connected components
+				std::vector<unsigned> component_begin(1, 0);
+				for (unsigned i = t.begin; i < t.end; ++i)
+					if (level[order[i]] == none) {
+						component_begin.push_back(unsigned(queue.size()));
+						bfs(order[i]);
+					}
+				component_begin.push_back(size);
+				std::copy(queue.begin(), queue.end(), order.begin() + t.begin);
+				for (size_t c = 0; c + 1 < component_begin.size(); ++c) {
+					unsigned begin = t.begin + component_begin[c], end = t.begin + component_begin[c + 1];
+					if (end - begin <= nd_leaf_size)
+						continue;
+					for (unsigned i = begin; i < end; ++i)
+						region[order[i]] = nr_regions;
+					tasks.push_back({ begin, end, nr_regions++ });
+				}
+				continue;
+			}
+			if (size <= nd_leaf_size) {
+				std::copy(queue.begin(), queue.end(), order.begin() + t.begin);
+				continue;
+			}
+			// find pseudo peripheral vertex as minimum degree vertex of the last level
+			for (unsigned iteration = 0; iteration < 3; ++iteration) {
+				unsigned root = queue[level_begin[nr_levels - 1]];
+				for (unsigned i = level_begin[nr_levels - 1]; i < size; ++i)
+					if (offsets[queue[i] + 1] - offsets[queue[i]] < offsets[root + 1] - offsets[root])
+						root = queue[i];
+				reset_levels();
+				queue.clear();
+				unsigned new_nr_levels = bfs(root);
+				if (new_nr_levels <= nr_levels) {
+					nr_levels = new_nr_levels;
+					break;
+				}
+				nr_levels = new_nr_levels;
+			}
+			if (nr_levels < 3) {
+				std::copy(queue.begin(), queue.end(), order.begin() + t.begin);
+				continue;
+			}
+			// separate at the level containing the median vertex
+			unsigned m = unsigned(std::upper_bound(level_begin.begin(), level_begin.end(), size / 2) - level_begin.begin()) - 1;
+			m = std::max(1u, std::min(m, nr_levels - 2));
+			part.clear();
+			unsigned nr_first = level_begin[m];
+			std::copy(queue.begin(), queue.begin() + nr_first, order.begin() + t.begin);
+			for (unsigned i = level_begin[m]; i < level_begin[m + 1]; ++i) {
+				unsigned v = queue[i];
+				bool is_separator = false;
+				for (size_t j = offsets[v]; j < offsets[v + 1]; ++j)
+					if (region[adjacency[j]] == t.region && level[adjacency[j]] == m + 1) {
+						is_separator = true;
+						break;
+					}
+				if (is_separator)
+					part.push_back(v);
+				else
+					order[t.begin + nr_first++] = v;
+			}
+			unsigned nr_second = size - level_begin[m + 1];
+			std::copy(queue.begin() + level_begin[m + 1], queue.end(), order.begin() + t.begin + nr_first);
+			std::copy(part.begin(), part.end(), order.begin() + t.begin + nr_first + nr_second);
+			for (unsigned i = t.begin; i < t.begin + nr_first; ++i)
+				region[order[i]] = nr_regions;
+			tasks.push_back({ t.begin, t.begin + nr_first, nr_regions++ });
+			for (unsigned i = t.begin + nr_first; i < t.begin + nr_first + nr_second; ++i)
+				region[order[i]] = nr_regions;
+			tasks.push_back({ t.begin + nr_first, t.begin + nr_first + nr_second, nr_regions++ });
+		}
+	}
+}
+
+conjugate_gradient_solver::conjugate_gradient_solver()
+{
+	preconditioner = PT_JACOBI;
+	max_nr_iterations = 10000;
+	tolerance = 1e-10;
+	nr_threads = 0;
+	nr_iterations = 0;
+	residual = 0;
+}
+
+bool conjugate_gradient_solver::solve(const csr_mat& A, const double* b, double* x)
+{
+	unsigned n = A.get_nr_rows();
+	nr_iterations = 0;
+	residual = 0;
+	if (n == 0)
+		return true;
+	unsigned nr_chunks = cgv::utils::get_nr_chunks(A.get_nr_non_zeros(), min_chunk_size, nr_threads);
+	std::vector<unsigned> row_bounds;
+	A.compute_row_chunks(nr_chunks, row_bounds);
+	std::vector<double> inv_diag(n, 1.0);
+	if (preconditioner == PT_JACOBI) {
+		A.extract_diagonal(inv_diag);
+		for (auto& d : inv_diag)
+			d = d == 0 ? 1.0 : 1.0 / d;
+	}
+	std::vector<double> r(n), z(n), p(n), q(n), partial(3 * nr_chunks);
+	auto sum_partial = [&](unsigned i) {
+		double sum = 0;
+		for (unsigned c = 0; c < nr_chunks; ++c)
+			sum += partial[3 * c + i];
+		return sum;
+	};
+	// r = b - A*x, z = M^-1*r and p = z
+	cgv::utils::parallel_for_tasks(nr_chunks, [&](unsigned c) {
+		A.multiply(x, &q[0], row_bounds[c], row_bounds[c + 1]);
+		double rz = 0, rr = 0, bb = 0;
+		for (unsigned i = row_bounds[c]; i < row_bounds[c + 1]; ++i) {
+			r[i] = b[i] - q[i];
+			p[i] = z[i] = inv_diag[i] * r[i];
+			rz += r[i] * z[i];
+			rr += r[i] * r[i];
+			bb += b[i] * b[i];
+		}
+		partial[3 * c] = rz;
+		partial[3 * c + 1] = rr;
+		partial[3 * c + 2] = bb;
+	});
+	double rz = sum_partial(0), rr = sum_partial(1), bb = sum_partial(2);
+	if (bb == 0) {
+		std::fill(x, x + n, 0.0);
+		return true;
+	}
+	double threshold = tolerance*tolerance*bb;
+	bool success = rr <= threshold;
+	while (!success && nr_iterations < max_nr_iterations) {
+		// q = A*p
+		cgv::utils::parallel_for_tasks(nr_chunks, [&](unsigned c) {
+			A.multiply(&p[0], &q[0], row_bounds[c], row_bounds[c + 1]);
+			double pq = 0;
+			for (unsigned i = row_bounds[c]; i < row_bounds[c + 1]; ++i)
+				pq += p[i] * q[i];
+			partial[3 * c] = pq;
+		});
+		double pq = sum_partial(0);
+		if (!(pq > 0))
+			break;
+		double alpha = rz / pq;
+		// update solution and residual
+		cgv::utils::parallel_for_tasks(nr_chunks, [&](unsigned c) {
+			double rz = 0, rr = 0;
+			for (unsigned i = row_bounds[c]; i < row_bounds[c + 1]; ++i) {
+				x[i] += alpha*p[i];
+				r[i] -= alpha*q[i];
+				z[i] = inv_diag[i] * r[i];
+				rz += r[i] * z[i];
+				rr += r[i] * r[i];
+			}
+			partial[3 * c] = rz;
+			partial[3 * c + 1] = rr;
+		});
+		double rz_new = sum_partial(0);
+		rr = sum_partial(1);
+		++nr_iterations;
+		success = rr <= threshold;
+		if (success)
+			break;
+		double beta = rz_new / rz;
+		rz = rz_new;
+		// update search direction
+		cgv::utils::parallel_for_tasks(nr_chunks, [&](unsigned c) {
+			for (unsigned i = row_bounds[c]; i < row_bounds[c + 1]; ++i)
+				p[i] = z[i] + beta*p[i];
+		});
+	}
+	residual = std::sqrt(rr / bb);
+	return success;
+}
+
+bool conjugate_gradient_solver::solve(const csr_mat& A, const std::vector<double>& b, std::vector<double>& x)
+{
+	if (x.size() != b.size())
+		x.assign(b.size(), 0.0);
+	if (b.size() != A.get_nr_rows()) {
+		std::cerr << "conjugate_gradient_solver::solve: right hand side does not match matrix dimension" << std::endl;
+		return false;
+	}
+	if (b.empty())
+		return true;
+	return solve(A, &b[0], &x[0]);
+}
+
+sparse_cholesky::sparse_cholesky() : nr_threads(0), factorized(false)
+{
+}
+
+void sparse_cholesky::clear()
+{
+	pattern.clear();
+	perm.clear();
+	inv_perm.clear();
+	super_begin.clear();
+	super_parent.clear();
+	super_row_offsets.clear();
+	super_rows.clear();
+	super_value_offsets.clear();
+	value_map.clear();
+	values.clear();
+	factorized = false;
+}
+
+bool sparse_cholesky::is_analyzed(const csr_mat& A) const
+{
+	return !super_value_offsets.empty() && pattern.has_same_pattern(A);
+}
+
+bool sparse_cholesky::analyze(const csr_mat& A)
+{
+	clear();
+	if (A.get_nr_rows() != A.get_nr_cols()) {
+		std::cerr << "sparse_cholesky::analyze: matrix is not square" << std::endl;
+		return false;
+	}
+	unsigned n = A.get_nr_rows();
+	std::vector<size_t> offsets;
+	std::vector<unsigned> adjacency;
+	build_adjacency(A, offsets, adjacency);
+	compute_nested_dissection(offsets, adjacency, perm);
+	inv_perm.resize(n);
+	for (unsigned i = 0; i < n; ++i)
+		inv_perm[perm[i]] = i;
+
+	// elimination tree with path compression
+	std::vector<unsigned> parent(n, none), ancestor(n, none);
+	for (unsigned j = 0; j < n; ++j) {
+		unsigned v = perm[j];
+		for (size_t k = offsets[v]; k < offsets[v + 1]; ++k) {
+			unsigned r = inv_perm[adjacency[k]];
+			if (r >= j)
+				continue;
+			while (ancestor[r] != none && ancestor[r] != j) {
+				unsigned next = ancestor[r];
+				ancestor[r] = j;
+				r = next;
+			}
+			if (ancestor[r] == none) {
+				ancestor[r] = j;
+				parent[r] = j;
+			}
+		}
+	}
+	// postorder the elimination tree such that supernodes consist of consecutive columns
+	std::vector<unsigned>& child_head = ancestor;
+	std::vector<unsigned> child_next(n, none), post, stack;
+	std::fill(child_head.begin(), child_head.end(), none);
+	for (unsigned j = n; j-- > 0; )
+		if (parent[j] != none) {
+			child_next[j] = child_head[parent[j]];
+			child_head[parent[j]] = j;
+		}
+	post.reserve(n);
+	for (unsigned j = 0; j < n; ++j) {
+		if (parent[j] != none)
+			continue;
+		stack.push_back(j);
+		while (!stack.empty()) {
+			unsigned v = stack.back();
+			if (child_head[v] != none) {
+				unsigned c = child_head[v];
+				child_head[v] = child_next[c];
+				stack.push_back(c);
+			}
+			else {
+				post.push_back(v);
+				stack.pop_back();
+			}
+		}
+	}
+	std::vector<unsigned> inv_post(n), old_perm(perm);
+	for (unsigned k = 0; k < n; ++k) {
+		perm[k] = old_perm[post[k]];
+		inv_post[post[k]] = k;
+	}
+	for (unsigned k = 0; k < n; ++k) {
+		inv_perm[perm[k]] = k;
+		ancestor[k] = parent[post[k]] == none ? none : inv_post[parent[post[k]]];
+	}
+	parent.swap(ancestor);
+
+	// column counts from the row subtrees of the elimination tree
+	std::vector<size_t> col_count(n, 1);
+	std::vector<unsigned>& mark = ancestor;
+	std::fill(mark.begin(), mark.end(), none);
+	std::vector<unsigned> nr_children(n, 0);
+	for (unsigned i = 0; i < n; ++i) {
+		if (parent[i] != none)
+			++nr_children[parent[i]];
+		mark[i] = i;
+		unsigned v = perm[i];
+		for (size_t k = offsets[v]; k < offsets[v + 1]; ++k) {
+			unsigned j = inv_perm[adjacency[k]];
+			if (j > i)
+				continue;
+			while (mark[j] != i) {
+				++col_count[j];
+				mark[j] = i;
+				j = parent[j];
+			}
+		}
+	}
+	// fundamental supernodes
+	std::vector<unsigned> fund_begin, fund_end, fund_of_col(n);
+	std::vector<size_t> fund_nr_entries;
+	for (unsigned j = 0; j < n; ++j) {
+		if (j == 0 || parent[j - 1] != j || col_count[j - 1] != col_count[j] + 1 || nr_children[j] != 1) {
+			fund_begin.push_back(j);
+			fund_end.push_back(j);
+			fund_nr_entries.push_back(0);
+		}
+		fund_of_col[j] = unsigned(fund_begin.size() - 1);
+		++fund_end.back();
+		fund_nr_entries.back() += col_count[j];
+	}
+	// relax supernodes by merging a child into its parent if this introduces few explicit zeros
+	unsigned nr_fund = unsigned(fund_begin.size());
+	std::vector<bool> merged(nr_fund, false);
+	for (unsigned s = 0; s < nr_fund; ++s) {
+		unsigned pc = parent[fund_end[s] - 1];
+		if (pc == none)
+			continue;
+		unsigned p = fund_of_col[pc];
+		if (fund_begin[p] != pc || fund_end[s] != pc)
+			continue;
+		double w = fund_end[p] - fund_begin[s], h = (pc - fund_begin[s]) + double(col_count[pc]);
+		double nr_entries = w*h - 0.5*w*(w - 1);
+		double zero_fraction = (nr_entries - double(fund_nr_entries[s] + fund_nr_entries[p])) / nr_entries;
+		if (w <= 4 || (w <= 16 && zero_fraction < 0.8) || (w <= 48 && zero_fraction < 0.1) || zero_fraction < 0.05) {
+			fund_begin[p] = fund_begin[s];
+			fund_nr_entries[p] += fund_nr_entries[s];
+			merged[s] = true;
+		}
+	}
+	std::vector<unsigned>& super_of_col = fund_of_col;
+	for (unsigned s = 0; s < nr_fund; ++s)
+		if (!merged[s]) {
+			for (unsigned j = fund_begin[s]; j < fund_end[s]; ++j)
+				super_of_col[j] = unsigned(super_begin.size());
+			super_begin.push_back(fund_begin[s]);
+		}
+	unsigned nr_super = unsigned(super_begin.size());
+	super_begin.push_back(n);
+	super_parent.resize(nr_super);
+	for (unsigned s = 0; s < nr_super; ++s) {
+		unsigned pc = parent[super_begin[s + 1] - 1];
+		super_parent[s] = pc == none ? none : super_of_col[pc];
+	}
+	// row structures as union of the matrix pattern and the structures of the children
+	std::vector<unsigned> super_child_head(nr_super, none), super_child_next(nr_super, none);
+	for (unsigned s = nr_super; s-- > 0; )
+		if (super_parent[s] != none) {
+			super_child_next[s] = super_child_head[super_parent[s]];
+			super_child_head[super_parent[s]] = s;
+		}
+	std::fill(mark.begin(), mark.end(), none);
+	super_row_offsets.resize(nr_super + 1);
+	super_value_offsets.resize(nr_super + 1);
+	super_row_offsets[0] = super_value_offsets[0] = 0;
+	for (unsigned s = 0; s < nr_super; ++s) {
+		unsigned f = super_begin[s], l = super_begin[s + 1];
+		size_t first = super_rows.size();
+		for (unsigned j = f; j < l; ++j) {
+			super_rows.push_back(j);
+			mark[j] = s;
+		}
+		for (unsigned j = f; j < l; ++j) {
+			unsigned v = perm[j];
+			for (size_t k = offsets[v]; k < offsets[v + 1]; ++k) {
+				unsigned i = inv_perm[adjacency[k]];
+				if (i >= l && mark[i] != s) {
+					mark[i] = s;
+					super_rows.push_back(i);
+				}
+			}
+		}
+		for (unsigned c = super_child_head[s]; c != none; c = super_child_next[c])
+			for (size_t k = super_row_offsets[c]; k < super_row_offsets[c + 1]; ++k) {
+				unsigned i = super_rows[k];
+				if (i >= l && mark[i] != s) {
+					mark[i] = s;
+					super_rows.push_back(i);
+				}
+			}
+		std::sort(super_rows.begin() + first + (l - f), super_rows.end());
+		super_row_offsets[s + 1] = super_rows.size();
+		super_value_offsets[s + 1] = super_value_offsets[s] + (super_rows.size() - first)*(l - f);
+	}
+	// map matrix entries to the panels, where entries of the upper triangle are only used if their transposed entry is missing
+	const std::vector<size_t>& row_offsets = A.get_row_offsets();
+	const std::vector<unsigned>& cols = A.get_col_indices();
+	value_map.resize(A.get_nr_non_zeros());
+	unsigned nr_chunks = cgv::utils::get_nr_chunks(A.get_nr_non_zeros(), min_chunk_size, nr_threads);
+	std::vector<unsigned> row_bounds;
+	A.compute_row_chunks(nr_chunks, row_bounds);
+	cgv::utils::parallel_for_tasks(nr_chunks, [&](unsigned c) {
+		for (unsigned v = row_bounds[c]; v < row_bounds[c + 1]; ++v) {
+			for (size_t k = row_offsets[v]; k < row_offsets[v + 1]; ++k) {
+				unsigned i = std::max(inv_perm[v], inv_perm[cols[k]]), j = std::min(inv_perm[v], inv_perm[cols[k]]);
+				if (i == inv_perm[v] && i != j && A.find_entry(cols[k], v) != size_t(-1)) {
+					value_map[k] = size_t(-1);
+					continue;
+				}
+				unsigned s = super_of_col[j];
+				auto rows_begin = super_rows.begin() + super_row_offsets[s], rows_end = super_rows.begin() + super_row_offsets[s + 1];
+				size_t local_row = std::lower_bound(rows_begin, rows_end, i) - rows_begin;
+				value_map[k] = super_value_offsets[s] + (j - super_begin[s])*(rows_end - rows_begin) + local_row;
+			}
+		}
+	});
+	pattern = A;
+	return true;
+}
+
+bool sparse_cholesky::factor_supernodes(unsigned s_begin, unsigned s_end, unsigned link_end, std::vector<unsigned>& head,
+	std::vector<unsigned>& link, std::vector<size_t>& next_row, std::vector<unsigned>& row_map, std::vector<unsigned>& deferred)
+{
+	std::vector<double> update;
+	for (unsigned s = s_begin; s < s_end; ++s) {
+		unsigned f = super_begin[s], w = super_begin[s + 1] - f;
+		const unsigned* rows = &super_rows[super_row_offsets[s]];
+		size_t h = super_row_offsets[s + 1] - super_row_offsets[s];
+		double* L = &values[super_value_offsets[s]];
+		for (size_t k = 0; k < h; ++k)
+			row_map[rows[k]] = unsigned(k);
+		// apply updates of descendants whose next rows fall into the columns of s
+		unsigned d = head[s];
+		head[s] = none;
+		while (d != none) {
+			unsigned next_d = link[d];
+			const unsigned* rows_d = &super_rows[super_row_offsets[d]];
+			size_t h_d = super_row_offsets[d + 1] - super_row_offsets[d];
+			unsigned w_d = super_begin[d + 1] - super_begin[d];
+			const double* L_d = &values[super_value_offsets[d]];
+			size_t p_begin = next_row[d], p_end = p_begin;
+			while (p_end < h_d && rows_d[p_end] < f + w)
+				++p_end;
+			// compute the update for blocks of four target columns to reuse the loaded descendant entries
+			size_t m = h_d - p_begin;
+			update.resize(4 * m);
+			for (size_t c = p_begin; c < p_end; c += 4) {
+				size_t nr_cols = std::min(size_t(4), p_end - c), m_c = h_d - c;
+				double* u = &update[0];
+				std::fill(u, u + 4 * m_c, 0.0);
+				for (unsigned k = 0; k < w_d; ++k) {
+					const double* col = L_d + k*h_d + c;
+					double b0 = col[0], b1 = nr_cols > 1 ? col[1] : 0, b2 = nr_cols > 2 ? col[2] : 0, b3 = nr_cols > 3 ? col[3] : 0;
+					if (b0 == 0 && b1 == 0 && b2 == 0 && b3 == 0)
+						continue;
+					for (size_t r = 0; r < m_c; ++r) {
+						double a = col[r];
+						u[4 * r] += a*b0;
+						u[4 * r + 1] += a*b1;
+						u[4 * r + 2] += a*b2;
+						u[4 * r + 3] += a*b3;
+					}
+				}
+				for (size_t i = 0; i < nr_cols; ++i) {
+					double* target = L + size_t(rows_d[c + i] - f)*h;
+					for (size_t r = i; r < m_c; ++r)
+						target[row_map[rows_d[c + r]]] -= u[4 * r + i];
+				}
+			}
+			next_row[d] = p_end;
+			if (p_end < h_d) {
+				unsigned t = unsigned(std::upper_bound(super_begin.begin(), super_begin.end(), rows_d[p_end]) - super_begin.begin()) - 1;
+				if (t < link_end) {
+					link[d] = head[t];
+					head[t] = d;
+				}
+				else
+					deferred.push_back(d);
+			}
+			d = next_d;
+		}
+		// dense factorization of the panel
+		for (unsigned j = 0; j < w; ++j) {
+			double* L_j = L + j*h;
+			for (unsigned k = 0; k < j; ++k) {
+				const double* L_k = L + k*h;
+				double a = L_k[j];
+				if (a == 0)
+					continue;
+				for (size_t r = j; r < h; ++r)
+					L_j[r] -= a*L_k[r];
+			}
+			if (!(L_j[j] > 0))
+				return false;
+			double diag = std::sqrt(L_j[j]), inv_diag = 1.0 / diag;
+			L_j[j] = diag;
+			for (size_t r = j + 1; r < h; ++r)
+				L_j[r] *= inv_diag;
+		}
+		// link s to the supernode containing its first row below the diagonal block
+		if (h > w) {
+			next_row[s] = w;
+			unsigned t = unsigned(std::upper_bound(super_begin.begin(), super_begin.end(), rows[w]) - super_begin.begin()) - 1;
+			if (t < link_end) {
+				link[s] = head[t];
+				head[t] = s;
+			}
+			else
+				deferred.push_back(s);
+		}
+	}
+	return true;
+}
+
+bool sparse_cholesky::factorize(const csr_mat& A)
+{
+	factorized = false;
+	if (!is_analyzed(A) && !analyze(A))
+		return false;
+	unsigned n = get_nr_unknowns(), nr_super = get_nr_supernodes();
+	unsigned nr_chunks = nr_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : nr_threads;
+	// scatter matrix entries into the panels
+	values.resize(get_nr_factor_entries());
+	unsigned nr_fill_chunks = cgv::utils::get_nr_chunks(values.size(), min_chunk_size, nr_chunks);
+	cgv::utils::parallel_for_tasks(nr_fill_chunks, [&](unsigned c) {
+		std::fill(values.begin() + values.size()*c / nr_fill_chunks, values.begin() + values.size()*(c + 1) / nr_fill_chunks, 0.0);
+	});
+	const std::vector<double>& a = A.get_values();
+	for (size_t k = 0; k < a.size(); ++k)
+		if (value_map[k] != size_t(-1))
+			values[value_map[k]] = a[k];
+
+	// split the supernodal elimination tree into a top part and subtrees assigned to threads
+	std::vector<double> work(nr_super);
+	std::vector<unsigned> first_descendant(nr_super), child_head(nr_super, none), child_next(nr_super, none);
+	for (unsigned s = 0; s < nr_super; ++s)
+		first_descendant[s] = s;
+	for (unsigned s = 0; s < nr_super; ++s) {
+		double w = super_begin[s + 1] - super_begin[s];
+		work[s] += double(super_row_offsets[s + 1] - super_row_offsets[s])*w*w;
+		if (super_parent[s] != none) {
+			work[super_parent[s]] += work[s];
+			first_descendant[super_parent[s]] = std::min(first_descendant[super_parent[s]], first_descendant[s]);
+		}
+	}
+	for (unsigned s = nr_super; s-- > 0; )
+		if (super_parent[s] != none) {
+			child_next[s] = child_head[super_parent[s]];
+			child_head[super_parent[s]] = s;
+		}
+	std::vector<unsigned> subtrees, top;
+	double total_work = 0;
+	for (unsigned s = 0; s < nr_super; ++s)
+		if (super_parent[s] == none) {
+			subtrees.push_back(s);
+			total_work += work[s];
+		}
+	if (nr_chunks > 1) {
+		while (true) {
+			auto iter = std::max_element(subtrees.begin(), subtrees.end(), [&](unsigned s0, unsigned s1) { return work[s0] < work[s1]; });
+			if (iter == subtrees.end() || work[*iter] < total_work / (2 * nr_chunks) || child_head[*iter] == none)
+				break;
+			unsigned s = *iter;
+			subtrees.erase(iter);
+			top.push_back(s);
+			for (unsigned c = child_head[s]; c != none; c = child_next[c])
+				subtrees.push_back(c);
+		}
+	}
+	else {
+		top.swap(subtrees);
+		for (unsigned s = 0; s < nr_super; ++s)
+			if (super_parent[s] != none)
+				top.push_back(s);
+	}
+	std::sort(top.begin(), top.end());
+	std::sort(subtrees.begin(), subtrees.end(), [&](unsigned s0, unsigned s1) { return work[s0] > work[s1]; });
+	nr_chunks = std::max(1u, std::min(nr_chunks, unsigned(subtrees.size())));
+	std::vector<std::vector<unsigned> > chunk_subtrees(nr_chunks);
+	std::vector<double> chunk_work(nr_chunks, 0.0);
+	for (unsigned s : subtrees) {
+		unsigned c = unsigned(std::min_element(chunk_work.begin(), chunk_work.end()) - chunk_work.begin());
+		chunk_subtrees[c].push_back(s);
+		chunk_work[c] += work[s];
+	}
+	// factor subtrees in parallel and the top part sequentially
+	std::vector<unsigned> head(nr_super, none), link(nr_super, none);
+	std::vector<size_t> next_row(nr_super, 0);
+	std::vector<std::vector<unsigned> > deferred(nr_chunks);
+	std::vector<std::vector<unsigned> > row_maps(nr_chunks);
+	std::atomic<bool> success(true);
+	cgv::utils::parallel_for_tasks(nr_chunks, [&](unsigned c) {
+		row_maps[c].resize(n);
+		for (unsigned root : chunk_subtrees[c])
+			if (success && !factor_supernodes(first_descendant[root], root + 1, root + 1, head, link, next_row, row_maps[c], deferred[c]))
+				success = false;
+	});
+	for (const auto& D : deferred)
+		for (unsigned d : D) {
+			unsigned t = unsigned(std::upper_bound(super_begin.begin(), super_begin.end(), super_rows[super_row_offsets[d] + next_row[d]]) - super_begin.begin()) - 1;
+			link[d] = head[t];
+			head[t] = d;
+		}
+	for (unsigned s : top)
+		if (success && !factor_supernodes(s, s + 1, nr_super, head, link, next_row, row_maps[0], deferred[0]))
+			success = false;
+	if (!success) {
+		std::cerr << "sparse_cholesky::factorize: matrix is not positive definite" << std::endl;
+		return false;
+	}
+	factorized = true;
+	return true;
+}
+
+void sparse_cholesky::solve(const double* b, double* x) const
+{
+	unsigned n = get_nr_unknowns();
+	std::vector<double> y(n);
+	for (unsigned i = 0; i < n; ++i)
+		y[i] = b[perm[i]];
+	unsigned nr_super = get_nr_supernodes();
+	// forward substitution with L
+	for (unsigned s = 0; s < nr_super; ++s) {
+		unsigned f = super_begin[s], w = super_begin[s + 1] - f;
+		const unsigned* rows = &super_rows[super_row_offsets[s]];
+		size_t h = super_row_offsets[s + 1] - super_row_offsets[s];
+		const double* L = &values[super_value_offsets[s]];
+		for (unsigned j = 0; j < w; ++j) {
+			const double* L_j = L + j*h;
+			double y_j = y[f + j] /= L_j[j];
+			for (size_t r = j + 1; r < h; ++r)
+				y[rows[r]] -= L_j[r] * y_j;
+		}
+	}
+	// backward substitution with L^T
+	for (unsigned s = nr_super; s-- > 0; ) {
+		unsigned f = super_begin[s], w = super_begin[s + 1] - f;
+		const unsigned* rows = &super_rows[super_row_offsets[s]];
+		size_t h = super_row_offsets[s + 1] - super_row_offsets[s];
+		const double* L = &values[super_value_offsets[s]];
+		for (unsigned j = w; j-- > 0; ) {
+			const double* L_j = L + j*h;
+			double y_j = y[f + j];
+			for (size_t r = j + 1; r < h; ++r)
+				y_j -= L_j[r] * y[rows[r]];
+			y[f + j] = y_j / L_j[j];
+		}
+	}
+	for (unsigned i = 0; i < n; ++i)
+		x[perm[i]] = y[i];
+}
+
+void sparse_cholesky::solve(const std::vector<double>& b, std::vector<double>& x) const
+{
+	x.resize(get_nr_unknowns());
+	if (!x.empty())
+		solve(&b[0], &x[0]);
+}
+
+csr_sparse_les::csr_sparse_les(int _n, int _nr_rhs, int nr_nze, solver_type _solver) :
+	solver(_solver), n(_n), nr_rhs(_nr_rhs), matrix_changed(true), b(size_t(_n)*_nr_rhs, 0.0), x(size_t(_n)*_nr_rhs, 0.0)
+{
+	if (nr_nze > 0)
+		triplets.reserve(nr_nze);
+}
+
+void csr_sparse_les::set_mat_entry(int r, int c, double val)
+{
+	triplets.push_back(csr_mat::triplet(r, c, val));
+	matrix_changed = true;
+}
+
+void csr_sparse_les::set_b_entry(int i, int j, double val)
+{
+	b[size_t(j)*n + i] = val;
+}
+
+double& csr_sparse_les::ref_b_entry(int i, int j)
+{
+	return b[size_t(j)*n + i];
+}
+
+bool csr_sparse_les::solve(bool analyze_residual)
+{
+	if (matrix_changed) {
+		A.assemble(n, n, triplets, false);
+		// drop overwritten entries such that the triplets do not grow with repeated updates
+		if (triplets.size() > A.get_nr_non_zeros()) {
+			triplets.clear();
+			for (unsigned r = 0; r < A.get_nr_rows(); ++r)
+				for (size_t k = A.get_row_offsets()[r]; k < A.get_row_offsets()[r + 1]; ++k)
+					triplets.push_back(csr_mat::triplet(r, A.get_col_indices()[k], A.get_values()[k]));
+		}
+		if (solver == ST_CHOLESKY && !cholesky.factorize(A))
+			return false;
+		matrix_changed = false;
+	}
+	bool success = true;
+	for (int j = 0; j < nr_rhs; ++j) {
+		const double* b_j = &b[size_t(j)*n];
+		double* x_j = &x[size_t(j)*n];
+		if (solver == ST_CHOLESKY)
+			cholesky.solve(b_j, x_j);
+		else if (!cg.solve(A, b_j, x_j)) {
+			std::cerr << "csr_sparse_les::solve: conjugate gradients did not converge for right hand side " << j
+				<< " with residual " << cg.get_residual() << std::endl;
+			success = false;
+		}
+		if (analyze_residual) {
+			std::vector<double> r(n);
+			A.multiply(x_j, &r[0], cg.get_nr_threads());
+			double rr = 0, bb = 0;
+			for (int i = 0; i < n; ++i) {
+				rr += (r[i] - b_j[i])*(r[i] - b_j[i]);
+				bb += b_j[i] * b_j[i];
+			}
+			std::cout << "relative residual of right hand side " << j << ": " << std::sqrt(rr / std::max(bb, 1e-300)) << std::endl;
+		}
+	}
+	return success;
+}
+
+double csr_sparse_les::get_x_entry(int i, int j) const
+{
+	return x[size_t(j)*n + i];
+}
+
+namespace {
+	/// sparse les using the Cholesky factorization
+	struct cholesky_sparse_les : public csr_sparse_les
+	{
+		cholesky_sparse_les(int n, int nr_rhs, int nr_nze) : csr_sparse_les(n, nr_rhs, nr_nze, ST_CHOLESKY) {}
+	};
+	/// sparse les using conjugate gradients
+	struct conjugate_gradient_sparse_les : public csr_sparse_les
+	{
+		conjugate_gradient_sparse_les(int n, int nr_rhs, int nr_nze) : csr_sparse_les(n, nr_rhs, nr_nze, ST_CONJUGATE_GRADIENT) {}
+	};
+	register_sparse_les_factory<cholesky_sparse_les> cholesky_sparse_les_registration("csr_cholesky", SparseLesCaps(SLC_SYMMETRIC | SLC_NZE_OPTIONAL));
+	register_sparse_les_factory<conjugate_gradient_sparse_les> conjugate_gradient_sparse_les_registration("csr_cg", SparseLesCaps(SLC_SYMMETRIC | SLC_NZE_OPTIONAL));
+}
+
+	}
+}
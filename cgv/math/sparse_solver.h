@@ -0,0 +1,165 @@
+#pragma once
+
+#include "csr_mat.h"
+#include "sparse_les.h"
+
+#include "lib_begin.h"
+
+namespace cgv {
+	namespace math {
+
+/** conjugate gradient solver for symmetric positive definite matrices in csr form, where both triangles of the matrix
+    need to be stored. Matrix vector products and vector operations of each iteration are computed in three parallel
+	passes over row ranges. */
+class CGV_API conjugate_gradient_solver
+{
+public:
+	/// supported preconditioners
+	enum preconditioner_type { PT_NONE, PT_JACOBI };
+protected:
+	preconditioner_type preconditioner;
+	unsigned max_nr_iterations;
+	double tolerance;
+	unsigned nr_threads;
+	unsigned nr_iterations;
+	double residual;
+public:
+	/// construct solver with Jacobi preconditioner, at most 10000 iterations and tolerance 1e-10
+	conjugate_gradient_solver();
+	/// set preconditioner
+	void set_preconditioner(preconditioner_type _preconditioner) { preconditioner = _preconditioner; }
+	/// return preconditioner
+	preconditioner_type get_preconditioner() const { return preconditioner; }
+	/// set maximum number of iterations
+	void set_max_nr_iterations(unsigned _max_nr_iterations) { max_nr_iterations = _max_nr_iterations; }
+	/// return maximum number of iterations
+	unsigned get_max_nr_iterations() const { return max_nr_iterations; }
+	/// set tolerance on the residual norm relative to the norm of the right hand side
+	void set_tolerance(double _tolerance) { tolerance = _tolerance; }
+	/// return tolerance
+	double get_tolerance() const { return tolerance; }
+	/// set number of threads, 0 for one per hardware thread
+	void set_nr_threads(unsigned _nr_threads) { nr_threads = _nr_threads; }
+	/// return number of threads
+	unsigned get_nr_threads() const { return nr_threads; }
+	/// solve A*x = b starting with the given x and return whether the tolerance was reached
+	bool solve(const csr_mat& A, const double* b, double* x);
+	/// solve A*x = b, where x is initialized with zeros if it does not match the size of b
+	bool solve(const csr_mat& A, const std::vector<double>& b, std::vector<double>& x);
+	/// return number of iterations of last solve
+	unsigned get_nr_iterations() const { return nr_iterations; }
+	/// return relative residual norm of last solve
+	double get_residual() const { return residual; }
+};
+
+/** sparse Cholesky factorization P*A*P^T = L*L^T of symmetric positive definite matrices in csr form, where either
+    both triangles or only one triangle of the matrix can be stored. The symbolic analysis computes a nested dissection
+	ordering P, the elimination tree and relaxed supernodes, i.e. sets of consecutive columns of L that share their
+	row structure and are stored as dense column major panels. It is cached such that repeated factorizations of
+	matrices with the same pattern only redo the numeric factorization. The numeric factorization is left looking and
+	factors independent subtrees of the supernodal elimination tree in parallel. */
+class CGV_API sparse_cholesky
+{
+protected:
+	unsigned nr_threads;
+	/// pattern of analyzed matrix
+	csr_mat pattern;
+	/// permutation mapping new to old indices and its inverse
+	std::vector<unsigned> perm, inv_perm;
+	/// first column of each supernode plus final entry with the number of columns
+	std::vector<unsigned> super_begin;
+	/// parent of each supernode in the supernodal elimination tree or -1 for roots
+	std::vector<unsigned> super_parent;
+	/// index of the first row of each supernode in super_rows plus final entry
+	std::vector<size_t> super_row_offsets;
+	/// sorted row indices of each supernode, which start with its columns
+	std::vector<unsigned> super_rows;
+	/// offset of each supernode panel in the values plus final entry
+	std::vector<size_t> super_value_offsets;
+	/// for each entry of the analyzed matrix its index in the values or -1 if it is not used
+	std::vector<size_t> value_map;
+	/// dense panels of L
+	std::vector<double> values;
+	/// whether a numeric factorization is available
+	bool factorized;
+	/** factor supernodes [s_begin,s_end) by applying the updates of the descendants linked in head and link. Factored
+	    supernodes are linked to the next supernode they update, where supernodes not below link_end are collected in
+		deferred and linked later by the caller. The row map of size n is thread local. */
+	bool factor_supernodes(unsigned s_begin, unsigned s_end, unsigned link_end, std::vector<unsigned>& head,
+		std::vector<unsigned>& link, std::vector<size_t>& next_row, std::vector<unsigned>& row_map, std::vector<unsigned>& deferred);
+public:
+	/// construct empty factorization
+	sparse_cholesky();
+	/// set number of threads, 0 for one per hardware thread
+	void set_nr_threads(unsigned _nr_threads) { nr_threads = _nr_threads; }
+	/// return number of threads
+	unsigned get_nr_threads() const { return nr_threads; }
+	/// clear factorization
+	void clear();
+	/// compute ordering and supernodal structure of a square matrix
+	bool analyze(const csr_mat& A);
+	/// check whether an analysis is available and applies to A
+	bool is_analyzed(const csr_mat& A) const;
+	/// compute numeric factorization, which analyzes A first if its pattern differs, and return false if A is not positive definite
+	bool factorize(const csr_mat& A);
+	/// check whether numeric factorization is available
+	bool is_factorized() const { return factorized; }
+	/// solve A*x = b with the factorization, where x and b may point to the same memory
+	void solve(const double* b, double* x) const;
+	/// solve A*x = b and resize x
+	void solve(const std::vector<double>& b, std::vector<double>& x) const;
+	/// return number of unknowns
+	unsigned get_nr_unknowns() const { return unsigned(perm.size()); }
+	/// return number of supernodes
+	unsigned get_nr_supernodes() const { return unsigned(super_parent.size()); }
+	/// return number of stored entries of L including explicit zeros of relaxed supernodes
+	size_t get_nr_factor_entries() const { return super_value_offsets.empty() ? 0 : super_value_offsets.back(); }
+	/// return permutation mapping indices of the factorization to indices of the matrix
+	const std::vector<unsigned>& get_permutation() const { return perm; }
+};
+
+/** implementation of the sparse_les interface for symmetric positive definite systems, which collects matrix entries
+    as triplets, where later entries overwrite earlier ones, and solves with a sparse_cholesky factorization or with
+	a conjugate_gradient_solver. Repeated solves reuse the factorization as long as the matrix is not changed and the
+	symbolic analysis as long as the pattern is not changed. The solvers are registered as "csr_cholesky" and
+	"csr_cg". */
+class CGV_API csr_sparse_les : public sparse_les
+{
+public:
+	/// supported solvers
+	enum solver_type { ST_CHOLESKY, ST_CONJUGATE_GRADIENT };
+protected:
+	solver_type solver;
+	int n, nr_rhs;
+	std::vector<csr_mat::triplet> triplets;
+	bool matrix_changed;
+	csr_mat A;
+	std::vector<double> b, x;
+	sparse_cholesky cholesky;
+	conjugate_gradient_solver cg;
+public:
+	/// construct system with n unknowns and nr_rhs right hand sides
+	csr_sparse_les(int _n, int _nr_rhs, int nr_nze = -1, solver_type _solver = ST_CHOLESKY);
+	/// return the Cholesky factorization to configure it
+	sparse_cholesky& ref_cholesky() { return cholesky; }
+	/// return the conjugate gradient solver to configure it
+	conjugate_gradient_solver& ref_conjugate_gradient_solver() { return cg; }
+	/// set entry in row r and column c in the sparse matrix A
+	void set_mat_entry(int r, int c, double val);
+	/// set i-th entry in the j-th right hand side
+	void set_b_entry(int i, int j, double val);
+	/// return reference to i-th entry in j-th right hand side
+	double& ref_b_entry(int i, int j);
+	/// solve system and print relative residuals if analyze_residual is true
+	bool solve(bool analyze_residual = false);
+	/// return the i-th component of the j-th solution vector
+	double get_x_entry(int i, int j) const;
+	using sparse_les::set_b_entry;
+	using sparse_les::ref_b_entry;
+	using sparse_les::get_x_entry;
+};
+
+	}
+}
+
+#include <cgv/config/lib_end.h>
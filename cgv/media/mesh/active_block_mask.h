@@ -0,0 +1,163 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cgv/media/volume/min_max_block_grid.h>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+/** mask of the active blocks of a min_max_block_grid used by the iso-surface extractors to restrict function evaluation and
+    surface construction to cells of active blocks. Grid point (i,j,k) of an extractor corresponds to voxel (i,j,k) and cell
+	(i,j,k) is spanned by the grid points (i..i+1,j..j+1,k..k+1). */
+class active_block_mask
+{
+public:
+	/// range [first,second) of grid point or cell indices along a row
+	typedef std::pair<int, int> span_type;
+protected:
+	int block_size;
+	int nr_blocks[3];
+	int res[3];
+	std::vector<bool> active;
+	/// check resolution and prepare members
+	bool prepare(const cgv::media::volume::min_max_block_grid& grid, unsigned resx, unsigned resy, unsigned resz)
+	{
+		const cgv::media::volume::min_max_block_grid::dimension_type& dims = grid.get_dimensions();
+		if (grid.empty() || dims(0) != int(resx) || dims(1) != int(resy) || dims(2) != int(resz)) {
+			std::cerr << "active_block_mask: block grid does not match the extraction resolution" << std::endl;
+			return false;
+		}
+		block_size = int(grid.get_block_size());
+		for (int c = 0; c < 3; ++c)
+			nr_blocks[c] = grid.get_nr_blocks()(c);
+		res[0] = int(resx); res[1] = int(resy); res[2] = int(resz);
+		return true;
+	}
+	/// check whether block exists and is active
+	bool block_active(int bx, int by, int bz) const
+	{
+		return bx >= 0 && by >= 0 && bz >= 0 && bx < nr_blocks[0] && by < nr_blocks[1] && bz < nr_blocks[2] &&
+			active[bx + nr_blocks[0] * (by + nr_blocks[1] * bz)];
+	}
+	/// append the ranges of active blocks of the given block row with per block ranges [b*block_size, b*block_size+block_size+extend) clamped to end
+	void append_block_spans(int by, int bz, int extend, int end, std::vector<span_type>& spans) const
+	{
+		if (by < 0 || bz < 0 || by >= nr_blocks[1] || bz >= nr_blocks[2])
+			return;
+		for (int bx = 0; bx < nr_blocks[0]; ++bx)
+			if (active[bx + nr_blocks[0] * (by + nr_blocks[1] * bz)])
+				spans.push_back(span_type(bx*block_size, std::min(end, (bx + 1)*block_size + extend)));
+	}
+	/// sort and merge overlapping or touching spans
+	static void merge_spans(std::vector<span_type>& spans)
+	{
+		std::sort(spans.begin(), spans.end());
+		size_t n = 0;
+		for (size_t i = 0; i < spans.size(); ++i) {
+			if (n > 0 && spans[i].first <= spans[n - 1].second)
+				spans[n - 1].second = std::max(spans[n - 1].second, spans[i].second);
+			else
+				spans[n++] = spans[i];
+		}
+		spans.resize(n);
+	}
+public:
+	/// construct empty mask
+	active_block_mask() : block_size(1) { nr_blocks[0] = nr_blocks[1] = nr_blocks[2] = 0; res[0] = res[1] = res[2] = 0; }
+	/// mark the blocks intersecting the iso-surface, where values above iso_value are inside; returns false if the grid does not match the resolution
+	bool init(const cgv::media::volume::min_max_block_grid& grid, float iso_value, unsigned resx, unsigned resy, unsigned resz)
+	{
+		if (!prepare(grid, resx, resy, resz))
+			return false;
+		grid.compute_active_blocks(iso_value, active);
+		return true;
+	}
+	/// mark the blocks for which the block predicate called with minimum and maximum value of the block returns true
+	template <typename F>
+	bool init_if(const cgv::media::volume::min_max_block_grid& grid, const F& block_pred, unsigned resx, unsigned resy, unsigned resz)
+	{
+		if (!prepare(grid, resx, resy, resz))
+			return false;
+		active.resize(size_t(nr_blocks[0])*nr_blocks[1] * nr_blocks[2]);
+		for (unsigned bi = 0; bi < active.size(); ++bi)
+			active[bi] = block_pred(grid.get_min_value(bi), grid.get_max_value(bi));
+		return true;
+	}
+	/// check whether cell (i,j,k) exists and lies in an active block
+	bool is_cell_active(int i, int j, int k) const
+	{
+		return i >= 0 && j >= 0 && k >= 0 && i < res[0] - 1 && j < res[1] - 1 && k < res[2] - 1 &&
+			block_active(i / block_size, j / block_size, k / block_size);
+	}
+	/// check whether grid point (i,j,k) is a corner of a cell in an active block
+	bool is_point_active(int i, int j, int k) const
+	{
+		for (int dk = -1; dk <= 0; ++dk)
+			for (int dj = -1; dj <= 0; ++dj)
+				for (int di = -1; di <= 0; ++di)
+					if (is_cell_active(i + di, j + dj, k + dk))
+						return true;
+		return false;
+	}
+	/// check whether the edge from grid point (i,j,k) along axis e is incident to a cell of an active block
+	bool is_edge_active(int i, int j, int k, int e) const
+	{
+		int p[3] = { i, j, k };
+		int a = (e + 1) % 3, b = (e + 2) % 3;
+		for (int da = -1; da <= 0; ++da)
+			for (int db = -1; db <= 0; ++db) {
+				int c[3] = { p[0], p[1], p[2] };
+				c[a] += da;
+				c[b] += db;
+				if (is_cell_active(c[0], c[1], c[2]))
+					return true;
+			}
+		return false;
+	}
+	/// check whether any cell of cell layers [k0,k1] lies in an active block
+	bool is_layer_range_active(int k0, int k1) const
+	{
+		k0 = std::max(k0, 0);
+		k1 = std::min(k1, res[2] - 2);
+		if (k0 > k1)
+			return false;
+		for (int bz = k0 / block_size; bz <= k1 / block_size; ++bz)
+			for (int by = 0; by < nr_blocks[1]; ++by)
+				for (int bx = 0; bx < nr_blocks[0]; ++bx)
+					if (block_active(bx, by, bz))
+						return true;
+		return false;
+	}
+	/// compute sorted disjoint spans of the grid points in row j that are corners of active cells of layers [k0,k1]
+	void compute_point_spans(int j, int k0, int k1, std::vector<span_type>& spans) const
+	{
+		spans.clear();
+		k0 = std::max(k0, 0);
+		k1 = std::min(k1, res[2] - 2);
+		for (int k = k0; k <= k1; ++k) {
+			if (k > k0 && k / block_size == (k - 1) / block_size)
+				continue;
+			if (j > 0 && j < res[1])
+				append_block_spans((j - 1) / block_size, k / block_size, 1, res[0], spans);
+			if (j < res[1] - 1 && (j == 0 || j / block_size != (j - 1) / block_size))
+				append_block_spans(j / block_size, k / block_size, 1, res[0], spans);
+		}
+		merge_spans(spans);
+	}
+	/// compute sorted disjoint spans of the active cells in row j of layer k
+	void compute_cell_spans(int j, int k, std::vector<span_type>& spans) const
+	{
+		spans.clear();
+		if (j < 0 || k < 0 || j >= res[1] - 1 || k >= res[2] - 1)
+			return;
+		append_block_spans(j / block_size, k / block_size, 0, res[0] - 1, spans);
+		merge_spans(spans);
+	}
+};
+
+		}
+	}
+}
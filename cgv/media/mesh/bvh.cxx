@@ -0,0 +1,424 @@
+#include "bvh.h"
+#include <cgv/utils/parallel_for.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cmath>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+namespace {
+	/// number of bins per axis used to evaluate the surface area heuristic
+	const unsigned nr_bins = 16;
+	/// cost of traversing an inner node relative to intersecting a primitive
+	const double traversal_cost = 1.0;
+	/// depth below which nodes are split at the object median to bound the traversal stack size
+	const unsigned max_sah_depth = 48;
+
+	/// half surface area of box given by min and max coordinates
+	template <typename T>
+	double half_area(const T* min_pnt, const T* max_pnt)
+	{
+		double e[3] = { double(max_pnt[0]) - min_pnt[0], double(max_pnt[1]) - min_pnt[1], double(max_pnt[2]) - min_pnt[2] };
+		return e[0] * e[1] + e[1] * e[2] + e[2] * e[0];
+	}
+	/// extend box given by min and max coordinates by another box
+	template <typename T>
+	inline void extend(T* min_pnt, T* max_pnt, const T* b_min, const T* b_max)
+	{
+		for (unsigned i = 0; i < 3; ++i) {
+			min_pnt[i] = std::min(min_pnt[i], b_min[i]);
+			max_pnt[i] = std::max(max_pnt[i], b_max[i]);
+		}
+	}
+	/// data shared by the threads building a hierarchy
+	template <typename T>
+	struct build_context
+	{
+		typedef typename bvh<T>::vec3 vec3;
+		typedef typename bvh<T>::node_type node_type;
+		/// primitive box with index, which is stored contiguously to avoid indirect accesses while partitioning
+		struct primitive_ref
+		{
+			vec3 min_pnt;
+			uint32_t index;
+			vec3 max_pnt;
+			/// return twice the centroid coordinate along axis
+			T centroid2(unsigned axis) const { return min_pnt[axis] + max_pnt[axis]; }
+		};
+		/// bounds of boxes and of doubled centroids of a range of primitives
+		struct range_bounds
+		{
+			T box_min[3], box_max[3], c_min[3], c_max[3];
+			void init() {
+				std::fill(box_min, box_min + 3, std::numeric_limits<T>::max());
+				std::fill(box_max, box_max + 3, -std::numeric_limits<T>::max());
+				std::fill(c_min, c_min + 3, std::numeric_limits<T>::max());
+				std::fill(c_max, c_max + 3, -std::numeric_limits<T>::max());
+			}
+			void add(const primitive_ref& r) {
+				extend(box_min, box_max, &r.min_pnt[0], &r.max_pnt[0]);
+				T c[3] = { r.centroid2(0), r.centroid2(1), r.centroid2(2) };
+				extend(c_min, c_max, c, c);
+			}
+			void add(const range_bounds& b) {
+				extend(box_min, box_max, b.box_min, b.box_max);
+				extend(c_min, c_max, b.c_min, b.c_max);
+			}
+		};
+		/// per axis and bin the bounds and number of primitives
+		struct bin_set
+		{
+			T box_min[3][nr_bins][3], box_max[3][nr_bins][3];
+			uint32_t count[3][nr_bins];
+			const T* c_min;
+			const T* scale;
+			void init() {
+				for (unsigned a = 0; a < 3; ++a)
+					for (unsigned b = 0; b < nr_bins; ++b) {
+						std::fill(box_min[a][b], box_min[a][b] + 3, std::numeric_limits<T>::max());
+						std::fill(box_max[a][b], box_max[a][b] + 3, -std::numeric_limits<T>::max());
+						count[a][b] = 0;
+					}
+			}
+			void add(const primitive_ref& r) {
+				for (unsigned a = 0; a < 3; ++a) {
+					unsigned b = std::min(nr_bins - 1, unsigned((r.centroid2(a) - c_min[a])*scale[a]));
+					++count[a][b];
+					extend(box_min[a][b], box_max[a][b], &r.min_pnt[0], &r.max_pnt[0]);
+				}
+			}
+			void add(const bin_set& bs) {
+				for (unsigned a = 0; a < 3; ++a)
+					for (unsigned b = 0; b < nr_bins; ++b) {
+						extend(box_min[a][b], box_max[a][b], bs.box_min[a][b], bs.box_max[a][b]);
+						count[a][b] += bs.count[a][b];
+					}
+			}
+		};
+		std::vector<primitive_ref> refs;
+		std::vector<node_type>& nodes;
+		std::atomic<uint32_t> nr_nodes;
+		std::atomic<int> nr_free_threads;
+		unsigned nr_chunks;
+		size_t parallel_threshold;
+		unsigned max_leaf_size;
+		build_context(std::vector<node_type>& _nodes) : nodes(_nodes), nr_nodes(1), nr_free_threads(0) {}
+		/// accumulate refs [begin,end) into an accumulator initialized by the caller, in parallel chunks if requested
+		template <typename A>
+		void accumulate(uint32_t begin, uint32_t end, bool parallel, A& result)
+		{
+			unsigned k = parallel ? unsigned(std::min(size_t(nr_chunks), size_t(end - begin) / 4096)) : 1;
+			if (k <= 1) {
+				for (uint32_t i = begin; i < end; ++i)
+					result.add(refs[i]);
+				return;
+			}
+			std::vector<A> partial(k, result);
+			cgv::utils::for_each_chunk(end - begin, k, [&](unsigned c, size_t chunk_begin, size_t chunk_end) {
+				for (size_t i = chunk_begin; i < chunk_end; ++i)
+					partial[c].add(refs[begin + i]);
+			});
+			for (unsigned c = 0; c < k; ++c)
+				result.add(partial[c]);
+		}
+		/// build subtree of node ni at given depth over refs [begin,end)
+		void build(uint32_t ni, uint32_t begin, uint32_t end, unsigned depth)
+		{
+			uint32_t n = end - begin;
+			// bounds of large nodes near the root are computed in parallel before subtrees are distributed over threads
+			bool parallel = n >= parallel_threshold && (uint64_t(1) << std::min(depth, 63u)) < nr_chunks;
+			range_bounds rb;
+			rb.init();
+			accumulate(begin, end, parallel, rb);
+			node_type& node = nodes[ni];
+			for (unsigned i = 0; i < 3; ++i) {
+				node.min_pnt[i] = rb.box_min[i];
+				node.max_pnt[i] = rb.box_max[i];
+			}
+			node.axis = 0;
+			if (n <= 1 || (n <= max_leaf_size && n <= 2)) {
+				node.offset = begin;
+				node.count = uint16_t(n);
+				return;
+			}
+			// evaluate binned surface area heuristic along all axes
+			T c_ext[3] = { rb.c_max[0] - rb.c_min[0], rb.c_max[1] - rb.c_min[1], rb.c_max[2] - rb.c_min[2] };
+			T scale[3];
+			for (unsigned a = 0; a < 3; ++a)
+				scale[a] = c_ext[a] > 0 ? T(nr_bins*(1 - 1e-5)) / c_ext[a] : T(0);
+			int best_axis = -1;
+			unsigned best_split = 0;
+			double best_cost = std::numeric_limits<double>::max();
+			if (depth < max_sah_depth && (c_ext[0] > 0 || c_ext[1] > 0 || c_ext[2] > 0)) {
+				bin_set bins;
+				bins.init();
+				bins.c_min = rb.c_min;
+				bins.scale = scale;
+				accumulate(begin, end, parallel, bins);
+				for (unsigned a = 0; a < 3; ++a) {
+					if (c_ext[a] <= 0)
+						continue;
+					// sweep from the right to accumulate areas and counts of the right side
+					double right_cost[nr_bins];
+					T r_min[3], r_max[3];
+					std::fill(r_min, r_min + 3, std::numeric_limits<T>::max());
+					std::fill(r_max, r_max + 3, -std::numeric_limits<T>::max());
+					uint32_t r_count = 0;
+					for (unsigned b = nr_bins - 1; b > 0; --b) {
+						extend(r_min, r_max, bins.box_min[a][b], bins.box_max[a][b]);
+						r_count += bins.count[a][b];
+						right_cost[b] = r_count > 0 ? half_area(r_min, r_max)*r_count : 0;
+					}
+					T l_min[3], l_max[3];
+					std::fill(l_min, l_min + 3, std::numeric_limits<T>::max());
+					std::fill(l_max, l_max + 3, -std::numeric_limits<T>::max());
+					uint32_t l_count = 0;
+					for (unsigned b = 0; b + 1 < nr_bins; ++b) {
+						extend(l_min, l_max, bins.box_min[a][b], bins.box_max[a][b]);
+						l_count += bins.count[a][b];
+						if (l_count == 0 || l_count == n)
+							continue;
+						double cost = half_area(l_min, l_max)*l_count + right_cost[b + 1];
+						if (cost < best_cost) {
+							best_cost = cost;
+							best_axis = a;
+							best_split = b + 1;
+						}
+					}
+				}
+			}
+			double node_area = half_area(rb.box_min, rb.box_max);
+			if (n <= max_leaf_size && (best_axis == -1 || node_area <= 0 || traversal_cost + best_cost / node_area >= n)) {
+				node.offset = begin;
+				node.count = uint16_t(n);
+				return;
+			}
+			uint32_t mid;
+			if (best_axis != -1) {
+				T s = scale[best_axis], c0 = rb.c_min[best_axis];
+				unsigned a = best_axis;
+				mid = uint32_t(std::partition(refs.begin() + begin, refs.begin() + end, [&](const primitive_ref& r) {
+					return std::min(nr_bins - 1, unsigned((r.centroid2(a) - c0)*s)) < best_split;
+				}) - refs.begin());
+			}
+			else {
+				// split deep nodes and coincident centroids at the object median along the largest centroid extent
+				unsigned a = c_ext[0] >= c_ext[1] ? (c_ext[0] >= c_ext[2] ? 0 : 2) : (c_ext[1] >= c_ext[2] ? 1 : 2);
+				best_axis = a;
+				mid = begin + n / 2;
+				std::nth_element(refs.begin() + begin, refs.begin() + mid, refs.begin() + end,
+					[a](const primitive_ref& r0, const primitive_ref& r1) { return r0.centroid2(a) < r1.centroid2(a); });
+			}
+			uint32_t ci = nr_nodes.fetch_add(2);
+			node.offset = ci;
+			node.count = 0;
+			node.axis = uint16_t(best_axis);
+			if (n >= parallel_threshold && nr_free_threads.fetch_sub(1) > 0) {
+				std::thread t(&build_context::build, this, ci, begin, mid, depth + 1);
+				build(ci + 1, mid, end, depth + 1);
+				t.join();
+				++nr_free_threads;
+			}
+			else {
+				if (n >= parallel_threshold)
+					++nr_free_threads;
+				build(ci, begin, mid, depth + 1);
+				build(ci + 1, mid, end, depth + 1);
+			}
+		}
+	};
+	/// return squared distance of p to box
+	template <typename T>
+	inline T sqr_box_distance(const cgv::math::fvec<T, 3>& p, const cgv::math::fvec<T, 3>& min_pnt, const cgv::math::fvec<T, 3>& max_pnt)
+	{
+		T d2 = 0;
+		for (unsigned i = 0; i < 3; ++i) {
+			T d = std::max(std::max(min_pnt[i] - p[i], p[i] - max_pnt[i]), T(0));
+			d2 += d*d;
+		}
+		return d2;
+	}
+}
+
+template <typename T>
+bvh<T>::bvh() : nr_threads(0), parallel_threshold(100000), max_leaf_size(4)
+{
+}
+
+template <typename T>
+unsigned bvh<T>::get_nr_chunks(size_t n, size_t min_chunk_size) const
+{
+	return cgv::utils::get_nr_chunks(n, min_chunk_size, nr_threads);
+}
+
+template <typename T>
+void bvh<T>::clear()
+{
+	nodes.clear();
+	primitive_indices.clear();
+}
+
+template <typename T>
+void bvh<T>::build_nodes(const std::vector<vec3>& box_min, const std::vector<vec3>& box_max)
+{
+	clear();
+	size_t n = box_min.size();
+	if (n == 0)
+		return;
+	max_leaf_size = std::max(1u, std::min(max_leaf_size, 65535u));
+	nodes.resize(2 * n - 1);
+	primitive_indices.resize(n);
+	build_context<T> ctx(nodes);
+	ctx.parallel_threshold = std::max(parallel_threshold, size_t(2));
+	ctx.max_leaf_size = max_leaf_size;
+	ctx.nr_chunks = get_nr_chunks(n);
+	ctx.nr_free_threads = int(ctx.nr_chunks) - 1;
+	ctx.refs.resize(n);
+	cgv::utils::for_each_chunk(n, get_nr_chunks(n), [&](unsigned, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			ctx.refs[i].min_pnt = box_min[i];
+			ctx.refs[i].max_pnt = box_max[i];
+			ctx.refs[i].index = uint32_t(i);
+		}
+	});
+	ctx.build(0, 0, uint32_t(n), 0);
+	cgv::utils::for_each_chunk(n, get_nr_chunks(n), [&](unsigned, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			primitive_indices[i] = ctx.refs[i].index;
+	});
+	nodes.resize(ctx.nr_nodes);
+	nodes.shrink_to_fit();
+}
+
+template <typename T>
+void bvh<T>::refit_nodes(const std::vector<vec3>& box_min, const std::vector<vec3>& box_max)
+{
+	const T inf = std::numeric_limits<T>::max();
+	cgv::utils::for_each_chunk(nodes.size(), get_nr_chunks(nodes.size()), [&](unsigned, size_t begin, size_t end) {
+		for (size_t ni = begin; ni < end; ++ni) {
+			node_type& node = nodes[ni];
+			if (!node.is_leaf())
+				continue;
+			node.min_pnt = vec3(inf);
+			node.max_pnt = vec3(-inf);
+			for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+				extend(&node.min_pnt[0], &node.max_pnt[0], &box_min[i][0], &box_max[i][0]);
+		}
+	});
+	// children are stored behind their parents
+	for (size_t ni = nodes.size(); ni > 0; ) {
+		node_type& node = nodes[--ni];
+		if (node.is_leaf())
+			continue;
+		node.min_pnt = nodes[node.offset].min_pnt;
+		node.max_pnt = nodes[node.offset].max_pnt;
+		extend(&node.min_pnt[0], &node.max_pnt[0], &nodes[node.offset + 1].min_pnt[0], &nodes[node.offset + 1].max_pnt[0]);
+	}
+}
+
+template <typename T>
+typename bvh<T>::box_type bvh<T>::get_box() const
+{
+	if (nodes.empty())
+		return box_type();
+	return box_type(nodes[0].min_pnt, nodes[0].max_pnt);
+}
+
+template <typename T>
+unsigned bvh<T>::compute_depth() const
+{
+	if (nodes.empty())
+		return 0;
+	std::vector<unsigned> depths(nodes.size(), 1);
+	unsigned depth = 1;
+	for (size_t ni = 0; ni < nodes.size(); ++ni) {
+		if (nodes[ni].is_leaf())
+			depth = std::max(depth, depths[ni]);
+		else
+			depths[nodes[ni].offset] = depths[nodes[ni].offset + 1] = depths[ni] + 1;
+	}
+	return depth;
+}
+
+template <typename T>
+void point_bvh<T>::build(const std::vector<vec3>& _points)
+{
+	this->build_nodes(_points, _points);
+	points.resize(_points.size());
+	for (size_t i = 0; i < points.size(); ++i)
+		points[i] = _points[this->primitive_indices[i]];
+}
+
+template <typename T>
+void point_bvh<T>::refit(const std::vector<vec3>& _points)
+{
+	for (size_t i = 0; i < points.size(); ++i)
+		points[i] = _points[this->primitive_indices[i]];
+	this->refit_nodes(points, points);
+}
+
+template <typename T>
+int point_bvh<T>::find_closest_point(const vec3& p, T max_distance, T* sqr_distance_ptr) const
+{
+	int result = -1;
+	if (this->nodes.empty())
+		return result;
+	T best = max_distance < std::sqrt(std::numeric_limits<T>::max()) ? max_distance*max_distance : std::numeric_limits<T>::max();
+	uint32_t stack[bvh<T>::max_stack_size];
+	unsigned top = 0;
+	stack[top++] = 0;
+	const node_type* nodes = &this->nodes.front();
+	while (top > 0) {
+		const node_type& node = nodes[stack[--top]];
+		if (sqr_box_distance(p, node.min_pnt, node.max_pnt) >= best)
+			continue;
+		if (node.is_leaf()) {
+			for (uint32_t i = node.offset; i < node.offset + node.count; ++i) {
+				T d2 = (points[i] - p).sqr_length();
+				if (d2 < best) {
+					best = d2;
+					result = int(i);
+				}
+			}
+			continue;
+		}
+		// push far child first to visit near child first
+		T d0 = sqr_box_distance(p, nodes[node.offset].min_pnt, nodes[node.offset].max_pnt);
+		T d1 = sqr_box_distance(p, nodes[node.offset + 1].min_pnt, nodes[node.offset + 1].max_pnt);
+		if (d0 == d1) {
+			// if p is inside of both boxes, descend into the box with the closer center first
+			d0 = (nodes[node.offset].min_pnt + nodes[node.offset].max_pnt - T(2)*p).sqr_length();
+			d1 = (nodes[node.offset + 1].min_pnt + nodes[node.offset + 1].max_pnt - T(2)*p).sqr_length();
+		}
+		uint32_t near_ni = d0 <= d1 ? node.offset : node.offset + 1;
+		stack[top++] = 2 * node.offset + 1 - near_ni;
+		stack[top++] = near_ni;
+	}
+	if (result == -1)
+		return -1;
+	if (sqr_distance_ptr)
+		*sqr_distance_ptr = best;
+	return int(this->primitive_indices[result]);
+}
+
+template <typename T>
+void point_bvh<T>::find_closest_points(const std::vector<vec3>& query_points, std::vector<int>& indices, T max_distance) const
+{
+	indices.resize(query_points.size());
+	cgv::utils::for_each_chunk(query_points.size(), this->get_nr_chunks(query_points.size()), [&](unsigned, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			indices[i] = find_closest_point(query_points[i], max_distance);
+	});
+}
+
+template class bvh<float>;
+template class bvh<double>;
+template class point_bvh<float>;
+template class point_bvh<double>;
+
+		}
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <cgv/math/fvec.h>
+#include <cgv/media/axis_aligned_box.h>
+
+#include <cgv/media/lib_begin.h>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+/** bounding volume hierarchy over primitives given by axis aligned boxes, which is built top down with the surface
+    area heuristic evaluated on binned primitive centroids. Subtrees of at least get_parallel_threshold() primitives
+	are built in separate threads. Nodes are stored in a flat array, where the two children of an inner node are
+	stored next to each other behind their parent, such that refitting can traverse the array in reverse order.
+	Primitive indices are stored in leaf order and derived classes reorder their primitive data accordingly. */
+template <typename T>
+class CGV_API bvh
+{
+public:
+	typedef cgv::math::fvec<T, 3> vec3;
+	typedef axis_aligned_box<T, 3> box_type;
+	/// node with bounding box, where inner nodes have count 0 and their children at offset and offset+1
+	struct node_type
+	{
+		vec3 min_pnt;
+		/// index of first child for inner nodes or of first primitive for leaves
+		uint32_t offset;
+		vec3 max_pnt;
+		/// number of primitives in leaf or 0 for inner nodes
+		uint16_t count;
+		/// split axis of inner nodes
+		uint16_t axis;
+		/// check whether node is a leaf
+		bool is_leaf() const { return count > 0; }
+	};
+	/// size of traversal stacks, which bounds the depth of the hierarchy
+	static const unsigned max_stack_size = 128;
+protected:
+	/// number of threads, 0 for one per hardware thread
+	unsigned nr_threads;
+	/// minimum number of primitives of a subtree to be built in a separate thread
+	size_t parallel_threshold;
+	/// maximum number of primitives in a leaf
+	unsigned max_leaf_size;
+	/// flattened nodes with the root at index 0
+	std::vector<node_type> nodes;
+	/// primitive indices in leaf order
+	std::vector<uint32_t> primitive_indices;
+	/// return number of chunks used to process n items in parallel, which is at most the number of threads and keeps chunks of at least min_chunk_size items
+	unsigned get_nr_chunks(size_t n, size_t min_chunk_size = 1024) const;
+	/// build hierarchy over boxes given by their min and max points
+	void build_nodes(const std::vector<vec3>& box_min, const std::vector<vec3>& box_max);
+	/// recompute node boxes from boxes given in leaf order, where leaf boxes are computed in parallel
+	void refit_nodes(const std::vector<vec3>& box_min, const std::vector<vec3>& box_max);
+public:
+	/// construct empty hierarchy
+	bvh();
+	/// set number of threads used for building and batched queries, 0 for one per hardware thread
+	void set_nr_threads(unsigned _nr_threads) { nr_threads = _nr_threads; }
+	/// return number of threads
+	unsigned get_nr_threads() const { return nr_threads; }
+	/// set minimum number of primitives of a subtree to be built in a separate thread, which defaults to 100000
+	void set_parallel_threshold(size_t _parallel_threshold) { parallel_threshold = _parallel_threshold; }
+	/// return parallel threshold
+	size_t get_parallel_threshold() const { return parallel_threshold; }
+	/// set maximum number of primitives per leaf, which defaults to 4 and must be called before building
+	void set_max_leaf_size(unsigned _max_leaf_size) { max_leaf_size = _max_leaf_size; }
+	/// return maximum number of primitives per leaf
+	unsigned get_max_leaf_size() const { return max_leaf_size; }
+	/// clear hierarchy
+	void clear();
+	/// check whether hierarchy is empty
+	bool is_empty() const { return nodes.empty(); }
+	/// return flattened nodes
+	const std::vector<node_type>& get_nodes() const { return nodes; }
+	/// return primitive indices in leaf order
+	const std::vector<uint32_t>& get_primitive_indices() const { return primitive_indices; }
+	/// return bounding box of all primitives
+	box_type get_box() const;
+	/// return depth of hierarchy, where a single leaf has depth 1
+	unsigned compute_depth() const;
+};
+
+/// bounding volume hierarchy over a point set supporting closest point queries
+template <typename T>
+class CGV_API point_bvh : public bvh<T>
+{
+public:
+	typedef typename bvh<T>::vec3 vec3;
+	typedef typename bvh<T>::node_type node_type;
+protected:
+	/// points in leaf order
+	std::vector<vec3> points;
+public:
+	/// build hierarchy over given points
+	void build(const std::vector<vec3>& _points);
+	/// update points that have moved and refit the node boxes without changing the hierarchy
+	void refit(const std::vector<vec3>& _points);
+	/** find point closest to p with distance below max_distance and return its index or -1 if no point is found. If
+	    given, the squared distance is stored in sqr_distance_ptr. */
+	int find_closest_point(const vec3& p, T max_distance = std::numeric_limits<T>::max(), T* sqr_distance_ptr = 0) const;
+	/// find closest points for a batch of query points in parallel
+	void find_closest_points(const std::vector<vec3>& query_points, std::vector<int>& indices, T max_distance = std::numeric_limits<T>::max()) const;
+};
+
+		}
+	}
+}
+
+#include <cgv/config/lib_end.h>
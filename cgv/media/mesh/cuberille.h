@@ -7,6 +7,7 @@
 #include <cgv/math/mfunc.h>
 #include <cgv/media/axis_aligned_box.h>
 #include "streaming_mesh.h"
+#include "active_block_mask.h"
 
 namespace cgv {
 	namespace media {
@@ -18,6 +19,8 @@ namespace cgv {
 				T reference_value;
 				greater_equal(const T& _value) : reference_value(_value) {}
 				bool operator () (const T& _value) const { return _value >= reference_value; }
+				/// check whether the predicate can hold for a value in [min_value,max_value]
+				bool may_hold(const T& min_value, const T& max_value) const { return max_value >= reference_value; }
 			};
 
 			template <typename T>
@@ -26,6 +29,8 @@ namespace cgv {
 				T reference_value;
 				equal(const T& _value) : reference_value(_value) {}
 				bool operator () (const T& _value) const { return _value == reference_value; }
+				/// check whether the predicate can hold for a value in [min_value,max_value]
+				bool may_hold(const T& min_value, const T& max_value) const { return min_value <= reference_value && reference_value <= max_value; }
 			};
 
 
@@ -78,6 +83,9 @@ private:
 	unsigned int resx, resy, resz;
 	vec_type d;
 	const P& pred;
+	/// whether function evaluation is restricted to the active blocks of mask
+	bool use_mask;
+	active_block_mask mask;
 protected:
 	const cgv::math::v3_func<X,T>& func;
 public:
@@ -85,7 +93,7 @@ public:
 	cuberille(const cgv::math::v3_func<X,T>& _func,
 			  streaming_mesh_callback_handler* _smcbh, 
 		      const P& _pred) :
-	func(_func), pred(_pred)
+	func(_func), pred(_pred), use_mask(false)
 	{
 		base_type::set_callback_handler(_smcbh);
 	}
@@ -97,8 +105,8 @@ public:
 		else
 			base_type::new_quad(vi, vj, vk, vl);
 	}
-	/// generate all vertices needed in the given slice I[0] with I[1] being the previous slice
-	void process_slice(c_slice_info<T, P>* I[2])
+	/// generate all vertices needed in the given slice I[0] of index k with I[1] being the previous slice
+	void process_slice(c_slice_info<T, P>* I[2], int k)
 	{
 		// init slice info
 		I[0]->init();
@@ -107,7 +115,8 @@ public:
 		for (j = 0, p(1) = minp(1); j <= resy; ++j, p(1) += d(1)) {
 			for (i = 0, p(0) = minp(0); i <= resx; ++i, p(0) += d(0)) {
 				// set voxel flag
-				I[0]->set_flag(i, j, i < resx && j < resy && pred(func.evaluate(p.to_vec())));
+				// voxels outside of blocks where the predicate may hold are not evaluated
+				I[0]->set_flag(i, j, i < resx && j < resy && (!use_mask || mask.is_point_active(i, j, k)) && pred(func.evaluate(p.to_vec())));
 				// and check whether assigned vertex is needed
 				bool need_vertex = false;
 				need_vertex = need_vertex || (I[0]->flag(i, j) != I[1]->flag(i, j));     // z(x0,y0)
@@ -145,6 +154,20 @@ public:
 			}
 		}
 	}
+	/** extract surface at the resolution of the block grid and only evaluate func in blocks where the predicate may hold,
+	    which requires P to provide a may_hold(min_value, max_value) method as greater_equal and equal do */
+	void extract(const axis_aligned_box<X,3>& box,
+				 const cgv::media::volume::min_max_block_grid& blocks,
+				 bool show_progress = false)
+	{
+		const cgv::media::volume::min_max_block_grid::dimension_type& dims = blocks.get_dimensions();
+		const P& block_pred = pred;
+		if (!mask.init_if(blocks, [&block_pred](float min_value, float max_value) { return block_pred.may_hold(T(min_value), T(max_value)); }, dims(0), dims(1), dims(2)))
+			return;
+		use_mask = true;
+		extract(box, dims(0), dims(1), dims(2), show_progress);
+		use_mask = false;
+	}
 	/// extract iso surface and send quads to streaming mesh handler
 	void extract(const axis_aligned_box<X,3>& box,
 				 unsigned int _resx, unsigned int _resy, unsigned int _resz,
@@ -165,7 +188,7 @@ public:
 		c_slice_info<T, P> slice_info_1(resx+1,resy+1), slice_info_2(resx+1,resy+1);
 		c_slice_info<T, P> *I[2] = { &slice_info_1, &slice_info_2 };
 		for (unsigned k=0; k<=resz; ++k, p(2) += d(2)) {
-			process_slice(I);
+			process_slice(I, k);
 			base_type::drop_vertices(I[1]->nr_vertices);
 			// show progression
 			if (show_progress)
@@ -7,6 +7,7 @@
 #include <cgv/math/mfunc.h>
 #include <cgv/media/axis_aligned_box.h>
 #include "streaming_mesh.h"
+#include "active_block_mask.h"
 
 namespace cgv {
 	namespace media {
@@ -97,6 +98,22 @@ private:
 	unsigned int resx, resy, resz;
 	vec_type d;
 	T iso_value;
+	/// grid coordinates along x and y
+	std::vector<X> xs, ys;
+	/// whether extraction is restricted to the active blocks of mask
+	bool use_mask;
+	active_block_mask mask;
+	std::vector<active_block_mask::span_type> spans;
+	/// compute the spans of grid points of row j that are incident to cells of layers [k0,k1] to be processed
+	void compute_point_spans(int j, int k0, int k1)
+	{
+		if (use_mask)
+			mask.compute_point_spans(j, k0, k1, spans);
+		else
+			spans.assign(1, active_block_mask::span_type(0, int(resx)));
+	}
+	/// check whether the edge from grid point (i,j,k) along axis e needs to be processed
+	bool is_edge_active(int i, int j, int k, int e) const { return !use_mask || mask.is_edge_active(i, j, k, e); }
 protected:
 	const cgv::math::v3_func<X,T>& func;
 	X epsilon;
@@ -108,7 +125,7 @@ public:
 				    streaming_mesh_callback_handler* _smcbh, 
 					const X& _consistency_threshold = 0.01f, unsigned int _max_nr_iters = 10,
 					const X& _epsilon = 1e-6f) :
-	func(_func), max_nr_iters(_max_nr_iters), consistency_threshold(_consistency_threshold), epsilon(_epsilon)
+	func(_func), max_nr_iters(_max_nr_iters), consistency_threshold(_consistency_threshold), epsilon(_epsilon), use_mask(false)
 	{
 		base_type::set_callback_handler(_smcbh);
 	}
@@ -213,24 +230,28 @@ public:
 		if (C3) { if (C3->count == 0) { C3->Q = Q; C3->center = q; } else { C3->Q += Q; C3->center += q; } ++C3->count; }
 		if (C4) { if (C4->count == 0) { C4->Q = Q; C4->center = q; } else { C4->Q += Q; C4->center += q; } ++C4->count; }
 	}
-	/// process a slice
-	void process_slice(dc_slice_info<T> *prev_info_ptr, dc_slice_info<T> *info_ptr)
+	/// process slice k
+	void process_slice(dc_slice_info<T> *prev_info_ptr, dc_slice_info<T> *info_ptr, int k)
 	{
 		unsigned int i,j;
 		info_ptr->init();
-		for (j = 0, p(1) = minp(1); j < resy; ++j, p(1) += d(1))
-			for (i = 0, p(0) = minp(0); i < resx; ++i, p(0)+=d(0)) {
+		for (j = 0; j < resy; ++j) {
+			p(1) = ys[j];
+			compute_point_spans(j, k-1, k);
+			for (const auto& s : spans)
+			for (i = s.first; i < unsigned(s.second); ++i) {
+				p(0) = xs[i];
 				// eval function on slice
 				info_ptr->set_value(i,j,func.evaluate(p.to_vec()),iso_value);
 				// process slice internal edges
-				if (i > 0 && info_ptr->flag(i-1,j) != info_ptr->flag(i,j))
+				if (i > 0 && is_edge_active(i-1,j,k,0) && info_ptr->flag(i-1,j) != info_ptr->flag(i,j))
 					process_edge_plane(info_ptr->value(i-1,j),
 											 info_ptr->value(i,j), 0,
 											 &info_ptr->info(i-1,j),
 											 j > 0 ? &info_ptr->info(i-1,j-1) : 0,
 											 prev_info_ptr ? &prev_info_ptr->info(i-1,j) : 0,
 											 (j > 0 && prev_info_ptr) ? &prev_info_ptr->info(i-1,j-1) : 0);
-				if (j > 0 && info_ptr->flag(i,j-1) != info_ptr->flag(i,j))
+				if (j > 0 && is_edge_active(i,j-1,k,1) && info_ptr->flag(i,j-1) != info_ptr->flag(i,j))
 					process_edge_plane(info_ptr->value(i,j-1),
 											 info_ptr->value(i,j), 1,
 											 &info_ptr->info(i,j-1),
@@ -238,15 +259,20 @@ public:
 											 prev_info_ptr ? &prev_info_ptr->info(i,j-1) : 0,
 											 (i > 0 && prev_info_ptr) ? &prev_info_ptr->info(i-1,j-1) : 0);
 			}
+		}
 	}
-	/// 
-	void process_slab(dc_slice_info<T> *info_ptr_1, dc_slice_info<T> *info_ptr_2)
+	/// process the slab between slices k-1 and k
+	void process_slab(dc_slice_info<T> *info_ptr_1, dc_slice_info<T> *info_ptr_2, int k)
 	{
 		unsigned int i,j;
-		for (j = 0, p(1) = minp(1); j < resy; ++j, p(1) += d(1))
-			for (i = 0, p(0) = minp(0); i < resx; ++i, p(0)+=d(0)) {
+		for (j = 0; j < resy; ++j) {
+			p(1) = ys[j];
+			compute_point_spans(j, k-1, k-1);
+			for (const auto& s : spans)
+			for (i = s.first; i < unsigned(s.second); ++i) {
+				p(0) = xs[i];
 				// process slab edges
-				if (info_ptr_1->flag(i,j) != info_ptr_2->flag(i,j))
+				if (is_edge_active(i,j,k-1,2) && info_ptr_1->flag(i,j) != info_ptr_2->flag(i,j))
 					process_edge_plane(info_ptr_1->value(i,j),
 											 info_ptr_2->value(i,j), 2,
 											 &info_ptr_1->info(i,j),
@@ -257,35 +283,55 @@ public:
 				if (i>0 && j>0)
 					compute_cell_vertex(info_ptr_1, i-1,j-1);
 			}
+		}
 		// generate the quads of inner edges inside the slab
-		for (j = 1, p(1) = minp(1)+d(1); j < resy-1; ++j, p(1) += d(1))
-			for (i = 1, p(0) = minp(0)+d(0); i < resx-1; ++i, p(0)+=d(0))
-				if (info_ptr_1->flag(i,j) != info_ptr_2->flag(i,j))
+		for (j = 1; j < resy-1; ++j) {
+			compute_point_spans(j, k-1, k-1);
+			for (const auto& s : spans)
+			for (i = std::max(1, s.first); i < std::min(resx-1, unsigned(s.second)); ++i)
+				if (is_edge_active(i,j,k-1,2) && info_ptr_1->flag(i,j) != info_ptr_2->flag(i,j))
 					generate_quad(info_ptr_1->index(i,j),
 									  info_ptr_1->index(i-1,j),
 									  info_ptr_1->index(i-1,j-1),
 									  info_ptr_1->index(i,j-1),
 									  info_ptr_1->flag(i,j));
+		}
 	}
-	/// 
-	void generate_slice_quads(dc_slice_info<T> *info_ptr_1, dc_slice_info<T> *info_ptr_2)
+	/// generate the quads of edges in slice k, whose cell vertices are stored in info_ptr_1 and info_ptr_2
+	void generate_slice_quads(dc_slice_info<T> *info_ptr_1, dc_slice_info<T> *info_ptr_2, int k)
 	{
 		unsigned int i,j;
-		for (j = 1, p(1) = minp(1)+d(1); j < resy-1; ++j, p(1) += d(1))
-			for (i = 1, p(0) = minp(0)+d(0); i < resx-1; ++i, p(0)+=d(0)) {
-				if (info_ptr_2->flag(i-1,j) != info_ptr_2->flag(i,j))
+		for (j = 1; j < resy-1; ++j) {
+			compute_point_spans(j, k-1, k);
+			for (const auto& s : spans)
+			for (i = std::max(1, s.first); i < std::min(resx-1, unsigned(s.second)); ++i) {
+				if (is_edge_active(i-1,j,k,0) && info_ptr_2->flag(i-1,j) != info_ptr_2->flag(i,j))
 					generate_quad(info_ptr_1->index(i-1,j),
 									  info_ptr_2->index(i-1,j),
 									  info_ptr_2->index(i-1,j-1),
 									  info_ptr_1->index(i-1,j-1),
 									  info_ptr_2->flag(i-1,j));
-				if (info_ptr_2->flag(i,j-1) != info_ptr_2->flag(i,j))
+				if (is_edge_active(i,j-1,k,1) && info_ptr_2->flag(i,j-1) != info_ptr_2->flag(i,j))
 					generate_quad(info_ptr_1->index(i,j-1),
 									  info_ptr_1->index(i-1,j-1),
 									  info_ptr_2->index(i-1,j-1),
 									  info_ptr_2->index(i,j-1),
 									  info_ptr_2->flag(i,j-1));
 			}
+		}
+	}
+	/// extract iso surface only in the blocks of a block grid that can intersect the iso surface, where the resolution is given by the block grid
+	void extract(const T& _iso_value,
+				 const axis_aligned_box<X,3>& box,
+				 const cgv::media::volume::min_max_block_grid& blocks,
+				 bool show_progress = false)
+	{
+		const cgv::media::volume::min_max_block_grid::dimension_type& dims = blocks.get_dimensions();
+		if (!mask.init(blocks, float(_iso_value), dims(0), dims(1), dims(2)))
+			return;
+		use_mask = true;
+		extract(_iso_value, box, dims(0), dims(1), dims(2), show_progress);
+		use_mask = false;
 	}
 	/// extract iso surface and send quads to dual contouring handler
 	void extract(const T& _iso_value,
@@ -299,6 +345,14 @@ public:
 		d = box.get_extent();
 		d(0) /= (resx-1); d(1) /= (resy-1); d(2) /= (resz-1);
 		iso_value = _iso_value;
+		xs.resize(resx);
+		ys.resize(resy);
+		unsigned int i, j;
+		for (i = 0, p(0) = minp(0); i < resx; ++i, p(0) += d(0))
+			xs[i] = p(0);
+		for (j = 0, p(1) = minp(1); j < resy; ++j, p(1) += d(1))
+			ys[j] = p(1);
+		p = minp;
 
 		// prepare progression
 		cgv::utils::progression prog;
@@ -312,10 +366,10 @@ public:
 		unsigned int nr_vertices[4] = { 0, 0, 0, 0 };
 		unsigned int k, n;
 
-		process_slice(0, slice_info_ptrs[0]);
+		process_slice(0, slice_info_ptrs[0], 0);
 		p(2) += d(2);
-		process_slice(slice_info_ptrs[0], slice_info_ptrs[1]);
-		process_slab(slice_info_ptrs[0], slice_info_ptrs[1]);
+		process_slice(slice_info_ptrs[0], slice_info_ptrs[1], 1);
+		process_slab(slice_info_ptrs[0], slice_info_ptrs[1], 1);
 		p(2) += d(2);
 		// show progression
 		if (show_progress) {
@@ -328,9 +382,9 @@ public:
 			dc_slice_info<T> *info_ptr_0 = slice_info_ptrs[(k-2)%3];
 			dc_slice_info<T> *info_ptr_1 = slice_info_ptrs[(k-1)%3];
 			dc_slice_info<T> *info_ptr_2 = slice_info_ptrs[k%3];
-			process_slice(info_ptr_1, info_ptr_2);
-			process_slab(info_ptr_1, info_ptr_2);
-			generate_slice_quads(info_ptr_0, info_ptr_1);
+			process_slice(info_ptr_1, info_ptr_2, k);
+			process_slab(info_ptr_1, info_ptr_2, k);
+			generate_slice_quads(info_ptr_0, info_ptr_1, k-1);
 
 			n = base_type::get_nr_vertices()-n;
 			nr_vertices[k%4] = n;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+/** hash map from N-tuples of 32 bit keys to 32 bit indices with open addressing and linear probing in flat arrays. The
+    table grows when it becomes half full. Used to find unique index tuples and to weld vertices by their coordinate bits. */
+template <unsigned N>
+class flat_index_map
+{
+	std::vector<uint32_t> keys;
+	std::vector<uint32_t> values;
+	size_t mask, size;
+	static size_t hash(const uint32_t* key)
+	{
+		uint64_t h = 0;
+		for (unsigned i = 0; i < N; ++i)
+			h = (h ^ key[i]) * 0x9E3779B97F4A7C15ull;
+		return size_t(h ^ (h >> 32));
+	}
+	size_t find_slot(const uint32_t* key) const
+	{
+		size_t slot = hash(key) & mask;
+		while (values[slot] != uint32_t(-1) && !std::equal(key, key + N, &keys[N*slot]))
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+	void rehash(size_t capacity)
+	{
+		std::vector<uint32_t> old_keys(N*capacity), old_values(capacity, uint32_t(-1));
+		keys.swap(old_keys);
+		values.swap(old_values);
+		mask = capacity - 1;
+		for (size_t i = 0; i < old_values.size(); ++i)
+			if (old_values[i] != uint32_t(-1)) {
+				size_t slot = find_slot(&old_keys[N*i]);
+				std::copy(&old_keys[N*i], &old_keys[N*i] + N, &keys[N*slot]);
+				values[slot] = old_values[i];
+			}
+	}
+public:
+	/// construct for the expected number of keys
+	flat_index_map(size_t expected_size) : size(0)
+	{
+		size_t capacity = 16;
+		while (capacity < 2 * expected_size)
+			capacity *= 2;
+		rehash(capacity);
+	}
+	/// return reference to the value of the key, which is inserted with value uint32_t(-1) if not present; values must not be set to uint32_t(-1)
+	uint32_t& operator [] (const uint32_t* key)
+	{
+		size_t slot = find_slot(key);
+		if (values[slot] == uint32_t(-1)) {
+			if (2 * (size + 1) > values.size()) {
+				rehash(2 * values.size());
+				slot = find_slot(key);
+			}
+			std::copy(key, key + N, &keys[N*slot]);
+			++size;
+		}
+		return values[slot];
+	}
+};
+
+		}
+	}
+}
@@ -2,11 +2,17 @@
 
 #include <vector>
 #include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 #include <cgv/utils/progression.h>
 #include <cgv/math/fvec.h>
 #include <cgv/math/mfunc.h>
 #include <cgv/media/axis_aligned_box.h>
 #include <cgv/media/mesh/streaming_mesh.h>
+#include <cgv/media/mesh/active_block_mask.h>
 
 #include <cgv/media/lib_begin.h>
 
@@ -64,6 +70,24 @@ struct slice_info
 	int& snap_index(int x, int y)		 { return indices[4 * (y*resx + x) + 3]; }
 };
 
+/** result of the extraction of a slab of slices in the parallel marching cubes mode. Vertices are referenced by
+    codes, where nonnegative codes index the vertices of the slab, -1 denotes a missing vertex and codes c < -1 refer
+	to entry -2-c of the indices of the last slice of the previous slab. */
+template <typename X>
+struct marching_cubes_slab
+{
+	/// locations of the vertices created in the slab
+	std::vector<cgv::math::fvec<X, 3> > vertices;
+	/// per vertex -1 or the code of a snap vertex of the previous slab, which replaces the vertex if it exists
+	std::vector<int> snap_codes;
+	/// per slice the end of its vertices and triangle corners
+	std::vector<size_t> slice_vertex_end, slice_corner_end;
+	/// vertex codes of triangle corners
+	std::vector<int> corners;
+	/// vertex codes of the indices of the last slice
+	std::vector<int> last_indices;
+};
+
 /// class used to perform the marching cubes algorithm
 template <typename X, typename T>
 class marching_cubes_base : public streaming_mesh<X>
@@ -81,14 +105,138 @@ private:
 protected:
 	X epsilon;
 	X grid_epsilon;
+	/// number of threads used for extraction
+	unsigned nr_threads;
+	/// construct a vertex of a slab, which behaves like construct_vertex but defers the reuse of snap vertices of the previous slab
+	void construct_slab_vertex(marching_cubes_slab<X>& slab, const pnt_type& p,
+		slice_info<T>* info_ptr_1, int i_1, int j_1, int e,
+		slice_info<T>* info_ptr_2, int i_2, int j_2) const
+	{
+		T v_1 = info_ptr_1->value(i_1, j_1);
+		T v_2 = info_ptr_2->value(i_2, j_2);
+		X f = (fabs(v_2 - v_1) > epsilon) ? (X)(iso_value - v_1) / (v_2 - v_1) : (X) 0.5;
+		int vi = (int)slab.vertices.size();
+		int snap_code = -1;
+		pnt_type q = p;
+		if (f < grid_epsilon) {
+			int vj = info_ptr_1->snap_index(i_1, j_1);
+			if (vj < -1)
+				snap_code = vj;
+			else if (vj != -1) {
+				info_ptr_1->index(i_1, j_1, e) = vj;
+				return;
+			}
+			info_ptr_1->snap_index(i_1, j_1) = vi;
+			q(e) -= d(e);
+		}
+		else if (1 - f < grid_epsilon) {
+			int vj = info_ptr_2->snap_index(i_2, j_2);
+			if (vj != -1) {
+				info_ptr_1->index(i_1, j_1, e) = vj;
+				return;
+			}
+			info_ptr_2->snap_index(i_2, j_2) = vi;
+		}
+		else
+			q(e) -= (1 - f)*d(e);
+
+		info_ptr_1->index(i_1, j_1, e) = vi;
+		slab.vertices.push_back(q);
+		slab.snap_codes.push_back(snap_code);
+	}
+	/// extract slices [k0,k1) into a slab in the same way as extract_impl, where the slice k0-1 is only evaluated
+	template <typename Eval, typename Valid>
+	void extract_slab(unsigned int k0, unsigned int k1, const axis_aligned_box<X, 3>& box,
+		unsigned int resx, unsigned int resy, const Eval& eval, const Valid& valid, marching_cubes_slab<X>& slab) const
+	{
+		slice_info<T> slice_info_1(resx, resy), slice_info_2(resx, resy);
+		slice_info<T> *slice_info_ptrs[2] = { &slice_info_1, &slice_info_2 };
+		unsigned int i, j, k, k_begin = k0 > 0 ? k0 - 1 : 0;
+		// accumulate z-coordinate in the same way as extract_impl to get identical vertex locations
+		pnt_type p = box.get_min_pnt();
+		for (k = 0; k < k_begin; ++k)
+			p(2) += d(2);
+		for (k = k_begin; k < k1; ++k, p(2) += d(2)) {
+			slice_info<T> *info_ptr = slice_info_ptrs[k & 1];
+			info_ptr->init();
+			if (k < k0) {
+				// slice of previous slab whose edge vertices are referenced through codes
+				for (j = 0, p(1) = box.get_min_pnt()(1); j < resy; ++j, p(1) += d(1))
+					for (i = 0, p(0) = box.get_min_pnt()(0); i < resx; ++i, p(0) += d(0)) {
+						info_ptr->set_value(i, j, eval(i, j, k, p), iso_value);
+						int c = 4 * (j*resx + i);
+						info_ptr->index(i, j, 0) = -2 - c;
+						info_ptr->index(i, j, 1) = -3 - c;
+						info_ptr->snap_index(i, j) = -5 - c;
+					}
+				continue;
+			}
+			for (j = 0, p(1) = box.get_min_pnt()(1); j < resy; ++j, p(1) += d(1))
+				for (i = 0, p(0) = box.get_min_pnt()(0); i < resx; ++i, p(0) += d(0)) {
+				T v = eval(i, j, k, p);
+				info_ptr->set_value(i, j, v, iso_value);
+				if (valid(v)) {
+					if (i > 0 && info_ptr->flag(i - 1, j) != info_ptr->flag(i, j) && valid(info_ptr->value(i - 1, j)))
+						construct_slab_vertex(slab, p, info_ptr, i - 1, j, 0, info_ptr, i, j);
+					if (j > 0 && info_ptr->flag(i, j - 1) != info_ptr->flag(i, j) && valid(info_ptr->value(i, j - 1)))
+						construct_slab_vertex(slab, p, info_ptr, i, j - 1, 1, info_ptr, i, j);
+				}
+				}
+			if (k != 0) {
+				slice_info<T> *prev_info_ptr = slice_info_ptrs[1 - (k & 1)];
+				for (j = 0, p(1) = box.get_min_pnt()(1); j < resy; ++j, p(1) += d(1))
+					for (i = 0, p(0) = box.get_min_pnt()(0); i < resx; ++i, p(0) += d(0))
+						if (prev_info_ptr->flag(i, j) != info_ptr->flag(i, j) && valid(prev_info_ptr->value(i, j)) && valid(info_ptr->value(i, j)))
+							construct_slab_vertex(slab, p, prev_info_ptr, i, j, 2, info_ptr, i, j);
+				for (j = 0; j < resy - 1; ++j) {
+					for (i = 0; i < resx - 1; ++i) {
+						int idx = prev_info_ptr->get_bit_code(i, j) +
+							16 * info_ptr->get_bit_code(i, j);
+						if (idx == 0 || idx == 255)
+							continue;
+						int vis[12] = {
+							prev_info_ptr->index(i, j, 0),
+							prev_info_ptr->index(i + 1, j, 1),
+							prev_info_ptr->index(i, j + 1, 0),
+							prev_info_ptr->index(i, j, 1),
+							info_ptr->index(i, j, 0),
+							info_ptr->index(i + 1, j, 1),
+							info_ptr->index(i, j + 1, 0),
+							info_ptr->index(i, j, 1),
+							prev_info_ptr->index(i, j, 2),
+							prev_info_ptr->index(i + 1, j, 2),
+							prev_info_ptr->index(i, j + 1, 2),
+							prev_info_ptr->index(i + 1, j + 1, 2)
+						};
+						// missing vertices and degenerate triangles are detected after resolving the codes
+						int n = get_nr_cube_triangles(idx);
+						for (int t = 0; t < n; ++t) {
+							int vi, vj, vk;
+							put_cube_triangle(idx, t, vi, vj, vk);
+							slab.corners.push_back(vis[vk]);
+							slab.corners.push_back(vis[vj]);
+							slab.corners.push_back(vis[vi]);
+						}
+					}
+				}
+			}
+			slab.slice_vertex_end.push_back(slab.vertices.size());
+			slab.slice_corner_end.push_back(slab.corners.size());
+		}
+		slab.last_indices = slice_info_ptrs[(k1 - 1) & 1]->indices;
+	}
 public:
 	/// construct marching cubes object
 	marching_cubes_base(streaming_mesh_callback_handler* _smcbh, 
 				   const X& _grid_epsilon = 0.01f, 
-				   const X& _epsilon = 1e-6f) : epsilon(_epsilon), grid_epsilon(_grid_epsilon)
+				   const X& _epsilon = 1e-6f) : epsilon(_epsilon), grid_epsilon(_grid_epsilon), nr_threads(1)
 	{
 		base_type::set_callback_handler(_smcbh);
 	}
+	/// set number of threads used for extraction, where 0 uses all cores and 1 the sequential extraction
+	void set_nr_threads(unsigned int n) { nr_threads = n; }
+	/// return number of threads used for extraction
+	unsigned int get_nr_threads() const { return nr_threads; }
 	/// construct a new vertex on an edge
 	void construct_vertex(slice_info<T> *info_ptr_1, int i_1, int j_1, int e,
 		slice_info<T> *info_ptr_2, int i_2, int j_2)
@@ -125,13 +273,22 @@ public:
 		this->new_vertex(q);
 	}
 
-	/// extract iso surface and send triangles to marching cubes handler
+	//! extract iso surface and send triangles to marching cubes handler
+	/*! If more than one thread is configured with set_nr_threads(), the volume is split into slabs of slices that are
+	    extracted in parallel, which requires eval and valid to be thread safe. The slabs are stitched and passed to the
+		handler in order on the calling thread, such that vertices, triangles and callbacks are identical to the
+		sequential extraction. */
 	template <typename Eval, typename Valid>
 	void extract_impl(const T& _iso_value,
 		const axis_aligned_box<X, 3>& box,
 		unsigned int resx, unsigned int resy, unsigned int resz,
 		const Eval& eval, const Valid& valid, bool show_progress = false)
 	{
+		unsigned int nr_workers = nr_threads > 0 ? nr_threads : std::max(1u, std::thread::hardware_concurrency());
+		if (nr_workers > 1 && resz > 2) {
+			extract_parallel_impl(_iso_value, box, resx, resy, resz, eval, valid, show_progress, nr_workers);
+			return;
+		}
 		// prepare private members
 		p = box.get_min_pnt();
 		d = box.get_extent();
@@ -225,6 +382,229 @@ public:
 				base_type::drop_vertices(n);
 		}
 	}
+	/// parallel version of extract_impl, where slabs are extracted by worker threads and stitched in order on the calling thread
+	template <typename Eval, typename Valid>
+	void extract_parallel_impl(const T& _iso_value,
+		const axis_aligned_box<X, 3>& box,
+		unsigned int resx, unsigned int resy, unsigned int resz,
+		const Eval& eval, const Valid& valid, bool show_progress, unsigned int nr_workers)
+	{
+		p = box.get_min_pnt();
+		d = box.get_extent();
+		d(0) /= (resx - 1); d(1) /= (resy - 1); d(2) /= (resz - 1);
+		iso_value = _iso_value;
+
+		cgv::utils::progression prog;
+		if (show_progress) prog.init("extraction", resz, 10);
+
+		// each slab evaluates one additional slice, so use slabs of at least 8 slices
+		unsigned int slab_size = std::max(8u, (resz + 4 * nr_workers - 1) / (4 * nr_workers));
+		unsigned int nr_slabs = (resz + slab_size - 1) / slab_size;
+		nr_workers = std::min(nr_workers, nr_slabs);
+		std::vector<std::unique_ptr<marching_cubes_slab<X> > > slabs(nr_slabs);
+		std::mutex mutex;
+		std::condition_variable cv;
+		unsigned int next_slab = 0, nr_stitched = 0;
+		// workers extract slabs, but at most two slabs per worker ahead of stitching to bound memory
+		auto work = [&]() {
+			for (;;) {
+				unsigned int s;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					cv.wait(lock, [&]() { return next_slab >= nr_slabs || next_slab < nr_stitched + 2 * nr_workers; });
+					if (next_slab >= nr_slabs)
+						return;
+					s = next_slab++;
+				}
+				std::unique_ptr<marching_cubes_slab<X> > slab(new marching_cubes_slab<X>());
+				extract_slab(s*slab_size, std::min(resz, (s + 1)*slab_size), box, resx, resy, eval, valid, *slab);
+				std::lock_guard<std::mutex> lock(mutex);
+				slabs[s] = std::move(slab);
+				cv.notify_all();
+			}
+		};
+		std::vector<std::thread> workers;
+		for (unsigned int w = 0; w < nr_workers; ++w)
+			workers.push_back(std::thread(work));
+
+		// stitch slabs in order by resolving vertex codes to global vertex indices
+		std::vector<int> prev_last_indices, global_indices;
+		unsigned int nr_vertices[3] = { 0, 0, 0 };
+		for (unsigned int s = 0; s < nr_slabs; ++s) {
+			std::unique_ptr<marching_cubes_slab<X> > slab;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&]() { return slabs[s] != nullptr; });
+				slab = std::move(slabs[s]);
+			}
+			global_indices.resize(slab->vertices.size());
+			auto resolve = [&](int code) {
+				return code >= 0 ? global_indices[code] : (code == -1 ? -1 : prev_last_indices[-2 - code]);
+			};
+			size_t vertex_begin = 0, corner_begin = 0;
+			unsigned int k0 = s*slab_size;
+			for (unsigned int l = 0; l < slab->slice_vertex_end.size(); ++l) {
+				unsigned int k = k0 + l;
+				int n = (int)base_type::get_nr_vertices();
+				for (size_t v = vertex_begin; v < slab->slice_vertex_end[l]; ++v) {
+					int vj = slab->snap_codes[v] == -1 ? -1 : resolve(slab->snap_codes[v]);
+					global_indices[v] = vj != -1 ? vj : (int)base_type::new_vertex(slab->vertices[v]);
+				}
+				if (show_progress)
+					prog.step();
+				for (size_t c = corner_begin; c < slab->slice_corner_end[l]; c += 3) {
+					int vi = resolve(slab->corners[c]);
+					int vj = resolve(slab->corners[c + 1]);
+					int vk = resolve(slab->corners[c + 2]);
+					if (vi == -1 || vj == -1 || vk == -1)
+						continue;
+					if ((vi != vj) && (vi != vk) && (vj != vk))
+						base_type::new_triangle(vi, vj, vk);
+				}
+				vertex_begin = slab->slice_vertex_end[l];
+				corner_begin = slab->slice_corner_end[l];
+				n = (int)base_type::get_nr_vertices() - n;
+				nr_vertices[k % 3] = n;
+				n = nr_vertices[(k + 2) % 3];
+				if (n > 0)
+					base_type::drop_vertices(n);
+			}
+			prev_last_indices.resize(slab->last_indices.size());
+			for (size_t i = 0; i < slab->last_indices.size(); ++i)
+				prev_last_indices[i] = resolve(slab->last_indices[i]);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				++nr_stitched;
+				cv.notify_all();
+			}
+		}
+		for (auto& w : workers)
+			w.join();
+	}
+	//! extract iso surface only in the blocks of a min max block grid that can intersect the iso surface
+	/*! The resolution is given by the dimensions of the block grid and grid point (i,j,k) corresponds to voxel (i,j,k).
+	    Function evaluation and triangle construction is restricted to the cells of active blocks, which yields the same
+		vertices, triangles and callbacks as extract_impl. */
+	template <typename Eval, typename Valid>
+	void extract_sparse_impl(const T& _iso_value,
+		const axis_aligned_box<X, 3>& box,
+		const cgv::media::volume::min_max_block_grid& blocks,
+		const Eval& eval, const Valid& valid, bool show_progress = false)
+	{
+		const cgv::media::volume::min_max_block_grid::dimension_type& dims = blocks.get_dimensions();
+		unsigned int resx = dims(0), resy = dims(1), resz = dims(2);
+		active_block_mask mask;
+		if (!mask.init(blocks, float(_iso_value), resx, resy, resz))
+			return;
+
+		// prepare private members
+		p = box.get_min_pnt();
+		d = box.get_extent();
+		d(0) /= (resx - 1); d(1) /= (resy - 1); d(2) /= (resz - 1);
+		iso_value = _iso_value;
+
+		// precompute grid coordinates with the same accumulation as in extract_impl
+		std::vector<X> xs(resx), ys(resy);
+		unsigned int i, j, k;
+		for (i = 0, p(0) = box.get_min_pnt()(0); i < resx; ++i, p(0) += d(0))
+			xs[i] = p(0);
+		for (j = 0, p(1) = box.get_min_pnt()(1); j < resy; ++j, p(1) += d(1))
+			ys[j] = p(1);
+
+		cgv::utils::progression prog;
+		if (show_progress) prog.init("extraction", resz, 10);
+
+		slice_info<T> slice_info_1(resx, resy), slice_info_2(resx, resy);
+		slice_info<T> *slice_info_ptrs[2] = { &slice_info_1, &slice_info_2 };
+		std::vector<active_block_mask::span_type> spans;
+		unsigned int nr_vertices[3] = { 0, 0, 0 };
+		for (k = 0, p(2) = box.get_min_pnt()(2); k < resz; ++k, p(2) += d(2)) {
+			slice_info<T> *info_ptr = slice_info_ptrs[k & 1];
+			int n = (int)base_type::get_nr_vertices();
+			// skip slices that are not incident to active cells
+			if (mask.is_layer_range_active(int(k) - 1, int(k))) {
+				info_ptr->init();
+				// evaluate the grid points of active cells and construct vertices on slice internal edges
+				for (j = 0; j < resy; ++j) {
+					p(1) = ys[j];
+					mask.compute_point_spans(j, int(k) - 1, int(k), spans);
+					for (const auto& s : spans) {
+						for (i = s.first; i < unsigned(s.second); ++i) {
+							p(0) = xs[i];
+							T v = eval(i, j, k, p);
+							info_ptr->set_value(i, j, v, iso_value);
+							if (valid(v)) {
+								if (i > 0 && mask.is_edge_active(i - 1, j, k, 0) && info_ptr->flag(i - 1, j) != info_ptr->flag(i, j) && valid(info_ptr->value(i - 1, j)))
+									construct_vertex(info_ptr, i - 1, j, 0, info_ptr, i, j);
+								if (j > 0 && mask.is_edge_active(i, j - 1, k, 1) && info_ptr->flag(i, j - 1) != info_ptr->flag(i, j) && valid(info_ptr->value(i, j - 1)))
+									construct_vertex(info_ptr, i, j - 1, 1, info_ptr, i, j);
+							}
+						}
+					}
+				}
+				if (k != 0 && mask.is_layer_range_active(int(k) - 1, int(k) - 1)) {
+					slice_info<T> *prev_info_ptr = slice_info_ptrs[1 - (k & 1)];
+					// construct vertices on edges between previous and new slice
+					for (j = 0; j < resy; ++j) {
+						p(1) = ys[j];
+						mask.compute_point_spans(j, int(k) - 1, int(k) - 1, spans);
+						for (const auto& s : spans) {
+							for (i = s.first; i < unsigned(s.second); ++i) {
+								p(0) = xs[i];
+								if (mask.is_edge_active(i, j, k - 1, 2) && prev_info_ptr->flag(i, j) != info_ptr->flag(i, j) && valid(prev_info_ptr->value(i, j)) && valid(info_ptr->value(i, j)))
+									construct_vertex(prev_info_ptr, i, j, 2, info_ptr, i, j);
+							}
+						}
+					}
+					// construct triangles of active cells
+					for (j = 0; j < resy - 1; ++j) {
+						mask.compute_cell_spans(j, k - 1, spans);
+						for (const auto& s : spans) {
+							for (i = s.first; i < unsigned(s.second); ++i) {
+								int idx = prev_info_ptr->get_bit_code(i, j) +
+									16 * info_ptr->get_bit_code(i, j);
+								if (idx == 0 || idx == 255)
+									continue;
+								int vis[12] = {
+									prev_info_ptr->index(i, j, 0),
+									prev_info_ptr->index(i + 1, j, 1),
+									prev_info_ptr->index(i, j + 1, 0),
+									prev_info_ptr->index(i, j, 1),
+									info_ptr->index(i, j, 0),
+									info_ptr->index(i + 1, j, 1),
+									info_ptr->index(i, j + 1, 0),
+									info_ptr->index(i, j, 1),
+									prev_info_ptr->index(i, j, 2),
+									prev_info_ptr->index(i + 1, j, 2),
+									prev_info_ptr->index(i, j + 1, 2),
+									prev_info_ptr->index(i + 1, j + 1, 2)
+								};
+								int nt = get_nr_cube_triangles(idx);
+								for (int t = 0; t < nt; ++t) {
+									int vi, vj, vk;
+									put_cube_triangle(idx, t, vi, vj, vk);
+									vi = vis[vi];
+									vj = vis[vj];
+									vk = vis[vk];
+									if (vi == -1 || vj == -1 || vk == -1)
+										continue;
+									if ((vi != vj) && (vi != vk) && (vj != vk))
+										base_type::new_triangle(vk, vj, vi);
+								}
+							}
+						}
+					}
+				}
+			}
+			if (show_progress)
+				prog.step();
+			n = (int)base_type::get_nr_vertices() - n;
+			nr_vertices[k % 3] = n;
+			n = nr_vertices[(k + 2) % 3];
+			if (n > 0)
+				base_type::drop_vertices(n);
+		}
+	}
 };
 
 template <typename T>
@@ -271,6 +651,7 @@ public:
 	T operator () (unsigned i, unsigned j, unsigned k, const pnt_type& p) const {
 		return func.evaluate(p.to_vec());
 	}
+	/// extract iso surface, in case of more than one thread the evaluation of func needs to be thread safe
 	void extract(const T& _iso_value,
 		const axis_aligned_box<X, 3>& box,
 		unsigned int resx, unsigned int resy, unsigned int resz,
@@ -279,6 +660,15 @@ public:
 		always_valid<T> valid;
 		this->extract_impl(_iso_value, box, resx, resy, resz, *this, valid, show_progress);
 	}
+	/// extract iso surface at the resolution of the block grid and only evaluate func in blocks that can intersect the iso surface
+	void extract(const T& _iso_value,
+		const axis_aligned_box<X, 3>& box,
+		const cgv::media::volume::min_max_block_grid& blocks,
+		bool show_progress = false)
+	{
+		always_valid<T> valid;
+		this->extract_sparse_impl(_iso_value, box, blocks, *this, valid, show_progress);
+	}
 };
 
 		}
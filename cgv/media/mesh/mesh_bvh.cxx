@@ -0,0 +1,298 @@
+#include "mesh_bvh.h"
+#include <cgv/utils/parallel_for.h>
+#include <algorithm>
+#include <cmath>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+namespace {
+	/// return squared distance of p to box
+	template <typename T>
+	inline T sqr_box_distance(const cgv::math::fvec<T, 3>& p, const cgv::math::fvec<T, 3>& min_pnt, const cgv::math::fvec<T, 3>& max_pnt)
+	{
+		T d2 = 0;
+		for (unsigned i = 0; i < 3; ++i) {
+			T d = std::max(std::max(min_pnt[i] - p[i], p[i] - max_pnt[i]), T(0));
+			d2 += d*d;
+		}
+		return d2;
+	}
+	/// compute point on triangle abc closest to p following Ericson, Real-Time Collision Detection
+	template <typename T>
+	cgv::math::fvec<T, 3> closest_point_on_triangle(const cgv::math::fvec<T, 3>& p, const cgv::math::fvec<T, 3>& a, const cgv::math::fvec<T, 3>& b, const cgv::math::fvec<T, 3>& c)
+	{
+		cgv::math::fvec<T, 3> ab = b - a, ac = c - a, ap = p - a;
+		T d1 = dot(ab, ap), d2 = dot(ac, ap);
+		if (d1 <= 0 && d2 <= 0)
+			return a;
+		cgv::math::fvec<T, 3> bp = p - b;
+		T d3 = dot(ab, bp), d4 = dot(ac, bp);
+		if (d3 >= 0 && d4 <= d3)
+			return b;
+		T vc = d1*d4 - d3*d2;
+		if (vc <= 0 && d1 >= 0 && d3 <= 0)
+			return a + (d1 / (d1 - d3))*ab;
+		cgv::math::fvec<T, 3> cp = p - c;
+		T d5 = dot(ab, cp), d6 = dot(ac, cp);
+		if (d6 >= 0 && d5 <= d6)
+			return c;
+		T vb = d5*d2 - d1*d6;
+		if (vb <= 0 && d2 >= 0 && d6 <= 0)
+			return a + (d2 / (d2 - d6))*ac;
+		T va = d3*d6 - d5*d4;
+		if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+			return b + ((d4 - d3) / ((d4 - d3) + (d5 - d6)))*(c - b);
+		T denom = 1 / (va + vb + vc);
+		return a + (vb*denom)*ab + (vc*denom)*ac;
+	}
+}
+
+template <typename T>
+void mesh_bvh<T>::compute_triangle_boxes(std::vector<vec3>& box_min, std::vector<vec3>& box_max) const
+{
+	size_t n = triangle_faces.size();
+	box_min.resize(n);
+	box_max.resize(n);
+	cgv::utils::for_each_chunk(n, this->get_nr_chunks(n), [&](unsigned, size_t begin, size_t end) {
+		for (size_t ti = begin; ti < end; ++ti) {
+			const vec3& p0 = positions[triangles[3 * ti]], &p1 = positions[triangles[3 * ti + 1]], &p2 = positions[triangles[3 * ti + 2]];
+			for (unsigned i = 0; i < 3; ++i) {
+				box_min[ti][i] = std::min(std::min(p0[i], p1[i]), p2[i]);
+				box_max[ti][i] = std::max(std::max(p0[i], p1[i]), p2[i]);
+			}
+		}
+	});
+}
+
+template <typename T>
+bool mesh_bvh<T>::build(const mesh_type& mesh)
+{
+	this->clear();
+	positions = mesh.get_positions();
+	triangles.clear();
+	triangle_faces.clear();
+	triangle_corners.clear();
+	for (idx_type fi = 0; fi < mesh.get_nr_faces(); ++fi) {
+		idx_type c0 = mesh.begin_corner(fi), ce = mesh.end_corner(fi);
+		for (idx_type ci = c0 + 1; ci + 1 < ce; ++ci) {
+			triangles.push_back(mesh.c2p(c0));
+			triangles.push_back(mesh.c2p(ci));
+			triangles.push_back(mesh.c2p(ci + 1));
+			triangle_faces.push_back(fi);
+			triangle_corners.push_back(ci);
+		}
+	}
+	if (triangle_faces.empty())
+		return false;
+	std::vector<vec3> box_min, box_max;
+	compute_triangle_boxes(box_min, box_max);
+	this->build_nodes(box_min, box_max);
+	// reorder triangles into leaf order
+	std::vector<idx_type> sorted_triangles(triangles.size()), sorted_faces(triangle_faces.size()), sorted_corners(triangle_corners.size());
+	for (size_t i = 0; i < triangle_faces.size(); ++i) {
+		uint32_t ti = this->primitive_indices[i];
+		for (unsigned j = 0; j < 3; ++j)
+			sorted_triangles[3 * i + j] = triangles[3 * ti + j];
+		sorted_faces[i] = triangle_faces[ti];
+		sorted_corners[i] = triangle_corners[ti];
+	}
+	triangles.swap(sorted_triangles);
+	triangle_faces.swap(sorted_faces);
+	triangle_corners.swap(sorted_corners);
+	return true;
+}
+
+template <typename T>
+void mesh_bvh<T>::refit(const std::vector<vec3>& _positions)
+{
+	positions = _positions;
+	std::vector<vec3> box_min, box_max;
+	compute_triangle_boxes(box_min, box_max);
+	this->refit_nodes(box_min, box_max);
+}
+
+template <typename T>
+template <unsigned P>
+void mesh_bvh<T>::intersect_packet(const ray_type* rays, unsigned n, ray_hit* hits, T t_max) const
+{
+	const T inf = std::numeric_limits<T>::max();
+	// packet in structure of arrays layout, where unused rays have a negative maximum ray parameter
+	T o[3][P], d[3][P], id[3][P], t_hit[P], u_hit[P], v_hit[P];
+	uint32_t ti_hit[P];
+	for (unsigned k = 0; k < P; ++k) {
+		const ray_type& r = rays[std::min(k, n - 1)];
+		for (unsigned i = 0; i < 3; ++i) {
+			o[i][k] = r.origin[i];
+			d[i][k] = r.direction[i];
+			id[i][k] = d[i][k] != 0 ? 1 / d[i][k] : (std::signbit(d[i][k]) ? -inf : inf);
+		}
+		t_hit[k] = k < n ? t_max : T(-1);
+		ti_hit[k] = uint32_t(-1);
+		u_hit[k] = v_hit[k] = 0;
+	}
+	bool dir_negative[3] = { d[0][0] < 0, d[1][0] < 0, d[2][0] < 0 };
+	uint32_t stack[bvh<T>::max_stack_size];
+	unsigned top = 0;
+	stack[top++] = 0;
+	const node_type* nodes = &this->nodes.front();
+	while (top > 0) {
+		const node_type& node = nodes[stack[--top]];
+		// slab test of all rays against the node box
+		int any = 0;
+		for (unsigned k = 0; k < P; ++k) {
+			T t_near = 0, t_far = t_hit[k];
+			for (unsigned i = 0; i < 3; ++i) {
+				T t0 = (node.min_pnt[i] - o[i][k])*id[i][k];
+				T t1 = (node.max_pnt[i] - o[i][k])*id[i][k];
+				t_near = std::max(t_near, std::min(t0, t1));
+				t_far = std::min(t_far, std::max(t0, t1));
+			}
+			any |= int(t_near <= t_far);
+		}
+		if (!any)
+			continue;
+		if (!node.is_leaf()) {
+			// visit the child first that comes first along the direction of the first ray
+			uint32_t first = dir_negative[node.axis] ? node.offset + 1 : node.offset;
+			stack[top++] = 2 * node.offset + 1 - first;
+			stack[top++] = first;
+			continue;
+		}
+		for (uint32_t ti = node.offset; ti < node.offset + node.count; ++ti) {
+			const vec3& p0 = positions[triangles[3 * ti]];
+			vec3 e1 = positions[triangles[3 * ti + 1]] - p0, e2 = positions[triangles[3 * ti + 2]] - p0;
+			// Moeller-Trumbore test of all rays against the triangle
+			for (unsigned k = 0; k < P; ++k) {
+				T px = d[1][k] * e2[2] - d[2][k] * e2[1];
+				T py = d[2][k] * e2[0] - d[0][k] * e2[2];
+				T pz = d[0][k] * e2[1] - d[1][k] * e2[0];
+				T det = e1[0] * px + e1[1] * py + e1[2] * pz;
+				T inv_det = det != 0 ? 1 / det : T(0);
+				T sx = o[0][k] - p0[0], sy = o[1][k] - p0[1], sz = o[2][k] - p0[2];
+				T u = (sx*px + sy*py + sz*pz)*inv_det;
+				T qx = sy*e1[2] - sz*e1[1];
+				T qy = sz*e1[0] - sx*e1[2];
+				T qz = sx*e1[1] - sy*e1[0];
+				T v = (d[0][k] * qx + d[1][k] * qy + d[2][k] * qz)*inv_det;
+				T t = (e2[0] * qx + e2[1] * qy + e2[2] * qz)*inv_det;
+				bool hit = det != 0 && u >= 0 && v >= 0 && u + v <= 1 && t >= 0 && t < t_hit[k];
+				t_hit[k] = hit ? t : t_hit[k];
+				u_hit[k] = hit ? u : u_hit[k];
+				v_hit[k] = hit ? v : v_hit[k];
+				ti_hit[k] = hit ? ti : ti_hit[k];
+			}
+		}
+	}
+	for (unsigned k = 0; k < n; ++k) {
+		ray_hit& h = hits[k];
+		if (ti_hit[k] == uint32_t(-1)) {
+			h.t = std::numeric_limits<T>::infinity();
+			h.u = h.v = 0;
+			h.face_index = h.corner_index = idx_type(-1);
+		}
+		else {
+			h.t = t_hit[k];
+			h.u = u_hit[k];
+			h.v = v_hit[k];
+			h.face_index = triangle_faces[ti_hit[k]];
+			h.corner_index = triangle_corners[ti_hit[k]];
+		}
+	}
+}
+
+template <typename T>
+bool mesh_bvh<T>::intersect(const ray_type& ray, ray_hit& hit, T t_max) const
+{
+	if (this->nodes.empty()) {
+		hit.t = std::numeric_limits<T>::infinity();
+		hit.face_index = hit.corner_index = idx_type(-1);
+		return false;
+	}
+	intersect_packet<1>(&ray, 1, &hit, t_max);
+	return hit.is_hit();
+}
+
+template <typename T>
+void mesh_bvh<T>::intersect(const std::vector<ray_type>& rays, std::vector<ray_hit>& hits, T t_max) const
+{
+	hits.resize(rays.size());
+	if (this->nodes.empty()) {
+		for (size_t i = 0; i < rays.size(); ++i)
+			intersect(rays[i], hits[i], t_max);
+		return;
+	}
+	size_t nr_packets = (rays.size() + packet_size - 1) / packet_size;
+	cgv::utils::for_each_chunk(nr_packets, this->get_nr_chunks(nr_packets, 64), [&](unsigned, size_t begin, size_t end) {
+		for (size_t pi = begin; pi < end; ++pi) {
+			size_t i = pi*packet_size;
+			intersect_packet<packet_size>(&rays[i], unsigned(std::min(size_t(packet_size), rays.size() - i)), &hits[i], t_max);
+		}
+	});
+}
+
+template <typename T>
+bool mesh_bvh<T>::find_closest_point(const vec3& p, closest_point_result& result, T max_distance) const
+{
+	result.sqr_distance = std::numeric_limits<T>::infinity();
+	result.face_index = idx_type(-1);
+	if (this->nodes.empty())
+		return false;
+	T best = max_distance < std::sqrt(std::numeric_limits<T>::max()) ? max_distance*max_distance : std::numeric_limits<T>::max();
+	uint32_t best_ti = uint32_t(-1);
+	uint32_t stack[bvh<T>::max_stack_size];
+	unsigned top = 0;
+	stack[top++] = 0;
+	const node_type* nodes = &this->nodes.front();
+	while (top > 0) {
+		const node_type& node = nodes[stack[--top]];
+		if (sqr_box_distance(p, node.min_pnt, node.max_pnt) > best)
+			continue;
+		if (node.is_leaf()) {
+			for (uint32_t ti = node.offset; ti < node.offset + node.count; ++ti) {
+				vec3 q = closest_point_on_triangle(p, positions[triangles[3 * ti]], positions[triangles[3 * ti + 1]], positions[triangles[3 * ti + 2]]);
+				T d2 = (q - p).sqr_length();
+				if (d2 <= best) {
+					best = d2;
+					best_ti = ti;
+					result.point = q;
+				}
+			}
+			continue;
+		}
+		// push far child first to visit near child first
+		T d0 = sqr_box_distance(p, nodes[node.offset].min_pnt, nodes[node.offset].max_pnt);
+		T d1 = sqr_box_distance(p, nodes[node.offset + 1].min_pnt, nodes[node.offset + 1].max_pnt);
+		if (d0 == d1) {
+			// if p is inside of both boxes, descend into the box with the closer center first
+			d0 = (nodes[node.offset].min_pnt + nodes[node.offset].max_pnt - T(2)*p).sqr_length();
+			d1 = (nodes[node.offset + 1].min_pnt + nodes[node.offset + 1].max_pnt - T(2)*p).sqr_length();
+		}
+		uint32_t near_ni = d0 <= d1 ? node.offset : node.offset + 1;
+		stack[top++] = 2 * node.offset + 1 - near_ni;
+		stack[top++] = near_ni;
+	}
+	if (best_ti == uint32_t(-1))
+		return false;
+	result.sqr_distance = best;
+	result.face_index = triangle_faces[best_ti];
+	return true;
+}
+
+template <typename T>
+void mesh_bvh<T>::find_closest_points(const std::vector<vec3>& query_points, std::vector<closest_point_result>& results, T max_distance) const
+{
+	results.resize(query_points.size());
+	cgv::utils::for_each_chunk(query_points.size(), this->get_nr_chunks(query_points.size(), 256), [&](unsigned, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			find_closest_point(query_points[i], results[i], max_distance);
+	});
+}
+
+template class mesh_bvh<float>;
+template class mesh_bvh<double>;
+
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "bvh.h"
+#include "simple_mesh.h"
+#include <cgv/math/ray.h>
+
+#include <cgv/media/lib_begin.h>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+/** bounding volume hierarchy over the triangles of a simple_mesh, where polygonal faces are split into triangle fans.
+    Ray queries are answered for single rays or for batches of rays, which are traversed in packets of packet_size
+	rays with the box and triangle tests written as loops over the packet, such that the compiler can vectorize them.
+	Closest point queries visit the nearer child first and prune subtrees by their box distance. Batched queries are
+	distributed over get_nr_threads() threads. After deformation of the mesh, refit() updates the boxes without
+	rebuilding the hierarchy. */
+template <typename T>
+class CGV_API mesh_bvh : public bvh<T>
+{
+public:
+	typedef typename bvh<T>::vec3 vec3;
+	typedef typename bvh<T>::node_type node_type;
+	typedef simple_mesh<T> mesh_type;
+	typedef simple_mesh_base::idx_type idx_type;
+	typedef cgv::math::ray<T, 3> ray_type;
+	/// number of rays traversed together in batched ray queries
+	static const unsigned packet_size = 8;
+	/// result of a ray query
+	struct ray_hit
+	{
+		/// ray parameter of the hit or infinity if no triangle is hit
+		T t;
+		/// barycentric coordinates of the hit with respect to the second and third triangle corner
+		T u, v;
+		/// index of the hit face or -1
+		idx_type face_index;
+		/// index of the first corner of the hit triangle in the face, such that the triangle has corners begin_corner, corner_index and corner_index+1
+		idx_type corner_index;
+		/// check whether a triangle was hit
+		bool is_hit() const { return face_index != idx_type(-1); }
+	};
+	/// result of a closest point query
+	struct closest_point_result
+	{
+		/// closest point on the mesh
+		vec3 point;
+		/// squared distance of the closest point or infinity if no point was found
+		T sqr_distance;
+		/// index of the face containing the closest point or -1
+		idx_type face_index;
+	};
+protected:
+	/// positions of the mesh
+	std::vector<vec3> positions;
+	/// per triangle in leaf order the position indices of its corners
+	std::vector<idx_type> triangles;
+	/// per triangle in leaf order its face index and the corner index of its second corner
+	std::vector<idx_type> triangle_faces, triangle_corners;
+	/// compute boxes of triangles in leaf order
+	void compute_triangle_boxes(std::vector<vec3>& box_min, std::vector<vec3>& box_max) const;
+	/// intersect n <= P rays traversing the hierarchy together
+	template <unsigned P>
+	void intersect_packet(const ray_type* rays, unsigned n, ray_hit* hits, T t_max) const;
+public:
+	/// build hierarchy over the triangles of mesh and return false if the mesh has no triangles
+	bool build(const mesh_type& mesh);
+	/// return number of triangles
+	size_t get_nr_triangles() const { return triangle_faces.size(); }
+	/// update positions from mesh with unchanged faces and refit the node boxes
+	void refit(const mesh_type& mesh) { refit(mesh.get_positions()); }
+	/// update positions and refit the node boxes
+	void refit(const std::vector<vec3>& _positions);
+	/// intersect ray with mesh and return whether a triangle is hit in the parameter range [0,t_max]
+	bool intersect(const ray_type& ray, ray_hit& hit, T t_max = std::numeric_limits<T>::max()) const;
+	/// intersect batch of rays in packets and in parallel
+	void intersect(const std::vector<ray_type>& rays, std::vector<ray_hit>& hits, T t_max = std::numeric_limits<T>::max()) const;
+	/// find point on mesh closest to p within max_distance and return whether such a point exists
+	bool find_closest_point(const vec3& p, closest_point_result& result, T max_distance = std::numeric_limits<T>::max()) const;
+	/// find closest points for a batch of query points in parallel
+	void find_closest_points(const std::vector<vec3>& query_points, std::vector<closest_point_result>& results, T max_distance = std::numeric_limits<T>::max()) const;
+};
+
+		}
+	}
+}
+
+#include <cgv/config/lib_end.h>
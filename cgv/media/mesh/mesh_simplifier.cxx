@@ -0,0 +1,751 @@
+#include "mesh_simplifier.h"
+#include "flat_index_map.h"
+#include <cgv/utils/parallel_for.h>
+#include <cgv/data/dynamic_priority_queue.h>
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <cmath>
+#include <iostream>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+namespace {
+	enum vertex_flag { VF_REMOVED = 1, VF_LOCKED = 2, VF_BOUNDARY = 4 };
+	/// maximum dimension of vertex vectors composed of position, normal, texture coordinate and rgba color
+	const unsigned max_dim = 12;
+	/// number of coefficients of a qem of dimension max_dim
+	const unsigned max_nr_coefficients = (max_dim + 1)*(max_dim + 2) / 2;
+	/// minimum cosine between triangle normals before and after a collapse
+	const double min_normal_cosine = 0.2;
+	/// fraction of the collapse candidates, sorted by cost, that is considered in one parallel round
+	const size_t round_candidate_fraction = 4;
+	const double infinite_cost = std::numeric_limits<double>::infinity();
+
+	/// minimum number of vertices or candidates per chunk processed by one thread
+	const size_t min_chunk_size = 1024;
+	/// evaluate qem given by packed coefficients in dimension d at x
+	double evaluate_quadric(const double* q, const double* x, unsigned d)
+	{
+		double e = q[0];
+		unsigned k = d + 1;
+		for (unsigned i = 0; i < d; ++i) {
+			e += 2 * q[i + 1] * x[i] + q[k++] * x[i] * x[i];
+			for (unsigned j = i + 1; j < d; ++j)
+				e += 2 * q[k++] * x[i] * x[j];
+		}
+		return e;
+	}
+	/** compute minimum of qem by solving A x = -b with an LDL^T factorization of the positive semi definite matrix
+	    part A and return false if A is close to singular */
+	bool minimize_quadric(const double* q, unsigned d, double* x)
+	{
+		double L[max_dim][max_dim], D[max_dim];
+		double max_diagonal = 0;
+		unsigned k = d + 1;
+		for (unsigned i = 0; i < d; ++i) {
+			for (unsigned j = i; j < d; ++j, ++k)
+				L[j][i] = q[k];
+			max_diagonal = std::max(max_diagonal, L[i][i]);
+		}
+		double epsilon = 1e-8*max_diagonal;
+		if (max_diagonal <= 0)
+			return false;
+		// lower triangle of L holds the matrix entries before factorization
+		for (unsigned j = 0; j < d; ++j) {
+			double dj = L[j][j];
+			for (unsigned m = 0; m < j; ++m)
+				dj -= L[j][m] * L[j][m] * D[m];
+			if (dj <= epsilon)
+				return false;
+			D[j] = dj;
+			for (unsigned i = j + 1; i < d; ++i) {
+				double lij = L[i][j];
+				for (unsigned m = 0; m < j; ++m)
+					lij -= L[i][m] * L[j][m] * D[m];
+				L[i][j] = lij / dj;
+			}
+		}
+		for (unsigned i = 0; i < d; ++i) {
+			double s = -q[i + 1];
+			for (unsigned m = 0; m < i; ++m)
+				s -= L[i][m] * x[m];
+			x[i] = s;
+		}
+		for (unsigned i = d; i > 0; ) {
+			--i;
+			double s = x[i] / D[i];
+			for (unsigned m = i + 1; m < d; ++m)
+				s -= L[m][i] * x[m];
+			x[i] = s;
+		}
+		return true;
+	}
+	/** add weighted quadric of squared distance to the plane of a triangle in dimension d to the packed coefficients q,
+	    where the plane is spanned by an orthonormal basis e1, e2 of the triangle edges */
+	void add_triangle_quadric(double* q, const double* p0, const double* p1, const double* p2, unsigned d, double w)
+	{
+		double e1[max_dim], e2[max_dim], l1 = 0, l2 = 0, t = 0;
+		for (unsigned i = 0; i < d; ++i) {
+			e1[i] = p1[i] - p0[i];
+			l1 += e1[i] * e1[i];
+		}
+		if (l1 == 0)
+			return;
+		l1 = 1 / std::sqrt(l1);
+		for (unsigned i = 0; i < d; ++i) {
+			e1[i] *= l1;
+			t += (p2[i] - p0[i])*e1[i];
+		}
+		for (unsigned i = 0; i < d; ++i) {
+			e2[i] = p2[i] - p0[i] - t*e1[i];
+			l2 += e2[i] * e2[i];
+		}
+		if (l2 == 0)
+			return;
+		l2 = 1 / std::sqrt(l2);
+		double a1 = 0, a2 = 0, pp = 0;
+		for (unsigned i = 0; i < d; ++i) {
+			e2[i] *= l2;
+			a1 += p0[i] * e1[i];
+			a2 += p0[i] * e2[i];
+			pp += p0[i] * p0[i];
+		}
+		q[0] += w*(pp - a1*a1 - a2*a2);
+		unsigned k = d + 1;
+		for (unsigned i = 0; i < d; ++i) {
+			q[i + 1] += w*(a1*e1[i] + a2*e2[i] - p0[i]);
+			for (unsigned j = i; j < d; ++j, ++k)
+				q[k] += w*((i == j ? 1 : 0) - e1[i] * e1[j] - e2[i] * e2[j]);
+		}
+	}
+	/// return cross product of the edges of the triangle given by the first three coordinates of the points
+	cgv::math::fvec<double, 3> triangle_normal(const double* p0, const double* p1, const double* p2)
+	{
+		cgv::math::fvec<double, 3> d1(p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]), d2(p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]);
+		return cross(d1, d2);
+	}
+	/// entry of the priority queue used for greedy simplification
+	struct collapse_entry
+	{
+		double cost;
+		bool operator < (const collapse_entry& e) const { return cost < e.cost; }
+	};
+}
+
+template <typename T>
+struct mesh_simplifier<T>::workspace
+{
+	std::vector<uint32_t> neighbors_u, neighbors_v, targets;
+	std::vector<std::pair<double, uint32_t> > costs;
+	std::vector<double> placements;
+	double q[max_nr_coefficients];
+	double x[max_dim];
+};
+
+template <typename T>
+mesh_simplifier<T>::mesh_simplifier() :
+	nr_threads(0), parallel_threshold(100000), normal_weight(T(0.25)), tex_coord_weight(T(1)), color_weight(T(0.25)), boundary_weight(T(10)),
+	max_error(-1), dim(3), normal_offset(-1), tex_coord_offset(-1), color_offset(-1), scale(1), origin(T(0)), nr_triangles(0), error(0),
+	nr_input_positions(0), color_type(CT_RGBA8)
+{
+}
+
+template <typename T>
+void mesh_simplifier<T>::build_refs()
+{
+	size_t nr_vertices = vertex_flags.size();
+	ref_count.assign(nr_vertices, 0);
+	ref_begin.resize(nr_vertices);
+	for (size_t t = 0; t < triangle_removed.size(); ++t)
+		if (!triangle_removed[t])
+			for (int c = 0; c < 3; ++c)
+				++ref_count[triangles[3 * t + c]];
+	uint32_t offset = 0;
+	for (size_t v = 0; v < nr_vertices; ++v) {
+		ref_begin[v] = offset;
+		offset += ref_count[v];
+		ref_count[v] = 0;
+	}
+	refs.resize(offset);
+	for (size_t t = 0; t < triangle_removed.size(); ++t)
+		if (!triangle_removed[t])
+			for (int c = 0; c < 3; ++c) {
+				uint32_t v = triangles[3 * t + c];
+				refs[ref_begin[v] + ref_count[v]++] = uint32_t(t);
+			}
+}
+
+template <typename T>
+void mesh_simplifier<T>::collect_neighbors(uint32_t u, std::vector<uint32_t>& neighbors) const
+{
+	neighbors.clear();
+	for (uint32_t ri = ref_begin[u]; ri < ref_begin[u] + ref_count[u]; ++ri) {
+		uint32_t t = refs[ri];
+		if (triangle_removed[t])
+			continue;
+		for (int c = 0; c < 3; ++c)
+			if (triangles[3 * t + c] != u)
+				neighbors.push_back(triangles[3 * t + c]);
+	}
+	std::sort(neighbors.begin(), neighbors.end());
+	neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+}
+
+template <typename T>
+double mesh_simplifier<T>::compute_placement(uint32_t u, uint32_t v, double* x, workspace& ws) const
+{
+	const double* qu = quadrics[u].begin(), *qv = quadrics[v].begin();
+	unsigned n = quadrics[u].size();
+	for (unsigned k = 0; k < n; ++k)
+		ws.q[k] = qu[k] + qv[k];
+	const double* xu = &vertex_data[dim*u], *xv = &vertex_data[dim*v];
+	if (vertex_flags[v] & VF_LOCKED)
+		std::copy(xv, xv + dim, x);
+	else {
+		bool solved = minimize_quadric(ws.q, dim, x);
+		if (solved) {
+			// reject ill conditioned solutions far away from the edge
+			double l2 = 0, m2 = 0;
+			for (int i = 0; i < 3; ++i) {
+				l2 += (xv[i] - xu[i])*(xv[i] - xu[i]);
+				double m = x[i] - 0.5*(xu[i] + xv[i]);
+				m2 += m*m;
+			}
+			solved = m2 <= 4 * l2;
+		}
+		if (!solved) {
+			// minimize the quadratic error along the edge from its values at both ends and the midpoint
+			for (unsigned i = 0; i < dim; ++i)
+				x[i] = 0.5*(xu[i] + xv[i]);
+			double f0 = evaluate_quadric(ws.q, xu, dim), fh = evaluate_quadric(ws.q, x, dim), f1 = evaluate_quadric(ws.q, xv, dim);
+			double a = 2 * (f0 - 2 * fh + f1), b = 4 * fh - 3 * f0 - f1;
+			double t = a > 0 ? std::min(1.0, std::max(0.0, -b / (2 * a))) : (f1 < f0 ? 1.0 : 0.0);
+			for (unsigned i = 0; i < dim; ++i)
+				x[i] = xu[i] + t*(xv[i] - xu[i]);
+		}
+	}
+	double e = std::max(0.0, evaluate_quadric(ws.q, x, dim));
+	return e / std::max(vertex_areas[u] + vertex_areas[v], 1e-20);
+}
+
+template <typename T>
+bool mesh_simplifier<T>::is_valid_collapse(uint32_t u, uint32_t v, const double* x, workspace& ws) const
+{
+	// link condition: common neighbors of u and v are exactly the opposite vertices of the triangles on edge uv
+	collect_neighbors(u, ws.neighbors_u);
+	collect_neighbors(v, ws.neighbors_v);
+	size_t nr_common = 0;
+	for (size_t i = 0, j = 0; i < ws.neighbors_u.size() && j < ws.neighbors_v.size(); ) {
+		if (ws.neighbors_u[i] < ws.neighbors_v[j])
+			++i;
+		else if (ws.neighbors_v[j] < ws.neighbors_u[i])
+			++j;
+		else {
+			++nr_common;
+			++i;
+			++j;
+		}
+	}
+	size_t nr_shared = 0;
+	for (uint32_t ri = ref_begin[u]; ri < ref_begin[u] + ref_count[u]; ++ri) {
+		const uint32_t* tri = &triangles[3 * refs[ri]];
+		if (!triangle_removed[refs[ri]] && (tri[0] == v || tri[1] == v || tri[2] == v))
+			++nr_shared;
+	}
+	if (nr_shared == 0 || nr_common != nr_shared)
+		return false;
+	// boundary vertices must stay on the boundary
+	if ((vertex_flags[u] & VF_BOUNDARY) && nr_shared != 1)
+		return false;
+	// triangles that remain must not flip or degenerate
+	for (uint32_t w : { u, v }) {
+		for (uint32_t ri = ref_begin[w]; ri < ref_begin[w] + ref_count[w]; ++ri) {
+			uint32_t t = refs[ri];
+			if (triangle_removed[t])
+				continue;
+			const uint32_t* tri = &triangles[3 * t];
+			if ((tri[0] == u || tri[1] == u || tri[2] == u) && (tri[0] == v || tri[1] == v || tri[2] == v))
+				continue;
+			const double* p[3], *q[3];
+			for (int c = 0; c < 3; ++c) {
+				p[c] = &vertex_data[dim*tri[c]];
+				q[c] = tri[c] == w ? x : p[c];
+			}
+			cgv::math::fvec<double, 3> n0 = triangle_normal(p[0], p[1], p[2]), n1 = triangle_normal(q[0], q[1], q[2]);
+			double l0 = n0.sqr_length(), l1 = n1.sqr_length();
+			if (l1 == 0 || dot(n0, n1) < min_normal_cosine*std::sqrt(l0*l1))
+				return false;
+		}
+	}
+	return true;
+}
+
+template <typename T>
+void mesh_simplifier<T>::evaluate_vertex(uint32_t u, workspace& ws)
+{
+	collapse_costs[u] = infinite_cost;
+	if (vertex_flags[u] & (VF_REMOVED | VF_LOCKED))
+		return;
+	collect_neighbors(u, ws.neighbors_u);
+	ws.targets.clear();
+	ws.costs.clear();
+	ws.placements.resize(dim*ws.neighbors_u.size());
+	for (uint32_t v : ws.neighbors_u) {
+		if ((vertex_flags[u] & VF_BOUNDARY) && !(vertex_flags[v] & VF_BOUNDARY))
+			continue;
+		uint32_t k = uint32_t(ws.targets.size());
+		ws.costs.push_back(std::make_pair(compute_placement(u, v, &ws.placements[dim*k], ws), k));
+		ws.targets.push_back(v);
+	}
+	std::sort(ws.costs.begin(), ws.costs.end());
+	for (const auto& c : ws.costs) {
+		uint32_t v = ws.targets[c.second];
+		if (is_valid_collapse(u, v, &ws.placements[dim*c.second], ws)) {
+			collapse_costs[u] = c.first;
+			collapse_targets[u] = v;
+			return;
+		}
+	}
+}
+
+template <typename T>
+size_t mesh_simplifier<T>::apply_collapse(uint32_t u, uint32_t v, workspace& ws)
+{
+	compute_placement(u, v, ws.x, ws);
+	std::copy(ws.x, ws.x + dim, &vertex_data[dim*v]);
+	quadrics[v] += quadrics[u];
+	vertex_areas[v] += vertex_areas[u];
+	vertex_flags[u] |= VF_REMOVED;
+	collapse_costs[u] = infinite_cost;
+	size_t nr_removed = 0;
+	for (uint32_t ri = ref_begin[u]; ri < ref_begin[u] + ref_count[u]; ++ri) {
+		uint32_t t = refs[ri];
+		if (triangle_removed[t])
+			continue;
+		uint32_t* tri = &triangles[3 * t];
+		if (tri[0] == v || tri[1] == v || tri[2] == v) {
+			triangle_removed[t] = 1;
+			++nr_removed;
+		}
+		else
+			for (int c = 0; c < 3; ++c)
+				if (tri[c] == u)
+					tri[c] = v;
+	}
+	return nr_removed;
+}
+
+template <typename T>
+bool mesh_simplifier<T>::init(const mesh_type& mesh)
+{
+	// unique combinations of position, normal and texture coordinate indices become vertices
+	bool nmls = normal_weight > 0 && mesh.has_normal_indices();
+	bool tcs = tex_coord_weight > 0 && mesh.has_tex_coord_indices();
+	bool clrs = color_weight > 0 && mesh.has_colors() && mesh.get_nr_colors() == mesh.get_nr_positions();
+	std::vector<idx_type> vertex_indices;
+	std::vector<typename mesh_type::vec4i> unique_tuples;
+	mesh.merge_indices(vertex_indices, unique_tuples, tcs ? &tcs : 0, nmls ? &nmls : 0);
+	dim = 3;
+	normal_offset = tex_coord_offset = color_offset = -1;
+	if (nmls) {
+		normal_offset = dim;
+		dim += 3;
+	}
+	if (tcs) {
+		tex_coord_offset = dim;
+		dim += 2;
+	}
+	if (clrs) {
+		color_offset = dim;
+		dim += 4;
+	}
+	// normalize positions to a bounding box with unit diagonal
+	typename mesh_type::box_type box = mesh.compute_box();
+	origin = box.get_min_pnt();
+	T diagonal = (box.get_max_pnt() - box.get_min_pnt()).length();
+	scale = diagonal > 0 ? T(1) / diagonal : T(1);
+	size_t nr_vertices = unique_tuples.size();
+	vertex_data.resize(dim*nr_vertices);
+	vertex_positions.resize(nr_vertices);
+	std::vector<idx_type> position_use_counts(mesh.get_nr_positions(), 0);
+	for (size_t vi = 0; vi < nr_vertices; ++vi) {
+		const auto& tuple = unique_tuples[vi];
+		double* x = &vertex_data[dim*vi];
+		vec3 p = (mesh.position(tuple[0]) - origin)*scale;
+		for (int i = 0; i < 3; ++i)
+			x[i] = p[i];
+		if (nmls) {
+			vec3 n = mesh.normal(tuple[2]);
+			T l = n.length();
+			for (int i = 0; i < 3; ++i)
+				x[normal_offset + i] = l > 0 ? normal_weight*n[i] / l : 0;
+		}
+		if (tcs)
+			for (int i = 0; i < 2; ++i)
+				x[tex_coord_offset + i] = tex_coord_weight*mesh.tex_coord(tuple[1])[i];
+		if (clrs) {
+			color_storage_types::rgba c;
+			mesh.put_color(tuple[0], c);
+			for (int i = 0; i < 4; ++i)
+				x[color_offset + i] = color_weight*c[i];
+		}
+		vertex_positions[vi] = tuple[0];
+		++position_use_counts[tuple[0]];
+	}
+	// triangulate faces as fans and drop triangles with repeated positions
+	bool grps = mesh.get_nr_groups() > 0, mtls = mesh.get_nr_materials() > 0;
+	triangles.clear();
+	triangle_groups.clear();
+	triangle_materials.clear();
+	for (idx_type fi = 0; fi < mesh.get_nr_faces(); ++fi) {
+		idx_type c0 = mesh.begin_corner(fi), ce = mesh.end_corner(fi);
+		for (idx_type ci = c0 + 1; ci + 1 < ce; ++ci) {
+			idx_type pi[3] = { mesh.c2p(c0), mesh.c2p(ci), mesh.c2p(ci + 1) };
+			if (pi[0] == pi[1] || pi[1] == pi[2] || pi[2] == pi[0])
+				continue;
+			triangles.push_back(vertex_indices[c0]);
+			triangles.push_back(vertex_indices[ci]);
+			triangles.push_back(vertex_indices[ci + 1]);
+			if (grps)
+				triangle_groups.push_back(mesh.group_index(fi));
+			if (mtls)
+				triangle_materials.push_back(mesh.material_index(fi));
+		}
+	}
+	nr_triangles = triangles.size() / 3;
+	triangle_removed.assign(nr_triangles, 0);
+	vertex_flags.assign(nr_vertices, 0);
+	if (nr_triangles == 0) {
+		std::cerr << "mesh_simplifier::init: mesh has no triangles" << std::endl;
+		return false;
+	}
+	build_refs();
+	// lock vertices on attribute seams and on borders between groups or materials
+	for (uint32_t v = 0; v < nr_vertices; ++v) {
+		if (position_use_counts[vertex_positions[v]] > 1)
+			vertex_flags[v] |= VF_LOCKED;
+		for (uint32_t ri = ref_begin[v] + 1; ri < ref_begin[v] + ref_count[v]; ++ri) {
+			uint32_t t0 = refs[ref_begin[v]], t = refs[ri];
+			if ((grps && triangle_groups[t] != triangle_groups[t0]) || (mtls && triangle_materials[t] != triangle_materials[t0]))
+				vertex_flags[v] |= VF_LOCKED;
+		}
+	}
+	// sum area weighted triangle quadrics per vertex in parallel
+	quadrics.assign(nr_vertices, cgv::math::qem<double>(int(dim)));
+	vertex_areas.assign(nr_vertices, 0.0);
+	unsigned nr_chunks = nr_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : nr_threads;
+	cgv::utils::for_each_chunk(nr_vertices, cgv::utils::get_nr_chunks(nr_vertices, min_chunk_size, nr_chunks), [this](unsigned, size_t begin, size_t end) {
+		for (size_t v = begin; v < end; ++v) {
+			double* q = quadrics[v].begin();
+			for (uint32_t ri = ref_begin[v]; ri < ref_begin[v] + ref_count[v]; ++ri) {
+				const uint32_t* tri = &triangles[3 * refs[ri]];
+				const double* p0 = &vertex_data[dim*tri[0]], *p1 = &vertex_data[dim*tri[1]], *p2 = &vertex_data[dim*tri[2]];
+				double area = 0.5*triangle_normal(p0, p1, p2).length();
+				add_triangle_quadric(q, p0, p1, p2, dim, area);
+				vertex_areas[v] += area;
+			}
+		}
+	});
+	// find boundary and non manifold edges
+	std::vector<uint32_t> edge_counts, edge_triangles;
+	flat_index_map<2> edge_map(uint32_t(nr_triangles * 3 / 2));
+	for (uint32_t t = 0; t < nr_triangles; ++t)
+		for (int c = 0; c < 3; ++c) {
+			uint32_t key[2] = { triangles[3 * t + c], triangles[3 * t + (c + 1) % 3] };
+			if (key[0] > key[1])
+				std::swap(key[0], key[1]);
+			uint32_t& ei = edge_map[key];
+			if (ei == uint32_t(-1)) {
+				ei = uint32_t(edge_counts.size());
+				edge_counts.push_back(0);
+				edge_triangles.push_back(3 * t + c);
+			}
+			++edge_counts[ei];
+		}
+	cgv::math::vec<double> plane_normal(dim);
+	plane_normal.zeros();
+	for (size_t ei = 0; ei < edge_counts.size(); ++ei) {
+		uint32_t ci = edge_triangles[ei], t = ci / 3;
+		uint32_t a = triangles[ci], b = triangles[3 * t + (ci + 1) % 3];
+		if (edge_counts[ei] > 2) {
+			vertex_flags[a] |= VF_LOCKED;
+			vertex_flags[b] |= VF_LOCKED;
+			continue;
+		}
+		if (edge_counts[ei] != 1)
+			continue;
+		// boundary constraint plane through the edge and orthogonal to its triangle
+		vertex_flags[a] |= VF_BOUNDARY;
+		vertex_flags[b] |= VF_BOUNDARY;
+		const double* pa = &vertex_data[dim*a], *pb = &vertex_data[dim*b];
+		cgv::math::fvec<double, 3> e(pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]);
+		cgv::math::fvec<double, 3> m = cross(e, triangle_normal(&vertex_data[dim*triangles[3 * t]],
+			&vertex_data[dim*triangles[3 * t + 1]], &vertex_data[dim*triangles[3 * t + 2]]));
+		double l = m.length();
+		if (l == 0)
+			continue;
+		m /= l;
+		for (int i = 0; i < 3; ++i)
+			plane_normal(i) = m[i];
+		cgv::math::qem<double> boundary_quadric(plane_normal, -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]));
+		boundary_quadric *= boundary_weight*e.sqr_length();
+		quadrics[a] += boundary_quadric;
+		quadrics[b] += boundary_quadric;
+	}
+	collapse_costs.assign(nr_vertices, infinite_cost);
+	collapse_targets.assign(nr_vertices, 0);
+	error = 0;
+	nr_input_positions = mesh.get_nr_positions();
+	color_type = mesh.get_color_storage_type();
+	group_names.clear();
+	for (size_t gi = 0; gi < mesh.get_nr_groups(); ++gi)
+		group_names.push_back(mesh.group_name(gi));
+	materials.clear();
+	for (size_t mi = 0; mi < mesh.get_nr_materials(); ++mi)
+		materials.push_back(mesh.get_material(mi));
+	return true;
+}
+
+template <typename T>
+void mesh_simplifier<T>::simplify_in_rounds(size_t target_nr_triangles)
+{
+	size_t nr_vertices = vertex_flags.size();
+	unsigned nr_chunks = nr_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : nr_threads;
+	double max_cost = max_error < 0 ? infinite_cost : max_error*max_error;
+	std::vector<std::pair<double, uint32_t> > candidates;
+	std::vector<std::pair<uint32_t, uint32_t> > selected;
+	std::vector<uint8_t> marks, dirty(nr_vertices, 1);
+	while (nr_triangles > target_nr_triangles && nr_triangles >= parallel_threshold) {
+		build_refs();
+		// collapses of the previous round change the candidates of the vertices in their one rings and their neighbors
+		if (!marks.empty()) {
+			for (uint32_t w = 0; w < nr_vertices; ++w) {
+				if (!marks[w] || (vertex_flags[w] & VF_REMOVED))
+					continue;
+				dirty[w] = 1;
+				for (uint32_t ri = ref_begin[w]; ri < ref_begin[w] + ref_count[w]; ++ri) {
+					const uint32_t* tri = &triangles[3 * refs[ri]];
+					dirty[tri[0]] = dirty[tri[1]] = dirty[tri[2]] = 1;
+				}
+			}
+		}
+		cgv::utils::for_each_chunk(nr_vertices, cgv::utils::get_nr_chunks(nr_vertices, min_chunk_size, nr_chunks), [this, &dirty](unsigned, size_t begin, size_t end) {
+			workspace ws;
+			for (size_t u = begin; u < end; ++u)
+				if (dirty[u]) {
+					evaluate_vertex(uint32_t(u), ws);
+					dirty[u] = 0;
+				}
+		});
+		candidates.clear();
+		for (uint32_t u = 0; u < nr_vertices; ++u)
+			if (collapse_costs[u] < infinite_cost && collapse_costs[u] <= max_cost)
+				candidates.push_back(std::make_pair(collapse_costs[u], u));
+		if (candidates.empty())
+			break;
+		// only the cheapest candidates are considered to approximate the greedy order
+		size_t nr_considered = std::max(size_t(1), candidates.size() / round_candidate_fraction);
+		std::nth_element(candidates.begin(), candidates.begin() + (nr_considered - 1), candidates.end());
+		std::sort(candidates.begin(), candidates.begin() + nr_considered);
+		// select collapses with disjoint one ring neighborhoods, such that they can be applied in parallel
+		marks.assign(nr_vertices, 0);
+		selected.clear();
+		size_t nr_removed = 0;
+		for (size_t i = 0; i < nr_considered && nr_triangles - nr_removed > target_nr_triangles; ++i) {
+			uint32_t u = candidates[i].second, v = collapse_targets[u];
+			bool independent = true;
+			size_t nr_shared = 0;
+			for (uint32_t w : { u, v })
+				for (uint32_t ri = ref_begin[w]; independent && ri < ref_begin[w] + ref_count[w]; ++ri) {
+					const uint32_t* tri = &triangles[3 * refs[ri]];
+					if (marks[tri[0]] || marks[tri[1]] || marks[tri[2]])
+						independent = false;
+					else if (w == u && (tri[0] == v || tri[1] == v || tri[2] == v))
+						++nr_shared;
+				}
+			if (!independent)
+				continue;
+			for (uint32_t w : { u, v })
+				for (uint32_t ri = ref_begin[w]; ri < ref_begin[w] + ref_count[w]; ++ri) {
+					const uint32_t* tri = &triangles[3 * refs[ri]];
+					marks[tri[0]] = marks[tri[1]] = marks[tri[2]] = 1;
+				}
+			selected.push_back(std::make_pair(u, v));
+			nr_removed += nr_shared;
+			error = std::max(error, std::sqrt(candidates[i].first));
+		}
+		if (selected.empty())
+			break;
+		std::vector<size_t> removed_per_chunk(nr_chunks, 0);
+		cgv::utils::for_each_chunk(selected.size(), cgv::utils::get_nr_chunks(selected.size(), min_chunk_size, nr_chunks), [this, &selected, &removed_per_chunk](unsigned c, size_t begin, size_t end) {
+			workspace ws;
+			size_t nr_removed = 0;
+			for (size_t i = begin; i < end; ++i)
+				nr_removed += apply_collapse(selected[i].first, selected[i].second, ws);
+			removed_per_chunk[c] = nr_removed;
+		});
+		for (size_t n : removed_per_chunk)
+			nr_triangles -= n;
+	}
+}
+
+template <typename T>
+void mesh_simplifier<T>::simplify_greedily(size_t target_nr_triangles)
+{
+	size_t nr_vertices = vertex_flags.size();
+	unsigned nr_chunks = nr_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : nr_threads;
+	double max_cost = max_error < 0 ? infinite_cost : max_error*max_error;
+	build_refs();
+	cgv::utils::for_each_chunk(nr_vertices, cgv::utils::get_nr_chunks(nr_vertices, min_chunk_size, nr_chunks), [this](unsigned, size_t begin, size_t end) {
+		workspace ws;
+		for (size_t u = begin; u < end; ++u)
+			evaluate_vertex(uint32_t(u), ws);
+	});
+	// vertices are inserted in order such that the element index of a vertex in the queue is its vertex index
+	cgv::data::dynamic_priority_queue<collapse_entry> queue;
+	for (uint32_t u = 0; u < nr_vertices; ++u) {
+		collapse_entry e = { collapse_costs[u] };
+		queue.insert(e);
+	}
+	workspace ws;
+	std::vector<uint32_t> neighbors;
+	while (nr_triangles > target_nr_triangles && !queue.empty()) {
+		uint32_t u = queue.top();
+		double cost = collapse_costs[u];
+		if (cost == infinite_cost || cost > max_cost)
+			break;
+		// the collapse can be outdated by changes in the two ring neighborhood of u
+		evaluate_vertex(u, ws);
+		if (collapse_costs[u] != cost) {
+			queue[u].cost = collapse_costs[u];
+			queue.update(u);
+			continue;
+		}
+		uint32_t v = collapse_targets[u];
+		nr_triangles -= apply_collapse(u, v, ws);
+		error = std::max(error, std::sqrt(cost));
+		queue.remove(u);
+		// append the incident triangles of u to the list of v, where shared triangles have been removed
+		if (refs.size() + ref_count[u] + ref_count[v] > 8 * nr_triangles + 1024)
+			build_refs();
+		else {
+			uint32_t begin = uint32_t(refs.size());
+			for (uint32_t w : { v, u })
+				for (uint32_t ri = ref_begin[w]; ri < ref_begin[w] + ref_count[w]; ++ri)
+					if (!triangle_removed[refs[ri]])
+						refs.push_back(refs[ri]);
+			ref_begin[v] = begin;
+			ref_count[v] = uint32_t(refs.size()) - begin;
+		}
+		collect_neighbors(v, neighbors);
+		neighbors.push_back(v);
+		for (uint32_t w : neighbors) {
+			evaluate_vertex(w, ws);
+			queue[w].cost = collapse_costs[w];
+			queue.update(w);
+		}
+	}
+}
+
+template <typename T>
+size_t mesh_simplifier<T>::simplify(size_t target_nr_triangles)
+{
+	if (nr_triangles <= target_nr_triangles)
+		return nr_triangles;
+	unsigned nr_chunks = nr_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : nr_threads;
+	if (nr_chunks > 1)
+		simplify_in_rounds(target_nr_triangles);
+	if (nr_triangles > target_nr_triangles)
+		simplify_greedily(target_nr_triangles);
+	return nr_triangles;
+}
+
+template <typename T>
+void mesh_simplifier<T>::extract(mesh_type& mesh) const
+{
+	mesh.clear();
+	for (const auto& name : group_names)
+		mesh.new_group(name);
+	for (const auto& mtl : materials)
+		mesh.ref_material(mesh.new_material()) = mtl;
+	// create output vertices and positions, where locked vertices that shared a position still share it
+	std::vector<uint32_t> vertex_map(vertex_flags.size(), uint32_t(-1)), position_map(nr_input_positions, uint32_t(-1));
+	std::vector<uint32_t> vertex_output_positions;
+	std::vector<uint32_t> output_vertices;
+	for (size_t t = 0; t < triangle_removed.size(); ++t) {
+		if (triangle_removed[t])
+			continue;
+		for (int c = 0; c < 3; ++c) {
+			uint32_t v = triangles[3 * t + c];
+			if (vertex_map[v] != uint32_t(-1))
+				continue;
+			vertex_map[v] = uint32_t(output_vertices.size());
+			output_vertices.push_back(v);
+			uint32_t* pi = (vertex_flags[v] & VF_LOCKED) ? &position_map[vertex_positions[v]] : 0;
+			if (pi && *pi != uint32_t(-1)) {
+				vertex_output_positions.push_back(*pi);
+				continue;
+			}
+			const double* x = &vertex_data[dim*v];
+			uint32_t new_pi = mesh.new_position(vec3(T(x[0]), T(x[1]), T(x[2])) / scale + origin);
+			if (pi)
+				*pi = new_pi;
+			vertex_output_positions.push_back(new_pi);
+		}
+	}
+	if (color_offset != -1)
+		mesh.ensure_colors(color_type, mesh.get_nr_positions());
+	for (size_t i = 0; i < output_vertices.size(); ++i) {
+		const double* x = &vertex_data[dim*output_vertices[i]];
+		if (normal_offset != -1) {
+			vec3 n(T(x[normal_offset]), T(x[normal_offset + 1]), T(x[normal_offset + 2]));
+			T l = n.length();
+			mesh.new_normal(l > 0 ? n / l : n);
+		}
+		if (tex_coord_offset != -1)
+			mesh.new_tex_coord(vec2(T(x[tex_coord_offset]), T(x[tex_coord_offset + 1])) / tex_coord_weight);
+		if (color_offset != -1) {
+			color_storage_types::rgba c;
+			for (int j = 0; j < 4; ++j)
+				c[j] = std::min(1.0f, std::max(0.0f, float(x[color_offset + j] / color_weight)));
+			mesh.set_color(vertex_output_positions[i], c);
+		}
+	}
+	for (size_t t = 0; t < triangle_removed.size(); ++t) {
+		if (triangle_removed[t])
+			continue;
+		idx_type fi = mesh.start_face();
+		for (int c = 0; c < 3; ++c) {
+			uint32_t vi = vertex_map[triangles[3 * t + c]];
+			mesh.new_corner(vertex_output_positions[vi], normal_offset != -1 ? vi : idx_type(-1), tex_coord_offset != -1 ? vi : idx_type(-1));
+		}
+		if (!triangle_groups.empty())
+			mesh.group_index(fi) = triangle_groups[t];
+		if (!triangle_materials.empty())
+			mesh.material_index(fi) = triangle_materials[t];
+	}
+}
+
+template <typename T>
+bool mesh_simplifier<T>::generate_lods(const mesh_type& mesh, const std::vector<size_t>& triangle_counts, std::vector<mesh_type>& lods)
+{
+	lods.clear();
+	if (!init(mesh))
+		return false;
+	for (size_t count : triangle_counts) {
+		simplify(count);
+		lods.push_back(mesh_type());
+		extract(lods.back());
+	}
+	return true;
+}
+
+template class mesh_simplifier<float>;
+template class mesh_simplifier<double>;
+
+		}
+	}
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "simple_mesh.h"
+#include <cgv/math/qem.h>
+#include <cstdint>
+
+#include <cgv/media/lib_begin.h>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+/** edge collapse simplification of a simple_mesh with quadric error metrics. Faces are triangulated and each unique
+    combination of position, normal and texture coordinate index becomes a vertex of the working mesh, whose quadric
+	is a cgv::math::qem over the position extended by the weighted attributes (normals, texture coordinates and per
+	position colors), such that attributes are optimized together with the positions. Vertices on attribute seams, on
+	borders between materials or groups and at non manifold edges are locked, vertices at open boundaries get
+	additional boundary constraint quadrics. Collapses that violate the link condition or flip faces are rejected.
+
+	Small meshes are simplified greedily with a cgv::data::dynamic_priority_queue. Meshes with at least
+	get_parallel_threshold() triangles are simplified in rounds, where per vertex collapse candidates are evaluated in
+	parallel, an independent set of cheap collapses with disjoint one ring neighborhoods is selected and applied in
+	parallel, until the mesh has become small enough for greedy simplification.
+
+	Errors are given as square root of the area weighted mean squared quadric error relative to the bounding box
+	diagonal of the input mesh. */
+template <typename T>
+class CGV_API mesh_simplifier
+{
+public:
+	typedef simple_mesh<T> mesh_type;
+	typedef typename mesh_type::vec3 vec3;
+	typedef typename mesh_type::vec2 vec2;
+	typedef simple_mesh_base::idx_type idx_type;
+	/// per thread buffers used while evaluating collapses
+	struct workspace;
+protected:
+	/// number of threads, 0 for one per hardware thread
+	unsigned nr_threads;
+	/// minimum number of triangles for parallel simplification
+	size_t parallel_threshold;
+	/// weights of the attributes relative to the normalized positions
+	T normal_weight, tex_coord_weight, color_weight, boundary_weight;
+	/// maximum allowed collapse error, negative for unlimited
+	double max_error;
+
+	/**@name working mesh*/
+	//@{
+	/// dimension of vertex vectors and offsets of attributes, where -1 means that an attribute is not used
+	unsigned dim;
+	int normal_offset, tex_coord_offset, color_offset;
+	/// scale and translation from input positions to the normalized working space
+	T scale;
+	vec3 origin;
+	/// vertex vectors with dim entries per vertex
+	std::vector<double> vertex_data;
+	/// per vertex quadrics over the vertex vectors
+	std::vector<cgv::math::qem<double> > quadrics;
+	/// per vertex sum of triangle areas that contributed to the quadric
+	std::vector<double> vertex_areas;
+	/// per vertex flags combined from vertex_flag
+	std::vector<uint8_t> vertex_flags;
+	/// per vertex index of position in input mesh
+	std::vector<idx_type> vertex_positions;
+	/// three vertex indices per triangle
+	std::vector<uint32_t> triangles;
+	/// per triangle whether it has been removed
+	std::vector<uint8_t> triangle_removed;
+	/// per triangle group and material index, empty if input has no groups or materials
+	std::vector<idx_type> triangle_groups, triangle_materials;
+	/// number of triangles that have not been removed
+	size_t nr_triangles;
+	/// per vertex range in refs with indices of incident triangles
+	std::vector<uint32_t> ref_begin, ref_count;
+	/// incident triangles of all vertices
+	std::vector<uint32_t> refs;
+	/// per vertex cost and target vertex of best collapse
+	std::vector<double> collapse_costs;
+	std::vector<uint32_t> collapse_targets;
+	/// maximum error of all performed collapses
+	double error;
+	/// number of positions and color storage type of input mesh
+	idx_type nr_input_positions;
+	ColorType color_type;
+	/// groups and materials copied from input mesh
+	std::vector<std::string> group_names;
+	std::vector<typename mesh_type::mat_type> materials;
+	//@}
+
+	/// rebuild incident triangle lists of all vertices
+	void build_refs();
+	/// collect the neighbors of vertex u from its triangles into a sorted vector
+	void collect_neighbors(uint32_t u, std::vector<uint32_t>& neighbors) const;
+	/// compute best collapse of vertex u into one of its neighbors
+	void evaluate_vertex(uint32_t u, workspace& ws);
+	/// compute vertex vector after collapse of u into v and return error
+	double compute_placement(uint32_t u, uint32_t v, double* x, workspace& ws) const;
+	/// check topology and face orientation of collapse of u into v with given vertex vector
+	bool is_valid_collapse(uint32_t u, uint32_t v, const double* x, workspace& ws) const;
+	/// apply collapse of u into v without updating refs and return the number of removed triangles
+	size_t apply_collapse(uint32_t u, uint32_t v, workspace& ws);
+	/// simplify in parallel rounds until target is reached, the mesh is small or no more collapses are possible
+	void simplify_in_rounds(size_t target_nr_triangles);
+	/// simplify greedily until target is reached or no more collapses are possible
+	void simplify_greedily(size_t target_nr_triangles);
+public:
+	/// construct with default parameters
+	mesh_simplifier();
+	/// set number of threads used for parallel simplification, 0 for one per hardware thread
+	void set_nr_threads(unsigned _nr_threads) { nr_threads = _nr_threads; }
+	/// return number of threads
+	unsigned get_nr_threads() const { return nr_threads; }
+	/// set minimum number of triangles for parallel simplification, which defaults to 100000
+	void set_parallel_threshold(size_t _parallel_threshold) { parallel_threshold = _parallel_threshold; }
+	/// return minimum number of triangles for parallel simplification
+	size_t get_parallel_threshold() const { return parallel_threshold; }
+	/// set weights of normals, texture coordinates and colors, where zero weight drops the attribute; must be called before init
+	void set_attribute_weights(T _normal_weight, T _tex_coord_weight, T _color_weight) { normal_weight = _normal_weight; tex_coord_weight = _tex_coord_weight; color_weight = _color_weight; }
+	/// set weight of boundary constraint quadrics, must be called before init
+	void set_boundary_weight(T _boundary_weight) { boundary_weight = _boundary_weight; }
+	/// set maximum collapse error relative to the bounding box diagonal, negative for unlimited
+	void set_max_error(double _max_error) { max_error = _max_error; }
+	/// return maximum collapse error
+	double get_max_error() const { return max_error; }
+	/// build working mesh from a mesh with at least one face and return false if mesh has no triangles
+	bool init(const mesh_type& mesh);
+	/// return current number of triangles
+	size_t get_nr_triangles() const { return nr_triangles; }
+	/// return maximum error of the performed collapses relative to the bounding box diagonal
+	double get_error() const { return error; }
+	/// collapse edges until the given number of triangles or the maximum error is reached and return the number of triangles
+	size_t simplify(size_t target_nr_triangles);
+	/// extract the current state of the working mesh
+	void extract(mesh_type& mesh) const;
+	/** simplify mesh successively to the given decreasing triangle counts and extract one level of detail per count.
+	    Return false if the mesh has no triangles. */
+	bool generate_lods(const mesh_type& mesh, const std::vector<size_t>& triangle_counts, std::vector<mesh_type>& lods);
+};
+
+		}
+	}
+}
+
+#include <cgv/config/lib_end.h>
@@ -0,0 +1,633 @@
+#include "obj_parallel_reader.h"
+#include <cgv/utils/file.h>
+#include <cgv/utils/dir.h>
+#include <cgv/utils/mapped_file.h>
+#include <cgv/utils/parallel_for.h>
+#include <cgv/utils/scan.h>
+#include <cgv/base/import.h>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+using namespace cgv::utils;
+
+#ifdef WIN32
+#pragma warning(disable:4996)
+#endif
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+namespace {
+	/// index stored for a corner without normal or texture coordinate
+	const int32_t missing_index = INT32_MIN;
+	/// identification of cache files
+	const char cache_magic[8] = { 'C', 'G', 'V', 'O', 'B', 'J', 'C', 0 };
+	/// increment whenever the layout of the cache file changes
+	const uint32_t cache_version = 1;
+
+	/// header of cache files
+	struct cache_header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t coordinate_size;
+		uint64_t file_size;
+		int64_t last_write_time;
+		uint64_t content_hash;
+		/// number of positions, normals, tex_coords, colors, faces, corners, normal indices, tex_coord indices, group names and material events
+		uint64_t counts[10];
+	};
+
+	inline const char* parse_number(const char* begin, const char* end, float& value) { return parse_float(begin, end, value); }
+	inline const char* parse_number(const char* begin, const char* end, double& value) { return parse_double(begin, end, value); }
+	/// parse up to n numbers starting at p, advance p behind the last parsed number and return the number of parsed numbers
+	template <typename T>
+	unsigned parse_numbers(const char*& p, const char* end, T* values, unsigned n)
+	{
+		for (unsigned i = 0; i < n; ++i) {
+			const char* q = parse_number(p, end, values[i]);
+			if (!q)
+				return i;
+			p = q;
+		}
+		return n;
+	}
+	inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+	inline const char* skip_spaces(const char* p, const char* end) { while (p < end && is_space(*p)) ++p; return p; }
+	inline const char* find_space(const char* p, const char* end) { while (p < end && !is_space(*p)) ++p; return p; }
+	/// parse an index that starts at p without skipping white spaces
+	inline const char* parse_index(const char* p, const char* end, int& value)
+	{
+		if (p == end || !(*p == '-' || *p == '+' || (*p >= '0' && *p <= '9')))
+			return 0;
+		return parse_int(p, end, value);
+	}
+	/// check whether keyword [begin,end) equals the zero terminated string s
+	inline bool is_keyword(const char* begin, const char* end, const char* s)
+	{
+		size_t n = std::strlen(s);
+		return size_t(end - begin) == n && std::equal(begin, end, s);
+	}
+	/// 64 bit hash of a memory block in FNV-1a style over 8 byte words
+	uint64_t compute_hash(const char* data, size_t size)
+	{
+		uint64_t h = 0xcbf29ce484222325ull ^ size;
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t w;
+			std::memcpy(&w, data + i, 8);
+			h = (h ^ w) * 0x100000001b3ull;
+		}
+		for (; i < size; ++i)
+			h = (h ^ uint8_t(data[i])) * 0x100000001b3ull;
+		return h ^ (h >> 29);
+	}
+	template <typename X>
+	bool write_vector(FILE* fp, const std::vector<X>& v)
+	{
+		return v.empty() || fwrite(&v[0], sizeof(X), v.size(), fp) == v.size();
+	}
+	template <typename X>
+	bool read_vector(FILE* fp, std::vector<X>& v, uint64_t n)
+	{
+		v.resize(size_t(n));
+		return v.empty() || fread(&v[0], sizeof(X), v.size(), fp) == v.size();
+	}
+}
+
+template <typename T>
+void obj_geometry<T>::clear()
+{
+	positions.clear();
+	normals.clear();
+	tex_coords.clear();
+	colors.clear();
+	faces.clear();
+	position_indices.clear();
+	normal_indices.clear();
+	tex_coord_indices.clear();
+	group_indices.clear();
+	material_indices.clear();
+	group_names.clear();
+	materials.clear();
+}
+
+template <typename T>
+struct obj_parallel_reader<T>::range_data
+{
+	/// state change of the reader
+	struct event
+	{
+		enum event_type { GROUP, MATERIAL, MTLLIB, LINE } type;
+		/// number of faces of the range before the event
+		uint32_t face_index;
+		std::string name;
+		std::string parameters;
+	};
+	std::vector<v3d_type> positions;
+	std::vector<v3d_type> normals;
+	std::vector<v2d_type> tex_coords;
+	std::vector<color_type> colors;
+	/// first corner of each face
+	std::vector<uint32_t> faces;
+	/// per corner indices that are absolute or, if listed in the relative corner vectors, relative to the range begin
+	std::vector<int32_t> position_indices, normal_indices, tex_coord_indices;
+	std::vector<uint32_t> relative_position_corners, relative_normal_corners, relative_tex_coord_corners;
+	std::vector<event> events;
+	bool has_line;
+
+	range_data() : has_line(false) {}
+	void add_event(typename event::event_type type, const char* begin, const char* end, const std::string& parameters = "")
+	{
+		event e;
+		e.type = type;
+		e.face_index = uint32_t(faces.size());
+		e.name.assign(begin, end);
+		e.parameters = parameters;
+		events.push_back(e);
+	}
+	/// convert one based or negative relative obj index to zero based index and record corner if relative
+	static int32_t convert_index(int idx, size_t count, std::vector<uint32_t>& relative_corners, size_t ci)
+	{
+		if (idx > 0)
+			return idx - 1;
+		if (idx < 0) {
+			relative_corners.push_back(uint32_t(ci));
+			return int32_t(count) + idx;
+		}
+		return 0;
+	}
+	void parse_face(const char* p, const char* end)
+	{
+		uint32_t first_corner = uint32_t(position_indices.size());
+		for (p = skip_spaces(p, end); p < end; p = skip_spaces(p, end)) {
+			int vi, ti, ni;
+			const char* q = parse_index(p, end, vi);
+			if (!q) {
+				p = find_space(p, end);
+				continue;
+			}
+			size_t ci = position_indices.size();
+			position_indices.push_back(convert_index(vi, positions.size(), relative_position_corners, ci));
+			int32_t tex_coord_index = missing_index, normal_index = missing_index;
+			if (q < end && *q == '/') {
+				++q;
+				if (q < end && *q != '/') {
+					const char* r = parse_index(q, end, ti);
+					if (r) {
+						tex_coord_index = convert_index(ti, tex_coords.size(), relative_tex_coord_corners, ci);
+						q = r;
+					}
+				}
+				if (q < end && *q == '/') {
+					const char* r = parse_index(q + 1, end, ni);
+					if (r) {
+						normal_index = convert_index(ni, normals.size(), relative_normal_corners, ci);
+						q = r;
+					}
+				}
+			}
+			else {
+				// like obj_reader_base, a single vertex index also addresses normal and texture coordinate
+				tex_coord_index = convert_index(vi, tex_coords.size(), relative_tex_coord_corners, ci);
+				normal_index = convert_index(vi, normals.size(), relative_normal_corners, ci);
+			}
+			tex_coord_indices.push_back(tex_coord_index);
+			normal_indices.push_back(normal_index);
+			p = find_space(q, end);
+		}
+		if (position_indices.size() > first_corner)
+			faces.push_back(first_corner);
+	}
+	void parse_line(const char* p, const char* end)
+	{
+		p = skip_spaces(p, end);
+		if (p == end || *p == '#')
+			return;
+		const char* kw_end = find_space(p, end);
+		const char* q = kw_end;
+		switch (*p) {
+		case 'v':
+			if (kw_end - p == 1) {
+				T v[3] = { 0, 0, 0 };
+				parse_numbers(q, end, v, 3);
+				positions.push_back(v3d_type(v[0], v[1], v[2]));
+				float c[4] = { 0, 0, 0, 1 };
+				if (parse_numbers(q, end, c, 3) == 3) {
+					parse_numbers(q, end, c + 3, 1);
+					colors.push_back(color_type(c[0], c[1], c[2], c[3]));
+				}
+			}
+			else if (kw_end - p == 2) {
+				if (p[1] == 'n') {
+					T v[3] = { 0, 0, 0 };
+					parse_numbers(q, end, v, 3);
+					normals.push_back(v3d_type(v[0], v[1], v[2]));
+				}
+				else if (p[1] == 't') {
+					T v[2] = { 0, 0 };
+					parse_numbers(q, end, v, 2);
+					tex_coords.push_back(v2d_type(v[0], v[1]));
+				}
+				else if (p[1] == 'c') {
+					float c[4] = { 0, 0, 0, 1 };
+					parse_numbers(q, end, c, 4);
+					colors.push_back(color_type(c[0], c[1], c[2], c[3]));
+				}
+			}
+			break;
+		case 'f':
+			if (kw_end - p == 1)
+				parse_face(kw_end, end);
+			break;
+		case 'l':
+			// lines are not stored but the first one selects the default group
+			if (kw_end - p == 1 && !has_line) {
+				add_event(event::LINE, p, p);
+				has_line = true;
+			}
+			break;
+		case 'g':
+			if (kw_end - p == 1) {
+				const char* name_begin = skip_spaces(kw_end, end);
+				const char* name_end = find_space(name_begin, end);
+				if (name_begin == name_end)
+					break;
+				const char* param_begin = skip_spaces(name_end, end);
+				const char* param_end = end;
+				while (param_end > param_begin && is_space(param_end[-1]))
+					--param_end;
+				add_event(event::GROUP, name_begin, name_end, std::string(param_begin, param_end));
+			}
+			break;
+		default:
+			if (is_keyword(p, kw_end, "usemtl") || is_keyword(p, kw_end, "mtllib")) {
+				const char* name_begin = skip_spaces(kw_end, end);
+				const char* name_end = find_space(name_begin, end);
+				if (name_begin < name_end)
+					add_event(*p == 'u' ? event::MATERIAL : event::MTLLIB, name_begin, name_end);
+			}
+		}
+	}
+	/// parse all lines in [begin,end)
+	void parse(const char* begin, const char* end)
+	{
+		while (begin < end) {
+			const char* line_end = std::find(begin, end, '\n');
+			parse_line(begin, line_end);
+			begin = line_end < end ? line_end + 1 : end;
+		}
+	}
+};
+
+/// return reference to the cache directory of newly constructed readers
+static std::string& ref_obj_cache_directory()
+{
+	static std::string cache_directory;
+	return cache_directory;
+}
+
+void set_obj_cache_directory(const std::string& cache_directory)
+{
+	ref_obj_cache_directory() = cache_directory;
+}
+
+const std::string& get_obj_cache_directory()
+{
+	return ref_obj_cache_directory();
+}
+
+template <typename T>
+obj_parallel_reader<T>::obj_parallel_reader(obj_geometry<T>& _geometry) : geometry(_geometry)
+{
+	nr_threads = 0;
+	cache_directory = get_obj_cache_directory();
+}
+
+template <typename T>
+void obj_parallel_reader<T>::process_group(const std::string& name, const std::string&)
+{
+	geometry.group_names.push_back(name);
+}
+
+template <typename T>
+void obj_parallel_reader<T>::process_material(const cgv::media::illum::obj_material& mtl, unsigned idx)
+{
+	if (idx >= geometry.materials.size())
+		geometry.materials.resize(idx + 1);
+	geometry.materials[idx] = mtl;
+}
+
+template <typename T>
+void obj_parallel_reader<T>::ensure_default_material()
+{
+	if (this->material_index != unsigned(-1))
+		return;
+	material_events.push_back(std::string());
+	this->ensure_material();
+}
+
+template <typename T>
+std::string obj_parallel_reader<T>::get_cache_file_name(const std::string& file_name) const
+{
+	// the hash of the file name distinguishes obj files of the same name in different directories
+	char hash[17];
+	snprintf(hash, 17, "%016llx", (unsigned long long)compute_hash(file_name.data(), file_name.size()));
+	return cache_directory + "/" + file::drop_extension(file::get_file_name(file_name)) + "_" + hash + (sizeof(T) == 4 ? ".obj_cachef" : ".obj_cached");
+}
+
+template <typename T>
+void obj_parallel_reader<T>::merge(std::vector<range_data>& ranges)
+{
+	size_t nr_ranges = ranges.size();
+	// compute per range offsets of positions, normals, tex_coords, colors, faces and corners
+	std::vector<size_t> offsets(6 * (nr_ranges + 1), 0);
+	for (size_t r = 0; r < nr_ranges; ++r) {
+		const range_data& rd = ranges[r];
+		const size_t counts[6] = { rd.positions.size(), rd.normals.size(), rd.tex_coords.size(), rd.colors.size(), rd.faces.size(), rd.position_indices.size() };
+		for (int i = 0; i < 6; ++i)
+			offsets[6 * (r + 1) + i] = offsets[6 * r + i] + counts[i];
+	}
+	const size_t* totals = &offsets[6 * nr_ranges];
+	// replay state changes in file order and assign group and material indices to runs of faces
+	struct face_run { uint32_t begin, end, group_index, material_index; };
+	std::vector<std::vector<face_run> > runs(nr_ranges);
+	for (size_t r = 0; r < nr_ranges; ++r) {
+		uint32_t begin = 0;
+		auto add_run = [&](uint32_t end) {
+			if (begin == end)
+				return;
+			this->ensure_group();
+			ensure_default_material();
+			face_run run = { begin, end, this->group_index, this->material_index };
+			runs[r].push_back(run);
+			begin = end;
+		};
+		for (const auto& e : ranges[r].events) {
+			add_run(e.face_index);
+			switch (e.type) {
+			case range_data::event::GROUP: this->select_group(e.name, e.parameters); break;
+			case range_data::event::MATERIAL: this->select_material(e.name); break;
+			case range_data::event::MTLLIB:
+				if (this->read_mtl(e.name))
+					material_events.push_back(e.name);
+				break;
+			case range_data::event::LINE: this->ensure_group(); break;
+			}
+		}
+		add_run(uint32_t(ranges[r].faces.size()));
+	}
+	// allocate geometry
+	geometry.positions.resize(totals[0]);
+	geometry.normals.resize(totals[1]);
+	geometry.tex_coords.resize(totals[2]);
+	geometry.colors.resize(totals[3]);
+	geometry.faces.resize(totals[4]);
+	geometry.group_indices.resize(totals[4]);
+	geometry.material_indices.resize(totals[4]);
+	geometry.position_indices.resize(totals[5]);
+	if (totals[1] > 0)
+		geometry.normal_indices.resize(totals[5]);
+	if (totals[2] > 0)
+		geometry.tex_coord_indices.resize(totals[5]);
+	// copy range data with index remapping in parallel
+	std::vector<char> has_normals(nr_ranges, 0), has_tex_coords(nr_ranges, 0);
+	parallel_for_tasks(unsigned(nr_ranges), [&](unsigned r) {
+		range_data& rd = ranges[r];
+		const size_t* o = &offsets[6 * r];
+		std::copy(rd.positions.begin(), rd.positions.end(), geometry.positions.begin() + o[0]);
+		std::copy(rd.normals.begin(), rd.normals.end(), geometry.normals.begin() + o[1]);
+		std::copy(rd.tex_coords.begin(), rd.tex_coords.end(), geometry.tex_coords.begin() + o[2]);
+		std::copy(rd.colors.begin(), rd.colors.end(), geometry.colors.begin() + o[3]);
+		for (uint32_t ci : rd.relative_position_corners)
+			rd.position_indices[ci] += int32_t(o[0]);
+		for (uint32_t ci : rd.relative_normal_corners)
+			rd.normal_indices[ci] += int32_t(o[1]);
+		for (uint32_t ci : rd.relative_tex_coord_corners)
+			rd.tex_coord_indices[ci] += int32_t(o[2]);
+		for (size_t ci = 0; ci < rd.position_indices.size(); ++ci)
+			geometry.position_indices[o[5] + ci] = uint32_t(rd.position_indices[ci]);
+		// per face attribute indices are only used if all corners reference a valid element
+		auto copy_attribute_indices = [&](const std::vector<int32_t>& indices, size_t count, std::vector<uint32_t>& target, char& any_valid) {
+			if (target.empty())
+				return;
+			for (size_t fi = 0; fi < rd.faces.size(); ++fi) {
+				size_t cb = rd.faces[fi], ce = fi + 1 < rd.faces.size() ? rd.faces[fi + 1] : indices.size();
+				bool valid = true;
+				for (size_t ci = cb; valid && ci < ce; ++ci)
+					valid = indices[ci] >= 0 && size_t(indices[ci]) < count;
+				for (size_t ci = cb; ci < ce; ++ci)
+					target[o[5] + ci] = valid ? uint32_t(indices[ci]) : 0;
+				if (valid)
+					any_valid = 1;
+			}
+		};
+		copy_attribute_indices(rd.normal_indices, totals[1], geometry.normal_indices, has_normals[r]);
+		copy_attribute_indices(rd.tex_coord_indices, totals[2], geometry.tex_coord_indices, has_tex_coords[r]);
+		for (size_t fi = 0; fi < rd.faces.size(); ++fi)
+			geometry.faces[o[4] + fi] = uint32_t(o[5]) + rd.faces[fi];
+		for (const auto& run : runs[r]) {
+			std::fill(geometry.group_indices.begin() + o[4] + run.begin, geometry.group_indices.begin() + o[4] + run.end, run.group_index);
+			std::fill(geometry.material_indices.begin() + o[4] + run.begin, geometry.material_indices.begin() + o[4] + run.end, run.material_index);
+		}
+		rd = range_data();
+	});
+	if (std::find(has_normals.begin(), has_normals.end(), 1) == has_normals.end())
+		geometry.normal_indices.clear();
+	if (std::find(has_tex_coords.begin(), has_tex_coords.end(), 1) == has_tex_coords.end())
+		geometry.tex_coord_indices.clear();
+	this->nr_normals = unsigned(totals[1]);
+	this->nr_texcoords = unsigned(totals[2]);
+}
+
+template <typename T>
+bool obj_parallel_reader<T>::parse_obj(const char* begin, const char* end, const std::string& path_name)
+{
+	this->clear();
+	this->group_index = -1;
+	this->path_name = path_name;
+	geometry.clear();
+	material_events.clear();
+	// use at most one thread per MB of text
+	const size_t min_range_size = 1 << 20;
+	size_t nr_ranges = nr_threads > 0 ? nr_threads : std::max(1u, std::thread::hardware_concurrency());
+	nr_ranges = std::max(size_t(1), std::min(nr_ranges, size_t(end - begin) / min_range_size));
+	std::vector<const char*> range_begin(nr_ranges + 1, end);
+	range_begin[0] = begin;
+	for (size_t r = 1; r < nr_ranges; ++r) {
+		const char* p = std::max(range_begin[r - 1], begin + r * size_t(end - begin) / nr_ranges);
+		p = std::find(p, end, '\n');
+		range_begin[r] = p < end ? p + 1 : end;
+	}
+	std::vector<range_data> ranges(nr_ranges);
+	parallel_for_tasks(unsigned(nr_ranges), [&](unsigned r) { ranges[r].parse(range_begin[r], range_begin[r + 1]); });
+	merge(ranges);
+	return true;
+}
+
+template <typename T>
+bool obj_parallel_reader<T>::read_obj(const std::string& file_name)
+{
+	std::string path_name = file::get_path(file_name);
+	if (!path_name.empty())
+		path_name += "/";
+	// files on disk are parsed directly from their mapping and resource files from a copy
+	mapped_file mapping;
+	std::string content;
+	const char* begin, * end;
+	if (file::exists(file_name) && mapping.open(file_name)) {
+		mapping.advise(mapped_file::AH_SEQUENTIAL);
+		begin = mapping.begin();
+		end = mapping.end();
+	}
+	else {
+		if (!cgv::base::read_data_file(file_name, content, false))
+			return false;
+		begin = content.data();
+		end = begin + content.size();
+	}
+	std::string cache_file_name;
+	if (!cache_directory.empty() && mapping.is_open()) {
+		if (!dir::exists(cache_directory))
+			dir::mkdir(cache_directory);
+		cache_file_name = get_cache_file_name(file_name);
+		if (file::exists(cache_file_name)) {
+			this->clear();
+			this->path_name = path_name;
+			geometry.clear();
+			material_events.clear();
+			if (read_cache(cache_file_name, file_name, begin, end))
+				return true;
+		}
+	}
+	if (!parse_obj(begin, end, path_name))
+		return false;
+	if (!cache_file_name.empty() && !write_cache(cache_file_name, file_name, begin, end))
+		file::remove(cache_file_name);
+	return true;
+}
+
+template <typename T>
+bool obj_parallel_reader<T>::read_cache(const std::string& cache_file_name, const std::string& file_name, const char* begin, const char* end)
+{
+	FILE* fp = fopen(cache_file_name.c_str(), "rb");
+	if (!fp)
+		return false;
+	cache_header h;
+	if (fread(&h, sizeof(cache_header), 1, fp) != 1 ||
+		std::memcmp(h.magic, cache_magic, 8) != 0 || h.version != cache_version || h.coordinate_size != sizeof(T) ||
+		h.file_size != uint64_t(end - begin)) {
+		fclose(fp);
+		return false;
+	}
+	// in case of a different write time, the cache is still valid if the content did not change
+	int64_t last_write_time = file::get_last_write_time(file_name);
+	bool update_write_time = false;
+	if (h.last_write_time != last_write_time) {
+		if (compute_hash(begin, end - begin) != h.content_hash) {
+			fclose(fp);
+			return false;
+		}
+		update_write_time = true;
+	}
+	if (!read_vector(fp, geometry.positions, h.counts[0]) ||
+		!read_vector(fp, geometry.normals, h.counts[1]) ||
+		!read_vector(fp, geometry.tex_coords, h.counts[2]) ||
+		!read_vector(fp, geometry.colors, h.counts[3]) ||
+		!read_vector(fp, geometry.faces, h.counts[4]) ||
+		!read_vector(fp, geometry.group_indices, h.counts[4]) ||
+		!read_vector(fp, geometry.material_indices, h.counts[4]) ||
+		!read_vector(fp, geometry.position_indices, h.counts[5]) ||
+		!read_vector(fp, geometry.normal_indices, h.counts[6]) ||
+		!read_vector(fp, geometry.tex_coord_indices, h.counts[7])) {
+		fclose(fp);
+		geometry.clear();
+		return false;
+	}
+	geometry.group_names.resize(size_t(h.counts[8]));
+	material_events.resize(size_t(h.counts[9]));
+	for (auto& name : geometry.group_names)
+		if (!file::read_string_bin(name, fp)) {
+			fclose(fp);
+			geometry.clear();
+			return false;
+		}
+	for (auto& name : material_events)
+		if (!file::read_string_bin(name, fp)) {
+			fclose(fp);
+			geometry.clear();
+			return false;
+		}
+	fclose(fp);
+	// replay material creation to read the material libraries
+	for (const auto& name : material_events) {
+		if (name.empty()) {
+			this->material_index = -1;
+			this->ensure_material();
+		}
+		else
+			this->read_mtl(name);
+	}
+	this->nr_groups = unsigned(geometry.group_names.size());
+	this->nr_normals = unsigned(geometry.normals.size());
+	this->nr_texcoords = unsigned(geometry.tex_coords.size());
+	if (update_write_time) {
+		h.last_write_time = last_write_time;
+		fp = fopen(cache_file_name.c_str(), "r+b");
+		if (fp) {
+			fwrite(&h, sizeof(cache_header), 1, fp);
+			fclose(fp);
+		}
+	}
+	return true;
+}
+
+template <typename T>
+bool obj_parallel_reader<T>::write_cache(const std::string& cache_file_name, const std::string& file_name, const char* begin, const char* end) const
+{
+	cache_header h;
+	std::memcpy(h.magic, cache_magic, 8);
+	h.version = cache_version;
+	h.coordinate_size = sizeof(T);
+	h.file_size = end - begin;
+	h.last_write_time = file::get_last_write_time(file_name);
+	h.content_hash = compute_hash(begin, end - begin);
+	const size_t counts[10] = {
+		geometry.positions.size(), geometry.normals.size(), geometry.tex_coords.size(), geometry.colors.size(),
+		geometry.faces.size(), geometry.position_indices.size(), geometry.normal_indices.size(),
+		geometry.tex_coord_indices.size(), geometry.group_names.size(), material_events.size()
+	};
+	std::copy(counts, counts + 10, h.counts);
+	FILE* fp = fopen(cache_file_name.c_str(), "wb");
+	if (!fp)
+		return false;
+	bool success = fwrite(&h, sizeof(cache_header), 1, fp) == 1 &&
+		write_vector(fp, geometry.positions) &&
+		write_vector(fp, geometry.normals) &&
+		write_vector(fp, geometry.tex_coords) &&
+		write_vector(fp, geometry.colors) &&
+		write_vector(fp, geometry.faces) &&
+		write_vector(fp, geometry.group_indices) &&
+		write_vector(fp, geometry.material_indices) &&
+		write_vector(fp, geometry.position_indices) &&
+		write_vector(fp, geometry.normal_indices) &&
+		write_vector(fp, geometry.tex_coord_indices);
+	for (const auto& name : geometry.group_names)
+		success = success && file::write_string_bin(name, fp);
+	for (const auto& name : material_events)
+		success = success && file::write_string_bin(name, fp);
+	return fclose(fp) == 0 && success;
+}
+
+template struct obj_geometry<float>;
+template struct obj_geometry<double>;
+template class obj_parallel_reader<float>;
+template class obj_parallel_reader<double>;
+
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "obj_reader.h"
+#include <cstdint>
+
+#include <cgv/media/lib_begin.h>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+/** geometry of an obj file stored in flat arrays as read by obj_parallel_reader. For each face the index of its first
+    corner is stored in faces and for each corner a position index. Normal and texture coordinate indices are either
+	empty or have one entry per corner, where corners of faces without normals or texture coordinates get index 0.
+	Each face has a group and a material index. */
+template <typename T>
+struct obj_geometry
+{
+	/// type used to store texture coordinates
+	typedef cgv::math::fvec<T, 2> v2d_type;
+	/// type used to store positions and normal vectors
+	typedef cgv::math::fvec<T, 3> v3d_type;
+	/// type used for rgba colors
+	typedef obj_reader_base::color_type color_type;
+
+	std::vector<v3d_type> positions;
+	std::vector<v3d_type> normals;
+	std::vector<v2d_type> tex_coords;
+	std::vector<color_type> colors;
+
+	std::vector<uint32_t> faces;
+	std::vector<uint32_t> position_indices;
+	std::vector<uint32_t> normal_indices;
+	std::vector<uint32_t> tex_coord_indices;
+	std::vector<uint32_t> group_indices;
+	std::vector<uint32_t> material_indices;
+
+	std::vector<std::string> group_names;
+	std::vector<cgv::media::illum::obj_material> materials;
+	/// remove all elements
+	void clear();
+};
+
+/// set the cache directory of obj_parallel_reader instances constructed afterwards, which is empty by default to disable caching
+extern CGV_API void set_obj_cache_directory(const std::string& cache_directory);
+/// return the cache directory of newly constructed obj_parallel_reader instances
+extern CGV_API const std::string& get_obj_cache_directory();
+
+/** obj reader that splits the file at line boundaries into one range per thread and parses the ranges in parallel into
+    per range arrays, which are then merged into an obj_geometry with remapping of relative indices. Statements that
+	change the reader state (g, usemtl, mtllib, first f or l) are recorded per range and replayed in file order during
+	merging, such that group and material indices agree with those of obj_reader_base. Numbers are parsed with
+	cgv::utils::parse_float and parse_double. In contrast to obj_reader_base, normal and texture coordinate indices are
+	validated against the number of normals and texture coordinates in the whole file.
+
+	If a cache directory is set, the result of reading a file is stored in a versioned binary cache file in this
+	directory, which stores size, last write time and a content hash of the obj file. The cache is used if size and last
+	write time match or, if only the write time changed, if the content hash matches. Material libraries are not cached
+	but read again. The cache stores an obj_geometry and is independent of the .bin_obj files of obj_loader, which store
+	the group parameters and face records of obj_loader. Caching is disabled by default and the cache directory of new
+	readers is set with set_obj_cache_directory(). */
+template <typename T>
+class CGV_API obj_parallel_reader : public obj_reader_generic<T>
+{
+public:
+	typedef typename obj_reader_generic<T>::v2d_type v2d_type;
+	typedef typename obj_reader_generic<T>::v3d_type v3d_type;
+	typedef obj_reader_base::color_type color_type;
+	/// per range parse result
+	struct range_data;
+protected:
+	/// geometry into which the file is read
+	obj_geometry<T>& geometry;
+	/// number of threads, 0 for one per hardware thread
+	unsigned nr_threads;
+	/// directory of the binary cache files, caching is disabled if empty
+	std::string cache_directory;
+	/// mtl library files in the order they have been read, where an empty string denotes creation of the default material
+	std::vector<std::string> material_events;
+	/// store group name
+	void process_group(const std::string& name, const std::string& parameters);
+	/// store material
+	void process_material(const cgv::media::illum::obj_material& mtl, unsigned idx);
+	/// create default material and record this for the cache
+	void ensure_default_material();
+	/// replay state changes of the ranges and merge the range data into the geometry
+	void merge(std::vector<range_data>& ranges);
+	/// try to read cache file of obj file with given content, whose hash is only computed if the write time differs
+	bool read_cache(const std::string& cache_file_name, const std::string& file_name, const char* begin, const char* end);
+	/// write cache for obj file with given content
+	bool write_cache(const std::string& cache_file_name, const std::string& file_name, const char* begin, const char* end) const;
+public:
+	/// construct reader that reads into the given geometry
+	obj_parallel_reader(obj_geometry<T>& _geometry);
+	/// set number of threads used for parsing, 0 for one per hardware thread
+	void set_nr_threads(unsigned _nr_threads) { nr_threads = _nr_threads; }
+	/// return number of threads used for parsing
+	unsigned get_nr_threads() const { return nr_threads; }
+	/// set directory of binary cache files, which is created if necessary, or disable caching with an empty directory
+	void set_cache_directory(const std::string& _cache_directory) { cache_directory = _cache_directory; }
+	/// return directory of binary cache files, which is empty if caching is disabled
+	const std::string& get_cache_directory() const { return cache_directory; }
+	/// return name of the cache file of an obj file in the cache directory, which also depends on the path of the obj file
+	std::string get_cache_file_name(const std::string& file_name) const;
+	/// read an obj file into the geometry, which is cleared before
+	bool read_obj(const std::string& file_name);
+	/// parse obj file content given as text range into the geometry, which is cleared before; mtl libraries are looked up relative to path_name
+	bool parse_obj(const char* begin, const char* end, const std::string& path_name = "");
+};
+
+		}
+	}
+}
+
+#include <cgv/config/lib_end.h>
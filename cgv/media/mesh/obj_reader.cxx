@@ -93,6 +93,7 @@ void obj_reader_base::clear()
 {
 	mtl_lib_files.clear();
 	material_index_lut.clear();
+	group_index_lut.clear();
 	nr_materials = 0;
 	nr_groups = 0;
 	minus = 1;
@@ -210,7 +211,7 @@ bool obj_reader_base::read_obj(const std::string& file_name)
 	group_index = -1;
 	nr_groups = 0;
 	nr_normals = nr_texcoords = 0;
-	std::map<std::string,unsigned> group_index_lut;
+	group_index_lut.clear();
 	std::vector<token> tokens;
 	for (unsigned li=0; li<lines.size(); ++li) {
 		if(li % 1000 == 0)
@@ -244,50 +245,20 @@ bool obj_reader_base::read_obj(const std::string& file_name)
 			}
 			break;
 		case 'f' :
-			if (group_index == -1) {
-				group_index = 0;
-				nr_groups = 1;
-				process_group("main","");
-				group_index_lut["main"] = group_index;
-			}
-			if (material_index == -1) {
-				obj_material m;
-				m.set_name("default");
-				material_index = 0;
-				nr_materials = 1;
-				process_material(m, 0);
-				material_index_lut[m.get_name()] = material_index;
-				have_default_material = true;
-			}
+			ensure_group();
+			ensure_material();
 			parse_face(tokens); 
 			break;
 		case 'l':
-			if (group_index == -1) {
-				group_index = 0;
-				nr_groups = 1;
-				process_group("main", "");
-				group_index_lut["main"] = group_index;
-			}
+			ensure_group();
 			parse_face(tokens, true);
 			break;
 		case 'g' :
 			if (tokens.size() > 1) {
-				std::string name = to_string(tokens[1]);
 				std::string parameters;
 				if (tokens.size() > 2)
 					parameters.assign(tokens[2].begin, tokens.back().end - tokens[2].begin);
-
-				std::map<std::string,unsigned>::iterator it = 
-					group_index_lut.find(name);
-
-				if (it != group_index_lut.end())
-					group_index = it->second;
-				else {
-					group_index = nr_groups;
-					++nr_groups;
-					process_group(name, parameters);
-					group_index_lut[name] = group_index;
-				}
+				select_group(to_string(tokens[1]), parameters);
 			}
 			break;
 		default:
@@ -404,14 +375,56 @@ void obj_reader_base::parse_material(const std::vector<token>& tokens)
 {
 	if (tokens.size() < 2)
 		return;
+	select_material(to_string(tokens[1]));
+}
 
+void obj_reader_base::select_material(const std::string& name)
+{
 	std::map<std::string,unsigned>::iterator it = 
-		material_index_lut.find(to_string(tokens[1]));
+		material_index_lut.find(name);
 	
 	if(it != material_index_lut.end())
 		material_index = it->second;
 }
 
+void obj_reader_base::select_group(const std::string& name, const std::string& parameters)
+{
+	std::map<std::string,unsigned>::iterator it = 
+		group_index_lut.find(name);
+
+	if (it != group_index_lut.end())
+		group_index = it->second;
+	else {
+		group_index = nr_groups;
+		++nr_groups;
+		process_group(name, parameters);
+		group_index_lut[name] = group_index;
+	}
+}
+
+void obj_reader_base::ensure_group()
+{
+	if (group_index != -1)
+		return;
+	group_index = 0;
+	nr_groups = 1;
+	process_group("main", "");
+	group_index_lut["main"] = group_index;
+}
+
+void obj_reader_base::ensure_material()
+{
+	if (material_index != -1)
+		return;
+	obj_material m;
+	m.set_name("default");
+	material_index = 0;
+	nr_materials = 1;
+	process_material(m, 0);
+	material_index_lut[m.get_name()] = material_index;
+	have_default_material = true;
+}
+
 void obj_reader_base::parse_face(const std::vector<token>& tokens, bool is_line)
 {
 	std::vector<int> vertex_indices;
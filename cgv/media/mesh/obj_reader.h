@@ -31,6 +31,8 @@ protected:
 	unsigned nr_materials;
 	/// mapping from material names to material indices
 	std::map<std::string, unsigned> material_index_lut;
+	/// mapping from group names to group indices
+	std::map<std::string, unsigned> group_index_lut;
 	/**@name helpers for reading*/
 	//@{
 	/// parse a color, if alpha not given it defaults to 1
@@ -41,6 +43,14 @@ protected:
 	std::set<std::string> mtl_lib_files;
 	void parse_face(const std::vector<cgv::utils::token>& tokens, bool is_line = false);
 	void parse_material(const std::vector<cgv::utils::token>& tokens);
+	/// select the group of the given name and create it if it does not exist yet
+	void select_group(const std::string& name, const std::string& parameters);
+	/// select the material of the given name if it has been defined
+	void select_material(const std::string& name);
+	/// create and select the group "main" if no group has been selected yet
+	void ensure_group();
+	/// create and select the default material if no material has been selected yet
+	void ensure_material();
 	virtual void parse_and_process_vertex(const std::vector<cgv::utils::token>& tokens) = 0;
 	virtual void parse_and_process_normal(const std::vector<cgv::utils::token>& tokens) = 0;
 	virtual void parse_and_process_texcoord(const std::vector<cgv::utils::token>& tokens) = 0;
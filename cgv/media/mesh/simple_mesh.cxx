@@ -1,16 +1,34 @@
 #include "simple_mesh.h"
-#include "stl_reader.h"
 #include "obj_loader.h"
 #include <cgv/math/inv.h>
 #include <cgv/utils/scan.h>
 #include <cgv/media/mesh/obj_reader.h>
+#include <cgv/media/mesh/obj_parallel_reader.h>
+#include <cgv/media/mesh/flat_index_map.h>
 #include <cgv/math/bucket_sort.h>
+#include <cgv/utils/parallel_for.h>
 #include <fstream>
+#include <algorithm>
+#include <atomic>
 
 namespace cgv {
 	namespace media {
 		namespace mesh {
 
+namespace {
+/// minimum number of elements per chunk processed by one thread
+const size_t min_chunk_size = 65536;
+/// increment counter and return previous value, where an atomic increment is only used if concurrent is true
+inline uint32_t fetch_increment(std::atomic<uint32_t>& counter, bool concurrent)
+{
+	if (concurrent)
+		return counter.fetch_add(1, std::memory_order_relaxed);
+	uint32_t value = counter.load(std::memory_order_relaxed);
+	counter.store(value + 1, std::memory_order_relaxed);
+	return value;
+}
+}
+
 /// default constructor
 simple_mesh_base::simple_mesh_base() 
 {
@@ -141,26 +159,20 @@ void simple_mesh_base::merge_indices(std::vector<idx_type>& indices, std::vector
 	if(include_tangents_ptr)
 		*include_tangents_ptr = include_tangents = (tangent_indices.size() > 0) && *include_tangents_ptr;
 
-	std::map<std::tuple<idx_type, idx_type, idx_type, idx_type>, idx_type> corner_to_index;
+	flat_index_map<4> corner_to_index(get_nr_positions());
+	indices.reserve(indices.size() + position_indices.size());
 	for (idx_type ci = 0; ci < position_indices.size(); ++ci) {
 		// construct corner
 		vec4i c(position_indices[ci], 
 			    (include_tex_coords && ci < tex_coord_indices.size()) ? tex_coord_indices[ci] : 0, 
 			    (include_normals && ci < normal_indices.size()) ? normal_indices[ci] : 0,
 			    (include_tangents && ci < tangent_indices.size()) ? tangent_indices[ci] : 0);
-		std::tuple<idx_type, idx_type, idx_type, idx_type> quadruple(c(0),c(1),c(2),c(3));
-		// look corner up in map
-		auto iter = corner_to_index.find(quadruple);
-		// determine vertex index
-		idx_type vi;
-		if (iter == corner_to_index.end()) {
+		// look corner up in hash map and determine vertex index
+		idx_type& vi = corner_to_index[&c[0]];
+		if (vi == idx_type(-1)) {
 			vi = idx_type(unique_quadruples.size());
-			corner_to_index[quadruple] = vi;
 			unique_quadruples.push_back(c);
 		}
-		else
-			vi = iter->second;
-
 		indices.push_back(vi);
 	}
 }
@@ -200,27 +212,21 @@ void simple_mesh_base::extract_triangle_element_buffer(
 void simple_mesh_base::extract_wireframe_element_buffer(const std::vector<idx_type>& vertex_indices, std::vector<idx_type>& edge_element_buffer) const
 {
 	// map stores for each halfedge the number of times it has been seen before
-	std::map<std::tuple<idx_type, idx_type>, idx_type> halfedge_to_count;
+	flat_index_map<2> halfedge_to_count(get_nr_corners() / 2);
 	for (idx_type fi = 0; fi < faces.size(); ++fi) {
 		idx_type last_vi = vertex_indices.at(end_corner(fi) - 1);
 		for (idx_type ci = begin_corner(fi); ci < end_corner(fi); ++ci) {
 			// construct halfedge with sorted vertex indices
 			idx_type vi = vertex_indices.at(ci);
-			std::tuple<idx_type, idx_type> halfedge(last_vi, vi);
-			if (vi < last_vi)
-				std::swap(std::get<0>(halfedge), std::get<1>(halfedge));
-
-			// lookup corner in map
-			auto iter = halfedge_to_count.find(halfedge);
-
-			// determine vertex index
-			if (iter == halfedge_to_count.end()) {
-				halfedge_to_count[halfedge] = 1;
+			idx_type halfedge[2] = { std::min(last_vi, vi), std::max(last_vi, vi) };
+			idx_type& count = halfedge_to_count[halfedge];
+			if (count == idx_type(-1)) {
+				count = 1;
 				edge_element_buffer.push_back(last_vi);
 				edge_element_buffer.push_back(vi);
 			}
 			else
-				++halfedge_to_count[halfedge];
+				++count;
 			last_vi = vi;
 		}
 	}
@@ -229,67 +235,126 @@ void simple_mesh_base::extract_wireframe_element_buffer(const std::vector<idx_ty
 /// compute a index vector storing the inv corners per corner and optionally index vectors with per position corner index, per corner next and or prev corner index (implementation assumes closed manifold connectivity)
 void simple_mesh_base::compute_inv(std::vector<uint32_t>& inv, std::vector<uint32_t>* p2c_ptr, std::vector<uint32_t>* next_ptr, std::vector<uint32_t>* prev_ptr) const
 {
-	uint32_t fi, e = 0;
+	uint32_t nr_corners = get_nr_corners(), nr_faces = get_nr_faces(), nr_positions = get_nr_positions();
 	if (p2c_ptr)
-		p2c_ptr->resize(get_nr_positions());
+		p2c_ptr->resize(nr_positions);
 	if (next_ptr)
-		next_ptr->resize(get_nr_corners());
+		next_ptr->resize(nr_corners);
 	if (prev_ptr)
-		prev_ptr->resize(get_nr_corners());
-	inv.resize(get_nr_corners(), uint32_t(-1));
-	std::map<std::pair<uint32_t, uint32_t>, uint32_t> pipj2ci;
-	for (fi = 0; fi < get_nr_faces(); ++fi) {
-		uint32_t prev_ci = end_corner(fi) - 1;
-		for (uint32_t ci = begin_corner(fi); ci < end_corner(fi); ++ci) {
-			uint32_t pi = c2p(ci);
-			if (p2c_ptr)
-				p2c_ptr->at(pi) = ci;
-			uint32_t next_ci = ci + 1 == end_corner(fi) ? begin_corner(fi) : ci + 1;
-			if (next_ptr)
-				next_ptr->at(ci) = next_ci;
-			if (prev_ptr)
-				prev_ptr->at(ci) = prev_ci;
-			prev_ci = ci;
-			uint32_t pj = c2p(next_ci);
-			std::pair<uint32_t, uint32_t> pipj(std::min(pi, pj), std::max(pi, pj));
-			if (pipj2ci.find(pipj) == pipj2ci.end())
-				pipj2ci[pipj] = ci;
-			else {
-				uint32_t inv_ci = pipj2ci[pipj];
-				inv[ci] = inv_ci;
-				inv[inv_ci] = ci;
-				pipj2ci.erase(pipj2ci.find(pipj));
+		prev_ptr->resize(nr_corners);
+	inv.assign(nr_corners, uint32_t(-1));
+	// per corner the position index at the end of its edge and the count of edges per smaller position index
+	std::vector<uint32_t> end_position(nr_corners);
+	std::vector<std::atomic<uint32_t> > bucket_fill(nr_positions + 1);
+	cgv::utils::parallel_for(nr_positions + 1, min_chunk_size, [&](size_t b, size_t e) {
+		for (size_t pi = b; pi < e; ++pi)
+			bucket_fill[pi].store(0, std::memory_order_relaxed);
+	});
+	bool concurrent = cgv::utils::get_nr_chunks(nr_faces, min_chunk_size) > 1;
+	cgv::utils::parallel_for(nr_faces, min_chunk_size, [&](size_t b, size_t e) {
+		for (uint32_t fi = uint32_t(b); fi < e; ++fi) {
+			uint32_t prev_ci = end_corner(fi) - 1;
+			for (uint32_t ci = begin_corner(fi); ci < end_corner(fi); ++ci) {
+				uint32_t next_ci = ci + 1 == end_corner(fi) ? begin_corner(fi) : ci + 1;
+				if (next_ptr)
+					(*next_ptr)[ci] = next_ci;
+				if (prev_ptr)
+					(*prev_ptr)[ci] = prev_ci;
+				prev_ci = ci;
+				uint32_t pi = c2p(ci), pj = c2p(next_ci);
+				end_position[ci] = pj;
+				fetch_increment(bucket_fill[std::min(pi, pj)], concurrent);
 			}
 		}
+	});
+	if (p2c_ptr) {
+		for (uint32_t ci = 0; ci < nr_corners; ++ci)
+			(*p2c_ptr)[c2p(ci)] = ci;
+	}
+	// counting sort of corners by smaller position index, where entries store larger position index and corner index
+	std::vector<uint32_t> bucket_begin(nr_positions + 1);
+	uint32_t sum = 0;
+	for (uint32_t pi = 0; pi <= nr_positions; ++pi) {
+		bucket_begin[pi] = sum;
+		sum += bucket_fill[pi].load(std::memory_order_relaxed);
+		bucket_fill[pi].store(bucket_begin[pi], std::memory_order_relaxed);
 	}
+	std::vector<uint64_t> entries(nr_corners);
+	concurrent = cgv::utils::get_nr_chunks(nr_corners, min_chunk_size) > 1;
+	cgv::utils::parallel_for(nr_corners, min_chunk_size, [&](size_t b, size_t e) {
+		for (uint32_t ci = uint32_t(b); ci < e; ++ci) {
+			uint32_t pi = c2p(ci), pj = end_position[ci];
+			entries[fetch_increment(bucket_fill[std::min(pi, pj)], concurrent)] = (uint64_t(std::max(pi, pj)) << 32) | ci;
+		}
+	});
+	// sort buckets by larger position index and corner index and pair subsequent corners of the same edge in corner order
+	cgv::utils::parallel_for(nr_positions, min_chunk_size, [&](size_t b, size_t e) {
+		for (size_t pi = b; pi < e; ++pi) {
+			uint64_t* first = &entries[0] + bucket_begin[pi], * last = &entries[0] + bucket_begin[pi + 1];
+			if (last - first < 16) {
+				for (uint64_t* i = first + 1; i < last; ++i)
+					for (uint64_t* j = i; j > first && *j < *(j - 1); --j)
+						std::swap(*j, *(j - 1));
+			}
+			else
+				std::sort(first, last);
+			for (uint64_t* i = first; i + 1 < last; ++i) {
+				if ((*i >> 32) == (*(i + 1) >> 32)) {
+					uint32_t ci = uint32_t(*i), cj = uint32_t(*(i + 1));
+					inv[ci] = cj;
+					inv[cj] = ci;
+					++i;
+				}
+			}
+		}
+	});
 }
 /// given the inv corners compute index vector per corner its edge index and optionally per edge its corner index (implementation assumes closed manifold connectivity)
 uint32_t simple_mesh_base::compute_c2e(const std::vector<uint32_t>& inv, std::vector<uint32_t>& c2e, std::vector<uint32_t>* e2c_ptr) const
 {
-	uint32_t e = 0;
-	c2e.resize(get_nr_corners(), -1);
+	uint32_t nr_corners = get_nr_corners();
+	c2e.resize(nr_corners);
+	// a corner starts a new edge if its inverse corner comes later, edges are enumerated in corner order with a prefix sum over chunks
+	unsigned nr_chunks = cgv::utils::get_nr_chunks(nr_corners, min_chunk_size);
+	std::vector<uint32_t> chunk_edge_begin(nr_chunks + 1, 0);
+	cgv::utils::for_each_chunk(nr_corners, nr_chunks, [&](unsigned c, size_t b, size_t e) {
+		uint32_t cnt = 0;
+		for (size_t ci = b; ci < e; ++ci)
+			if (inv[ci] > ci)
+				++cnt;
+		chunk_edge_begin[c + 1] = cnt;
+	});
+	for (unsigned c = 0; c < nr_chunks; ++c)
+		chunk_edge_begin[c + 1] += chunk_edge_begin[c];
+	uint32_t nr_edges = chunk_edge_begin[nr_chunks];
 	if (e2c_ptr)
-		e2c_ptr->resize(get_nr_corners() / 2);
-	for (uint32_t fi = 0; fi < get_nr_faces(); ++fi) {
-		for (uint32_t ci = begin_corner(fi); ci < end_corner(fi); ++ci) {
-			if (c2e[ci] == -1) {
-				c2e[ci] = c2e[inv[ci]] = e;
+		e2c_ptr->resize(nr_edges);
+	cgv::utils::for_each_chunk(nr_corners, nr_chunks, [&](unsigned c, size_t b, size_t e) {
+		uint32_t ei = chunk_edge_begin[c];
+		for (uint32_t ci = uint32_t(b); ci < e; ++ci)
+			if (inv[ci] > ci) {
+				c2e[ci] = ei;
 				if (e2c_ptr)
-					e2c_ptr->at(e) = ci;
-				++e;
+					(*e2c_ptr)[ei] = ci;
+				++ei;
 			}
-		}
-	}
-	return e;
+	});
+	cgv::utils::parallel_for(nr_corners, min_chunk_size, [&](size_t b, size_t e) {
+		for (size_t ci = b; ci < e; ++ci)
+			if (inv[ci] < ci)
+				c2e[ci] = c2e[inv[ci]];
+	});
+	return nr_edges;
 }
 /// compute index vector with per corner its face index
 void simple_mesh_base::compute_c2f(std::vector<uint32_t>& c2f) const
 {
-	c2f.resize(get_nr_corners(), -1);
-	for (uint32_t fi = 0; fi < get_nr_faces(); ++fi) {
-		for (uint32_t ci = begin_corner(fi); ci < end_corner(fi); ++ci)
-			c2f[ci] = fi;
-	}
+	c2f.resize(get_nr_corners());
+	cgv::utils::parallel_for(get_nr_faces(), min_chunk_size, [&](size_t b, size_t e) {
+		for (uint32_t fi = uint32_t(b); fi < e; ++fi)
+			for (uint32_t ci = begin_corner(fi); ci < end_corner(fi); ++ci)
+				c2f[ci] = fi;
+	});
 }
 
 /// construct from obj loader
@@ -325,72 +390,6 @@ void simple_mesh<T>::construct(const obj_loader_generic<T>& loader, bool copy_gr
 	}
 }
 
-template <typename T>
-class simple_mesh_obj_reader : public obj_reader_generic<T>
-{
-public:
-	/// type of coordinates
-	typedef T crd_type;
-	/// type used to store texture coordinates
-	typedef cgv::math::fvec<T,2> v2d_type;
-	/// type used to store positions and normal vectors
-	typedef cgv::math::fvec<T,3> v3d_type;
-	/// type used for rgba colors
-	typedef illum::obj_material::color_type color_type;
-
-	typedef typename simple_mesh<T>::idx_type idx_type;
-protected:
-	simple_mesh<T> &mesh;
-public:
-	simple_mesh_obj_reader(simple_mesh<T>& _mesh) : mesh(_mesh) {}
-	/// overide this function to process a vertex
-	void process_vertex(const v3d_type& p) { mesh.positions.push_back(p); }
-	/// overide this function to process a texcoord
-	void process_texcoord(const v2d_type& t) { mesh.tex_coords.push_back(v2d_type(t(0),t(1))); }
-	/// overide this function to process a color (this called for vc prefixes which is is not in the standard but for example used in pobj-files)
-	void process_color(const color_type& c) { mesh.resize_colors(mesh.get_nr_colors() + 1); mesh.set_color(mesh.get_nr_colors()-1, c); }
-	/// overide this function to process a normal
-	void process_normal(const v3d_type& n) { mesh.normals.push_back(n); }
-	/// overide this function to process a face, the indices start with 0
-	void process_face(unsigned vcount, int *vertices, int *texcoords, int *normals)
-	{
-		obj_reader_base::convert_to_positive(vcount, vertices, texcoords, normals, unsigned(mesh.positions.size()), unsigned(mesh.normals.size()), unsigned(mesh.tex_coords.size()));
-		mesh.faces.push_back(idx_type(mesh.position_indices.size()));
-		if (obj_reader_base::get_current_group() != -1)
-			mesh.group_indices.push_back(obj_reader_base::get_current_group());
-		if (obj_reader_base::get_current_material() != -1)
-			mesh.material_indices.push_back(obj_reader_base::get_current_material());
-		if (texcoords) {
-			if (mesh.tex_coord_indices.size() < mesh.position_indices.size())
-				mesh.tex_coord_indices.resize(mesh.position_indices.size(), 0);
-		}
-		if (normals) {
-			if (mesh.normal_indices.size() < mesh.position_indices.size())
-				mesh.normal_indices.resize(mesh.position_indices.size(), 0);
-		}
-		for (idx_type i = 0; i < vcount; ++i) {
-			mesh.position_indices.push_back(idx_type(vertices[i]));
-			if (texcoords)
-				mesh.tex_coord_indices.push_back(idx_type(texcoords[i]));
-			if (normals)
-				mesh.normal_indices.push_back(idx_type(normals[i]));
-		}
-	}
-	/// overide this function to process a group given by name and parameter string
-	void process_group(const std::string& name, const std::string& parameters)
-	{
-		mesh.group_names.push_back(name);
-	}
-	/// process a material definition. If a material with a certain name is overwritten, it will receive the same index
-	void process_material(const cgv::media::illum::obj_material& mtl, unsigned idx)
-	{
-		if (idx >= mesh.materials.size())
-			mesh.materials.resize(idx+1);
-		mesh.materials[idx] = mtl;
-	}
-};
-
-
 /// copy constructor
 template <typename T>
 simple_mesh<T>::simple_mesh(const simple_mesh<T>& sm)
@@ -455,41 +454,46 @@ bool simple_mesh<T>::read(const std::string& file_name)
 { 
 	std::string ext = cgv::utils::to_lower(cgv::utils::file::get_extension(file_name));
 	if (ext == "obj") {
-		simple_mesh_obj_reader<T> reader(*this);
-		return reader.read_obj(file_name);
-	}
-	if (ext == "stl") {
-		try {
-			stl_reader::StlMesh <T, unsigned> mesh(file_name);
-
-			// copy vertices
-			for (size_t vi = 0; vi < mesh.num_vrts(); ++vi)
-				new_position(cgv::math::fvec<T, 3>(3, mesh.vrt_coords(vi)));
-
-			// copy triangles and normals
-			bool has_normals = mesh.raw_normals();
-			for (size_t ti = 0; ti < mesh.num_tris(); ++ti) {
-				if (has_normals)
-					new_normal(cgv::math::fvec<T, 3>(3, mesh.tri_normal(ti)));
-				start_face();
-				for (size_t ci = 0; ci < 3; ++ci)
-					new_corner(mesh.tri_corner_ind(ti, ci), has_normals ? (unsigned)ti : -1);
-			}
-			return true;
-		}
-		catch (std::exception& e) {
-			std::cout << e.what() << std::endl;
+		obj_geometry<T> geometry;
+		obj_parallel_reader<T> reader(geometry);
+		if (!reader.read_obj(file_name))
 			return false;
+		clear();
+		positions = std::move(geometry.positions);
+		normals = std::move(geometry.normals);
+		tex_coords = std::move(geometry.tex_coords);
+		faces = std::move(geometry.faces);
+		position_indices = std::move(geometry.position_indices);
+		normal_indices = std::move(geometry.normal_indices);
+		tex_coord_indices = std::move(geometry.tex_coord_indices);
+		group_indices = std::move(geometry.group_indices);
+		material_indices = std::move(geometry.material_indices);
+		group_names = std::move(geometry.group_names);
+		materials.assign(geometry.materials.begin(), geometry.materials.end());
+		if (!geometry.colors.empty()) {
+			resize_colors(geometry.colors.size());
+			for (size_t i = 0; i < geometry.colors.size(); ++i)
+				set_color(i, geometry.colors[i]);
 		}
+		return true;
 	}
+	if (ext == "ply")
+		return read_ply(file_name);
+	if (ext == "stl")
+		return read_stl(file_name);
 	std::cerr << "unknown mesh file extension '*." << ext << "'" << std::endl;
 	return false;
 }
 
-/// write simple mesh to file (currently only obj is supported)
+/// write simple mesh to file
 template <typename T>
 bool simple_mesh<T>::write(const std::string& file_name) const
 {
+	std::string ext = cgv::utils::to_lower(cgv::utils::file::get_extension(file_name));
+	if (ext == "ply")
+		return write_ply(file_name);
+	if (ext == "stl")
+		return write_stl(file_name);
 	std::ofstream os(file_name);
 	if (os.fail())
 		return false;
@@ -16,9 +16,6 @@ namespace cgv {
 	namespace media {
 		namespace mesh {
 			
-template <typename T>
-class simple_mesh_obj_reader;
-
 template <typename T>
 class CGV_API obj_loader_generic;
 
@@ -221,7 +218,6 @@ public:
 	/// color type used in surface materials
 	typedef typename illum::surface_material::color_type clr_type;
 protected:
-	friend class simple_mesh_obj_reader<T>;
 	std::vector<vec3>  positions;
 	std::vector<vec3>  normals;
 	std::vector<vec3>  tangents;
@@ -305,10 +301,21 @@ public:
 	void compute_vertex_normals();
 	/// construct from obj loader
 	void construct(const obj_loader_generic<T>& loader, bool copy_grp_info, bool copy_material_info);
-	/// read simple mesh from file (currently only obj and stl are supported)
+	/// read simple mesh from file, where the format is selected by the extension (obj, ply and stl are supported) and obj files are cached as configured with set_obj_cache_directory()
 	bool read(const std::string& file_name);
-	/// write simple mesh to file (currently only obj is supported)
+	/// write simple mesh to file, where the format is selected by the extension (ply and stl, all others are written as obj)
 	bool write(const std::string& file_name) const;
+	/** read ascii or binary ply file with vertex positions, optional per vertex normals, texture coordinates and colors and
+	    faces given by vertex index lists. Vertex records are decoded from large blocks read directly from the file. */
+	bool read_ply(const std::string& file_name);
+	/** write binary ply file in the byte order of the host. Normals and texture coordinates are written per vertex, where vertices are
+	    duplicated with merge_indices if a position is used with different normal or texture coordinate indices. */
+	bool write_ply(const std::string& file_name) const;
+	/** read ascii or binary stl file with one normal per triangle. If weld is true, vertices with bitwise identical
+	    coordinates are merged with a hash map, otherwise each triangle gets three new positions. */
+	bool read_stl(const std::string& file_name, bool weld = true);
+	/// write binary stl file, where faces are triangulated as fans and triangle normals are computed from the positions
+	bool write_stl(const std::string& file_name) const;
 	/**
 	 * Extract vertex attribute array and element array buffers for triangulation and edges in wireframe.
 	 * 
@@ -0,0 +1,758 @@
+#include "simple_mesh.h"
+#include "flat_index_map.h"
+#include <cgv/utils/scan.h>
+#include <cgv/utils/file.h>
+#include <cgv/utils/convert_string.h>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+#ifdef WIN32
+#pragma warning(disable:4996)
+#endif
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+namespace {
+	inline bool is_little_endian_host()
+	{
+		const uint16_t one = 1;
+		return *reinterpret_cast<const uint8_t*>(&one) == 1;
+	}
+	/// copy n bytes to dst and reverse their order if swap is true
+	inline void copy_bytes(void* dst, const char* src, unsigned n, bool swap)
+	{
+		if (swap)
+			std::reverse_copy(src, src + n, static_cast<char*>(dst));
+		else
+			std::memcpy(dst, src, n);
+	}
+
+	/// reads a file through a large buffer and gives access to contiguous byte ranges
+	class block_reader
+	{
+		FILE* fp;
+		std::vector<char> buffer;
+		size_t pos, end;
+	public:
+		block_reader(FILE* _fp, size_t buffer_size = size_t(1) << 22) : fp(_fp), buffer(buffer_size), pos(0), end(0) {}
+		/// fill the buffer and return the number of available bytes, which is at least n unless the file ends before
+		size_t fill(size_t n = 1)
+		{
+			if (end - pos >= n)
+				return end - pos;
+			if (pos > 0) {
+				std::memmove(&buffer[0], &buffer[pos], end - pos);
+				end -= pos;
+				pos = 0;
+			}
+			if (n > buffer.size())
+				buffer.resize(n);
+			end += fread(&buffer[end], 1, buffer.size() - end, fp);
+			return end - pos;
+		}
+		/// return pointer to the next n bytes or 0 if the file ends before
+		const char* peek(size_t n) { return fill(n) >= n ? &buffer[pos] : 0; }
+		/// advance behind bytes returned by peek
+		void skip(size_t n) { pos += n; }
+		/// copy the next n bytes to dst, where large blocks are read directly from the file
+		bool read(void* dst, size_t n)
+		{
+			size_t m = std::min(n, end - pos);
+			std::memcpy(dst, &buffer[pos], m);
+			pos += m;
+			return m == n || fread(static_cast<char*>(dst) + m, 1, n - m, fp) == n - m;
+		}
+		/// read a line without the line end and return false at the end of the file
+		bool read_line(std::string& line)
+		{
+			line.clear();
+			while (fill(1) > 0) {
+				char c = buffer[pos++];
+				if (c == '\n')
+					return true;
+				if (c != '\r')
+					line.push_back(c);
+			}
+			return !line.empty();
+		}
+		/// read the rest of the file
+		void read_rest(std::string& content)
+		{
+			content.assign(&buffer[pos], end - pos);
+			pos = end;
+			char block[65536];
+			size_t n;
+			while ((n = fread(block, 1, sizeof(block), fp)) > 0)
+				content.append(block, n);
+		}
+	};
+
+	/// collects data in a large buffer and writes it in blocks
+	class block_writer
+	{
+		FILE* fp;
+		std::vector<char> buffer;
+		size_t pos;
+		bool success;
+	public:
+		block_writer(FILE* _fp, size_t buffer_size = size_t(1) << 22) : fp(_fp), buffer(buffer_size), pos(0), success(true) {}
+		~block_writer() { flush(); }
+		void flush()
+		{
+			if (pos > 0 && fwrite(&buffer[0], 1, pos, fp) != pos)
+				success = false;
+			pos = 0;
+		}
+		/// return pointer to space for n bytes that has to be filled before the next call
+		char* reserve(size_t n)
+		{
+			if (pos + n > buffer.size()) {
+				flush();
+				if (n > buffer.size())
+					buffer.resize(n);
+			}
+			char* p = &buffer[pos];
+			pos += n;
+			return p;
+		}
+		void write(const void* data, size_t n) { std::memcpy(reserve(n), data, n); }
+		bool good() const { return success; }
+	};
+
+	/**@name ply support*/
+	//@{
+	enum ply_type { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_UNKNOWN };
+	const unsigned ply_type_size[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+	ply_type find_ply_type(const std::string& name)
+	{
+		static const char* names[] = { "char", "uchar", "short", "ushort", "int", "uint", "float", "double" };
+		static const char* sized_names[] = { "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64" };
+		for (int i = 0; i < PLY_UNKNOWN; ++i)
+			if (name == names[i] || name == sized_names[i])
+				return ply_type(i);
+		return PLY_UNKNOWN;
+	}
+	/// decode a binary value of the given type
+	inline double decode_ply_value(const char* p, ply_type type, bool swap)
+	{
+		switch (type) {
+		case PLY_INT8:   return double(*reinterpret_cast<const int8_t*>(p));
+		case PLY_UINT8:  return double(*reinterpret_cast<const uint8_t*>(p));
+		case PLY_INT16:  { int16_t v;  copy_bytes(&v, p, 2, swap); return double(v); }
+		case PLY_UINT16: { uint16_t v; copy_bytes(&v, p, 2, swap); return double(v); }
+		case PLY_INT32:  { int32_t v;  copy_bytes(&v, p, 4, swap); return double(v); }
+		case PLY_UINT32: { uint32_t v; copy_bytes(&v, p, 4, swap); return double(v); }
+		case PLY_FLOAT32:{ float v;    copy_bytes(&v, p, 4, swap); return double(v); }
+		case PLY_FLOAT64:{ double v;   copy_bytes(&v, p, 8, swap); return v; }
+		default: return 0;
+		}
+	}
+	struct ply_property
+	{
+		std::string name;
+		ply_type type;
+		/// type of the element count in case of a list
+		ply_type count_type;
+		bool is_list;
+		/// byte offset in the record of elements without lists
+		size_t offset;
+	};
+	struct ply_element
+	{
+		std::string name;
+		size_t count;
+		std::vector<ply_property> properties;
+		/// size of a record or 0 if the element has list properties
+		size_t record_size;
+		/// return the index of the first property with one of the given names or -1
+		int find_property(const char* name0, const char* name1 = 0, const char* name2 = 0) const
+		{
+			for (size_t i = 0; i < properties.size(); ++i)
+				if (properties[i].name == name0 || (name1 && properties[i].name == name1) || (name2 && properties[i].name == name2))
+					return int(i);
+			return -1;
+		}
+	};
+	/// parse the ply header and return false if it is invalid
+	bool read_ply_header(block_reader& reader, std::string& format, std::vector<ply_element>& elements)
+	{
+		std::string line;
+		if (!reader.read_line(line) || line != "ply")
+			return false;
+		while (reader.read_line(line)) {
+			std::istringstream is(line);
+			std::vector<std::string> toks;
+			std::string tok;
+			while (is >> tok)
+				toks.push_back(tok);
+			if (toks.empty())
+				continue;
+			const std::string& keyword = toks[0];
+			if (keyword == "end_header")
+				return !format.empty();
+			if (keyword == "format" && toks.size() > 1)
+				format = toks[1];
+			else if (keyword == "element" && toks.size() > 2) {
+				ply_element e;
+				e.name = toks[1];
+				e.count = size_t(std::strtoull(toks[2].c_str(), 0, 10));
+				e.record_size = 0;
+				elements.push_back(e);
+			}
+			else if (keyword == "property" && toks.size() > 2 && !elements.empty()) {
+				ply_property p;
+				p.is_list = toks[1] == "list";
+				if (p.is_list) {
+					if (toks.size() < 5)
+						return false;
+					p.count_type = find_ply_type(toks[2]);
+					p.type = find_ply_type(toks[3]);
+					p.name = toks[4];
+				}
+				else {
+					p.count_type = PLY_UNKNOWN;
+					p.type = find_ply_type(toks[1]);
+					p.name = toks[2];
+				}
+				if (p.type == PLY_UNKNOWN || (p.is_list && p.count_type == PLY_UNKNOWN)) {
+					std::cerr << "read_ply: unknown property type in line '" << line << "'" << std::endl;
+					return false;
+				}
+				elements.back().properties.push_back(p);
+			}
+		}
+		return false;
+	}
+	/// compute offsets and record size of elements without list properties
+	void compute_record_layout(ply_element& e)
+	{
+		size_t offset = 0;
+		for (auto& p : e.properties) {
+			if (p.is_list) {
+				e.record_size = 0;
+				return;
+			}
+			p.offset = offset;
+			offset += ply_type_size[p.type];
+		}
+		e.record_size = offset;
+	}
+	/// source of ply values for binary and ascii encoded files
+	class ply_value_source
+	{
+		block_reader& reader;
+		bool ascii, swap;
+		std::string text;
+		const char* text_pos;
+	public:
+		ply_value_source(block_reader& _reader, bool _ascii, bool _swap) : reader(_reader), ascii(_ascii), swap(_swap)
+		{
+			if (ascii) {
+				reader.read_rest(text);
+				text_pos = text.data();
+			}
+		}
+		bool is_ascii() const { return ascii; }
+		bool get_swap() const { return swap; }
+		/// read next value and return false at the end of the data
+		bool next(ply_type type, double& value)
+		{
+			if (ascii) {
+				const char* p = cgv::utils::parse_double(text_pos, text.data() + text.size(), value);
+				if (!p)
+					return false;
+				text_pos = p;
+				return true;
+			}
+			const char* p = reader.peek(ply_type_size[type]);
+			if (!p)
+				return false;
+			value = decode_ply_value(p, type, swap);
+			reader.skip(ply_type_size[type]);
+			return true;
+		}
+	};
+	/// read all values of one record and call handler(property_index, value_index, value) for each value
+	template <typename F>
+	bool read_ply_record(ply_value_source& source, const ply_element& e, const F& handler)
+	{
+		double value, count;
+		for (size_t pi = 0; pi < e.properties.size(); ++pi) {
+			const ply_property& p = e.properties[pi];
+			if (!p.is_list) {
+				if (!source.next(p.type, value))
+					return false;
+				handler(pi, size_t(0), value);
+				continue;
+			}
+			if (!source.next(p.count_type, count))
+				return false;
+			handler(pi, size_t(-1), count);
+			for (size_t i = 0; i < size_t(count); ++i) {
+				if (!source.next(p.type, value))
+					return false;
+				handler(pi, i, value);
+			}
+		}
+		return true;
+	}
+	/// call f(record_pointer) for each record of a binary element without list properties, where records are decoded from large blocks
+	template <typename F>
+	bool for_each_ply_record(block_reader& reader, const ply_element& e, const F& f)
+	{
+		// records without properties cannot be decoded from blocks
+		if (e.record_size == 0)
+			return e.count == 0;
+		size_t remaining = e.count;
+		while (remaining > 0) {
+			size_t n = std::min(remaining, reader.fill(e.record_size) / e.record_size);
+			const char* p = n > 0 ? reader.peek(n*e.record_size) : 0;
+			if (!p)
+				return false;
+			for (size_t i = 0; i < n; ++i, p += e.record_size)
+				f(p);
+			reader.skip(n*e.record_size);
+			remaining -= n;
+		}
+		return true;
+	}
+	//@}
+
+	/// fixed size record of a binary stl file
+	const size_t stl_record_size = 50;
+	/// normalized triangle normal or null vector for degenerate triangles
+	template <typename T>
+	cgv::math::fvec<T, 3> compute_triangle_normal(const cgv::math::fvec<T, 3>& p0, const cgv::math::fvec<T, 3>& p1, const cgv::math::fvec<T, 3>& p2)
+	{
+		cgv::math::fvec<T, 3> n = cross(p1 - p0, p2 - p0);
+		T l = n.length();
+		return l > 0 ? n / l : n;
+	}
+}
+
+template <typename T>
+bool simple_mesh<T>::read_ply(const std::string& file_name)
+{
+	FILE* fp = fopen(file_name.c_str(), "rb");
+	if (!fp) {
+		std::cerr << "read_ply: could not open file " << file_name << std::endl;
+		return false;
+	}
+	block_reader reader(fp);
+	std::string format;
+	std::vector<ply_element> elements;
+	if (!read_ply_header(reader, format, elements)) {
+		std::cerr << "read_ply: invalid header in file " << file_name << std::endl;
+		fclose(fp);
+		return false;
+	}
+	bool ascii = format == "ascii";
+	if (!ascii && format != "binary_little_endian" && format != "binary_big_endian") {
+		std::cerr << "read_ply: unknown format " << format << std::endl;
+		fclose(fp);
+		return false;
+	}
+	bool swap = !ascii && (format == "binary_little_endian") != is_little_endian_host();
+	ply_value_source source(reader, ascii, swap);
+	clear();
+	bool success = true;
+	for (auto& e : elements) {
+		compute_record_layout(e);
+		if (e.name == "vertex") {
+			int pos_props[3] = { e.find_property("x"), e.find_property("y"), e.find_property("z") };
+			int nml_props[3] = { e.find_property("nx"), e.find_property("ny"), e.find_property("nz") };
+			int tc_props[2] = { e.find_property("u", "s", "texture_u"), e.find_property("v", "t", "texture_v") };
+			if (tc_props[0] == -1)
+				tc_props[0] = e.find_property("texture_s");
+			if (tc_props[1] == -1)
+				tc_props[1] = e.find_property("texture_t");
+			int clr_props[4] = { e.find_property("red", "r", "diffuse_red"), e.find_property("green", "g", "diffuse_green"),
+				e.find_property("blue", "b", "diffuse_blue"), e.find_property("alpha", "a") };
+			bool has_nmls = nml_props[0] != -1 && nml_props[1] != -1 && nml_props[2] != -1;
+			bool has_tcs = tc_props[0] != -1 && tc_props[1] != -1;
+			bool has_clrs = clr_props[0] != -1 && clr_props[1] != -1 && clr_props[2] != -1;
+			bool has_alpha = has_clrs && clr_props[3] != -1;
+			bool byte_clrs = has_clrs && e.properties[clr_props[0]].type == PLY_UINT8;
+			positions.resize(e.count, vec3(T(0)));
+			if (has_nmls)
+				normals.resize(e.count);
+			if (has_tcs)
+				tex_coords.resize(e.count);
+			if (has_clrs)
+				ensure_colors(byte_clrs ? (has_alpha ? CT_RGBA8 : CT_RGB8) : (has_alpha ? CT_RGBA : CT_RGB), e.count);
+			// map property index to attribute and component
+			std::vector<int> attribute(e.properties.size(), -1);
+			for (int c = 0; c < 3; ++c) {
+				if (pos_props[c] != -1)
+					attribute[pos_props[c]] = c;
+				if (has_nmls)
+					attribute[nml_props[c]] = 3 + c;
+			}
+			for (int c = 0; c < 4; ++c)
+				if (has_clrs && clr_props[c] != -1)
+					attribute[clr_props[c]] = 8 + c;
+			if (has_tcs) {
+				attribute[tc_props[0]] = 6;
+				attribute[tc_props[1]] = 7;
+			}
+			size_t vi = 0;
+			float clr[4] = { 0, 0, 0, 1 };
+			auto store = [&](size_t pi, double value) {
+				int a = attribute[pi];
+				if (a < 0)
+					return;
+				if (a < 3)
+					positions[vi][a] = T(value);
+				else if (a < 6)
+					normals[vi][a - 3] = T(value);
+				else if (a < 8)
+					tex_coords[vi][a - 6] = T(value);
+				else
+					clr[a - 8] = float(value);
+			};
+			auto finish_vertex = [&]() {
+				if (has_clrs) {
+					if (byte_clrs) {
+						uint8_t c8[4] = { uint8_t(clr[0]), uint8_t(clr[1]), uint8_t(clr[2]), uint8_t(clr[3]) };
+						set_color(vi, c8);
+					}
+					else
+						set_color(vi, clr);
+				}
+				++vi;
+			};
+			const ply_property* pp = e.properties.empty() ? 0 : &e.properties[0];
+			if (!ascii && e.record_size == 3 * sizeof(T) && e.properties.size() == 3 && !swap &&
+				pos_props[0] == 0 && pos_props[1] == 1 && pos_props[2] == 2 &&
+				pp[0].type == (sizeof(T) == 4 ? PLY_FLOAT32 : PLY_FLOAT64) && pp[1].type == pp[0].type && pp[2].type == pp[0].type)
+				// positions only in native layout are copied in one block
+				success = e.count == 0 || reader.read(&positions[0], e.count * 3 * sizeof(T));
+			else if (!ascii && e.record_size > 0)
+				success = for_each_ply_record(reader, e, [&](const char* p) {
+					for (size_t pi = 0; pi < e.properties.size(); ++pi)
+						if (attribute[pi] >= 0)
+							store(pi, decode_ply_value(p + pp[pi].offset, pp[pi].type, swap));
+					finish_vertex();
+				});
+			else {
+				for (size_t i = 0; success && i < e.count; ++i) {
+					success = read_ply_record(source, e, [&](size_t pi, size_t ci, double value) {
+						if (ci == 0)
+							store(pi, value);
+					});
+					finish_vertex();
+				}
+			}
+		}
+		else if (e.name == "face") {
+			int idx_prop = e.find_property("vertex_indices", "vertex_index");
+			faces.reserve(e.count);
+			position_indices.reserve(3 * e.count);
+			for (size_t i = 0; success && i < e.count; ++i) {
+				faces.push_back(idx_type(position_indices.size()));
+				success = read_ply_record(source, e, [&](size_t pi, size_t ci, double value) {
+					if (int(pi) == idx_prop && ci != size_t(-1))
+						position_indices.push_back(idx_type(value));
+				});
+			}
+		}
+		else if (!ascii && e.record_size > 0) {
+			for (size_t i = 0; success && i < e.count; ) {
+				size_t n = std::min(e.count - i, std::max(size_t(1), reader.fill(e.record_size) / e.record_size));
+				success = reader.peek(n*e.record_size) != 0;
+				reader.skip(n*e.record_size);
+				i += n;
+			}
+		}
+		else {
+			for (size_t i = 0; success && i < e.count; ++i)
+				success = read_ply_record(source, e, [](size_t, size_t, double) {});
+		}
+		if (!success) {
+			std::cerr << "read_ply: unexpected end of data in element " << e.name << " of file " << file_name << std::endl;
+			break;
+		}
+	}
+	fclose(fp);
+	if (!success)
+		return false;
+	for (idx_type pi : position_indices)
+		if (pi >= positions.size()) {
+			std::cerr << "read_ply: vertex index " << pi << " out of range in file " << file_name << std::endl;
+			return false;
+		}
+	if (!normals.empty())
+		normal_indices = position_indices;
+	if (!tex_coords.empty())
+		tex_coord_indices = position_indices;
+	return true;
+}
+
+template <typename T>
+bool simple_mesh<T>::write_ply(const std::string& file_name) const
+{
+	// check whether normals and texture coordinates can be stored per position
+	bool nmls = has_normal_indices(), tcs = has_tex_coord_indices();
+	bool per_position = true;
+	std::vector<idx_type> p2n, p2t;
+	if (nmls)
+		p2n.resize(positions.size(), idx_type(-1));
+	if (tcs)
+		p2t.resize(positions.size(), idx_type(-1));
+	for (idx_type ci = 0; per_position && ci < get_nr_corners(); ++ci) {
+		idx_type pi = position_indices[ci];
+		if (nmls) {
+			if (p2n[pi] == idx_type(-1))
+				p2n[pi] = normal_indices[ci];
+			else if (p2n[pi] != normal_indices[ci])
+				per_position = false;
+		}
+		if (tcs) {
+			if (p2t[pi] == idx_type(-1))
+				p2t[pi] = tex_coord_indices[ci];
+			else if (p2t[pi] != tex_coord_indices[ci])
+				per_position = false;
+		}
+	}
+	// otherwise a vertex is written per unique index tuple
+	std::vector<idx_type> vertex_indices;
+	std::vector<vec4i> unique_tuples;
+	if (!per_position)
+		merge_indices(vertex_indices, unique_tuples, tcs ? &tcs : 0, nmls ? &nmls : 0);
+	const std::vector<idx_type>& corner_vertices = per_position ? position_indices : vertex_indices;
+	size_t nr_vertices = per_position ? positions.size() : unique_tuples.size();
+	bool clrs = has_colors() && get_nr_colors() == positions.size();
+	idx_type max_degree = 0;
+	for (idx_type fi = 0; fi < get_nr_faces(); ++fi)
+		max_degree = std::max(max_degree, face_degree(fi));
+
+	FILE* fp = fopen(file_name.c_str(), "wb");
+	if (!fp) {
+		std::cerr << "write_ply: could not open file " << file_name << std::endl;
+		return false;
+	}
+	const char* crd_type = sizeof(T) == 4 ? "float" : "double";
+	std::string header = std::string("ply\nformat ") + (is_little_endian_host() ? "binary_little_endian" : "binary_big_endian") + " 1.0\n";
+	header += "element vertex " + cgv::utils::to_string(nr_vertices) + "\n";
+	header += std::string("property ") + crd_type + " x\nproperty " + crd_type + " y\nproperty " + crd_type + " z\n";
+	if (nmls)
+		header += std::string("property ") + crd_type + " nx\nproperty " + crd_type + " ny\nproperty " + crd_type + " nz\n";
+	if (tcs)
+		header += std::string("property ") + crd_type + " u\nproperty " + crd_type + " v\n";
+	if (clrs)
+		header += "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\n";
+	header += "element face " + cgv::utils::to_string(faces.size()) + "\n";
+	header += std::string("property list ") + (max_degree > 255 ? "uint" : "uchar") + " uint vertex_indices\nend_header\n";
+	bool success;
+	{
+		block_writer writer(fp);
+		writer.write(header.data(), header.size());
+		vec3 null_vector(T(0));
+		vec2 null_tex_coord(T(0));
+		for (size_t vi = 0; vi < nr_vertices; ++vi) {
+			idx_type pi = per_position ? idx_type(vi) : unique_tuples[vi][0];
+			writer.write(&positions[pi], sizeof(vec3));
+			if (nmls) {
+				idx_type ni = per_position ? p2n[pi] : unique_tuples[vi][2];
+				writer.write(ni == idx_type(-1) ? &null_vector : &normals[ni], sizeof(vec3));
+			}
+			if (tcs) {
+				idx_type ti = per_position ? p2t[pi] : unique_tuples[vi][1];
+				writer.write(ti == idx_type(-1) ? &null_tex_coord : &tex_coords[ti], sizeof(vec2));
+			}
+			if (clrs) {
+				rgba8 c;
+				put_color(pi, c);
+				writer.write(&c, 4);
+			}
+		}
+		for (idx_type fi = 0; fi < get_nr_faces(); ++fi) {
+			idx_type degree = face_degree(fi);
+			if (max_degree > 255)
+				writer.write(&degree, 4);
+			else
+				*writer.reserve(1) = char(uint8_t(degree));
+			writer.write(&corner_vertices[begin_corner(fi)], degree * sizeof(idx_type));
+		}
+		writer.flush();
+		success = writer.good();
+	}
+	if (fclose(fp) != 0 || !success) {
+		std::cerr << "write_ply: could not write file " << file_name << std::endl;
+		return false;
+	}
+	return true;
+}
+
+template <typename T>
+bool simple_mesh<T>::read_stl(const std::string& file_name, bool weld)
+{
+	FILE* fp = fopen(file_name.c_str(), "rb");
+	if (!fp) {
+		std::cerr << "read_stl: could not open file " << file_name << std::endl;
+		return false;
+	}
+	clear();
+	block_reader reader(fp);
+	size_t file_size = cgv::utils::file::size(file_name);
+	const char* header = reader.peek(84);
+	uint32_t nr_triangles = 0;
+	if (header)
+		copy_bytes(&nr_triangles, header + 80, 4, !is_little_endian_host());
+	bool binary = header && file_size == 84 + stl_record_size*nr_triangles;
+	if (!binary)
+		nr_triangles = uint32_t(file_size / 256);
+	flat_index_map<3> position_map(weld ? nr_triangles / 2 : 0);
+	positions.reserve(weld ? nr_triangles / 2 + 3 : 3 * size_t(nr_triangles));
+	normals.reserve(nr_triangles);
+	faces.reserve(nr_triangles);
+	position_indices.reserve(3 * size_t(nr_triangles));
+	normal_indices.reserve(3 * size_t(nr_triangles));
+	// add corner with position given by three floats
+	auto add_corner = [&](const float* p) {
+		idx_type pi;
+		if (weld) {
+			// adding zero maps -0 to +0 such that both are welded
+			float q[3] = { p[0] + 0.0f, p[1] + 0.0f, p[2] + 0.0f };
+			uint32_t key[3];
+			std::memcpy(key, q, 12);
+			uint32_t& idx = position_map[key];
+			if (idx == uint32_t(-1)) {
+				idx = uint32_t(positions.size());
+				positions.push_back(vec3(T(q[0]), T(q[1]), T(q[2])));
+			}
+			pi = idx;
+		}
+		else {
+			pi = idx_type(positions.size());
+			positions.push_back(vec3(T(p[0]), T(p[1]), T(p[2])));
+		}
+		position_indices.push_back(pi);
+		normal_indices.push_back(idx_type(normals.size() - 1));
+	};
+	bool success = true;
+	if (binary) {
+		reader.skip(84);
+		bool swap = !is_little_endian_host();
+		ply_element e;
+		e.count = nr_triangles;
+		e.record_size = stl_record_size;
+		success = for_each_ply_record(reader, e, [&](const char* p) {
+			float v[12];
+			for (int i = 0; i < 12; ++i)
+				copy_bytes(v + i, p + 4 * i, 4, swap);
+			normals.push_back(vec3(T(v[0]), T(v[1]), T(v[2])));
+			faces.push_back(idx_type(position_indices.size()));
+			for (int c = 1; c < 4; ++c)
+				add_corner(v + 3 * c);
+		});
+	}
+	else {
+		std::string content;
+		reader.read_rest(content);
+		const char* p = content.data(), * end = p + content.size();
+		float v[3] = { 0, 0, 0 };
+		while (p < end) {
+			while (p < end && cgv::utils::is_space(*p))
+				++p;
+			const char* q = p;
+			while (q < end && !cgv::utils::is_space(*q))
+				++q;
+			size_t n = q - p;
+			if ((n == 6 && std::equal(p, q, "normal")) || (n == 6 && std::equal(p, q, "vertex"))) {
+				for (int c = 0; c < 3; ++c) {
+					const char* r = cgv::utils::parse_float(q, end, v[c]);
+					if (!r) {
+						v[c] = 0;
+						continue;
+					}
+					q = r;
+				}
+				if (*p == 'n') {
+					normals.push_back(vec3(T(v[0]), T(v[1]), T(v[2])));
+					faces.push_back(idx_type(position_indices.size()));
+				}
+				else if (!faces.empty())
+					add_corner(v);
+			}
+			p = q;
+		}
+		// remove faces with less than three corners
+		for (idx_type fi = 0; fi < get_nr_faces(); ++fi)
+			if (face_degree(fi) < 3) {
+				std::cerr << "read_stl: facet " << fi << " has less than three vertices in file " << file_name << std::endl;
+				success = false;
+				break;
+			}
+	}
+	fclose(fp);
+	if (!success) {
+		std::cerr << "read_stl: could not read file " << file_name << std::endl;
+		return false;
+	}
+	return true;
+}
+
+template <typename T>
+bool simple_mesh<T>::write_stl(const std::string& file_name) const
+{
+	FILE* fp = fopen(file_name.c_str(), "wb");
+	if (!fp) {
+		std::cerr << "write_stl: could not open file " << file_name << std::endl;
+		return false;
+	}
+	uint32_t nr_triangles = 0;
+	for (idx_type fi = 0; fi < get_nr_faces(); ++fi)
+		if (face_degree(fi) > 2)
+			nr_triangles += face_degree(fi) - 2;
+	bool swap = !is_little_endian_host();
+	bool success;
+	{
+		block_writer writer(fp);
+		char header[80] = "binary stl written by cgv::media::mesh::simple_mesh";
+		writer.write(header, 80);
+		copy_bytes(writer.reserve(4), reinterpret_cast<const char*>(&nr_triangles), 4, swap);
+		for (idx_type fi = 0; fi < get_nr_faces(); ++fi) {
+			idx_type c0 = begin_corner(fi), ce = end_corner(fi);
+			for (idx_type ci = c0 + 1; ci + 1 < ce; ++ci) {
+				const vec3* p[3] = { &positions[position_indices[c0]], &positions[position_indices[ci]], &positions[position_indices[ci + 1]] };
+				vec3 n = compute_triangle_normal(*p[0], *p[1], *p[2]);
+				float v[12] = { float(n[0]), float(n[1]), float(n[2]) };
+				for (int c = 0; c < 3; ++c)
+					for (int i = 0; i < 3; ++i)
+						v[3 + 3 * c + i] = float((*p[c])[i]);
+				char* r = writer.reserve(stl_record_size);
+				for (int i = 0; i < 12; ++i)
+					copy_bytes(r + 4 * i, reinterpret_cast<const char*>(v + i), 4, swap);
+				r[48] = r[49] = 0;
+			}
+		}
+		writer.flush();
+		success = writer.good();
+	}
+	if (fclose(fp) != 0 || !success) {
+		std::cerr << "write_stl: could not write file " << file_name << std::endl;
+		return false;
+	}
+	return true;
+}
+
+template bool simple_mesh<float>::read_ply(const std::string&);
+template bool simple_mesh<float>::write_ply(const std::string&) const;
+template bool simple_mesh<float>::read_stl(const std::string&, bool);
+template bool simple_mesh<float>::write_stl(const std::string&) const;
+template bool simple_mesh<double>::read_ply(const std::string&);
+template bool simple_mesh<double>::write_ply(const std::string&) const;
+template bool simple_mesh<double>::read_stl(const std::string&, bool);
+template bool simple_mesh<double>::write_stl(const std::string&) const;
+
+		}
+	}
+}
@@ -17,6 +17,32 @@ struct streaming_mesh_callback_handler
 	virtual void new_polygon(const std::vector<unsigned int>& vertex_indices) = 0;
 	/// drop the currently first vertex that has the given global vertex index
 	virtual void before_drop_vertex(unsigned int vertex_index) = 0;
+	/// called by streaming_mesh::finish() after all remaining vertices have been dropped at the end of the stream
+	virtual void finish() {}
+};
+
+/** base class of stages of a streaming mesh pipeline that forward all callbacks to the next handler. Stages that
+    compute per vertex data override the callbacks, process the event and call the base implementation. */
+struct streaming_mesh_stage : public streaming_mesh_callback_handler
+{
+protected:
+	/// next handler in the pipeline
+	streaming_mesh_callback_handler* next;
+public:
+	/// construct with next handler
+	streaming_mesh_stage(streaming_mesh_callback_handler* _next = 0) : next(_next) {}
+	/// set the next handler in the pipeline
+	void set_next(streaming_mesh_callback_handler* _next) { next = _next; }
+	/// return the next handler in the pipeline
+	streaming_mesh_callback_handler* get_next() const { return next; }
+	/// forward to next handler
+	void new_vertex(unsigned int vertex_index) { if (next) next->new_vertex(vertex_index); }
+	/// forward to next handler
+	void new_polygon(const std::vector<unsigned int>& vertex_indices) { if (next) next->new_polygon(vertex_indices); }
+	/// forward to next handler
+	void before_drop_vertex(unsigned int vertex_index) { if (next) next->before_drop_vertex(vertex_index); }
+	/// forward to next handler
+	void finish() { if (next) next->finish(); }
 };
 
 /// class used to perform the marching cubes algorithm
@@ -68,6 +94,14 @@ public:
 		for (unsigned int i=0; i<n; ++i)
 			drop_vertex();
 	}
+	/// return the number of vertices that have not been dropped yet
+	unsigned int get_nr_live_vertices() const              { return (unsigned int) pnts.size(); }
+	/// end the stream by dropping all remaining vertices and calling the finish callback of the callback handler
+	void finish() {
+		drop_vertices((unsigned int) pnts.size());
+		if (smcbh)
+			smcbh->finish();
+	}
 	/// write access to vertex locations
 		   pnt_type& vertex_location(unsigned int vi)       { return pnts[vi-idx_off]; }
 	/// read access to vertex locations
@@ -0,0 +1,329 @@
+#pragma once
+
+#include "streaming_mesh.h"
+#include <unordered_map>
+#include <deque>
+#include <array>
+#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+/** streaming mesh stage that computes vertex normals as the normalized sum of the area weighted normals of the
+    incident polygons. Normals are accumulated in the streaming mesh of the source and normalized before the vertex is
+	dropped, such that subsequent stages see the final normal in before_drop_vertex. */
+template <typename T>
+class streaming_normal_stage : public streaming_mesh_stage
+{
+protected:
+	/// streaming mesh providing locations and storing the accumulated normals
+	streaming_mesh<T>* source;
+public:
+	typedef typename streaming_mesh<T>::pnt_type pnt_type;
+	typedef typename streaming_mesh<T>::vec_type vec_type;
+	/// construct with source mesh and next handler
+	streaming_normal_stage(streaming_mesh<T>* _source = 0, streaming_mesh_callback_handler* _next = 0) :
+		streaming_mesh_stage(_next), source(_source) {}
+	/// set the streaming mesh providing vertex locations and normals
+	void set_source(streaming_mesh<T>* _source) { source = _source; }
+	/// reset normal and forward
+	void new_vertex(unsigned int vertex_index) {
+		source->vertex_normal(vertex_index) = vec_type(0, 0, 0);
+		streaming_mesh_stage::new_vertex(vertex_index);
+	}
+	/// add polygon normal computed with Newell's method to the normals of its vertices and forward
+	void new_polygon(const std::vector<unsigned int>& vertex_indices) {
+		vec_type n(0, 0, 0);
+		size_t k = vertex_indices.size();
+		for (size_t i = 0; i < k; ++i) {
+			const pnt_type& p = source->vertex_location(vertex_indices[i]);
+			const pnt_type& q = source->vertex_location(vertex_indices[(i + 1) % k]);
+			n += cross(p, q);
+		}
+		n *= T(0.5);
+		for (unsigned int vi : vertex_indices)
+			source->vertex_normal(vi) += n;
+		streaming_mesh_stage::new_polygon(vertex_indices);
+	}
+	/// normalize accumulated normal and forward
+	void before_drop_vertex(unsigned int vertex_index) {
+		vec_type& n = source->vertex_normal(vertex_index);
+		T l = n.length();
+		if (l > 0)
+			n /= l;
+		streaming_mesh_stage::before_drop_vertex(vertex_index);
+	}
+};
+
+/** streaming decimation by vertex clustering on a uniform grid following Lindstrom's out of core simplification.
+    Vertices of the input stream are mapped to grid cells, which become the vertices of an output streaming mesh.
+	Each cell accumulates the plane quadrics of the triangles incident to its vertices and its output vertex is placed
+	at the quadric minimizer inside the cell or at the mean of its vertices if the quadric is degenerate. Triangles
+	with vertices in three different cells are emitted to the output, while duplicates are skipped.
+
+	A cell is finalized once all of its input vertices have been dropped and the given number of further input
+	vertices has been dropped. Its output vertex gets the final location and is dropped from the output mesh in
+	creation order. Input vertices mapping to a finalized cell open a new cell in the same place, such that the
+	memory footprint only depends on the width of the stream front. Output vertices get a preliminary location
+	when they are announced to the output handler and their final location in before_drop_vertex. */
+template <typename T>
+class streaming_clustering_stage : public streaming_mesh_callback_handler
+{
+public:
+	typedef typename streaming_mesh<T>::pnt_type pnt_type;
+	typedef typename streaming_mesh<T>::vec_type vec_type;
+protected:
+	/// accumulated data of a grid cell
+	struct cell_type
+	{
+		/// key of grid cell
+		uint64_t key;
+		/// upper triangle of quadric matrix A, vector b and scalar c of error x'Ax + 2b'x + c
+		double A[6], b[3], c;
+		/// sum of vertex locations
+		double sum[3];
+		/// number of vertices mapped to the cell and number of them not dropped yet
+		unsigned int nr_vertices, nr_live_vertices;
+		/// index of output vertex
+		unsigned int output_index;
+		/// number of dropped input vertices when the cell became unreferenced
+		unsigned int release_stamp;
+	};
+	/// streaming mesh providing the input vertices
+	const streaming_mesh<T>* source;
+	/// output mesh
+	streaming_mesh<T> output;
+	/// origin and extent of grid cells
+	pnt_type origin;
+	T cell_size;
+	/// number of dropped input vertices to wait before an unreferenced cell is finalized
+	unsigned int finalization_delay;
+	/// cells with free list of slots
+	std::vector<cell_type> cells;
+	std::vector<unsigned int> free_cells;
+	/// map from cell key to slot of open cells
+	std::unordered_map<uint64_t, unsigned int> cell_index;
+	/// per live input vertex the slot of its cell
+	std::deque<unsigned int> vertex_cells;
+	/// number of dropped input vertices
+	unsigned int nr_dropped;
+	/// unreferenced cells waiting for finalization as pairs of slot and release stamp
+	std::deque<std::pair<unsigned int, unsigned int> > released_cells;
+	/// per live output vertex whether it has been finalized
+	std::deque<bool> output_finalized;
+	/// hash of sorted output triangle
+	struct triangle_hash
+	{
+		size_t operator () (const std::array<unsigned int, 3>& t) const {
+			return std::hash<uint64_t>()((uint64_t(t[0]) * 0x9E3779B97F4A7C15ull) ^ (uint64_t(t[1]) << 21) ^ (uint64_t(t[2]) << 42) ^ t[2]);
+		}
+	};
+	/// sorted output triangles emitted since their smallest vertex has been created
+	std::unordered_set<std::array<unsigned int, 3>, triangle_hash> triangles;
+	/// size of triangle set that triggers removal of triangles with dropped vertices
+	size_t triangle_purge_size;
+	/// compute key of the cell containing p
+	uint64_t compute_key(const pnt_type& p) const {
+		uint64_t key = 0;
+		for (unsigned int i = 0; i < 3; ++i) {
+			int64_t c = (int64_t)std::floor((p(i) - origin(i)) / cell_size) + (int64_t(1) << 20);
+			key = (key << 21) | (uint64_t(std::min(std::max(c, int64_t(0)), (int64_t(1) << 21) - 1)));
+		}
+		return key;
+	}
+	/// compute lower corner of the cell with given key
+	pnt_type cell_min(uint64_t key) const {
+		pnt_type p;
+		for (int i = 2; i >= 0; --i, key >>= 21)
+			p(i) = origin(i) + cell_size * T(int64_t(key & ((1 << 21) - 1)) - (int64_t(1) << 20));
+		return p;
+	}
+	/// compute output location of cell
+	pnt_type compute_location(const cell_type& c) const {
+		double m[3] = { c.sum[0] / c.nr_vertices, c.sum[1] / c.nr_vertices, c.sum[2] / c.nr_vertices };
+		// solve A (m + d) = -b for the offset d to the mean with Cramer's rule if A is well conditioned
+		const double* A = c.A;
+		double r[3] = {
+			-(A[0] * m[0] + A[1] * m[1] + A[2] * m[2] + c.b[0]),
+			-(A[1] * m[0] + A[3] * m[1] + A[4] * m[2] + c.b[1]),
+			-(A[2] * m[0] + A[4] * m[1] + A[5] * m[2] + c.b[2])
+		};
+		double C[6] = {
+			A[3] * A[5] - A[4] * A[4], A[2] * A[4] - A[1] * A[5], A[1] * A[4] - A[2] * A[3],
+			A[0] * A[5] - A[2] * A[2], A[1] * A[2] - A[0] * A[4], A[0] * A[3] - A[1] * A[1]
+		};
+		double det = A[0] * C[0] + A[1] * C[1] + A[2] * C[2];
+		double tr = A[0] + A[3] + A[5];
+		pnt_type p((T)m[0], (T)m[1], (T)m[2]);
+		if (tr <= 0 || std::abs(det) <= 1e-6 * tr * tr * tr)
+			return p;
+		pnt_type q(
+			T(m[0] + (C[0] * r[0] + C[1] * r[1] + C[2] * r[2]) / det),
+			T(m[1] + (C[1] * r[0] + C[3] * r[1] + C[4] * r[2]) / det),
+			T(m[2] + (C[2] * r[0] + C[4] * r[1] + C[5] * r[2]) / det));
+		// reject minimizers far outside of the cell
+		pnt_type l = cell_min(c.key);
+		for (unsigned int i = 0; i < 3; ++i)
+			if (q(i) < l(i) - T(0.5)*cell_size || q(i) > l(i) + T(1.5)*cell_size)
+				return p;
+		return q;
+	}
+	/// finalize cell in given slot and drop finalized output vertices from the front
+	void finalize_cell(unsigned int ci) {
+		cell_type& c = cells[ci];
+		output.vertex_location(c.output_index) = compute_location(c);
+		output_finalized[c.output_index - output.get_nr_dropped_vertices()] = true;
+		cell_index.erase(c.key);
+		free_cells.push_back(ci);
+		unsigned int n = 0;
+		while (n < output_finalized.size() && output_finalized[n])
+			++n;
+		output_finalized.erase(output_finalized.begin(), output_finalized.begin() + n);
+		output.drop_vertices(n);
+	}
+	/// finalize released cells whose delay has passed and that have not been referenced again
+	void finalize_released_cells(bool all) {
+		while (!released_cells.empty() && (all || released_cells.front().second + finalization_delay <= nr_dropped)) {
+			unsigned int ci = released_cells.front().first, stamp = released_cells.front().second;
+			released_cells.pop_front();
+			if (cells[ci].nr_live_vertices == 0 && cells[ci].release_stamp == stamp)
+				finalize_cell(ci);
+		}
+	}
+	/// add plane quadric of triangle weighted by its area to cell
+	static void add_quadric(cell_type& c, const double* n, double d) {
+		c.A[0] += n[0] * n[0]; c.A[1] += n[0] * n[1]; c.A[2] += n[0] * n[2];
+		c.A[3] += n[1] * n[1]; c.A[4] += n[1] * n[2]; c.A[5] += n[2] * n[2];
+		for (unsigned int i = 0; i < 3; ++i)
+			c.b[i] += d * n[i];
+		c.c += d * d;
+	}
+	/// process triangle given by input vertex indices
+	void process_triangle(unsigned int vi, unsigned int vj, unsigned int vk) {
+		unsigned int off = source->get_nr_dropped_vertices();
+		unsigned int cis[3] = { vertex_cells[vi - off], vertex_cells[vj - off], vertex_cells[vk - off] };
+		// area weighted plane quadric uses the unnormalized normal scaled by the square root of the half area
+		const pnt_type& p0 = source->vertex_location(vi), &p1 = source->vertex_location(vj), &p2 = source->vertex_location(vk);
+		vec_type e1 = p1 - p0, e2 = p2 - p0;
+		double n[3] = {
+			double(e1(1)) * e2(2) - double(e1(2)) * e2(1),
+			double(e1(2)) * e2(0) - double(e1(0)) * e2(2),
+			double(e1(0)) * e2(1) - double(e1(1)) * e2(0)
+		};
+		double l = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (l > 0) {
+			double s = std::sqrt(0.5 / l);
+			for (unsigned int i = 0; i < 3; ++i)
+				n[i] *= s;
+			double d = -(n[0] * p0(0) + n[1] * p0(1) + n[2] * p0(2));
+			add_quadric(cells[cis[0]], n, d);
+			if (cis[1] != cis[0])
+				add_quadric(cells[cis[1]], n, d);
+			if (cis[2] != cis[0] && cis[2] != cis[1])
+				add_quadric(cells[cis[2]], n, d);
+		}
+		if (cis[0] == cis[1] || cis[0] == cis[2] || cis[1] == cis[2])
+			return;
+		unsigned int ois[3] = { cells[cis[0]].output_index, cells[cis[1]].output_index, cells[cis[2]].output_index };
+		std::array<unsigned int, 3> t = { ois[0], ois[1], ois[2] };
+		std::sort(t.begin(), t.end());
+		if (!triangles.insert(t).second)
+			return;
+		output.new_triangle(ois[0], ois[1], ois[2]);
+		if (triangles.size() >= triangle_purge_size) {
+			// triangles with a dropped vertex cannot be generated again
+			unsigned int output_off = output.get_nr_dropped_vertices();
+			for (auto iter = triangles.begin(); iter != triangles.end(); )
+				if ((*iter)[0] < output_off)
+					iter = triangles.erase(iter);
+				else
+					++iter;
+			triangle_purge_size = std::max(size_t(1024), 2 * triangles.size());
+		}
+	}
+public:
+	/// construct with source mesh, cell size and output handler
+	streaming_clustering_stage(const streaming_mesh<T>* _source = 0, T _cell_size = T(1), streaming_mesh_callback_handler* output_handler = 0) :
+		source(_source), output(output_handler), origin(0, 0, 0), cell_size(_cell_size), finalization_delay(0), nr_dropped(0), triangle_purge_size(1024) {}
+	/// set the streaming mesh providing the input vertices
+	void set_source(const streaming_mesh<T>* _source) { source = _source; }
+	/// set grid of cells with given origin and cell size, must be called before streaming starts
+	void set_grid(const pnt_type& _origin, T _cell_size) { origin = _origin; cell_size = _cell_size; }
+	/// return the cell size
+	T get_cell_size() const { return cell_size; }
+	/// set number of dropped input vertices to wait before an unreferenced cell is finalized, which defaults to 0
+	void set_finalization_delay(unsigned int n) { finalization_delay = n; }
+	/// return finalization delay
+	unsigned int get_finalization_delay() const { return finalization_delay; }
+	/// return the number of currently open cells
+	size_t get_nr_open_cells() const { return cell_index.size(); }
+	/// access to the output mesh, whose callback handler receives the decimated stream
+	streaming_mesh<T>& get_output() { return output; }
+	/// map vertex to its cell and open the cell if necessary
+	void new_vertex(unsigned int vertex_index) {
+		uint64_t key = compute_key(source->vertex_location(vertex_index));
+		auto iter = cell_index.find(key);
+		unsigned int ci;
+		if (iter == cell_index.end()) {
+			if (free_cells.empty()) {
+				ci = (unsigned int)cells.size();
+				cells.push_back(cell_type());
+			}
+			else {
+				ci = free_cells.back();
+				free_cells.pop_back();
+			}
+			cell_type& c = cells[ci];
+			std::fill(c.A, c.A + 6, 0.0);
+			std::fill(c.b, c.b + 3, 0.0);
+			std::fill(c.sum, c.sum + 3, 0.0);
+			c.c = 0;
+			c.key = key;
+			c.nr_vertices = c.nr_live_vertices = 0;
+			c.release_stamp = unsigned(-1);
+			cell_index[key] = ci;
+			output_finalized.push_back(false);
+			c.output_index = output.new_vertex(source->vertex_location(vertex_index));
+		}
+		else
+			ci = iter->second;
+		cell_type& c = cells[ci];
+		const pnt_type& p = source->vertex_location(vertex_index);
+		for (unsigned int i = 0; i < 3; ++i)
+			c.sum[i] += p(i);
+		++c.nr_vertices;
+		++c.nr_live_vertices;
+		vertex_cells.push_back(ci);
+	}
+	/// accumulate quadrics and emit the triangles of a fan triangulation of the polygon
+	void new_polygon(const std::vector<unsigned int>& vertex_indices) {
+		for (size_t i = 2; i < vertex_indices.size(); ++i)
+			process_triangle(vertex_indices[0], vertex_indices[i - 1], vertex_indices[i]);
+	}
+	/// release cell if its last vertex is dropped and finalize cells whose delay has passed
+	void before_drop_vertex(unsigned int vertex_index) {
+		unsigned int ci = vertex_cells.front();
+		vertex_cells.pop_front();
+		++nr_dropped;
+		if (--cells[ci].nr_live_vertices == 0) {
+			cells[ci].release_stamp = nr_dropped;
+			released_cells.push_back(std::make_pair(ci, nr_dropped));
+		}
+		finalize_released_cells(false);
+	}
+	/// finalize all cells and finish the output stream
+	void finish() {
+		finalize_released_cells(true);
+		output.finish();
+		triangles.clear();
+		triangle_purge_size = 1024;
+	}
+};
+
+		}
+	}
+}
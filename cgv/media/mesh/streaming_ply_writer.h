@@ -0,0 +1,193 @@
+#pragma once
+
+#include "streaming_mesh.h"
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+
+namespace cgv {
+	namespace media {
+		namespace mesh {
+
+/** streaming mesh stage that writes a binary little endian ply file without keeping the mesh in memory. Vertices are
+    written when they are dropped from the streaming mesh, such that locations and normals computed by previous stages
+	are final. Faces are written to a temporary face file, which is appended to the vertex data in close(), where also
+	the element counts in the fixed width header are patched. All callbacks are forwarded to the next handler. */
+template <typename T>
+class streaming_ply_writer : public streaming_mesh_stage
+{
+protected:
+	/// streaming mesh providing the vertex data
+	const streaming_mesh<T>* source;
+	/// file pointers of ply file and temporary face file
+	FILE* fp, *face_fp;
+	/// file names of ply file and temporary face file
+	std::string file_name, face_file_name;
+	/// whether to write vertex normals
+	bool write_normals;
+	/// global index of the first written vertex
+	unsigned int vertex_offset;
+	/// number of written vertices and faces
+	unsigned int nr_vertices, nr_faces;
+	/// whether all writes succeeded
+	bool success;
+	/// write buffers of vertices and faces
+	std::vector<char> vertex_buffer, face_buffer;
+	/// flush buffer to file
+	void flush(FILE* f, std::vector<char>& buffer) {
+		if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), f) != buffer.size())
+			success = false;
+		buffer.clear();
+	}
+	/// check whether host stores values in little endian byte order
+	static bool is_little_endian_host() {
+		const uint16_t one = 1;
+		return *reinterpret_cast<const uint8_t*>(&one) == 1;
+	}
+	/// append value to buffer in little endian byte order, swapping bytes on big endian hosts
+	template <typename S>
+	static void append(std::vector<char>& buffer, const S& value) {
+		size_t pos = buffer.size();
+		buffer.resize(pos + sizeof(S));
+		std::memcpy(&buffer[pos], &value, sizeof(S));
+		if (!is_little_endian_host())
+			std::reverse(buffer.begin() + pos, buffer.end());
+	}
+	/// construct header with fixed width element counts
+	std::string header() const {
+		char counts[2][16];
+		snprintf(counts[0], 16, "%010u", nr_vertices);
+		snprintf(counts[1], 16, "%010u", nr_faces);
+		std::string h = "ply\nformat binary_little_endian 1.0\nelement vertex ";
+		h += counts[0];
+		h += "\nproperty float x\nproperty float y\nproperty float z\n";
+		if (write_normals)
+			h += "property float nx\nproperty float ny\nproperty float nz\n";
+		h += "element face ";
+		h += counts[1];
+		h += "\nproperty list uchar int vertex_indices\nend_header\n";
+		return h;
+	}
+public:
+	/// size of write buffers in bytes
+	static const size_t buffer_size = size_t(1) << 20;
+	/// construct with source mesh and next handler
+	streaming_ply_writer(const streaming_mesh<T>* _source = 0, streaming_mesh_callback_handler* _next = 0) :
+		streaming_mesh_stage(_next), source(_source), fp(0), face_fp(0), write_normals(false),
+		vertex_offset(0), nr_vertices(0), nr_faces(0), success(true) {}
+	/// close file on destruction
+	~streaming_ply_writer() { close(); }
+	/// set the streaming mesh providing vertex locations and normals
+	void set_source(const streaming_mesh<T>* _source) { source = _source; }
+	/// open ply file, where vertices generated by the source before are not written
+	bool open(const std::string& _file_name, bool _write_normals = false) {
+		close();
+		if (!source) {
+			std::cerr << "streaming_ply_writer: no source set" << std::endl;
+			return false;
+		}
+		file_name = _file_name;
+		face_file_name = file_name + ".faces";
+		write_normals = _write_normals;
+		vertex_offset = source->get_nr_vertices();
+		nr_vertices = nr_faces = 0;
+		success = true;
+		fp = fopen(file_name.c_str(), "wb");
+		if (!fp) {
+			std::cerr << "streaming_ply_writer: could not open " << file_name << std::endl;
+			return false;
+		}
+		face_fp = fopen(face_file_name.c_str(), "w+b");
+		if (!face_fp) {
+			std::cerr << "streaming_ply_writer: could not open " << face_file_name << std::endl;
+			fclose(fp);
+			fp = 0;
+			return false;
+		}
+		std::string h = header();
+		success = fwrite(h.data(), 1, h.size(), fp) == h.size();
+		vertex_buffer.reserve(buffer_size + 64);
+		face_buffer.reserve(buffer_size + 64);
+		return success;
+	}
+	/// check whether a file is open
+	bool is_open() const { return fp != 0; }
+	/// return number of written vertices
+	unsigned int get_nr_vertices() const { return nr_vertices; }
+	/// return number of written faces
+	unsigned int get_nr_faces() const { return nr_faces; }
+	/// append faces to vertices, patch header and close file; returns false if no file was open or writing failed
+	bool close() {
+		if (!fp)
+			return false;
+		flush(fp, vertex_buffer);
+		flush(face_fp, face_buffer);
+		// append faces in blocks
+		std::vector<char> block(buffer_size);
+		rewind(face_fp);
+		size_t n;
+		while ((n = fread(block.data(), 1, block.size(), face_fp)) > 0)
+			if (fwrite(block.data(), 1, n, fp) != n) {
+				success = false;
+				break;
+			}
+		fclose(face_fp);
+		face_fp = 0;
+		remove(face_file_name.c_str());
+		// header has the same length with the final counts
+		std::string h = header();
+		if (fseek(fp, 0, SEEK_SET) != 0 || fwrite(h.data(), 1, h.size(), fp) != h.size())
+			success = false;
+		if (fclose(fp) != 0)
+			success = false;
+		fp = 0;
+		if (!success)
+			std::cerr << "streaming_ply_writer: could not write " << file_name << std::endl;
+		return success;
+	}
+	/// write face to temporary face file unless it references vertices generated before the file was opened
+	void new_polygon(const std::vector<unsigned int>& vertex_indices) {
+		bool valid = vertex_indices.size() < 256;
+		for (unsigned int vi : vertex_indices)
+			if (vi < vertex_offset)
+				valid = false;
+		if (fp && valid) {
+			append(face_buffer, uint8_t(vertex_indices.size()));
+			for (unsigned int vi : vertex_indices)
+				append(face_buffer, int32_t(vi - vertex_offset));
+			++nr_faces;
+			if (face_buffer.size() >= buffer_size)
+				flush(face_fp, face_buffer);
+		}
+		streaming_mesh_stage::new_polygon(vertex_indices);
+	}
+	/// write vertex after previous stages have finalized it and forward before it is dropped
+	void before_drop_vertex(unsigned int vertex_index) {
+		if (fp && vertex_index >= vertex_offset) {
+			const typename streaming_mesh<T>::pnt_type& p = source->vertex_location(vertex_index);
+			for (unsigned int i = 0; i < 3; ++i)
+				append(vertex_buffer, float(p(i)));
+			if (write_normals) {
+				const typename streaming_mesh<T>::vec_type& n = source->vertex_normal(vertex_index);
+				for (unsigned int i = 0; i < 3; ++i)
+					append(vertex_buffer, float(n(i)));
+			}
+			++nr_vertices;
+			if (vertex_buffer.size() >= buffer_size)
+				flush(fp, vertex_buffer);
+		}
+		streaming_mesh_stage::before_drop_vertex(vertex_index);
+	}
+	/// close file at the end of the stream and forward
+	void finish() {
+		close();
+		streaming_mesh_stage::finish();
+	}
+};
+
+		}
+	}
+}
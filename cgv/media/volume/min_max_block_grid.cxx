@@ -0,0 +1,123 @@
+#include "min_max_block_grid.h"
+#include <algorithm>
+#include <limits>
+#include <iostream>
+
+namespace cgv {
+	namespace media {
+		namespace volume {
+
+			min_max_block_grid::min_max_block_grid() : block_size(8), dims(0, 0, 0), nr_blocks(0, 0, 0)
+			{
+			}
+
+			void min_max_block_grid::clear()
+			{
+				dims = nr_blocks = dimension_type(0, 0, 0);
+				min_values.clear();
+				max_values.clear();
+				blocks_by_min.clear();
+			}
+
+			template <typename F>
+			void min_max_block_grid::compute_ranges(const F& value)
+			{
+				for (int c = 0; c < 3; ++c)
+					nr_blocks(c) = std::max(1, (dims(c) - 2) / int(block_size) + 1);
+				size_t n = size_t(nr_blocks(0))*nr_blocks(1)*nr_blocks(2);
+				min_values.assign(n, std::numeric_limits<float>::max());
+				max_values.assign(n, -std::numeric_limits<float>::max());
+				// every voxel contributes to the blocks whose cells it is a corner of
+				for (int k = 0; k < dims(2); ++k) {
+					int bz0 = std::max(0, k - 1) / int(block_size), bz1 = std::min(k / int(block_size), nr_blocks(2) - 1);
+					for (int j = 0; j < dims(1); ++j) {
+						int by0 = std::max(0, j - 1) / int(block_size), by1 = std::min(j / int(block_size), nr_blocks(1) - 1);
+						for (int i = 0; i < dims(0); ++i) {
+							int bx0 = std::max(0, i - 1) / int(block_size), bx1 = std::min(i / int(block_size), nr_blocks(0) - 1);
+							float v = value(i, j, k);
+							for (int bz = bz0; bz <= bz1; ++bz)
+								for (int by = by0; by <= by1; ++by)
+									for (int bx = bx0; bx <= bx1; ++bx) {
+										unsigned bi = get_block_index(bx, by, bz);
+										min_values[bi] = std::min(min_values[bi], v);
+										max_values[bi] = std::max(max_values[bi], v);
+									}
+						}
+					}
+				}
+				blocks_by_min.resize(n);
+				for (unsigned bi = 0; bi < n; ++bi)
+					blocks_by_min[bi] = bi;
+				std::sort(blocks_by_min.begin(), blocks_by_min.end(), [this](unsigned bi, unsigned bj) { return min_values[bi] < min_values[bj]; });
+			}
+
+			template <typename T>
+			struct typed_voxel_accessor
+			{
+				const volume& V;
+				unsigned ci;
+				typed_voxel_accessor(const volume& _V, unsigned _ci) : V(_V), ci(_ci) {}
+				float operator () (int i, int j, int k) const { return float(V.get_voxel_ptr<T>(i, j, k)[ci]); }
+			};
+
+			struct generic_voxel_accessor
+			{
+				const volume& V;
+				unsigned ci;
+				generic_voxel_accessor(const volume& _V, unsigned _ci) : V(_V), ci(_ci) {}
+				float operator () (int i, int j, int k) const { return V.get_format().get<float>(ci, V.get_voxel_ptr<cgv::type::uint8_type>(i, j, k)); }
+			};
+
+			bool min_max_block_grid::build(const volume& V, unsigned _block_size, unsigned component_index)
+			{
+				clear();
+				if (V.empty()) {
+					std::cerr << "min_max_block_grid::build: volume is empty" << std::endl;
+					return false;
+				}
+				if (component_index >= V.get_nr_components()) {
+					std::cerr << "min_max_block_grid::build: volume has no component " << component_index << std::endl;
+					return false;
+				}
+				block_size = std::max(1u, _block_size);
+				dims = V.get_dimensions();
+				switch (V.get_component_type()) {
+				case cgv::type::info::TI_INT8:    compute_ranges(typed_voxel_accessor<cgv::type::int8_type>(V, component_index)); break;
+				case cgv::type::info::TI_INT16:   compute_ranges(typed_voxel_accessor<cgv::type::int16_type>(V, component_index)); break;
+				case cgv::type::info::TI_INT32:   compute_ranges(typed_voxel_accessor<cgv::type::int32_type>(V, component_index)); break;
+				case cgv::type::info::TI_UINT8:   compute_ranges(typed_voxel_accessor<cgv::type::uint8_type>(V, component_index)); break;
+				case cgv::type::info::TI_UINT16:  compute_ranges(typed_voxel_accessor<cgv::type::uint16_type>(V, component_index)); break;
+				case cgv::type::info::TI_UINT32:  compute_ranges(typed_voxel_accessor<cgv::type::uint32_type>(V, component_index)); break;
+				case cgv::type::info::TI_FLT32:   compute_ranges(typed_voxel_accessor<cgv::type::flt32_type>(V, component_index)); break;
+				case cgv::type::info::TI_FLT64:   compute_ranges(typed_voxel_accessor<cgv::type::flt64_type>(V, component_index)); break;
+				default:                          compute_ranges(generic_voxel_accessor(V, component_index)); break;
+				}
+				return true;
+			}
+
+			void min_max_block_grid::build(const float* values, const dimension_type& _dims, unsigned _block_size)
+			{
+				clear();
+				block_size = std::max(1u, _block_size);
+				dims = _dims;
+				size_t nx = dims(0), nxy = size_t(dims(0))*dims(1);
+				compute_ranges([values, nx, nxy](int i, int j, int k) { return values[i + nx*j + nxy*k]; });
+			}
+
+			size_t min_max_block_grid::compute_active_blocks(float iso_value, std::vector<bool>& active) const
+			{
+				active.assign(min_values.size(), false);
+				size_t nr_active = 0;
+				for (unsigned bi : blocks_by_min) {
+					if (min_values[bi] > iso_value)
+						break;
+					if (max_values[bi] > iso_value) {
+						active[bi] = true;
+						++nr_active;
+					}
+				}
+				return nr_active;
+			}
+		}
+	}
+}
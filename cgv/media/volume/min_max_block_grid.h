@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include "volume.h"
+
+#include "../lib_begin.h"
+
+namespace cgv {
+	namespace media {
+		namespace volume {
+
+			/** grid of value ranges over blocks of cells of a volume, where a cell is spanned by 2x2x2 voxels. Block (bx,by,bz)
+			    covers the voxels with indices in [b*block_size, b*block_size+block_size] per dimension, such that neighboring blocks
+				share one layer of voxels. Iso-surface extractors use the grid to skip blocks that cannot intersect the iso-surface.
+				The grid is built once per volume and can be queried for arbitrary iso-values. */
+			class CGV_API min_max_block_grid
+			{
+			public:
+				typedef volume::dimension_type dimension_type;
+			protected:
+				/// number of cells per block edge
+				unsigned block_size;
+				/// number of voxels of the volume
+				dimension_type dims;
+				/// number of blocks per dimension
+				dimension_type nr_blocks;
+				/// per block minimum and maximum value
+				std::vector<float> min_values, max_values;
+				/// block indices sorted by increasing minimum value
+				std::vector<unsigned> blocks_by_min;
+				/// compute value ranges from the given accessor to voxel values
+				template <typename F>
+				void compute_ranges(const F& value);
+			public:
+				/// construct empty grid
+				min_max_block_grid();
+				/// deallocate all memory
+				void clear();
+				/// check whether grid has been built
+				bool empty() const { return min_values.empty(); }
+				/// build from the given component of a volume and return false if volume has no three dimensional data
+				bool build(const volume& V, unsigned block_size = 8, unsigned component_index = 0);
+				/// build from float values of dimensions dims stored with x varying fastest
+				void build(const float* values, const dimension_type& dims, unsigned block_size = 8);
+				/// return the number of cells per block edge
+				unsigned get_block_size() const { return block_size; }
+				/// return the number of voxels per dimension of the volume the grid has been built for
+				const dimension_type& get_dimensions() const { return dims; }
+				/// return the number of blocks per dimension
+				const dimension_type& get_nr_blocks() const { return nr_blocks; }
+				/// return the linear index of a block
+				unsigned get_block_index(int bx, int by, int bz) const { return unsigned(bx + nr_blocks(0)*(by + nr_blocks(1)*bz)); }
+				/// return minimum value of a block
+				float get_min_value(unsigned block_index) const { return min_values[block_index]; }
+				/// return maximum value of a block
+				float get_max_value(unsigned block_index) const { return max_values[block_index]; }
+				/// check whether a block contains values on both sides of the iso-value, where values above iso_value are considered inside
+				bool is_block_active(unsigned block_index, float iso_value) const { return min_values[block_index] <= iso_value && max_values[block_index] > iso_value; }
+				/// set the flags of all blocks that intersect the iso-surface and return their number, only blocks with minimum value up to iso_value are visited
+				size_t compute_active_blocks(float iso_value, std::vector<bool>& active) const;
+			};
+		}
+	}
+}
+
+#include <cgv/config/lib_end.h>
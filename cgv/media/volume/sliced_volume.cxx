@@ -4,6 +4,7 @@
 #include <fstream>
 #include <stdio.h>
 #include <cgv/utils/file.h>
+#include <cgv/utils/mapped_file.h>
 #include <cgv/utils/scan.h>
 #include <cgv/utils/convert_string.h>
 #include <cgv/utils/tokenizer.h>
@@ -118,22 +119,23 @@ namespace cgv {
 
 				// detect special case for binary files
 				if (cgv::utils::file::get_extension(file_name).empty()) {
-					size_t file_size = cgv::utils::file::size(file_name);
+					// map the file such that only the data at its end is read
+					cgv::utils::mapped_file content;
+					if (!content.open(file_name)) {
+						std::cerr << "could not read slice file " << file_name << "." << std::endl;
+						return false;
+					}
+					size_t file_size = content.get_size();
 					size_t data_size = df.get_nr_bytes();
 					if (data_size > file_size) {
 						std::cerr << "slice file " << file_name << " too small: only contains " << file_size << " bytes, but " << df.get_nr_bytes() << " bytes needed." << std::endl;
 						return false;
 					}
-					char* content = cgv::utils::file::read(file_name);
-					if (!content) {
-						std::cerr << "could not read slice file " << file_name << "." << std::endl;
-						return false;
-					}
 					size_t offset = file_size - data_size;
+					content.advise(cgv::utils::mapped_file::AH_SEQUENTIAL, offset, data_size);
 					if (dv.empty())
 						new(&dv) data_view(&df);
-					std::copy(content + offset, content + file_size, dv.get_ptr<char>());
-					delete[] content;
+					std::copy(content.begin() + offset, content.end(), dv.get_ptr<char>());
 					return true;
 				}
 				else {
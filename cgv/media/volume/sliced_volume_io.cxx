@@ -5,6 +5,7 @@
 #include "sliced_volume_io.h"
 #include <cgv/utils/scan.h>
 #include <cgv/utils/file.h>
+#include <cgv/utils/async_io.h>
 #include <cgv/utils/progression.h>
 #include <cgv/utils/advanced_scan.h>
 #include <cgv/utils/dir.h>
@@ -334,36 +335,67 @@ namespace cgv {
 				std::size_t slize_size = V.get_voxel_size() * V.get_format().get_width() * V.get_format().get_height();
 				cgv::type::uint8_type* dst_ptr = V.get_data_ptr<cgv::type::uint8_type>();
 
-				for (int i = 0; i < (int)dims(2); ++i) {
-					switch (st) {
-					case ST_INDEX:
-						if (!svol.read_slice(i)) {
-							std::cerr << "could not read slice " << i << " with filename \"" << svol.get_slice_file_name(i) << "\"." << std::endl;
-							return false;
+				if (st != ST_VIDEO) {
+					// file name of i-th slice or empty string if there are not enough matching files
+					auto slice_file_name = [&](int i) -> std::string {
+						if (st == ST_INDEX)
+							return svol.get_slice_file_name(i);
+						unsigned j = i + svol.offset;
+						return j < slice_file_names.size() ? file_path + slice_file_names[j] : std::string();
+					};
+					cgv::utils::async_io io;
+					// raw slices store their data at the end of the file and are read directly into the volume
+					if (cgv::utils::file::get_extension(slice_file_name(0)).empty()) {
+						std::vector<cgv::utils::async_io::request> batch;
+						for (int i = 0; i < (int)dims(2); ++i) {
+							std::string slice_name = slice_file_name(i);
+							uint64_t file_size;
+							if (!cgv::utils::async_io::get_file_size(slice_name, file_size) || file_size < slize_size) {
+								std::cerr << "could not read slice " << i << " with filename \"" << slice_name << "\"." << std::endl;
+								return false;
+							}
+							batch.push_back(cgv::utils::async_io::request(slice_name, file_size - slize_size, slize_size, (char*)dst_ptr + i*slize_size));
 						}
-						break;
-					case ST_FILTER: {
-						int j = i + svol.offset;
-						if ((unsigned)j > slice_file_names.size()) {
-							std::cerr << "could not read slice " << i << " from with filename with index " << j << " as only " << slice_file_names.size() << " match pattern." << std::endl;
+						std::vector<std::future<cgv::utils::async_io::result> > results = io.read(batch);
+						bool success = true;
+						for (int i = 0; i < (int)dims(2); ++i)
+							if (!results[i].get().success) {
+								std::cerr << "could not read slice " << i << " with filename \"" << batch[i].file_name << "\"." << std::endl;
+								success = false;
+							}
+						svol.close();
+						return success;
+					}
+					// otherwise load the files of the next slices into the page cache while the current slice is decoded
+					int nr_read_ahead = std::min((int)dims(2), 2 * (int)io.get_nr_threads());
+					for (int i = 0; i < nr_read_ahead; ++i)
+						io.read_ahead(slice_file_name(i));
+					for (int i = 0; i < (int)dims(2); ++i) {
+						if (i + nr_read_ahead < (int)dims(2))
+							io.read_ahead(slice_file_name(i + nr_read_ahead));
+						std::string slice_name = slice_file_name(i);
+						if (slice_name.empty()) {
+							std::cerr << "could not read slice " << i << " from with filename with index " << i + svol.offset << " as only " << slice_file_names.size() << " match pattern." << std::endl;
 							return false;
 						}
-						if (!svol.read_slice(i, file_path + slice_file_names[j])) {
-							std::cerr << "could not read slice " << i << " from file \"" << slice_file_names[j] << "\"." << std::endl;
+						if (!svol.read_slice(i, slice_name)) {
+							std::cerr << "could not read slice " << i << " from file \"" << slice_name << "\"." << std::endl;
 							return false;
 						}
-						break;
+						const cgv::type::uint8_type* src_ptr = svol.get_data_ptr<cgv::type::uint8_type>();
+						std::copy(src_ptr, src_ptr + slize_size, dst_ptr);
+						dst_ptr += slize_size;
 					}
-					case ST_VIDEO:
-						if (!vr_ptr->read_frame(*dv_ptr)) {
-							std::cerr << "could not frame " << i << " from avi file \"" << svol.file_name_pattern << "\"." << std::endl;
-							return false;
-						}
-						break;
+					svol.close();
+					return true;
+				}
+
+				for (int i = 0; i < (int)dims(2); ++i) {
+					if (!vr_ptr->read_frame(*dv_ptr)) {
+						std::cerr << "could not frame " << i << " from avi file \"" << svol.file_name_pattern << "\"." << std::endl;
+						return false;
 					}
-					const cgv::type::uint8_type* src_ptr =
-						st == ST_VIDEO ? dv_ptr->get_ptr<cgv::type::uint8_type>() :
-						svol.get_data_ptr<cgv::type::uint8_type>();
+					const cgv::type::uint8_type* src_ptr = dv_ptr->get_ptr<cgv::type::uint8_type>();
 					std::copy(src_ptr, src_ptr + slize_size, dst_ptr);
 					dst_ptr += slize_size;
 				}
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <stdio.h>
 #include <cgv/utils/file.h>
+#include <cgv/utils/async_io.h>
 #include <cgv/utils/scan.h>
 #include <cgv/utils/tokenizer.h>
 #include <cgv/media/image/image_reader.h>
@@ -342,28 +343,21 @@ namespace cgv {
 				if (V.get_extent() != info.extent)
 					V.ref_extent() = info.extent;
 
-				// open file and jump to offset
-				FILE* fp = fopen(file_name.c_str(), "rb");
-				if (!fp) {
+				uint64_t file_size;
+				if (!cgv::utils::async_io::get_file_size(file_name, file_size)) {
 					std::cerr << "cannot open file " << file_name << std::endl;
 					return false;
 				}
-				if (offset > 0) {
-					fseek(fp, (long)offset, SEEK_SET);
-				}
 
-				// read data
+				// read data in pieces that are loaded concurrently
 				std::size_t n = V.get_nr_voxels();
 				unsigned N = V.get_voxel_size();
-				std::size_t nr = fread(V.get_data_ptr<unsigned char>(), N, n, fp);
-				if (nr != n) {
-					std::cerr << "could not read the expected number " << n << " of voxels but only " << nr << std::endl;
-					fclose(fp);
+				cgv::utils::async_io io;
+				cgv::utils::async_io::result r = io.read(cgv::utils::async_io::request(file_name, offset, n*N, V.get_data_ptr<char>())).get();
+				if (!r.success) {
+					std::cerr << "could not read the expected number " << n << " of voxels but only " << r.nr_bytes_read / N << std::endl;
 					return false;
 				}
-
-				// close and return success
-				fclose(fp);
 				return true;
 			}
 
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <map>
+#include <functional>
 
 namespace cgv {
 	namespace os {
@@ -32,11 +33,15 @@ struct http_request
 	std::string accept_language;
 	std::string accept_encoding;
 	std::string user_agent;
+	/// all header fields with lower case names
+	std::map<std::string, std::string> headers;
+	/// content of the request, which is only filled by servers that support POST data
+	std::string body;
 
 	/**@name return values*/
 	//@{
 	/** status: used to transmit server's error status, such as
-	 - 202 OK (this is set by default)
+	 - 200 OK (this is set by default)
 	 -  404 Not Found 
 	 and so on. */
 	std::string status;
@@ -45,6 +50,18 @@ struct http_request
 	std::string auth_realm;
 	/// set this member to the html page to be returned
 	std::string answer;
+	/// content type of the answer, where an empty string selects html
+	std::string content_type;
+	/// if not empty, the content of this file is sent instead of the answer
+	std::string answer_file_name;
+	/** if set, the answer is sent in chunks, where the function is called to fill the next chunk until it returns
+	    false. It is called from the thread serving the request after the handler has returned. */
+	std::function<bool(std::string&)> answer_stream;
+	/// whether the connection is kept open after the answer, which is initialized from the request
+	bool keep_alive;
+	//@}
+	/// construct with default values
+	http_request() : authentication_given(false), status("200 OK"), keep_alive(false) {}
 };
 
 	}
@@ -0,0 +1,422 @@
+#include "http_server.h"
+#include <cgv/utils/file.h>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <ctime>
+#include <cctype>
+#include <cstdlib>
+
+namespace cgv {
+	namespace os {
+
+namespace {
+	/// remove trailing carriage return and newline
+	void strip_line_end(std::string& line)
+	{
+		while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+			line.pop_back();
+	}
+	/// return lower case version of string
+	std::string to_lower(std::string s)
+	{
+		for (auto& c : s)
+			c = char(tolower((unsigned char)c));
+		return s;
+	}
+	/// decode percent encoded characters and plus signs of url components
+	std::string decode_url(const std::string& s)
+	{
+		std::string result;
+		result.reserve(s.size());
+		for (size_t i = 0; i < s.size(); ++i) {
+			if (s[i] == '+')
+				result += ' ';
+			else if (s[i] == '%' && i + 2 < s.size() && isxdigit((unsigned char)s[i + 1]) && isxdigit((unsigned char)s[i + 2])) {
+				result += char(strtol(s.substr(i + 1, 2).c_str(), 0, 16));
+				i += 2;
+			}
+			else
+				result += s[i];
+		}
+		return result;
+	}
+	/// split target of request line into path and parameters
+	void split_target(const std::string& target, std::string& path, std::map<std::string, std::string>& params)
+	{
+		size_t pos = target.find('?');
+		path = decode_url(target.substr(0, pos));
+		while (pos != std::string::npos) {
+			size_t end = target.find('&', pos + 1);
+			std::string param = target.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+			size_t eq = param.find('=');
+			if (!param.empty())
+				params[decode_url(param.substr(0, eq))] = eq == std::string::npos ? std::string() : decode_url(param.substr(eq + 1));
+			pos = end;
+		}
+	}
+	/// decode base64 encoded credentials of basic authentication
+	std::string decode_base64(const std::string& s)
+	{
+		static const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		std::string result;
+		unsigned value = 0;
+		int nr_bits = 0;
+		for (char c : s) {
+			size_t i = alphabet.find(c);
+			if (i == std::string::npos)
+				break;
+			value = (value << 6) | unsigned(i);
+			nr_bits += 6;
+			if (nr_bits >= 8) {
+				nr_bits -= 8;
+				result += char((value >> nr_bits) & 255);
+			}
+		}
+		return result;
+	}
+	/// return current time formatted for the date header field
+	std::string get_http_date()
+	{
+		time_t now = time(0);
+		tm gmt;
+#ifdef WIN32
+		gmtime_s(&gmt, &now);
+#else
+		gmtime_r(&now, &gmt);
+#endif
+		char buffer[64];
+		strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+		return buffer;
+	}
+	/// maximum size of request line and header fields
+	const size_t max_header_size = 65536;
+}
+
+http_server::http_server(const request_handler& _handler, unsigned _nr_worker_threads) :
+	handler(_handler), port(0), nr_worker_threads(_nr_worker_threads), max_body_size(size_t(64) << 20), receive_timeout(30000), wake_up_sent(false), stop_request(false), running(false), nr_served_requests(0)
+{
+	if (nr_worker_threads == 0)
+		nr_worker_threads = std::max(std::thread::hardware_concurrency(), 2u);
+}
+
+http_server::~http_server()
+{
+	stop();
+}
+
+bool http_server::listen(unsigned _port, int max_nr_pending_connections)
+{
+	port = _port;
+	server = create_socket_server();
+	if (!server->bind_and_listen(int(port), max_nr_pending_connections)) {
+		std::cerr << "http_server: could not listen to port " << port << ": " << server->get_last_error() << std::endl;
+		server.clear();
+		return false;
+	}
+	// private socket pair for waking up the event loop, which clients connecting to the port cannot take over
+	if (!create_socket_pair(wake_up_sender, wake_up_receiver)) {
+		std::cerr << "http_server: could not create wake up connection" << std::endl;
+		server.clear();
+		return false;
+	}
+	return true;
+}
+
+void http_server::wake_up()
+{
+	if (wake_up_sent)
+		return;
+	wake_up_sent = true;
+	wake_up_sender->send_data("w", 1);
+}
+
+void http_server::run()
+{
+	if (server.empty()) {
+		std::cerr << "http_server: run called without successful listen" << std::endl;
+		return;
+	}
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (running)
+			return;
+		// stop has been called before run
+		if (stop_request) {
+			stop_request = false;
+			server->close();
+			server.clear();
+			wake_up_sender.clear();
+			wake_up_receiver.clear();
+			return;
+		}
+		running = true;
+	}
+	for (unsigned i = 0; i < nr_worker_threads; ++i)
+		workers.push_back(std::thread(&http_server::worker_loop, this));
+
+	socket_select select;
+	select.add(server);
+	select.add(wake_up_receiver);
+	std::vector<socket_select::event> events;
+	char wake_up_bytes[16];
+	while (true) {
+		if (select.wait(events) < 0) {
+			std::cerr << "http_server: " << select.get_last_error() << std::endl;
+			break;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		for (const auto& e : events) {
+			if (e.s == server) {
+				// accept all pending connections
+				while (true) {
+					socket_ptr c = server->check_for_connection();
+					if (c.empty())
+						break;
+					c->set_blocking(true);
+					c->set_no_delay(true);
+					c->set_receive_timeout(receive_timeout);
+					select.add(c);
+				}
+			}
+			else if (e.s == wake_up_receiver) {
+				wake_up_receiver->receive_available(wake_up_bytes, sizeof(wake_up_bytes));
+				wake_up_sent = false;
+			}
+			else {
+				// workers own connections while serving them
+				select.remove(e.s);
+				pending_connections.push_back(e.s);
+				worker_condition.notify_one();
+			}
+		}
+		if (stop_request)
+			break;
+		for (auto& c : returned_connections)
+			select.add(c);
+		returned_connections.clear();
+	}
+
+	// finish requests in progress and close all connections
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stop_request = true;
+		worker_condition.notify_all();
+	}
+	for (auto& w : workers)
+		w.join();
+	workers.clear();
+	pending_connections.clear();
+	returned_connections.clear();
+	select.remove(server);
+	server->close();
+	server.clear();
+	wake_up_sender->close();
+	wake_up_receiver->close();
+	wake_up_sender.clear();
+	wake_up_receiver.clear();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	running = false;
+	stop_request = false;
+	stop_condition.notify_all();
+}
+
+void http_server::stop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	stop_request = true;
+	if (!running)
+		return;
+	// workers waiting for slow clients return instead of waiting for the receive timeout
+	for (auto& s : served_connections)
+		s->shutdown_receiving();
+	wake_up();
+	stop_condition.wait(lock, [this]() { return !running; });
+}
+
+bool http_server::is_running()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return running;
+}
+
+void http_server::worker_loop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		worker_condition.wait(lock, [this]() { return stop_request || !pending_connections.empty(); });
+		if (stop_request)
+			break;
+		socket_ptr s = pending_connections.front();
+		pending_connections.pop_front();
+		served_connections.push_back(s);
+		lock.unlock();
+		// answer pipelined requests that have already been received before handing back the connection
+		bool keep_open;
+		do
+			keep_open = serve_request(*s);
+		while (keep_open && s->is_data_pending());
+		lock.lock();
+		served_connections.erase(std::find(served_connections.begin(), served_connections.end(), s));
+		if (!keep_open)
+			s->close();
+		else {
+			returned_connections.push_back(s);
+			wake_up();
+		}
+	}
+}
+
+bool http_server::serve_request(socket& s)
+{
+	http_request request;
+	std::string line;
+	// skip empty lines preceding the request line
+	do {
+		if (!s.receive_line(line))
+			return false;
+		request.request += line;
+		strip_line_end(line);
+	} while (line.empty() && request.request.size() < max_header_size);
+
+	std::istringstream is(line);
+	std::string target, version;
+	is >> request.method >> target >> version;
+	if (request.method.empty() || target.empty() || version.compare(0, 5, "HTTP/") != 0) {
+		request.status = "400 Bad Request";
+		request.answer = "malformed request line";
+		send_answer(s, request);
+		return false;
+	}
+	split_target(target, request.path, request.params);
+
+	// read header fields
+	while (true) {
+		if (request.request.size() > max_header_size) {
+			request.status = "431 Request Header Fields Too Large";
+			send_answer(s, request);
+			return false;
+		}
+		if (!s.receive_line(line))
+			return false;
+		request.request += line;
+		strip_line_end(line);
+		if (line.empty())
+			break;
+		size_t colon = line.find(':');
+		if (colon == std::string::npos)
+			continue;
+		std::string name = to_lower(line.substr(0, colon));
+		size_t value_begin = line.find_first_not_of(" \t", colon + 1);
+		std::string value = value_begin == std::string::npos ? std::string() : line.substr(value_begin);
+		if (name == "authorization" && to_lower(value.substr(0, 6)) == "basic ") {
+			std::string decoded = decode_base64(value.substr(6));
+			size_t pos_colon = decoded.find(':');
+			request.authentication_given = true;
+			request.username = decoded.substr(0, pos_colon);
+			request.password = pos_colon == std::string::npos ? std::string() : decoded.substr(pos_colon + 1);
+		}
+		else if (name == "accept")
+			request.accept = value;
+		else if (name == "accept-language")
+			request.accept_language = value;
+		else if (name == "accept-encoding")
+			request.accept_encoding = value;
+		else if (name == "user-agent")
+			request.user_agent = value;
+		request.headers[name] = value;
+	}
+	std::string connection = to_lower(request.headers["connection"]);
+	request.keep_alive = version == "HTTP/1.0" ? connection == "keep-alive" : connection != "close";
+
+	// read body of known length
+	auto iter = request.headers.find("content-length");
+	if (iter != request.headers.end()) {
+		char* end = 0;
+		unsigned long long content_length = strtoull(iter->second.c_str(), &end, 10);
+		if (end == iter->second.c_str() || iter->second[0] == '-') {
+			request.status = "400 Bad Request";
+			request.answer = "malformed content length";
+			request.keep_alive = false;
+			send_answer(s, request);
+			return false;
+		}
+		// reject large bodies before allocating memory for them
+		if (content_length > max_body_size) {
+			request.status = "413 Payload Too Large";
+			request.keep_alive = false;
+			send_answer(s, request);
+			return false;
+		}
+		if (content_length > 0) {
+			request.body.resize(size_t(content_length));
+			if (!s.receive_data(&request.body[0], request.body.size()))
+				return false;
+		}
+	}
+	else if (request.headers.find("transfer-encoding") != request.headers.end()) {
+		request.status = "411 Length Required";
+		request.keep_alive = false;
+		send_answer(s, request);
+		return false;
+	}
+	handler(request);
+	++nr_served_requests;
+	return send_answer(s, request) && request.keep_alive;
+}
+
+bool http_server::send_answer(socket& s, const http_request& request)
+{
+	std::ostringstream header;
+	bool send_file = !request.answer_file_name.empty() && !request.answer_stream;
+	uint64_t file_size = 0;
+	std::string status = request.auth_realm.empty() ? request.status : "401 Unauthorized";
+	if (send_file && !cgv::utils::file::exists(request.answer_file_name)) {
+		send_file = false;
+		status = "404 Not Found";
+	}
+	if (send_file)
+		file_size = cgv::utils::file::size(request.answer_file_name);
+	header << "HTTP/1.1 " << status << "\r\n";
+	if (!request.auth_realm.empty())
+		header << "WWW-Authenticate: Basic realm=\"" << request.auth_realm << "\"\r\n";
+	header << "Date: " << get_http_date() << "\r\n";
+	header << "Server: cgv web server\r\n";
+	header << "Connection: " << (request.keep_alive ? "keep-alive" : "close") << "\r\n";
+	header << "Content-Type: " << (request.content_type.empty() ? "text/html; charset=ISO-8859-1" : request.content_type) << "\r\n";
+	bool send_body = request.method != "HEAD";
+	if (request.answer_stream) {
+		header << "Transfer-Encoding: chunked\r\n\r\n";
+		if (!s.send_data(header.str()))
+			return false;
+		if (!send_body)
+			return true;
+		std::string chunk;
+		bool more;
+		do {
+			chunk.clear();
+			more = request.answer_stream(chunk);
+			if (chunk.empty())
+				continue;
+			std::ostringstream chunk_header;
+			chunk_header << std::hex << chunk.size() << "\r\n";
+			std::string chunk_header_str = chunk_header.str();
+			socket::buffer buffers[3] = { socket::buffer(chunk_header_str.data(), chunk_header_str.size()), socket::buffer(chunk.data(), chunk.size()), socket::buffer("\r\n", 2) };
+			if (!s.send_data(buffers, 3))
+				return false;
+		} while (more);
+		return s.send_data("0\r\n\r\n", 5);
+	}
+	static const std::string not_found = "file not found";
+	const std::string& answer = !send_file && !request.answer_file_name.empty() ? not_found : request.answer;
+	header << "Content-Length: " << (send_file ? file_size : answer.size()) << "\r\n\r\n";
+	std::string header_str = header.str();
+	if (send_file)
+		return s.send_data(header_str) && (!send_body || s.send_file(request.answer_file_name, 0, size_t(file_size)));
+	socket::buffer buffers[2] = { socket::buffer(header_str.data(), header_str.size()), socket::buffer(answer.data(), send_body ? answer.size() : 0) };
+	return s.send_data(buffers, 2);
+}
+
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "socket.h"
+#include "http_request.h"
+
+#include "lib_begin.h"
+
+namespace cgv {
+	namespace os {
+
+/** event driven http/1.1 server. One thread runs the event loop on a socket_select (epoll on linux), which accepts
+    connections and dispatches connections with incoming requests to a pool of worker threads. Workers parse the
+	request, call the request handler and send the answer as a single gathering write, as chunks produced by the
+	answer stream or as file with sendfile. Connections are kept alive and handed back to the event loop after the
+	answer has been sent, such that idle clients do not occupy workers. */
+class CGV_API http_server
+{
+public:
+	/// type of function that fills the answer of a request and is called from the worker threads
+	typedef std::function<void(http_request&)> request_handler;
+protected:
+	request_handler handler;
+	unsigned port;
+	unsigned nr_worker_threads;
+	size_t max_body_size;
+	int receive_timeout;
+	socket_server_ptr server;
+	/// connected sockets with which workers and stop wake up the event loop
+	socket_ptr wake_up_sender, wake_up_receiver;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable worker_condition, stop_condition;
+	/// connections with incoming requests that wait for a worker
+	std::deque<socket_ptr> pending_connections;
+	/// connections that are kept alive after their requests have been answered
+	std::deque<socket_ptr> returned_connections;
+	/// connections that are currently served by workers
+	std::vector<socket_ptr> served_connections;
+	bool wake_up_sent;
+	bool stop_request;
+	bool running;
+	std::atomic<size_t> nr_served_requests;
+	/// wake up event loop, must be called with locked mutex
+	void wake_up();
+	/// function of worker threads
+	void worker_loop();
+	/// receive and answer one request and return whether the connection stays open
+	bool serve_request(socket& s);
+	/// send status line, header fields and answer of request
+	bool send_answer(socket& s, const http_request& request);
+	/// no copies
+	http_server(const http_server&);
+	http_server& operator = (const http_server&);
+public:
+	/// construct server with given handler and number of worker threads, where 0 selects one per hardware thread
+	http_server(const request_handler& _handler, unsigned _nr_worker_threads = 0);
+	/// stop server
+	~http_server();
+	/// bind to port and listen, return false and print error on failure
+	bool listen(unsigned _port, int max_nr_pending_connections = 128);
+	/// run event loop until stop is called
+	void run();
+	/** stop event loop from a different thread than the workers and wait for it to return. Receiving is shut down on
+	    connections served by workers, such that stop does not wait for slow clients, while answers of requests in progress
+		are still sent. If the event loop is not running yet, the next call to run returns immediately. */
+	void stop();
+	/// return whether event loop is running
+	bool is_running();
+	/// return port passed to listen
+	unsigned get_port() const { return port; }
+	/// return number of worker threads
+	unsigned get_nr_worker_threads() const { return nr_worker_threads; }
+	/// set maximum size of request bodies in bytes, where larger requests are answered with 413 Payload Too Large (default 64 MB)
+	void set_max_body_size(size_t _max_body_size) { max_body_size = _max_body_size; }
+	/// return maximum size of request bodies
+	size_t get_max_body_size() const { return max_body_size; }
+	/// set time in milliseconds after which connections stalling within a request are closed, or -1 to wait forever (default 30 s), must be called before run
+	void set_receive_timeout(int milliseconds) { receive_timeout = milliseconds; }
+	/// return receive timeout of connections in milliseconds
+	int get_receive_timeout() const { return receive_timeout; }
+	/// return number of requests answered so far
+	size_t get_nr_served_requests() const { return nr_served_requests; }
+};
+
+	}
+}
+
+#include <cgv/config/lib_end.h>
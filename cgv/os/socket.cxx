@@ -6,13 +6,25 @@
 #include <netdb.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #include <string.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#endif
 #endif
 
 #include <algorithm>
+#include <climits>
+#include <cstdio>
+
 #include <iostream>
 #include "socket.h"
 #include "mutex.h"
@@ -26,6 +38,12 @@ typedef int SOCKET;
 
 #ifdef WIN32
 		typedef int socklen_t;
+#define poll WSAPoll
+#endif
+
+// avoid SIGPIPE on writes to closed connections where supported
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
 #endif
 
 
@@ -40,6 +58,42 @@ mutex& ref_show_mutex()
 	return sm;
 }
 
+/// size of the reads that fill receive buffers
+const size_t receive_chunk_size = 65536;
+/// maximum number of buffers passed to one scatter or gather call
+const size_t max_nr_transfer_buffers = 64;
+/// maximum number of bytes passed to one system call
+const size_t max_transfer_size = size_t(1) << 30;
+
+/// send or receive the given buffers with one scatter or gather call and return the number of transferred bytes or SOCKET_ERROR
+static long long transfer(SOCKET s, const socket::buffer* buffers, size_t nr_buffers, bool sending)
+{
+	nr_buffers = std::min(nr_buffers, max_nr_transfer_buffers);
+#ifdef WIN32
+	WSABUF wsa_buffers[max_nr_transfer_buffers];
+	for (size_t i = 0; i < nr_buffers; ++i) {
+		wsa_buffers[i].buf = buffers[i].data;
+		wsa_buffers[i].len = ULONG(std::min(buffers[i].size, max_transfer_size));
+	}
+	DWORD nr_bytes = 0, flags = 0;
+	int result = sending ?
+		WSASend(s, wsa_buffers, DWORD(nr_buffers), &nr_bytes, 0, 0, 0) :
+		WSARecv(s, wsa_buffers, DWORD(nr_buffers), &nr_bytes, &flags, 0, 0);
+	return result == 0 ? (long long)nr_bytes : SOCKET_ERROR;
+#else
+	iovec io_buffers[max_nr_transfer_buffers];
+	for (size_t i = 0; i < nr_buffers; ++i) {
+		io_buffers[i].iov_base = buffers[i].data;
+		io_buffers[i].iov_len = std::min(buffers[i].size, max_transfer_size);
+	}
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = io_buffers;
+	message.msg_iovlen = nr_buffers;
+	return sending ? sendmsg(s, &message, MSG_NOSIGNAL) : recvmsg(s, &message, 0);
+#endif
+}
+
 int socket::nr_of_sockets= 0;
 bool socket::show_debug_output = false;
 
@@ -90,22 +144,23 @@ void socket::end()
 
 }
 
-socket::socket() : user_data(0) 
+socket::socket() : user_data(0), receive_buffer_begin(0), receive_timeout(-1)
 {
 }
 
 /// construct from existing socket identifier
-socket::socket(size_t _id) : user_data(_id)
+socket::socket(size_t _id) : user_data(_id), receive_buffer_begin(0), receive_timeout(-1)
 {
 }
 
 bool socket::set_last_error(const char* location, const std::string& text) const
 {
 	if (text.empty()) {
-		char buffer[1024];
-		socklen_t len;
-		getsockopt(user_data, SOL_SOCKET, SO_ERROR, buffer, &len);
-		last_error = buffer;
+#ifdef WIN32
+		last_error = "error " + std::to_string(WSAGetLastError());
+#else
+		last_error = strerror(errno);
+#endif
 	}
 	else
 		last_error = text;
@@ -132,15 +187,76 @@ std::string socket::get_last_error() const
 	return last_error;
 }
 
+size_t socket::take_buffered_bytes(char* data, size_t size)
+{
+	size_t n = std::min(size, get_nr_buffered_bytes());
+	std::copy(receive_buffer.data() + receive_buffer_begin, receive_buffer.data() + receive_buffer_begin + n, data);
+	receive_buffer_begin += n;
+	if (receive_buffer_begin == receive_buffer.size()) {
+		receive_buffer.clear();
+		receive_buffer_begin = 0;
+	}
+	return n;
+}
+
+bool socket::would_block()
+{
+#ifdef WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+bool socket::wait_until_ready(bool for_sending) const
+{
+	pollfd p;
+	p.fd = (SOCKET)user_data;
+	p.events = for_sending ? POLLOUT : POLLIN;
+	p.revents = 0;
+	return poll(&p, 1, for_sending ? -1 : receive_timeout) == 1;
+}
+
+bool socket::transfer_buffers(std::vector<buffer>& pending, bool sending, const char* location)
+{
+	size_t first = 0;
+	while (true) {
+		while (first < pending.size() && pending[first].size == 0)
+			++first;
+		if (first == pending.size())
+			break;
+		// blocking reads would not return when the timeout expires
+		if (!sending && receive_timeout >= 0 && !wait_until_ready(false))
+			return set_last_error(location, "timeout");
+		long long n = transfer((SOCKET)user_data, &pending[first], pending.size() - first, sending);
+		if (n <= 0) {
+			if (n == SOCKET_ERROR && would_block() && wait_until_ready(sending))
+				continue;
+			return set_last_error(location, n == SOCKET_ERROR ? "" : "connection closed");
+		}
+		// advance over the transferred bytes
+		for (size_t i = first; n > 0; ++i) {
+			size_t m = std::min(size_t(n), pending[i].size);
+			pending[i].data += m;
+			pending[i].size -= m;
+			n -= m;
+		}
+	}
+	last_error.clear();
+	return true;
+}
+
 /// return whether data has arrived
 bool socket::is_data_pending() const
 {
-	fd_set set;
-	FD_ZERO(&set);
-	FD_SET(user_data, &set);
-	timeval t;
-	timerclear(&t);
-	return select(0, &set, 0, 0, &t) == 1;
+	if (get_nr_buffered_bytes() > 0)
+		return true;
+	// poll is not limited to descriptors below FD_SETSIZE, errors and hang ups are reported as pending such that receiving detects them
+	pollfd p;
+	p.fd = (SOCKET)user_data;
+	p.events = POLLIN;
+	p.revents = 0;
+	return poll(&p, 1, 0) == 1;
 }
 
 /// return the number of data bytes that have been arrived at the socket
@@ -150,91 +266,246 @@ int socket::get_nr_of_arrived_bytes() const
 		set_last_error("get_nr_of_arrived_bytes", "socket not connected");
 		return -1;
 	}
-	unsigned long arg;
 #ifdef WIN32
+	unsigned long arg;
 	if (ioctlsocket(user_data, FIONREAD, &arg) != 0) {
+#else
+	int arg;
+	if (ioctl(int(user_data), FIONREAD, &arg) != 0) {
+#endif
 		set_last_error("get_nr_of_arrived_bytes");
 		return -1;
 	}
 	last_error.clear();
+	return int(arg + get_nr_buffered_bytes());
+}
+
+bool socket::set_no_delay(bool no_delay)
+{
+	int value = no_delay ? 1 : 0;
+	if (setsockopt((SOCKET)user_data, IPPROTO_TCP, TCP_NODELAY, (const char*)&value, sizeof(value)) != 0)
+		return set_last_error("set_no_delay");
+	last_error.clear();
+	return true;
+}
+
+void socket::set_receive_timeout(int milliseconds)
+{
+	receive_timeout = milliseconds;
+}
+
+int socket::get_receive_timeout() const
+{
+	return receive_timeout;
+}
+
+bool socket::set_blocking(bool blocking)
+{
+#ifdef WIN32
+	u_long arg = blocking ? 0 : 1;
+	if (ioctlsocket(user_data, FIONBIO, &arg) != 0)
+		return set_last_error("set_blocking");
 #else
-	arg = -1;
-	std::cerr << "get_nr_of_arrived_bytes not implemented!!!" << std::endl;
+	int flags = fcntl(int(user_data), F_GETFL, 0);
+	if (flags == -1 || fcntl(int(user_data), F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) == -1)
+		return set_last_error("set_blocking");
 #endif
-	return arg;
+	last_error.clear();
+	return true;
 }
 
 std::string socket::receive_data(unsigned int nr_of_bytes) 
 {
 	std::string ret;
-	char buf[1024];
-	last_error.clear();
+	receive_data(ret, nr_of_bytes);
+	return ret;
+}
 
-	if (nr_of_bytes == 0) {
-		while (is_data_pending()) {
-			int received_nr_of_bytes = recv (user_data, buf, 1024, 0);
-			if (received_nr_of_bytes <= 0) {
-				set_last_error("receive_data", received_nr_of_bytes == SOCKET_ERROR ? "" : "connection closed");
-				break;
-			}
-			ret += std::string(buf,received_nr_of_bytes);
-		}
+bool socket::receive_data(std::string& data, unsigned int nr_of_bytes)
+{
+	data.clear();
+	if (nr_of_bytes > 0) {
+		data.resize(nr_of_bytes);
+		if (receive_data(&data[0], nr_of_bytes))
+			return true;
+		data.clear();
+		return false;
 	}
-	else {
-		while (nr_of_bytes > 0) {
-			int received_nr_of_bytes = recv(user_data, buf, min(1024, (int)nr_of_bytes), 0);
-			if (received_nr_of_bytes <= 0) {
-				set_last_error("receive_data", received_nr_of_bytes == SOCKET_ERROR ? "" : "connection closed");
+	data.assign(receive_buffer, receive_buffer_begin, std::string::npos);
+	receive_buffer.clear();
+	receive_buffer_begin = 0;
+	last_error.clear();
+	while (is_data_pending()) {
+		size_t old_size = data.size();
+		data.resize(old_size + receive_chunk_size);
+		int received_nr_of_bytes = recv(user_data, &data[old_size], int(receive_chunk_size), 0);
+		data.resize(old_size + std::max(received_nr_of_bytes, 0));
+		if (received_nr_of_bytes <= 0) {
+			if (received_nr_of_bytes == SOCKET_ERROR && would_block())
 				break;
-			}
-			ret += std::string(buf,received_nr_of_bytes);
-			nr_of_bytes -= received_nr_of_bytes;
+			return set_last_error("receive_data", received_nr_of_bytes == SOCKET_ERROR ? "" : "connection closed");
 		}
+	}
+	return true;
+}
+
+bool socket::receive_data(char* data, size_t size)
+{
+	buffer b(data, size);
+	return receive_data(&b, 1);
+}
 
+bool socket::receive_data(const buffer* buffers, size_t nr_buffers)
+{
+	// first consume buffered bytes
+	std::vector<buffer> pending(buffers, buffers + nr_buffers);
+	for (size_t i = 0; i < nr_buffers && get_nr_buffered_bytes() > 0; ++i) {
+		size_t n = take_buffered_bytes(pending[i].data, pending[i].size);
+		pending[i].data += n;
+		pending[i].size -= n;
 	}
-	return ret;
+	return transfer_buffers(pending, false, "receive_data");
+}
+
+int socket::receive_available(char* data, size_t capacity)
+{
+	last_error.clear();
+	if (get_nr_buffered_bytes() > 0)
+		return int(take_buffered_bytes(data, std::min(capacity, size_t(INT_MAX))));
+	int received_nr_of_bytes = recv(user_data, data, int(std::min(capacity, max_transfer_size)), 0);
+	if (received_nr_of_bytes > 0)
+		return received_nr_of_bytes;
+	if (received_nr_of_bytes == SOCKET_ERROR && would_block())
+		return 0;
+	set_last_error("receive_available", received_nr_of_bytes == SOCKET_ERROR ? "" : "connection closed");
+	return -1;
 }
 
 std::string socket::receive_line() 
 {
 	std::string ret;
+	receive_line(ret);
+	return ret;
+}
+
+bool socket::receive_line(std::string& line)
+{
+	line.clear();
 	while (true) {
-		char r;
-		int result = recv(user_data, &r, 1, 0);
-		if (result <= 0) {
-			set_last_error("receive_line", result == SOCKET_ERROR ? "" : "connection closed");
-			return "";
-		}
-		ret += r;
-		if (r == '\n') {
+		size_t pos = receive_buffer.find('\n', receive_buffer_begin);
+		if (pos != std::string::npos) {
+			line.append(receive_buffer, receive_buffer_begin, pos + 1 - receive_buffer_begin);
+			receive_buffer_begin = pos + 1;
+			if (receive_buffer_begin == receive_buffer.size()) {
+				receive_buffer.clear();
+				receive_buffer_begin = 0;
+			}
 			last_error.clear();
 			if (show_debug_output) {
 				ref_show_mutex().lock();
-				std::cout << "received line: " << ret.c_str(); 
+				std::cout << "received line: " << line.c_str(); 
 				std::cout.flush();
 				ref_show_mutex().unlock();
 			}
-			return ret;
+			return true;
+		}
+		// keep incomplete line and refill buffer with one large read
+		line.append(receive_buffer, receive_buffer_begin, std::string::npos);
+		receive_buffer.resize(receive_chunk_size);
+		receive_buffer_begin = 0;
+		if (receive_timeout >= 0 && !wait_until_ready(false)) {
+			receive_buffer.clear();
+			line.clear();
+			return set_last_error("receive_line", "timeout");
+		}
+		int result = recv(user_data, &receive_buffer[0], int(receive_chunk_size), 0);
+		receive_buffer.resize(std::max(result, 0));
+		if (result <= 0) {
+			if (result == SOCKET_ERROR && would_block() && wait_until_ready(false))
+				continue;
+			line.clear();
+			return set_last_error("receive_line", result == SOCKET_ERROR ? "" : "connection closed");
 		}
 	}
 }
 
 bool socket::send_line(const std::string& s) 
 {
-	return send_data(s+'\n');
+	buffer buffers[2] = { buffer(s.data(), s.size()), buffer("\n", 1) };
+	return send_data(buffers, 2);
 }
 
 bool socket::send_data(const std::string& s)
 {
-	int nr_bytes = (int)s.length();
-	const char* buf = s.c_str();
-	do {
-		int nr_bytes_sent = send(user_data, buf, nr_bytes, 0);
-		if (nr_bytes_sent <= 0)
-			return set_last_error("send_data/line", nr_bytes_sent == SOCKET_ERROR ? "" : "connection closed");
-		nr_bytes -= nr_bytes_sent;
-		buf += nr_bytes_sent;
-	} while (nr_bytes > 0);
+	return send_data(s.data(), s.size());
+}
+
+bool socket::send_data(const char* data, size_t size)
+{
+	buffer b(data, size);
+	return send_data(&b, 1);
+}
+
+bool socket::send_data(const buffer* buffers, size_t nr_buffers)
+{
+	std::vector<buffer> pending(buffers, buffers + nr_buffers);
+	return transfer_buffers(pending, true, "send_data/line");
+}
+
+bool socket::send_file(const std::string& file_name, uint64_t offset, size_t size)
+{
+#ifdef __linux__
+	int fd = ::open(file_name.c_str(), O_RDONLY);
+	if (fd == -1)
+		return set_last_error("send_file", "could not open " + file_name);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || uint64_t(st.st_size) < offset) {
+		::close(fd);
+		return set_last_error("send_file", "could not access range of " + file_name);
+	}
+	size = size_t(std::min(uint64_t(size), uint64_t(st.st_size) - offset));
+	// the kernel copies from the page cache to the socket without passing the data through user space
+	off_t position = off_t(offset);
+	while (size > 0) {
+		ssize_t n = sendfile(int(user_data), fd, &position, std::min(size, max_transfer_size));
+		if (n <= 0) {
+			if (n < 0 && would_block() && wait_until_ready(true))
+				continue;
+			::close(fd);
+			return set_last_error("send_file", n < 0 ? "" : "unexpected end of " + file_name);
+		}
+		size -= size_t(n);
+	}
+	::close(fd);
+#else
+	FILE* fp = fopen(file_name.c_str(), "rb");
+	if (!fp)
+		return set_last_error("send_file", "could not open " + file_name);
+#ifdef WIN32
+	int result = _fseeki64(fp, offset, SEEK_SET);
+#else
+	int result = fseeko(fp, off_t(offset), SEEK_SET);
+#endif
+	if (result != 0) {
+		fclose(fp);
+		return set_last_error("send_file", "could not access range of " + file_name);
+	}
+	std::vector<char> chunk(receive_chunk_size);
+	while (size > 0) {
+		size_t n = fread(&chunk[0], 1, std::min(size, chunk.size()), fp);
+		if (n == 0)
+			break;
+		if (!send_data(&chunk[0], n)) {
+			fclose(fp);
+			return false;
+		}
+		if (size != size_t(-1))
+			size -= n;
+	}
+	fclose(fp);
+	if (size != size_t(-1) && size > 0)
+		return set_last_error("send_file", "unexpected end of " + file_name);
+#endif
 	last_error.clear();
 	return true;
 }
@@ -260,10 +531,79 @@ bool socket::close()
 		set_last_error("close");
 
 	user_data = 0;
+	receive_buffer.clear();
+	receive_buffer_begin = 0;
 	end();
 	return result == 0;
 }
 
+bool socket::shutdown_receiving()
+{
+#ifdef WIN32
+	int result = shutdown(user_data, SD_RECEIVE);
+#else
+	int result = shutdown(user_data, SHUT_RD);
+#endif
+	if (result != 0)
+		return set_last_error("shutdown_receiving");
+	last_error.clear();
+	return true;
+}
+
+bool create_socket_pair(socket_ptr& first, socket_ptr& second)
+{
+	if (!socket::begin())
+		return false;
+	SOCKET fds[2] = { INVALID_SOCKET, INVALID_SOCKET };
+#ifdef WIN32
+	// connect to a listener on an arbitrary loopback port and accept only the connection with the own local address
+	SOCKET listener = ::socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addr_len = sizeof(addr);
+	if (listener != INVALID_SOCKET && bind(listener, (sockaddr*)&addr, addr_len) == 0 &&
+		getsockname(listener, (sockaddr*)&addr, &addr_len) == 0 && listen(listener, 1) == 0) {
+		fds[0] = ::socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in local;
+		socklen_t local_len = sizeof(local);
+		if (fds[0] != INVALID_SOCKET && ::connect(fds[0], (sockaddr*)&addr, addr_len) == 0 &&
+			getsockname(fds[0], (sockaddr*)&local, &local_len) == 0) {
+			while (true) {
+				sockaddr_in peer;
+				socklen_t peer_len = sizeof(peer);
+				fds[1] = ::accept(listener, (sockaddr*)&peer, &peer_len);
+				if (fds[1] == INVALID_SOCKET || (peer.sin_port == local.sin_port && peer.sin_addr.s_addr == local.sin_addr.s_addr))
+					break;
+				closesocket(fds[1]);
+			}
+		}
+	}
+	if (listener != INVALID_SOCKET)
+		closesocket(listener);
+#else
+	int pair[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0) {
+		fds[0] = pair[0];
+		fds[1] = pair[1];
+	}
+#endif
+	if (fds[0] == INVALID_SOCKET || fds[1] == INVALID_SOCKET) {
+		if (fds[0] != INVALID_SOCKET)
+			closesocket(fds[0]);
+		if (fds[1] != INVALID_SOCKET)
+			closesocket(fds[1]);
+		socket::end();
+		return false;
+	}
+	// each socket releases the socket library when it is closed
+	socket::begin();
+	first = socket_ptr(new socket(size_t(fds[0])));
+	second = socket_ptr(new socket(size_t(fds[1])));
+	return true;
+}
+
 socket_client::socket_client()
 {
 }
@@ -318,6 +658,11 @@ bool socket_server::bind_and_listen(int port, int max_nr_connections)
 		user_data = 0;
 		return set_last_error("bind_and_listen", "could not create socket");
 	}
+#ifndef WIN32
+	// allow to bind again while connections of a previous server are in TIME_WAIT state
+	int reuse = 1;
+	setsockopt((SOCKET)user_data, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
 	/* bind the socket to the internet address */
 	if (bind(user_data, (sockaddr *)&sa, sizeof(sockaddr_in)) == SOCKET_ERROR) {
 		set_last_error("bind_and_listen");
@@ -343,13 +688,7 @@ socket_ptr socket_server::wait_for_connection()
 		set_last_error("wait_for_connection", "attempt to wait for connection of socket server that does not listen to port");
 		return socket_ptr();
 	}
-#ifdef WIN32
-	u_long arg = 0;
-	ioctlsocket(user_data, FIONBIO, &arg);
-#else
-	int flags = fcntl(user_data, F_GETFD) & (~O_NONBLOCK);
-	fcntl(user_data, F_SETFD, flags);
-#endif
+	set_blocking(true);
 	SOCKET new_sock = ::accept(user_data, 0, 0);
 	if (new_sock == INVALID_SOCKET) {
 		set_last_error("wait_for_connection");
@@ -372,12 +711,7 @@ socket_ptr socket_server::check_for_connection()
 		set_last_error("check_for_connection", "attempt to check for connection of socket server that does not listen to port");
 		return socket_ptr();
 	}
-#ifdef WIN32
-	u_long arg = 1;
-	ioctlsocket(user_data, FIONBIO, &arg);
-#else
-	fcntl(user_data, F_SETFD, O_NONBLOCK);
-#endif
+	set_blocking(false);
 	SOCKET new_sock = ::accept(user_data, 0, 0);
 	if (new_sock == INVALID_SOCKET) {
 #ifdef WIN32
@@ -407,6 +741,187 @@ socket_server_ptr create_socket_server()
 	return socket_server_ptr(new socket_server);
 }
 
+socket_select::socket_select() : handle(-1)
+{
+#ifdef __linux__
+	handle = epoll_create1(EPOLL_CLOEXEC);
+#endif
+}
+
+socket_select::~socket_select()
+{
+#ifdef __linux__
+	if (handle != -1)
+		::close(handle);
+#endif
+}
+
+#ifdef __linux__
+static epoll_event to_epoll_event(socket* s, int events)
+{
+	epoll_event e;
+	e.events = EPOLLRDHUP;
+	if (events & socket_select::SE_READ)
+		e.events |= EPOLLIN;
+	if (events & socket_select::SE_WRITE)
+		e.events |= EPOLLOUT;
+	e.data.ptr = s;
+	return e;
+}
+#endif
+
+bool socket_select::add(const socket_ptr& s, int events)
+{
+	if (s.empty() || !s->user_data) {
+		last_error = "attempt to add socket that is not connected";
+		return false;
+	}
+	if (entries.find(&*s) != entries.end())
+		return modify(s, events);
+#ifdef __linux__
+	if (handle != -1) {
+		epoll_event e = to_epoll_event(&*s, events);
+		if (epoll_ctl(handle, EPOLL_CTL_ADD, int(s->user_data), &e) != 0) {
+			last_error = strerror(errno);
+			return false;
+		}
+	}
+#endif
+	entry& en = entries[&*s];
+	en.s = s;
+	en.events = events;
+	last_error.clear();
+	return true;
+}
+
+bool socket_select::modify(const socket_ptr& s, int events)
+{
+	auto iter = s.empty() ? entries.end() : entries.find(&*s);
+	if (iter == entries.end()) {
+		last_error = "attempt to modify socket that has not been added";
+		return false;
+	}
+#ifdef __linux__
+	if (handle != -1) {
+		epoll_event e = to_epoll_event(&*s, events);
+		if (epoll_ctl(handle, EPOLL_CTL_MOD, int(s->user_data), &e) != 0) {
+			last_error = strerror(errno);
+			return false;
+		}
+	}
+#endif
+	iter->second.events = events;
+	last_error.clear();
+	return true;
+}
+
+bool socket_select::remove(const socket_ptr& s)
+{
+	auto iter = s.empty() ? entries.end() : entries.find(&*s);
+	if (iter == entries.end()) {
+		last_error = "attempt to remove socket that has not been added";
+		return false;
+	}
+#ifdef __linux__
+	// closed sockets have already been removed from the epoll set by the system
+	if (handle != -1 && s->user_data) {
+		epoll_event e = to_epoll_event(&*s, 0);
+		epoll_ctl(handle, EPOLL_CTL_DEL, int(s->user_data), &e);
+	}
+#endif
+	entries.erase(iter);
+	last_error.clear();
+	return true;
+}
+
+int socket_select::wait(std::vector<event>& ready, int timeout)
+{
+	ready.clear();
+	// sockets with buffered data are ready without waiting
+	for (auto& en : entries)
+		if ((en.second.events & SE_READ) && en.second.s->get_nr_buffered_bytes() > 0) {
+			event e;
+			e.s = en.second.s;
+			e.events = SE_READ;
+			ready.push_back(e);
+		}
+	size_t nr_buffered = ready.size();
+	if (nr_buffered > 0)
+		timeout = 0;
+	// add the events reported by the system, merging them with those of sockets with buffered data
+	auto report = [&](socket* s, int events) {
+		for (size_t i = 0; i < nr_buffered; ++i)
+			if (&*ready[i].s == s) {
+				ready[i].events |= events;
+				return;
+			}
+		event e;
+		e.s = entries[s].s;
+		e.events = events;
+		ready.push_back(e);
+	};
+#ifdef __linux__
+	if (handle != -1) {
+		epoll_event events[256];
+		int n = epoll_wait(handle, events, 256, timeout);
+		if (n < 0) {
+			if (errno == EINTR)
+				return int(ready.size());
+			last_error = strerror(errno);
+			return -1;
+		}
+		for (int i = 0; i < n; ++i) {
+			int e = 0;
+			if (events[i].events & EPOLLIN)
+				e |= SE_READ;
+			if (events[i].events & EPOLLOUT)
+				e |= SE_WRITE;
+			if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+				e |= SE_CLOSE;
+			report((socket*)events[i].data.ptr, e);
+		}
+		last_error.clear();
+		return int(ready.size());
+	}
+#endif
+	std::vector<pollfd> fds;
+	std::vector<socket*> fd_sockets;
+	for (auto& en : entries) {
+		pollfd p;
+		p.fd = (SOCKET)en.second.s->user_data;
+		p.events = 0;
+		if (en.second.events & SE_READ)
+			p.events |= POLLIN;
+		if (en.second.events & SE_WRITE)
+			p.events |= POLLOUT;
+		p.revents = 0;
+		fds.push_back(p);
+		fd_sockets.push_back(&*en.second.s);
+	}
+	int n = fds.empty() ? 0 : poll(fds.data(), (unsigned long)fds.size(), timeout);
+	if (n < 0) {
+		if (errno == EINTR)
+			return int(ready.size());
+		last_error = "poll failed";
+		return -1;
+	}
+	for (size_t i = 0; n > 0 && i < fds.size(); ++i) {
+		if (fds[i].revents == 0)
+			continue;
+		int e = 0;
+		if (fds[i].revents & POLLIN)
+			e |= SE_READ;
+		if (fds[i].revents & POLLOUT)
+			e |= SE_WRITE;
+		if (fds[i].revents & (POLLHUP | POLLERR | POLLNVAL))
+			e |= SE_CLOSE;
+		report(fd_sockets[i], e);
+		--n;
+	}
+	last_error.clear();
+	return int(ready.size());
+}
+
 
 	}
 }
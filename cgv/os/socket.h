@@ -1,6 +1,9 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
 #include <cgv/data/ref_ptr.h>
 
 #include "lib_begin.h"
@@ -8,9 +11,19 @@
 namespace cgv {
 	namespace os {
 
-/** base class for all sockets */
+/** base class for all sockets. Lines are received through an internal buffer that is filled with large reads and
+    consumed by all receive functions before data is read from the socket again. */
 class CGV_API socket : public data::ref_counted
 {
+public:
+	/// memory range of scatter gather sends and receives
+	struct buffer
+	{
+		char* data;
+		size_t size;
+		/// construct from pointer and size in bytes
+		buffer(const void* _data = 0, size_t _size = 0) : data((char*)_data), size(_size) {}
+	};
 protected:
 	static bool show_debug_output;
 	static int  nr_of_sockets;
@@ -18,6 +31,7 @@ protected:
 	static void end();
 	friend class socket_server;
 	friend class socket_select;
+	friend CGV_API bool create_socket_pair(data::ref_ptr<socket,true>& first, data::ref_ptr<socket,true>& second);
 	/// hides constructor from user
 	socket();
 	/// construct from existing socket identifier
@@ -28,6 +42,21 @@ protected:
 	mutable std::string last_error;
 	/// convenience function to set last error and print debug info. The method always returns false.
 	bool set_last_error(const char* location, const std::string& text = "") const;
+	/// received bytes that have not been consumed yet, which start at receive_buffer_begin
+	std::string receive_buffer;
+	size_t receive_buffer_begin;
+	/// time in milliseconds that receiving waits for data or -1 to wait forever
+	int receive_timeout;
+	/// return number of bytes in the receive buffer
+	size_t get_nr_buffered_bytes() const { return receive_buffer.size() - receive_buffer_begin; }
+	/// move up to size bytes from the receive buffer to data and return their number
+	size_t take_buffered_bytes(char* data, size_t size);
+	/// check whether the last call failed only because the socket is non blocking
+	static bool would_block();
+	/// wait until the socket can be read or written without blocking, where reading waits at most receive_timeout milliseconds
+	bool wait_until_ready(bool for_sending) const;
+	/// send or receive the pending buffers completely, where buffers are advanced and emptied while data is transferred
+	bool transfer_buffers(std::vector<buffer>& pending, bool sending, const char* location);
 public:
 	/// enables or disables (default) debug output for all socket commands
 	static void enable_debug_output(bool enable = true);
@@ -39,14 +68,42 @@ public:
 	bool is_data_pending() const;
 	/// return the number of data bytes that have been arrived at the socket or -1 if socket is not connected
 	int get_nr_of_arrived_bytes() const;
-	/// receive data up to the next newline excluding the newline char
+	/// switch between blocking (default) and non blocking mode
+	bool set_blocking(bool blocking);
+	/// disable or enable the delay of small sends (Nagle's algorithm)
+	bool set_no_delay(bool no_delay);
+	/// set time in milliseconds after which receiving fails if no data arrives or -1 (default) to wait forever
+	void set_receive_timeout(int milliseconds);
+	/// return the receive timeout in milliseconds
+	int get_receive_timeout() const;
+	/// receive data up to and including the next newline
 	std::string receive_line();
+	/// receive data up to and including the next newline into line, which keeps its capacity
+	bool receive_line(std::string& line);
 	/// receive all pending data or if nr_of_bytes is larger than 0, exactly nr_of_bytes
 	std::string receive_data(unsigned int nr_of_bytes = 0);
+	/// receive all pending data or exactly nr_of_bytes into data, which is cleared but keeps its capacity
+	bool receive_data(std::string& data, unsigned int nr_of_bytes = 0);
+	/// receive exactly size bytes into caller supplied memory
+	bool receive_data(char* data, size_t size);
+	/// fill the given buffers completely with scattering reads
+	bool receive_data(const buffer* buffers, size_t nr_buffers);
+	/** receive at most capacity bytes with a single read, which waits for the first byte in blocking mode. Returns
+	    the number of received bytes, 0 if no data is available in non blocking mode or -1 on errors and if the
+		connection has been closed. */
+	int receive_available(char* data, size_t capacity);
 	/// extends line by newline and send as data
 	bool send_line(const std::string& content);
 	/// send the data in the string
 	bool send_data(const std::string&);
+	/// send size bytes from caller supplied memory
+	bool send_data(const char* data, size_t size);
+	/// send the given buffers with gathering writes without copying them into one block
+	bool send_data(const buffer* buffers, size_t nr_buffers);
+	/// send size bytes of a file starting at offset or the rest of the file for size_t(-1), which uses sendfile on linux
+	bool send_file(const std::string& file_name, uint64_t offset = 0, size_t size = size_t(-1));
+	/// shut down receiving such that receives blocked in other threads return and further receives fail, while data can still be sent
+	bool shutdown_receiving();
 	/// close the socket
 	bool close();
 };
@@ -54,6 +111,10 @@ public:
 /// reference counted pointer to socket
 typedef data::ref_ptr<socket> socket_ptr;
 
+/** create two connected sockets that are not reachable by other processes, which uses socketpair on posix systems and a
+    connection over a temporary loopback listener that only accepts the own connection on windows */
+extern CGV_API bool create_socket_pair(socket_ptr& first, socket_ptr& second);
+
 class CGV_API socket_client;
 
 /// reference counted pointer to socket_client
@@ -99,6 +160,53 @@ public:
 /// this is the only way to create a socket_server as a reference counted pointer
 extern CGV_API socket_server_ptr create_socket_server();
 
+/** waits for events on a set of sockets, which is implemented with epoll on linux and with poll on other systems.
+    Sockets that have buffered received data are reported as readable without waiting. Socket servers are readable
+	if a connection is pending. */
+class CGV_API socket_select
+{
+public:
+	/// event flags
+	enum event_type { SE_READ = 1, SE_WRITE = 2, SE_CLOSE = 4 };
+	/// socket together with the events that occurred
+	struct event
+	{
+		socket_ptr s;
+		int events;
+	};
+protected:
+	/// epoll instance or -1 if poll is used
+	int handle;
+	/// registered socket with its events
+	struct entry
+	{
+		socket_ptr s;
+		int events;
+	};
+	std::unordered_map<const socket*, entry> entries;
+	mutable std::string last_error;
+	/// no copies
+	socket_select(const socket_select&);
+	socket_select& operator = (const socket_select&);
+public:
+	/// construct empty set
+	socket_select();
+	/// release epoll instance
+	~socket_select();
+	/// add socket to wait for the given events, where SE_CLOSE is always reported
+	bool add(const socket_ptr& s, int events = SE_READ);
+	/// change events of socket in set
+	bool modify(const socket_ptr& s, int events);
+	/// remove socket from set
+	bool remove(const socket_ptr& s);
+	/// return number of sockets in set
+	size_t get_nr_sockets() const { return entries.size(); }
+	/// wait at most timeout milliseconds or infinitely for a negative timeout and return number of ready sockets or -1 on errors
+	int wait(std::vector<event>& ready, int timeout = -1);
+	/// returns the last error
+	std::string get_last_error() const { return last_error; }
+};
+
 #if _MSC_VER >= 1400
 CGV_TEMPLATE template class CGV_API cgv::data::ref_ptr<cgv::os::socket_ptr>;
 CGV_TEMPLATE template class CGV_API cgv::data::ref_ptr<cgv::os::socket_client_ptr>;
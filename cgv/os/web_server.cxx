@@ -1,4 +1,7 @@
 #include "web_server.h"
+#include "http_server.h"
+#include <iostream>
+#include <mutex>
 
 namespace cgv {
 	namespace os {
@@ -9,6 +12,13 @@ web_server_provider*& ref_provider()
 	return wsp;
 }
 
+/// protects the server pointer stored in the user data of web servers without provider
+static std::mutex& ref_server_mutex()
+{
+	static std::mutex m;
+	return m;
+}
+
 /// create a web server that listens to the given port
 web_server::web_server(unsigned int _port)
 {
@@ -33,17 +43,36 @@ void web_server::start()
 {
 	if (ref_provider()) 
 		ref_provider()->start_web_server(this);
-	else
-		std::cerr << "no web server provider registered, please use the co_web plugin" << std::endl;
+	else {
+		// without provider use the built-in event driven server
+		// server is published before listen, such that a concurrent stop lets run return immediately
+		http_server* server = new http_server([this](http_request& request) { handle_request(request); });
+		{
+			std::lock_guard<std::mutex> lock(ref_server_mutex());
+			user_data = server;
+		}
+		if (server->listen(port))
+			server->run();
+		// stop holds the lock until run has returned
+		{
+			std::lock_guard<std::mutex> lock(ref_server_mutex());
+			user_data = 0;
+		}
+		delete server;
+	}
 }
 
 /// can only be called from a different thread
 void web_server::stop()
 {
-	if (user_data && ref_provider()) 
+	if (ref_provider()) 
 		ref_provider()->stop_web_server(this);
-	else
-		std::cerr << "no web server provider registered, please use the co_web plugin" << std::endl;
+	else {
+		// start deletes the server after run has returned
+		std::lock_guard<std::mutex> lock(ref_server_mutex());
+		if (user_data)
+			((http_server*)user_data)->stop();
+	}
 }
 
 
@@ -56,8 +85,8 @@ void web_server_thread::start()
 /// calls the stop method of the web_server
 web_server_thread::~web_server_thread()
 {
-	thread::kill();
 	web_server::stop();
+	thread::kill();
 }
 
 /// reimplements the run method that simply starts the web server
@@ -20,7 +20,7 @@ public:
 	web_server(unsigned int _port = 80);
 	/// reimplement to handle requests
 	virtual void handle_request(http_request& request) = 0;
-	/// start the web server (does never return)
+	/// start the web server, which returns only after stop has been called from a different thread
 	void start();
 	/// can only be called from a different thread
 	void stop();
@@ -34,7 +34,7 @@ class CGV_API web_server_thread : public thread, public web_server
 public:
 	/// create a web server that listens to the given port
 	web_server_thread(unsigned int _port = 8080);
-	/// calls the stop method of the web_server
+	/// calls the stop method of the web_server and kills the thread if it is still running
 	~web_server_thread();
 	/// start the web server in a separate thread
 	void start();
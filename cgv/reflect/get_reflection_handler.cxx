@@ -21,7 +21,14 @@ void get_reflection_handler::process_member_void(const std::string& member_name,
 	                     abst_reflection_traits* rt, GroupKind group_kind, unsigned grp_size)
 {
 	find_reflection_handler::process_member_void(member_name, member_ptr, rt, group_kind, grp_size);
-	valid = false;
+	valid = get_member_value(member_ptr, rt, value_type, value_ptr, value_rt);
+}
+
+/// copy value of member described by rt with the conversions of the get handler and return whether this was possible
+bool get_reflection_handler::get_member_value(void* member_ptr, abst_reflection_traits* rt,
+						const std::string& value_type, void* value_ptr, abst_reflection_traits* value_rt)
+{
+	bool valid = false;
 	if (value_rt) {
 		if (info::is_fundamental(value_rt->get_type_id())) {
 			if (info::is_fundamental(rt->get_type_id())) {
@@ -59,6 +66,7 @@ void get_reflection_handler::process_member_void(const std::string& member_name,
 			valid = true;
 		}
 	}
+	return valid;
 }
 
 	}
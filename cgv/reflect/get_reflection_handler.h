@@ -26,6 +26,9 @@ public:
 	/// copy value of member to external value pointer
 	void process_member_void(const std::string& member_name, void* member_ptr, 
 						     abst_reflection_traits* rt, GroupKind group_kind, unsigned grp_size);
+	/// copy value of member described by rt with the conversions of the get handler and return whether this was possible
+	static bool get_member_value(void* member_ptr, abst_reflection_traits* rt,
+								 const std::string& value_type, void* value_ptr, abst_reflection_traits* value_rt = 0);
 };
 
 #ifdef REFLECT_TRAITS_WITH_DECLTYPE
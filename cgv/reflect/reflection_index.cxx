@@ -0,0 +1,147 @@
+#include "reflection_index.h"
+#include <cgv/utils/convert.h>
+#include <typeindex>
+#include <mutex>
+
+namespace cgv {
+	namespace reflect {
+
+/// reflection handler that collects the paths and offsets of the members stored inside of an object
+struct reflection_index_builder : public reflection_handler
+{
+	/// traversed group with the path of its members
+	struct group_frame
+	{
+		GroupKind group_kind;
+		std::string path;
+		/// whether members of group are not indexed
+		bool skip;
+		group_frame(GroupKind _group_kind, const std::string& _path, bool _skip = false) : group_kind(_group_kind), path(_path), skip(_skip) {}
+	};
+	std::vector<group_frame> frames;
+	const char* object_ptr;
+	size_t max_offset;
+	std::unordered_map<std::string, reflection_index::entry>& entries;
+	reflection_index_builder(const void* _object_ptr, size_t _max_offset, std::unordered_map<std::string, reflection_index::entry>& _entries) :
+		object_ptr(static_cast<const char*>(_object_ptr)), max_offset(_max_offset), entries(_entries)
+	{
+		frames.push_back(group_frame(GK_NO_GROUP, ""));
+	}
+	/// compose path of member in current group in the syntax of the find_reflection_handler
+	std::string member_path(const std::string& member_name) const
+	{
+		const group_frame& f = frames.back();
+		if (f.group_kind == GK_ARRAY)
+			return f.path + "[" + cgv::utils::to_string(nesting_info_stack.back().idx) + "]";
+		if (member_name.empty() || f.path.empty())
+			return f.path + member_name;
+		return f.path + "." + member_name;
+	}
+	/// add entry if member lies inside of object and path has not been found before, what corresponds to the first match of the find_reflection_handler
+	void add_entry(const std::string& path, void* member_ptr, abst_reflection_traits* rt)
+	{
+		std::ptrdiff_t offset = static_cast<const char*>(member_ptr) - object_ptr;
+		if (path.empty() || offset < 0 || size_t(offset) >= max_offset || entries.find(path) != entries.end())
+			return;
+		reflection_index::entry& e = entries[path];
+		e.offset = offset;
+		e.rt = rt->clone();
+	}
+	int reflect_group_begin(GroupKind group_kind, const std::string& group_name, void* group_ptr, abst_reflection_traits* rt, unsigned grp_size)
+	{
+		if (frames.back().skip)
+			return GT_SKIP;
+		switch (group_kind) {
+		case GK_BASE_CLASS:
+			frames.push_back(group_frame(group_kind, frames.back().path));
+			return GT_COMPLETE;
+		case GK_STRUCTURE: {
+			std::string path = member_path(group_name);
+			// structures without name reflect base classes, which are accessed with the path of the enclosing group
+			if (path != frames.back().path)
+				add_entry(path, group_ptr, rt);
+			frames.push_back(group_frame(group_kind, path));
+			return GT_COMPLETE;
+		}
+		case GK_ARRAY:
+			frames.push_back(group_frame(group_kind, member_path(group_name)));
+			return GT_COMPLETE;
+		default:
+			// elements of vectors and pointers are not stored inside of the object
+			return GT_SKIP;
+		}
+	}
+	void reflect_group_end(GroupKind group_kind)
+	{
+		frames.pop_back();
+	}
+	bool reflect_member_void(const std::string& member_name, void* member_ptr, abst_reflection_traits* rt)
+	{
+		group_frame& f = frames.back();
+		if (f.skip)
+			return true;
+		// only dynamic arrays reflect their size, their elements are not stored inside of the object
+		if (f.group_kind == GK_ARRAY && member_name == "size") {
+			f.skip = true;
+			return true;
+		}
+		add_entry(member_path(member_name), member_ptr, rt);
+		return true;
+	}
+	bool reflect_method_void(const std::string& method_name, method_interface* mi_ptr,
+		abst_reflection_traits* return_traits, const std::vector<abst_reflection_traits*>& param_value_traits)
+	{
+		return true;
+	}
+};
+
+reflection_index::reflection_index()
+{
+}
+
+reflection_index::~reflection_index()
+{
+	for (auto& e : entries)
+		delete e.second.rt;
+}
+
+void reflection_index::build(const void* object_ptr, const reflect_function& reflect, size_t max_offset)
+{
+	for (auto& e : entries)
+		delete e.second.rt;
+	entries.clear();
+	reflection_index_builder rib(object_ptr, max_offset, entries);
+	reflect(rib);
+}
+
+const reflection_index::entry* reflection_index::find(const std::string& path) const
+{
+	auto iter = entries.find(path);
+	if (iter == entries.end())
+		return 0;
+	return &iter->second;
+}
+
+const reflection_index& reflection_index::get_type_index(const std::type_info& ti, const void* object_ptr, const reflect_function& reflect)
+{
+	// allocated once and never destructed such that objects can be accessed during static destruction
+	static std::mutex& mutex = *new std::mutex();
+	static std::unordered_map<std::type_index, reflection_index*>& type_indices = *new std::unordered_map<std::type_index, reflection_index*>();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto iter = type_indices.find(std::type_index(ti));
+		if (iter != type_indices.end())
+			return *iter->second;
+	}
+	// build without lock, such that self_reflect() can access properties of other objects
+	reflection_index* index = new reflection_index();
+	index->build(object_ptr, reflect);
+	std::lock_guard<std::mutex> lock(mutex);
+	auto result = type_indices.insert(std::make_pair(std::type_index(ti), index));
+	if (!result.second)
+		delete index;
+	return *result.first->second;
+}
+
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <typeinfo>
+#include <cstddef>
+#include "reflection_handler.h"
+
+#include "lib_begin.h"
+
+namespace cgv {
+	namespace reflect {
+
+/** index of the members that the self_reflect() method of a type describes, which maps the member paths accepted by
+    the cgv::reflect::find_reflection_handler (for example \c style.radius or \c colors[2].r) to the offset of the member
+	relative to the start of the object and its reflection traits. The index is built once per type from the self
+	reflection of one instance and afterwards resolves a member of any instance of the type with a single hash lookup.
+	Only members stored inside of the object are indexed. Elements of vectors, dynamic arrays and pointers are skipped
+	as their location changes at runtime. The offsets of other members are only valid for all instances if the self
+	reflection does not reflect members of other objects, what cgv::base::base types ensure by opting in with
+	use_reflection_index(). Members outside of the first max_offset bytes of the object are skipped as well, which
+	should be the size of the object if known. Paths that are not indexed need to be resolved with a reflection handler. */
+class CGV_API reflection_index
+{
+public:
+	/// indexed member
+	struct entry
+	{
+		/// offset of member relative to the start of the object
+		std::ptrdiff_t offset;
+		/// reflection traits of member
+		abst_reflection_traits* rt;
+	};
+	/// function that passes the reflection handler to the self_reflect() method of the instance
+	typedef std::function<bool(reflection_handler&)> reflect_function;
+protected:
+	std::unordered_map<std::string, entry> entries;
+	/// no copies
+	reflection_index(const reflection_index&);
+	reflection_index& operator = (const reflection_index&);
+public:
+	/// construct empty index
+	reflection_index();
+	/// destruct reflection traits of entries
+	~reflection_index();
+	/// build index from the self reflection of the object starting at object_ptr
+	void build(const void* object_ptr, const reflect_function& reflect, size_t max_offset = size_t(1) << 20);
+	/// return entry of member path or 0 if the path is not indexed
+	const entry* find(const std::string& path) const;
+	/// return number of indexed member paths
+	size_t get_nr_entries() const { return entries.size(); }
+	/// return pointer to indexed member in the object starting at object_ptr
+	static void* get_member_ptr(const void* object_ptr, const entry& e) { return const_cast<char*>(static_cast<const char*>(object_ptr) + e.offset); }
+	/// return index of type, which is built from the given object on the first call for a type; indices are shared between threads and never destructed
+	static const reflection_index& get_type_index(const std::type_info& ti, const void* object_ptr, const reflect_function& reflect);
+};
+
+	}
+}
+
+#include <cgv/config/lib_end.h>
@@ -0,0 +1,221 @@
+#include "async_io.h"
+#include <algorithm>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace cgv {
+	namespace utils {
+
+/// state of a submitted request shared by its pieces
+struct async_io::job
+{
+	request req;
+	result res;
+	/// whether data is read into scratch buffers and dropped
+	bool discard;
+	std::atomic<size_t> nr_pending_pieces;
+	std::atomic<size_t> nr_bytes_read;
+	std::atomic<bool> failed;
+	/// index in batch passed to the handler
+	size_t index;
+	completion_handler handler;
+	bool has_promise;
+	std::promise<result> promise;
+	job(const request& _req, bool _discard = false) : req(_req), discard(_discard), nr_pending_pieces(0), nr_bytes_read(0), failed(false), index(0), has_promise(false) {}
+};
+
+async_io::async_io(unsigned nr_threads, size_t _piece_size) : piece_size(std::max(_piece_size, size_t(1) << 16)), nr_pending_jobs(0), stop_workers(false)
+{
+	if (nr_threads == 0)
+		nr_threads = std::max(std::thread::hardware_concurrency(), 4u);
+	for (unsigned i = 0; i < nr_threads; ++i)
+		workers.push_back(std::thread(&async_io::worker_loop, this));
+}
+
+async_io::~async_io()
+{
+	wait();
+	{
+		std::unique_lock<std::mutex> lock(queue_mutex);
+		stop_workers = true;
+	}
+	queue_condition.notify_all();
+	for (auto& w : workers)
+		w.join();
+}
+
+void async_io::submit(const std::shared_ptr<job>& j)
+{
+	request& r = j->req;
+	if (r.size == size_t(-1)) {
+		uint64_t file_size;
+		if (!get_file_size(r.file_name, file_size)) {
+			j->failed = true;
+			r.size = 0;
+		}
+		else
+			r.size = file_size > r.offset ? size_t(file_size - r.offset) : 0;
+	}
+	if (r.destination == 0 && !j->discard)
+		j->res.buffer.resize(r.size);
+	char* destination = r.destination ? r.destination : j->res.buffer.data();
+	// requests of size zero are completed by a single empty piece
+	size_t nr_pieces = std::max((r.size + piece_size - 1) / piece_size, size_t(1));
+	j->nr_pending_pieces = nr_pieces;
+	std::unique_lock<std::mutex> lock(queue_mutex);
+	++nr_pending_jobs;
+	for (size_t i = 0; i < nr_pieces; ++i) {
+		piece p;
+		p.owner = j;
+		p.offset = r.offset + i*piece_size;
+		p.size = std::min(piece_size, r.size - std::min(r.size, i*piece_size));
+		p.destination = j->discard ? 0 : destination + i*piece_size;
+		pieces.push_back(p);
+	}
+	lock.unlock();
+	queue_condition.notify_all();
+}
+
+void async_io::finish(job& j)
+{
+	j.res.success = !j.failed;
+	j.res.nr_bytes_read = j.nr_bytes_read;
+	if (j.handler)
+		j.handler(j.index, j.res);
+	else if (j.has_promise)
+		j.promise.set_value(std::move(j.res));
+	{
+		std::unique_lock<std::mutex> lock(queue_mutex);
+		--nr_pending_jobs;
+	}
+	idle_condition.notify_all();
+}
+
+void async_io::worker_loop()
+{
+	std::vector<char> scratch;
+	std::unique_lock<std::mutex> lock(queue_mutex);
+	while (true) {
+		queue_condition.wait(lock, [this]() { return stop_workers || !pieces.empty(); });
+		if (pieces.empty())
+			break;
+		piece p = pieces.front();
+		pieces.pop_front();
+		lock.unlock();
+		job& j = *p.owner;
+		char* destination = p.destination;
+		if (j.discard) {
+			scratch.resize(p.size);
+			destination = scratch.data();
+		}
+		size_t nr_bytes = p.size > 0 ? read_range(j.req.file_name, p.offset, p.size, destination) : 0;
+		if (nr_bytes != p.size)
+			j.failed = true;
+		j.nr_bytes_read += nr_bytes;
+		if (--j.nr_pending_pieces == 0)
+			finish(j);
+		p.owner.reset();
+		lock.lock();
+	}
+}
+
+std::future<async_io::result> async_io::read(const request& r)
+{
+	std::shared_ptr<job> j(new job(r));
+	j->has_promise = true;
+	std::future<result> f = j->promise.get_future();
+	submit(j);
+	return f;
+}
+
+std::vector<std::future<async_io::result> > async_io::read(const std::vector<request>& batch)
+{
+	std::vector<std::future<result> > futures;
+	for (const auto& r : batch)
+		futures.push_back(read(r));
+	return futures;
+}
+
+void async_io::read(const std::vector<request>& batch, const completion_handler& handler)
+{
+	for (size_t i = 0; i < batch.size(); ++i) {
+		std::shared_ptr<job> j(new job(batch[i]));
+		j->index = i;
+		j->handler = handler;
+		submit(j);
+	}
+}
+
+void async_io::read_ahead(const std::string& file_name)
+{
+	submit(std::shared_ptr<job>(new job(request(file_name), true)));
+}
+
+void async_io::wait()
+{
+	std::unique_lock<std::mutex> lock(queue_mutex);
+	idle_condition.wait(lock, [this]() { return nr_pending_jobs == 0; });
+}
+
+bool async_io::get_file_size(const std::string& file_name, uint64_t& size)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(file_name.c_str(), GetFileExInfoStandard, &attributes))
+		return false;
+	size = (uint64_t(attributes.nFileSizeHigh) << 32) + attributes.nFileSizeLow;
+#else
+	struct stat st;
+	if (stat(file_name.c_str(), &st) != 0)
+		return false;
+	size = uint64_t(st.st_size);
+#endif
+	return true;
+}
+
+size_t async_io::read_range(const std::string& file_name, uint64_t offset, size_t size, char* destination)
+{
+	size_t nr_bytes = 0;
+	// single reads are limited to 1GB
+	const size_t max_read_size = size_t(1) << 30;
+#ifdef _WIN32
+	HANDLE fh = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fh == INVALID_HANDLE_VALUE)
+		return 0;
+	while (nr_bytes < size) {
+		OVERLAPPED overlapped = {};
+		uint64_t position = offset + nr_bytes;
+		overlapped.Offset = DWORD(position);
+		overlapped.OffsetHigh = DWORD(position >> 32);
+		DWORD n = 0;
+		if (!ReadFile(fh, destination + nr_bytes, DWORD(std::min(size - nr_bytes, max_read_size)), &n, &overlapped) || n == 0)
+			break;
+		nr_bytes += n;
+	}
+	CloseHandle(fh);
+#else
+	int fd = ::open(file_name.c_str(), O_RDONLY);
+	if (fd == -1)
+		return 0;
+	while (nr_bytes < size) {
+		ssize_t n = pread(fd, destination + nr_bytes, std::min(size - nr_bytes, max_read_size), off_t(offset + nr_bytes));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		nr_bytes += size_t(n);
+	}
+	::close(fd);
+#endif
+	return nr_bytes;
+}
+
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <cstdint>
+
+#include "lib_begin.h"
+
+namespace cgv {
+	namespace utils {
+
+/** service for asynchronous reads of file ranges, which are processed by a pool of worker threads with positional
+    reads (pread on posix systems and ReadFile with offset on windows). Requests can be submitted one by one or in
+	batches and complete through futures or completion handlers. Requests larger than the piece size are split into
+	pieces that are read concurrently, such that a single large request as well as many small requests keep several
+	reads in flight. Completion handlers are called on the worker thread that finished the last piece, which allows
+	to decode one file while others are still being read. */
+class CGV_API async_io
+{
+public:
+	/// request to read a range of a file
+	struct request
+	{
+		std::string file_name;
+		/// offset of range in bytes
+		uint64_t offset;
+		/// size of range in bytes, where size_t(-1) reads until the end of the file
+		size_t size;
+		/// memory receiving the data or 0 to read into the buffer of the result
+		char* destination;
+		/// construct request for whole file read into the result buffer
+		request(const std::string& _file_name = "", uint64_t _offset = 0, size_t _size = size_t(-1), char* _destination = 0) :
+			file_name(_file_name), offset(_offset), size(_size), destination(_destination) {}
+	};
+	/// result of a request
+	struct result
+	{
+		/// whether the requested range was read completely
+		bool success;
+		/// number of bytes read
+		size_t nr_bytes_read;
+		/// data of requests without destination
+		std::vector<char> buffer;
+		/// construct failed result
+		result() : success(false), nr_bytes_read(0) {}
+	};
+	/// handler called with the index of the request in its batch and its result
+	typedef std::function<void(size_t, result&)> completion_handler;
+protected:
+	struct job;
+	/// part of a request processed by one worker
+	struct piece
+	{
+		std::shared_ptr<job> owner;
+		uint64_t offset;
+		size_t size;
+		char* destination;
+	};
+	size_t piece_size;
+	std::vector<std::thread> workers;
+	std::mutex queue_mutex;
+	std::condition_variable queue_condition, idle_condition;
+	std::deque<piece> pieces;
+	/// number of submitted requests that are not completed yet
+	size_t nr_pending_jobs;
+	bool stop_workers;
+	/// function of worker threads
+	void worker_loop();
+	/// split job into pieces and queue them
+	void submit(const std::shared_ptr<job>& j);
+	/// complete job after its last piece has been read
+	void finish(job& j);
+	/// no copies
+	async_io(const async_io&);
+	async_io& operator = (const async_io&);
+public:
+	/// start nr_threads workers, where 0 selects one per hardware thread but at least 4 to keep several reads in flight
+	async_io(unsigned nr_threads = 0, size_t _piece_size = size_t(1) << 22);
+	/// wait for all requests and stop workers
+	~async_io();
+	/// return number of worker threads
+	unsigned get_nr_threads() const { return unsigned(workers.size()); }
+	/// return size of the pieces into which large requests are split
+	size_t get_piece_size() const { return piece_size; }
+	/// submit a single request
+	std::future<result> read(const request& r);
+	/// submit a batch of requests and return one future per request
+	std::vector<std::future<result> > read(const std::vector<request>& batch);
+	/// submit a batch of requests whose results are passed to the handler on completion
+	void read(const std::vector<request>& batch, const completion_handler& handler);
+	/// read file into a scratch buffer and drop the data, such that later reads of the file are served from the page cache
+	void read_ahead(const std::string& file_name);
+	/// wait until all submitted requests are completed, including their completion handlers
+	void wait();
+	/// determine size of file and return false if it cannot be accessed
+	static bool get_file_size(const std::string& file_name, uint64_t& size);
+	/// read range of file with positional reads and return number of bytes read, which is smaller than size at the end of the file or on errors
+	static size_t read_range(const std::string& file_name, uint64_t offset, size_t size, char* destination);
+};
+
+	}
+}
+
+#include <cgv/config/lib_end.h>
@@ -10,7 +10,11 @@ namespace cgv {
 * hiding the ugly win32 api calls
 * 
 * linux-support by using 64bit pointer, LFS required in kernel
+*
+* readers that parse or randomly access whole files should prefer mapped_file,
+* which avoids the copy into heap memory and supports prefetching
 */
+
 class CGV_API big_binary_file
 {
 public:
@@ -0,0 +1,296 @@
+#include "mapped_file.h"
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+
+namespace cgv {
+	namespace utils {
+
+mapped_file::mapped_file() : mode(MA_READ_ONLY), file_handle(0), mapping_handle(0), mapped(false), data(0), size(0), prefetch_busy(false), stop_prefetching(false)
+{
+}
+
+mapped_file::mapped_file(const std::string& _file_name, access_mode _mode) : mode(MA_READ_ONLY), file_handle(0), mapping_handle(0), mapped(false), data(0), size(0), prefetch_busy(false), stop_prefetching(false)
+{
+	open(_file_name, _mode);
+}
+
+mapped_file::~mapped_file()
+{
+	close();
+}
+
+bool mapped_file::fail(const std::string& message)
+{
+#ifdef _WIN32
+	std::cerr << "mapped_file: " << message << " " << file_name << " (error " << GetLastError() << ")" << std::endl;
+	if (mapping_handle)
+		CloseHandle((HANDLE)mapping_handle);
+	if (file_handle)
+		CloseHandle((HANDLE)file_handle);
+#else
+	std::cerr << "mapped_file: " << message << " " << file_name << " (" << strerror(errno) << ")" << std::endl;
+#endif
+	file_handle = mapping_handle = 0;
+	data = 0;
+	size = 0;
+	return false;
+}
+
+bool mapped_file::open(const std::string& _file_name, access_mode _mode)
+{
+	close();
+	file_name = _file_name;
+	mode = _mode;
+#ifdef _WIN32
+	HANDLE fh = CreateFileA(file_name.c_str(), mode == MA_READ_ONLY ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+		mode == MA_READ_ONLY ? FILE_SHARE_READ : 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fh == INVALID_HANDLE_VALUE)
+		return fail("could not open");
+	file_handle = fh;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(fh, &file_size))
+		return fail("could not determine size of");
+	size = size_t(file_size.QuadPart);
+	// empty files cannot be mapped
+	if (size > 0) {
+		HANDLE mh = CreateFileMappingA(fh, NULL, mode == MA_READ_ONLY ? PAGE_READONLY : PAGE_READWRITE, 0, 0, NULL);
+		if (mh == NULL)
+			return fail("could not create mapping of");
+		mapping_handle = mh;
+		data = reinterpret_cast<char*>(MapViewOfFile(mh, mode == MA_READ_ONLY ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, 0));
+		if (data == 0)
+			return fail("could not map");
+	}
+#else
+	int fd = ::open(file_name.c_str(), mode == MA_READ_ONLY ? O_RDONLY : O_RDWR);
+	if (fd == -1)
+		return fail("could not open");
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		return fail("could not determine size of");
+	}
+	size = size_t(st.st_size);
+	if (size > 0) {
+		void* ptr = mmap(0, size, mode == MA_READ_ONLY ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		// the mapping stays valid after closing the descriptor
+		::close(fd);
+		if (ptr == MAP_FAILED)
+			return fail("could not map");
+		data = reinterpret_cast<char*>(ptr);
+	}
+	else
+		::close(fd);
+#endif
+	mapped = true;
+	return true;
+}
+
+bool mapped_file::create(const std::string& _file_name, size_t _size)
+{
+	close();
+	file_name = _file_name;
+	mode = MA_READ_WRITE;
+#ifdef _WIN32
+	HANDLE fh = CreateFileA(file_name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fh == INVALID_HANDLE_VALUE)
+		return fail("could not create");
+	file_handle = fh;
+	LARGE_INTEGER new_size;
+	new_size.QuadPart = LONGLONG(_size);
+	if (!SetFilePointerEx(fh, new_size, NULL, FILE_BEGIN) || !SetEndOfFile(fh))
+		return fail("could not resize");
+	size = _size;
+	if (size > 0) {
+		HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READWRITE, 0, 0, NULL);
+		if (mh == NULL)
+			return fail("could not create mapping of");
+		mapping_handle = mh;
+		data = reinterpret_cast<char*>(MapViewOfFile(mh, FILE_MAP_WRITE, 0, 0, 0));
+		if (data == 0)
+			return fail("could not map");
+	}
+#else
+	int fd = ::open(file_name.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd == -1)
+		return fail("could not create");
+	if (ftruncate(fd, off_t(_size)) != 0) {
+		::close(fd);
+		return fail("could not resize");
+	}
+	size = _size;
+	if (size > 0) {
+		void* ptr = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (ptr == MAP_FAILED)
+			return fail("could not map");
+		data = reinterpret_cast<char*>(ptr);
+	}
+	else
+		::close(fd);
+#endif
+	mapped = true;
+	return true;
+}
+
+void mapped_file::close()
+{
+	stop_prefetch_thread();
+	if (!mapped)
+		return;
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping_handle)
+		CloseHandle((HANDLE)mapping_handle);
+	if (file_handle)
+		CloseHandle((HANDLE)file_handle);
+#else
+	if (data)
+		munmap(data, size);
+#endif
+	file_handle = mapping_handle = 0;
+	mapped = false;
+	data = 0;
+	size = 0;
+}
+
+mapped_file::view mapped_file::get_view(size_t offset, size_t length) const
+{
+	offset = std::min(offset, size);
+	length = std::min(length, size - offset);
+	return view(data + offset, data + offset + length);
+}
+
+bool mapped_file::page_range(size_t& offset, size_t& length) const
+{
+	if (offset >= size || length == 0)
+		return false;
+	length = std::min(length, size - offset);
+	size_t page_offset = offset % get_page_size();
+	offset -= page_offset;
+	length += page_offset;
+	return true;
+}
+
+bool mapped_file::advise(access_hint hint, size_t offset, size_t length)
+{
+	if (!page_range(offset, length))
+		return false;
+#ifdef _WIN32
+	// windows only supports explicit prefetching of ranges
+	if (hint != AH_WILL_NEED)
+		return false;
+#if _WIN32_WINNT >= 0x0602
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = data + offset;
+	range.NumberOfBytes = length;
+	return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) != 0;
+#else
+	return false;
+#endif
+#else
+	static const int advice[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED };
+	return madvise(data + offset, length, advice[hint]) == 0;
+#endif
+}
+
+void mapped_file::prefetch(size_t offset, size_t length)
+{
+	if (!page_range(offset, length))
+		return;
+	advise(AH_WILL_NEED, offset, length);
+	std::unique_lock<std::mutex> lock(prefetch_mutex);
+	if (!prefetch_thread.joinable()) {
+		stop_prefetching = false;
+		prefetch_thread = std::thread(&mapped_file::prefetch_loop, this);
+	}
+	// queue pieces of bounded size such that closing the file does not wait for long ranges
+	const size_t max_piece_size = size_t(1) << 22;
+	for (size_t piece_offset = 0; piece_offset < length; piece_offset += max_piece_size)
+		prefetch_ranges.push_back(std::make_pair(offset + piece_offset, std::min(max_piece_size, length - piece_offset)));
+	prefetch_condition.notify_all();
+}
+
+void mapped_file::prefetch_loop()
+{
+	size_t page_size = get_page_size();
+	std::unique_lock<std::mutex> lock(prefetch_mutex);
+	while (true) {
+		prefetch_busy = false;
+		prefetch_condition.notify_all();
+		prefetch_condition.wait(lock, [this]() { return stop_prefetching || !prefetch_ranges.empty(); });
+		if (stop_prefetching)
+			break;
+		std::pair<size_t, size_t> range = prefetch_ranges.front();
+		prefetch_ranges.pop_front();
+		prefetch_busy = true;
+		lock.unlock();
+		// touch one byte per page, where the volatile sum keeps the reads from being optimized away
+		volatile char sum = 0;
+		for (size_t i = 0; i < range.second; i += page_size)
+			sum += data[range.first + i];
+		lock.lock();
+	}
+}
+
+void mapped_file::wait_for_prefetch()
+{
+	std::unique_lock<std::mutex> lock(prefetch_mutex);
+	prefetch_condition.wait(lock, [this]() { return !prefetch_thread.joinable() || (prefetch_ranges.empty() && !prefetch_busy); });
+}
+
+void mapped_file::stop_prefetch_thread()
+{
+	{
+		std::unique_lock<std::mutex> lock(prefetch_mutex);
+		if (!prefetch_thread.joinable())
+			return;
+		stop_prefetching = true;
+		prefetch_ranges.clear();
+		prefetch_condition.notify_all();
+	}
+	prefetch_thread.join();
+	prefetch_busy = false;
+}
+
+bool mapped_file::flush()
+{
+	if (mode != MA_READ_WRITE || data == 0)
+		return mapped;
+#ifdef _WIN32
+	return FlushViewOfFile(data, 0) != 0 && FlushFileBuffers((HANDLE)file_handle) != 0;
+#else
+	return msync(data, size, MS_SYNC) == 0;
+#endif
+}
+
+size_t mapped_file::get_page_size()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return size_t(info.dwPageSize);
+#else
+	static size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+	return page_size;
+#endif
+}
+
+	}
+}
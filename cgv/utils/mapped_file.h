@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "lib_begin.h"
+
+namespace cgv {
+	namespace utils {
+
+/** memory mapping of a file, which gives access to the file content without copying it into heap memory. Pages are
+    loaded from the page cache or the disk when they are first accessed. Access pattern hints are forwarded to the
+	operating system (madvise on posix systems and PrefetchVirtualMemory on windows). In addition, prefetch() queues
+	ranges for a background thread that touches one byte per page such that a parser following behind does not stall
+	on page faults. Empty files can be opened and result in an empty mapping with null data pointer. */
+class CGV_API mapped_file
+{
+public:
+	/// access modes
+	enum access_mode { MA_READ_ONLY, MA_READ_WRITE };
+	/// access pattern hints
+	enum access_hint { AH_NORMAL, AH_SEQUENTIAL, AH_RANDOM, AH_WILL_NEED, AH_DONT_NEED };
+	/// read only view of a byte range of the mapping
+	struct view
+	{
+		const char* begin;
+		const char* end;
+		/// construct empty view
+		view() : begin(0), end(0) {}
+		/// construct view of range
+		view(const char* _begin, const char* _end) : begin(_begin), end(_end) {}
+		/// return size in bytes
+		size_t size() const { return size_t(end - begin); }
+		/// check whether view is empty
+		bool empty() const { return begin == end; }
+	};
+protected:
+	std::string file_name;
+	access_mode mode;
+	/// platform specific handles, only used on windows
+	void* file_handle;
+	void* mapping_handle;
+	/// whether a file is mapped
+	bool mapped;
+	/// begin and size of the mapping
+	char* data;
+	size_t size;
+	/**@name background prefetching*/
+	//@{
+	std::thread prefetch_thread;
+	std::mutex prefetch_mutex;
+	std::condition_variable prefetch_condition;
+	std::deque<std::pair<size_t, size_t> > prefetch_ranges;
+	bool prefetch_busy;
+	bool stop_prefetching;
+	/// function of prefetch thread
+	void prefetch_loop();
+	/// stop prefetch thread and drop pending ranges
+	void stop_prefetch_thread();
+	//@}
+	/// report error with system error message and close file
+	bool fail(const std::string& message);
+	/// clamp range to the mapping and align its begin to the page size
+	bool page_range(size_t& offset, size_t& length) const;
+	/// no copies
+	mapped_file(const mapped_file&);
+	mapped_file& operator = (const mapped_file&);
+public:
+	/// construct without opening a file
+	mapped_file();
+	/// construct and open file
+	mapped_file(const std::string& _file_name, access_mode _mode = MA_READ_ONLY);
+	/// close mapping on destruction
+	~mapped_file();
+	/// open and map an existing file, return false and print an error if this fails
+	bool open(const std::string& _file_name, access_mode _mode = MA_READ_ONLY);
+	/// create file or resize existing file to the given size and map it read write
+	bool create(const std::string& _file_name, size_t _size);
+	/// unmap and close file
+	void close();
+	/// check whether a file is mapped
+	bool is_open() const { return mapped; }
+	/// return name of mapped file
+	const std::string& get_file_name() const { return file_name; }
+	/// return access mode
+	access_mode get_mode() const { return mode; }
+	/// return size of file in bytes
+	size_t get_size() const { return size; }
+	/// return pointer to the begin of the mapping
+	const char* get_data() const { return data; }
+	/// return writable pointer to the begin of the mapping or 0 for read only mappings
+	char* ref_data() { return mode == MA_READ_WRITE ? data : 0; }
+	/// return begin of mapping
+	const char* begin() const { return data; }
+	/// return end of mapping
+	const char* end() const { return data + size; }
+	/// return view of the mapping
+	view get_view() const { return view(begin(), end()); }
+	/// return view of given range clamped to the mapping
+	view get_view(size_t offset, size_t length) const;
+	/// give access pattern hint for the given range or the whole mapping and return whether it was accepted by the system
+	bool advise(access_hint hint, size_t offset = 0, size_t length = size_t(-1));
+	/// asynchronously load the given range, which is queued for the background thread
+	void prefetch(size_t offset, size_t length);
+	/// wait until all queued prefetch ranges have been processed
+	void wait_for_prefetch();
+	/// write back modified pages of read write mappings
+	bool flush();
+	/// return page size of the system, which is also the alignment of advise ranges
+	static size_t get_page_size();
+};
+
+	}
+}
+
+#include <cgv/config/lib_end.h>
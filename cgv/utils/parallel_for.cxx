@@ -0,0 +1,111 @@
+#include "parallel_for.h"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace cgv {
+	namespace utils {
+
+namespace {
+	/// tasks of one call to parallel_for_tasks
+	struct task_group
+	{
+		const std::function<void(unsigned)>& f;
+		unsigned nr_tasks;
+		std::atomic<unsigned> next_task;
+		std::atomic<unsigned> nr_finished_tasks;
+		task_group(const std::function<void(unsigned)>& _f, unsigned _nr_tasks) : f(_f), nr_tasks(_nr_tasks), next_task(0), nr_finished_tasks(0) {}
+	};
+	/// worker threads that process the task groups in the order of submission
+	class thread_pool
+	{
+		std::mutex mutex;
+		std::condition_variable work_condition, finish_condition;
+		std::deque<std::shared_ptr<task_group> > groups;
+		/// remove group from the queue if it is still queued, must be called with locked mutex
+		void remove(const std::shared_ptr<task_group>& g)
+		{
+			for (auto iter = groups.begin(); iter != groups.end(); ++iter)
+				if (*iter == g) {
+					groups.erase(iter);
+					break;
+				}
+		}
+		/// execute tasks of group until all of them have been taken
+		void process(task_group& g)
+		{
+			unsigned i;
+			while ((i = g.next_task++) < g.nr_tasks) {
+				g.f(i);
+				if (++g.nr_finished_tasks == g.nr_tasks) {
+					std::lock_guard<std::mutex> lock(mutex);
+					finish_condition.notify_all();
+				}
+			}
+		}
+		void work()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (true) {
+				work_condition.wait(lock, [this]() { return !groups.empty(); });
+				std::shared_ptr<task_group> g = groups.front();
+				lock.unlock();
+				process(*g);
+				lock.lock();
+				remove(g);
+			}
+		}
+	public:
+		/// start one worker less than hardware threads, as the calling thread takes part in the processing, but at least one
+		thread_pool()
+		{
+			unsigned nr_threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+			for (unsigned i = 0; i < nr_threads; ++i)
+				std::thread(&thread_pool::work, this).detach();
+		}
+		void run(unsigned nr_tasks, const std::function<void(unsigned)>& f)
+		{
+			std::shared_ptr<task_group> g(new task_group(f, nr_tasks));
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				groups.push_back(g);
+			}
+			work_condition.notify_all();
+			process(*g);
+			std::unique_lock<std::mutex> lock(mutex);
+			remove(g);
+			finish_condition.wait(lock, [&g]() { return g->nr_finished_tasks == g->nr_tasks; });
+		}
+	};
+	/// return pool, which is never destructed such that workers need not be joined during static destruction
+	thread_pool& ref_thread_pool()
+	{
+		static thread_pool& pool = *new thread_pool();
+		return pool;
+	}
+}
+
+unsigned get_nr_chunks(size_t n, size_t min_chunk_size, unsigned nr_threads)
+{
+	if (nr_threads == 0)
+		nr_threads = std::max(1u, std::thread::hardware_concurrency());
+	return unsigned(std::max(size_t(1), std::min(size_t(nr_threads), n / std::max(min_chunk_size, size_t(1)))));
+}
+
+void parallel_for_tasks(unsigned nr_tasks, const std::function<void(unsigned)>& f)
+{
+	if (nr_tasks == 0)
+		return;
+	if (nr_tasks == 1) {
+		f(0);
+		return;
+	}
+	ref_thread_pool().run(nr_tasks, f);
+}
+
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+
+#include "lib_begin.h"
+
+namespace cgv {
+	namespace utils {
+
+/** return the number of chunks used to process n items concurrently, which is at most nr_threads (0 selects one per
+    hardware thread) and keeps at least min_chunk_size items per chunk */
+extern CGV_API unsigned get_nr_chunks(size_t n, size_t min_chunk_size = 1, unsigned nr_threads = 0);
+
+/** call f(i) for all i in [0,nr_tasks) concurrently and return after all calls have finished. The calls are executed by
+    the calling thread and a pool of worker threads, which is created on first use and persists across calls, such that
+	repeated calls do not create threads. Calls can be nested, where a task that calls parallel_for_tasks itself
+	processes the nested tasks that no idle worker takes. */
+extern CGV_API void parallel_for_tasks(unsigned nr_tasks, const std::function<void(unsigned)>& f);
+
+/// split [0,n) into nr_chunks chunks of equal size and call f(chunk_index, begin, end) concurrently for each chunk
+template <typename F>
+void for_each_chunk(size_t n, unsigned nr_chunks, const F& f)
+{
+	if (nr_chunks <= 1) {
+		f(0u, size_t(0), n);
+		return;
+	}
+	size_t chunk_size = (n + nr_chunks - 1) / nr_chunks;
+	parallel_for_tasks(nr_chunks, [&](unsigned c) { f(c, std::min(n, c*chunk_size), std::min(n, (c + 1)*chunk_size)); });
+}
+
+/// process [0,n) concurrently with f(begin, end) in chunks of at least min_chunk_size items with at most nr_threads threads
+template <typename F>
+void parallel_for(size_t n, size_t min_chunk_size, const F& f, unsigned nr_threads = 0)
+{
+	for_each_chunk(n, get_nr_chunks(n, min_chunk_size, nr_threads), [&f](unsigned, size_t begin, size_t end) { f(begin, end); });
+}
+
+	}
+}
+
+#include <cgv/config/lib_end.h>
@@ -1,6 +1,7 @@
 #include "scan.h"
 
 #include <stdlib.h>
+#include <math.h>
 #include <algorithm>
 
 namespace cgv {
@@ -462,6 +463,106 @@ bool is_double(const std::string& s, double& value)
 	return is_double(&s[0], &s[0]+s.size(), value);
 }
 
+/// skip white spaces as done by the conversion specifiers of sscanf
+static inline const char* skip_white_spaces(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == '\v' || *p == '\f'))
+		++p;
+	return p;
+}
+
+const char* parse_int(const char* begin, const char* end, int& value)
+{
+	const char* p = skip_white_spaces(begin, end);
+	bool negative = false;
+	if (p < end && (*p == '+' || *p == '-'))
+		negative = *p++ == '-';
+	if (p == end || *p < '0' || *p > '9')
+		return 0;
+	long long v = 0;
+	do {
+		if (v < 0x7fffffffLL)
+			v = 10 * v + (*p - '0');
+	} while (++p < end && *p >= '0' && *p <= '9');
+	if (v > 0x7fffffffLL)
+		v = 0x7fffffffLL;
+	value = int(negative ? -v : v);
+	return p;
+}
+
+const char* parse_double(const char* begin, const char* end, double& value)
+{
+	static const double powers_of_ten[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const char* p = skip_white_spaces(begin, end);
+	bool negative = false;
+	if (p < end && (*p == '+' || *p == '-'))
+		negative = *p++ == '-';
+	// accumulate up to 19 significant digits in an integer mantissa
+	unsigned long long mantissa = 0;
+	int nr_significant_digits = 0;
+	int exponent = 0;
+	bool found_digit = false;
+	for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+		found_digit = true;
+		if (nr_significant_digits < 19) {
+			mantissa = 10 * mantissa + (*p - '0');
+			if (mantissa != 0)
+				++nr_significant_digits;
+		}
+		else
+			++exponent;
+	}
+	if (p < end && *p == '.') {
+		for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+			found_digit = true;
+			if (nr_significant_digits < 19) {
+				mantissa = 10 * mantissa + (*p - '0');
+				if (mantissa != 0)
+					++nr_significant_digits;
+				--exponent;
+			}
+		}
+	}
+	if (!found_digit)
+		return 0;
+	// optional exponent is only consumed if it contains at least one digit
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* q = p + 1;
+		bool negative_exponent = false;
+		if (q < end && (*q == '+' || *q == '-'))
+			negative_exponent = *q++ == '-';
+		if (q < end && *q >= '0' && *q <= '9') {
+			int e = 0;
+			for (; q < end && *q >= '0' && *q <= '9'; ++q)
+				if (e < 100000)
+					e = 10 * e + (*q - '0');
+			exponent += negative_exponent ? -e : e;
+			p = q;
+		}
+	}
+	double v = double(mantissa);
+	if (mantissa != 0 && exponent != 0) {
+		if (nr_significant_digits <= 15 && exponent >= -22 && exponent <= 22)
+			v = exponent < 0 ? v / powers_of_ten[-exponent] : v * powers_of_ten[exponent];
+		else // split power to avoid intermediate under- or overflow
+			v = v * pow(10.0, exponent / 2) * pow(10.0, exponent - exponent / 2);
+	}
+	value = negative ? -v : v;
+	return p;
+}
+
+const char* parse_float(const char* begin, const char* end, float& value)
+{
+	double v;
+	const char* p = parse_double(begin, end, v);
+	if (p)
+		value = float(v);
+	return p;
+}
+
 
 bool is_year(const char* begin, const char* end, unsigned short& year, bool short_allowed)
 {
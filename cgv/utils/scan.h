@@ -93,6 +93,15 @@ extern CGV_API bool is_integer(const std::string& s, int& value);
 extern CGV_API bool is_double(const char* begin, const char* end, double& value);
 /// check if the passed string defines a double value. If yes, store the value in the passed reference.
 extern CGV_API bool is_double(const std::string& s, double& value);
+/** locale independent parsing of an integer at the beginning of the text range [\c begin, \c end) after skipping white spaces.
+    Like sscanf, only the longest valid prefix is consumed. Return pointer behind the parsed number or 0 if no number was found. */
+extern CGV_API const char* parse_int(const char* begin, const char* end, int& value);
+/** locale independent parsing of a floating point number in decimal notation with optional exponent at the beginning of the text
+    range [\c begin, \c end) after skipping white spaces. Numbers with up to 15 significant digits and decimal exponents in [-22,22]
+	are converted exactly, all others with an error of a few ulps. Return pointer behind the parsed number or 0 if no number was found. */
+extern CGV_API const char* parse_double(const char* begin, const char* end, double& value);
+/// same as parse_double but for single precision values
+extern CGV_API const char* parse_float(const char* begin, const char* end, float& value);
 /// check and extract year from string token [\c begin, \c end]
 extern CGV_API bool is_year(const char* begin, const char* end, unsigned short& year, bool short_allowed = true);
 /// check and extract year from string \c s
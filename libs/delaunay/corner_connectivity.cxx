@@ -12,6 +12,12 @@ void corner_connectivity::clear_triangles()
 	C.clear(); 
 }
 
+/// reserve memory for the given number of triangles
+void corner_connectivity::reserve_triangles(unsigned int nr_triangles)
+{
+	C.reserve(3*nr_triangles);
+}
+
 /// add a triangle with all edges boundary edges
 void corner_connectivity::add_triangle(unsigned int v0, unsigned int v1, unsigned int v2)
 {
@@ -112,6 +112,8 @@ public:
 	corner_connectivity();
 	/// remove all triangles
 	void clear_triangles();
+	/// reserve memory for the given number of triangles
+	void reserve_triangles(unsigned int nr_triangles);
 	/// add a triangle with all edges boundary edges
 	void add_triangle(unsigned int v0, unsigned int v1, unsigned int v2);
 	/// add a triangle with the given cornern information
@@ -1,12 +1,102 @@
 #include "delaunay_mesh.h"
 #include <iostream>
 #include <algorithm>
+#include <random>
+#include <thread>
+#include <cstdint>
 #include <math.h>
 
+namespace {
+	/// return the index of cell (x,y) of a 2^16 x 2^16 grid along a hilbert curve
+	unsigned int hilbert_index(unsigned int x, unsigned int y)
+	{
+		unsigned int d = 0;
+		for (unsigned int s = 1 << 15; s > 0; s >>= 1) {
+			unsigned int rx = (x & s) > 0 ? 1 : 0;
+			unsigned int ry = (y & s) > 0 ? 1 : 0;
+			d += s*s*((3*rx) ^ ry);
+			if (ry == 0) {
+				if (rx == 1) {
+					x = 0xffff - x;
+					y = 0xffff - y;
+				}
+				std::swap(x, y);
+			}
+		}
+		return d;
+	}
+	/// return a positive value if p0, p1 and p2 are in counter clockwise order and zero if they are collinear
+	template <class P>
+	double orientation(const P& p0, const P& p1, const P& p2)
+	{
+		return ((double)p1.x()-p0.x())*((double)p2.y()-p0.y()) - ((double)p1.y()-p0.y())*((double)p2.x()-p0.x());
+	}
+	/// return a positive value if p3 lies inside the circum circle of the counter clockwise triangle p0, p1, p2
+	template <class P>
+	double in_circle(const P& p0, const P& p1, const P& p2, const P& p3)
+	{
+		double x0 = (double)p0.x()-p3.x(), y0 = (double)p0.y()-p3.y();
+		double x1 = (double)p1.x()-p3.x(), y1 = (double)p1.y()-p3.y();
+		double x2 = (double)p2.x()-p3.x(), y2 = (double)p2.y()-p3.y();
+		return (x0*x0+y0*y0)*(x1*y2-x2*y1) + (x1*x1+y1*y1)*(x2*y0-x0*y2) + (x2*x2+y2*y2)*(x0*y1-x1*y0);
+	}
+	/// lexicographic order of points
+	template <class P>
+	bool lex_less(const P& p0, const P& p1)
+	{
+		return p0.x() < p1.x() || (p0.x() == p1.x() && p0.y() < p1.y());
+	}
+}
+
 /// construct empty triangle mesh
 template <class T>
 delaunay_mesh<T>::delaunay_mesh() 
 {
+	insertion_order = IO_INPUT;
+	nr_threads = 1;
+	parallel_threshold = 100000;
+}
+
+/// set the order in which compute_triangulation inserts the points
+template <class T>
+void delaunay_mesh<T>::set_insertion_order(InsertionOrder io)
+{
+	insertion_order = io;
+}
+
+/// return the order in which compute_triangulation inserts the points
+template <class T>
+typename delaunay_mesh<T>::InsertionOrder delaunay_mesh<T>::get_insertion_order() const
+{
+	return insertion_order;
+}
+
+/// set the number of threads used by compute_triangulation, 0 for one per hardware thread
+template <class T>
+void delaunay_mesh<T>::set_nr_threads(unsigned int n)
+{
+	nr_threads = n;
+}
+
+/// return the number of threads used by compute_triangulation
+template <class T>
+unsigned int delaunay_mesh<T>::get_nr_threads() const
+{
+	return nr_threads;
+}
+
+/// set the minimum number of points for the parallel construction
+template <class T>
+void delaunay_mesh<T>::set_parallel_threshold(unsigned int n)
+{
+	parallel_threshold = n;
+}
+
+/// return the minimum number of points for the parallel construction
+template <class T>
+unsigned int delaunay_mesh<T>::get_parallel_threshold() const
+{
+	return parallel_threshold;
 }
 
 /// return index of the nearest neighbor of the given point
@@ -57,49 +147,9 @@ unsigned int delaunay_mesh<T>::find_nearest_neighbor(const point_type& p, unsign
 template <class T>
 bool delaunay_mesh<T>::is_locally_delaunay(unsigned int ci) const
 {
-	const point_type& p0 = T::p_of_vi(T::vi_of_ci(ci));
-	const point_type& p1 = T::p_of_vi(T::vi_of_ci(T::next(ci)));
-	const point_type& p2 = T::p_of_vi(T::vi_of_ci(T::prev(ci)));
-	const point_type& p3 = T::p_of_vi(T::vi_of_ci(T::inv(ci)));
-	const coord_type& x0 = p0.x();
-	const coord_type& y0 = p0.y();
-	      coord_type  r0 = x0*x0+y0*y0;
-	const coord_type& x1 = p1.x();
-	const coord_type& y1 = p1.y();
-	      coord_type  r1 = x1*x1+y1*y1;
-	const coord_type& x2 = p2.x();
-	const coord_type& y2 = p2.y();
-	      coord_type  r2 = x2*x2+y2*y2;
-	const coord_type& x3 = p3.x();
-	const coord_type& y3 = p3.y();
-	      coord_type  r3 = x3*x3+y3*y3;
-	coord_type det = 
-		x0 * ( y1 * r2 
-	        + y2 * r3 
-	        + y3 * r1 )
-	 + x1 * ( y0 * r3 
-	        + y2 * r0 
-	        + y3 * r2 )
-	 + x2 * ( y0 * r1 
-	        + y1 * r3 
-	        + y3 * r0 )
-	 + x3 * ( y0 * r2 
-	        + y1 * r0 
-	        + y2 * r1 )
-	 - (
-	   x0 * ( y1 * r3 
-	        + y2 * r1 
-	        + y3 * r2 )
-	 + x1 * ( y0 * r2 
-	        + y2 * r3 
-	        + y3 * r0 )
-	 + x2 * ( y0 * r3 
-	        + y1 * r0 
-	        + y3 * r1 )
-	 + x3 * ( y0 * r1 
-	        + y1 * r2 
-	        + y2 * r0 ) );
-	return det < 0;
+	// evaluate determinant relative to the opposite point to reduce cancellation
+	return in_circle(T::p_of_vi(T::vi_of_ci(ci)), T::p_of_vi(T::vi_of_ci(T::next(ci))),
+	                 T::p_of_vi(T::vi_of_ci(T::prev(ci))), T::p_of_vi(T::vi_of_ci(T::inv(ci)))) < 0;
 }
 
 /// insert a vertex by keeping a delaunay triangulation. If a vertex with the same location already exists, ignore vertex and return index of vertex with identical location
@@ -144,3 +194,331 @@ void delaunay_mesh<T>::flip_edges_around_vertex_to_validate(unsigned int ci, uns
 		}
 	}
 }
+
+/// flip the edges opposite to the given corners and all edges affected by flips until they are locally delaunay
+template <class T>
+void delaunay_mesh<T>::flip_edges_to_validate(std::vector<unsigned int>& cis)
+{
+	while (!cis.empty()) {
+		unsigned int c0 = cis.back();
+		cis.pop_back();
+		if (T::is_opposite_to_border(c0))
+			continue;
+		unsigned int c3 = T::inv(c0);
+		if (in_circle(T::p_of_vi(T::vi_of_ci(c0)), T::p_of_vi(T::vi_of_ci(T::next(c0))), 
+			           T::p_of_vi(T::vi_of_ci(T::prev(c0))), T::p_of_vi(T::vi_of_ci(c3))) <= 0)
+			continue;
+		T::flip_edge(c0);
+		// the new edge is locally delaunay, check the four edges of the quadrilateral
+		cis.push_back(c0);
+		cis.push_back(T::prev(c0));
+		cis.push_back(c3);
+		cis.push_back(T::prev(c3));
+	}
+}
+
+/// permute the indices in [begin,end) according to the insertion order
+template <class T>
+void delaunay_mesh<T>::compute_insertion_order(unsigned int* begin, unsigned int* end, unsigned int seed) const
+{
+	unsigned int n = (unsigned int)(end - begin);
+	if (n < 2)
+		return;
+	if (insertion_order == IO_BRIO) {
+		std::mt19937 rand_gen(seed);
+		std::shuffle(begin, end, rand_gen);
+	}
+	// map bounding box to hilbert curve grid
+	const point_type& p0 = T::p_of_vi(*begin);
+	double x_min = p0.x(), x_max = p0.x(), y_min = p0.y(), y_max = p0.y();
+	for (unsigned int i = 1; i < n; ++i) {
+		const point_type& p = T::p_of_vi(begin[i]);
+		x_min = std::min(x_min, (double)p.x());
+		x_max = std::max(x_max, (double)p.x());
+		y_min = std::min(y_min, (double)p.y());
+		y_max = std::max(y_max, (double)p.y());
+	}
+	double x_scale = x_max > x_min ? 65535.0/(x_max-x_min) : 0.0;
+	double y_scale = y_max > y_min ? 65535.0/(y_max-y_min) : 0.0;
+	std::vector<uint64_t> keys(n);
+	for (unsigned int i = 0; i < n; ++i) {
+		const point_type& p = T::p_of_vi(begin[i]);
+		unsigned int hi = hilbert_index((unsigned int)((p.x()-x_min)*x_scale), (unsigned int)((p.y()-y_min)*y_scale));
+		keys[i] = ((uint64_t)hi << 32) | begin[i];
+	}
+	// brio sorts the rounds [n/2,n), [n/4,n/2), ... individually, where the direction alternates 
+	// such that each round starts close to where the previous round ended
+	unsigned int end_of_round = n;
+	bool reverse = false;
+	while (end_of_round > 0) {
+		unsigned int begin_of_round = (insertion_order == IO_BRIO && end_of_round > 128) ? end_of_round/2 : 0;
+		if (reverse)
+			std::sort(keys.begin()+begin_of_round, keys.begin()+end_of_round, std::greater<uint64_t>());
+		else
+			std::sort(keys.begin()+begin_of_round, keys.begin()+end_of_round);
+		reverse = !reverse;
+		end_of_round = begin_of_round;
+	}
+	for (unsigned int i = 0; i < n; ++i)
+		begin[i] = (unsigned int)keys[i];
+}
+
+/// move the points such that vertex vi gets the location of vertex order[vi]
+template <class T>
+void delaunay_mesh<T>::permute_points(const std::vector<unsigned int>& order)
+{
+	std::vector<point_type> P(order.size());
+	for (unsigned int vi = 0; vi < P.size(); ++vi)
+		P[vi] = T::p_of_vi(order[vi]);
+	for (unsigned int vi = 0; vi < P.size(); ++vi)
+		T::p_of_vi(vi) = P[vi];
+}
+
+/// triangulate all points in the order of their indices, starting the point location at the previously inserted vertex
+template <class T>
+void delaunay_mesh<T>::insert_points_in_order()
+{
+	unsigned int n = T::get_nr_vertices();
+	if (n < 3)
+		return;
+	// find a non degenerate initial triangle
+	const point_type& p0 = T::p_of_vi(0);
+	unsigned int v1 = 1;
+	while (v1 < n && T::sqr_dist(p0, T::p_of_vi(v1)) == 0)
+		++v1;
+	unsigned int v2 = v1+1;
+	while (v2 < n && !T::geometry_type::is_outside(T::p_of_vi(v2), p0, T::p_of_vi(v1)) && 
+		              !T::geometry_type::is_inside(T::p_of_vi(v2), p0, T::p_of_vi(v1)))
+		++v2;
+	if (v2 >= n)
+		return;
+	T::reserve_triangles(2*n);
+	T::reserve_vertices(n);
+	T::add_triangle(0, v1, v2);
+	unsigned int ci = 0;
+	for (unsigned int vi = 1; vi < n; ++vi) {
+		if (vi == v1 || vi == v2)
+			continue;
+		vertex_insertion_info vii = insert_vertex(vi, ci);
+		if (vii.insert_error)
+			continue;
+		ci = vii.is_duplicate ? vii.ci_of_vertex : T::ci_of_vi(vi);
+	}
+}
+
+/// split the points into vertical strips and sort each strip according to the insertion order
+template <class T>
+bool delaunay_mesh<T>::partition_points(std::vector<unsigned int>& order, unsigned int nr_partitions, std::vector<unsigned int>& partition_begins) const
+{
+	auto vertex_less = [this](unsigned int vi, unsigned int vj) { return lex_less(this->p_of_vi(vi), this->p_of_vi(vj)); };
+	unsigned int n = (unsigned int)order.size();
+	partition_begins.assign(1, 0);
+	for (unsigned int i = 1; i < nr_partitions; ++i) {
+		unsigned int split = (unsigned int)((uint64_t)n*i/nr_partitions);
+		std::nth_element(order.begin()+partition_begins.back(), order.begin()+split, order.end(), vertex_less);
+		// points with the location of the split point go to the right partition
+		unsigned int vs = order[split];
+		split = (unsigned int)(std::partition(order.begin()+partition_begins.back(), order.begin()+split,
+			[&](unsigned int vi) { return vertex_less(vi, vs); }) - order.begin());
+		if (split < partition_begins.back()+3)
+			return false;
+		partition_begins.push_back(split);
+	}
+	if (n < partition_begins.back()+3)
+		return false;
+	partition_begins.push_back(n);
+	std::vector<std::thread> threads;
+	for (unsigned int i = 0; i < nr_partitions; ++i)
+		threads.push_back(std::thread(&delaunay_mesh<T>::compute_insertion_order, this, 
+			&order[0]+partition_begins[i], &order[0]+partition_begins[i+1], i));
+	for (unsigned int i = 0; i < nr_partitions; ++i)
+		threads[i].join();
+	return true;
+}
+
+/// triangulate the sorted partitions in parallel and merge the triangulations
+template <class T>
+bool delaunay_mesh<T>::triangulate_partitions(const std::vector<unsigned int>& partition_begins)
+{
+	unsigned int nr_partitions = (unsigned int)partition_begins.size()-1;
+	std::vector<partition_mesh_type> partitions(nr_partitions);
+	std::vector<std::thread> threads;
+	for (unsigned int i = 0; i < nr_partitions; ++i)
+		threads.push_back(std::thread([this, &partitions, &partition_begins, i]() {
+			for (unsigned int vi = partition_begins[i]; vi < partition_begins[i+1]; ++vi)
+				partitions[i].add_point(this->p_of_vi(vi));
+			partitions[i].compute_triangulation();
+		}));
+	for (unsigned int i = 0; i < nr_partitions; ++i)
+		threads[i].join();
+
+	// append the triangles of the partitions with offsets to vertex and corner indices
+	T::clear_triangles();
+	T::reserve_triangles(2*T::get_nr_vertices());
+	T::reserve_vertices(T::get_nr_vertices());
+	for (unsigned int i = 0; i < nr_partitions; ++i) {
+		const partition_mesh_type& pm = partitions[i];
+		if (pm.get_nr_triangles() == 0)
+			return false;
+		unsigned int vo = partition_begins[i];
+		unsigned int co = T::get_nr_corners();
+		for (unsigned int ci = 0; ci < pm.get_nr_corners(); ci += 3) {
+			corner c[3];
+			for (unsigned int j = 0; j < 3; ++j) {
+				if (pm.is_opposite_to_border(ci+j))
+					c[j] = corner(pm.vi_of_ci(ci+j)+vo);
+				else
+					c[j] = corner(pm.vi_of_ci(ci+j)+vo, pm.inv(ci+j)+co);
+			}
+			T::connectivity_type::add_triangle(c[0], c[1], c[2]);
+		}
+	}
+	partitions.clear();
+
+	// close the gaps between neighboring partitions and restore the delaunay property
+	std::vector<unsigned int> cis;
+	for (unsigned int i = 1; i < nr_partitions; ++i) {
+		if (!merge_partitions(partition_begins[i-1], partition_begins[i], partition_begins[i+1], cis))
+			return false;
+		flip_edges_to_validate(cis);
+	}
+	return true;
+}
+
+/// return the corner opposite to the border edge leaving the given convex hull vertex in counter clockwise order
+template <class T>
+unsigned int delaunay_mesh<T>::find_outgoing_border_corner(unsigned int vi) const
+{
+	unsigned int c0 = T::prev(T::ci_of_vi(vi));
+	unsigned int ci = c0;
+	while (!T::is_opposite_to_border(ci)) {
+		ci = T::next(T::inv(ci));
+		if (ci == c0)
+			return -1;
+	}
+	return ci;
+}
+
+/// triangulate the region in between two convex triangulations
+template <class T>
+bool delaunay_mesh<T>::merge_partitions(unsigned int vi_begin, unsigned int vi_split, unsigned int vi_end, std::vector<unsigned int>& cis)
+{
+	// start with the lexicographically extreme triangulated vertices
+	unsigned int l = -1, r = -1;
+	for (unsigned int vi = vi_begin; vi < vi_split; ++vi)
+		if (T::ci_of_vi(vi) != (unsigned int)-1 && (l == (unsigned int)-1 || lex_less(T::p_of_vi(l), T::p_of_vi(vi))))
+			l = vi;
+	for (unsigned int vi = vi_split; vi < vi_end; ++vi)
+		if (T::ci_of_vi(vi) != (unsigned int)-1 && (r == (unsigned int)-1 || lex_less(T::p_of_vi(vi), T::p_of_vi(r))))
+			r = vi;
+	if (l == (unsigned int)-1 || r == (unsigned int)-1)
+		return false;
+	unsigned int cl = find_outgoing_border_corner(l);
+	unsigned int cr = find_outgoing_border_corner(r);
+	if (cl == (unsigned int)-1 || cr == (unsigned int)-1)
+		return false;
+
+	// find lower common tangent by moving l clockwise along the left and r counter clockwise along the right hull,
+	// where cl is opposite to the border edge ending in l and cr opposite to the border edge starting in r
+	cl = T::next_on_border(cl);
+	while (true) {
+		unsigned int vr = T::vi_of_ci(T::prev(cr));
+		double o = orientation(T::p_of_vi(l), T::p_of_vi(r), T::p_of_vi(vr));
+		if (o < 0) {
+			r = vr;
+			cr = T::prev_on_border(cr);
+			continue;
+		}
+		unsigned int vl = T::vi_of_ci(T::next(cl));
+		double o_l = orientation(T::p_of_vi(l), T::p_of_vi(r), T::p_of_vi(vl));
+		if (o_l < 0) {
+			l = vl;
+			cl = T::next_on_border(cl);
+			continue;
+		}
+		if (o == 0 || o_l == 0)
+			return false;
+		break;
+	}
+
+	// zip triangles from the lower to the upper common tangent, where cl is now opposite to the border edge starting
+	// in l, cr opposite to the border edge ending in r and cb opposite to the base edge from l to r
+	cl = T::prev_on_border(cl);
+	cr = T::next_on_border(cr);
+	unsigned int cb = -1;
+	while (true) {
+		unsigned int vl = T::vi_of_ci(T::prev(cl));
+		unsigned int vr = T::vi_of_ci(T::next(cr));
+		double o_l = orientation(T::p_of_vi(l), T::p_of_vi(r), T::p_of_vi(vl));
+		double o_r = orientation(T::p_of_vi(l), T::p_of_vi(r), T::p_of_vi(vr));
+		if (o_l == 0 || o_r == 0)
+			return false;
+		if (o_l < 0 && o_r < 0)
+			break;
+		unsigned int cn = T::get_nr_corners();
+		unsigned int cb_new;
+		if (o_l > 0 && (o_r < 0 || in_circle(T::p_of_vi(l), T::p_of_vi(r), T::p_of_vi(vl), T::p_of_vi(vr)) <= 0)) {
+			unsigned int cl_next = T::prev_on_border(cl);
+			T::connectivity_type::add_triangle(corner(l), corner(r, cl), corner(vl));
+			this->opposite(cl) = typename T::opposite_info(cn+1);
+			cb_new = cn;
+			l = vl;
+			cl = cl_next;
+		}
+		else {
+			unsigned int cr_next = T::next_on_border(cr);
+			T::connectivity_type::add_triangle(corner(l, cr), corner(r), corner(vr));
+			this->opposite(cr) = typename T::opposite_info(cn);
+			cb_new = cn+1;
+			r = vr;
+			cr = cr_next;
+		}
+		if (cb != (unsigned int)-1) {
+			this->opposite(cn+2) = typename T::opposite_info(cb);
+			this->opposite(cb) = typename T::opposite_info(cn+2);
+		}
+		cb = cb_new;
+		cis.push_back(cn);
+		cis.push_back(cn+1);
+		cis.push_back(cn+2);
+	}
+	return true;
+}
+
+/// reimplement to insert the points in the selected insertion order and in parallel partitions for large point sets
+template <class T>
+void delaunay_mesh<T>::compute_triangulation()
+{
+	compute_triangulation(0);
+}
+
+/// compute the triangulation of all points of a mesh without triangles
+template <class T>
+void delaunay_mesh<T>::compute_triangulation(std::vector<unsigned int>* permutation)
+{
+	unsigned int n = T::get_nr_vertices();
+	std::vector<unsigned int> order(n);
+	for (unsigned int vi = 0; vi < n; ++vi)
+		order[vi] = vi;
+	if (insertion_order == IO_INPUT || n < 3)
+		insert_points_in_order();
+	else {
+		unsigned int nr_partitions = nr_threads == 0 ? std::thread::hardware_concurrency() : nr_threads;
+		std::vector<unsigned int> partition_begins;
+		if (nr_partitions > 1 && n >= parallel_threshold && partition_points(order, nr_partitions, partition_begins)) {
+			permute_points(order);
+			if (!triangulate_partitions(partition_begins)) {
+				std::cerr << "delaunay_mesh: degenerate partitions, falling back to sequential triangulation" << std::endl;
+				T::clear_triangles();
+				insert_points_in_order();
+			}
+		}
+		else {
+			compute_insertion_order(&order[0], &order[0]+n, 0);
+			permute_points(order);
+			insert_points_in_order();
+		}
+	}
+	if (permutation)
+		permutation->swap(order);
+}
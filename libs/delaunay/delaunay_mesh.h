@@ -20,11 +20,55 @@ public:
 	typedef typename triangle_mesh_type::coord_type coord_type;
 	///
 	typedef typename triangle_mesh_type::vertex_insertion_info vertex_insertion_info;
+	/// type of the triangulations of the partitions in the parallel construction
+	typedef delaunay_mesh<triangle_mesh<mesh_geometry<coord_type, point_type> > > partition_mesh_type;
+	/// different orders in which compute_triangulation inserts the points
+	enum InsertionOrder {
+		IO_INPUT,   // insert points in the order of their indices
+		IO_HILBERT, // insert points along a hilbert curve
+		IO_BRIO     // biased randomized insertion order with rounds of doubling size, each sorted along a hilbert curve
+	};
+protected:
+	/// order in which compute_triangulation inserts the points
+	InsertionOrder insertion_order;
+	/// number of threads used to construct the triangulation, 0 for one per hardware thread
+	unsigned int nr_threads;
+	/// minimum number of points for the parallel construction
+	unsigned int parallel_threshold;
+	/// permute the indices in [begin,end) according to the insertion order
+	void compute_insertion_order(unsigned int* begin, unsigned int* end, unsigned int seed) const;
+	/// move the points such that vertex vi gets the location of vertex order[vi]
+	void permute_points(const std::vector<unsigned int>& order);
+	/// triangulate all points in the order of their indices, starting the point location at the previously inserted vertex
+	void insert_points_in_order();
+	/** split the points into nr_partitions vertical strips of equal size that are separated in lexicographic order and
+	    sort each strip according to the insertion order. Return false if the points cannot be split. */
+	bool partition_points(std::vector<unsigned int>& order, unsigned int nr_partitions, std::vector<unsigned int>& partition_begins) const;
+	/// triangulate the sorted partitions in parallel and merge the triangulations, return false for degenerate partitions
+	bool triangulate_partitions(const std::vector<unsigned int>& partition_begins);
+	/// return the corner opposite to the border edge leaving the given convex hull vertex in counter clockwise order
+	unsigned int find_outgoing_border_corner(unsigned int vi) const;
+	/** triangulate the region in between the convex triangulations of the vertices in [vi_begin,vi_split) and in 
+	    [vi_split,vi_end), where the first lie lexicographically before the latter, and append the new corners to cis. 
+		 Return false if the convex hulls are degenerate. */
+	bool merge_partitions(unsigned int vi_begin, unsigned int vi_split, unsigned int vi_end, std::vector<unsigned int>& cis);
 public:
 	/**@name construction*/
 	//@{
 	/// construct empty delaunay mesh
 	delaunay_mesh();
+	/// set the order in which compute_triangulation inserts the points
+	void set_insertion_order(InsertionOrder io);
+	/// return the order in which compute_triangulation inserts the points
+	InsertionOrder get_insertion_order() const;
+	/// set the number of threads used by compute_triangulation, 0 for one per hardware thread
+	void set_nr_threads(unsigned int n);
+	/// return the number of threads used by compute_triangulation
+	unsigned int get_nr_threads() const;
+	/// set the minimum number of points for the parallel construction, which defaults to 100000
+	void set_parallel_threshold(unsigned int n);
+	/// return the minimum number of points for the parallel construction
+	unsigned int get_parallel_threshold() const;
 	//@}
 
 	/**@name geometric predicates*/
@@ -40,7 +84,15 @@ public:
 	/// flip the edges in the one ring of vertex with given corner until all are valid meaning locally delaunay
 	virtual void flip_edges_around_vertex_to_validate(unsigned int ci, unsigned int n, std::vector<unsigned int>* touched_corners = 0);
 	/// reimplement vertex insertion in order to keep a delaunay triangulation. If a vertex with the same location already exists, ignore vertex and return index of vertex with identical location
-	vertex_insertion_info insert_vertex(unsigned int vi, unsigned int ci_start = 0, std::vector<unsigned int>* touched_corners = 0);
+	virtual vertex_insertion_info insert_vertex(unsigned int vi, unsigned int ci_start = 0, std::vector<unsigned int>* touched_corners = 0);
+	/// flip the edges opposite to the given corners and all edges affected by flips until they are locally delaunay
+	void flip_edges_to_validate(std::vector<unsigned int>& cis);
+	/// reimplement to insert the points in the selected insertion order and in parallel partitions for large point sets
+	void compute_triangulation();
+	/** compute the triangulation of all points of a mesh without triangles. Unless the insertion order is IO_INPUT the
+	    points are reordered in insertion order to keep vertices and corners of neighboring triangles close in memory. If
+		 given, the permutation is set to the previous index of each vertex. */
+	void compute_triangulation(std::vector<unsigned int>* permutation);
 	//@}
 };
 
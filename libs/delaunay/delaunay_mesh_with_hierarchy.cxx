@@ -59,8 +59,10 @@ void delaunay_mesh_with_hierarchy<T>::configure_hierarchy(unsigned int n)
 /// overload point localization to use hierarchy
 template <class T>
 typename delaunay_mesh_with_hierarchy<T>::point_location_info delaunay_mesh_with_hierarchy<T>::localize_point(
-	const point_type& p, unsigned int) const
+	const point_type& p, unsigned int ci_start) const
 {
+	if (H.empty())
+		return delaunay_mesh_type::triangle_mesh_type::localize_point(p, ci_start);
 	unsigned int vi = 0;
 	for (unsigned int hi = 0; hi < H.size(); ++hi)
 		vi = H[hi]->find_nearest_neighbor(p, H[hi]->ci_of_vi(vi));
@@ -69,8 +71,10 @@ typename delaunay_mesh_with_hierarchy<T>::point_location_info delaunay_mesh_with
 
 /// return index of the nearest neighbor of the given point
 template <class T>
-unsigned int delaunay_mesh_with_hierarchy<T>::find_nearest_neighbor(const point_type& p, unsigned int) const
+unsigned int delaunay_mesh_with_hierarchy<T>::find_nearest_neighbor(const point_type& p, unsigned int ci_start) const
 {
+	if (H.empty())
+		return delaunay_mesh_type::find_nearest_neighbor(p, ci_start);
 	unsigned int vi = 0;
 	for (unsigned int hi = 0; hi < H.size(); ++hi)
 		vi = H[hi]->find_nearest_neighbor(p, H[hi]->ci_of_vi(vi));
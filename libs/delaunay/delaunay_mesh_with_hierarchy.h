@@ -48,9 +48,9 @@ public:
 
 	/**@name geometric predicates*/
 	//@{
-	/// overload point localization to use hierarchy, the ci_start argument is ignored as its existence on the coarsest hierarchy level cannot be guaranteed
+	/// overload point localization to use hierarchy, the ci_start argument is only used as long as the hierarchy is empty as its existence on the coarsest hierarchy level cannot be guaranteed
 	point_location_info localize_point(const point_type& p, unsigned int ci_start = 0) const;
-	/// reimplement nearest neighbor search using the hierarchy
+	/// reimplement nearest neighbor search using the hierarchy, the ci_start argument is only used as long as the hierarchy is empty
 	unsigned int find_nearest_neighbor(const point_type& p, unsigned int ci_start = 0) const;
 	//@}
 	/// reimplement to construct the hierarchy levels
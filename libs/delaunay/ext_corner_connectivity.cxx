@@ -13,6 +13,12 @@ void ext_corner_connectivity::clear_triangles()
 	V.clear();
 }
 
+/// reserve memory for the corner indices of the given number of vertices
+void ext_corner_connectivity::reserve_vertices(unsigned int nr_vertices)
+{
+	V.reserve(nr_vertices);
+}
+
 /// add a triangle with all edges boundary edges
 void ext_corner_connectivity::add_triangle(unsigned int v0, unsigned int v1, unsigned int v2)
 {
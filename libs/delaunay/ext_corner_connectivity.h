@@ -17,6 +17,8 @@ public:
 	ext_corner_connectivity();
 	/// remove all triangles
 	void clear_triangles();
+	/// reserve memory for the corner indices of the given number of vertices
+	void reserve_vertices(unsigned int nr_vertices);
 	/// add a triangle with all edges boundary edges
 	void add_triangle(unsigned int v0, unsigned int v1, unsigned int v2);
 	/// add a triangle with the given cornern information
@@ -2,7 +2,13 @@
 #include <algorithm>
 #include <random>
 #include <fstream>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
 #include "ICP.h"
+#include "concurrency.h"
+
+using cgv::pointcloud::utility::parallel_for_range;
 
 namespace cgv {
 	namespace pointcloud {
@@ -15,6 +21,12 @@ namespace cgv {
 			this->maxIterations = 400;
 			this->numRandomSamples = 400;
 			this->eps = 1e-8;
+			this->min_update = 1e-6f;
+			this->max_correspondence_distance = 0;
+			this->num_levels = 1;
+			this->voxel_size = 0;
+			S_type = DEFAULT_SAMPLING;
+			M_type = POINT_TO_POINT_METRIC;
 		}
 
 		ICP::~ICP() {
@@ -59,117 +71,255 @@ namespace cgv {
 			this->eps = e;
 		}
 
-		///output the rotation matrix and translation vector
-		void ICP::reg_icp(Mat& rotation_mat, Dir& translation_vec) {
-			if (!tree) {
-				/// create the ann tree
-				build_ann_tree();
-				//std::cerr << "ICP::reg_icp: called reg_icp before initialization!\n";
-			}
-			if (!(sourceCloud && targetCloud)) {
-				std::cerr << "ICP::reg_icp: source or target cloud not set!\n";
-				return;
-			}
-			Pnt source_center;
-			Pnt target_center;
-			source_center.zeros();
-			target_center.zeros();
-			size_t num_source_points = sourceCloud->get_nr_points();
-
-			float cost = 1.0;
-			///initialize as Infinity
-			float last_error = std::numeric_limits<float>::infinity();
-
-			Mat fA(0.0f);             // this initializes fA to matrix filled with zeros
-
-			cgv::math::mat<float> U, V;
-			cgv::math::diag_mat<float> Sigma;
-			/*
-			U.zeros();
-			V.zeros();
-			Sigma.zeros();
-			*/
-			point_cloud S, Q;
+		void ICP::set_metric(Metric_Type m) {
+			this->M_type = m;
+		}
 
+		void ICP::set_pyramid(int levels, float finest_voxel_size) {
+			this->num_levels = std::max(levels, 1);
+			this->voxel_size = finest_voxel_size;
+		}
 
-			/// sample the source point cloud
-			if (numRandomSamples > 0 && numRandomSamples < sourceCloud->get_nr_points()) {
-				std::vector<int> numbers(sourceCloud->get_nr_points());
-				for (int i = 0; i < sourceCloud->get_nr_points(); ++i)
-					numbers[i] = i;
-				std::random_device rd;
-				std::default_random_engine rng(std::time(0));
-				std::shuffle(numbers.begin(), numbers.end(), rng);
+		void ICP::set_max_correspondence_distance(float d) {
+			this->max_correspondence_distance = d;
+		}
 
-				S.resize(numRandomSamples);
-				Q.resize(numRandomSamples);
-				std::srand(std::time(0));
-				for (int i = 0; i < numRandomSamples; i++)
-					S.pnt(i) = sourceCloud->pnt(numbers[i]);
+		void ICP::voxel_subsample(const std::vector<Pnt>& points, float voxel_size, std::vector<Pnt>& result)
+		{
+			result.clear();
+			if (voxel_size <= 0) {
+				result = points;
+				return;
 			}
-			else {
-				S.resize(sourceCloud->get_nr_points());
-				Q.resize(sourceCloud->get_nr_points());
-				for (int i = 0; i < sourceCloud->get_nr_points(); i++)
-					S.pnt(i) = sourceCloud->pnt(i);
+			// hash voxel coordinates with 21 bits per dimension and keep the first point of each voxel
+			std::unordered_map<uint64_t, Idx> voxels;
+			voxels.reserve(points.size() / 4);
+			for (const Pnt& p : points) {
+				uint64_t key = 0;
+				for (int j = 0; j < 3; ++j)
+					key = (key << 21) | (uint64_t(int64_t(std::floor(p[j] / voxel_size))) & 0x1fffff);
+				if (voxels.emplace(key, Idx(result.size())).second)
+					result.push_back(p);
 			}
+		}
 
-			Mat rotation_update_mat = rotation_mat;
-			Dir translation_update_vec = translation_vec;
-
-			for (int iter = 0; iter < maxIterations; iter++)
-			{
-				// update S
-				for (int i = 0; i < S.get_nr_points(); i++)
-					S.pnt(i) = rotation_update_mat * S.pnt(i) + translation_update_vec;
-				// update center
-				get_center_point(S, source_center);
-			
-				fA.zeros();
-				for (int i = 0; i < S.get_nr_points(); i++)
-				{
-					/// get the closest point to p from the target point cloud
-					Pnt p = S.pnt(i);
-					Pnt q = targetCloud->pnt(tree->find_closest(p));
-					Q.pnt(i) = q; 
-					fA += Mat(q - target_center, p - source_center);
+		/// solve symmetric positive definite 6x6 system with Cholesky decomposition, return false if it is singular
+		static bool solve_spd6(double A[6][6], double* b, double* x)
+		{
+			double L[6][6] = {};
+			for (int i = 0; i < 6; ++i) {
+				for (int j = 0; j <= i; ++j) {
+					double sum = A[i][j];
+					for (int k = 0; k < j; ++k)
+						sum -= L[i][k] * L[j][k];
+					if (i == j) {
+						if (sum <= 1e-12 * (A[i][i] + 1e-30))
+							return false;
+						L[i][i] = std::sqrt(sum);
+					}
+					else
+						L[i][j] = sum / L[j][j];
 				}
-				get_center_point(Q, target_center);
+			}
+			double y[6];
+			for (int i = 0; i < 6; ++i) {
+				double sum = b[i];
+				for (int k = 0; k < i; ++k)
+					sum -= L[i][k] * y[k];
+				y[i] = sum / L[i][i];
+			}
+			for (int i = 5; i >= 0; --i) {
+				double sum = y[i];
+				for (int k = i + 1; k < 6; ++k)
+					sum -= L[k][i] * x[k];
+				x[i] = sum / L[i][i];
+			}
+			return true;
+		}
 
+		bool ICP::icp_step(const std::vector<Pnt>& samples, const Mat& rotation_mat, const Dir& translation_vec, float max_dist, Metric_Type metric,
+			Mat& rotation_update_mat, Dir& translation_update_vec, iteration_statistics& stats) const
+		{
+			auto start = std::chrono::steady_clock::now();
+			// sums over correspondences accumulated in double, for point to point the cross covariance and for point to plane the normal equations
+			struct accumulator {
+				double n = 0, cost = 0;
+				double sp[3] = {}, sq[3] = {}, C[3][3] = {};
+				double A[6][6] = {}, b[6] = {};
+				void add(const accumulator& a) {
+					n += a.n; cost += a.cost;
+					for (int i = 0; i < 3; ++i) {
+						sp[i] += a.sp[i]; sq[i] += a.sq[i];
+						for (int j = 0; j < 3; ++j)
+							C[i][j] += a.C[i][j];
+					}
+					for (int i = 0; i < 6; ++i) {
+						b[i] += a.b[i];
+						for (int j = 0; j < 6; ++j)
+							A[i][j] += a.A[i][j];
+					}
+				}
+			} total;
+			std::mutex total_mutex;
+			float max_sqr_dist = max_dist > 0 ? max_dist * max_dist : std::numeric_limits<float>::max();
+			// correspondence search in parallel batches
+			parallel_for_range(0, samples.size(), [&](int64_t begin, int64_t end) {
+				accumulator acc;
+				for (int64_t i = begin; i < end; ++i) {
+					Pnt p = rotation_mat * samples[i] + translation_vec;
+					Idx j = tree->find_closest(p);
+					if (j < 0)
+						continue;
+					const Pnt& q = targetCloud->pnt(j);
+					Dir d = p - q;
+					if (d.sqr_length() > max_sqr_dist)
+						continue;
+					acc.n += 1;
+					if (metric == POINT_TO_POINT_METRIC) {
+						acc.cost += d.sqr_length();
+						for (int r = 0; r < 3; ++r) {
+							acc.sp[r] += p[r];
+							acc.sq[r] += q[r];
+							for (int c = 0; c < 3; ++c)
+								acc.C[r][c] += double(q[r]) * p[c];
+						}
+					}
+					else {
+						// linearized residual of rotation angles and translation
+						const Nml& nml = targetCloud->nml(j);
+						double r = dot(d, nml);
+						Dir pxn = cross(p, nml);
+						double J[6] = { pxn[0], pxn[1], pxn[2], nml[0], nml[1], nml[2] };
+						acc.cost += r * r;
+						for (int a = 0; a < 6; ++a) {
+							acc.b[a] -= J[a] * r;
+							for (int c = 0; c < 6; ++c)
+								acc.A[a][c] += J[a] * J[c];
+						}
+					}
+				}
+				std::lock_guard<std::mutex> lock(total_mutex);
+				total.add(acc);
+			}, 256);
+			auto found = std::chrono::steady_clock::now();
+			stats.nr_correspondences = size_t(total.n);
+			stats.cost = total.n > 0 ? float(total.cost / total.n) : 0.0f;
+			stats.correspondence_time = std::chrono::duration<double>(found - start).count();
+			bool success = total.n >= 3;
+			if (success && metric == POINT_TO_POINT_METRIC) {
+				Pnt source_center, target_center;
+				for (int r = 0; r < 3; ++r) {
+					source_center[r] = float(total.sp[r] / total.n);
+					target_center[r] = float(total.sq[r] / total.n);
+				}
+				Mat fA;
+				for (int r = 0; r < 3; ++r)
+					for (int c = 0; c < 3; ++c)
+						fA(r, c) = float(total.C[r][c] - total.n * target_center[r] * source_center[c]);
 				///cast fA to A
 				cgv::math::mat<float> A(3, 3, &fA(0, 0));
+				cgv::math::mat<float> U, V;
+				cgv::math::diag_mat<float> Sigma;
 				cgv::math::svd(A, U, Sigma, V, false);
 				Mat fU(3, 3, &U(0, 0)), fV(3, 3, &V(0, 0)), m;
 				float det = cgv::math::det(V * cgv::math::transpose(U));
 				m.identity();
 				m(2, 2) = det;
 				///get new R and t
-				//Mat rotation_update_mat = fU * cgv::math::transpose(fV);
 				rotation_update_mat = fV * m * cgv::math::transpose(fU);
 				rotation_update_mat.transpose();
-
 				translation_update_vec = target_center - rotation_update_mat * source_center;
-				///calculate error function E(R,t)
-				cost = 0.f;
-				for (int i = 0; i < S.get_nr_points(); i++) {
-					///the new rotation matrix: rotation_update_mat
-					cost += error(Q.pnt(i), S.pnt(i), rotation_update_mat, translation_update_vec);
+			}
+			else if (success) {
+				double x[6];
+				success = solve_spd6(total.A, total.b, x);
+				if (success) {
+					Dir omega = Dir(Crd(x[0]), Crd(x[1]), Crd(x[2]));
+					float angle = omega.length();
+					if (angle > 0)
+						rotation_update_mat = Qat(omega / angle, angle).get_matrix();
+					else
+						rotation_update_mat.identity();
+					translation_update_vec = Dir(Crd(x[3]), Crd(x[4]), Crd(x[5]));
+				}
+			}
+			stats.solve_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - found).count();
+			return success;
+		}
+
+		///output the rotation matrix and translation vector
+		void ICP::reg_icp(Mat& rotation_mat, Dir& translation_vec) {
+			statistics.clear();
+			if (!(sourceCloud && targetCloud)) {
+				std::cerr << "ICP::reg_icp: source or target cloud not set!\n";
+				return;
+			}
+			if (!tree) {
+				/// create the ann tree
+				build_ann_tree();
+			}
+			Metric_Type metric = M_type;
+			if (metric == POINT_TO_PLANE_METRIC && !targetCloud->has_normals()) {
+				std::cerr << "ICP::reg_icp: point to plane metric needs target normals, using point to point metric\n";
+				metric = POINT_TO_POINT_METRIC;
+			}
+			std::vector<Pnt> source_points(sourceCloud->get_nr_points());
+			for (Idx i = 0; i < Idx(source_points.size()); ++i)
+				source_points[i] = sourceCloud->pnt(i);
+			std::default_random_engine rng((unsigned)std::time(0));
+			std::vector<Pnt> samples;
+			int nr_levels = voxel_size > 0 ? num_levels : 1;
+			// coarse to fine schedule over voxel pyramid, where the voxel size and correspondence distance double per level
+			for (int level = nr_levels - 1; level >= 0; --level) {
+				float level_scale = float(1 << level);
+				voxel_subsample(source_points, voxel_size * level_scale, samples);
+				/// sample the source point cloud
+				if (numRandomSamples > 0 && numRandomSamples < int(samples.size())) {
+					std::shuffle(samples.begin(), samples.end(), rng);
+					samples.resize(numRandomSamples);
+				}
+				float max_dist = max_correspondence_distance * level_scale;
+				///initialize as Infinity
+				float last_error = std::numeric_limits<float>::infinity();
+				for (int iter = 0; iter < maxIterations; iter++) {
+					iteration_statistics stats;
+					stats.level = level;
+					stats.iteration = iter;
+					Mat rotation_update_mat;
+					Dir translation_update_vec;
+					bool success = icp_step(samples, rotation_mat, translation_vec, max_dist, metric, rotation_update_mat, translation_update_vec, stats);
+					statistics.push_back(stats);
+					if (!success)
+						break;
+					/// update the R and t
+					rotation_mat = rotation_update_mat * rotation_mat;
+					translation_vec = rotation_update_mat * translation_vec + translation_update_vec;
+					///stop if cost does not change anymore or the update is negligible
+					/// rotation angle from cosine and sine, as acos of the cosine is not accurate for small angles in float precision
+					float cos_angle = 0.5f * (rotation_update_mat(0, 0) + rotation_update_mat(1, 1) + rotation_update_mat(2, 2) - 1);
+					float sin_angle = 0.5f * Dir(rotation_update_mat(2, 1) - rotation_update_mat(1, 2), rotation_update_mat(0, 2) - rotation_update_mat(2, 0), rotation_update_mat(1, 0) - rotation_update_mat(0, 1)).length();
+					float angle = std::atan2(sin_angle, cos_angle);
+					if (std::abs(last_error - stats.cost) <= eps || (angle < min_update && translation_update_vec.length() < min_update))
+						break;
+					last_error = stats.cost;
 				}
-				cost /= S.get_nr_points();
-				///judge if cost is decreasing, and is larger than eps. If so, update the R and t, otherwise stop and output R and t
-				
-				/// update the R and t		
-				rotation_mat = rotation_update_mat * rotation_mat;
-				translation_vec = rotation_update_mat * translation_vec + translation_update_vec;
-				
-				if (abs(last_error-cost) <= eps)
-					break;
-				last_error = cost;
 			}
-			//std::cout << "rotate_mat: " << rotation_mat << std::endl;
-			//std::cout << "translation_vec: " << translation_vec << std::endl;
-			//print_rotation(rotation_mat);
-			//print_translation(translation_vec);
+		}
+
+		double ICP::get_total_time() const
+		{
+			double t = 0;
+			for (const auto& s : statistics)
+				t += s.correspondence_time + s.solve_time;
+			return t;
+		}
+
+		void ICP::print_statistics(std::ostream& os) const
+		{
+			for (const auto& s : statistics)
+				os << "level " << s.level << " iteration " << s.iteration << ": " << s.nr_correspondences << " correspondences, cost " << s.cost
+				   << ", search " << 1000 * s.correspondence_time << " ms, solve " << 1000 * s.solve_time << " ms" << std::endl;
+			os << "total " << 1000 * get_total_time() << " ms" << std::endl;
 		}
 
 		void ICP::get_center_point(const point_cloud& input, Pnt& center_point) {
@@ -191,9 +341,11 @@ namespace cgv {
 			Pnt target_center;
 			source_center.zeros();
 			target_center.zeros();
-			/// create the ann tree
+			/// create the ann trees of target and source used to filter correspondences
 			ann_tree* tree = new ann_tree();
 			tree->build(*targetCloud);
+			ann_tree* tree_inv = new ann_tree();
+			tree_inv->build(*sourceCloud);
 			size_t num_source_points = sourceCloud->get_nr_points();
 			
 			get_center_point(*targetCloud, target_center);
@@ -228,23 +380,25 @@ namespace cgv {
 				Q.clear();
 				source_center = rotation_mat * source_center + translation_vec;
 				fA.zeros();
-				for (int i = 0; i < sourceCloud->get_nr_points(); i++)
+				/// sample the source point cloud and filter the correspondences of the samples in parallel
+				Idx n = Idx(sourceCloud->get_nr_points());
+				std::vector<Idx> samples(n);
+				for (Idx i = 0; i < n; i++)
+					samples[i] = std::rand() % n;
+				std::vector<Pnt> sample_s(n), sample_q(n);
+				std::vector<char> valid(n);
+				parallel_for_range(0, n, [&](int64_t begin, int64_t end) {
+					for (int64_t i = begin; i < end; ++i)
+						valid[i] = correspondences_filter(*sourceCloud, *targetCloud, *tree_inv, *tree, samples[i], sample_s[i], sample_q[i]);
+				});
+				for (Idx i = 0; i < n; i++)
 				{
-					//int randSample = std::rand() % sourceCloud->get_nr_points();
-					/// sample the source point cloud
-					//S.pnt(i) = sourceCloud->pnt(randSample);
-					//Q.pnt(i) = targetCloud->pnt(tree->find_closest(S.pnt(i)));
-					Pnt temp_s(0.0);
-					Pnt temp_q(0.0);
-					if (correspondences_filter(*sourceCloud, *targetCloud, temp_s, temp_q))
+					if (valid[i])
 					{
-						S.add_point(temp_s);
-						Q.add_point(temp_q);
-						fA += Mat(temp_q - target_center, rotation_mat * temp_s + translation_vec - source_center);
+						S.add_point(sample_s[i]);
+						Q.add_point(sample_q[i]);
+						fA += Mat(sample_q[i] - target_center, rotation_mat * sample_s[i] + translation_vec - source_center);
 					}
-					/// get the closest point in the target point cloud
-					//Q.pnt(i) = targetCloud->pnt(i);
-					//fA += Mat(Q.pnt(i) - target_center, rotation_mat * S.pnt(i) + translation_vec - source_center);
 				}
 				///cast fA to A
 				cgv::math::mat<float> A(3, 3, &fA(0, 0));
@@ -287,6 +441,7 @@ namespace cgv {
 			std::cout << "rotate_mat: " << rotation_mat << std::endl;
 			std::cout << "translation_vec: " << translation_vec << std::endl;
 			delete tree;
+			delete tree_inv;
 		}
 		///print rotation matrix
 		void ICP::print_rotation(float* rotation) {
@@ -303,17 +458,21 @@ namespace cgv {
 
 		bool ICP::correspondences_filter(const point_cloud& source, const point_cloud& target, Pnt& source_p, Pnt& target_p)
 		{
-			ann_tree* tree = new ann_tree();
-			tree->build(target);
-			ann_tree* tree_inv = new ann_tree();
-			tree_inv->build(source);
-			float dist, dist_inv = 0.0;
+			ann_tree tree, tree_inv;
+			tree.build(target);
+			tree_inv.build(source);
 			int randSample = std::rand() % source.get_nr_points();
-			source_p = source.pnt(randSample);
-			target_p = target.pnt(tree->find_closest(source_p));
+			return correspondences_filter(source, target, tree_inv, tree, randSample, source_p, target_p);
+		}
+
+		bool ICP::correspondences_filter(const point_cloud& source, const point_cloud& target, const ann_tree& source_tree, const ann_tree& target_tree, Idx sample, Pnt& source_p, Pnt& target_p)
+		{
+			float dist, dist_inv = 0.0;
+			source_p = source.pnt(sample);
+			target_p = target.pnt(target_tree.find_closest(source_p));
 			//std::cout << "source_p: " << source_p << "target_p: " << target_p << std::endl;
 			dist = dis_pts(source_p, target_p);
-			Pnt source_p_inv = source.pnt(tree_inv->find_closest(target_p));
+			Pnt source_p_inv = source.pnt(source_tree.find_closest(target_p));
 			dist_inv = dis_pts(source_p_inv, target_p);
 			if (dist > 1.5 * dist_inv || dist < 0.667 * dist_inv)
 			{
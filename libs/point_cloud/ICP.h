@@ -20,12 +20,38 @@ namespace cgv {
 				RANDOM_SAMPLING = 1,
 				NORMAL_SPACE_SAMPLING = 2  ,
 			} S_type;
+			/// error metric minimized in each iteration, point to plane requires normals in the target cloud
+			enum Metric_Type {
+				POINT_TO_POINT_METRIC = 0,
+				POINT_TO_PLANE_METRIC = 1
+			} M_type;
+			/// timing and convergence information of a single iteration
+			struct iteration_statistics {
+				int level;
+				int iteration;
+				size_t nr_correspondences;
+				/// mean squared residual of the correspondences before the update
+				float cost;
+				/// wall clock times in seconds
+				double correspondence_time;
+				double solve_time;
+			};
 
 			const point_cloud* sourceCloud;
 			const point_cloud* targetCloud;
 			int maxIterations;
 			int numRandomSamples;
 			float eps;
+			/// stop iterating on a level once rotation angle in radians and translation length of an update are both below this threshold
+			float min_update;
+			/// reject correspondences further apart than this distance on the finest level, which doubles per coarser level; 0 disables rejection
+			float max_correspondence_distance;
+			/// number of levels of the voxel pyramid used to subsample the source cloud
+			int num_levels;
+			/// voxel size on the finest level, 0 disables voxel subsampling
+			float voxel_size;
+			/// statistics of all iterations of the last call to reg_icp
+			std::vector<iteration_statistics> statistics;
 			point_cloud* crspd_source;
 			point_cloud* crspd_target;
 
@@ -39,8 +65,16 @@ namespace cgv {
 			void set_iterations(int Iter);
 			void set_num_random(int NR);
 			void set_eps(float e);
+			void set_metric(Metric_Type m);
+			/// configure a coarse to fine schedule with the given number of levels and voxel size on the finest level
+			void set_pyramid(int levels, float finest_voxel_size);
+			void set_max_correspondence_distance(float d);
+			/// register source to target starting from the given transformation, which is updated to the result
 			void reg_icp(Mat& rotation_m, Dir& translation_v);
 			void get_center_point(const point_cloud& input, Pnt& mid_point);
+			/// return total time of the last registration in seconds
+			double get_total_time() const;
+			void print_statistics(std::ostream& os) const;
 			float error(Pnt& ps, Pnt& pd, Mat& r, Dir& t);
 			void get_crspd(Mat& rotation_m, Dir& translation_v, point_cloud& pc1, point_cloud& pc2);
 			void print_rotation(float* rotationMatrix);
@@ -48,6 +82,13 @@ namespace cgv {
 
 			bool correspondences_filter(const point_cloud& source, const point_cloud& target, Pnt& source_p, Pnt& target_p);
 			float dis_pts(const Pnt& source_p, const Pnt& target_p);
+		protected:
+			/// keep one point per voxel of the given size
+			static void voxel_subsample(const std::vector<Pnt>& points, float voxel_size, std::vector<Pnt>& result);
+			/// find correspondences of the transformed samples in parallel and solve for the update of the selected metric, return false if there are too few correspondences
+			bool icp_step(const std::vector<Pnt>& samples, const Mat& rotation_mat, const Dir& translation_vec, float max_dist, Metric_Type metric,
+				Mat& rotation_update_mat, Dir& translation_update_vec, iteration_statistics& stats) const;
+			bool correspondences_filter(const point_cloud& source, const point_cloud& target, const ann_tree& source_tree, const ann_tree& target_tree, Idx sample, Pnt& source_p, Pnt& target_p);
 		private:
 			std::shared_ptr<ann_tree> tree;
 		};
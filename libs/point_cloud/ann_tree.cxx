@@ -1,18 +1,7 @@
 #include "ann_tree.h"
 
-#define ANN_USE_FLOAT
-#include <ANN/ANN.h>
-
-struct ann_struct
-{
-	ANNpointArray pa;
-	ANNpointSet* ps;
-	ann_struct() : pa(0), ps(0) {}
-};
-
 ann_tree::ann_tree()
 {
-	ann_impl = 0;
 	k = 30;
 	pc = 0;
 }
@@ -24,13 +13,9 @@ ann_tree::~ann_tree()
 
 void ann_tree::clear()
 {
-	if (!ann_impl)
-		return;
-	ann_struct*& ann = (ann_struct*&)ann_impl;
-	delete [] ann->pa;
-	delete ann->ps;
-	delete ann;
-	ann = 0;
+	tree.clear();
+	point_indices.clear();
+	component_tree_offsets.clear();
 	pc = 0;
 }
 
@@ -41,99 +26,93 @@ bool ann_tree::is_empty() const
 
 void ann_tree::build(const point_cloud& _pc)
 {
-	//
 	clear();
 	// store pointer to points in point cloud
 	pc = &_pc;
-
-	// construct ann data structure container
-	if (!ann_impl)
-		ann_impl = new ann_struct();
-	ann_struct* ann = static_cast<ann_struct*>(ann_impl);
-
-	// build point array
-	Cnt n = (Cnt)pc->get_nr_points();
-
-	ann->pa = new ANNpoint[n];
-	Idx i;
-	for (i=0; i<(Idx)n; ++i)
-		ann->pa[i] = const_cast<ANNpoint>(&pc->pnt(i)[0]);
-
-	// construct search tree
-	ann->ps = new ANNkd_tree(ann->pa,n,3);
+	tree.build(Cnt(pc->get_nr_points()), pc->get_nr_points() > 0 ? &pc->pnt(0) : 0);
 }
 
 /// build from given components
 void ann_tree::build(const point_cloud& _pc, const std::vector<Idx>& component_indices)
 {
-	//
 	clear();
 	// store pointer to points in point cloud
 	pc = &_pc;
-
-	// construct ann data structure container
-	if (!ann_impl)
-		ann_impl = new ann_struct();
-	ann_struct* ann = static_cast<ann_struct*>(ann_impl);
-
-	// build point array
-	Cnt n = 0;
-	for (Idx ci : component_indices)
-		n += Cnt(pc->component_point_range(ci).nr_points);
-	ann->pa = new ANNpoint[n];
-	Idx i = 0;
+	// collect points of components
+	std::vector<Pnt> P;
+	component_tree_offsets.assign(pc->get_nr_components(), -1);
 	for (Idx ci : component_indices) {
+		component_tree_offsets[ci] = Idx(P.size());
 		Idx pi_end = Idx(pc->component_point_range(ci).index_of_first_point + pc->component_point_range(ci).nr_points);
 		for (Idx pi = Idx(pc->component_point_range(ci).index_of_first_point); pi < pi_end; ++pi) {
-			ann->pa[i] = const_cast<ANNpoint>(&pc->pnt(pi)[0]);
-			++i;
+			P.push_back(pc->pnt(pi));
+			point_indices.push_back(pi);
 		}
 	}
-	// construct search tree
-	ann->ps = new ANNkd_tree(ann->pa, n, 3);
+	tree.build(P);
 }
 
 void ann_tree::extract_neighbors(Idx i, Idx k, std::vector<Idx>& N) const
 {
-	static std::vector<float> dists;
-	static std::vector<Idx> tmp;
-	ann_struct* ann = static_cast<ann_struct*>(ann_impl);
-	if (!ann) {
+	if (is_empty()) {
 		std::cerr << "no ann_tree built" << std::endl;
 		return;
 	}
-	N.resize(k);
-	tmp.resize(k+1);
-	dists.resize(k+1);
-	ann->ps->annkSearch(const_cast<ANNpoint>(&pc->pnt(i)[0]), k+1, (ANNidxArray)&tmp[0], &dists[0]);
-	std::copy(tmp.begin()+1,tmp.end(),N.begin());
+	// the query point itself is excluded, also if other points share its position
+	tree.find_knn(pc->pnt(i), k, N, 0, get_tree_index(i));
+	to_point_indices(N);
 }
 
 ann_tree::Idx ann_tree::find_closest(const Pnt& p) const
 {
-	ann_struct* ann = static_cast<ann_struct*>(ann_impl);
-	if (!ann) {
+	if (is_empty()) {
 		std::cerr << "no ann_tree built" << std::endl;
 		return -1;
 	}
-	float dist;
-	unsigned int result;
-	ann->ps->annkSearch(const_cast<ANNpoint>(&p[0]), 1, (ANNidxArray)&result, &dist);
-	return result;
+	return get_point_index(tree.find_closest(p));
 }
+
 void ann_tree::find_closest_points(const Pnt& p, Idx k, std::vector<const Pnt*>& knn) const
 {
-	ann_struct* ann = static_cast<ann_struct*>(ann_impl);
-	if (!ann) {
+	if (is_empty()) {
 		std::cerr << "no ann_tree built" << std::endl;
 		return;
 	}
-	knn.resize(k);
-	ANNdistArray dist_array = new ANNdist[k];
-	ANNidxArray index_array = new ANNidx[k];
-	ann->ps->annkSearch(const_cast<ANNpoint>(&p[0]), 1, (ANNidxArray)&index_array, dist_array);
-	for (Idx i = 0; i < k; ++i)
-		knn[i] = reinterpret_cast<const Pnt*>(ann->ps->thePoints()[index_array[i]]);
-	delete[] dist_array;
-	delete[] index_array;
-}
\ No newline at end of file
+	std::vector<Idx> N;
+	tree.find_knn(p, k, N);
+	knn.resize(N.size());
+	for (size_t i = 0; i < N.size(); ++i)
+		knn[i] = &pc->pnt(get_point_index(N[i]));
+}
+
+void ann_tree::find_knn(const Pnt& p, Idx k, std::vector<Idx>& N, std::vector<Crd>* sqr_dists) const
+{
+	tree.find_knn(p, k, N, sqr_dists);
+	to_point_indices(N);
+}
+
+void ann_tree::find_in_radius(const Pnt& p, Crd radius, std::vector<Idx>& N, std::vector<Crd>* sqr_dists) const
+{
+	tree.find_in_radius(p, radius, N, sqr_dists);
+	to_point_indices(N);
+}
+
+ann_tree::Idx ann_tree::get_tree_index(Idx pi) const
+{
+	if (point_indices.empty())
+		return pi;
+	if (pi < 0 || pi >= Idx(pc->get_nr_points()))
+		return -1;
+	Idx ci = Idx(pc->component_index(pi));
+	if (ci < 0 || ci >= Idx(component_tree_offsets.size()) || component_tree_offsets[ci] < 0)
+		return -1;
+	return component_tree_offsets[ci] + pi - Idx(pc->component_point_range(ci).index_of_first_point);
+}
+
+void ann_tree::to_point_indices(std::vector<Idx>& N) const
+{
+	if (point_indices.empty())
+		return;
+	for (auto& ni : N)
+		ni = get_point_index(ni);
+}
@@ -2,16 +2,29 @@
 
 #include <vector>
 #include "point_cloud.h"
+#include "kd_tree.h"
 
 #include "lib_begin.h"
 
-/** uses ann to provide a data structure to build a knn neighbor graph */
+/** provides a data structure to build a knn neighbor graph and to answer closest point queries. Originally based on the
+    ANN library, it now uses the native kd_tree and all queries are thread safe. All methods take and return point
+	cloud indices, also if the tree has been built from a subset of the components. */
 class CGV_API ann_tree : public point_cloud_types
 {
 protected:
-	void* ann_impl;
+	kd_tree tree;
 	const point_cloud* pc;
+	/// in case of a tree built from components the point cloud index of each point in the tree, empty otherwise
+	std::vector<Idx> point_indices;
+	/// in case of a tree built from components the tree index of the first point of each component, indexed by component
+	std::vector<Idx> component_tree_offsets;
 	Cnt k;
+	/// convert index of point in the tree to point cloud index
+	Idx get_point_index(Idx ti) const { return point_indices.empty() || ti < 0 ? ti : point_indices[ti]; }
+	/// convert point cloud index to index in the tree or -1 if the point is not part of the tree
+	Idx get_tree_index(Idx pi) const;
+	/// convert indices of points in the tree to point cloud indices
+	void to_point_indices(std::vector<Idx>& N) const;
 public:
 	/// construct
 	ann_tree();
@@ -25,12 +38,18 @@ public:
 	void build(const point_cloud& pc);
 	/// build from given components
 	void build(const point_cloud& pc, const std::vector<Idx>& component_indices);
-	/// provide necessary method for building a neighbor graph
+	/// provide necessary method for building a neighbor graph, which finds the k closest points of point i excluding i itself
 	void extract_neighbors(Idx i, Idx k, std::vector<Idx>& N) const;
-	/// addition query method to find the closest neighbor
+	/// addition query method to find the index of the closest point
 	Idx find_closest(const Pnt& p) const;
 	/// knn query that returns pointers to points
 	void find_closest_points(const Pnt& p, Idx k, std::vector<const Pnt*>& knn) const;
+	/// knn query returning the indices of the k closest points sorted by increasing distance and optionally their squared distances
+	void find_knn(const Pnt& p, Idx k, std::vector<Idx>& N, std::vector<Crd>* sqr_dists = 0) const;
+	/// find the indices of all points within the given radius sorted by increasing distance
+	void find_in_radius(const Pnt& p, Crd radius, std::vector<Idx>& N, std::vector<Crd>* sqr_dists = 0) const;
+	/// access to the underlying kd tree, e.g. for batched queries, whose indices refer to the points in the tree
+	const kd_tree& get_kd_tree() const { return tree; }
 };
 
-#include <cgv/config/lib_end.h>
\ No newline at end of file
+#include <cgv/config/lib_end.h>
@@ -0,0 +1,320 @@
+#include "compact_point_cloud.h"
+#include "concurrency.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+using cgv::type::uint16_type;
+using cgv::type::uint32_type;
+using cgv::pointcloud::utility::parallel_for_range;
+
+compact_point_cloud::compact_point_cloud()
+{
+	flags = CAF_NONE;
+	n = 0;
+	has_nmls = false;
+	has_clrs = false;
+}
+
+void compact_point_cloud::clear()
+{
+	flags = CAF_NONE;
+	n = 0;
+	has_nmls = false;
+	has_clrs = false;
+	P.clear();
+	N.clear();
+	C.clear();
+	QX.clear();
+	QY.clear();
+	QZ.clear();
+	block_begin.clear();
+	block_min.clear();
+	block_step.clear();
+	ON.clear();
+	PC.clear();
+	components.clear();
+}
+
+compact_point_cloud::Idx compact_point_cloud::find_block(size_t i) const
+{
+	return Idx(std::upper_bound(block_begin.begin(), block_begin.end(), Cnt(i)) - block_begin.begin()) - 1;
+}
+
+void compact_point_cloud::build(const point_cloud& pc, int _flags)
+{
+	clear();
+	flags = _flags;
+	// byte colors need less memory than packed colors
+	if (!std::is_floating_point<ClrComp>::value)
+		flags &= ~CAF_PACKED_COLORS;
+	n = Cnt(pc.get_nr_points());
+	has_nmls = pc.has_normals();
+	has_clrs = pc.has_colors();
+	if (pc.has_components())
+		for (Idx ci = 0; ci < Idx(pc.get_nr_components()); ++ci)
+			components.push_back(pc.component_point_range(ci));
+
+	if (flags & CAF_QUANTIZED_POSITIONS) {
+		// split point ranges of components into blocks
+		std::vector<component_info> ranges = components;
+		if (ranges.empty())
+			ranges.push_back(component_info(0, n));
+		std::sort(ranges.begin(), ranges.end(), [](const component_info& a, const component_info& b) { return a.index_of_first_point < b.index_of_first_point; });
+		Cnt i = 0;
+		for (const auto& r : ranges) {
+			// points not covered by a component are blocked separately
+			for (; i < r.index_of_first_point; i += std::min(block_size, Cnt(r.index_of_first_point - i)))
+				block_begin.push_back(i);
+			Cnt end = Cnt(r.index_of_first_point + r.nr_points);
+			for (; i < end; i += std::min(block_size, end - i))
+				block_begin.push_back(i);
+		}
+		for (; i < n; i += std::min(block_size, n - i))
+			block_begin.push_back(i);
+		block_begin.push_back(n);
+		size_t nr_blocks = block_begin.size() - 1;
+		block_min.resize(nr_blocks);
+		block_step.resize(nr_blocks);
+		QX.resize(n);
+		QY.resize(n);
+		QZ.resize(n);
+		parallel_for_range(0, nr_blocks, [this, &pc](int64_t begin, int64_t end) {
+			for (int64_t bi = begin; bi < end; ++bi) {
+				Box B;
+				for (Cnt i = block_begin[bi]; i < block_begin[bi + 1]; ++i)
+					B.add_point(pc.pnt(i));
+				block_min[bi] = B.get_min_pnt();
+				block_step[bi] = B.get_extent() / 65535.0f;
+				for (Cnt i = block_begin[bi]; i < block_begin[bi + 1]; ++i)
+					set_pnt(i, pc.pnt(i));
+			}
+		}, 1);
+	}
+	else {
+		P.resize(n);
+		for (Cnt i = 0; i < n; ++i)
+			P[i] = pc.pnt(i);
+	}
+	if (has_nmls) {
+		if (flags & CAF_OCTAHEDRAL_NORMALS)
+			ON.resize(n);
+		else
+			N.resize(n);
+		parallel_for_range(0, n, [this, &pc](int64_t begin, int64_t end) {
+			for (int64_t i = begin; i < end; ++i)
+				set_nml(i, pc.nml(i));
+		});
+	}
+	if (has_clrs) {
+		if (flags & CAF_PACKED_COLORS)
+			PC.resize(n);
+		else
+			C.resize(n);
+		for (Cnt i = 0; i < n; ++i)
+			set_clr(i, pc.clr(i));
+	}
+}
+
+void compact_point_cloud::extract(point_cloud& pc) const
+{
+	pc.clear();
+	if (has_nmls)
+		pc.create_normals();
+	if (has_clrs)
+		pc.create_colors();
+	pc.resize(n);
+	parallel_for_range(0, n, [this, &pc](int64_t begin, int64_t end) {
+		for (int64_t i = begin; i < end; ++i) {
+			pc.pnt(i) = pnt(i);
+			if (has_nmls)
+				pc.nml(i) = nml(i);
+			if (has_clrs)
+				pc.clr(i) = clr(i);
+		}
+	});
+	if (components.empty())
+		return;
+	pc.create_components();
+	for (Idx ci = 0; ci < Idx(components.size()); ++ci) {
+		if (ci > 0)
+			pc.add_component();
+		pc.component_point_range(ci) = components[ci];
+		for (size_t i = components[ci].index_of_first_point; i < components[ci].index_of_first_point + components[ci].nr_points; ++i)
+			pc.component_index(i) = unsigned(ci);
+	}
+}
+
+size_t compact_point_cloud::get_memory_size() const
+{
+	return P.size() * sizeof(Pnt) + N.size() * sizeof(Nml) + C.size() * sizeof(Clr) +
+		(QX.size() + QY.size() + QZ.size()) * sizeof(uint16_type) +
+		block_begin.size() * sizeof(Cnt) + (block_min.size() + block_step.size()) * sizeof(Pnt) +
+		(ON.size() + PC.size()) * sizeof(uint32_type);
+}
+
+compact_point_cloud::Pnt compact_point_cloud::pnt(size_t i) const
+{
+	if (!(flags & CAF_QUANTIZED_POSITIONS))
+		return P[i];
+	Idx bi = find_block(i);
+	const Pnt& m = block_min[bi];
+	const Pnt& s = block_step[bi];
+	return Pnt(m[0] + s[0] * QX[i], m[1] + s[1] * QY[i], m[2] + s[2] * QZ[i]);
+}
+
+compact_point_cloud::Nml compact_point_cloud::nml(size_t i) const
+{
+	return (flags & CAF_OCTAHEDRAL_NORMALS) ? decode_octahedral(ON[i]) : N[i];
+}
+
+compact_point_cloud::Clr compact_point_cloud::clr(size_t i) const
+{
+	return (flags & CAF_PACKED_COLORS) ? unpack_color(PC[i]) : C[i];
+}
+
+void compact_point_cloud::set_pnt(size_t i, const Pnt& p)
+{
+	if (!(flags & CAF_QUANTIZED_POSITIONS)) {
+		P[i] = p;
+		return;
+	}
+	Idx bi = find_block(i);
+	uint16_type q[3];
+	for (int j = 0; j < 3; ++j) {
+		Crd s = block_step[bi][j];
+		Crd x = s > 0 ? (p[j] - block_min[bi][j]) / s : 0;
+		q[j] = uint16_type(std::max(Crd(0), std::min(Crd(65535), std::floor(x + 0.5f))));
+	}
+	QX[i] = q[0];
+	QY[i] = q[1];
+	QZ[i] = q[2];
+}
+
+void compact_point_cloud::set_nml(size_t i, const Nml& nml)
+{
+	if (flags & CAF_OCTAHEDRAL_NORMALS)
+		ON[i] = encode_octahedral(nml);
+	else
+		N[i] = nml;
+}
+
+void compact_point_cloud::set_clr(size_t i, const Clr& c)
+{
+	if (flags & CAF_PACKED_COLORS)
+		PC[i] = pack_color(c);
+	else
+		C[i] = c;
+}
+
+void compact_point_cloud::decode_points(size_t begin, size_t end, Crd* X, Crd* Y, Crd* Z) const
+{
+	if (!(flags & CAF_QUANTIZED_POSITIONS)) {
+		for (size_t i = begin; i < end; ++i) {
+			X[i - begin] = P[i][0];
+			Y[i - begin] = P[i][1];
+			Z[i - begin] = P[i][2];
+		}
+		return;
+	}
+	// decode block wise with constant box inside of the inner loops
+	for (Idx bi = find_block(begin); begin < end; ++bi) {
+		size_t block_end = std::min(size_t(block_begin[bi + 1]), end);
+		size_t cnt = block_end - begin;
+		const uint16_type* qx = &QX[begin], * qy = &QY[begin], * qz = &QZ[begin];
+		Crd mx = block_min[bi][0], my = block_min[bi][1], mz = block_min[bi][2];
+		Crd sx = block_step[bi][0], sy = block_step[bi][1], sz = block_step[bi][2];
+		for (size_t l = 0; l < cnt; ++l)
+			X[l] = mx + sx * qx[l];
+		for (size_t l = 0; l < cnt; ++l)
+			Y[l] = my + sy * qy[l];
+		for (size_t l = 0; l < cnt; ++l)
+			Z[l] = mz + sz * qz[l];
+		X += cnt;
+		Y += cnt;
+		Z += cnt;
+		begin = block_end;
+	}
+}
+
+void compact_point_cloud::decode_normals(size_t begin, size_t end, Crd* X, Crd* Y, Crd* Z) const
+{
+	if (!has_nmls)
+		return;
+	if (!(flags & CAF_OCTAHEDRAL_NORMALS)) {
+		for (size_t i = begin; i < end; ++i) {
+			X[i - begin] = N[i][0];
+			Y[i - begin] = N[i][1];
+			Z[i - begin] = N[i][2];
+		}
+		return;
+	}
+	// branch free decoding of octahedral mapping
+	size_t cnt = end - begin;
+	const uint32_type* on = &ON[begin];
+	for (size_t l = 0; l < cnt; ++l) {
+		Crd x = Crd(on[l] & 0xffff) * (2.0f / 65535) - 1;
+		Crd y = Crd(on[l] >> 16) * (2.0f / 65535) - 1;
+		Crd z = 1 - std::abs(x) - std::abs(y);
+		Crd t = std::max(-z, Crd(0));
+		x += x >= 0 ? -t : t;
+		y += y >= 0 ? -t : t;
+		Crd inv_len = 1 / std::sqrt(x * x + y * y + z * z);
+		X[l] = x * inv_len;
+		Y[l] = y * inv_len;
+		Z[l] = z * inv_len;
+	}
+}
+
+void compact_point_cloud::decode_colors(size_t begin, size_t end, Clr* colors) const
+{
+	if (!has_clrs)
+		return;
+	for (size_t i = begin; i < end; ++i)
+		colors[i - begin] = clr(i);
+}
+
+uint32_type compact_point_cloud::encode_octahedral(const Nml& nml)
+{
+	Crd l1 = std::abs(nml[0]) + std::abs(nml[1]) + std::abs(nml[2]);
+	if (l1 == 0)
+		return encode_octahedral(Nml(0, 0, 1));
+	Crd x = nml[0] / l1, y = nml[1] / l1;
+	// fold lower hemisphere over the diagonals
+	if (nml[2] < 0) {
+		Crd fx = (1 - std::abs(y)) * (x >= 0 ? 1 : -1);
+		Crd fy = (1 - std::abs(x)) * (y >= 0 ? 1 : -1);
+		x = fx;
+		y = fy;
+	}
+	uint32_type u = uint32_type(std::floor((x * 0.5f + 0.5f) * 65535 + 0.5f));
+	uint32_type v = uint32_type(std::floor((y * 0.5f + 0.5f) * 65535 + 0.5f));
+	return std::min(u, 65535u) | (std::min(v, 65535u) << 16);
+}
+
+compact_point_cloud::Nml compact_point_cloud::decode_octahedral(uint32_type code)
+{
+	Crd x = Crd(code & 0xffff) * (2.0f / 65535) - 1;
+	Crd y = Crd(code >> 16) * (2.0f / 65535) - 1;
+	Crd z = 1 - std::abs(x) - std::abs(y);
+	if (z < 0) {
+		Crd fx = (1 - std::abs(y)) * (x >= 0 ? 1 : -1);
+		Crd fy = (1 - std::abs(x)) * (y >= 0 ? 1 : -1);
+		x = fx;
+		y = fy;
+	}
+	Nml nml(x, y, z);
+	nml.normalize();
+	return nml;
+}
+
+uint32_type compact_point_cloud::pack_color(const Clr& c)
+{
+	return uint32_type(color_component_to_byte(c[0])) | (uint32_type(color_component_to_byte(c[1])) << 8) |
+		(uint32_type(color_component_to_byte(c[2])) << 16) | 0xff000000u;
+}
+
+compact_point_cloud::Clr compact_point_cloud::unpack_color(uint32_type code)
+{
+	return Clr(byte_to_color_component(code & 0xff), byte_to_color_component((code >> 8) & 0xff), byte_to_color_component((code >> 16) & 0xff));
+}
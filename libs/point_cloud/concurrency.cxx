@@ -73,6 +73,125 @@ namespace utility {
 		}
 	}
 
+	// index of the calling worker thread in its scheduler or -1 for other threads
+	static thread_local int this_worker_index = -1;
+	static thread_local TaskScheduler* this_worker_scheduler = nullptr;
+
+	TaskScheduler::TaskScheduler(unsigned nr_workers) : nr_pending(0), nr_sleeping(0)
+	{
+		for (unsigned i = 0; i <= nr_workers; ++i)
+			queues.push_back(std::make_unique<WorkQueue>());
+		for (unsigned i = 0; i < nr_workers; ++i)
+			threads.emplace_back(&TaskScheduler::worker_kernel, this, int(i));
+	}
+
+	TaskScheduler::~TaskScheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleep_mtx);
+			stop_request = true;
+		}
+		sleep_cv.notify_all();
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	TaskScheduler& TaskScheduler::instance()
+	{
+		static TaskScheduler scheduler(std::max(1u, std::thread::hardware_concurrency()) - 1);
+		return scheduler;
+	}
+
+	int TaskScheduler::get_thread_index() const
+	{
+		return this_worker_scheduler == this ? this_worker_index : int(threads.size());
+	}
+
+	void TaskScheduler::submit(Task task)
+	{
+		int queue_index = this_worker_scheduler == this ? this_worker_index : int(threads.size());
+		if (threads.empty()) {
+			// without workers tasks are executed by waiting threads
+			queue_index = 0;
+		}
+		{
+			std::lock_guard<std::mutex> lock(queues[queue_index]->mtx);
+			queues[queue_index]->tasks.push_back(std::move(task));
+		}
+		nr_pending.fetch_add(1);
+		if (nr_sleeping.load() > 0) {
+			std::lock_guard<std::mutex> lock(sleep_mtx);
+			sleep_cv.notify_one();
+		}
+	}
+
+	bool TaskScheduler::pop(int queue_index, bool back, Task& task)
+	{
+		WorkQueue& queue = *queues[queue_index];
+		std::lock_guard<std::mutex> lock(queue.mtx);
+		if (queue.tasks.empty())
+			return false;
+		if (back) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		return true;
+	}
+
+	bool TaskScheduler::execute_one()
+	{
+		if (nr_pending.load() == 0)
+			return false;
+		int nr_queues = int(queues.size());
+		int own = this_worker_scheduler == this ? this_worker_index : nr_queues - 1;
+		Task task;
+		// first own queue in lifo order, then steal in fifo order starting at the neighbor
+		bool found = pop(own, true, task);
+		for (int i = 1; !found && i < nr_queues; ++i)
+			found = pop((own + i) % nr_queues, false, task);
+		if (!found)
+			return false;
+		nr_pending.fetch_sub(1);
+		task();
+		return true;
+	}
+
+	void TaskScheduler::worker_kernel(int worker_index)
+	{
+		this_worker_index = worker_index;
+		this_worker_scheduler = this;
+		while (true) {
+			if (execute_one())
+				continue;
+			// spin shortly before going to sleep
+			bool executed = false;
+			for (int i = 0; i < 64 && !executed; ++i) {
+				std::this_thread::yield();
+				executed = execute_one();
+			}
+			if (executed)
+				continue;
+			std::unique_lock<std::mutex> lock(sleep_mtx);
+			nr_sleeping.fetch_add(1);
+			sleep_cv.wait(lock, [this]() { return stop_request || nr_pending.load() > 0; });
+			nr_sleeping.fetch_sub(1);
+			if (stop_request && nr_pending.load() == 0)
+				return;
+		}
+	}
+
+	void TaskGroup::wait()
+	{
+		while (nr_pending.load() > 0) {
+			if (!scheduler.execute_one())
+				std::this_thread::yield();
+		}
+	}
+
 } // namespace utility
 } // namespace pointcloud
 } // namespace cgv
\ No newline at end of file
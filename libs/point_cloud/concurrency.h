@@ -6,6 +6,10 @@
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
 
 #include "lib_begin.h"
 
@@ -66,6 +70,7 @@ class CGV_API SenseReversingBarrier
 		}
 	};
 
+	/// pool of threads that all execute the same function, superseded by the work stealing TaskScheduler
 	class CGV_API WorkerPool
 	{
 
@@ -156,6 +161,107 @@ class CGV_API SenseReversingBarrier
 	};
 
 
+	//! work stealing task scheduler shared by all parallel algorithms of the point cloud library
+	/*! Each worker thread owns a deque of tasks. Tasks spawned by a worker are pushed to and popped from the back of its own
+	    deque, idle workers steal from the front of other deques. Tasks submitted by other threads go to a separate injection
+		queue. Threads waiting for a TaskGroup execute pending tasks instead of blocking, such that nested parallel_for calls
+		and task groups compose without creating additional threads. Idle workers sleep until new tasks are submitted. */
+	class CGV_API TaskScheduler
+	{
+	public:
+		typedef std::function<void()> Task;
+	protected:
+		struct WorkQueue {
+			std::mutex mtx;
+			std::deque<Task> tasks;
+		};
+		/// one queue per worker followed by the injection queue
+		std::vector<std::unique_ptr<WorkQueue>> queues;
+		std::vector<std::thread> threads;
+		std::atomic<int64_t> nr_pending;
+		std::atomic<int> nr_sleeping;
+		std::mutex sleep_mtx;
+		std::condition_variable sleep_cv;
+		bool stop_request = false;
+		/// try to take a task from the given queue, from the back for own queues and from the front otherwise
+		bool pop(int queue_index, bool back, Task& task);
+		/// kernel of the worker threads
+		void worker_kernel(int worker_index);
+	public:
+		/// construct scheduler with given number of worker threads, the thread calling wait() participates in addition
+		TaskScheduler(unsigned nr_workers);
+		/// join all workers after finishing all submitted tasks
+		~TaskScheduler();
+		/// return the process wide scheduler with hardware_concurrency()-1 workers
+		static TaskScheduler& instance();
+		/// return number of threads executing tasks including one waiting thread
+		int get_nr_threads() const { return int(threads.size()) + 1; }
+		/// return index of the calling thread in [0, get_nr_threads()), non worker threads share the last index
+		int get_thread_index() const;
+		/// submit a task
+		void submit(Task task);
+		/// execute one pending task if available and return whether a task has been executed
+		bool execute_one();
+	};
+
+	//! group of tasks that can be waited for
+	/*! Tasks can be added from any thread, also from tasks of the same group. wait() executes pending tasks of the scheduler
+	    until all tasks of the group are finished and is called on destruction. */
+	class CGV_API TaskGroup
+	{
+		TaskScheduler& scheduler;
+		std::atomic<int64_t> nr_pending;
+	public:
+		TaskGroup(TaskScheduler& _scheduler = TaskScheduler::instance()) : scheduler(_scheduler), nr_pending(0) {}
+		~TaskGroup() { wait(); }
+		/// add a task to the group
+		template <typename F> void run(F func) {
+			nr_pending.fetch_add(1);
+			scheduler.submit([this, func]() { func(); nr_pending.fetch_sub(1); });
+		}
+		/// wait for all tasks of the group to finish
+		void wait();
+	};
+
+	/// call func(range_begin, range_end) in parallel on subranges of [begin,end) with at most grain_size elements, where grain_size 0 selects a size leading to 8 subranges per thread
+	template <typename F>
+	void parallel_for_range(int64_t begin, int64_t end, F func, int64_t grain_size = 0, TaskScheduler& scheduler = TaskScheduler::instance())
+	{
+		if (end <= begin)
+			return;
+		if (grain_size <= 0)
+			grain_size = std::max<int64_t>(1, (end - begin) / (8 * scheduler.get_nr_threads()));
+		// split recursively such that large ranges are stolen first
+		std::function<void(int64_t, int64_t)> split = [&](int64_t b, int64_t e) {
+			TaskGroup group(scheduler);
+			while (e - b > grain_size) {
+				int64_t m = b + (e - b) / 2;
+				group.run([&split, m, e]() { split(m, e); });
+				e = m;
+			}
+			func(b, e);
+			group.wait();
+		};
+		split(begin, end);
+	}
+
+	/// call func(i) in parallel for all i in [begin,end)
+	template <typename F>
+	void parallel_for(int64_t begin, int64_t end, F func, int64_t grain_size = 0, TaskScheduler& scheduler = TaskScheduler::instance())
+	{
+		parallel_for_range(begin, end, [&func](int64_t b, int64_t e) {
+			for (int64_t i = b; i < e; ++i)
+				func(i);
+		}, grain_size, scheduler);
+	}
+
+	/// call func(&tasks[i]) in parallel for all tasks, e.g. the tasks of a TaskPool
+	template <typename TASK>
+	void parallel_for_each(std::vector<TASK>& tasks, std::function<void(TASK*)>& func, TaskScheduler& scheduler = TaskScheduler::instance())
+	{
+		parallel_for(0, int64_t(tasks.size()), [&tasks, &func](int64_t i) { func(&tasks[i]); }, 1, scheduler);
+	}
+
 	// template definitions
 	template <typename F>
 	void WorkerPool::run(F func)
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include "point_cloud.h"
+#include "concurrency.h"
+
+/** kd-tree over float points with an implicit node layout. The tree is balanced with all leaves on the same level, such that
+    the point range of a node follows from halving the range of its parent and a node only stores its split plane. Children of
+	node i are 2i+1 and 2i+2. Coordinates are stored per dimension in leaf order to allow vectorized leaf scans. All queries are
+	thread safe and return indices in the order of the points passed to build(). */
+class kd_tree : public point_cloud_types
+{
+public:
+	/// maximum number of points in a leaf
+	static const unsigned leaf_size = 16;
+	/// a neighbor given by its squared distance and index
+	typedef std::pair<Crd, Idx> neighbor;
+protected:
+	struct node
+	{
+		Crd split;
+		int dim;
+	};
+	Cnt n;
+	/// number of levels of inner nodes
+	unsigned depth;
+	std::vector<node> nodes;
+	/// coordinates of points in leaf order
+	std::vector<Crd> X, Y, Z;
+	/// original index of each point in leaf order
+	std::vector<Idx> indices;
+
+	/// recursively split the point range [b,e) of a node and store its split plane
+	void build_node(std::vector<std::pair<Pnt, Idx> >& points, size_t ni, unsigned level, Idx b, Idx e)
+	{
+		if (level == depth)
+			return;
+		Box B;
+		for (Idx i = b; i < e; ++i)
+			B.add_point(points[i].first);
+		int dim = int(cgv::math::max_index(B.get_extent()));
+		Idx m = b + (e - b) / 2;
+		std::nth_element(points.begin() + b, points.begin() + m, points.begin() + e,
+			[dim](const std::pair<Pnt, Idx>& p, const std::pair<Pnt, Idx>& q) { return p.first[dim] < q.first[dim]; });
+		nodes[ni].split = points[m].first[dim];
+		nodes[ni].dim = dim;
+		// split large ranges in parallel
+		if (e - b > 65536) {
+			cgv::pointcloud::utility::TaskGroup group;
+			group.run([&]() { build_node(points, 2 * ni + 1, level + 1, b, m); });
+			build_node(points, 2 * ni + 2, level + 1, m, e);
+			group.wait();
+		}
+		else {
+			build_node(points, 2 * ni + 1, level + 1, b, m);
+			build_node(points, 2 * ni + 2, level + 1, m, e);
+		}
+	}
+	/// insert the points of leaf [b,e) closer than the current worst neighbor into the max heap of the k closest neighbors
+	void scan_leaf_knn(Idx b, Idx e, const Pnt& q, size_t k, Idx exclude, std::vector<neighbor>& heap) const
+	{
+		Crd d2[leaf_size];
+		const Crd* x = &X[b], * y = &Y[b], * z = &Z[b];
+		Idx cnt = e - b;
+		// simple loop over separate coordinate arrays that compilers vectorize
+		for (Idx l = 0; l < cnt; ++l) {
+			Crd dx = x[l] - q[0], dy = y[l] - q[1], dz = z[l] - q[2];
+			d2[l] = dx * dx + dy * dy + dz * dz;
+		}
+		for (Idx l = 0; l < cnt; ++l) {
+			if (indices[b + l] == exclude)
+				continue;
+			if (heap.size() < k) {
+				heap.push_back(neighbor(d2[l], indices[b + l]));
+				std::push_heap(heap.begin(), heap.end());
+			}
+			else if (d2[l] < heap.front().first) {
+				std::pop_heap(heap.begin(), heap.end());
+				heap.back() = neighbor(d2[l], indices[b + l]);
+				std::push_heap(heap.begin(), heap.end());
+			}
+		}
+	}
+	/// recursive knn search, where rd is the squared distance of q to the cell of the node and off the per dimension offsets of q to the cell
+	void search_knn(size_t ni, unsigned level, Idx b, Idx e, const Pnt& q, Crd rd, Crd* off, size_t k, Idx exclude, std::vector<neighbor>& heap) const
+	{
+		if (level == depth) {
+			scan_leaf_knn(b, e, q, k, exclude, heap);
+			return;
+		}
+		const node& nd = nodes[ni];
+		Idx m = b + (e - b) / 2;
+		Crd diff = q[nd.dim] - nd.split;
+		size_t near_ni = diff < 0 ? 2 * ni + 1 : 2 * ni + 2, far_ni = diff < 0 ? 2 * ni + 2 : 2 * ni + 1;
+		Idx near_b = diff < 0 ? b : m, near_e = diff < 0 ? m : e, far_b = diff < 0 ? m : b, far_e = diff < 0 ? e : m;
+		search_knn(near_ni, level + 1, near_b, near_e, q, rd, off, k, exclude, heap);
+		Crd old_off = off[nd.dim];
+		Crd far_rd = rd - old_off * old_off + diff * diff;
+		if (heap.size() < k || far_rd < heap.front().first) {
+			off[nd.dim] = diff;
+			search_knn(far_ni, level + 1, far_b, far_e, q, far_rd, off, k, exclude, heap);
+			off[nd.dim] = old_off;
+		}
+	}
+	/// recursive search of all points within squared radius r2
+	void search_radius(size_t ni, unsigned level, Idx b, Idx e, const Pnt& q, Crd rd, Crd* off, Crd r2, std::vector<neighbor>& result) const
+	{
+		if (level == depth) {
+			for (Idx l = b; l < e; ++l) {
+				Crd dx = X[l] - q[0], dy = Y[l] - q[1], dz = Z[l] - q[2];
+				Crd d2 = dx * dx + dy * dy + dz * dz;
+				if (d2 <= r2)
+					result.push_back(neighbor(d2, indices[l]));
+			}
+			return;
+		}
+		const node& nd = nodes[ni];
+		Idx m = b + (e - b) / 2;
+		Crd diff = q[nd.dim] - nd.split;
+		size_t near_ni = diff < 0 ? 2 * ni + 1 : 2 * ni + 2, far_ni = diff < 0 ? 2 * ni + 2 : 2 * ni + 1;
+		Idx near_b = diff < 0 ? b : m, near_e = diff < 0 ? m : e, far_b = diff < 0 ? m : b, far_e = diff < 0 ? e : m;
+		search_radius(near_ni, level + 1, near_b, near_e, q, rd, off, r2, result);
+		Crd old_off = off[nd.dim];
+		Crd far_rd = rd - old_off * old_off + diff * diff;
+		if (far_rd <= r2) {
+			off[nd.dim] = diff;
+			search_radius(far_ni, level + 1, far_b, far_e, q, far_rd, off, r2, result);
+			off[nd.dim] = old_off;
+		}
+	}
+public:
+	/// construct empty tree
+	kd_tree() : n(0), depth(0) {}
+	/// clear the used memory
+	void clear()
+	{
+		n = 0;
+		depth = 0;
+		nodes.clear();
+		X.clear();
+		Y.clear();
+		Z.clear();
+		indices.clear();
+	}
+	/// check whether the tree has been built
+	bool is_empty() const { return n == 0; }
+	/// return number of points
+	Cnt get_nr_points() const { return n; }
+	/// build tree from n points, the points are copied and do not need to stay valid
+	void build(Cnt _n, const Pnt* P)
+	{
+		clear();
+		n = _n;
+		if (n == 0)
+			return;
+		while (((size_t(n) + (size_t(1) << depth) - 1) >> depth) > leaf_size)
+			++depth;
+		nodes.resize((size_t(1) << depth) - 1);
+		std::vector<std::pair<Pnt, Idx> > points(n);
+		for (Idx i = 0; i < Idx(n); ++i)
+			points[i] = std::pair<Pnt, Idx>(P[i], i);
+		build_node(points, 0, 0, 0, Idx(n));
+		X.resize(n);
+		Y.resize(n);
+		Z.resize(n);
+		indices.resize(n);
+		for (Idx i = 0; i < Idx(n); ++i) {
+			X[i] = points[i].first[0];
+			Y[i] = points[i].first[1];
+			Z[i] = points[i].first[2];
+			indices[i] = points[i].second;
+		}
+	}
+	/// build tree from a vector of points
+	void build(const std::vector<Pnt>& P) { build(Cnt(P.size()), P.empty() ? 0 : &P[0]); }
+	/// find the k nearest neighbors of q sorted by increasing distance, optionally skip the point with index exclude and return squared distances
+	void find_knn(const Pnt& q, Idx k, std::vector<Idx>& N, std::vector<Crd>* sqr_dists = 0, Idx exclude = -1) const
+	{
+		thread_local std::vector<neighbor> heap;
+		heap.clear();
+		N.clear();
+		if (sqr_dists)
+			sqr_dists->clear();
+		if (n == 0 || k <= 0)
+			return;
+		Crd off[3] = { 0, 0, 0 };
+		search_knn(0, 0, 0, Idx(n), q, 0, off, size_t(k), exclude, heap);
+		std::sort_heap(heap.begin(), heap.end());
+		for (const auto& nb : heap) {
+			N.push_back(nb.second);
+			if (sqr_dists)
+				sqr_dists->push_back(nb.first);
+		}
+	}
+	/// return index of the point closest to q or -1 if the tree is empty
+	Idx find_closest(const Pnt& q) const
+	{
+		thread_local std::vector<Idx> N;
+		find_knn(q, 1, N);
+		return N.empty() ? -1 : N[0];
+	}
+	/// find all points within the given radius around q sorted by increasing distance
+	void find_in_radius(const Pnt& q, Crd radius, std::vector<Idx>& N, std::vector<Crd>* sqr_dists = 0) const
+	{
+		thread_local std::vector<neighbor> result;
+		result.clear();
+		N.clear();
+		if (sqr_dists)
+			sqr_dists->clear();
+		if (n == 0)
+			return;
+		Crd off[3] = { 0, 0, 0 };
+		search_radius(0, 0, 0, Idx(n), q, 0, off, radius * radius, result);
+		std::sort(result.begin(), result.end());
+		for (const auto& nb : result) {
+			N.push_back(nb.second);
+			if (sqr_dists)
+				sqr_dists->push_back(nb.first);
+		}
+	}
+	/// find k nearest neighbors of nq query points in parallel and store them in N[i*k ... i*k+k-1], missing neighbors are set to -1
+	void find_knn(Cnt nq, const Pnt* Q, Idx k, Idx* N, Crd* sqr_dists = 0) const
+	{
+		cgv::pointcloud::utility::parallel_for_range(0, nq, [&](int64_t begin, int64_t end) {
+			std::vector<Idx> Ni;
+			std::vector<Crd> Di;
+			for (int64_t i = begin; i < end; ++i) {
+				find_knn(Q[i], k, Ni, sqr_dists ? &Di : 0);
+				for (Idx j = 0; j < k; ++j) {
+					N[i * k + j] = j < Idx(Ni.size()) ? Ni[j] : -1;
+					if (sqr_dists)
+						sqr_dists[i * k + j] = j < Idx(Di.size()) ? Di[j] : std::numeric_limits<Crd>::max();
+				}
+			}
+		}, 1024);
+	}
+};
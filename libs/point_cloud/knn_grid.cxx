@@ -0,0 +1,211 @@
+#include "knn_grid.h"
+#include "concurrency.h"
+#include "morton.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+knn_grid::knn_grid()
+{
+	P = 0;
+	n = 0;
+	cell_size = 1;
+	res[0] = res[1] = res[2] = 0;
+}
+
+void knn_grid::clear()
+{
+	P = 0;
+	n = 0;
+	res[0] = res[1] = res[2] = 0;
+	cell_begin.clear();
+	point_indices.clear();
+}
+
+knn_grid::Idx knn_grid::cell_index(const Pnt& p, int* c) const
+{
+	for (int j = 0; j < 3; ++j)
+		c[j] = std::max(0, std::min(res[j] - 1, int((p[j] - origin[j]) / cell_size)));
+	return Idx(c[0] + res[0] * (c[1] + res[1] * c[2]));
+}
+
+void knn_grid::build(const point_cloud& pc, Crd points_per_cell)
+{
+	build(Cnt(pc.get_nr_points()), pc.get_nr_points() > 0 ? &pc.pnt(0) : 0, points_per_cell);
+}
+
+void knn_grid::build(Cnt _n, const Pnt* _P, Crd points_per_cell)
+{
+	clear();
+	if (_n == 0)
+		return;
+	n = _n;
+	P = _P;
+	Box B;
+	for (Idx i = 0; i < Idx(n); ++i)
+		B.add_point(P[i]);
+	origin = B.get_min_pnt();
+	Pnt extent = B.get_extent();
+	Crd max_extent = std::max(cgv::math::max_value(extent), std::numeric_limits<Crd>::min());
+	for (int j = 0; j < 3; ++j)
+		extent[j] = std::max(extent[j], 1e-3f * max_extent);
+
+	// start with a cell size for volumetric data and refine it in case of fewer occupied cells, as for example for surface scans
+	points_per_cell = std::max(points_per_cell, Crd(1));
+	double max_nr_cells = 8.0 * n + 64;
+	cell_size = Crd(std::cbrt(double(extent[0]) * extent[1] * extent[2] * points_per_cell / n));
+	std::vector<bool> occupied;
+	for (int iteration = 0; ; ++iteration) {
+		double nr_cells = 1;
+		for (int j = 0; j < 3; ++j) {
+			res[j] = std::max(1, int(std::min(double(extent[j] / cell_size), 1e6)) + 1);
+			nr_cells *= res[j];
+		}
+		if (nr_cells > max_nr_cells) {
+			cell_size *= Crd(std::cbrt(nr_cells / max_nr_cells));
+			continue;
+		}
+		if (iteration >= 3)
+			break;
+		occupied.assign(size_t(nr_cells), false);
+		Cnt nr_occupied = 0;
+		int c[3];
+		for (Idx i = 0; i < Idx(n); ++i) {
+			Idx ci = cell_index(P[i], c);
+			if (!occupied[ci]) {
+				occupied[ci] = true;
+				++nr_occupied;
+			}
+		}
+		double points_per_occupied_cell = double(n) / nr_occupied;
+		if (points_per_occupied_cell < 2 * points_per_cell || nr_cells >= max_nr_cells / 2)
+			break;
+		// assume surface like distribution where the number of points per cell scales quadratically with cell size
+		cell_size /= Crd(std::sqrt(points_per_occupied_cell / points_per_cell));
+	}
+
+	// counting sort of point indices by cell
+	size_t nr_cells = size_t(res[0]) * res[1] * res[2];
+	std::vector<Idx> point_cell(n);
+	cgv::pointcloud::utility::parallel_for_range(0, n, [this, &point_cell](int64_t begin, int64_t end) {
+		int c[3];
+		for (int64_t i = begin; i < end; ++i)
+			point_cell[i] = cell_index(P[i], c);
+	});
+	cell_begin.assign(nr_cells + 1, 0);
+	for (Idx i = 0; i < Idx(n); ++i)
+		++cell_begin[point_cell[i] + 1];
+	for (size_t ci = 0; ci < nr_cells; ++ci)
+		cell_begin[ci + 1] += cell_begin[ci];
+	std::vector<Idx> fill(cell_begin.begin(), cell_begin.end() - 1);
+	point_indices.resize(n);
+	for (Idx i = 0; i < Idx(n); ++i)
+		point_indices[fill[point_cell[i]]++] = i;
+}
+
+void knn_grid::extract_neighbors(Idx i, Idx k, std::vector<Idx>& N) const
+{
+	N.clear();
+	if (k <= 0 || n < 2)
+		return;
+	typedef std::pair<Crd, Idx> entry;
+	thread_local std::vector<entry> heap;
+	heap.clear();
+	size_t nr_neighbors = std::min(size_t(k), size_t(n - 1));
+	const Pnt& q = P[i];
+	int c[3];
+	cell_index(q, c);
+	int max_r = std::max(res[0], std::max(res[1], res[2]));
+	for (int r = 0; r <= max_r; ++r) {
+		// visit all cells at chebyshev distance r from the cell of q
+		for (int dz = -r; dz <= r; ++dz) {
+			int z = c[2] + dz;
+			if (z < 0 || z >= res[2])
+				continue;
+			for (int dy = -r; dy <= r; ++dy) {
+				int y = c[1] + dy;
+				if (y < 0 || y >= res[1])
+					continue;
+				int step = (dz == -r || dz == r || dy == -r || dy == r) ? 1 : 2 * r;
+				for (int dx = -r; dx <= r; dx += step) {
+					int x = c[0] + dx;
+					if (x < 0 || x >= res[0])
+						continue;
+					size_t ci = size_t(x) + size_t(res[0]) * (y + size_t(res[1]) * z);
+					for (Idx l = cell_begin[ci]; l < cell_begin[ci + 1]; ++l) {
+						Idx j = point_indices[l];
+						if (j == i)
+							continue;
+						Crd d2 = (P[j] - q).sqr_length();
+						if (heap.size() < nr_neighbors) {
+							heap.push_back(entry(d2, j));
+							std::push_heap(heap.begin(), heap.end());
+						}
+						else if (d2 < heap.front().first) {
+							std::pop_heap(heap.begin(), heap.end());
+							heap.back() = entry(d2, j);
+							std::push_heap(heap.begin(), heap.end());
+						}
+					}
+				}
+			}
+		}
+		if (heap.size() < nr_neighbors)
+			continue;
+		// all points not visited yet are further away than the boundary of the visited cells
+		Crd d = std::numeric_limits<Crd>::max();
+		for (int j = 0; j < 3; ++j) {
+			if (c[j] - r > 0)
+				d = std::min(d, q[j] - (origin[j] + (c[j] - r) * cell_size));
+			if (c[j] + r < res[j] - 1)
+				d = std::min(d, origin[j] + (c[j] + r + 1) * cell_size - q[j]);
+		}
+		if (d == std::numeric_limits<Crd>::max() || d * d >= heap.front().first)
+			break;
+	}
+	std::sort_heap(heap.begin(), heap.end());
+	N.resize(heap.size());
+	for (size_t l = 0; l < heap.size(); ++l)
+		N[l] = heap[l].second;
+}
+
+void knn_grid::compute_morton_order(Cnt n, const Pnt* P, std::vector<Idx>& order)
+{
+	order.resize(n);
+	if (n == 0)
+		return;
+	Box B;
+	for (Idx i = 0; i < Idx(n); ++i)
+		B.add_point(P[i]);
+	Pnt scale = B.get_extent();
+	for (int j = 0; j < 3; ++j)
+		scale[j] = scale[j] > 0 ? 1023.0f / scale[j] : 0.0f;
+	std::vector<cgv::type::uint32_type> keys(n), sorted_keys(n);
+	std::vector<Idx> sorted_order(n);
+	cgv::pointcloud::utility::parallel_for_range(0, n, [&](int64_t begin, int64_t end) {
+		for (int64_t i = begin; i < end; ++i) {
+			unsigned c[3];
+			for (int j = 0; j < 3; ++j)
+				c[j] = std::min(1023u, unsigned((P[i][j] - B.get_min_pnt()[j]) * scale[j]));
+			keys[i] = cgv::type::uint32_type(cgv::pointcloud::morton_encode_magicbits(c[0], c[1], c[2]));
+			order[i] = Idx(i);
+		}
+	});
+	// least significant digit radix sort of the 30 bit keys with 10 bits per pass
+	std::vector<Idx> count(1025);
+	for (int shift = 0; shift < 30; shift += 10) {
+		std::fill(count.begin(), count.end(), 0);
+		for (Idx i = 0; i < Idx(n); ++i)
+			++count[((keys[i] >> shift) & 1023) + 1];
+		for (int d = 0; d < 1024; ++d)
+			count[d + 1] += count[d];
+		for (Idx i = 0; i < Idx(n); ++i) {
+			Idx& pos = count[(keys[i] >> shift) & 1023];
+			sorted_keys[pos] = keys[i];
+			sorted_order[pos] = order[i];
+			++pos;
+		}
+		keys.swap(sorted_keys);
+		order.swap(sorted_order);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include "point_cloud.h"
+
+#include "lib_begin.h"
+
+/** exact k nearest neighbor search in a uniform grid, which is an alternative to ann_tree for scans of roughly uniform
+    density. Queries are thread safe such that the grid can be used to build a neighbor graph in parallel. */
+class CGV_API knn_grid : public point_cloud_types
+{
+protected:
+	const Pnt* P;
+	Cnt n;
+	/// origin and size of grid cells
+	Pnt origin;
+	Crd cell_size;
+	/// number of cells per dimension
+	int res[3];
+	/// begin of the points of each cell in point_indices, followed by an end marker
+	std::vector<Idx> cell_begin;
+	/// point indices sorted by cell
+	std::vector<Idx> point_indices;
+	/// return linear index of the cell containing p
+	Idx cell_index(const Pnt& p, int* c) const;
+public:
+	/// construct empty grid
+	knn_grid();
+	/// clear the used memory
+	void clear();
+	/// check whether the grid has been built
+	bool is_empty() const { return n == 0; }
+	/// build for complete point cloud, the grid resolution is chosen such that occupied cells contain about points_per_cell points
+	void build(const point_cloud& pc, Crd points_per_cell = 2);
+	/// build for the given points, which need to stay valid while the grid is used
+	void build(Cnt n, const Pnt* P, Crd points_per_cell = 2);
+	/// provide necessary method for building a neighbor graph, N is sorted by increasing distance and does not contain i
+	void extract_neighbors(Idx i, Idx k, std::vector<Idx>& N) const;
+	/// compute a permutation of the given points sorting them along a morton curve with 10 bits per dimension
+	static void compute_morton_order(Cnt n, const Pnt* P, std::vector<Idx>& order);
+};
+
+#include <cgv/config/lib_end.h>
@@ -0,0 +1,179 @@
+#include "mapped_point_cloud.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+#ifdef _MSC_VER
+#pragma warning(disable:4996)
+#endif
+
+mapped_point_cloud::mapped_point_cloud()
+{
+	memset(&header, 0, sizeof(mpc_header));
+}
+
+mapped_point_cloud::mapped_point_cloud(const std::string& file_name)
+{
+	memset(&header, 0, sizeof(mpc_header));
+	open(file_name);
+}
+
+mapped_point_cloud::~mapped_point_cloud()
+{
+	close();
+}
+
+bool mapped_point_cloud::open(const std::string& file_name)
+{
+	close();
+	if (!file.open(file_name))
+		return false;
+	if (file.get_size() < sizeof(mpc_header)) {
+		std::cerr << "mapped_point_cloud::open(" << file_name << "): file too small" << std::endl;
+		close();
+		return false;
+	}
+	memcpy(&header, file.get_data(), sizeof(mpc_header));
+	if (header.magic == 0x4D504300) {
+		std::cerr << "mapped_point_cloud::open(" << file_name << "): file was written with different byte order" << std::endl;
+		close();
+		return false;
+	}
+	if (!validate()) {
+		std::cerr << "mapped_point_cloud::open(" << file_name << "): invalid or unsupported mpc file" << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void mapped_point_cloud::close()
+{
+	file.close();
+	memset(&header, 0, sizeof(mpc_header));
+}
+
+void mapped_point_cloud::prefetch_chunks(size_t ci_begin, size_t ci_end)
+{
+	ci_end = std::min(ci_end, get_nr_chunks());
+	if (ci_begin >= ci_end)
+		return;
+	size_t element_sizes[MPC_NR_SECTIONS - 1] = { sizeof(Pnt), sizeof(Nml), sizeof(Clr), sizeof(GLint) };
+	size_t begin = chunk_begin(ci_begin), end = chunk_begin(ci_end - 1) + chunk_nr_points(ci_end - 1);
+	for (int s = 0; s < MPC_CHUNK_BOXES; ++s)
+		if (header.section_offsets[s] != 0)
+			file.prefetch(size_t(header.section_offsets[s]) + begin*element_sizes[s], (end - begin)*element_sizes[s]);
+}
+
+bool mapped_point_cloud::validate() const
+{
+	if (header.magic != MPC_MAGIC || header.version == 0 || header.version > MPC_VERSION)
+		return false;
+	if (header.chunk_size == 0 || header.nr_chunks != (header.nr_points + header.chunk_size - 1) / header.chunk_size)
+		return false;
+#ifdef BYTE_COLORS
+	bool byte_colors = true;
+#else
+	bool byte_colors = false;
+#endif
+	if (has_colors() && ((header.flags & MPC_HAS_BYTE_CLRS) != 0) != byte_colors)
+		return false;
+	size_t element_sizes[MPC_NR_SECTIONS] = { sizeof(Pnt), sizeof(Nml), sizeof(Clr), sizeof(GLint), sizeof(Box) };
+	bool present[MPC_NR_SECTIONS] = { true, has_normals(), has_colors(), has_labels(), has_chunk_boxes() };
+	for (int s = 0; s < MPC_NR_SECTIONS; ++s) {
+		if (!present[s])
+			continue;
+		cgv::type::uint64_type offset = header.section_offsets[s];
+		cgv::type::uint64_type count = s == MPC_CHUNK_BOXES ? header.nr_chunks : header.nr_points;
+		if (offset == 0 || offset % MPC_ALIGNMENT != 0 || offset + count * element_sizes[s] > file.get_size())
+			return false;
+	}
+	return true;
+}
+
+size_t mapped_point_cloud::chunk_nr_points(size_t ci) const
+{
+	return std::min(size_t(header.chunk_size), get_nr_points() - chunk_begin(ci));
+}
+
+/// write zero bytes to file until the file position is a multiple of MPC_ALIGNMENT
+static bool pad_to_alignment(FILE* fp, cgv::type::uint64_type& pos)
+{
+	static const char zeros[4096] = { 0 };
+	while (pos % MPC_ALIGNMENT != 0) {
+		size_t n = std::min(size_t(MPC_ALIGNMENT - pos % MPC_ALIGNMENT), sizeof(zeros));
+		if (fwrite(zeros, 1, n, fp) != n)
+			return false;
+		pos += n;
+	}
+	return true;
+}
+
+bool mapped_point_cloud::write(const std::string& file_name, size_t nr_points, const Pnt* p, const Nml* n, const Clr* c, const GLint* l,
+	unsigned chunk_size, bool store_chunk_boxes)
+{
+	if (chunk_size == 0)
+		chunk_size = MPC_DEFAULT_CHUNK_SIZE;
+	chunk_size = ((chunk_size + MPC_CHUNK_GRANULARITY - 1) / MPC_CHUNK_GRANULARITY) * MPC_CHUNK_GRANULARITY;
+	if (nr_points == 0) {
+		n = 0, c = 0, l = 0;
+		store_chunk_boxes = false;
+	}
+
+	mpc_header h;
+	memset(&h, 0, sizeof(mpc_header));
+	h.magic = MPC_MAGIC;
+	h.version = MPC_VERSION;
+	h.chunk_size = chunk_size;
+	h.nr_points = nr_points;
+	h.nr_chunks = (nr_points + chunk_size - 1) / chunk_size;
+	h.flags += n ? MPC_HAS_NMLS : 0;
+	h.flags += c ? MPC_HAS_CLRS : 0;
+#ifdef BYTE_COLORS
+	h.flags += c ? MPC_HAS_BYTE_CLRS : 0;
+#endif
+	h.flags += l ? MPC_HAS_LABELS : 0;
+	h.flags += store_chunk_boxes ? MPC_HAS_CHUNK_BOXES : 0;
+
+	// compute overall and per chunk bounding boxes
+	std::vector<Box> chunk_boxes(size_t(h.nr_chunks));
+	Box B;
+	for (size_t ci = 0; ci < chunk_boxes.size(); ++ci) {
+		size_t end = std::min(nr_points, (ci + 1) * chunk_size);
+		for (size_t i = ci * chunk_size; i < end; ++i)
+			chunk_boxes[ci].add_point(p[i]);
+		B.add_axis_aligned_box(chunk_boxes[ci]);
+	}
+	if (nr_points > 0) {
+		std::copy(&B.get_min_pnt()[0], &B.get_min_pnt()[0] + 3, h.box);
+		std::copy(&B.get_max_pnt()[0], &B.get_max_pnt()[0] + 3, h.box + 3);
+	}
+
+	// layout sections in the order of the MPCSection enum
+	const void* arrays[MPC_NR_SECTIONS] = { p, n, c, l, store_chunk_boxes ? &chunk_boxes.front() : 0 };
+	size_t nr_bytes[MPC_NR_SECTIONS] = { nr_points * sizeof(Pnt), nr_points * sizeof(Nml), nr_points * sizeof(Clr), nr_points * sizeof(GLint), chunk_boxes.size() * sizeof(Box) };
+	cgv::type::uint64_type offset = MPC_ALIGNMENT;
+	for (int s = 0; s < MPC_NR_SECTIONS; ++s) {
+		if (s != MPC_POSITIONS && (!arrays[s] || nr_bytes[s] == 0))
+			continue;
+		h.section_offsets[s] = offset;
+		offset += ((nr_bytes[s] + MPC_ALIGNMENT - 1) / MPC_ALIGNMENT) * MPC_ALIGNMENT;
+	}
+
+	FILE* fp = fopen(file_name.c_str(), "wb");
+	if (!fp)
+		return false;
+	cgv::type::uint64_type pos = sizeof(mpc_header);
+	bool success = fwrite(&h, sizeof(mpc_header), 1, fp) == 1;
+	for (int s = 0; success && s < MPC_NR_SECTIONS; ++s) {
+		if (h.section_offsets[s] == 0)
+			continue;
+		success = pad_to_alignment(fp, pos) && pos == h.section_offsets[s];
+		if (success && nr_bytes[s] > 0) {
+			success = fwrite(arrays[s], 1, nr_bytes[s], fp) == nr_bytes[s];
+			pos += nr_bytes[s];
+		}
+	}
+	return fclose(fp) == 0 && success;
+}
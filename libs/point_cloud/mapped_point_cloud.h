@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <cgv/utils/mapped_file.h>
+#include "point_cloud.h"
+
+#include "lib_begin.h"
+
+/// magic number stored in the first four bytes of a mapped point cloud file ("MPC" followed by a zero byte)
+#define MPC_MAGIC 0x0043504D
+/// version of the mapped point cloud format written by this implementation
+#define MPC_VERSION 1
+/// alignment in bytes of all sections in a mapped point cloud file, chosen as multiple of all common page sizes
+#define MPC_ALIGNMENT 65536
+/// default number of points per chunk, must be a multiple of MPC_CHUNK_GRANULARITY
+#define MPC_DEFAULT_CHUNK_SIZE 65536
+/// chunk sizes are multiples of this number such that chunk boundaries of all attribute arrays are page aligned
+#define MPC_CHUNK_GRANULARITY 4096
+
+/// flags stored in the header of a mapped point cloud file
+enum MPCFlags
+{
+	MPC_HAS_NMLS = 1,
+	MPC_HAS_CLRS = 2,
+	MPC_HAS_BYTE_CLRS = 4,
+	MPC_HAS_LABELS = 8,
+	MPC_HAS_CHUNK_BOXES = 16
+};
+
+/// sections of a mapped point cloud file, each one starts at a multiple of MPC_ALIGNMENT
+enum MPCSection
+{
+	MPC_POSITIONS,
+	MPC_NORMALS,
+	MPC_COLORS,
+	MPC_LABELS,
+	MPC_CHUNK_BOXES,
+	MPC_NR_SECTIONS
+};
+
+/** fixed size header at the beginning of a mapped point cloud file (*.mpc). All values are stored in the byte order of
+    the writing machine, which is detected from the magic number such that files of the other byte order are rejected.
+    Attribute arrays are stored tightly packed in sections that start at multiples of MPC_ALIGNMENT. Points are grouped
+	into chunks of chunk_size points (the last chunk can be smaller) such that each chunk of each attribute array starts on a
+	page boundary and can be paged in independently. Sections of attributes not present have offset 0. */
+struct mpc_header
+{
+	cgv::type::uint32_type magic;
+	cgv::type::uint32_type version;
+	cgv::type::uint32_type flags;
+	cgv::type::uint32_type chunk_size;
+	cgv::type::uint64_type nr_points;
+	cgv::type::uint64_type nr_chunks;
+	cgv::type::uint64_type section_offsets[MPC_NR_SECTIONS];
+	point_cloud_types::Crd box[6];
+};
+
+/** read only view of a point cloud stored in the mapped point cloud format (*.mpc). The file is memory mapped and the
+    attribute arrays are accessed directly in the mapping such that opening a file neither parses nor copies any data and
+	pages are only loaded from disk once they are accessed. */
+class CGV_API mapped_point_cloud : public point_cloud_types
+{
+protected:
+	/// mapping of the file
+	cgv::utils::mapped_file file;
+	/// copy of the file header
+	mpc_header header;
+	/// return pointer to begin of section or 0 if section is not present
+	const void* section(MPCSection s) const { return header.section_offsets[s] == 0 ? 0 : file.get_data() + header.section_offsets[s]; }
+	/// validate header and section extents against file size
+	bool validate() const;
+	/// no copies as the mapping is owned by the instance
+	mapped_point_cloud(const mapped_point_cloud&);
+	mapped_point_cloud& operator = (const mapped_point_cloud&);
+public:
+	/// construct without opening a file
+	mapped_point_cloud();
+	/// construct and open given file
+	mapped_point_cloud(const std::string& file_name);
+	/// close file on destruction
+	~mapped_point_cloud();
+	/// open the given file read only, return false if file cannot be mapped or is not a valid mpc file
+	bool open(const std::string& file_name);
+	/// unmap and close file
+	void close();
+	/// check whether a file is open
+	bool is_open() const { return file.is_open(); }
+	/// asynchronously load the attributes of the chunks in [ci_begin,ci_end), for example before they are rendered
+	void prefetch_chunks(size_t ci_begin, size_t ci_end);
+	/// write given attribute arrays in mpc format, where n, c and l are optional. In case chunk_size is not a multiple of MPC_CHUNK_GRANULARITY, it is rounded up.
+	static bool write(const std::string& file_name, size_t nr_points, const Pnt* p, const Nml* n = 0, const Clr* c = 0, const GLint* l = 0,
+		unsigned chunk_size = MPC_DEFAULT_CHUNK_SIZE, bool store_chunk_boxes = true);
+
+	/**@name access to attributes*/
+	//@{
+	/// return the number of points
+	size_t get_nr_points() const { return size_t(header.nr_points); }
+	/// return the bounding box of all points
+	Box box() const { return Box(Pnt(3, header.box), Pnt(3, header.box + 3)); }
+	/// return whether the file contains normals
+	bool has_normals() const { return (header.flags & MPC_HAS_NMLS) != 0; }
+	/// return whether the file contains colors
+	bool has_colors() const { return (header.flags & MPC_HAS_CLRS) != 0; }
+	/// return whether the file contains labels
+	bool has_labels() const { return (header.flags & MPC_HAS_LABELS) != 0; }
+	/// return pointer to the array of point positions
+	const Pnt* positions() const { return reinterpret_cast<const Pnt*>(section(MPC_POSITIONS)); }
+	/// return pointer to the array of normals or 0 if not present
+	const Nml* normals() const { return reinterpret_cast<const Nml*>(section(MPC_NORMALS)); }
+	/// return pointer to the array of colors or 0 if not present
+	const Clr* colors() const { return reinterpret_cast<const Clr*>(section(MPC_COLORS)); }
+	/// return pointer to the array of labels or 0 if not present
+	const GLint* labels() const { return reinterpret_cast<const GLint*>(section(MPC_LABELS)); }
+	/// return i-th point
+	const Pnt& pnt(size_t i) const { return positions()[i]; }
+	/// return i-th normal
+	const Nml& nml(size_t i) const { return normals()[i]; }
+	/// return i-th color
+	const Clr& clr(size_t i) const { return colors()[i]; }
+	/// return i-th label
+	GLint label(size_t i) const { return labels()[i]; }
+	//@}
+
+	/**@name chunk access*/
+	//@{
+	/// return number of points per chunk
+	size_t get_chunk_size() const { return header.chunk_size; }
+	/// return number of chunks
+	size_t get_nr_chunks() const { return size_t(header.nr_chunks); }
+	/// return index of the first point of chunk ci
+	size_t chunk_begin(size_t ci) const { return ci * header.chunk_size; }
+	/// return number of points in chunk ci
+	size_t chunk_nr_points(size_t ci) const;
+	/// return whether per chunk bounding boxes are available
+	bool has_chunk_boxes() const { return (header.flags & MPC_HAS_CHUNK_BOXES) != 0; }
+	/// return bounding box of chunk ci, only valid if has_chunk_boxes() returns true
+	const Box& chunk_box(size_t ci) const { return reinterpret_cast<const Box*>(section(MPC_CHUNK_BOXES))[ci]; }
+	//@}
+};
+
+#include <cgv/config/lib_end.h>
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <cgv/utils/statistics.h>
 #include <cgv/type/standard_types.h>
+#include "concurrency.h"
 
 #include "lib_begin.h"
 
@@ -67,21 +68,25 @@ struct CGV_API neighbor_graph : public std::vector<std::vector<graph_location::I
 
 	/**@name construction */
 	//@{
-	/// build a knn neighbor graph for n points from a data structure that provides the method extract_neighbors(i, k, vector<Idx>&).
+	/// build a knn neighbor graph for n points from a data structure that provides the thread safe method extract_neighbors(i, k, vector<Idx>&).
+	/// Queries are processed in parallel batches in the order given by query_order, e.g. a morton order computed with knn_grid::compute_morton_order, or by index otherwise.
 	template <typename knn_info>
-	void build(Cnt n, Cnt k, const knn_info& knn, cgv::utils::statistics* he_stats = 0) {
+	void build(Cnt n, Cnt k, const knn_info& knn, cgv::utils::statistics* he_stats = 0, const std::vector<Idx>* query_order = 0) {
 		if (he_stats)
 			he_stats->init();
 		clear();
 		resize(n);
 		nr_half_edges = 0;
+		cgv::pointcloud::utility::parallel_for_range(0, n, [this, k, &knn, query_order](int64_t begin, int64_t end) {
+			for (int64_t l = begin; l < end; ++l) {
+				Idx i = query_order ? (*query_order)[l] : Idx(l);
+				knn.extract_neighbors(i, k, (*this)[i]);
+			}
+		}, 4096);
 		for (Idx i = 0; i < (Idx)n; ++i) {
-			/*if (i % 10000 == 0)
-				std::cout << "build ng " << i << " nr half edges = " << nr_half_edges << std::endl;*/
-			knn.extract_neighbors(i, k, at(i));
 			if (he_stats)
-				he_stats->update(k);
-			nr_half_edges += k;
+				he_stats->update((double)at(i).size());
+			nr_half_edges += Cnt(at(i).size());
 		}
 	}
 	/// ensure the neighbor graph to be symmetric
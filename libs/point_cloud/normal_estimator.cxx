@@ -1,8 +1,77 @@
 #include "normal_estimator.h"
-#include <cgv/math/normal_estimation.h>
+#include "concurrency.h"
 #include <cmath>
 #include <cgv/math/functions.h>
 #include <algorithm>
+#include <cstring>
+
+using cgv::pointcloud::utility::parallel_for_range;
+
+/// compute eigenvector of the symmetric 3x3 matrix (a00,a11,a22,a01,a02,a12) for the eigenvalue lambda from cross products of the rows of A - lambda*I, return false if the eigenvalue is not simple
+static bool eigenvector_sym3(const double* A, double lambda, double* v)
+{
+	double r[3][3] = {
+		{ A[0] - lambda, A[3], A[4] },
+		{ A[3], A[1] - lambda, A[5] },
+		{ A[4], A[5], A[2] - lambda } };
+	double best = 0, s2 = 0;
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j)
+			s2 += r[i][j] * r[i][j];
+		const double* a = r[i], * b = r[(i + 1) % 3];
+		double c[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+		double l2 = c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
+		if (l2 > best) {
+			best = l2;
+			v[0] = c[0]; v[1] = c[1]; v[2] = c[2];
+		}
+	}
+	if (best <= 1e-20 * s2 * s2)
+		return false;
+	double l = std::sqrt(best);
+	v[0] /= l; v[1] /= l; v[2] /= l;
+	return true;
+}
+
+/// compute unit eigenvector of the smallest eigenvalue of a symmetric 3x3 matrix (a00,a11,a22,a01,a02,a12) in closed form
+static void smallest_eigenvector_sym3(const double* A, double* v)
+{
+	static const double pi = 3.14159265358979323846;
+	double p1 = A[3] * A[3] + A[4] * A[4] + A[5] * A[5];
+	double q = (A[0] + A[1] + A[2]) / 3;
+	double p2 = (A[0] - q) * (A[0] - q) + (A[1] - q) * (A[1] - q) + (A[2] - q) * (A[2] - q) + 2 * p1;
+	v[0] = v[1] = 0; v[2] = 1;
+	if (p2 <= 0)
+		return;
+	if (p1 <= 1e-30 * p2) {
+		// diagonal matrix
+		int i = A[0] <= A[1] ? (A[0] <= A[2] ? 0 : 2) : (A[1] <= A[2] ? 1 : 2);
+		v[0] = v[1] = v[2] = 0;
+		v[i] = 1;
+		return;
+	}
+	// trigonometric solution of the characteristic polynomial of B = (A - q*I)/p
+	double p = std::sqrt(p2 / 6);
+	double b00 = (A[0] - q) / p, b11 = (A[1] - q) / p, b22 = (A[2] - q) / p, b01 = A[3] / p, b02 = A[4] / p, b12 = A[5] / p;
+	double r = 0.5 * (b00 * (b11 * b22 - b12 * b12) - b01 * (b01 * b22 - b12 * b02) + b02 * (b01 * b12 - b11 * b02));
+	double phi = std::acos(std::max(-1.0, std::min(1.0, r))) / 3;
+	double lambda_max = q + 2 * p * std::cos(phi);
+	double lambda_min = q + 2 * p * std::cos(phi + 2 * pi / 3);
+	if (eigenvector_sym3(A, lambda_min, v))
+		return;
+	// double smallest eigenvalue as for collinear points, return a direction orthogonal to the eigenvector of the largest eigenvalue
+	double u[3];
+	if (!eigenvector_sym3(A, lambda_max, u))
+		return;
+	int i = std::abs(u[0]) <= std::abs(u[1]) ? (std::abs(u[0]) <= std::abs(u[2]) ? 0 : 2) : (std::abs(u[1]) <= std::abs(u[2]) ? 1 : 2);
+	double e[3] = { 0, 0, 0 };
+	e[i] = 1;
+	v[0] = u[1] * e[2] - u[2] * e[1];
+	v[1] = u[2] * e[0] - u[0] * e[2];
+	v[2] = u[0] * e[1] - u[1] * e[0];
+	double l = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	v[0] /= l; v[1] /= l; v[2] /= l;
+}
 
 normal_estimator::normal_estimator(point_cloud& _pc, neighbor_graph& _ng) : pc(_pc), ng(_ng) 
 {
@@ -47,15 +116,45 @@ normal_estimator::Crd normal_estimator::estimate_scale(Idx vi) const
 	return length(pc.pnt(Ni[ni/2]) - pi)*localization_scale;
 }
 
+normal_estimator::Nml normal_estimator::compute_wls_normal(Idx vi, const std::vector<Crd>& weights) const
+{
+	const std::vector<Idx> &Ni = ng.at(vi);
+	unsigned ni = (unsigned)Ni.size();
+	// weighted mean relative to the point itself
+	const Pnt& pi = pc.pnt(vi);
+	double w_sum = weights[0], m[3] = { 0, 0, 0 };
+	for (unsigned j = 0; j < ni; ++j) {
+		Dir d = pc.pnt(Ni[j]) - pi;
+		double w = weights[j + 1];
+		w_sum += w;
+		m[0] += w * d[0]; m[1] += w * d[1]; m[2] += w * d[2];
+	}
+	if (w_sum <= 0)
+		return Nml(0, 0, 1);
+	m[0] /= w_sum; m[1] /= w_sum; m[2] /= w_sum;
+	// weighted covariance matrix as (a00,a11,a22,a01,a02,a12)
+	double A[6] = { 0, 0, 0, 0, 0, 0 };
+	for (unsigned j = 0; j <= ni; ++j) {
+		double d[3] = { -m[0], -m[1], -m[2] };
+		if (j > 0) {
+			const Pnt& pj = pc.pnt(Ni[j - 1]);
+			d[0] += pj[0] - pi[0]; d[1] += pj[1] - pi[1]; d[2] += pj[2] - pi[2];
+		}
+		double w = weights[j];
+		A[0] += w * d[0] * d[0]; A[1] += w * d[1] * d[1]; A[2] += w * d[2] * d[2];
+		A[3] += w * d[0] * d[1]; A[4] += w * d[0] * d[2]; A[5] += w * d[1] * d[2];
+	}
+	double v[3];
+	smallest_eigenvector_sym3(A, v);
+	return Nml(Crd(v[0]), Crd(v[1]), Crd(v[2]));
+}
+
 /// compute normals from neighbor graph and distance and normal weights
 void normal_estimator::smooth_normals()
 {
 	if (!pc.has_normals())
 		compute_weighted_normals(false);
 
-	std::vector<Crd> weights;
-	std::vector<Pnt> points;
-
 	// copy current normals
 	std::vector<Nml> NS;
 	NS.resize(pc.get_nr_points());
@@ -63,45 +162,46 @@ void normal_estimator::smooth_normals()
 	for (i = 0; i < n; ++i)
 		NS[i] = pc.nml(i);
 
-	for (Idx vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
-		const Pnt& pi = pc.pnt(vi);
-		const Nml& nml_i = pc.nml(vi);
-		const std::vector<Idx> &Ni = ng.at(vi);
-		unsigned ni = (unsigned) Ni.size();
-		Crd l0 = estimate_scale(vi);
-		Crd l0_sqr = l0*l0;
-		Pnt center(0,0,0);
-		Crd weight_sum = 0;
-		Dir nml_avg(0,0,0);
-		Dir ortho(0,0,0);
-		Dir repulse(0,0,0);
-		for (unsigned j=0; j < ni; ++j) {
-			Idx vj = Ni[j];
-			Dir dij = pc.pnt(vj)-pc.pnt(vi);
-			Crd lij_sqr = sqr_length(dij);
-			Crd w_x = exp(-lij_sqr/l0_sqr);
-			Crd w_n = compute_normal_quality(pc.pnt(vi), nml_i, pc.pnt(vj), pc.nml(vj), l0);
-			Crd w   = w_x*w_n;
-
-			// compute area weighted normal
-			dij = (1/sqrt(lij_sqr))*dij;
-			Nml nml_ij = cross(dij,cross(nml_i,dij));
-
-			// add contributions
-			nml_avg += w*pc.nml(vj);
-			ortho   += w*nml_ij;
-			repulse += w*dij;
-			center  += w*pc.pnt(vj);
-			weight_sum += w;
-		}
-		center = (1.0f/weight_sum)*center;
-		NS[vi] = normalize(pc.nml(vi) + 0.4f*normalize(
-			     nml_avg
+	parallel_for_range(0, n, [this, &NS](int64_t begin, int64_t end) {
+		for (Idx vi = Idx(begin); vi < Idx(end); ++vi) {
+			const Nml& nml_i = pc.nml(vi);
+			const std::vector<Idx> &Ni = ng.at(vi);
+			unsigned ni = (unsigned) Ni.size();
+			Crd l0 = estimate_scale(vi);
+			Crd l0_sqr = l0*l0;
+			Pnt center(0,0,0);
+			Crd weight_sum = 0;
+			Dir nml_avg(0,0,0);
+			Dir ortho(0,0,0);
+			Dir repulse(0,0,0);
+			for (unsigned j=0; j < ni; ++j) {
+				Idx vj = Ni[j];
+				Dir dij = pc.pnt(vj)-pc.pnt(vi);
+				Crd lij_sqr = sqr_length(dij);
+				Crd w_x = exp(-lij_sqr/l0_sqr);
+				Crd w_n = compute_normal_quality(pc.pnt(vi), nml_i, pc.pnt(vj), pc.nml(vj), l0);
+				Crd w   = w_x*w_n;
+
+				// compute area weighted normal
+				dij = (1/sqrt(lij_sqr))*dij;
+				Nml nml_ij = cross(dij,cross(nml_i,dij));
+
+				// add contributions
+				nml_avg += w*pc.nml(vj);
+				ortho   += w*nml_ij;
+				repulse += w*dij;
+				center  += w*pc.pnt(vj);
+				weight_sum += w;
+			}
+			center = (1.0f/weight_sum)*center;
+			NS[vi] = normalize(pc.nml(vi) + 0.4f*normalize(
+				     nml_avg
 //		   +0.5f*ortho
 //			-3*(dot(N[vi], center - P[vi])/sqrt(l0_sqr))*repulse
-			-repulse
-			));
-	}
+				-repulse
+				));
+		}
+	});
 	for (i = 0; i < n; ++i)
 		pc.nml(i) = NS[i];
 }
@@ -138,16 +238,16 @@ void normal_estimator::compute_weighted_normals(bool reorient)
 		pc.create_normals();
 		reorient = false;
 	}
-	std::vector<Crd> weights;
-	std::vector<Pnt> points;
-	for (Idx vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
-		compute_weights(vi, weights, &points);
-		Nml new_nml;
-		cgv::math::estimate_normal_wls((unsigned)points.size(), points[0], &weights[0], new_nml);
-		if (reorient && (dot(new_nml,pc.nml(vi)) < 0))
-			new_nml = -new_nml;
-		pc.nml(vi) = new_nml;
-	}
+	parallel_for_range(0, pc.get_nr_points(), [this, reorient](int64_t begin, int64_t end) {
+		std::vector<Crd> weights;
+		for (Idx vi = Idx(begin); vi < Idx(end); ++vi) {
+			compute_weights(vi, weights);
+			Nml new_nml = compute_wls_normal(vi, weights);
+			if (reorient && (dot(new_nml,pc.nml(vi)) < 0))
+				new_nml = -new_nml;
+			pc.nml(vi) = new_nml;
+		}
+	});
 }
 
 /// recompute normals from neighbor graph and distance and normal weights
@@ -185,9 +285,6 @@ void normal_estimator::compute_bilateral_weighted_normals(bool reorient)
 	if (!pc.has_normals())
 		compute_weighted_normals(reorient);
 
-	std::vector<Crd> weights;
-	std::vector<Pnt> points;
-
 	// copy current normals
 	std::vector<Nml> NS;
 	NS.resize(pc.get_nr_points());
@@ -195,14 +292,15 @@ void normal_estimator::compute_bilateral_weighted_normals(bool reorient)
 	for (i = 0; i < n; ++i)
 		NS[i] = pc.nml(i);
 
-	for (Idx vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
-
-		compute_bilateral_weights(vi, weights, &points);
-
-		cgv::math::estimate_normal_wls((unsigned)points.size(), points[0], &weights[0], NS[vi]);
-		if (reorient && (dot(NS[vi],pc.nml(vi)) < 0))
-			NS[vi] = -NS[vi];
-	}
+	parallel_for_range(0, n, [this, reorient, &NS](int64_t begin, int64_t end) {
+		std::vector<Crd> weights;
+		for (Idx vi = Idx(begin); vi < Idx(end); ++vi) {
+			compute_bilateral_weights(vi, weights);
+			NS[vi] = compute_wls_normal(vi, weights);
+			if (reorient && (dot(NS[vi],pc.nml(vi)) < 0))
+				NS[vi] = -NS[vi];
+		}
+	});
 	for (i = 0; i < n; ++i)
 		pc.nml(i) = NS[i];
 }
@@ -213,9 +311,6 @@ void normal_estimator::compute_plane_bilateral_weighted_normals(bool reorient)
 	if (!pc.has_normals())
 		compute_weighted_normals(reorient);
 
-	std::vector<Crd> weights;
-	std::vector<Pnt> points;
-
 	// copy current normals
 	std::vector<Nml> NS;
 	NS.resize(pc.get_nr_points());
@@ -223,72 +318,46 @@ void normal_estimator::compute_plane_bilateral_weighted_normals(bool reorient)
 	for (i = 0; i < n; ++i)
 		NS[i] = pc.nml(i);
 
-	for (Idx vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
-		const Pnt& pi = pc.pnt(vi);
-		const Nml& nml_i = pc.nml(vi);
-		const std::vector<Idx> &Ni = ng.at(vi);
-		unsigned ni = (unsigned) Ni.size();
-		weights.resize(ni+1);
-		points.resize(ni+1);
-		weights[0] = 1;
-		points[0] = pi;
-		Crd l0 = estimate_scale(vi);
-		Crd l0_sqr = l0*l0;
-		Crd err0_sqr = l0_sqr*noise_to_sampling_ratio*noise_to_sampling_ratio;
-		for (unsigned j=0; j < ni; ++j) {
-			Idx vj = Ni[j];
-			Dir dij = pc.pnt(vj)-pc.pnt(vi);
-			Crd lij_sqr = sqr_length(dij);
-			Crd w_x = exp(-lij_sqr/l0_sqr);
-			Crd errij = dot(pc.nml(vj),dij)*dot(pc.nml(vj),dij);
-			Crd w_n = exp(-errij/err0_sqr);
-			Crd w   = w_x*w_n;
-			weights[j+1] = w;
-			points[j+1] = pc.pnt(vj);
+	parallel_for_range(0, n, [this, reorient, &NS](int64_t begin, int64_t end) {
+		std::vector<Crd> weights;
+		for (Idx vi = Idx(begin); vi < Idx(end); ++vi) {
+			const std::vector<Idx> &Ni = ng.at(vi);
+			unsigned ni = (unsigned) Ni.size();
+			weights.resize(ni+1);
+			weights[0] = 1;
+			Crd l0 = estimate_scale(vi);
+			Crd l0_sqr = l0*l0;
+			Crd err0_sqr = l0_sqr*noise_to_sampling_ratio*noise_to_sampling_ratio;
+			for (unsigned j=0; j < ni; ++j) {
+				Idx vj = Ni[j];
+				Dir dij = pc.pnt(vj)-pc.pnt(vi);
+				Crd lij_sqr = sqr_length(dij);
+				Crd w_x = exp(-lij_sqr/l0_sqr);
+				Crd errij = dot(pc.nml(vj),dij)*dot(pc.nml(vj),dij);
+				Crd w_n = exp(-errij/err0_sqr);
+				Crd w   = w_x*w_n;
+				weights[j+1] = w;
+			}
+			NS[vi] = compute_wls_normal(vi, weights);
+			if (reorient && (dot(NS[vi],pc.nml(vi)) < 0))
+				NS[vi] = -NS[vi];
 		}
-		cgv::math::estimate_normal_wls((unsigned)points.size(), points[0], &weights[0], NS[vi]);
-		if (reorient && (dot(NS[vi],pc.nml(vi)) < 0))
-			NS[vi] = -NS[vi];
-	}
+	});
 	for (i = 0; i < n; ++i)
 		pc.nml(i) = NS[i];
 }
 
 #include <cgv/math/union_find.h>
 #include <limits>
+#include <atomic>
+#include <mutex>
 
-struct neighbor_info 
-{
-	struct {
-		unsigned  vj : 31;
-		bool flip : 1;
-	};
-	neighbor_info(unsigned _vj = 0, bool _flip = false) : vj(_vj), flip(_flip) {}
-};
-
-struct edge_info 
-{
-	unsigned vi;
-	struct {
-		unsigned  vj : 31;
-		bool flip : 1;
-	};
-	edge_info(unsigned _vi, unsigned _vj, bool _flip) : vi(_vi), vj(_vj), flip(_flip) {}
-};
-
-struct weighted_edge_info 
+/// edge of the spanning tree used to propagate the normal orientation
+struct tree_edge
 {
-	unsigned vi;
-	struct {
-		unsigned  vj : 31;
-		bool flip : 1;
-	};
-	float w;
-	weighted_edge_info(unsigned _vi, unsigned _vj, float signed_w) : vi(_vi), vj(_vj), w(fabs(signed_w)), flip(signed_w < 0) {}
-	bool operator < (const weighted_edge_info& ei) const 
-	{
-		return w < ei.w;
-	}
+	normal_estimator::Idx vi, vj;
+	bool flip;
+	tree_edge(normal_estimator::Idx _vi, normal_estimator::Idx _vj, bool _flip) : vi(_vi), vj(_vj), flip(_flip) {}
 };
 
 /// orient normals towards given point
@@ -297,10 +366,12 @@ void normal_estimator::orient_normals(const Pnt& view_point)
 	if (!pc.has_normals())
 		compute_weighted_normals(false);
 
-	for (Idx vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
-		if (dot(pc.nml(vi),view_point-pc.pnt(vi)) < 0)
-			pc.nml(vi) = -pc.nml(vi);
-	}
+	parallel_for_range(0, pc.get_nr_points(), [this, &view_point](int64_t begin, int64_t end) {
+		for (Idx vi = Idx(begin); vi < Idx(end); ++vi) {
+			if (dot(pc.nml(vi),view_point-pc.pnt(vi)) < 0)
+				pc.nml(vi) = -pc.nml(vi);
+		}
+	});
 }
 
 
@@ -310,80 +381,167 @@ void normal_estimator::orient_normals()
 	if (!pc.has_normals())
 		compute_weighted_normals(false);
 	std::cout << "orienting normals\n=================" << std::endl;
+	Idx vi, n = (Idx)pc.get_nr_points();
+	if (n == 0)
+		return;
 
-	// compute weighted edges and initial point with smallest x-component
+	// compute edge weights, whose sign tells whether normals need to be flipped along the edge, and initial point with smallest x-component
 	std::cout << "computing weighted edges" << std::endl;
-	std::vector<weighted_edge_info> E;
+	std::vector<size_t> edge_begin(n + 1, 0);
 	Crd min_x = std::numeric_limits<Crd>::max();
-	Idx vi, v0 = 0;
-	for (vi = 0; vi < (Idx)pc.get_nr_points(); ++vi) {
-		const Pnt& pi = pc.pnt(vi);
-		if (pi[0] < min_x) {
-			min_x = pi(0);
+	Idx v0 = 0;
+	for (vi = 0; vi < n; ++vi) {
+		edge_begin[vi + 1] = edge_begin[vi] + ng.at(vi).size();
+		if (pc.pnt(vi)[0] < min_x) {
+			min_x = pc.pnt(vi)[0];
 			v0 = vi;
 		}
-		const Nml& nml_i = pc.nml(vi);
-		const std::vector<Idx> &Ni = ng.at(vi);
-		unsigned ni = (unsigned) Ni.size();
-		for (unsigned j=0; j < ni; ++j) {
-			Idx vj = Ni[j];
-			const Pnt& pj = pc.pnt(vj);
-			const Nml& nml_j = pc.nml(vj);
-			Dir d = normalize(pj-pi);
-			Dir nml_ip = nml_i - 2*dot(nml_i,d)*d;
-			E.push_back(weighted_edge_info(vi,vj,dot(nml_ip, nml_j)));
-		}
 	}
+	std::vector<Crd> W(edge_begin[n]);
+	parallel_for_range(0, n, [this, &edge_begin, &W](int64_t begin, int64_t end) {
+		for (Idx vi = Idx(begin); vi < Idx(end); ++vi) {
+			const Pnt& pi = pc.pnt(vi);
+			const Nml& nml_i = pc.nml(vi);
+			const std::vector<Idx> &Ni = ng.at(vi);
+			for (size_t j = 0; j < Ni.size(); ++j) {
+				Dir d = normalize(pc.pnt(Ni[j]) - pi);
+				Dir nml_ip = nml_i - 2*dot(nml_i,d)*d;
+				Crd w = dot(nml_ip, pc.nml(Ni[j]));
+				// ignore edges between duplicate points
+				W[edge_begin[vi] + j] = std::isfinite(w) ? w : 0;
+			}
+		}
+	});
 
 	std::cout << "construct MST" << std::endl;
-	// compute MST as simple neighborgraph
-	cgv::math::union_find uf(pc.get_nr_points());
-	std::sort(E.begin(), E.end());
-	std::vector<std::vector<neighbor_info> > MST(pc.get_nr_points());
-	for (vi = 1; vi < (Idx)pc.get_nr_points(); ) {
-		if (E.empty()) {
-			std::cerr << "warning: impossible to build MST over neighbor graph " << pc.get_nr_points()-vi <<  " unreachable vertices" << std::endl;
-			break;
-		}
-		const weighted_edge_info& wei = E.back();
-		if (uf.find(wei.vi) != uf.find(wei.vj)) {
-			uf.unite(wei.vi,wei.vj);
-			MST[wei.vi].push_back(neighbor_info(wei.vj, wei.flip));
-			MST[wei.vj].push_back(neighbor_info(wei.vi, wei.flip));
-			++vi;
+	// compute maximum spanning tree with Boruvka's algorithm, where each round finds the best edge leaving each component in parallel
+	cgv::math::union_find uf(n);
+	std::vector<Idx> comp(n);
+	std::vector<std::atomic<uint64_t> > best(n);
+	std::vector<tree_edge> MST;
+	for (;;) {
+		// label components with their roots and flatten the union find structure
+		parallel_for_range(0, n, [&uf, &comp, &best](int64_t begin, int64_t end) {
+			for (int64_t v = begin; v < end; ++v) {
+				int c = int(v);
+				while (uf.id[c] != c)
+					c = uf.id[c];
+				comp[v] = c;
+				best[v].store(0, std::memory_order_relaxed);
+			}
+		});
+		parallel_for_range(0, n, [&uf, &comp](int64_t begin, int64_t end) {
+			for (int64_t v = begin; v < end; ++v)
+				uf.id[v] = comp[v];
+		});
+		// find per component the strongest edge to another component, encoded as valid flag, weight bits and index of the vertex whose neighbor list contains the edge
+		parallel_for_range(0, n, [this, &edge_begin, &W, &comp, &best](int64_t begin, int64_t end) {
+			auto update_best = [&best](Idx c, Crd w_abs, Idx vi) {
+				uint32_t w_bits;
+				std::memcpy(&w_bits, &w_abs, sizeof(w_bits));
+				uint64_t key = (uint64_t(1) << 63) | (uint64_t(w_bits) << 32) | uint32_t(vi);
+				std::atomic<uint64_t>& b = best[c];
+				uint64_t current = b.load(std::memory_order_relaxed);
+				while (key > current && !b.compare_exchange_weak(current, key, std::memory_order_relaxed))
+					;
+			};
+			for (Idx vi = Idx(begin); vi < Idx(end); ++vi) {
+				const std::vector<Idx> &Ni = ng.at(vi);
+				Crd w_max = -1;
+				for (size_t j = 0; j < Ni.size(); ++j) {
+					if (comp[Ni[j]] == comp[vi])
+						continue;
+					Crd w_abs = std::abs(W[edge_begin[vi] + j]);
+					w_max = std::max(w_max, w_abs);
+					// the edge also leaves the component of the neighbor, whose neighbor lists need not contain vi
+					update_best(comp[Ni[j]], w_abs, vi);
+				}
+				if (w_max >= 0)
+					update_best(comp[vi], w_max, vi);
+			}
+		});
+		// merge components along their best edges
+		size_t nr_edges = MST.size();
+		for (Idx c = 0; c < n; ++c) {
+			uint64_t key = best[c].load(std::memory_order_relaxed);
+			if (comp[c] != c || key == 0)
+				continue;
+			Idx vi = Idx(key & 0xffffffff);
+			uint32_t w_bits = uint32_t(key >> 32) & 0x7fffffff;
+			const std::vector<Idx> &Ni = ng.at(vi);
+			for (size_t j = 0; j < Ni.size(); ++j) {
+				Crd w = W[edge_begin[vi] + j], w_abs = std::abs(w);
+				if (comp[Ni[j]] == comp[vi] || (comp[vi] != c && comp[Ni[j]] != c) || std::memcmp(&w_abs, &w_bits, sizeof(w_bits)) != 0)
+					continue;
+				if (uf.find(vi) != uf.find(Ni[j])) {
+					uf.unite(vi, Ni[j]);
+					MST.push_back(tree_edge(vi, Ni[j], w < 0));
+				}
+				break;
+			}
 		}
-		E.pop_back();
+		if (MST.size() == nr_edges)
+			break;
 	}
-	E.clear();
-
-	/*
-	for (vi = 0; vi < n; ++vi) {
-		(*ng)[vi].clear();
-		for (unsigned i=0;i<MST[vi].size(); ++i)
-			(*ng)[vi].push_back(MST[vi][i].vj);
-	}*/
+	W.clear();
+	W.shrink_to_fit();
+	if (MST.size() + 1 < size_t(n))
+		std::cerr << "warning: impossible to build MST over neighbor graph " << n - 1 - MST.size() << " unreachable vertices" << std::endl;
+
+	// adjacency of the spanning tree
+	std::vector<Idx> tree_begin(n + 1, 0);
+	for (const auto& e : MST) {
+		++tree_begin[e.vi + 1];
+		++tree_begin[e.vj + 1];
+	}
+	for (vi = 0; vi < n; ++vi)
+		tree_begin[vi + 1] += tree_begin[vi];
+	std::vector<std::pair<Idx, bool> > tree_neighbors(tree_begin[n]);
+	std::vector<Idx> fill(tree_begin.begin(), tree_begin.end() - 1);
+	for (const auto& e : MST) {
+		tree_neighbors[fill[e.vi]++] = std::pair<Idx, bool>(e.vj, e.flip);
+		tree_neighbors[fill[e.vj]++] = std::pair<Idx, bool>(e.vi, e.flip);
+	}
+	MST.clear();
 
 	std::cout << "flipping edges starting at v0=" << v0 << std::endl;
-	unsigned nr = 0;
-	// flip starting with v0
-	std::vector<edge_info> Q;
-	Q.push_back(edge_info(v0,-1,pc.nml(v0)(0)>0));
-	if (pc.nml(v0)(0)>0)
-		pc.nml(v0) = -pc.nml(v0);
-	while (!Q.empty()) {
-		edge_info ei = Q.back();
-		Q.pop_back();
-		const std::vector<neighbor_info>& ni = MST[ei.vi];
-		for (unsigned i=0; i<ni.size(); ++i) {
-			unsigned vj = ni[i].vj;
-			if (vj == ei.vj)
-				continue;
-			if (ni[i].flip != ei.flip) {
-				pc.nml(vj) = -pc.nml(vj);
-				++nr;
+	// propagate orientation from v0 breadth first and process each level in parallel, which is race free as each vertex has a single parent in the tree
+	std::vector<Idx> parent(n, -1);
+	std::vector<char> flip(n, 0);
+	parent[v0] = v0;
+	flip[v0] = pc.nml(v0)(0) > 0;
+	std::vector<Idx> frontier(1, v0), next;
+	std::mutex next_mutex;
+	while (!frontier.empty()) {
+		next.clear();
+		parallel_for_range(0, frontier.size(), [&](int64_t begin, int64_t end) {
+			std::vector<Idx> local_next;
+			for (int64_t f = begin; f < end; ++f) {
+				Idx vi = frontier[f];
+				for (Idx l = tree_begin[vi]; l < tree_begin[vi + 1]; ++l) {
+					Idx vj = tree_neighbors[l].first;
+					if (vj == parent[vi])
+						continue;
+					parent[vj] = vi;
+					flip[vj] = flip[vi] ^ char(tree_neighbors[l].second);
+					local_next.push_back(vj);
+				}
 			}
-			Q.push_back(edge_info(vj,ei.vi,ei.flip ^ ni[i].flip));
-		}
+			std::lock_guard<std::mutex> lock(next_mutex);
+			next.insert(next.end(), local_next.begin(), local_next.end());
+		});
+		frontier.swap(next);
 	}
+	std::atomic<unsigned> nr(0);
+	parallel_for_range(0, n, [this, &parent, &flip, &nr](int64_t begin, int64_t end) {
+		unsigned local_nr = 0;
+		for (Idx vi = Idx(begin); vi < Idx(end); ++vi) {
+			if (parent[vi] >= 0 && flip[vi]) {
+				pc.nml(vi) = -pc.nml(vi);
+				++local_nr;
+			}
+		}
+		nr += local_nr;
+	});
 	std::cout << "flipped " << nr << " edges" << std::endl;
 }
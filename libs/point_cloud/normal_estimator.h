@@ -11,7 +11,8 @@ enum BilateralWeightType {
 };
 
 /** the normal estimator class needs a reference to a point_cloud and a neighbor_graph and allows to
-    compute [[bilaterally] weighted] least squares normals and to consistently orient the normals */
+    compute [[bilaterally] weighted] least squares normals and to consistently orient the normals. All
+    computations are processed in parallel. */
 class CGV_API normal_estimator : public point_cloud_types
 {
 protected:
@@ -29,6 +30,8 @@ public:
 	BilateralWeightType bw_type;
 
 	Crd compute_normal_quality(const Pnt& p1, const Nml& n1, const Pnt& p2, const Nml& n2, Crd l0) const;
+	/// compute the weighted least squares normal of point vi and its neighbors, where weights[0] is the weight of vi and weights[j+1] of the j-th neighbor
+	Nml compute_wls_normal(Idx vi, const std::vector<Crd>& weights) const;
 public:
 	/// construct from point cloud and neighbor graph
 	normal_estimator(point_cloud& _pc, neighbor_graph& _ng);
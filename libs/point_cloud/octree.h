@@ -14,7 +14,10 @@
 #include <sstream>
 #include <exception>
 #include <typeinfo>
+#include <cstdio>
 
+#include <cgv/utils/file.h>
+#include <cgv/utils/dir.h>
 #include "concurrency.h"
 #include "morton.h"
 #include "lib_begin.h"
@@ -145,14 +148,29 @@ namespace pointcloud {
 		int z = 0;
 		int size = 0; //cube edge length
 		int numPoints;
-		//point cloud data
+		//point cloud data, null for chunks spilled to a file until they are indexed
 		std::shared_ptr<ChunkPointCloud<point_t>> pc_data;
 		std::string id;
+		//temporary file holding the points of a spilled chunk
+		std::string file_name;
 
-		ChunkNode(std::string node_id, int numPoints) {
+		ChunkNode(std::string node_id, int numPoints, bool allocate = true) {
 			this->numPoints = numPoints;
 			this->id = node_id;
-			this->pc_data = std::make_shared<ChunkPointCloud<point_t>>(numPoints);
+			if (allocate)
+				this->pc_data = std::make_shared<ChunkPointCloud<point_t>>(numPoints);
+		}
+
+		//load the points of a spilled chunk and remove the temporary file
+		bool load() {
+			if (pc_data != nullptr || file_name.empty())
+				return pc_data != nullptr;
+			pc_data = std::make_shared<ChunkPointCloud<point_t>>(numPoints);
+			bool success = cgv::utils::file::read(file_name, reinterpret_cast<char*>(pc_data->vertices.data()), numPoints * sizeof(point_t));
+			pc_data->numPointsWritten = numPoints;
+			cgv::utils::file::remove(file_name);
+			file_name.clear();
+			return success;
 		}
 
 	};
@@ -163,6 +181,37 @@ namespace pointcloud {
 		vec3 min, max;
 	};
 
+	/// interface for streaming the input of the out-of-core lod generation in batches
+	template <typename point_t>
+	struct PointStream {
+		/// restart streaming at the first point, the input is traversed once per pass of the generator
+		virtual bool rewind() = 0;
+		/// read up to max_points points into buffer and return the number of read points, 0 signals the end of the stream
+		virtual size_t read(point_t* buffer, size_t max_points) = 0;
+		virtual ~PointStream() {}
+	};
+
+	/// streams points from a binary file storing a plain array of point_t after an optional header of offset bytes
+	template <typename point_t>
+	struct RawPointFileStream : public PointStream<point_t> {
+		FILE* fp = nullptr;
+		long offset = 0;
+
+		RawPointFileStream(const std::string& file_name, long offset = 0) : offset(offset) {
+			fp = fopen(file_name.c_str(), "rb");
+		}
+		~RawPointFileStream() {
+			if (fp)
+				fclose(fp);
+		}
+		bool rewind() override {
+			return fp != nullptr && fseek(fp, offset, SEEK_SET) == 0;
+		}
+		size_t read(point_t* buffer, size_t max_points) override {
+			return fp ? fread(buffer, sizeof(point_t), max_points, fp) : 0;
+		}
+	};
+
 	// sampler for bottom up sampling
 	template <typename point_t>
 	struct Sampler {
@@ -220,9 +269,31 @@ class octree_lod_generator : public cgv::render::render_types {
 				node.points = nullptr;
 			}
 		};
+
+		// this indexer appends finished nodes with assigned levels to a file and releases their points, used for out-of-core generation
+		struct FileIndexer : public Indexer {
+			FILE* fp;
+			bool success = true;
+			std::mutex mtx_write;
+			FileIndexer(FILE* fp) : fp(fp) {}
+
+			void finish_node(IndexNode<point_t>& node) override {
+				assert(node.sampled);
+				if (node.points != nullptr) {
+					for (auto& vert : *node.points)
+						vert.level() = node.level();
+					std::lock_guard<std::mutex> lock(mtx_write);
+					success = success && fwrite(node.points->data(), sizeof(point_t), node.points->size(), fp) == node.points->size();
+				}
+				node.points = nullptr;
+			}
+		};
 		
 		int max_points_per_chunk = -1;
 
+		/// number of points read per batch from a PointStream in out-of-core lod generation
+		int64_t out_of_core_batch_size = 1'000'000;
+
 	protected:
 
 		inline std::string to_node_id(int level, int gridSize, int64_t x, int64_t y, int64_t z);
@@ -254,12 +325,18 @@ class octree_lod_generator : public cgv::render::render_types {
 		inline void lod_counting_core(std::function<void(int64_t first_point, int64_t num_points)>& processor, const int64_t num_points);
 
 
-		inline NodeLUT lod_createLUT(std::vector<std::atomic_int32_t>& grid, int64_t grid_size,std::vector<ChunkNode<point_t>>& nodes);
+		inline NodeLUT lod_createLUT(std::vector<std::atomic_int32_t>& grid, int64_t grid_size,std::vector<ChunkNode<point_t>>& nodes, bool allocate_chunk_data = true);
 			
 		//create chunk nodes
 		inline void distribute_points(vec3 min, vec3 max, float cube_size, int64_t grid_size, NodeLUT& lut, const point_t* vertices, const int64_t num_points, const std::vector<ChunkNode<point_t>>& nodes);
-		//inout chunks
-		inline void indexing(Chunks<point_t>& chunks, Indexer& indexer, Sampler<point_t>& sampler);
+		//finish a root node containing all points, used if all points share the same position
+		inline void finish_root_only(const point_t* points, size_t num_points, Indexer& indexer);
+		//create a new directory inside of temp_directory, to which the chunks of one out-of-core lod generation are spilled
+		inline bool create_chunk_directory(const std::string& temp_directory, std::string& chunk_directory);
+		//streaming variant of chunking, which spills the chunks to temporary files in temp_directory
+		inline bool chunking(PointStream<point_t>& input, const int64_t num_points, const vec3& min, const vec3& max, const float& cube_size, const std::string& temp_directory, Chunks<point_t>& chunks);
+		//inout chunks, returns false if a spilled chunk could not be loaded
+		inline bool indexing(Chunks<point_t>& chunks, Indexer& indexer, Sampler<point_t>& sampler);
 			
 		void build_hierarchy(Indexer* indexer, IndexNode<point_t>* node, std::shared_ptr<std::vector<point_t>> points, int64_t numPoints, int64_t depth = 0, int max_points_per_index_node = 10000);
 			
@@ -278,34 +355,47 @@ class octree_lod_generator : public cgv::render::render_types {
 		/// generate points with lod information out of the given vertices
 		inline std::vector<point_t> generate_lods(const std::vector<point_t>& points);
 
+		//! out-of-core lod generation in bounded memory, modeled after PotreeConverter 2
+		/*! The input is streamed in batches of out_of_core_batch_size points three times: to compute the bounding box, to count points
+		    per grid cell and to distribute the points into chunks, which are appended to temporary files in a new directory created
+			inside of temp_directory (defaults to the directory of the output file) and removed afterwards. Afterwards chunks are loaded and indexed independently and the resulting points with lod
+			information are appended to the output file as a plain array of point_t. Only the sampled chunk roots are kept in memory. */
+		inline bool generate_lods(PointStream<point_t>& input, const std::string& output_file_name, const std::string& temp_directory = "");
+
+		/// generate lods for the given points and pass all finished nodes to the given indexer, e.g. to write them to a file
+		inline void generate_lods(const point_t* points, size_t num_points, Indexer& indexer);
+
+		/// out-of-core lod generation passing all finished nodes to the given indexer, chunks are spilled to a new directory inside of temp_directory
+		inline bool generate_lods(PointStream<point_t>& input, Indexer& indexer, const std::string& temp_directory);
+
 		//creates a octree structure out of IndexNodes and returns a shared pointer to the root
 		inline std::shared_ptr<IndexNode<point_t>> build_octree(const std::vector<point_t>& points);
 		
 		//splits points into chunks
 		inline Chunks<point_t> chunking(const point_t* vertices, const size_t num_points, const vec3& min, const vec3& max, const float& size);
 
+		//parallel stages run on the shared cgv::pointcloud::utility::TaskScheduler, init_pool is kept for compatibility
 		octree_lod_generator(bool init_pool = true){
-			//create a thread pool
 			if (init_pool) {
 				init();
 			}
 		}
 
 		bool init() {
-			pool_ptr =
-				  std::make_unique<cgv::pointcloud::utility::WorkerPool>((std::thread::hardware_concurrency() - 1));
-			return pool_ptr != nullptr;
+			//make sure the shared scheduler is running
+			cgv::pointcloud::utility::TaskScheduler::instance();
+			return true;
 		}
 
-		void clear() { 
-			pool_ptr = nullptr;
+		//reset the state of the last lod generation, the shared scheduler keeps running
+		void clear() {
+			max_points_per_chunk = -1;
 		}
 
 		//helper method for managing the singleton in ref_octree_lod_generator
 		void manage_singelton(int& ref_count, int ref_count_change);
 
 	private:
-		std::unique_ptr<cgv::pointcloud::utility::WorkerPool> pool_ptr;
 		bool allow_duplicate_elimination = true;
 };
 
@@ -612,62 +702,94 @@ struct SamplerRandom : public Sampler<point_t> {
 	}
 
 	template <typename point_t>
-	void octree_lod_generator<point_t>::lod_counting_core(std::function<void(int64_t first_point, int64_t num_points)>& processor, const int64_t num_points)
+	bool octree_lod_generator<point_t>::chunking(PointStream<point_t>& input, const int64_t num_points, const vec3& min, const vec3& max, const float& cube_size, const std::string& temp_directory, Chunks<point_t>& chunks)
 	{
-		int64_t points_left = num_points;
-		int64_t batch_size = 1'000'000;
-		int64_t num_read = 0;
+		max_points_per_chunk = std::min<size_t>(num_points / 20, 10'000'000ll);
 
-		struct Task {
-			int64_t first_point;
-			int64_t num_points;
-		};
+		int64_t grid_size = select_grid_size(num_points);
 
-		struct Tasks {
-			std::vector<Task> task_pool;
-			std::atomic_int next_task = 0;
-
-			std::function<void(int64_t first_point, int64_t num_points)> func;
-
-			void operator()() {
-				while (true) {
-					Task* task;
-					//get task
-					{
-						int task_id = next_task.fetch_add(1);
-						if (task_id >= task_pool.size())
-							return;
-						task = &task_pool[task_id];
-					}
-					func(task->first_point, task->num_points);
-				}
-			}
-		} tasks;
-		tasks.func = processor;
+		std::vector<point_t> batch(std::max<int64_t>(out_of_core_batch_size, 1));
+		std::vector<int32_t> batch_indices(batch.size());
+		size_t batch_points;
 
-		//simple thread pool
-		while (points_left > 0) {
+		// process a batch in parallel in pieces of piece_size points
+		static constexpr int64_t piece_size = 65536;
+		auto for_each_piece = [&batch_points](std::function<void(int64_t first_point, int64_t num_points)> func) {
+			cgv::pointcloud::utility::parallel_for_range(0, int64_t(batch_points), [&func](int64_t begin, int64_t end) {
+				func(begin, end - begin);
+			}, piece_size);
+		};
 
-			int64_t num_to_read;
-			if (points_left < batch_size) {
-				num_to_read = points_left;
-				points_left = 0;
-			}
-			else {
-				num_to_read = batch_size;
-				points_left = points_left - batch_size;
-			}
+		// COUNT
+		std::vector<std::atomic_int32_t> grid(grid_size * grid_size * grid_size);
+		if (!input.rewind())
+			return false;
+		int64_t num_counted = 0;
+		while ((batch_points = input.read(batch.data(), batch.size())) > 0) {
+			for_each_piece([this, &batch, &grid, &min, &cube_size, grid_size](int64_t first_point, int64_t num_points) {
+				for (int64_t i = first_point; i < first_point + num_points; ++i) {
+					int64_t index = grid_index(batch[i].position(), min, cube_size, grid_size);
+					grid[index].fetch_add(1, std::memory_order::memory_order_relaxed);
+				}
+			});
+			num_counted += batch_points;
+		}
+		if (num_counted != num_points) {
+			std::cerr << "lod generator: input stream changed between passes" << std::endl;
+			return false;
+		}
 
-			{
-				Task t;
-				t.first_point = num_read;
-				t.num_points = num_to_read;
-				tasks.task_pool.push_back(t);
+		// DISTRIBUTE, points of each chunk are appended to a temporary file
+		auto lut = lod_createLUT(grid, grid_size, chunks.nodes, false);
+		for (auto& node : chunks.nodes)
+			node.file_name = temp_directory + "/chunk_" + node.id + ".bin";
+		std::vector<point_t> sorted(batch.size());
+		std::vector<int64_t> offsets(chunks.nodes.size() + 1);
+		bool success = input.rewind();
+		while (success && (batch_points = input.read(batch.data(), batch.size())) > 0) {
+			for_each_piece([this, &batch, &batch_indices, &lut, &min, &cube_size, grid_size](int64_t first_point, int64_t num_points) {
+				for (int64_t i = first_point; i < first_point + num_points; ++i)
+					batch_indices[i] = lut.grid[grid_index(batch[i].position(), min, cube_size, grid_size)];
+			});
+			// counting sort by chunk index
+			std::fill(offsets.begin(), offsets.end(), 0);
+			for (size_t i = 0; i < batch_points; ++i)
+				++offsets[batch_indices[i] + 1];
+			for (size_t c = 1; c < offsets.size(); ++c)
+				offsets[c] += offsets[c - 1];
+			std::vector<int64_t> positions(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < batch_points; ++i)
+				sorted[positions[batch_indices[i]]++] = batch[i];
+			for (size_t c = 0; success && c < chunks.nodes.size(); ++c) {
+				int64_t count = offsets[c + 1] - offsets[c];
+				if (count == 0)
+					continue;
+				FILE* fp = fopen(chunks.nodes[c].file_name.c_str(), "ab");
+				success = fp && fwrite(&sorted[offsets[c]], sizeof(point_t), count, fp) == size_t(count);
+				if (fp)
+					success = fclose(fp) == 0 && success;
 			}
-			num_read += batch_size;
+		}
+		if (!success) {
+			std::cerr << "lod generator: could not write chunks to " << temp_directory << std::endl;
+			for (auto& node : chunks.nodes)
+				cgv::utils::file::remove(node.file_name);
+			return false;
 		}
 
-		pool_ptr->run([&tasks](int thread_id) {tasks(); });
+		chunks.min = min;
+		chunks.max = max;
+		return true;
+	}
+
+	template <typename point_t>
+	void octree_lod_generator<point_t>::lod_counting_core(std::function<void(int64_t first_point, int64_t num_points)>& processor, const int64_t num_points)
+	{
+		//process batches of at most batch_size points in parallel
+		constexpr int64_t batch_size = 65536;
+		cgv::pointcloud::utility::parallel_for_range(0, num_points, [&processor](int64_t first_point, int64_t end) {
+			processor(first_point, end - first_point);
+		}, batch_size);
 	}
 
 
@@ -765,7 +887,7 @@ struct SamplerRandom : public Sampler<point_t> {
 
 		};
 
-		pool_ptr->run([&tasks](int id) {tasks(); });
+		cgv::pointcloud::utility::parallel_for_each(tasks.pool, tasks.func);
 
 		/* //single thread variant
 		for (int i = 0; i < num_points; ++i) {
@@ -781,7 +903,7 @@ struct SamplerRandom : public Sampler<point_t> {
 	}
 
 	template <typename point_t>
-	NodeLUT octree_lod_generator<point_t>::lod_createLUT(std::vector<std::atomic_int32_t>& grid, int64_t grid_size, std::vector<ChunkNode<point_t>>& nodes)
+	NodeLUT octree_lod_generator<point_t>::lod_createLUT(std::vector<std::atomic_int32_t>& grid, int64_t grid_size, std::vector<ChunkNode<point_t>>& nodes, bool allocate_chunk_data)
 	{
 		nodes.clear();
 
@@ -818,7 +940,7 @@ struct SamplerRandom : public Sampler<point_t> {
 			// grid_high
 
 			// loop through all cells of the lower detail target grid, and for each cell through the 8 enclosed cells of the higher level grid
-			for_xyz(gridSize_low, [this, &nodes, &grid_low, &grid_high, gridSize_low, gridSize_high, level_low, level_high, level_max](int64_t x, int64_t y, int64_t z) {
+			for_xyz(gridSize_low, [this, &nodes, &grid_low, &grid_high, gridSize_low, gridSize_high, level_low, level_high, level_max, allocate_chunk_data](int64_t x, int64_t y, int64_t z) {
 
 				int64_t index_low = x + y * gridSize_low + z * gridSize_low * gridSize_low;
 
@@ -867,7 +989,7 @@ struct SamplerRandom : public Sampler<point_t> {
 
 						if (value > 0) {
 							std::string node_id = to_node_id(level_high, gridSize_high, nx, ny, nz);
-							nodes.emplace_back(node_id, value);
+							nodes.emplace_back(node_id, value, allocate_chunk_data);
 							ChunkNode<point_t>& node = nodes.back();
 
 							node.x = nx;
@@ -944,7 +1066,7 @@ struct SamplerRandom : public Sampler<point_t> {
 	}
 
 	template <typename point_t>
-	void octree_lod_generator<point_t>::indexing(Chunks<point_t>& chunks, Indexer& indexer, Sampler<point_t>& sampler)
+	bool octree_lod_generator<point_t>::indexing(Chunks<point_t>& chunks, Indexer& indexer, Sampler<point_t>& sampler)
 	{
 		struct Task {
 			ChunkNode<point_t>* chunk = nullptr;
@@ -959,36 +1081,28 @@ struct SamplerRandom : public Sampler<point_t> {
 
 		struct Tasks {
 			std::vector<Task> task_pool;
-			std::atomic_int next_task = 0;
-
 			std::function<void(Task*)> func;
-
-			void operator()() {
-				while (true) {
-					Task* task;
-					//get task
-					{
-						int task_id = next_task.fetch_add(1);
-						if (task_id >= task_pool.size())
-							return;
-						task = &task_pool[task_id];
-					}
-					func(task);
-				}
-			}
 		} tasks;
 		
 		std::mutex mtx_nodes;
 		std::vector<std::shared_ptr<IndexNode<point_t>>> nodes;
+		std::atomic<bool> load_failed(false);
 
 		indexer.root = std::make_shared<IndexNode<point_t>>("r", chunks.min, chunks.max);
 		indexer.spacing = (chunks.max - chunks.min).x() / 128.0;
 
 		//builds node hierachy
-		tasks.func = [this, &indexer, &sampler, &nodes, &mtx_nodes](Task* task) {
+		tasks.func = [this, &indexer, &sampler, &nodes, &mtx_nodes, &load_failed](Task* task) {
 			static constexpr float Infinity = std::numeric_limits<float>::infinity();
 			ChunkNode<point_t>* chunk = task->chunk;
 
+			//chunks spilled to disk by out-of-core chunking are loaded on demand
+			if (!chunk->load()) {
+				std::cerr << "lod generator: could not load chunk " << chunk->id << " from " << chunk->file_name << std::endl;
+				load_failed = true;
+				return;
+			}
+
 			vec3 min(Infinity), max(-Infinity);
 
 			for (auto& v : chunk->pc_data->vertices) {
@@ -1016,6 +1130,10 @@ struct SamplerRandom : public Sampler<point_t> {
 
 			sampler.sample(chunk_root, indexer.spacing, onNodeCompleted);
 
+			// the chunk root keeps its sampled points, release all others
+			points = nullptr;
+			chunk->pc_data = nullptr;
+
 			// add chunk root, provided it isn't the root.
 			if (chunk_root->name.size() > 1) {
 				assert(indexer.root != nullptr);
@@ -1032,7 +1150,11 @@ struct SamplerRandom : public Sampler<point_t> {
 			tasks.task_pool.emplace_back(chunk);
 		}
 
-		pool_ptr->run([&tasks](int thread_id) {tasks(); });
+		cgv::pointcloud::utility::parallel_for_each(tasks.task_pool, tasks.func);
+
+		//the hierarchy misses the subtrees of chunks that could not be loaded
+		if (load_failed || nodes.empty())
+			return false;
 
 		if (chunks.nodes.size() == 1) {
 			indexer.root = nodes[0];
@@ -1044,6 +1166,7 @@ struct SamplerRandom : public Sampler<point_t> {
 			sampler.sample(indexer.root, indexer.spacing, onNodeCompleted);
 		}
 		indexer.finish_node(*indexer.root.get());
+		return true;
 	}
 
 	struct NodeCandidate {
@@ -1297,8 +1420,52 @@ struct SamplerRandom : public Sampler<point_t> {
 		std::vector<point_t> out;
 		out.reserve(points.size());
 
-		point_t* source_data = (point_t*)points.data();
-		size_t source_data_size = points.size();
+		FlatIndexer indexer(&out);
+		generate_lods(points.data(), points.size(), indexer);
+		
+		if (out.size() != points.size()) {
+			std::cout << "lod generator: some points were eliminated!\n";
+		}
+		return out;
+	}
+
+	template <typename point_t>
+	void octree_lod_generator<point_t>::finish_root_only(const point_t* points, size_t num_points, Indexer& indexer)
+	{
+		//all points have the same position
+		auto root = std::make_shared<IndexNode<point_t>>("r", points[0].position(), points[0].position());
+		root->points = std::make_shared<std::vector<point_t>>(points, points + (allow_duplicate_elimination ? 1 : num_points));
+		root->num_points = root->points->size();
+		root->sampled = true;
+		indexer.root = root;
+		indexer.finish_node(*root); //assigns root level to all points
+	}
+
+	template <typename point_t>
+	bool octree_lod_generator<point_t>::create_chunk_directory(const std::string& temp_directory, std::string& chunk_directory)
+	{
+		//random names keep concurrent generations, also of different processes, from sharing a directory
+		static std::atomic<unsigned> counter(0);
+		std::random_device rd;
+		for (int attempt = 0; attempt < 16; ++attempt) {
+			chunk_directory = temp_directory + "/lod_chunks_" + std::to_string(rd()) + "_" + std::to_string(counter++);
+			if (cgv::utils::dir::exists(chunk_directory))
+				continue;
+			cgv::utils::dir::mkdir(chunk_directory);
+			if (cgv::utils::dir::exists(chunk_directory))
+				return true;
+			break;
+		}
+		std::cerr << "lod generator: could not create a directory for chunks in " << temp_directory << std::endl;
+		chunk_directory.clear();
+		return false;
+	}
+
+	template <typename point_t>
+	void octree_lod_generator<point_t>::generate_lods(const point_t* points, size_t num_points, Indexer& indexer)
+	{
+		point_t* source_data = (point_t*)points;
+		size_t source_data_size = num_points;
 
 		//find min, max
 		static constexpr float Infinity = std::numeric_limits<float>::infinity();
@@ -1320,17 +1487,8 @@ struct SamplerRandom : public Sampler<point_t> {
 		float cube_size = *std::max_element(ext.begin(), ext.end());
 		
 		//prevent some crashes caused by division by zero
-		if (cube_size == 0.f) {
-			if (allow_duplicate_elimination) {
-				//only copy one point
-				source_data_size = 1;
-			}
-			for (int i = 0; i < source_data_size; ++i) {
-				//all points have the same position
-				point_t p = points[i];
-				p.level() = 0; //assign root level to all points
-				out.push_back(p);
-			}
+		if (source_data_size != 0 && cube_size == 0.f) {
+			finish_root_only(source_data, source_data_size, indexer);
 		}
 		else if (source_data_size != 0) {
 			//run lod generation
@@ -1339,17 +1497,100 @@ struct SamplerRandom : public Sampler<point_t> {
 			Chunks<point_t> nodes = chunking(source_data, source_data_size, min, max, cube_size);
 
 			SamplerRandom<point_t> sampler;
-			FlatIndexer indexer(&out);
 			indexing(nodes, indexer, sampler);
 		}
-		
-		if (out.size() != points.size()) {
-			std::cout << "lod generator: some points were eliminated!\n";
+	}
+
+	template <typename point_t>
+	bool octree_lod_generator<point_t>::generate_lods(PointStream<point_t>& input, const std::string& output_file_name, const std::string& temp_directory)
+	{
+		std::string temp_dir = temp_directory;
+		if (temp_dir.empty()) {
+			temp_dir = cgv::utils::file::get_path(output_file_name);
+			if (temp_dir.empty())
+				temp_dir = ".";
 		}
-		return out;
+		FILE* fp = fopen(output_file_name.c_str(), "wb");
+		if (!fp) {
+			std::cerr << "lod generator: could not open " << output_file_name << " for writing" << std::endl;
+			return false;
+		}
+		FileIndexer indexer(fp);
+		bool success = generate_lods(input, indexer, temp_dir) && indexer.success;
+		success = fclose(fp) == 0 && success;
+		if (!success)
+			std::cerr << "lod generator: out-of-core lod generation of " << output_file_name << " failed" << std::endl;
+		return success;
 	}
-	
 
+	template <typename point_t>
+	bool octree_lod_generator<point_t>::generate_lods(PointStream<point_t>& input, Indexer& indexer, const std::string& temp_directory)
+	{
+		std::vector<point_t> batch(std::max<int64_t>(out_of_core_batch_size, 1));
+		size_t batch_points;
+
+		//find min, max and number of points
+		static constexpr float Infinity = std::numeric_limits<float>::infinity();
+		vec3 min = { Infinity , Infinity , Infinity };
+		vec3 max = { -Infinity , -Infinity , -Infinity };
+		int64_t num_points = 0;
+
+		if (!input.rewind()) {
+			std::cerr << "lod generator: could not read input stream" << std::endl;
+			return false;
+		}
+		while ((batch_points = input.read(batch.data(), batch.size())) > 0) {
+			for (size_t i = 0; i < batch_points; ++i) {
+				const vec3& p = batch[i].position();
+				min.x() = std::min(min.x(), p.x());
+				min.y() = std::min(min.y(), p.y());
+				min.z() = std::min(min.z(), p.z());
+
+				max.x() = std::max(max.x(), p.x());
+				max.y() = std::max(max.y(), p.y());
+				max.z() = std::max(max.z(), p.z());
+			}
+			num_points += batch_points;
+		}
+
+		bool success = true;
+		vec3 ext = max - min;
+		float cube_size = num_points > 0 ? *std::max_element(ext.begin(), ext.end()) : 0.f;
+
+		//prevent some crashes caused by division by zero
+		if (num_points > 0 && cube_size == 0.f) {
+			//the root is finished once per batch
+			success = input.rewind();
+			while (success && (batch_points = input.read(batch.data(), batch.size())) > 0) {
+				finish_root_only(batch.data(), batch_points, indexer);
+				if (allow_duplicate_elimination)
+					break;
+			}
+		}
+		else if (num_points > 0) {
+			//run lod generation
+			max = min + vec3(cube_size, cube_size, cube_size);
+			batch.clear();
+			batch.shrink_to_fit();
+
+			Chunks<point_t> chunks;
+			std::string chunk_directory;
+			success = create_chunk_directory(temp_directory.empty() ? std::string(".") : temp_directory, chunk_directory);
+			if (success) {
+				success = chunking(input, num_points, min, max, cube_size, chunk_directory, chunks);
+				if (success) {
+					SamplerRandom<point_t> sampler;
+					success = indexing(chunks, indexer, sampler);
+				}
+				//remove the files of chunks that have not been loaded
+				for (auto& node : chunks.nodes)
+					if (!node.file_name.empty())
+						cgv::utils::file::remove(node.file_name);
+				cgv::utils::dir::rmdir(chunk_directory);
+			}
+		}
+		return success;
+	}
 
 	template <typename point_t>
 	std::shared_ptr<IndexNode<point_t>> octree_lod_generator<point_t>::build_octree(const std::vector<point_t>& points) {
@@ -0,0 +1,350 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "octree.h"
+
+#include "lib_begin.h"
+
+/// magic number stored in the first four bytes of a lod hierarchy file ("LODH")
+#define LOD_FILE_MAGIC 0x48444F4C
+/// version of the lod hierarchy file format written by this implementation
+#define LOD_FILE_VERSION 1
+
+namespace cgv {
+namespace pointcloud {
+namespace octree {
+
+	/// flags stored in the header of a lod hierarchy file
+	enum LODFileFlags
+	{
+		/// positions are quantized to 16 bit per component relative to the box of their node
+		LOD_FILE_COMPRESSED = 1
+	};
+
+	/** fixed size header at the beginning of a lod hierarchy file. The header is followed by the point blocks of all nodes,
+	    each one a tightly packed array of point records, and the node index starting at index_offset. */
+	struct lod_file_header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t flags;
+		/// size of a stored point record in bytes
+		uint32_t point_size;
+		uint32_t nr_nodes;
+		uint32_t reserved;
+		uint64_t nr_points;
+		uint64_t index_offset;
+		/// bounding cube of the octree given as min and max point
+		float box[6];
+		/// spacing of the root node
+		double spacing;
+	};
+
+	/// entry of the node index, which is stored in breadth first order and each entry is followed by name_length characters of the node name
+	struct lod_file_node
+	{
+		/// file offset of the node's point block
+		uint64_t offset;
+		uint32_t nr_points;
+		uint8_t level;
+		/// bit i is set if child i exists
+		uint8_t child_mask;
+		uint16_t name_length;
+		/// bounding box of the node given as min and max point, also used to quantize compressed positions
+		float box[6];
+	};
+
+	/// conversion between points and stored point records, compressed records replace the position by 16 bit offsets relative to the node box
+	template <typename point_t>
+	struct LODFileCodec : public cgv::render::render_types {
+		bool compressed;
+		size_t position_offset;
+
+		LODFileCodec(bool compressed = false) : compressed(compressed) {
+			point_t p;
+			position_offset = reinterpret_cast<char*>(&p.position()) - reinterpret_cast<char*>(&p);
+		}
+		/// size of a stored point record in bytes
+		size_t record_size() const {
+			return compressed ? sizeof(point_t) - sizeof(vec3) + 3 * sizeof(uint16_t) : sizeof(point_t);
+		}
+		/// convert n points to records
+		void encode(const point_t* points, size_t n, const float* box, char* records) const {
+			if (!compressed) {
+				memcpy(records, points, n * sizeof(point_t));
+				return;
+			}
+			size_t rs = record_size();
+			for (size_t i = 0; i < n; ++i) {
+				const char* src = reinterpret_cast<const char*>(points + i);
+				char* dst = records + i * rs;
+				const vec3& p = points[i].position();
+				uint16_t q[3];
+				for (int c = 0; c < 3; ++c) {
+					float extent = box[c + 3] - box[c];
+					float t = extent > 0.0f ? (p[c] - box[c]) / extent : 0.0f;
+					q[c] = uint16_t(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f + 0.5f);
+				}
+				memcpy(dst, q, sizeof(q));
+				memcpy(dst + sizeof(q), src, position_offset);
+				memcpy(dst + sizeof(q) + position_offset, src + position_offset + sizeof(vec3), sizeof(point_t) - position_offset - sizeof(vec3));
+			}
+		}
+		/// convert n records to points
+		void decode(const char* records, size_t n, const float* box, point_t* points) const {
+			if (!compressed) {
+				memcpy(points, records, n * sizeof(point_t));
+				return;
+			}
+			size_t rs = record_size();
+			for (size_t i = 0; i < n; ++i) {
+				const char* src = records + i * rs;
+				char* dst = reinterpret_cast<char*>(points + i);
+				uint16_t q[3];
+				memcpy(q, src, sizeof(q));
+				memcpy(dst, src + sizeof(q), position_offset);
+				memcpy(dst + position_offset + sizeof(vec3), src + sizeof(q) + position_offset, sizeof(point_t) - position_offset - sizeof(vec3));
+				vec3& p = points[i].position();
+				for (int c = 0; c < 3; ++c)
+					p[c] = box[c] + (box[c + 3] - box[c]) * (q[c] / 65535.0f);
+			}
+		}
+	};
+
+	/// indexer that appends the point blocks of finished nodes to a lod hierarchy file and collects the node index
+	template <typename point_t>
+	struct LODFileIndexer : public octree_lod_generator<point_t>::Indexer {
+		FILE* fp;
+		LODFileCodec<point_t> codec;
+		bool success = true;
+		uint64_t offset = sizeof(lod_file_header);
+		std::vector<lod_file_node> nodes;
+		std::vector<std::string> names;
+		std::mutex mtx_write;
+
+		LODFileIndexer(FILE* fp, bool compress) : fp(fp), codec(compress) {
+			lod_file_header header;
+			memset(&header, 0, sizeof(lod_file_header));
+			success = fwrite(&header, sizeof(lod_file_header), 1, fp) == 1;
+		}
+
+		void finish_node(IndexNode<point_t>& node) override {
+			assert(node.sampled);
+			if (node.points != nullptr && !node.points->empty()) {
+				lod_file_node entry;
+				memset(&entry, 0, sizeof(lod_file_node));
+				entry.nr_points = uint32_t(node.points->size());
+				entry.level = uint8_t(node.level());
+				entry.name_length = uint16_t(node.name.size());
+				std::copy(&node.min[0], &node.min[0] + 3, entry.box);
+				std::copy(&node.max[0], &node.max[0] + 3, entry.box + 3);
+				for (auto& vert : *node.points)
+					vert.level() = node.level();
+				std::vector<char> records(node.points->size() * codec.record_size());
+				codec.encode(node.points->data(), node.points->size(), entry.box, records.data());
+
+				std::lock_guard<std::mutex> lock(mtx_write);
+				entry.offset = offset;
+				success = success && fwrite(records.data(), 1, records.size(), fp) == records.size();
+				offset += records.size();
+				// a node finished repeatedly in succession is extended
+				if (!names.empty() && names.back() == node.name)
+					nodes.back().nr_points += entry.nr_points;
+				else {
+					nodes.push_back(entry);
+					names.push_back(node.name);
+				}
+			}
+			node.points = nullptr;
+		}
+
+		/// sort the node index in breadth first order, write it and the header
+		bool finish() {
+			std::vector<size_t> order(nodes.size());
+			for (size_t i = 0; i < order.size(); ++i)
+				order[i] = i;
+			std::sort(order.begin(), order.end(), [this](size_t i, size_t j) {
+				return names[i].size() < names[j].size() || (names[i].size() == names[j].size() && names[i] < names[j]);
+			});
+			std::unordered_map<std::string, size_t> node_index;
+			for (size_t i : order)
+				node_index[names[i]] = i;
+			for (size_t i : order) {
+				if (names[i].size() < 2)
+					continue;
+				auto parent = node_index.find(names[i].substr(0, names[i].size() - 1));
+				if (parent != node_index.end())
+					nodes[parent->second].child_mask |= uint8_t(1 << (names[i].back() - '0'));
+			}
+			lod_file_header header;
+			memset(&header, 0, sizeof(lod_file_header));
+			header.magic = LOD_FILE_MAGIC;
+			header.version = LOD_FILE_VERSION;
+			header.flags = codec.compressed ? LOD_FILE_COMPRESSED : 0;
+			header.point_size = uint32_t(codec.record_size());
+			header.nr_nodes = uint32_t(nodes.size());
+			header.index_offset = offset;
+			header.spacing = this->spacing;
+			if (this->root) {
+				std::copy(&this->root->min[0], &this->root->min[0] + 3, header.box);
+				std::copy(&this->root->max[0], &this->root->max[0] + 3, header.box + 3);
+			}
+			for (size_t i : order) {
+				header.nr_points += nodes[i].nr_points;
+				success = success && fwrite(&nodes[i], sizeof(lod_file_node), 1, fp) == 1;
+				success = success && fwrite(names[i].data(), 1, names[i].size(), fp) == names[i].size();
+			}
+			success = success && fseek(fp, 0, SEEK_SET) == 0;
+			success = success && fwrite(&header, sizeof(lod_file_header), 1, fp) == 1;
+			return success;
+		}
+	};
+
+	/// build the lod hierarchy of the given points and write it to a lod hierarchy file, positions are quantized if compress is true
+	template <typename point_t>
+	bool write_lod_file(octree_lod_generator<point_t>& generator, const std::vector<point_t>& points, const std::string& file_name, bool compress = false)
+	{
+		FILE* fp = fopen(file_name.c_str(), "wb");
+		if (!fp)
+			return false;
+		LODFileIndexer<point_t> indexer(fp, compress);
+		generator.generate_lods(points.data(), points.size(), indexer);
+		bool success = indexer.finish();
+		return fclose(fp) == 0 && success;
+	}
+
+	/// out-of-core variant of write_lod_file, chunks are spilled to temp_directory which defaults to the directory of the written file
+	template <typename point_t>
+	bool write_lod_file(octree_lod_generator<point_t>& generator, PointStream<point_t>& input, const std::string& file_name, bool compress = false, const std::string& temp_directory = "")
+	{
+		std::string temp_dir = temp_directory.empty() ? cgv::utils::file::get_path(file_name) : temp_directory;
+		FILE* fp = fopen(file_name.c_str(), "wb");
+		if (!fp)
+			return false;
+		LODFileIndexer<point_t> indexer(fp, compress);
+		bool success = generator.generate_lods(input, indexer, temp_dir);
+		success = indexer.finish() && success;
+		return fclose(fp) == 0 && success;
+	}
+
+	/** random access reader for lod hierarchy files. Opening a file only reads the header and the node index, the points
+	    of individual nodes are read on demand. Reading nodes is thread safe. */
+	template <typename point_t>
+	class lod_file : public cgv::render::render_types
+	{
+	protected:
+		std::ifstream is;
+		std::mutex mtx_read;
+		lod_file_header header;
+		LODFileCodec<point_t> codec;
+		std::vector<lod_file_node> nodes;
+		std::vector<std::string> names;
+		std::unordered_map<std::string, size_t> node_index;
+	public:
+		/// construct without opening a file
+		lod_file() { close(); }
+		/// open the given file, return false if it is not a valid lod hierarchy file written for point_t
+		bool open(const std::string& file_name) {
+			close();
+			is.open(file_name, std::ios::binary);
+			if (!is.is_open())
+				return false;
+			if (!is.read(reinterpret_cast<char*>(&header), sizeof(lod_file_header)) ||
+				header.magic != LOD_FILE_MAGIC || header.version == 0 || header.version > LOD_FILE_VERSION) {
+				std::cerr << "lod_file::open(" << file_name << "): invalid or unsupported lod hierarchy file" << std::endl;
+				close();
+				return false;
+			}
+			codec = LODFileCodec<point_t>((header.flags & LOD_FILE_COMPRESSED) != 0);
+			if (header.point_size != codec.record_size()) {
+				std::cerr << "lod_file::open(" << file_name << "): point size does not match" << std::endl;
+				close();
+				return false;
+			}
+			is.seekg(std::streamoff(header.index_offset));
+			nodes.resize(header.nr_nodes);
+			names.resize(header.nr_nodes);
+			for (size_t i = 0; i < nodes.size(); ++i) {
+				if (!is.read(reinterpret_cast<char*>(&nodes[i]), sizeof(lod_file_node)))
+					break;
+				names[i].resize(nodes[i].name_length);
+				if (!is.read(&names[i][0], nodes[i].name_length))
+					break;
+				node_index[names[i]] = i;
+			}
+			if (!is) {
+				std::cerr << "lod_file::open(" << file_name << "): could not read node index" << std::endl;
+				close();
+				return false;
+			}
+			return true;
+		}
+		/// close the file
+		void close() {
+			if (is.is_open())
+				is.close();
+			is.clear();
+			memset(&header, 0, sizeof(lod_file_header));
+			nodes.clear();
+			names.clear();
+			node_index.clear();
+		}
+		/// check whether a file is open
+		bool is_open() const { return header.magic == LOD_FILE_MAGIC; }
+		/// return whether positions are stored quantized
+		bool is_compressed() const { return codec.compressed; }
+		/// return the total number of points
+		size_t get_nr_points() const { return size_t(header.nr_points); }
+		/// return the number of nodes
+		size_t get_nr_nodes() const { return nodes.size(); }
+		/// return the bounding cube of the octree
+		box3 get_box() const { return box3(vec3(3, header.box), vec3(3, header.box + 3)); }
+		/// return the spacing of the root node
+		double get_spacing() const { return header.spacing; }
+		/// return the index entry of the i-th node in breadth first order, where node 0 is the root
+		const lod_file_node& get_node(size_t i) const { return nodes[i]; }
+		/// return the name of the i-th node, i.e. "r" followed by the child indices on the path from the root
+		const std::string& get_node_name(size_t i) const { return names[i]; }
+		/// return the index of the node with the given name or -1 if it does not exist
+		int find_node(const std::string& name) const {
+			auto it = node_index.find(name);
+			return it == node_index.end() ? -1 : int(it->second);
+		}
+		/// return the index of the given child of the i-th node or -1 if it does not exist
+		int find_child(size_t i, int child) const {
+			if ((nodes[i].child_mask & (1 << child)) == 0)
+				return -1;
+			return find_node(names[i] + char('0' + child));
+		}
+		/// read the points of the i-th node
+		bool read_node(size_t i, std::vector<point_t>& points) {
+			const lod_file_node& node = nodes[i];
+			std::vector<char> records(size_t(node.nr_points) * codec.record_size());
+			{
+				std::lock_guard<std::mutex> lock(mtx_read);
+				is.clear();
+				is.seekg(std::streamoff(node.offset));
+				if (!is.read(records.data(), records.size()))
+					return false;
+			}
+			points.resize(node.nr_points);
+			codec.decode(records.data(), node.nr_points, node.box, points.data());
+			return true;
+		}
+		/// read the points of the node with the given name
+		bool read_node(const std::string& name, std::vector<point_t>& points) {
+			int i = find_node(name);
+			return i != -1 && read_node(size_t(i), points);
+		}
+	};
+
+} //octree namespace
+} //pointcloud namespace
+} //cgv namespace
+
+#include <cgv/config/lib_end.h>
@@ -1,12 +1,17 @@
 #include <cgv/math/permute.h>
 #include <cgv/math/det.h>
 #include "point_cloud.h"
+#include "mapped_point_cloud.h"
+#include "concurrency.h"
 #include <cgv/utils/file.h>
+#include <cgv/utils/mapped_file.h>
 #include <cgv/utils/stopwatch.h>
 #include <cgv/utils/scan.h>
 #include <cgv/utils/advanced_scan.h>
 #include <cgv/media/mesh/obj_reader.h>
 #include <fstream>
+#include <algorithm>
+#include <thread>
 
 #pragma warning(disable:4996)
 
@@ -42,6 +47,107 @@ public:
 
 };
 
+/// attributes of a single point parsed from a line of an ascii file
+struct ascii_point : public point_cloud_types
+{
+	enum Attributes { HAS_PNT = 1, HAS_NML = 2, HAS_CLR = 4, HAS_PIXCRD = 8 };
+	Pnt p;
+	Nml n;
+	Clr c;
+	PixCrd i;
+};
+
+//! parse all lines of the text [begin,end) in parallel
+/*! The text is split into one range per thread at line boundaries. After counting the lines per range, the attribute arrays selected in
+    \c attributes are resized to the number of lines and each thread parses its lines directly into the arrays. The callback
+	int parse_line(const char* line_begin, const char* line_end, ascii_point& ap) is called for each non empty line with trailing
+	carriage returns removed and returns the attributes it has set in \c ap. Finally, the ranges are compacted and the arrays resized. */
+template <typename F>
+static void parse_ascii_lines(const char* begin, const char* end, int attributes,
+	std::vector<point_cloud_types::Pnt>& P, std::vector<point_cloud_types::Nml>& N,
+	std::vector<point_cloud_types::Clr>& C, std::vector<point_cloud_types::PixCrd>& I, F parse_line)
+{
+	// use at most one thread per MB of text
+	const size_t min_range_size = 1 << 20;
+	size_t nr_ranges = size_t(cgv::pointcloud::utility::TaskScheduler::instance().get_nr_threads());
+	nr_ranges = std::max(size_t(1), std::min(nr_ranges, size_t(end - begin) / min_range_size));
+	std::vector<const char*> range_begin(nr_ranges + 1, end);
+	range_begin[0] = begin;
+	for (size_t r = 1; r < nr_ranges; ++r) {
+		const char* p = std::max(range_begin[r - 1], begin + r * size_t(end - begin) / nr_ranges);
+		p = std::find(p, end, '\n');
+		range_begin[r] = p < end ? p + 1 : end;
+	}
+	// count lines per range
+	std::vector<size_t> range_offset(nr_ranges + 1, 0);
+	cgv::pointcloud::utility::parallel_for(0, nr_ranges, [&](int64_t r) {
+		const char* b = range_begin[r], * e = range_begin[r + 1];
+		size_t nr_lines = std::count(b, e, '\n');
+		if (b < e && e[-1] != '\n')
+			++nr_lines;
+		range_offset[r + 1] = nr_lines;
+	}, 1);
+	for (size_t r = 0; r < nr_ranges; ++r)
+		range_offset[r + 1] += range_offset[r];
+	size_t nr_lines = range_offset[nr_ranges];
+	if (attributes & ascii_point::HAS_PNT)
+		P.resize(nr_lines);
+	if (attributes & ascii_point::HAS_NML)
+		N.resize(nr_lines);
+	if (attributes & ascii_point::HAS_CLR)
+		C.resize(nr_lines);
+	if (attributes & ascii_point::HAS_PIXCRD)
+		I.resize(nr_lines);
+	// parse lines and count per range the number of parsed values of each attribute
+	std::vector<size_t> range_counts(4 * nr_ranges, 0);
+	cgv::pointcloud::utility::parallel_for(0, nr_ranges, [&](int64_t r) {
+		const char* b = range_begin[r], * e = range_begin[r + 1];
+		size_t* counts = &range_counts[4 * r];
+		size_t offset = range_offset[r];
+		ascii_point ap;
+		while (b < e) {
+			const char* line_end = std::find(b, e, '\n');
+			const char* le = line_end;
+			while (le > b && le[-1] == '\r')
+				--le;
+			int flags = le > b ? parse_line(b, le, ap) & attributes : 0;
+			if (flags & ascii_point::HAS_PNT)
+				P[offset + counts[0]++] = ap.p;
+			if (flags & ascii_point::HAS_NML)
+				N[offset + counts[1]++] = ap.n;
+			if (flags & ascii_point::HAS_CLR)
+				C[offset + counts[2]++] = ap.c;
+			if (flags & ascii_point::HAS_PIXCRD)
+				I[offset + counts[3]++] = ap.i;
+			b = line_end < e ? line_end + 1 : e;
+		}
+	}, 1);
+	// close gaps between ranges
+	size_t sizes[4] = { 0, 0, 0, 0 };
+	for (size_t r = 0; r < nr_ranges; ++r) {
+		const size_t* counts = &range_counts[4 * r];
+		size_t offset = range_offset[r];
+		if (attributes & ascii_point::HAS_PNT)
+			std::copy(P.begin() + offset, P.begin() + offset + counts[0], P.begin() + sizes[0]);
+		if (attributes & ascii_point::HAS_NML)
+			std::copy(N.begin() + offset, N.begin() + offset + counts[1], N.begin() + sizes[1]);
+		if (attributes & ascii_point::HAS_CLR)
+			std::copy(C.begin() + offset, C.begin() + offset + counts[2], C.begin() + sizes[2]);
+		if (attributes & ascii_point::HAS_PIXCRD)
+			std::copy(I.begin() + offset, I.begin() + offset + counts[3], I.begin() + sizes[3]);
+		for (int a = 0; a < 4; ++a)
+			sizes[a] += counts[a];
+	}
+	if (attributes & ascii_point::HAS_PNT)
+		P.resize(sizes[0]);
+	if (attributes & ascii_point::HAS_NML)
+		N.resize(sizes[1]);
+	if (attributes & ascii_point::HAS_CLR)
+		C.resize(sizes[2]);
+	if (attributes & ascii_point::HAS_PIXCRD)
+		I.resize(sizes[3]);
+}
+
 index_image::Idx index_image::get_index(const PixCrd& pixcrd) const
 {
 	return (pixcrd(1) - pixel_range.get_min_pnt()(1))*width + pixcrd(0) - pixel_range.get_min_pnt()(0);
@@ -471,6 +577,8 @@ bool point_cloud::read(const string& _file_name)
 		success = read_bin(_file_name);
 	if (ext == "lpc")
 		success = read_lpc(_file_name);
+	if (ext == "mpc")
+		success = read_mpc(_file_name);
 	if (ext == "xyz")
 		success = read_xyz(_file_name);
 	if (ext == "pct")
@@ -639,6 +747,8 @@ bool point_cloud::write(const string& _file_name)
 		return write_bin(_file_name);
 	if (ext == "lpc")
 		return write_lpc(_file_name);
+	if (ext == "mpc")
+		return write_mpc(_file_name);
 	if (ext == "apc" || ext == "pnt")
 		return write_ascii(_file_name, (ext == "apc") && has_normals());
 	if (ext == "obj" || ext == "pobj")
@@ -686,37 +796,26 @@ bool point_cloud::write_component_transformations(const std::string& file_name,
 /// read ascii file with lines of the form i j x y z I, where ij are pixel coordinates, xyz coordinates and I the intensity
 bool point_cloud::read_pct(const std::string& file_name)
 {
-	string content;
-	// double time;
-	// {
-		// cgv::utils::stopwatch watch(&time);
-		if (!cgv::utils::file::read(file_name, content, true))
-			return false;
-		// std::cout << "read from disk in " << watch.get_elapsed_time() << " sec" << std::endl; watch.restart();
-		clear();
-		vector<line> lines;
-		split_to_lines(content, lines);
-		// std::cout << "split to " << lines.size() << " lines in " << watch.get_elapsed_time() << " sec" << std::endl; watch.restart();
-
-		bool do_parse = false;
-		for (unsigned li = 1; li < lines.size(); ++li) {
-			if (lines[li].empty())
-				continue;
-			Pnt p;
-			int i, j, Intensity;
-			char tmp = lines[li].end[0];
-			content[lines[li].end - content.c_str()] = 0;
-			sscanf(lines[li].begin, "%d %d %f %f %f %d", &i, &j, &p[2], &p[0], &p[1], &Intensity);
-			content[lines[li].end - content.c_str()] = tmp;
-			P.push_back(p);
-			C.push_back(Clr(byte_to_color_component(Intensity), byte_to_color_component(Intensity), byte_to_color_component(Intensity)));
-			I.push_back(PixCrd(i, j));
-
-			if ((P.size() % 100000) == 0)
-				cout << "read " << P.size() << " points" << endl;
-		}
-		// std::cout << "parsed in " << watch.get_elapsed_time() << " sec" << std::endl;
-	// }
+	mapped_file content;
+	if (!content.open(file_name))
+		return false;
+	content.advise(mapped_file::AH_SEQUENTIAL);
+	clear();
+	// skip header line
+	const char* begin = std::find(content.begin(), content.end(), '\n');
+	if (begin < content.end())
+		++begin;
+	parse_ascii_lines(begin, content.end(), ascii_point::HAS_PNT | ascii_point::HAS_CLR | ascii_point::HAS_PIXCRD, P, N, C, I,
+		[](const char* p, const char* e, ascii_point& ap) {
+			int i, j, intensity = 0;
+			if (!((p = parse_int(p, e, i)) && (p = parse_int(p, e, j)) &&
+				  (p = parse_float(p, e, ap.p[2])) && (p = parse_float(p, e, ap.p[0])) && (p = parse_float(p, e, ap.p[1]))))
+				return 0;
+			parse_int(p, e, intensity);
+			ap.c = Clr(byte_to_color_component(intensity), byte_to_color_component(intensity), byte_to_color_component(intensity));
+			ap.i = PixCrd(i, j);
+			return ascii_point::HAS_PNT | ascii_point::HAS_CLR | ascii_point::HAS_PIXCRD;
+		});
 	return true;
 }
 
@@ -724,112 +823,56 @@ bool point_cloud::read_pct(const std::string& file_name)
 /// read ascii file with lines of the form x y z r g b I colors and intensity values, where intensity values are ignored
 bool point_cloud::read_xyz(const std::string& file_name)
 {
-	string content;
 	cgv::utils::stopwatch watch;
-	if (!cgv::utils::file::read(file_name, content, true))
+	mapped_file content;
+	if (!content.open(file_name))
 		return false;
-	std::cout << "read data from disk "; watch.add_time();
+	content.advise(mapped_file::AH_SEQUENTIAL);
+	std::cout << "mapped file "; watch.add_time();
 	clear();
-	vector<line> lines;
-	split_to_lines(content, lines);
-	std::cout << "split data into " << lines.size() << " lines. ";	watch.add_time();
-
-	bool do_parse = false;
-	unsigned i;
-	for (i = 0; i<lines.size(); ++i) {
-		if (lines[i].empty())
-			continue;
-
-		if (true) {
-			Pnt p;
-			int c[3], I;
-			char tmp = lines[i].end[0];
-			content[lines[i].end - content.c_str()] = 0;
-			sscanf(lines[i].begin, "%f %f %f %d %d %d %d", &p[0], &p[1], &p[2], c, c + 1, c + 2, &I);
-			content[lines[i].end - content.c_str()] = tmp;
-			P.push_back(p);
-			C.push_back(Clr(byte_to_color_component(c[0]), byte_to_color_component(c[1]), byte_to_color_component(c[2])));
-		}
-		else {
-
-			vector<token> numbers;
-			tokenizer(lines[i]).bite_all(numbers);
-			double values[7];
-			unsigned n = min(7, (int)numbers.size());
-			unsigned j;
-			for (j = 0; j < n; ++j) {
-				if (!is_double(numbers[j].begin, numbers[j].end, values[j]))
-					break;
-			}
-			if (j >= 3)
-				P.push_back(Pnt((Crd)values[0], (Crd)values[1], (Crd)values[2]));
-			if (j >= 6)
-				C.push_back(Clr(float_to_color_component(values[3]), float_to_color_component(values[4]), float_to_color_component(values[5])));
-		}
-		if ((P.size() % 100000) == 0)
-			cout << "read " << P.size() << " points" << endl;
-	}
-	watch.add_time();
+	parse_ascii_lines(content.begin(), content.end(), ascii_point::HAS_PNT | ascii_point::HAS_CLR, P, N, C, I,
+		[](const char* p, const char* e, ascii_point& ap) {
+			if (!((p = parse_float(p, e, ap.p[0])) && (p = parse_float(p, e, ap.p[1])) && (p = parse_float(p, e, ap.p[2]))))
+				return 0;
+			int c[3] = { 0, 0, 0 };
+			(p = parse_int(p, e, c[0])) && (p = parse_int(p, e, c[1])) && (p = parse_int(p, e, c[2]));
+			ap.c = Clr(byte_to_color_component(c[0]), byte_to_color_component(c[1]), byte_to_color_component(c[2]));
+			return ascii_point::HAS_PNT | ascii_point::HAS_CLR;
+		});
+	std::cout << "parsed " << P.size() << " points "; watch.add_time();
 	return true;
 }
 
 /// read ascii file with lines of the form x y z I r g b intensity and color values, where intensity values are ignored
 bool point_cloud::read_txt(const std::string& file_name)
 {
-	string content;
 	cgv::utils::stopwatch watch;
-	if (!cgv::utils::file::read(file_name, content, true))
+	mapped_file content;
+	if (!content.open(file_name))
 		return false;
-	std::cout << "read data from disk "; watch.add_time();
+	content.advise(mapped_file::AH_SEQUENTIAL);
+	std::cout << "mapped file "; watch.add_time();
 	clear();
-	vector<line> lines;
-	split_to_lines(content, lines);
-	std::cout << "split data into " << lines.size() << " lines. ";	watch.add_time();
-
-	bool do_parse = false;
-	unsigned i;
-	for (i = 0; i < lines.size(); ++i) {
-		if (lines[i].empty())
-			continue;
-
-		if (true) {
-			Pnt p;
-			int icol[3], iint;
-			double dcol[3];
-			char tmp = lines[i].end[0];
-			content[lines[i].end - content.c_str()] = 0;
-			if (sscanf(lines[i].begin, "%f %f %f %d %d %d %d", &p[0], &p[1], &p[2], &iint, icol, icol + 1, icol + 2) == 7) 
-			{
-				P.push_back(p);
-				C.push_back(Clr(byte_to_color_component(icol[0]), byte_to_color_component(icol[1]),
-								byte_to_color_component(icol[2])));
-			}
-			else if (sscanf(lines[i].begin, "%f %f %f %lf %lf %lf", &p[0], &p[1], &p[2], dcol, dcol + 1, dcol + 2) == 6) {
-				P.push_back(p);
-				C.push_back(Clr(float_to_color_component(dcol[0]), float_to_color_component(dcol[1]),
-								float_to_color_component(dcol[2])));
+	parse_ascii_lines(content.begin(), content.end(), ascii_point::HAS_PNT | ascii_point::HAS_CLR, P, N, C, I,
+		[](const char* p, const char* e, ascii_point& ap) {
+			if (!((p = parse_float(p, e, ap.p[0])) && (p = parse_float(p, e, ap.p[1])) && (p = parse_float(p, e, ap.p[2]))))
+				return 0;
+			// first try x y z I r g b with integer intensity and colors
+			int iint, icol[3];
+			const char* q = p;
+			if ((q = parse_int(q, e, iint)) && (q = parse_int(q, e, icol[0])) && (q = parse_int(q, e, icol[1])) && (q = parse_int(q, e, icol[2]))) {
+				ap.c = Clr(byte_to_color_component(icol[0]), byte_to_color_component(icol[1]), byte_to_color_component(icol[2]));
+				return ascii_point::HAS_PNT | ascii_point::HAS_CLR;
 			}
-			content[lines[i].end - content.c_str()] = tmp;
-		}
-		else {
-			vector<token> numbers;
-			tokenizer(lines[i]).bite_all(numbers);
-			double values[7];
-			unsigned n = min(7, (int)numbers.size());
-			unsigned j;
-			for (j = 0; j < n; ++j) {
-				if (!is_double(numbers[j].begin, numbers[j].end, values[j]))
-					break;
+			// otherwise x y z r g b with floating point colors
+			double dcol[3];
+			if ((p = parse_double(p, e, dcol[0])) && (p = parse_double(p, e, dcol[1])) && (p = parse_double(p, e, dcol[2]))) {
+				ap.c = Clr(float_to_color_component(dcol[0]), float_to_color_component(dcol[1]), float_to_color_component(dcol[2]));
+				return ascii_point::HAS_PNT | ascii_point::HAS_CLR;
 			}
-			if (j >= 3)
-				P.push_back(Pnt((Crd)values[0], (Crd)values[1], (Crd)values[2]));
-			if (j >= 6)
-				C.push_back(Clr(float_to_color_component(values[3]), float_to_color_component(values[4]), float_to_color_component(values[5])));
-		}
-		if ((P.size() % 100000) == 0)
-			cout << "read " << P.size() << " points" << endl;
-	}
-	watch.add_time();
+			return 0;
+		});
+	std::cout << "parsed " << P.size() << " points "; watch.add_time();
 	return true;
 }
 /// read e57 file from leica scanner
@@ -1186,6 +1229,31 @@ bool point_cloud::read_bin(const string& file_name)
 	return fclose(fp) == 0 && success;
 }
 
+bool point_cloud::read_mpc(const std::string& file_name)
+{
+	mapped_point_cloud mpc;
+	if (!mpc.open(file_name))
+		return false;
+	clear();
+	size_t n = mpc.get_nr_points();
+	P.assign(mpc.positions(), mpc.positions() + n);
+	if (mpc.has_normals())
+		N.assign(mpc.normals(), mpc.normals() + n);
+	if (mpc.has_colors())
+		C.assign(mpc.colors(), mpc.colors() + n);
+	if (mpc.has_labels())
+		labels.assign(mpc.labels(), mpc.labels() + n);
+	return true;
+}
+
+bool point_cloud::write_mpc(const std::string& file_name) const
+{
+	return mapped_point_cloud::write(file_name, P.size(), P.empty() ? 0 : &P.front(),
+		has_normals() && N.size() == P.size() ? &N.front() : 0,
+		has_colors() && C.size() == P.size() ? &C.front() : 0,
+		labels.size() == P.size() && !labels.empty() ? &labels.front() : 0);
+}
+
 bool point_cloud::read_obj(const string& _file_name) 
 {
 	point_cloud_obj_loader pc_obj(P,N,C);
@@ -1388,26 +1456,33 @@ bool point_cloud::write_e57(const std::string& file_name) const
 
 bool point_cloud::read_ascii(const string& file_name)
 {
-	ifstream is(file_name.c_str());
-	if (is.fail()) 
+	mapped_file content;
+	if (!content.open(file_name))
 		return false;
+	content.advise(mapped_file::AH_SEQUENTIAL);
 	clear();
-	while (!is.eof()) {
-		char buffer[4096];
-		is.getline(buffer,4096);
-		float x, y, z, nx, ny, nz, r, g, b;
-		unsigned int n = sscanf(buffer, "%f %f %f %f %f %f %f %f %f", &x, &y, &z, &nx, &ny, &nz, &r, &g, &b);
-		if (n == 3 || n == 6 || n == 9)
-			P.push_back(Pnt(x,y,z));
-		if (n == 6) {
-			if (no_normals_contained)
-				C.push_back(Clr(float_to_color_component(nx), float_to_color_component(ny), float_to_color_component(nz)));
-			else
-				N.push_back(Nml(nx,ny,nz));
-		}
-		if (n == 9)
-			C.push_back(Clr(float_to_color_component(r), float_to_color_component(g), float_to_color_component(b)));
-	}
+	bool no_nmls = no_normals_contained;
+	parse_ascii_lines(content.begin(), content.end(), ascii_point::HAS_PNT | ascii_point::HAS_NML | ascii_point::HAS_CLR, P, N, C, I,
+		[no_nmls](const char* p, const char* e, ascii_point& ap) {
+			float v[9];
+			int n = 0;
+			while (n < 9 && (p = parse_float(p, e, v[n])))
+				++n;
+			if (n != 3 && n != 6 && n != 9)
+				return 0;
+			ap.p = Pnt(v[0], v[1], v[2]);
+			if (n == 3)
+				return int(ascii_point::HAS_PNT);
+			if (n == 6 && no_nmls) {
+				ap.c = Clr(float_to_color_component(v[3]), float_to_color_component(v[4]), float_to_color_component(v[5]));
+				return ascii_point::HAS_PNT | ascii_point::HAS_CLR;
+			}
+			ap.n = Nml(v[3], v[4], v[5]);
+			if (n == 6)
+				return ascii_point::HAS_PNT | ascii_point::HAS_NML;
+			ap.c = Clr(float_to_color_component(v[6]), float_to_color_component(v[7]), float_to_color_component(v[8]));
+			return ascii_point::HAS_PNT | ascii_point::HAS_NML | ascii_point::HAS_CLR;
+		});
 	return true;
 }
 
@@ -215,6 +215,10 @@ protected:
 		resulting from the extension of the format with colors. */
 	///
 	bool read_bin(const std::string& file_name);
+	//! read memory mapped point cloud format, see mapped_point_cloud.h for format description
+	/*! Positions, normals, colors and labels are copied with one block copy per array from the mapping without parsing.
+	    Use the class mapped_point_cloud directly to access the arrays in the mapping without copying them. */
+	bool read_mpc(const std::string& file_name);
 	//! read a ply format.
 	/*! Ignores all but the vertex elements and from the vertex elements the properties x,y,z,nx,ny,nz:Float32 and red,green,blue,alpha:Uint8.
 	    Colors are transformed to 32-bit floats in the range [0,1] and alpha components are ignored. */
@@ -227,6 +231,8 @@ protected:
 	bool write_ascii(const std::string& file_name, bool write_nmls = true) const;
 	/// write binary format, see read_bin for format description
 	bool write_bin(const std::string& file_name) const;
+	/// write memory mapped point cloud format with per chunk bounding boxes, see read_mpc for format description
+	bool write_mpc(const std::string& file_name) const;
 	/// write obj format, see read_obj for format description
 	bool write_obj(const std::string& file_name) const;
 	/// write ply format, see read_ply for format description
@@ -284,6 +290,7 @@ protected:
 	/*! extension mapping:
 	    - read_ascii: *.pnt,*.apc
 		- read_bin:   *.bin
+		- read_mpc:   *.mpc
 		- read_ply:   *.ply
 		- read_obj:   *.obj
 		- read_points:*.points 
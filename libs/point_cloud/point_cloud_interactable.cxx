@@ -7,6 +7,7 @@
 #include <cgv/signal/rebind.h>
 #include <cgv/base/import.h>
 #include <cgv/utils/file.h>
+#include <cgv/utils/async_io.h>
 #include <cgv/render/view.h>
 #include <cgv/gui/dialog.h>
 #include <cgv/gui/trigger.h>
@@ -19,10 +20,10 @@
 
 #define FILE_OPEN_TITLE "Open Point Cloud"
 #define FILE_APPEND_TITLE "Append Point Cloud"
-#define FILE_OPEN_FILTER "Point Clouds (apc,bpc):*.apc;*.bpc|Mesh Files (obj,ply,pct):*.obj;*.ply;*.pct|All Files:*.*"
+#define FILE_OPEN_FILTER "Point Clouds (apc,bpc,mpc):*.apc;*.bpc;*.mpc|Mesh Files (obj,ply,pct):*.obj;*.ply;*.pct|All Files:*.*"
 
 #define FILE_SAVE_TITLE "Save Point Cloud"
-#define FILE_SAVE_FILTER "Point Clouds (apc,bpc):*.apc;*.bpc|Mesh Files (obj,ply):*.obj;*.ply|All Files:*.*"
+#define FILE_SAVE_FILTER "Point Clouds (apc,bpc,mpc):*.apc;*.bpc;*.mpc|Mesh Files (obj,ply):*.obj;*.ply|All Files:*.*"
 
 void point_cloud_interactable::update_file_name(const std::string& ffn, bool append)
 {
@@ -75,8 +76,14 @@ bool point_cloud_interactable::open_directory(const std::string& dn)
 		std::cerr << "did not find files in directory <" << dn << ">" << std::endl;
 		return false;
 	}
-	unsigned i;
+	// load the next scans into the page cache while the current one is parsed
+	cgv::utils::async_io io;
+	unsigned i, nr_read_ahead = std::min(unsigned(file_names.size()), io.get_nr_threads());
+	for (i = 0; i < nr_read_ahead; ++i)
+		io.read_ahead(directory_name + "/" + file_names[i]);
 	for (i = 0; i < file_names.size(); ++i) {
+		if (i + nr_read_ahead < file_names.size())
+			io.read_ahead(directory_name + "/" + file_names[i + nr_read_ahead]);
 		std::cout << i << "(" << file_names.size() << "): " << file_names[i];
 		std::cout.flush();
 		if (!do_append && i == 0)
@@ -159,9 +166,19 @@ void point_cloud_interactable::build_neighbor_graph()
 	}
 
 	ng.clear();
-	ensure_tree_ds();
 	cgv::utils::statistics he_stats;
-	ng.build(pc.get_nr_points(), k, *tree_ds, &he_stats);
+	// process queries along a morton curve for cache locality
+	std::vector<Idx> query_order;
+	knn_grid::compute_morton_order(Cnt(pc.get_nr_points()), pc.get_nr_points() > 0 ? &pc.pnt(0) : 0, query_order);
+	if (use_grid_knn) {
+		knn_grid grid;
+		grid.build(pc);
+		ng.build(pc.get_nr_points(), k, grid, &he_stats, &query_order);
+	}
+	else {
+		ensure_tree_ds();
+		ng.build(pc.get_nr_points(), k, *tree_ds, &he_stats, &query_order);
+	}
 	if (do_symmetrize)
 		ng.symmetrize();
 	on_point_cloud_change_callback(PCC_NEIGHBORGRAPH_CREATE);
@@ -191,8 +208,6 @@ void point_cloud_interactable::build_neighbor_graph_componentwise()
 			Idx i = l + offset;
 			std::vector<Idx>& Ni = ng[i];
 			T->extract_neighbors(i, k, Ni);
-			for (auto& ni : Ni) 
-				ni += offset;
 			ng.nr_half_edges += k;
 		}
 		delete T;
@@ -341,6 +356,7 @@ point_cloud_interactable::point_cloud_interactable() : ne(pc, ng)
 	show_neighbor_graph = false;
 	k = 30;
 	do_symmetrize = false;
+	use_grid_knn = false;
 	reorient_normals = true;
 }
 void point_cloud_interactable::auto_set_view()
@@ -388,6 +404,7 @@ bool point_cloud_interactable::self_reflect(cgv::reflect::reflection_handler& sr
 		srh.reflect_member("show_neighbor_graph", show_neighbor_graph) &&
 		srh.reflect_member("k", k) &&
 		srh.reflect_member("do_symmetrize", do_symmetrize) &&
+		srh.reflect_member("use_grid_knn", use_grid_knn) &&
 		srh.reflect_member("reorient_normals", reorient_normals);
 }
 void point_cloud_interactable::stream_help(std::ostream& os)
@@ -858,6 +875,7 @@ void point_cloud_interactable::create_gui()
 	if (show) {
 		add_member_control(this, "k", k, "value_slider", "min=3;max=50;log=true;ticks=true");
 		add_member_control(this, "symmetrize", do_symmetrize, "toggle");
+		add_member_control(this, "uniform grid", use_grid_knn, "toggle");
 		cgv::signal::connect_copy(add_button("build")->click, cgv::signal::rebind(this, &point_cloud_interactable::build_neighbor_graph));
 		end_tree_node(show_neighbor_graph);
 	}
@@ -7,6 +7,7 @@
 #include <cgv/base/register.h>
 #include "gl_point_cloud_drawable.h"
 #include "ann_tree.h"
+#include "knn_grid.h"
 #include "neighbor_graph.h"
 #include "normal_estimator.h"
 
@@ -129,6 +130,8 @@ protected:
 	unsigned k;
 	/// whether to symmetric neighbor graph after build
 	bool do_symmetrize;
+	/// whether to build the neighbor graph with the exact uniform grid instead of the ann tree, which is faster for scans of uniform density
+	bool use_grid_knn;
 	/// knn-neighbor graph built with tree_ds
 	neighbor_graph ng;
 	/// build the neighbor graph
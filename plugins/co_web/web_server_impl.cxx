@@ -1,11 +1,6 @@
 #include <cgv/os/web_server.h>
-#include <3rd/webserver/webserver.h>
-
-void request_function(webserver::http_request* r)
-{
-	cgv::os::web_server* ws = (cgv::os::web_server*) r->user_data;
-	ws->handle_request(*r);
-}
+#include <cgv/os/http_server.h>
+#include <mutex>
 
 #ifdef CGV_OS_WEB_EXPORTS
 #	define CGV_EXPORTS
@@ -13,6 +8,7 @@ void request_function(webserver::http_request* r)
 
 #include <cgv/config/lib_begin.h>
 
+/// provider that serves requests with the event driven cgv::os::http_server
 struct CGV_API web_server_provider_impl : public cgv::os::web_server_provider
 {
 	void start_web_server(cgv::os::web_server* instance);
@@ -21,18 +17,34 @@ struct CGV_API web_server_provider_impl : public cgv::os::web_server_provider
 
 #include <cgv/config/lib_end.h>
 
+/// protects the server pointers stored in the user data of the web servers
+static std::mutex server_mutex;
+
 void web_server_provider_impl::start_web_server(cgv::os::web_server* instance)
 {
-	webserver* w = new webserver(instance);
-	ref_user_data(instance) = w;
-	w->start(instance->get_port(), request_function);
+	// server is published before listen, such that a concurrent stop lets run return immediately
+	cgv::os::http_server* server = new cgv::os::http_server([instance](cgv::os::http_request& request) { instance->handle_request(request); });
+	{
+		std::lock_guard<std::mutex> lock(server_mutex);
+		ref_user_data(instance) = server;
+	}
+	if (server->listen(instance->get_port()))
+		server->run();
+	// stop holds the lock until run has returned
+	{
+		std::lock_guard<std::mutex> lock(server_mutex);
+		ref_user_data(instance) = 0;
+	}
+	delete server;
 }
 
 void web_server_provider_impl::stop_web_server(cgv::os::web_server* instance)
 {
-	webserver* w = (webserver*)ref_user_data(instance);
-	w->stop();
-	delete w;
+	// start deletes the server after run has returned
+	std::lock_guard<std::mutex> lock(server_mutex);
+	cgv::os::http_server* server = (cgv::os::http_server*)ref_user_data(instance);
+	if (server)
+		server->stop();
 }
 
 cgv::os::web_server_provider_registration<web_server_provider_impl> web_server_impl_registration;
@@ -23,8 +23,6 @@ using namespace cgv::render;
 using namespace cgv::pointcloud;
 
 namespace {
-	static cgv::pointcloud::utility::WorkerPool pool(std::thread::hardware_concurrency() - 1);
-	
 	//glCheckError from https://learnopengl.com/In-Practice/Debugging
 	GLenum glCheckError_(const char* file, int line)
 	{
@@ -105,45 +103,17 @@ namespace {
 
 		if (run_parralel) {
 
-			struct Task {
-				Point* start;
-				int num_points;
-			};
-			struct Tasks {
-				std::atomic_int next_task = 0;
-				std::vector<Task> task;
-			} tasks;
-
-			int64_t points_distributed = 0;
-			int64_t points_total = input_buffer_data.size();
 			constexpr int64_t batch_size = 500000;
 
-			while (points_distributed < points_total) {
-				int64_t batch = std::min(batch_size, points_total - points_distributed);
-				tasks.task.push_back({ &input_buffer_data[points_distributed],(int)batch });
-				points_distributed += batch;
-			}
-
-			pool.run([&input_buffer_data ,&tasks](int thread_id) {
+			cgv::pointcloud::utility::parallel_for_range(0, input_buffer_data.size(), [&input_buffer_data](int64_t begin, int64_t end) {
 				std::poisson_distribution<int> dist(mean);
 				std::random_device rdev;
 
-				while (true) {
-					//fetch task
-					int tid = tasks.next_task.fetch_add(1, std::memory_order_relaxed);
-					if (tid < tasks.task.size()) {
-						Task& task = tasks.task[tid];
-
-						Point* end = task.start + task.num_points;
-						for (Point* p = task.start; p < end; p++) {
-							p->level() = std::min(2 * mean, std::max(0, mean - abs(dist(rdev) - mean)));
-						}
-					}
-					else {
-						return;
-					}
+				for (int64_t i = begin; i < end; ++i) {
+					Point* p = &input_buffer_data[i];
+					p->level() = std::min(2 * mean, std::max(0, mean - abs(dist(rdev) - mean)));
 				}
-				});
+				}, batch_size);
 		}
 		else {
 			std::poisson_distribution<int> dist(8);
@@ -54,6 +54,11 @@ rgbd_icp_tool::rgbd_icp_tool() {
 	icp_iterations = 50;
 	icp_eps = 1e-8;
 	icp_random_samples = 0;
+	icp_metric_type = ICP::POINT_TO_POINT_METRIC;
+	icp_pyramid_levels = 1;
+	icp_voxel_size = 0;
+	icp_max_distance = 0;
+	icp_print_statistics = false;
 
 	show_corresponding_lines = true;
 
@@ -64,7 +69,8 @@ rgbd_icp_tool::rgbd_icp_tool() {
 bool rgbd_icp_tool::self_reflect(cgv::reflect::reflection_handler & rh)
 {
 	return  rh.reflect_member("ply_path", ply_path)&&
-		    rh.reflect_member("show_corresponding_lines", show_corresponding_lines);
+		    rh.reflect_member("show_corresponding_lines", show_corresponding_lines) &&
+		    rh.reflect_member("icp_print_statistics", icp_print_statistics);
 }
 
 void rgbd_icp_tool::on_set(void * member_ptr)
@@ -228,6 +234,11 @@ void rgbd_icp_tool::create_gui()
 	add_member_control(this, "Sampling Type", (DummyEnum&)icp_filter_type, "dropdown", "enums='Default Sampling,Radom Sampling,Normal-space Sampling'");
 	add_member_control(this, "Random Samples", icp_random_samples, "value_slider",
 					   "min=0;max=10000;log=true;ticks=false");
+	add_member_control(this, "Metric", (DummyEnum&)icp_metric_type, "dropdown", "enums='POINT_TO_POINT,POINT_TO_PLANE'");
+	add_member_control(this, "Pyramid levels", icp_pyramid_levels, "value_slider", "min=1;max=6;ticks=true");
+	add_member_control(this, "Voxel size", icp_voxel_size, "value_slider", "min=0;max=0.1;log=true;ticks=false");
+	add_member_control(this, "Max. distance", icp_max_distance, "value_slider", "min=0;max=1;log=true;ticks=false");
+	add_member_control(this, "Print statistics", icp_print_statistics, "check");
 	add_member_control(this, "show_corresponding_lines", show_corresponding_lines, "check");
 
 	add_decorator("Go-ICP", "heading", "level=2");
@@ -354,9 +365,14 @@ void rgbd_icp_tool::on_reg_ICP_cb()
 	icp.set_iterations(5);
 	icp.set_eps(icp_eps);
 	icp.set_num_random(icp_random_samples);
+	icp.set_metric(icp_metric_type);
+	icp.set_pyramid(icp_pyramid_levels, icp_voxel_size);
+	icp.set_max_correspondence_distance(icp_max_distance);
 
 	icp.build_ann_tree();
 	icp.reg_icp(rotation, translation);
+	if (icp_print_statistics)
+		icp.print_statistics(std::cout);
 	//icp.get_crspd(rotation, translation, crs_srs_pc, crs_tgt_pc);
 	// need to de-mean for rotation
 	source_pc.rotate(cgv::math::quaternion<float>(rotation));
@@ -99,6 +99,12 @@ public:
 	int icp_iterations;
 	int icp_random_samples;
 	cgv::pointcloud::ICP::Sampling_Type icp_filter_type;
+	cgv::pointcloud::ICP::Metric_Type icp_metric_type;
+	int icp_pyramid_levels;
+	float icp_voxel_size;
+	float icp_max_distance;
+	/// whether to print timing and convergence of each ICP iteration to the console
+	bool icp_print_statistics;
 	bool view_find_point_cloud;
 	bool show_corresponding_lines;
 	cgv::pointcloud::GoICP::DistanceComputationMode goicp_distance_computation_mode;
@@ -0,0 +1,160 @@
+#include <cgv/base/base.h>
+#include <cgv/base/register.h>
+#include <cgv/reflect/reflection_index.h>
+#include <cgv/reflect/set_reflection_handler.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+using namespace cgv::base;
+using namespace cgv::reflect;
+
+/// structure reflected as member of the test object
+struct index_test_style : public self_reflection_tag
+{
+	float radius;
+	int mode;
+	bool self_reflect(reflection_handler& rh)
+	{
+		return
+			rh.reflect_member("radius", radius) &&
+			rh.reflect_member("mode", mode);
+	}
+};
+
+/// object with members of all group kinds and a counter of on_set calls
+struct index_test_object : public base
+{
+	int n;
+	double d;
+	std::string s;
+	index_test_style style;
+	index_test_style styles[3];
+	float weights[4];
+	std::vector<int> values;
+	unsigned nr_on_set;
+	index_test_object() : n(1), d(2.5), s("hello"), values(5, 7), nr_on_set(0)
+	{
+		style.radius = 0.5f;
+		style.mode = 2;
+		for (int i = 0; i < 3; ++i) {
+			styles[i].radius = float(i);
+			styles[i].mode = i;
+		}
+		for (int i = 0; i < 4; ++i)
+			weights[i] = 0.25f*i;
+	}
+	std::string get_type_name() const { return "index_test_object"; }
+	/// all reflected members are stored in the object
+	bool use_reflection_index() const { return true; }
+	void on_set(void* member_ptr) { ++nr_on_set; }
+	bool self_reflect(reflection_handler& rh)
+	{
+		return
+			rh.reflect_member("n", n) &&
+			rh.reflect_member("d", d) &&
+			rh.reflect_member("s", s) &&
+			rh.reflect_member("style", style) &&
+			rh.reflect_member("styles", styles) &&
+			rh.reflect_member("weights", weights) &&
+			rh.reflect_member("values", values);
+	}
+};
+
+/// object that reflects its members without opting in to the reflection index
+struct reflected_object : public base
+{
+	int x = 0;
+	std::string get_type_name() const { return "reflected_object"; }
+	bool self_reflect(reflection_handler& rh) { return rh.reflect_member("x", x); }
+};
+
+bool test_reflection_index()
+{
+	cgv::data::ref_ptr<index_test_object, true> o(new index_test_object);
+	const void* object_ptr = dynamic_cast<const void*>(o.operator->());
+	const reflection_index& index = reflection_index::get_type_index(typeid(*o), object_ptr,
+		[&](reflection_handler& rh) { return o->self_reflect(rh); });
+	// members inside of the object are indexed and vector elements are not
+	TEST_ASSERT(index.find("n") != 0);
+	TEST_ASSERT(index.find("style.radius") != 0);
+	TEST_ASSERT(index.find("styles[2].mode") != 0);
+	TEST_ASSERT(index.find("weights[3]") != 0);
+	TEST_ASSERT(index.find("values[0]") == 0);
+	TEST_ASSERT_EQ(reflection_index::get_member_ptr(object_ptr, *index.find("styles[1].radius")), (void*)&o->styles[1].radius);
+	// indexed and reflected paths behave the same
+	o->set("n", 5.0);
+	TEST_ASSERT_EQ(o->n, 5);
+	o->set("style.mode", std::string("3"));
+	TEST_ASSERT_EQ(o->style.mode, 3);
+	o->set("styles[2].radius", 1.5);
+	TEST_ASSERT_EQ(o->styles[2].radius, 1.5f);
+	o->set("values[1]", 9);
+	TEST_ASSERT_EQ(o->values[1], 9);
+	TEST_ASSERT_EQ(o->get<double>("weights[2]"), 0.5);
+	TEST_ASSERT_EQ(o->get<int>("values[1]"), 9);
+	TEST_ASSERT_EQ(o->get<std::string>("s"), "hello");
+	TEST_ASSERT_EQ(o->nr_on_set, 4u);
+	std::string type_name;
+	TEST_ASSERT_EQ(o->find_member_ptr("d", &type_name), (void*)&o->d);
+	TEST_ASSERT_EQ(type_name, "flt64");
+	TEST_ASSERT(!o->set_void("unknown", "int32", &o->n));
+	// handles to indexed and reflected members
+	property_handle h = o->get_property_handle("style.radius");
+	TEST_ASSERT(h.is_valid());
+	TEST_ASSERT(h.set(2.0f));
+	TEST_ASSERT_EQ(o->style.radius, 2.0f);
+	TEST_ASSERT(h.set(3));
+	TEST_ASSERT_EQ(o->style.radius, 3.0f);
+	double r;
+	TEST_ASSERT(h.get(r));
+	TEST_ASSERT_EQ(r, 3.0);
+	property_handle hv = o->get_property_handle("values[4]");
+	TEST_ASSERT(hv.set(11));
+	TEST_ASSERT_EQ(o->values[4], 11);
+	TEST_ASSERT_EQ(o->nr_on_set, 7u);
+	TEST_ASSERT(!o->get_property_handle("unknown").is_valid());
+	// offsets of the index built from the first instance resolve the members of another instance
+	cgv::data::ref_ptr<index_test_object, true> o2(new index_test_object);
+	o2->set("styles[1].mode", 8);
+	TEST_ASSERT_EQ(o2->styles[1].mode, 8);
+	TEST_ASSERT_EQ(o->styles[1].mode, 1);
+	TEST_ASSERT_EQ(o2->find_member_ptr("weights[1]"), (void*)&o2->weights[1]);
+	// types that do not opt in are accessed with reflection
+	cgv::data::ref_ptr<reflected_object, true> ro(new reflected_object);
+	TEST_ASSERT(!ro->use_reflection_index());
+	ro->set("x", 4);
+	TEST_ASSERT_EQ(ro->x, 4);
+	TEST_ASSERT_EQ(ro->find_member_ptr("x"), (void*)&ro->x);
+	return true;
+}
+
+bool benchmark_reflection_index()
+{
+	cgv::data::ref_ptr<index_test_object, true> o(new index_test_object);
+	const unsigned n = 1000000;
+	auto seconds = [](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) { return std::chrono::duration<double>(b - a).count(); };
+	auto t0 = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < n; ++i)
+		o->set("weights[3]", float(i));
+	auto t1 = std::chrono::steady_clock::now();
+	// same accesses with full reflection for comparison
+	for (unsigned i = 0; i < n; ++i) {
+		float v = float(i);
+		set_reflection_handler srh("weights[3]", cgv::type::info::type_name<float>::get_name(), &v);
+		o->self_reflect(srh);
+	}
+	auto t2 = std::chrono::steady_clock::now();
+	property_handle h = o->get_property_handle("weights[3]");
+	for (unsigned i = 0; i < n; ++i)
+		h.set(float(i));
+	auto t3 = std::chrono::steady_clock::now();
+	std::cout << "indexed set: " << 1e9*seconds(t0, t1)/n << " ns, reflected set: " << 1e9*seconds(t1, t2)/n
+		<< " ns, handle set: " << 1e9*seconds(t2, t3)/n << " ns" << std::endl;
+	return o->weights[3] == float(n - 1);
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_reflection_index_reg("cgv::base::test_reflection_index", test_reflection_index);
+extern CGV_API benchmark_registration benchmark_reflection_index_reg("cgv::base::benchmark_reflection_index", benchmark_reflection_index);
@@ -0,0 +1,191 @@
+#include <delaunay/delaunay_mesh_with_hierarchy.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+
+using namespace cgv::base;
+
+typedef delaunay_mesh<> mesh_type;
+typedef delaunay_mesh_with_hierarchy<> hierarchy_mesh_type;
+typedef mesh_type::point_type point_type;
+
+/// generate n uniformly distributed random points in [-1,1]^2 or a regular grid of about n points
+static void generate_points(std::vector<point_type>& P, unsigned int n, bool regular = false)
+{
+	mesh_type M;
+	srand(17);
+	M.generate_sample_data_set(n, regular ? mesh_type::ST_REGULAR : mesh_type::ST_RANDOM, mesh_type::DT_UNIFORM,
+		mesh_type::GT_PSEUDO_RANDOM_DEFAULT, mesh_type::ST_SQUARE, mesh_type::SS_REJECTION, false);
+	P.resize(M.get_nr_vertices());
+	for (unsigned int vi = 0; vi < P.size(); ++vi)
+		P[vi] = M.p_of_vi(vi);
+}
+
+/// return a positive value if p3 is inside the circum circle of the counter clockwise triangle p0, p1, p2
+static double in_circle(const point_type& p0, const point_type& p1, const point_type& p2, const point_type& p3)
+{
+	double x0 = p0.x() - p3.x(), y0 = p0.y() - p3.y();
+	double x1 = p1.x() - p3.x(), y1 = p1.y() - p3.y();
+	double x2 = p2.x() - p3.x(), y2 = p2.y() - p3.y();
+	return (x0*x0 + y0*y0)*(x1*y2 - x2*y1) + (x1*x1 + y1*y1)*(x2*y0 - x0*y2) + (x2*x2 + y2*y2)*(x0*y1 - x1*y0);
+}
+
+/// check corner connectivity, orientation and the delaunay property of all edges and the number of triangles
+template <class M>
+static bool check_triangulation(const M& T, const char* name)
+{
+	unsigned int nr_border_edges = 0;
+	for (unsigned int ci = 0; ci < T.get_nr_corners(); ++ci) {
+		const point_type& p0 = T.p_of_vi(T.vi_of_ci(ci));
+		const point_type& p1 = T.p_of_vi(T.vi_of_ci(T.next(ci)));
+		const point_type& p2 = T.p_of_vi(T.vi_of_ci(T.prev(ci)));
+		if ((p1.x() - p0.x())*(p2.y() - p0.y()) - (p1.y() - p0.y())*(p2.x() - p0.x()) <= 0) {
+			std::cerr << name << ": triangle " << T.ti_of_ci(ci) << " is not counter clockwise" << std::endl;
+			return false;
+		}
+		if (T.is_opposite_to_border(ci)) {
+			++nr_border_edges;
+			continue;
+		}
+		unsigned int cj = T.inv(ci);
+		if (T.is_opposite_to_border(cj) || T.inv(cj) != ci ||
+			T.vi_of_ci(T.next(ci)) != T.vi_of_ci(T.prev(cj)) || T.vi_of_ci(T.prev(ci)) != T.vi_of_ci(T.next(cj))) {
+			std::cerr << name << ": inconsistent opposite of corner " << ci << std::endl;
+			return false;
+		}
+		if (in_circle(p0, p1, p2, T.p_of_vi(T.vi_of_ci(cj))) > 1e-12) {
+			std::cerr << name << ": edge opposite to corner " << ci << " is not locally delaunay" << std::endl;
+			return false;
+		}
+	}
+	std::vector<bool> used(T.get_nr_vertices(), false);
+	for (unsigned int ci = 0; ci < T.get_nr_corners(); ++ci)
+		used[T.vi_of_ci(ci)] = true;
+	unsigned int nr_vertices = (unsigned int)std::count(used.begin(), used.end(), true);
+	if (T.get_nr_triangles() != 2 * nr_vertices - nr_border_edges - 2) {
+		std::cerr << name << ": " << T.get_nr_triangles() << " triangles for " << nr_vertices << " vertices and "
+			<< nr_border_edges << " border edges" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/// extract triangles as sorted list of vertex index triples starting with the smallest index, mapped through permutation if given
+template <class M>
+static void extract_triangles(const M& T, std::vector<std::vector<unsigned int> >& triangles, const std::vector<unsigned int>* permutation = 0)
+{
+	triangles.clear();
+	for (unsigned int ci = 0; ci < T.get_nr_corners(); ci += 3) {
+		std::vector<unsigned int> t(3);
+		for (unsigned int j = 0; j < 3; ++j)
+			t[j] = permutation ? (*permutation)[T.vi_of_ci(ci + j)] : T.vi_of_ci(ci + j);
+		std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+		triangles.push_back(t);
+	}
+	std::sort(triangles.begin(), triangles.end());
+}
+
+/// triangulate points with given insertion order and number of threads, check result and compare with reference triangles if given
+static bool test_insertion_order(const std::vector<point_type>& P, mesh_type::InsertionOrder io, unsigned int nr_threads,
+	const std::vector<std::vector<unsigned int> >* reference_triangles, const char* name)
+{
+	mesh_type T;
+	for (const auto& p : P)
+		T.add_point(p);
+	T.set_insertion_order(io);
+	T.set_nr_threads(nr_threads);
+	T.set_parallel_threshold(1000);
+	std::vector<unsigned int> permutation;
+	T.compute_triangulation(&permutation);
+	if (!check_triangulation(T, name))
+		return false;
+	for (unsigned int vi = 0; vi < P.size(); ++vi)
+		if (T.p_of_vi(vi).x() != P[permutation[vi]].x() || T.p_of_vi(vi).y() != P[permutation[vi]].y()) {
+			std::cerr << name << ": point " << vi << " does not match permutation" << std::endl;
+			return false;
+		}
+	if (reference_triangles) {
+		std::vector<std::vector<unsigned int> > triangles;
+		extract_triangles(T, triangles, &permutation);
+		if (triangles != *reference_triangles) {
+			std::cerr << name << ": triangulation differs from reference" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool test_delaunay_mesh()
+{
+	bool result = true;
+	std::vector<point_type> P;
+	generate_points(P, 20000);
+	// the delaunay triangulation of random points is unique
+	hierarchy_mesh_type H;
+	for (const auto& p : P)
+		H.add_point(p);
+	H.compute_triangulation();
+	std::vector<std::vector<unsigned int> > reference_triangles;
+	extract_triangles(H, reference_triangles);
+	if (!check_triangulation(H, "hierarchy"))
+		result = false;
+	if (!test_insertion_order(P, mesh_type::IO_INPUT, 1, &reference_triangles, "input order") ||
+		!test_insertion_order(P, mesh_type::IO_HILBERT, 1, &reference_triangles, "hilbert order") ||
+		!test_insertion_order(P, mesh_type::IO_BRIO, 1, &reference_triangles, "brio") ||
+		!test_insertion_order(P, mesh_type::IO_BRIO, 4, &reference_triangles, "brio with 4 partitions") ||
+		!test_insertion_order(P, mesh_type::IO_HILBERT, 7, &reference_triangles, "hilbert order with 7 partitions"))
+		result = false;
+	// grid points with collinear and cocircular points
+	generate_points(P, 2500, true);
+	if (!test_insertion_order(P, mesh_type::IO_BRIO, 1, 0, "brio on grid") ||
+		!test_insertion_order(P, mesh_type::IO_BRIO, 4, 0, "brio with 4 partitions on grid"))
+		result = false;
+	return result;
+}
+
+/// measure time to triangulate the points with the given mesh
+template <class M>
+static double measure_triangulation(const std::vector<point_type>& P, M& T)
+{
+	for (const auto& p : P)
+		T.add_point(p);
+	auto t0 = std::chrono::steady_clock::now();
+	T.compute_triangulation();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool benchmark_delaunay_mesh()
+{
+	bool result = true;
+	for (unsigned int n : { 1000000u, 4000000u }) {
+		std::vector<point_type> P;
+		generate_points(P, n);
+		hierarchy_mesh_type H;
+		double t_hierarchy = measure_triangulation(P, H);
+		std::cout << n << " points: hierarchy " << t_hierarchy << " s";
+		unsigned int nr_triangles = H.get_nr_triangles();
+		H.clear();
+		struct { mesh_type::InsertionOrder io; unsigned int nr_threads; const char* name; } configs[] = {
+			{ mesh_type::IO_HILBERT, 1, "hilbert" }, { mesh_type::IO_BRIO, 1, "brio" }, { mesh_type::IO_BRIO, 0, "parallel brio" }
+		};
+		for (const auto& c : configs) {
+			mesh_type T;
+			T.set_insertion_order(c.io);
+			T.set_nr_threads(c.nr_threads);
+			double t = measure_triangulation(P, T);
+			std::cout << ", " << c.name << " " << t << " s";
+			if (T.get_nr_triangles() != nr_triangles) {
+				std::cerr << std::endl << c.name << ": " << T.get_nr_triangles() << " triangles instead of " << nr_triangles << std::endl;
+				result = false;
+			}
+		}
+		std::cout << std::endl;
+	}
+	return result;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_delaunay_mesh_reg("delaunay::test_delaunay_mesh", test_delaunay_mesh);
+extern CGV_API benchmark_registration benchmark_delaunay_mesh_reg("delaunay::benchmark_delaunay_mesh", benchmark_delaunay_mesh);
@@ -0,0 +1,245 @@
+#include <cgv/math/sparse_solver.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cmath>
+
+using namespace cgv::base;
+using namespace cgv::math;
+
+/// assemble 5-point Laplacian with Dirichlet boundary on an n x m grid, optionally storing only the lower triangle
+static void assemble_laplacian(csr_mat& A, unsigned n, unsigned m, bool lower_only = false, double shift = 0)
+{
+	std::vector<csr_mat::triplet> triplets;
+	for (unsigned y = 0; y < m; ++y)
+		for (unsigned x = 0; x < n; ++x) {
+			unsigned i = y*n + x;
+			triplets.push_back(csr_mat::triplet(i, i, 4 + shift));
+			if (x > 0)
+				triplets.push_back(csr_mat::triplet(i, i - 1, -1));
+			if (y > 0)
+				triplets.push_back(csr_mat::triplet(i, i - n, -1));
+			if (!lower_only && x + 1 < n)
+				triplets.push_back(csr_mat::triplet(i, i + 1, -1));
+			if (!lower_only && y + 1 < m)
+				triplets.push_back(csr_mat::triplet(i, i + n, -1));
+		}
+	A.assemble(n*m, n*m, triplets);
+}
+
+/// return maximum absolute difference
+static double max_difference(const std::vector<double>& a, const std::vector<double>& b)
+{
+	double d = 0;
+	for (size_t i = 0; i < a.size(); ++i)
+		d = std::max(d, std::abs(a[i] - b[i]));
+	return d;
+}
+
+static bool test_csr_mat()
+{
+	std::vector<csr_mat::triplet> triplets;
+	triplets.push_back(csr_mat::triplet(1, 2, 1.0));
+	triplets.push_back(csr_mat::triplet(0, 0, 2.0));
+	triplets.push_back(csr_mat::triplet(1, 2, 3.0));
+	triplets.push_back(csr_mat::triplet(1, 0, -1.0));
+	csr_mat A;
+	A.assemble(2, 3, triplets);
+	if (A.get_nr_non_zeros() != 3 || A(1, 2) != 4.0 || A(1, 0) != -1.0 || A(0, 1) != 0.0) {
+		std::cerr << "csr_mat: summing assembly failed" << std::endl;
+		return false;
+	}
+	A.assemble(2, 3, triplets, false);
+	if (A(1, 2) != 3.0) {
+		std::cerr << "csr_mat: overwriting assembly failed" << std::endl;
+		return false;
+	}
+	std::vector<double> x(3, 1.0), y;
+	A.multiply(x, y);
+	if (y[0] != 2.0 || y[1] != 2.0) {
+		std::cerr << "csr_mat: wrong matrix vector product" << std::endl;
+		return false;
+	}
+	// parallel product on a matrix large enough to be split into chunks
+	csr_mat L;
+	assemble_laplacian(L, 300, 300);
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<double> d(-1, 1);
+	x.resize(L.get_nr_cols());
+	for (auto& v : x)
+		v = d(rng);
+	std::vector<double> y1, y4;
+	L.multiply(x, y1, 1);
+	L.multiply(x, y4, 4);
+	if (y1 != y4) {
+		std::cerr << "csr_mat: parallel matrix vector product differs" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool test_solvers()
+{
+	std::mt19937 rng(9);
+	std::uniform_real_distribution<double> d(-1, 1);
+	for (unsigned nr_threads : { 1u, 4u }) {
+		csr_mat A, A_lower;
+		assemble_laplacian(A, 120, 90);
+		assemble_laplacian(A_lower, 120, 90, true);
+		std::vector<double> x_ref(A.get_nr_rows()), b, x;
+		for (auto& v : x_ref)
+			v = d(rng);
+		A.multiply(x_ref, b);
+		sparse_cholesky C;
+		C.set_nr_threads(nr_threads);
+		if (!C.factorize(A)) {
+			std::cerr << "sparse_cholesky: factorization failed" << std::endl;
+			return false;
+		}
+		C.solve(b, x);
+		if (max_difference(x, x_ref) > 1e-9) {
+			std::cerr << "sparse_cholesky: solution differs by " << max_difference(x, x_ref) << std::endl;
+			return false;
+		}
+		// the same pattern reuses the analysis
+		std::vector<double>& values = A.ref_values();
+		for (size_t i = 0; i < values.size(); ++i)
+			values[i] *= 2;
+		if (!C.is_analyzed(A) || !C.factorize(A)) {
+			std::cerr << "sparse_cholesky: refactorization failed" << std::endl;
+			return false;
+		}
+		C.solve(b, x);
+		for (auto& v : x)
+			v *= 2;
+		if (max_difference(x, x_ref) > 1e-9) {
+			std::cerr << "sparse_cholesky: solution of refactorization differs by " << max_difference(x, x_ref) << std::endl;
+			return false;
+		}
+		// only the lower triangle is stored
+		sparse_cholesky C_lower;
+		C_lower.set_nr_threads(nr_threads);
+		if (!C_lower.factorize(A_lower)) {
+			std::cerr << "sparse_cholesky: factorization of lower triangle failed" << std::endl;
+			return false;
+		}
+		C_lower.solve(b, x);
+		if (max_difference(x, x_ref) > 1e-9 || C_lower.get_nr_factor_entries() != C.get_nr_factor_entries()) {
+			std::cerr << "sparse_cholesky: solution from lower triangle differs by " << max_difference(x, x_ref) << std::endl;
+			return false;
+		}
+		// conjugate gradients on the unscaled matrix
+		assemble_laplacian(A, 120, 90);
+		conjugate_gradient_solver cg;
+		cg.set_nr_threads(nr_threads);
+		cg.set_tolerance(1e-12);
+		x.clear();
+		if (!cg.solve(A, b, x) || max_difference(x, x_ref) > 1e-8) {
+			std::cerr << "conjugate_gradient_solver: not converged after " << cg.get_nr_iterations() << " iterations with residual " << cg.get_residual() << std::endl;
+			return false;
+		}
+	}
+	// indefinite matrices are detected
+	csr_mat A;
+	assemble_laplacian(A, 20, 20, false, -8);
+	sparse_cholesky C;
+	std::cerr << "expect error message on indefinite matrix: ";
+	if (C.factorize(A)) {
+		std::cerr << "sparse_cholesky: indefinite matrix factorized" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool test_sparse_les()
+{
+	for (const char* solver_name : { "csr_cholesky", "csr_cg" }) {
+		unsigned n = 50;
+		sparse_les_ptr les = sparse_les::create_by_name(solver_name, n*n, 2);
+		if (les.empty()) {
+			std::cerr << "sparse_les: solver " << solver_name << " not registered" << std::endl;
+			return false;
+		}
+		// Laplacian with a wrong diagonal that is overwritten
+		for (unsigned i = 0; i < n*n; ++i) {
+			les->set_mat_entry(i, i, 1.0);
+			les->set_mat_entry(i, i, 4.0);
+			if (i % n > 0) {
+				les->set_mat_entry(i, i - 1, -1.0);
+				les->set_mat_entry(i - 1, i, -1.0);
+			}
+			if (i >= n) {
+				les->set_mat_entry(i, i - n, -1.0);
+				les->set_mat_entry(i - n, i, -1.0);
+			}
+			les->set_b_entry(i, 0, 1.0);
+			les->set_b_entry(i, 1, double(i % 7));
+		}
+		if (!les->solve()) {
+			std::cerr << "sparse_les: " << solver_name << " failed" << std::endl;
+			return false;
+		}
+		// check residual of both right hand sides
+		for (int j = 0; j < 2; ++j)
+			for (unsigned i = 0; i < n*n; ++i) {
+				double r = 4 * les->get_x_entry(i, j);
+				if (i % n > 0)
+					r -= les->get_x_entry(i - 1, j);
+				if (i % n + 1 < n)
+					r -= les->get_x_entry(i + 1, j);
+				if (i >= n)
+					r -= les->get_x_entry(i - n, j);
+				if (i + n < n*n)
+					r -= les->get_x_entry(i + n, j);
+				if (std::abs(r - (j == 0 ? 1.0 : double(i % 7))) > 1e-7) {
+					std::cerr << "sparse_les: " << solver_name << " has residual " << r << " in row " << i << std::endl;
+					return false;
+				}
+			}
+	}
+	return true;
+}
+
+bool test_sparse_solver()
+{
+	bool result = test_csr_mat();
+	if (!test_solvers())
+		result = false;
+	if (!test_sparse_les())
+		result = false;
+	return result;
+}
+
+bool benchmark_sparse_solver()
+{
+	csr_mat A;
+	assemble_laplacian(A, 1000, 1000);
+	std::vector<double> b(A.get_nr_rows(), 1.0), x, x_cg;
+	auto seconds = [](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) { return std::chrono::duration<double>(b - a).count(); };
+	auto t0 = std::chrono::steady_clock::now();
+	sparse_cholesky C;
+	if (!C.analyze(A))
+		return false;
+	auto t1 = std::chrono::steady_clock::now();
+	if (!C.factorize(A))
+		return false;
+	auto t2 = std::chrono::steady_clock::now();
+	C.solve(b, x);
+	auto t3 = std::chrono::steady_clock::now();
+	std::cout << A.get_nr_rows() << " unknowns: cholesky with " << C.get_nr_factor_entries() << " factor entries in "
+		<< C.get_nr_supernodes() << " supernodes, analyze " << seconds(t0, t1) << " s, factorize " << seconds(t1, t2)
+		<< " s, solve " << seconds(t2, t3) << " s" << std::endl;
+	conjugate_gradient_solver cg;
+	cg.set_tolerance(1e-8);
+	bool result = cg.solve(A, b, x_cg);
+	auto t4 = std::chrono::steady_clock::now();
+	std::cout << "conjugate gradients: " << cg.get_nr_iterations() << " iterations in " << seconds(t3, t4)
+		<< " s, max difference to cholesky " << max_difference(x, x_cg) << std::endl;
+	return result;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_sparse_solver_reg("cgv::math::sparse_solver", test_sparse_solver);
+extern CGV_API benchmark_registration benchmark_sparse_solver_reg("cgv::math::benchmark_sparse_solver", benchmark_sparse_solver);
@@ -0,0 +1,146 @@
+#include <cgv/media/mesh/simple_mesh.h>
+#include <cgv/base/register.h>
+#include "test_helpers.h"
+#include <iostream>
+#include <chrono>
+#include <map>
+#include <cmath>
+
+using namespace cgv::base;
+using namespace cgv::media::mesh;
+
+typedef simple_mesh_base::idx_type idx_type;
+
+/// reference implementation of inv computation with a map from edges to corners
+static void compute_inv_reference(const simple_mesh_base& M, std::vector<uint32_t>& inv)
+{
+	inv.assign(M.get_nr_corners(), uint32_t(-1));
+	std::map<std::pair<uint32_t, uint32_t>, uint32_t> pipj2ci;
+	for (uint32_t fi = 0; fi < M.get_nr_faces(); ++fi) {
+		for (uint32_t ci = M.begin_corner(fi); ci < M.end_corner(fi); ++ci) {
+			uint32_t next_ci = ci + 1 == M.end_corner(fi) ? M.begin_corner(fi) : ci + 1;
+			uint32_t pi = M.c2p(ci), pj = M.c2p(next_ci);
+			std::pair<uint32_t, uint32_t> pipj(std::min(pi, pj), std::max(pi, pj));
+			auto iter = pipj2ci.find(pipj);
+			if (iter == pipj2ci.end())
+				pipj2ci[pipj] = ci;
+			else {
+				inv[ci] = iter->second;
+				inv[iter->second] = ci;
+				pipj2ci.erase(iter);
+			}
+		}
+	}
+}
+
+/// check topology of the given mesh against reference implementation, if reference is false only consistency is checked
+static bool check_topology(const simple_mesh<float>& M, bool reference, double* time_ptr = 0, double* ref_time_ptr = 0)
+{
+	std::vector<uint32_t> inv, p2c, next, prev, c2e, e2c, c2f;
+	auto t0 = std::chrono::steady_clock::now();
+	M.compute_inv(inv, &p2c, &next, &prev);
+	uint32_t nr_edges = M.compute_c2e(inv, c2e, &e2c);
+	M.compute_c2f(c2f);
+	if (time_ptr)
+		*time_ptr = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	if (nr_edges != M.get_nr_corners() / 2) {
+		std::cerr << "expected " << M.get_nr_corners() / 2 << " edges but found " << nr_edges << std::endl;
+		return false;
+	}
+	for (uint32_t ci = 0; ci < M.get_nr_corners(); ++ci) {
+		if (inv[ci] == uint32_t(-1) || inv[inv[ci]] != ci || M.c2p(inv[ci]) != M.c2p(next[ci]) || next[prev[ci]] != ci ||
+			c2e[ci] != c2e[inv[ci]] || e2c[c2e[ci]] != std::min(ci, inv[ci]) || ci < M.begin_corner(c2f[ci]) || ci >= M.end_corner(c2f[ci])) {
+			std::cerr << "inconsistent topology at corner " << ci << std::endl;
+			return false;
+		}
+	}
+	for (uint32_t pi = 0; pi < M.get_nr_positions(); ++pi)
+		if (M.c2p(p2c[pi]) != pi)
+			return false;
+	if (reference) {
+		std::vector<uint32_t> inv_ref;
+		t0 = std::chrono::steady_clock::now();
+		compute_inv_reference(M, inv_ref);
+		if (ref_time_ptr)
+			*ref_time_ptr = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (inv != inv_ref) {
+			std::cerr << "inv differs from map based reference" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+/// check merge_indices against map based reference
+static bool check_merge_indices(const simple_mesh<float>& M)
+{
+	std::vector<idx_type> indices;
+	std::vector<simple_mesh_base::vec4i> unique_quadruples;
+	bool include_normals = true;
+	M.merge_indices(indices, unique_quadruples, 0, &include_normals);
+	std::map<std::pair<idx_type, idx_type>, idx_type> corner_to_index;
+	for (idx_type ci = 0; ci < M.get_nr_corners(); ++ci) {
+		auto iter = corner_to_index.insert(std::make_pair(std::make_pair(M.c2p(ci), M.c2n(ci)), idx_type(corner_to_index.size()))).first;
+		if (indices[ci] != iter->second)
+			return false;
+		const simple_mesh_base::vec4i& q = unique_quadruples[indices[ci]];
+		if (q[0] != M.c2p(ci) || q[2] != M.c2n(ci))
+			return false;
+	}
+	return unique_quadruples.size() == corner_to_index.size();
+}
+
+bool test_simple_mesh_topology()
+{
+	simple_mesh<float> M;
+	generate_torus(M, 37, 23, TN_ALTERNATING);
+	TEST_ASSERT(check_topology(M, true));
+	TEST_ASSERT(check_merge_indices(M));
+	// mesh with non manifold edges, which are paired in corner order
+	generate_torus(M, 3, 3, TN_ALTERNATING);
+	M.start_face();
+	M.new_corner(0);
+	M.new_corner(3);
+	M.new_corner(5);
+	M.start_face();
+	M.new_corner(3);
+	M.new_corner(0);
+	M.new_corner(6);
+	std::vector<uint32_t> inv, inv_ref;
+	M.compute_inv(inv);
+	compute_inv_reference(M, inv_ref);
+	TEST_ASSERT(inv == inv_ref);
+	return true;
+}
+
+/// measure topology construction and merging of indices on tori with the given number of triangles
+static bool benchmark_topology(idx_type nr_triangles, bool measure_reference)
+{
+	idx_type n = idx_type(std::sqrt(nr_triangles / 2.0));
+	simple_mesh<float> M;
+	generate_torus(M, n, nr_triangles / 2 / n, TN_ALTERNATING);
+	double t, t_ref = 0;
+	if (!check_topology(M, measure_reference, &t, &t_ref))
+		return false;
+	auto t0 = std::chrono::steady_clock::now();
+	std::vector<idx_type> indices;
+	std::vector<simple_mesh_base::vec4i> unique_quadruples;
+	bool include_normals = true;
+	M.merge_indices(indices, unique_quadruples, 0, &include_normals);
+	double t_merge = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	std::cout << M.get_nr_faces() << " triangles: inv, c2e and c2f " << t << " s, merge_indices " << t_merge << " s";
+	if (measure_reference)
+		std::cout << ", map based inv " << t_ref << " s, speedup " << t_ref / t;
+	std::cout << std::endl;
+	return true;
+}
+
+bool benchmark_simple_mesh_topology()
+{
+	return benchmark_topology(1000000, true) && benchmark_topology(20000000, false);
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_simple_mesh_topology_reg("cgv::media::mesh::test_simple_mesh_topology", test_simple_mesh_topology);
+extern CGV_API benchmark_registration benchmark_simple_mesh_topology_reg("cgv::media::mesh::benchmark_simple_mesh_topology", benchmark_simple_mesh_topology);
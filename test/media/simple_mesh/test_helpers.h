@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cgv/media/mesh/simple_mesh.h>
+#include <cmath>
+#include <fstream>
+#include <string>
+
+/// normals generated by generate_torus
+enum torus_normals
+{
+	TN_NONE,         // corners do not reference normals
+	TN_PER_POSITION, // one normal per position with the same index
+	TN_ALTERNATING   // two normals referenced alternately by the corners, such that merge_indices has to split positions
+};
+
+//! construct closed torus with radii 1 and 0.3 and n*m positions
+/*! Each quad of the parameter grid is split into two triangles. If quads is true, every other quad is kept. */
+inline void generate_torus(cgv::media::mesh::simple_mesh<float>& M, cgv::media::mesh::simple_mesh_base::idx_type n,
+	cgv::media::mesh::simple_mesh_base::idx_type m, torus_normals normals, bool quads = false)
+{
+	typedef cgv::media::mesh::simple_mesh_base::idx_type idx_type;
+	typedef cgv::media::mesh::simple_mesh<float>::vec3 vec3;
+	M.clear();
+	for (idx_type i = 0; i < n; ++i) {
+		float u = 2 * 3.14159265f * i / n;
+		for (idx_type j = 0; j < m; ++j) {
+			float v = 2 * 3.14159265f * j / m;
+			M.new_position(vec3((1 + 0.3f*std::cos(v))*std::cos(u), (1 + 0.3f*std::cos(v))*std::sin(u), 0.3f*std::sin(v)));
+			if (normals == TN_PER_POSITION)
+				M.new_normal(vec3(std::cos(v)*std::cos(u), std::cos(v)*std::sin(u), std::sin(v)));
+		}
+	}
+	if (normals == TN_ALTERNATING) {
+		M.new_normal(vec3(0, 0, 1));
+		M.new_normal(vec3(0, 1, 0));
+	}
+	// return normal index of a position given the normal index used in the alternating case
+	auto nml = [normals](idx_type pi, idx_type alternating_ni) -> idx_type {
+		return normals == TN_NONE ? idx_type(-1) : (normals == TN_PER_POSITION ? pi : alternating_ni);
+	};
+	for (idx_type i = 0; i < n; ++i)
+		for (idx_type j = 0; j < m; ++j) {
+			idx_type p00 = i*m + j, p10 = ((i + 1) % n)*m + j, p01 = i*m + (j + 1) % m, p11 = ((i + 1) % n)*m + (j + 1) % m;
+			if (quads && (i + j) % 2 == 0) {
+				M.start_face();
+				M.new_corner(p00, nml(p00, (i + j) % 2));
+				M.new_corner(p10, nml(p10, 0));
+				M.new_corner(p11, nml(p11, 1));
+				M.new_corner(p01, nml(p01, 1));
+			}
+			else {
+				M.start_face();
+				M.new_corner(p00, nml(p00, (i + j) % 2));
+				M.new_corner(p10, nml(p10, 0));
+				M.new_corner(p11, nml(p11, 1));
+				M.start_face();
+				M.new_corner(p00, nml(p00, 0));
+				M.new_corner(p11, nml(p11, (i*j) % 2));
+				M.new_corner(p01, nml(p01, 1));
+			}
+		}
+}
+
+/// write content to a file in binary mode, such that line endings are preserved
+inline bool write_text_file(const std::string& file_name, const std::string& content)
+{
+	std::ofstream os(file_name, std::ios::binary);
+	os << content;
+	return !os.fail();
+}
@@ -0,0 +1,81 @@
+#include <cgv/media/mesh/marching_cubes.h>
+#include <cgv/math/mfunc.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <sstream>
+#include <cmath>
+
+using namespace cgv::base;
+using namespace cgv::media::mesh;
+
+typedef cgv::math::fvec<float, 3> pnt_type;
+typedef cgv::media::axis_aligned_box<float, 3> box_type;
+
+/// torus with a wavy surface, such that slabs contain differently many vertices
+struct wavy_torus : public cgv::math::v3_func<float, float>
+{
+	float evaluate(const pnt_type& p) const
+	{
+		float r = std::sqrt(p(0)*p(0) + p(1)*p(1)) - 0.6f;
+		return r*r + p(2)*p(2) - 0.09f + 0.02f*std::sin(13 * p(0))*std::cos(11 * p(2));
+	}
+};
+
+/// record all callbacks of a streaming mesh including vertex locations in a string
+struct mesh_recorder : public streaming_mesh_callback_handler
+{
+	std::ostringstream os;
+	streaming_mesh<float>* sm = 0;
+	void new_vertex(unsigned int vi)
+	{
+		const pnt_type& p = sm->vertex_location(vi);
+		os << "v " << vi << " " << p(0) << " " << p(1) << " " << p(2) << "\n";
+	}
+	void new_polygon(const std::vector<unsigned int>& vertex_indices)
+	{
+		os << "f";
+		for (unsigned int vi : vertex_indices)
+			os << " " << vi;
+		os << "\n";
+	}
+	void before_drop_vertex(unsigned int vi) { os << "d " << vi << "\n"; }
+};
+
+/// extract with the given number of threads and return the recorded callbacks
+static std::string extract_recorded(const wavy_torus& func, float iso_value, unsigned int res, unsigned int nr_threads, unsigned int& nr_faces)
+{
+	mesh_recorder recorder;
+	marching_cubes<float, float> mc(func, &recorder, 0.1f);
+	recorder.sm = &mc;
+	mc.set_nr_threads(nr_threads);
+	mc.extract(iso_value, box_type(pnt_type(-1, -1, -0.5f), pnt_type(1, 1, 0.5f)), res, res + 2, res + 3);
+	nr_faces = mc.get_nr_faces();
+	return recorder.os.str();
+}
+
+bool test_marching_cubes()
+{
+	wavy_torus func;
+	// parallel extraction yields the same vertices, faces and vertex drops in the same order as the sequential one
+	for (unsigned int res : { 5u, 40u, 97u }) {
+		for (float iso_value : { 0.0f, 0.05f }) {
+			unsigned int nr_faces = 0;
+			std::string reference = extract_recorded(func, iso_value, res, 1, nr_faces);
+			TEST_ASSERT(nr_faces > 0);
+			for (unsigned int nr_threads : { 2u, 3u, 7u }) {
+				unsigned int nr_parallel_faces = 0;
+				TEST_ASSERT(extract_recorded(func, iso_value, res, nr_threads, nr_parallel_faces) == reference);
+				TEST_ASSERT_EQ(nr_parallel_faces, nr_faces);
+			}
+		}
+	}
+	// iso value outside of the range of the function yields an empty mesh
+	unsigned int nr_faces = 1;
+	TEST_ASSERT(extract_recorded(func, 10.0f, 40, 3, nr_faces).empty());
+	TEST_ASSERT_EQ(nr_faces, 0u);
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_marching_cubes_reg("cgv::media::mesh::test_marching_cubes", test_marching_cubes);
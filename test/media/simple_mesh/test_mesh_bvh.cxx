@@ -0,0 +1,232 @@
+#include <cgv/media/mesh/mesh_bvh.h>
+#include <cgv/base/register.h>
+#include "test_helpers.h"
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cmath>
+
+using namespace cgv::base;
+using namespace cgv::media::mesh;
+
+typedef simple_mesh<float> mesh_type;
+typedef simple_mesh_base::idx_type idx_type;
+typedef mesh_type::vec3 vec3;
+typedef mesh_bvh<float> bvh_type;
+
+/// generate rays from random points around the torus towards random points near the torus
+static void generate_rays(std::vector<bvh_type::ray_type>& rays, size_t n, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> d(-1.5f, 1.5f);
+	rays.resize(n);
+	for (auto& r : rays) {
+		vec3 o(2 * d(rng), 2 * d(rng), 2 * d(rng)), t(d(rng), d(rng), 0.3f*d(rng));
+		r = bvh_type::ray_type(o, normalize(t - o));
+	}
+}
+
+/// intersect ray with all triangles of the fan triangulation of the mesh
+static float intersect_brute_force(const mesh_type& M, const bvh_type::ray_type& r)
+{
+	float t_min = std::numeric_limits<float>::infinity();
+	for (idx_type fi = 0; fi < M.get_nr_faces(); ++fi) {
+		idx_type c0 = M.begin_corner(fi);
+		for (idx_type ci = c0 + 1; ci + 1 < M.end_corner(fi); ++ci) {
+			vec3 p0 = M.position(M.c2p(c0)), e1 = M.position(M.c2p(ci)) - p0, e2 = M.position(M.c2p(ci + 1)) - p0;
+			vec3 p = cross(r.direction, e2);
+			float det = dot(e1, p);
+			if (det == 0)
+				continue;
+			vec3 s = r.origin - p0, q = cross(s, e1);
+			float u = dot(s, p) / det, v = dot(r.direction, q) / det, t = dot(e2, q) / det;
+			if (u >= 0 && v >= 0 && u + v <= 1 && t >= 0)
+				t_min = std::min(t_min, t);
+		}
+	}
+	return t_min;
+}
+
+/// compare ray and closest point queries with brute force results
+static bool check_queries(const mesh_type& M, const bvh_type& B, std::mt19937& rng, const char* name)
+{
+	std::vector<bvh_type::ray_type> rays;
+	generate_rays(rays, 300, rng);
+	std::vector<bvh_type::ray_hit> hits;
+	B.intersect(rays, hits);
+	for (size_t i = 0; i < rays.size(); ++i) {
+		float t = intersect_brute_force(M, rays[i]);
+		bvh_type::ray_hit hit;
+		B.intersect(rays[i], hit);
+		if (hit.is_hit() != (t != std::numeric_limits<float>::infinity()) || (hit.is_hit() && std::abs(hit.t - t) > 1e-5f) ||
+			hits[i].t != hit.t || hits[i].face_index != hit.face_index) {
+			std::cerr << name << ": ray " << i << " hits at " << hit.t << " (packet " << hits[i].t << ") instead of " << t << std::endl;
+			return false;
+		}
+		if (hit.is_hit()) {
+			// hit point from barycentric coordinates
+			idx_type c0 = M.begin_corner(hit.face_index), ci = hit.corner_index;
+			vec3 p = (1 - hit.u - hit.v)*M.position(M.c2p(c0)) + hit.u*M.position(M.c2p(ci)) + hit.v*M.position(M.c2p(ci + 1));
+			if ((p - (rays[i].origin + hit.t*rays[i].direction)).length() > 1e-4f) {
+				std::cerr << name << ": barycentric coordinates of ray " << i << " do not match hit point" << std::endl;
+				return false;
+			}
+		}
+	}
+	std::uniform_real_distribution<float> d(-2, 2);
+	std::vector<vec3> points(200);
+	for (auto& p : points)
+		p = vec3(d(rng), d(rng), 0.5f*d(rng));
+	std::vector<bvh_type::closest_point_result> results;
+	B.find_closest_points(points, results);
+	for (size_t i = 0; i < points.size(); ++i) {
+		// brute force closest distance over the vertices is an upper bound and the bvh result needs to lie on the face
+		float d2_vertices = std::numeric_limits<float>::max();
+		for (const auto& p : M.get_positions())
+			d2_vertices = std::min(d2_vertices, (p - points[i]).sqr_length());
+		if (results[i].face_index == idx_type(-1) || results[i].sqr_distance > d2_vertices ||
+			std::abs((results[i].point - points[i]).sqr_length() - results[i].sqr_distance) > 1e-5f) {
+			std::cerr << name << ": closest point of " << points[i] << " not found" << std::endl;
+			return false;
+		}
+		// the closest point minimizes the distance among the sampled surface points
+		for (idx_type fi = 0; fi < M.get_nr_faces(); fi += 7)
+			for (idx_type ci = M.begin_corner(fi); ci < M.end_corner(fi); ++ci) {
+				vec3 q = 0.5f*(M.position(M.c2p(ci)) + M.position(M.c2p(ci + 1 == M.end_corner(fi) ? M.begin_corner(fi) : ci + 1)));
+				if ((q - points[i]).sqr_length() < results[i].sqr_distance - 1e-6f) {
+					std::cerr << name << ": edge midpoint of face " << fi << " is closer to " << points[i] << std::endl;
+					return false;
+				}
+			}
+	}
+	return true;
+}
+
+static bool test_mesh_queries()
+{
+	bool result = true;
+	std::mt19937 rng(7);
+	mesh_type M;
+	generate_torus(M, 60, 30, TN_NONE, true);
+	for (unsigned nr_threads : { 1u, 4u }) {
+		bvh_type B;
+		B.set_nr_threads(nr_threads);
+		B.set_parallel_threshold(500);
+		if (!B.build(M) || B.get_nr_triangles() != 3600 || B.compute_depth() > 30) {
+			std::cerr << "mesh_bvh: build failed with " << B.get_nr_triangles() << " triangles and depth " << B.compute_depth() << std::endl;
+			return false;
+		}
+		if (!check_queries(M, B, rng, nr_threads == 1 ? "mesh_bvh" : "parallel mesh_bvh"))
+			result = false;
+		// deform and refit
+		for (idx_type pi = 0; pi < M.get_nr_positions(); ++pi) {
+			vec3& p = M.position(pi);
+			p = vec3(p[0] * 1.2f, p[1] + 0.2f*p[0] * p[0], p[2] * 0.8f);
+		}
+		B.refit(M);
+		if (!check_queries(M, B, rng, "refitted mesh_bvh"))
+			result = false;
+		generate_torus(M, 60, 30, TN_NONE, true);
+	}
+	return result;
+}
+
+static bool test_point_queries()
+{
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> d(0, 1);
+	std::vector<vec3> points(5000), query_points(500);
+	for (auto& p : points)
+		p = vec3(d(rng), d(rng), d(rng)*d(rng));
+	// add duplicate points
+	for (size_t i = 0; i < 100; ++i)
+		points[4900 + i] = points[i];
+	for (auto& p : query_points)
+		p = vec3(d(rng), d(rng), d(rng));
+	point_bvh<float> B;
+	B.set_parallel_threshold(1000);
+	B.build(points);
+	std::vector<int> indices;
+	B.find_closest_points(query_points, indices);
+	for (size_t i = 0; i < query_points.size(); ++i) {
+		float best = std::numeric_limits<float>::max();
+		for (const auto& p : points)
+			best = std::min(best, (p - query_points[i]).sqr_length());
+		if (indices[i] < 0 || (points[indices[i]] - query_points[i]).sqr_length() != best) {
+			std::cerr << "point_bvh: wrong closest point for query " << i << std::endl;
+			return false;
+		}
+	}
+	if (B.find_closest_point(vec3(5, 5, 5), 1.0f) != -1) {
+		std::cerr << "point_bvh: found point beyond maximum distance" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool test_mesh_bvh()
+{
+	bool result = test_mesh_queries();
+	if (!test_point_queries())
+		result = false;
+	return result;
+}
+
+bool benchmark_mesh_bvh()
+{
+	mesh_type M;
+	generate_torus(M, 4000, 1000, TN_NONE, true);
+	// coherent picking rays through the pixels of a 1000 x 1000 view
+	std::vector<bvh_type::ray_type> rays;
+	vec3 eye(0, -4, 2);
+	for (unsigned y = 0; y < 1000; ++y)
+		for (unsigned x = 0; x < 1000; ++x) {
+			vec3 target(1.6f*(x / 500.0f - 1), 0, 1.6f*(y / 500.0f - 1));
+			rays.push_back(bvh_type::ray_type(eye, normalize(target - eye)));
+		}
+	// query points close to the surface
+	std::mt19937 rng(3);
+	std::uniform_int_distribution<idx_type> pd(0, M.get_nr_positions() - 1);
+	std::uniform_real_distribution<float> d(-0.05f, 0.05f);
+	std::vector<vec3> points(1000000);
+	for (auto& p : points)
+		p = M.position(pd(rng)) + vec3(d(rng), d(rng), d(rng));
+	bool result = true;
+	for (unsigned nr_threads : { 1u, 0u }) {
+		bvh_type B;
+		B.set_nr_threads(nr_threads);
+		auto t0 = std::chrono::steady_clock::now();
+		result = B.build(M) && result;
+		auto t1 = std::chrono::steady_clock::now();
+		bvh_type::ray_hit hit;
+		size_t nr_hits = 0;
+		for (const auto& r : rays)
+			if (B.intersect(r, hit))
+				++nr_hits;
+		auto t2 = std::chrono::steady_clock::now();
+		std::vector<bvh_type::ray_hit> hits;
+		B.intersect(rays, hits);
+		auto t3 = std::chrono::steady_clock::now();
+		std::vector<bvh_type::closest_point_result> closest_points;
+		B.find_closest_points(points, closest_points);
+		auto t4 = std::chrono::steady_clock::now();
+		B.refit(M);
+		auto t5 = std::chrono::steady_clock::now();
+		size_t nr_packet_hits = 0;
+		for (const auto& h : hits)
+			if (h.is_hit())
+				++nr_packet_hits;
+		if (nr_packet_hits != nr_hits)
+			result = false;
+		auto seconds = [](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) { return std::chrono::duration<double>(b - a).count(); };
+		std::cout << B.get_nr_triangles() << " triangles with " << (nr_threads == 1 ? "1 thread" : "all threads") << ": build "
+			<< seconds(t0, t1) << " s, " << rays.size() / seconds(t1, t2) * 1e-6 << " Mrays/s single, "
+			<< rays.size() / seconds(t2, t3) * 1e-6 << " Mrays/s packets, " << points.size() / seconds(t3, t4) * 1e-6
+			<< " M closest points/s, refit " << seconds(t4, t5) << " s" << std::endl;
+	}
+	return result;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_mesh_bvh_reg("cgv::media::mesh::test_mesh_bvh", test_mesh_bvh);
+extern CGV_API benchmark_registration benchmark_mesh_bvh_reg("cgv::media::mesh::benchmark_mesh_bvh", benchmark_mesh_bvh);
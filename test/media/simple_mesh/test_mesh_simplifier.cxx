@@ -0,0 +1,170 @@
+#include <cgv/media/mesh/mesh_simplifier.h>
+#include <cgv/base/register.h>
+#include "test_helpers.h"
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <map>
+
+using namespace cgv::base;
+using namespace cgv::media::mesh;
+
+typedef simple_mesh<float> mesh_type;
+typedef simple_mesh_base::idx_type idx_type;
+
+/// construct triangulated n x n grid in the unit square of the xy-plane
+static void generate_plane(mesh_type& M, idx_type n)
+{
+	M.clear();
+	for (idx_type j = 0; j <= n; ++j)
+		for (idx_type i = 0; i <= n; ++i)
+			M.new_position(mesh_type::vec3(float(i) / n, float(j) / n, 0));
+	for (idx_type j = 0; j < n; ++j)
+		for (idx_type i = 0; i < n; ++i) {
+			idx_type p00 = j*(n + 1) + i, p10 = p00 + 1, p01 = p00 + n + 1, p11 = p01 + 1;
+			M.start_face();
+			M.new_corner(p00);
+			M.new_corner(p10);
+			M.new_corner(p11);
+			M.start_face();
+			M.new_corner(p00);
+			M.new_corner(p11);
+			M.new_corner(p01);
+		}
+}
+
+/// check that each undirected edge is used once in each direction
+static bool check_closed_manifold(const mesh_type& M)
+{
+	std::map<std::pair<idx_type, idx_type>, int> edges;
+	for (idx_type fi = 0; fi < M.get_nr_faces(); ++fi)
+		for (idx_type ci = M.begin_corner(fi); ci < M.end_corner(fi); ++ci) {
+			idx_type cj = ci + 1 == M.end_corner(fi) ? M.begin_corner(fi) : ci + 1;
+			if (++edges[std::make_pair(M.c2p(ci), M.c2p(cj))] > 1) {
+				std::cerr << "mesh_simplifier: edge used twice in the same direction" << std::endl;
+				return false;
+			}
+		}
+	for (const auto& e : edges)
+		if (edges.find(std::make_pair(e.first.second, e.first.first)) == edges.end()) {
+			std::cerr << "mesh_simplifier: boundary edge in closed mesh" << std::endl;
+			return false;
+		}
+	return true;
+}
+
+/// check distance of positions to the torus surface
+static bool check_torus_distance(const mesh_type& M, float max_distance)
+{
+	for (const auto& p : M.get_positions()) {
+		float r = std::sqrt(p[0] * p[0] + p[1] * p[1]) - 1;
+		float d = std::abs(std::sqrt(r*r + p[2] * p[2]) - 0.3f);
+		if (d > max_distance) {
+			std::cerr << "mesh_simplifier: position " << p << " has distance " << d << " to torus" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool test_torus(unsigned nr_threads)
+{
+	mesh_type M, R;
+	generate_torus(M, 100, 50, TN_PER_POSITION);
+	mesh_simplifier<float> simplifier;
+	simplifier.set_nr_threads(nr_threads);
+	simplifier.set_parallel_threshold(1000);
+	if (!simplifier.init(M) || simplifier.get_nr_triangles() != 10000)
+		return false;
+	size_t nr_triangles = simplifier.simplify(2000);
+	simplifier.extract(R);
+	if (nr_triangles > 2000 || nr_triangles < 1990 || R.get_nr_faces() != nr_triangles) {
+		std::cerr << "mesh_simplifier: torus simplified to " << nr_triangles << " triangles" << std::endl;
+		return false;
+	}
+	if (!R.has_normal_indices() || R.get_nr_normals() != R.get_nr_positions()) {
+		std::cerr << "mesh_simplifier: normals not preserved" << std::endl;
+		return false;
+	}
+	return check_closed_manifold(R) && check_torus_distance(R, 0.02f) && simplifier.get_error() < 0.01;
+}
+
+static bool test_plane()
+{
+	mesh_type M, R;
+	generate_plane(M, 40);
+	mesh_simplifier<float> simplifier;
+	simplifier.set_nr_threads(1);
+	// flat regions collapse without error until only few triangles remain
+	simplifier.set_max_error(1e-5);
+	simplifier.init(M);
+	simplifier.simplify(0);
+	simplifier.extract(R);
+	if (R.get_nr_faces() > 50) {
+		std::cerr << "mesh_simplifier: plane simplified only to " << R.get_nr_faces() << " triangles" << std::endl;
+		return false;
+	}
+	mesh_type::box_type box = R.compute_box();
+	if ((box.get_min_pnt() - mesh_type::vec3(0, 0, 0)).length() > 1e-4f || (box.get_max_pnt() - mesh_type::vec3(1, 1, 0)).length() > 1e-4f) {
+		std::cerr << "mesh_simplifier: plane boundary not preserved" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool test_lods()
+{
+	mesh_type M;
+	generate_torus(M, 60, 30, TN_PER_POSITION);
+	mesh_simplifier<float> simplifier;
+	std::vector<size_t> counts = { 2000, 500, 100 };
+	std::vector<mesh_type> lods;
+	if (!simplifier.generate_lods(M, counts, lods) || lods.size() != 3)
+		return false;
+	for (size_t i = 0; i < lods.size(); ++i)
+		if (lods[i].get_nr_faces() > counts[i] || lods[i].get_nr_faces() + 10 < counts[i] || !check_closed_manifold(lods[i])) {
+			std::cerr << "mesh_simplifier: lod " << i << " has " << lods[i].get_nr_faces() << " triangles" << std::endl;
+			return false;
+		}
+	return true;
+}
+
+bool test_mesh_simplifier()
+{
+	bool result = true;
+	if (!test_torus(1) || !test_torus(4))
+		result = false;
+	if (!test_plane())
+		result = false;
+	if (!test_lods())
+		result = false;
+	return result;
+}
+
+bool benchmark_mesh_simplifier()
+{
+	mesh_type M, R;
+	generate_torus(M, 2000, 500, TN_PER_POSITION);
+	bool result = true;
+	for (unsigned nr_threads : { 1u, 4u }) {
+		mesh_simplifier<float> simplifier;
+		simplifier.set_nr_threads(nr_threads);
+		auto t0 = std::chrono::steady_clock::now();
+		simplifier.init(M);
+		auto t1 = std::chrono::steady_clock::now();
+		simplifier.simplify(M.get_nr_faces() / 20);
+		auto t2 = std::chrono::steady_clock::now();
+		simplifier.extract(R);
+		std::cout << M.get_nr_faces() << " -> " << R.get_nr_faces() << " triangles with " << (nr_threads == 1 ? "greedy" : "parallel")
+			<< " simplification: init " << std::chrono::duration<double>(t1 - t0).count() << " s, simplify "
+			<< std::chrono::duration<double>(t2 - t1).count() << " s, error " << simplifier.get_error() << std::endl;
+		if (!check_torus_distance(R, 0.01f))
+			result = false;
+	}
+	return result;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_mesh_simplifier_reg("cgv::media::mesh::test_mesh_simplifier", test_mesh_simplifier);
+extern CGV_API benchmark_registration benchmark_mesh_simplifier_reg("cgv::media::mesh::benchmark_mesh_simplifier", benchmark_mesh_simplifier);
@@ -0,0 +1,226 @@
+#include <cgv/media/mesh/obj_parallel_reader.h>
+#include <cgv/utils/file.h>
+#include <cgv/utils/dir.h>
+#include <cgv/base/register.h>
+#include "test_helpers.h"
+#include <iostream>
+#include <sstream>
+#include <chrono>
+
+using namespace cgv::base;
+using namespace cgv::media::mesh;
+
+/// sequential reader that collects the geometry through the callbacks of obj_reader_base like simple_mesh did before
+class reference_obj_reader : public obj_reader_generic<float>
+{
+	obj_geometry<float>& G;
+public:
+	reference_obj_reader(obj_geometry<float>& _G) : G(_G) {}
+	void process_vertex(const v3d_type& p) { G.positions.push_back(p); }
+	void process_texcoord(const v2d_type& t) { G.tex_coords.push_back(t); }
+	void process_color(const color_type& c) { G.colors.push_back(c); }
+	void process_normal(const v3d_type& n) { G.normals.push_back(n); }
+	void process_face(unsigned vcount, int* vertices, int* texcoords, int* normals)
+	{
+		convert_to_positive(vcount, vertices, texcoords, normals, unsigned(G.positions.size()), unsigned(G.normals.size()), unsigned(G.tex_coords.size()));
+		G.faces.push_back(uint32_t(G.position_indices.size()));
+		G.group_indices.push_back(get_current_group());
+		G.material_indices.push_back(get_current_material());
+		if (texcoords && G.tex_coord_indices.size() < G.position_indices.size())
+			G.tex_coord_indices.resize(G.position_indices.size(), 0);
+		if (normals && G.normal_indices.size() < G.position_indices.size())
+			G.normal_indices.resize(G.position_indices.size(), 0);
+		for (unsigned i = 0; i < vcount; ++i) {
+			G.position_indices.push_back(vertices[i]);
+			if (texcoords)
+				G.tex_coord_indices.push_back(texcoords[i]);
+			if (normals)
+				G.normal_indices.push_back(normals[i]);
+		}
+	}
+	void process_group(const std::string& name, const std::string&) { G.group_names.push_back(name); }
+	void process_material(const cgv::media::illum::obj_material& mtl, unsigned idx)
+	{
+		if (idx >= G.materials.size())
+			G.materials.resize(idx + 1);
+		G.materials[idx] = mtl;
+	}
+};
+
+/** generate obj file of a n x n grid of quads split into triangles. Faces start before the first group and material
+    selection, groups and materials change every few rows and the file ends with faces using relative indices. */
+static std::string generate_obj(unsigned n, const std::string& mtl_file_name)
+{
+	std::ostringstream os;
+	os << "# test grid\nmtllib " << mtl_file_name << "\n";
+	for (unsigned j = 0; j <= n; ++j)
+		for (unsigned i = 0; i <= n; ++i)
+			os << "v " << float(i) / n << " " << float(j) / n << " " << 0.25f*((i + j) % 4) << " 0.5 " << float(i % 2) << " 1\n";
+	for (unsigned j = 0; j <= n; ++j)
+		for (unsigned i = 0; i <= n; ++i)
+			os << "vt " << float(i) / n << " " << float(j) / n << "\n";
+	os << "vn 0 0 1\r\nvn 0 0 -1\n";
+	for (unsigned j = 0; j < n; ++j) {
+		if (j > 0 && j % 7 == 0)
+			os << "g row" << (j / 7) % 3 << " smooth\n";
+		if (j > 0 && j % 5 == 0)
+			os << "usemtl " << ((j / 5) % 2 == 0 ? "red" : "blue") << "\n";
+		for (unsigned i = 0; i < n; ++i) {
+			unsigned p00 = j*(n + 1) + i + 1, p10 = p00 + 1, p01 = p00 + n + 1, p11 = p01 + 1, ni = (i + j) % 2 + 1;
+			os << "f " << p00 << "/" << p00 << "/" << ni << " " << p10 << "/" << p10 << "/" << ni << " " << p11 << "/" << p11 << "/" << ni << "\n";
+			os << "f\t" << p00 << "/" << p00 << "/" << ni << "  " << p11 << "/" << p11 << "/" << ni << " " << p01 << "/" << p01 << "/" << ni << " \n";
+		}
+	}
+	os << "l 1 2\ng last\nv 0 0 1\nv 1 0 1\nv 0 1 1\nvt 0 0\nvt 1 0\nvt 0 1\nvn 0 1 0\nvn 1 0 0\nvn 0 0 1\n";
+	os << "f -3/-3/-3 -2/-2/-2 -1/-1/-1\nf -3 -2 -1\n";
+	return os.str();
+}
+
+template <typename X>
+static bool check_vector(const std::vector<X>& v, const std::vector<X>& r, const char* name)
+{
+	if (v.size() == r.size() && (v.empty() || std::equal(v.begin(), v.end(), r.begin())))
+		return true;
+	std::cerr << "obj_parallel_reader: " << name << " differ (" << v.size() << " instead of " << r.size() << ")" << std::endl;
+	return false;
+}
+
+static bool check_geometry(const obj_geometry<float>& G, const obj_geometry<float>& R)
+{
+	bool result =
+		check_vector(G.positions, R.positions, "positions") &&
+		check_vector(G.normals, R.normals, "normals") &&
+		check_vector(G.tex_coords, R.tex_coords, "tex_coords") &&
+		check_vector(G.faces, R.faces, "faces") &&
+		check_vector(G.position_indices, R.position_indices, "position_indices") &&
+		check_vector(G.normal_indices, R.normal_indices, "normal_indices") &&
+		check_vector(G.tex_coord_indices, R.tex_coord_indices, "tex_coord_indices") &&
+		check_vector(G.group_indices, R.group_indices, "group_indices") &&
+		check_vector(G.material_indices, R.material_indices, "material_indices") &&
+		check_vector(G.group_names, R.group_names, "group_names");
+	if (G.colors.size() != R.colors.size()) {
+		std::cerr << "obj_parallel_reader: number of colors differs" << std::endl;
+		return false;
+	}
+	for (size_t i = 0; i < G.colors.size(); ++i)
+		if (!(G.colors[i] == R.colors[i])) {
+			std::cerr << "obj_parallel_reader: color " << i << " differs" << std::endl;
+			return false;
+		}
+	if (G.materials.size() != R.materials.size()) {
+		std::cerr << "obj_parallel_reader: number of materials differs" << std::endl;
+		return false;
+	}
+	for (size_t i = 0; i < G.materials.size(); ++i)
+		if (G.materials[i].get_name() != R.materials[i].get_name() || !(G.materials[i].get_diffuse() == R.materials[i].get_diffuse())) {
+			std::cerr << "obj_parallel_reader: material " << i << " differs" << std::endl;
+			return false;
+		}
+	return result;
+}
+
+bool test_obj_parallel_reader()
+{
+	std::string obj_file_name = "test_obj_parallel_reader.obj", mtl_file_name = "test_obj_parallel_reader.mtl";
+	std::string cache_directory = "test_obj_parallel_reader_cache";
+	if (!write_text_file(mtl_file_name, "newmtl red\nKd 1 0 0\nnewmtl blue\nKd 0 0 1\n"))
+		return false;
+	// text with about 6 MB such that 4 threads parse 4 ranges
+	std::string content = generate_obj(300, mtl_file_name);
+	if (!write_text_file(obj_file_name, content))
+		return false;
+	obj_geometry<float> R;
+	reference_obj_reader ref_reader(R);
+	bool result = ref_reader.read_obj(obj_file_name);
+	for (unsigned nr_threads = 1; nr_threads <= 4; nr_threads += 3) {
+		obj_geometry<float> G;
+		obj_parallel_reader<float> reader(G);
+		reader.set_nr_threads(nr_threads);
+		reader.parse_obj(content.data(), content.data() + content.size());
+		if (!check_geometry(G, R))
+			result = false;
+	}
+	// caching is disabled by default
+	{
+		obj_geometry<float> G;
+		obj_parallel_reader<float> reader(G);
+		TEST_ASSERT(reader.get_cache_directory().empty());
+		TEST_ASSERT(reader.read_obj(obj_file_name) && check_geometry(G, R));
+		TEST_ASSERT(!cgv::utils::dir::exists(cache_directory));
+	}
+	// obj files of the same name in different directories use different cache files
+	{
+		obj_geometry<float> G;
+		obj_parallel_reader<float> reader(G);
+		reader.set_cache_directory(cache_directory);
+		std::string cache_file_name = reader.get_cache_file_name(obj_file_name);
+		TEST_ASSERT_EQ(cgv::utils::file::get_path(cache_file_name), cache_directory);
+		TEST_ASSERT(cache_file_name != reader.get_cache_file_name("other/" + obj_file_name));
+	}
+	// first read creates the cache directory and writes the cache, second read uses it, after changing the file the cache is rebuilt
+	set_obj_cache_directory(cache_directory);
+	std::string cache_file_name;
+	if (result) {
+		for (int i = 0; i < 2; ++i) {
+			obj_geometry<float> G;
+			obj_parallel_reader<float> reader(G);
+			cache_file_name = reader.get_cache_file_name(obj_file_name);
+			if (!reader.read_obj(obj_file_name) || !check_geometry(G, R))
+				result = false;
+			if (!cgv::utils::file::exists(cache_file_name)) {
+				std::cerr << "obj_parallel_reader: cache file not written" << std::endl;
+				result = false;
+			}
+		}
+		content += "v 2 2 2\n";
+		write_text_file(obj_file_name, content);
+		R.positions.push_back(obj_geometry<float>::v3d_type(2, 2, 2));
+		obj_geometry<float> G;
+		obj_parallel_reader<float> reader(G);
+		if (!reader.read_obj(obj_file_name) || !check_geometry(G, R))
+			result = false;
+	}
+	set_obj_cache_directory("");
+	cgv::utils::file::remove(cache_file_name);
+	cgv::utils::dir::rmdir(cache_directory);
+	cgv::utils::file::remove(obj_file_name);
+	cgv::utils::file::remove(mtl_file_name);
+	return result;
+}
+
+bool benchmark_obj_parallel_reader()
+{
+	std::string obj_file_name = "benchmark_obj_parallel_reader.obj", cache_directory = "benchmark_obj_parallel_reader_cache";
+	std::string content = generate_obj(1000, "none.mtl");
+	if (!write_text_file(obj_file_name, content))
+		return false;
+	double mb = content.size() / 1048576.0;
+	auto t0 = std::chrono::steady_clock::now();
+	obj_geometry<float> R;
+	reference_obj_reader ref_reader(R);
+	ref_reader.read_obj(obj_file_name);
+	auto t1 = std::chrono::steady_clock::now();
+	obj_geometry<float> G;
+	obj_parallel_reader<float> reader(G);
+	reader.set_cache_directory(cache_directory);
+	std::string cache_file_name = reader.get_cache_file_name(obj_file_name);
+	cgv::utils::file::remove(cache_file_name);
+	reader.read_obj(obj_file_name);
+	auto t2 = std::chrono::steady_clock::now();
+	reader.read_obj(obj_file_name);
+	auto t3 = std::chrono::steady_clock::now();
+	double t_ref = std::chrono::duration<double>(t1 - t0).count(), t_par = std::chrono::duration<double>(t2 - t1).count(),
+		t_cache = std::chrono::duration<double>(t3 - t2).count();
+	std::cout << mb << " MB obj with " << G.faces.size() << " faces: obj_reader " << mb / t_ref << " MB/s, parallel reader "
+		<< mb / t_par << " MB/s (including cache writing), cached " << mb / t_cache << " MB/s" << std::endl;
+	bool result = check_geometry(G, R);
+	cgv::utils::file::remove(cache_file_name);
+	cgv::utils::dir::rmdir(cache_directory);
+	cgv::utils::file::remove(obj_file_name);
+	return result;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_obj_parallel_reader_reg("cgv::media::mesh::test_obj_parallel_reader", test_obj_parallel_reader);
+extern CGV_API benchmark_registration benchmark_obj_parallel_reader_reg("cgv::media::mesh::benchmark_obj_parallel_reader", benchmark_obj_parallel_reader);
@@ -0,0 +1,214 @@
+#include <cgv/media/mesh/simple_mesh.h>
+#include <cgv/media/mesh/stl_reader.h>
+#include <cgv/utils/file.h>
+#include <cgv/base/register.h>
+#include "test_helpers.h"
+#include <iostream>
+#include <chrono>
+
+using namespace cgv::base;
+using namespace cgv::media::mesh;
+
+typedef simple_mesh<float> mesh_type;
+typedef simple_mesh_base::idx_type idx_type;
+
+/** construct n x n grid of positions with per position normals, texture coordinates and colors. Cells are quads
+    except for the last row, which is split into triangles. */
+static void generate_grid(mesh_type& M, idx_type n, bool per_face_normals = false)
+{
+	M.clear();
+	M.ensure_colors(cgv::media::CT_RGBA8, (n + 1)*(n + 1));
+	for (idx_type j = 0; j <= n; ++j)
+		for (idx_type i = 0; i <= n; ++i) {
+			idx_type pi = M.new_position(mesh_type::vec3(float(i) / n, float(j) / n, 0.1f*float((i*j) % 7)));
+			M.new_tex_coord(mesh_type::vec2(float(i) / n, float(j) / n));
+			if (!per_face_normals)
+				M.new_normal(mesh_type::vec3(0, float(i % 2), 1));
+			M.set_color(pi, cgv::media::color_storage_types::rgba8(uint8_t(i), uint8_t(j), uint8_t(i + j), 255));
+		}
+	if (per_face_normals) {
+		M.new_normal(mesh_type::vec3(0, 0, 1));
+		M.new_normal(mesh_type::vec3(0, 0, -1));
+	}
+	for (idx_type j = 0; j < n; ++j)
+		for (idx_type i = 0; i < n; ++i) {
+			idx_type p00 = j*(n + 1) + i, p10 = p00 + 1, p01 = p00 + n + 1, p11 = p01 + 1;
+			idx_type ni[4] = { p00, p10, p11, p01 };
+			if (per_face_normals)
+				ni[0] = ni[1] = ni[2] = ni[3] = (i + j) % 2;
+			if (j + 1 < n) {
+				M.start_face();
+				M.new_corner(p00, ni[0], p00);
+				M.new_corner(p10, ni[1], p10);
+				M.new_corner(p11, ni[2], p11);
+				M.new_corner(p01, ni[3], p01);
+			}
+			else {
+				M.start_face();
+				M.new_corner(p00, ni[0], p00);
+				M.new_corner(p10, ni[1], p10);
+				M.new_corner(p11, ni[2], p11);
+				M.start_face();
+				M.new_corner(p00, ni[0], p00);
+				M.new_corner(p11, ni[2], p11);
+				M.new_corner(p01, ni[3], p01);
+			}
+		}
+}
+
+/// check that faces of both meshes reference the same positions, normals and texture coordinates
+static bool check_corners(const mesh_type& M, const mesh_type& R, bool nmls, bool tcs)
+{
+	if (M.get_nr_faces() != R.get_nr_faces() || M.get_nr_corners() != R.get_nr_corners()) {
+		std::cerr << "simple_mesh_io: " << M.get_nr_faces() << " faces instead of " << R.get_nr_faces() << std::endl;
+		return false;
+	}
+	for (idx_type fi = 0; fi < M.get_nr_faces(); ++fi) {
+		if (M.begin_corner(fi) != R.begin_corner(fi)) {
+			std::cerr << "simple_mesh_io: face " << fi << " differs" << std::endl;
+			return false;
+		}
+	}
+	for (idx_type ci = 0; ci < M.get_nr_corners(); ++ci) {
+		if (!(M.position(M.c2p(ci)) == R.position(R.c2p(ci))) ||
+			(nmls && !(M.normal(M.c2n(ci)) == R.normal(R.c2n(ci)))) ||
+			(tcs && !(M.tex_coord(M.c2t(ci)) == R.tex_coord(R.c2t(ci))))) {
+			std::cerr << "simple_mesh_io: corner " << ci << " differs" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool test_ply()
+{
+	std::string file_name = "test_simple_mesh_io.ply";
+	bool result = true;
+	// per position attributes are written without duplication
+	mesh_type R, M;
+	generate_grid(R, 20);
+	if (!R.write(file_name) || !M.read(file_name) || !check_corners(M, R, true, true))
+		result = false;
+	else if (M.get_nr_positions() != R.get_nr_positions() || M.get_nr_colors() != R.get_nr_colors()) {
+		std::cerr << "simple_mesh_io: ply vertices or colors not preserved" << std::endl;
+		result = false;
+	}
+	else {
+		for (idx_type pi = 0; pi < M.get_nr_positions(); ++pi) {
+			cgv::media::color_storage_types::rgba8 c, d;
+			M.put_color(pi, c);
+			R.put_color(pi, d);
+			if (!(c == d)) {
+				std::cerr << "simple_mesh_io: color " << pi << " differs" << std::endl;
+				result = false;
+				break;
+			}
+		}
+	}
+	// per face normals require duplication of vertices
+	generate_grid(R, 10, true);
+	if (!R.write_ply(file_name) || !M.read_ply(file_name) || !check_corners(M, R, true, true))
+		result = false;
+	// ascii file with additional element and property
+	write_text_file(file_name,
+		"ply\nformat ascii 1.0\ncomment test\nelement vertex 4\nproperty float x\nproperty float y\nproperty float z\n"
+		"property float confidence\nproperty uchar red\nproperty uchar green\nproperty uchar blue\n"
+		"element face 2\nproperty list uchar int vertex_indices\nproperty int flags\n"
+		"element edge 1\nproperty int vertex1\nproperty int vertex2\nend_header\n"
+		"0 0 0 0.5 255 0 0\n1 0 0 0.5 0 255 0\n1 1 0 0.5 0 0 255\n0 1 0 0.5 255 255 255\n"
+		"3 0 1 2 7\n3 0 2 3 7\n0 1\n");
+	if (!M.read_ply(file_name) || M.get_nr_positions() != 4 || M.get_nr_faces() != 2 || M.get_nr_corners() != 6 ||
+		M.c2p(5) != 3 || !(M.position(2) == mesh_type::vec3(1, 1, 0)) || M.get_nr_colors() != 4) {
+		std::cerr << "simple_mesh_io: ascii ply not read correctly" << std::endl;
+		result = false;
+	}
+	cgv::utils::file::remove(file_name);
+	return result;
+}
+
+static bool test_stl()
+{
+	std::string file_name = "test_simple_mesh_io.stl";
+	bool result = true;
+	mesh_type R, M;
+	generate_grid(R, 20);
+	// welding recovers the positions of the grid and faces are split into triangle fans
+	if (!R.write(file_name) || !M.read(file_name) || M.get_nr_positions() != R.get_nr_positions()) {
+		std::cerr << "simple_mesh_io: stl with " << M.get_nr_positions() << " positions" << std::endl;
+		result = false;
+	}
+	else {
+		idx_type ti = 0;
+		for (idx_type fi = 0; result && fi < R.get_nr_faces(); ++fi) {
+			idx_type c0 = R.begin_corner(fi);
+			for (idx_type ci = c0 + 1; result && ci + 1 < R.end_corner(fi); ++ci, ++ti) {
+				idx_type rc[3] = { c0, ci, ci + 1 };
+				for (int k = 0; k < 3; ++k)
+					if (ti >= M.get_nr_faces() || !(M.position(M.c2p(3 * ti + k)) == R.position(R.c2p(rc[k])))) {
+						std::cerr << "simple_mesh_io: stl triangle " << ti << " differs" << std::endl;
+						result = false;
+						break;
+					}
+			}
+		}
+	}
+	if (M.get_nr_normals() != M.get_nr_faces() || !M.has_normal_indices()) {
+		std::cerr << "simple_mesh_io: stl normals missing" << std::endl;
+		result = false;
+	}
+	if (!M.read_stl(file_name, false) || M.get_nr_positions() != M.get_nr_corners()) {
+		std::cerr << "simple_mesh_io: stl without welding not read correctly" << std::endl;
+		result = false;
+	}
+	// ascii stl
+	write_text_file(file_name,
+		"solid test\n facet normal 0 0 1\n  outer loop\n   vertex 0 0 0\n   vertex 1 0 0\n   vertex 1 1 0\n  endloop\n endfacet\n"
+		" facet normal 0 0 1\n  outer loop\n   vertex 0 0 0\n   vertex 1 1 0\n   vertex 0 1 -0\n  endloop\n endfacet\nendsolid test\n");
+	if (!M.read_stl(file_name) || M.get_nr_positions() != 4 || M.get_nr_faces() != 2 || M.c2p(3) != 0 || M.c2p(4) != 2) {
+		std::cerr << "simple_mesh_io: ascii stl not read correctly" << std::endl;
+		result = false;
+	}
+	cgv::utils::file::remove(file_name);
+	return result;
+}
+
+bool test_simple_mesh_io()
+{
+	bool result = test_ply();
+	if (!test_stl())
+		result = false;
+	return result;
+}
+
+bool benchmark_simple_mesh_io()
+{
+	std::string ply_file_name = "benchmark_simple_mesh_io.ply", stl_file_name = "benchmark_simple_mesh_io.stl";
+	mesh_type R, M;
+	generate_grid(R, 1000);
+	if (!R.write(ply_file_name) || !R.write(stl_file_name))
+		return false;
+	double ply_mb = cgv::utils::file::size(ply_file_name) / 1048576.0, stl_mb = cgv::utils::file::size(stl_file_name) / 1048576.0;
+	auto t0 = std::chrono::steady_clock::now();
+	bool result = M.read(ply_file_name);
+	auto t1 = std::chrono::steady_clock::now();
+	result = M.read(stl_file_name) && result;
+	auto t2 = std::chrono::steady_clock::now();
+	stl_reader::StlMesh<float, unsigned> stl_mesh(stl_file_name);
+	auto t3 = std::chrono::steady_clock::now();
+	double t_ply = std::chrono::duration<double>(t1 - t0).count(), t_stl = std::chrono::duration<double>(t2 - t1).count(),
+		t_ref = std::chrono::duration<double>(t3 - t2).count();
+	std::cout << "ply " << ply_mb / t_ply << " MB/s, stl " << stl_mb / t_stl << " MB/s (stl_reader " << stl_mb / t_ref
+		<< " MB/s) for " << M.get_nr_faces() << " triangles" << std::endl;
+	if (M.get_nr_positions() != stl_mesh.num_vrts()) {
+		std::cerr << "simple_mesh_io: " << M.get_nr_positions() << " welded positions instead of " << stl_mesh.num_vrts() << std::endl;
+		result = false;
+	}
+	cgv::utils::file::remove(ply_file_name);
+	cgv::utils::file::remove(stl_file_name);
+	return result;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_simple_mesh_io_reg("cgv::media::mesh::test_simple_mesh_io", test_simple_mesh_io);
+extern CGV_API benchmark_registration benchmark_simple_mesh_io_reg("cgv::media::mesh::benchmark_simple_mesh_io", benchmark_simple_mesh_io);
@@ -0,0 +1,214 @@
+#include <cgv/media/mesh/marching_cubes.h>
+#include <cgv/media/mesh/dual_contouring.h>
+#include <cgv/media/mesh/cuberille.h>
+#include <cgv/media/mesh/active_block_mask.h>
+#include <cgv/media/volume/min_max_block_grid.h>
+#include <cgv/math/mfunc.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+using namespace cgv::base;
+using namespace cgv::media::mesh;
+using cgv::media::volume::min_max_block_grid;
+
+/// thin torus with a wavy surface, which intersects only a small fraction of the blocks and counts its evaluations
+template <typename X>
+struct counting_torus : public cgv::math::v3_func<X, X>
+{
+	/// cuberille evaluates one slice above the box, where the negated function must be outside for dense and sparse extraction to agree
+	bool negate = false;
+	mutable size_t nr_evaluations = 0;
+	X evaluate(const cgv::math::vec<X>& p) const
+	{
+		++nr_evaluations;
+		if (negate && p(2) > X(0.5001))
+			return X(-100);
+		X r = std::sqrt(p(0)*p(0) + p(1)*p(1)) - X(0.3);
+		X v = r*r + p(2)*p(2) - X(0.01) + X(0.005)*std::sin(13 * p(0))*std::cos(11 * p(2));
+		return negate ? -v : v;
+	}
+};
+
+/// record all callbacks of a streaming mesh including vertex locations in a string
+template <typename X>
+struct mesh_recorder : public streaming_mesh_callback_handler
+{
+	std::ostringstream os;
+	streaming_mesh<X>* sm = 0;
+	void new_vertex(unsigned int vi)
+	{
+		const cgv::math::fvec<X, 3>& p = sm->vertex_location(vi);
+		os << "v " << vi << " " << p(0) << " " << p(1) << " " << p(2) << "\n";
+	}
+	void new_polygon(const std::vector<unsigned int>& vertex_indices)
+	{
+		os << "f";
+		for (unsigned int vi : vertex_indices)
+			os << " " << vi;
+		os << "\n";
+	}
+	void before_drop_vertex(unsigned int vi) { os << "d " << vi << "\n"; }
+};
+
+/// sample func at the grid points with the same coordinate accumulation as the extractors
+template <typename X>
+static std::vector<float> sample(const counting_torus<X>& func, const cgv::media::axis_aligned_box<X, 3>& box, unsigned int resx, unsigned int resy, unsigned int resz)
+{
+	std::vector<float> values(size_t(resx)*resy*resz);
+	cgv::math::fvec<X, 3> d = box.get_extent(), p;
+	d(0) /= resx - 1; d(1) /= resy - 1; d(2) /= resz - 1;
+	unsigned int i, j, k;
+	for (k = 0, p(2) = box.get_min_pnt()(2); k < resz; ++k, p(2) += d(2))
+		for (j = 0, p(1) = box.get_min_pnt()(1); j < resy; ++j, p(1) += d(1))
+			for (i = 0, p(0) = box.get_min_pnt()(0); i < resx; ++i, p(0) += d(0))
+				values[i + resx*(j + resy*k)] = float(func.evaluate(p.to_vec()));
+	return values;
+}
+
+/// check block value ranges and active blocks against the sampled values
+static bool check_block_grid(const min_max_block_grid& grid, const std::vector<float>& values, unsigned int resx, unsigned int resy, unsigned int resz)
+{
+	const min_max_block_grid::dimension_type& nr_blocks = grid.get_nr_blocks();
+	int bs = int(grid.get_block_size());
+	// blocks cover all cells
+	TEST_ASSERT_EQ(nr_blocks(0), int(resx + bs - 2) / bs);
+	TEST_ASSERT_EQ(nr_blocks(1), int(resy + bs - 2) / bs);
+	TEST_ASSERT_EQ(nr_blocks(2), int(resz + bs - 2) / bs);
+	for (int bz = 0; bz < nr_blocks(2); ++bz)
+		for (int by = 0; by < nr_blocks(1); ++by)
+			for (int bx = 0; bx < nr_blocks(0); ++bx) {
+				// neighboring blocks share one layer of voxels
+				float min_value = values[bx*bs + resx*(by*bs + resy*bz*bs)], max_value = min_value;
+				for (int k = bz*bs; k <= std::min(bz*bs + bs, int(resz) - 1); ++k)
+					for (int j = by*bs; j <= std::min(by*bs + bs, int(resy) - 1); ++j)
+						for (int i = bx*bs; i <= std::min(bx*bs + bs, int(resx) - 1); ++i) {
+							min_value = std::min(min_value, values[i + resx*(j + resy*k)]);
+							max_value = std::max(max_value, values[i + resx*(j + resy*k)]);
+						}
+				unsigned int bi = grid.get_block_index(bx, by, bz);
+				TEST_ASSERT_EQ(grid.get_min_value(bi), min_value);
+				TEST_ASSERT_EQ(grid.get_max_value(bi), max_value);
+			}
+	for (float iso_value : { -1.0f, 0.0f, 0.3f, 5.0f }) {
+		std::vector<bool> active;
+		size_t nr_active = grid.compute_active_blocks(iso_value, active);
+		TEST_ASSERT_EQ(active.size(), size_t(nr_blocks(0))*nr_blocks(1)*nr_blocks(2));
+		TEST_ASSERT_EQ(size_t(std::count(active.begin(), active.end(), true)), nr_active);
+		for (unsigned int bi = 0; bi < active.size(); ++bi)
+			TEST_ASSERT_EQ(bool(active[bi]), grid.is_block_active(bi, iso_value));
+	}
+	return true;
+}
+
+/// check the spans of an active block mask against its per point and per cell queries
+static bool check_mask(const active_block_mask& mask, unsigned int resx, unsigned int resy, unsigned int resz)
+{
+	std::vector<active_block_mask::span_type> spans;
+	for (int k = 0; k + 1 < int(resz); ++k)
+		for (int j = 0; j < int(resy); ++j) {
+			mask.compute_point_spans(j, k, k, spans);
+			std::vector<bool> in_span(resx, false);
+			for (const auto& s : spans)
+				for (int i = s.first; i < s.second; ++i)
+					in_span[i] = true;
+			bool point_spans_match = true;
+			for (int i = 0; i < int(resx); ++i) {
+				bool corner = false;
+				for (int dj = -1; dj <= 0; ++dj)
+					for (int di = -1; di <= 0; ++di)
+						corner = corner || mask.is_cell_active(i + di, j + dj, k);
+				point_spans_match = point_spans_match && in_span[i] == corner;
+			}
+			TEST_ASSERT(point_spans_match);
+			mask.compute_cell_spans(j, k, spans);
+			std::fill(in_span.begin(), in_span.end(), false);
+			for (const auto& s : spans)
+				for (int i = s.first; i < s.second; ++i)
+					in_span[i] = true;
+			bool cell_spans_match = true;
+			for (int i = 0; i + 1 < int(resx); ++i)
+				cell_spans_match = cell_spans_match && in_span[i] == mask.is_cell_active(i, j, k);
+			TEST_ASSERT(cell_spans_match);
+		}
+	return true;
+}
+
+bool test_sparse_extraction()
+{
+	// block predicates of cuberille may only be false if the predicate fails for all values in the range
+	TEST_ASSERT(greater_equal<float>(1.0f).may_hold(0.0f, 1.0f));
+	TEST_ASSERT(!greater_equal<float>(1.0f).may_hold(0.0f, 0.5f));
+	TEST_ASSERT(equal<float>(1.0f).may_hold(1.0f, 1.0f));
+	TEST_ASSERT(equal<float>(1.0f).may_hold(0.0f, 2.0f));
+	TEST_ASSERT(!equal<float>(1.0f).may_hold(1.5f, 2.0f));
+
+	counting_torus<float> func;
+	counting_torus<float> negated_func;
+	negated_func.negate = true;
+	counting_torus<double> dfunc;
+	cgv::media::axis_aligned_box<float, 3> box(cgv::math::fvec<float, 3>(-1, -1, -0.5f), cgv::math::fvec<float, 3>(1, 1, 0.5f));
+	cgv::media::axis_aligned_box<double, 3> dbox(cgv::math::fvec<double, 3>(-1, -1, -0.5), cgv::math::fvec<double, 3>(1, 1, 0.5));
+	for (unsigned int res : { 9u, 40u, 81u }) {
+		unsigned int resx = res, resy = res + 2, resz = res / 2 + 2;
+		std::vector<float> values = sample(func, box, resx, resy, resz);
+		std::vector<float> negated_values = sample(negated_func, box, resx, resy, resz);
+		std::vector<float> dvalues = sample(dfunc, dbox, resx, resy, resz);
+		for (unsigned int block_size : { 1u, 4u, 8u }) {
+			min_max_block_grid grid, negated_grid, dgrid;
+			grid.build(&values[0], min_max_block_grid::dimension_type(resx, resy, resz), block_size);
+			negated_grid.build(&negated_values[0], min_max_block_grid::dimension_type(resx, resy, resz), block_size);
+			dgrid.build(&dvalues[0], min_max_block_grid::dimension_type(resx, resy, resz), block_size);
+			TEST_ASSERT(check_block_grid(grid, values, resx, resy, resz));
+			active_block_mask mask;
+			TEST_ASSERT(mask.init(grid, 0.0f, resx, resy, resz));
+			TEST_ASSERT(check_mask(mask, resx, resy, resz));
+			// grids built for another resolution are rejected
+			if (res == 9 && block_size == 1)
+				TEST_ASSERT(!mask.init(grid, 0.0f, resx + 1, resy, resz));
+
+			// sparse extraction produces the same mesh as the dense one, but evaluates the function less often on finer grids
+			for (float iso_value : { 0.0f, -0.005f, 0.3f, 5.0f }) {
+				mesh_recorder<float> dense, sparse;
+				marching_cubes<float, float> mc_dense(func, &dense, 0.1f), mc_sparse(func, &sparse, 0.1f);
+				dense.sm = &mc_dense;
+				sparse.sm = &mc_sparse;
+				func.nr_evaluations = 0;
+				mc_dense.extract(iso_value, box, resx, resy, resz);
+				size_t nr_dense_evaluations = func.nr_evaluations;
+				func.nr_evaluations = 0;
+				mc_sparse.extract(iso_value, box, grid);
+				TEST_ASSERT(sparse.os.str() == dense.os.str());
+				TEST_ASSERT(func.nr_evaluations <= nr_dense_evaluations);
+				if (res > 9 && block_size > 1 && iso_value == 0.0f)
+					TEST_ASSERT(2 * func.nr_evaluations < nr_dense_evaluations);
+			}
+			for (double iso_value : { 0.0, 0.3, 5.0 }) {
+				mesh_recorder<double> dense, sparse;
+				dual_contouring<double, double> dc_dense(dfunc, &dense), dc_sparse(dfunc, &sparse);
+				dense.sm = &dc_dense;
+				sparse.sm = &dc_sparse;
+				dc_dense.extract(iso_value, dbox, resx, resy, resz);
+				dc_sparse.extract(iso_value, dbox, dgrid);
+				TEST_ASSERT(sparse.os.str() == dense.os.str());
+			}
+			for (float reference_value : { 0.0f, -0.3f, -5.0f }) {
+				mesh_recorder<float> dense, sparse;
+				greater_equal<float> pred(reference_value);
+				cuberille<float, float, greater_equal<float> > cub_dense(negated_func, &dense, pred), cub_sparse(negated_func, &sparse, pred);
+				dense.sm = &cub_dense;
+				sparse.sm = &cub_sparse;
+				cub_dense.extract(box, resx, resy, resz);
+				cub_sparse.extract(box, negated_grid);
+				TEST_ASSERT(sparse.os.str() == dense.os.str());
+			}
+		}
+	}
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_sparse_extraction_reg("cgv::media::mesh::test_sparse_extraction", test_sparse_extraction);
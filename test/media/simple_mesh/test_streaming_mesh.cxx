@@ -0,0 +1,203 @@
+#include <cgv/media/mesh/marching_cubes.h>
+#include <cgv/media/mesh/streaming_mesh_stages.h>
+#include <cgv/media/mesh/streaming_ply_writer.h>
+#include <cgv/media/mesh/simple_mesh.h>
+#include <cgv/utils/file.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <set>
+
+using namespace cgv::base;
+using namespace cgv::media::mesh;
+
+typedef simple_mesh<float> mesh_type;
+typedef simple_mesh_base::idx_type idx_type;
+typedef marching_cubes_base<float, float> mc_type;
+typedef mc_type::pnt_type pnt_type;
+
+/// distance to origin as implicit function of a sphere
+struct sphere_eval
+{
+	float operator () (unsigned i, unsigned j, unsigned k, const pnt_type& p) const { return p.length(); }
+};
+
+/// stage that collects the stream into a simple_mesh and records the maximum number of live vertices of its source
+struct collecting_stage : public streaming_mesh_stage
+{
+	const streaming_mesh<float>* source;
+	mesh_type mesh;
+	unsigned int max_nr_live_vertices;
+	collecting_stage(const streaming_mesh<float>* _source, streaming_mesh_callback_handler* _next = 0) :
+		streaming_mesh_stage(_next), source(_source), max_nr_live_vertices(0) {}
+	void new_vertex(unsigned int vi) {
+		mesh.new_position(source->vertex_location(vi));
+		max_nr_live_vertices = std::max(max_nr_live_vertices, source->get_nr_live_vertices());
+		streaming_mesh_stage::new_vertex(vi);
+	}
+	void new_polygon(const std::vector<unsigned int>& vis) {
+		mesh.start_face();
+		for (unsigned int vi : vis)
+			mesh.new_corner(vi);
+		streaming_mesh_stage::new_polygon(vis);
+	}
+};
+
+/// extract sphere of given radius in [-1,1]^3 at given resolution and finish the stream
+static void extract_sphere(mc_type& mc, float radius, unsigned int res)
+{
+	cgv::media::axis_aligned_box<float, 3> box(pnt_type(-1, -1, -1), pnt_type(1, 1, 1));
+	mc.extract_impl(radius, box, res, res, res, sphere_eval(), always_valid<float>());
+	mc.finish();
+}
+
+/// check that ply file contains mesh and that normals are radial
+static bool check_written_mesh(const std::string& file_name, const mesh_type& R)
+{
+	mesh_type M;
+	if (!M.read_ply(file_name))
+		return false;
+	if (M.get_nr_positions() != R.get_nr_positions() || M.get_nr_faces() != R.get_nr_faces() || M.get_nr_corners() != R.get_nr_corners()) {
+		std::cerr << "streaming_mesh: written mesh has " << M.get_nr_positions() << " positions and " << M.get_nr_faces() << " faces" << std::endl;
+		return false;
+	}
+	for (idx_type pi = 0; pi < M.get_nr_positions(); ++pi)
+		if (!(M.position(pi) == R.position(pi))) {
+			std::cerr << "streaming_mesh: position " << pi << " differs" << std::endl;
+			return false;
+		}
+	for (idx_type ci = 0; ci < M.get_nr_corners(); ++ci)
+		if (M.c2p(ci) != R.c2p(ci)) {
+			std::cerr << "streaming_mesh: corner " << ci << " differs" << std::endl;
+			return false;
+		}
+	if (M.get_nr_normals() != M.get_nr_positions()) {
+		std::cerr << "streaming_mesh: normals missing" << std::endl;
+		return false;
+	}
+	// marching cubes orients all triangles consistently
+	float sign = dot(M.normal(0), M.position(0)) < 0 ? -1.0f : 1.0f;
+	for (idx_type pi = 0; pi < M.get_nr_positions(); ++pi)
+		if (sign * dot(M.normal(pi), normalize(M.position(pi))) < 0.95f) {
+			std::cerr << "streaming_mesh: normal " << pi << " is not radial" << std::endl;
+			return false;
+		}
+	return true;
+}
+
+static bool test_writer()
+{
+	std::string file_name = "test_streaming_mesh.ply";
+	mc_type mc(0);
+	streaming_ply_writer<float> writer(&mc);
+	streaming_normal_stage<float> normals(&mc, &writer);
+	collecting_stage collector(&mc, &normals);
+	mc.set_callback_handler(&collector);
+	if (!writer.open(file_name, true))
+		return false;
+	extract_sphere(mc, 0.8f, 40);
+	bool result = !writer.is_open() && check_written_mesh(file_name, collector.mesh);
+	// only the vertices of few slices are kept in memory
+	if (collector.max_nr_live_vertices * 5 > mc.get_nr_vertices()) {
+		std::cerr << "streaming_mesh: " << collector.max_nr_live_vertices << " of " << mc.get_nr_vertices() << " vertices kept in memory" << std::endl;
+		result = false;
+	}
+	cgv::utils::file::remove(file_name);
+	return result;
+}
+
+static bool test_clustering()
+{
+	std::string file_name = "test_streaming_mesh_clustering.ply";
+	mc_type mc(0);
+	streaming_clustering_stage<float> clustering(&mc);
+	clustering.set_grid(pnt_type(-1, -1, -1), 0.1f);
+	streaming_ply_writer<float> writer(&clustering.get_output());
+	streaming_normal_stage<float> normals(&clustering.get_output(), &writer);
+	clustering.get_output().set_callback_handler(&normals);
+	mc.set_callback_handler(&clustering);
+	if (!writer.open(file_name, true))
+		return false;
+	extract_sphere(mc, 0.8f, 60);
+	bool result = true;
+	mesh_type M;
+	if (!M.read_ply(file_name) || M.get_nr_faces() * 10 > mc.get_nr_faces() || M.get_nr_faces() < 500 || clustering.get_nr_open_cells() != 0) {
+		std::cerr << "streaming_mesh: clustering reduced " << mc.get_nr_faces() << " to " << M.get_nr_faces() << " triangles" << std::endl;
+		result = false;
+	}
+	for (idx_type pi = 0; result && pi < M.get_nr_positions(); ++pi)
+		if (std::abs(M.position(pi).length() - 0.8f) > 0.02f) {
+			std::cerr << "streaming_mesh: clustered position " << M.position(pi) << " is off the sphere" << std::endl;
+			result = false;
+		}
+	std::set<std::vector<idx_type> > triangles;
+	for (idx_type fi = 0; result && fi < M.get_nr_faces(); ++fi) {
+		std::vector<idx_type> t = { M.c2p(3 * fi), M.c2p(3 * fi + 1), M.c2p(3 * fi + 2) };
+		std::sort(t.begin(), t.end());
+		if (t[0] == t[1] || t[1] == t[2] || !triangles.insert(t).second) {
+			std::cerr << "streaming_mesh: degenerate or duplicate triangle " << fi << std::endl;
+			result = false;
+		}
+	}
+	cgv::utils::file::remove(file_name);
+	return result;
+}
+
+bool test_streaming_mesh()
+{
+	bool result = test_writer();
+	if (!test_clustering())
+		result = false;
+	return result;
+}
+
+bool benchmark_streaming_mesh()
+{
+	std::string file_name = "benchmark_streaming_mesh.ply";
+	unsigned int res = 400;
+	// in memory reference
+	mc_type mc(0);
+	collecting_stage collector(&mc);
+	mc.set_callback_handler(&collector);
+	auto t0 = std::chrono::steady_clock::now();
+	extract_sphere(mc, 0.8f, res);
+	bool result = collector.mesh.write_ply(file_name);
+	auto t1 = std::chrono::steady_clock::now();
+	unsigned int nr_faces = mc.get_nr_faces();
+	collector.mesh.clear();
+	// streaming pipeline
+	mc_type mc_stream(0);
+	streaming_ply_writer<float> writer(&mc_stream);
+	streaming_normal_stage<float> normals(&mc_stream, &writer);
+	mc_stream.set_callback_handler(&normals);
+	auto t2 = std::chrono::steady_clock::now();
+	result = writer.open(file_name, true) && result;
+	extract_sphere(mc_stream, 0.8f, res);
+	auto t3 = std::chrono::steady_clock::now();
+	double file_mb = cgv::utils::file::size(file_name) / 1048576.0;
+	// streaming decimation
+	mc_type mc_decimate(0);
+	streaming_clustering_stage<float> clustering(&mc_decimate);
+	clustering.set_grid(pnt_type(-1, -1, -1), 0.01f);
+	writer.set_source(&clustering.get_output());
+	normals.set_source(&clustering.get_output());
+	clustering.get_output().set_callback_handler(&normals);
+	mc_decimate.set_callback_handler(&clustering);
+	auto t4 = std::chrono::steady_clock::now();
+	result = writer.open(file_name, true) && result;
+	extract_sphere(mc_decimate, 0.8f, res);
+	auto t5 = std::chrono::steady_clock::now();
+	std::cout << nr_faces << " triangles: in memory " << std::chrono::duration<double>(t1 - t0).count() << " s, streaming "
+		<< std::chrono::duration<double>(t3 - t2).count() << " s (" << file_mb << " MB), streaming clustering to "
+		<< writer.get_nr_faces() << " triangles " << std::chrono::duration<double>(t5 - t4).count() << " s" << std::endl;
+	if (mc_stream.get_nr_faces() != nr_faces)
+		result = false;
+	cgv::utils::file::remove(file_name);
+	return result;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_streaming_mesh_reg("cgv::media::mesh::test_streaming_mesh", test_streaming_mesh);
+extern CGV_API benchmark_registration benchmark_streaming_mesh_reg("cgv::media::mesh::benchmark_streaming_mesh", benchmark_streaming_mesh);
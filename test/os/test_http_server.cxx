@@ -0,0 +1,270 @@
+#include <cgv/os/http_server.h>
+#include <cgv/os/web_server.h>
+#include <cgv/utils/file.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdlib>
+
+using namespace cgv::base;
+using namespace cgv::os;
+
+/// port used by test and benchmark
+static const unsigned test_port = 47321;
+
+/// handler serving a greeting, a chunked stream and files from the temporary directory
+static void handle_test_request(http_request& request, const std::string& file_name)
+{
+	if (request.path == "/hello")
+		request.answer = "hello " + request.params["name"];
+	else if (request.path == "/stream") {
+		auto nr_chunks = std::make_shared<int>(0);
+		request.content_type = "text/plain";
+		request.answer_stream = [nr_chunks](std::string& chunk) {
+			chunk = "chunk" + std::to_string(*nr_chunks) + ";";
+			return ++*nr_chunks < 5;
+		};
+	}
+	else if (request.path == "/file") {
+		request.content_type = "application/octet-stream";
+		request.answer_file_name = file_name;
+	}
+	else if (request.path == "/missing")
+		request.answer_file_name = file_name + ".missing";
+	else if (request.path == "/echo")
+		request.answer = request.body;
+	else {
+		request.status = "404 Not Found";
+		request.answer = "unknown path";
+	}
+}
+
+/// read response and return its status code, where the body of fixed length or chunked responses is stored in body
+static int read_response(socket& s, std::string& body, std::string& line)
+{
+	if (!s.receive_line(line) || line.compare(0, 9, "HTTP/1.1 ") != 0)
+		return -1;
+	int status = atoi(line.c_str() + 9);
+	size_t content_length = 0;
+	bool chunked = false;
+	while (s.receive_line(line) && line != "\r\n") {
+		if (line.compare(0, 16, "Content-Length: ") == 0)
+			content_length = size_t(strtoull(line.c_str() + 16, 0, 10));
+		else if (line == "Transfer-Encoding: chunked\r\n")
+			chunked = true;
+	}
+	body.clear();
+	if (!chunked)
+		return s.receive_data(body, unsigned(content_length)) || content_length == 0 ? status : -1;
+	std::string chunk;
+	while (s.receive_line(line)) {
+		size_t chunk_size = size_t(strtoull(line.c_str(), 0, 16));
+		if (chunk_size == 0)
+			return s.receive_line(line) ? status : -1;
+		if (!s.receive_data(chunk, unsigned(chunk_size)) || !s.receive_line(line))
+			return -1;
+		body += chunk;
+	}
+	return -1;
+}
+
+/// web server answering all requests with a greeting
+struct test_web_server : public web_server
+{
+	test_web_server(unsigned port) : web_server(port) {}
+	void handle_request(http_request& request) { request.answer = "hello"; }
+};
+
+/// run server in a separate thread and return after it accepts connections
+static std::thread start_server(http_server& server)
+{
+	if (!server.listen(test_port))
+		return std::thread();
+	std::thread t(&http_server::run, &server);
+	while (!server.is_running())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	return t;
+}
+
+/// create file of given size with a deterministic pattern
+static std::string create_test_file(size_t size)
+{
+	std::string file_name = "test_http_server_file.bin";
+	std::string content(size, 0);
+	for (size_t i = 0; i < size; ++i)
+		content[i] = char(i * 31 + (i >> 12));
+	std::ofstream os(file_name, std::ios::binary);
+	os.write(content.data(), content.size());
+	return file_name;
+}
+
+bool test_http_server()
+{
+	std::string file_name = create_test_file(3000000);
+	http_server server([&](http_request& request) { handle_test_request(request, file_name); }, 4);
+	server.set_max_body_size(1000);
+	server.set_receive_timeout(200);
+	std::thread t = start_server(server);
+	if (!t.joinable()) {
+		std::cerr << "http_server: could not start server" << std::endl;
+		return false;
+	}
+	bool result = true;
+	auto check = [&](bool condition, const char* what) {
+		if (!condition) {
+			std::cerr << "http_server: " << what << " failed" << std::endl;
+			result = false;
+		}
+	};
+	socket_client_ptr c = create_socket_client();
+	check(c->connect("localhost", test_port), "connect");
+	std::string body, line;
+	// several requests on one keep alive connection
+	for (int i = 0; i < 3; ++i) {
+		c->send_data("GET /hello?name=a%20b HTTP/1.1\r\nHost: localhost\r\n\r\n");
+		check(read_response(*c, body, line) == 200 && body == "hello a b", "keep alive request");
+	}
+	// pipelined requests sent at once
+	c->send_data("GET /hello?name=x HTTP/1.1\r\n\r\nGET /hello?name=y HTTP/1.1\r\n\r\n");
+	check(read_response(*c, body, line) == 200 && body == "hello x", "first pipelined request");
+	check(read_response(*c, body, line) == 200 && body == "hello y", "second pipelined request");
+	// chunked answer
+	c->send_data("GET /stream HTTP/1.1\r\n\r\n");
+	check(read_response(*c, body, line) == 200 && body == "chunk0;chunk1;chunk2;chunk3;chunk4;", "chunked answer");
+	// request body
+	c->send_data("POST /echo HTTP/1.1\r\nContent-Length: 5\r\n\r\nabcde");
+	check(read_response(*c, body, line) == 200 && body == "abcde", "post request");
+	// file answer
+	c->send_data("GET /file HTTP/1.1\r\n\r\n");
+	std::string content;
+	cgv::utils::file::read(file_name, content, false);
+	check(read_response(*c, body, line) == 200 && body == content, "file answer");
+	c->send_data("GET /missing HTTP/1.1\r\n\r\n");
+	check(read_response(*c, body, line) == 404, "missing file");
+	// connection is closed on request
+	c->send_data("GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n");
+	check(read_response(*c, body, line) == 200 && c->receive_line().empty(), "closing request");
+	c->close();
+	// too large bodies and malformed lengths are rejected before the body is read
+	c = create_socket_client();
+	check(c->connect("localhost", test_port), "connect");
+	c->send_data("POST /echo HTTP/1.1\r\nContent-Length: 1001\r\n\r\n");
+	check(read_response(*c, body, line) == 413 && c->receive_line().empty(), "too large body");
+	c->close();
+	c = create_socket_client();
+	check(c->connect("localhost", test_port), "connect");
+	c->send_data("POST /echo HTTP/1.1\r\nContent-Length: -1\r\n\r\n");
+	check(read_response(*c, body, line) == 400 && c->receive_line().empty(), "negative content length");
+	c->close();
+	// connections stalling within a request are closed after the receive timeout
+	c = create_socket_client();
+	check(c->connect("localhost", test_port), "connect");
+	c->send_data("GET /hello HTTP/1.1\r\nHost: loc");
+	auto start = std::chrono::steady_clock::now();
+	check(c->receive_line().empty() && std::chrono::steady_clock::now() - start < std::chrono::seconds(10), "receive timeout");
+	c->close();
+	check(server.get_nr_served_requests() == 10, "request count");
+	server.stop();
+	t.join();
+	// stop before run lets run return immediately
+	check(server.listen(test_port), "listen after stop");
+	server.stop();
+	server.run();
+	check(!server.is_running(), "stop before run");
+	// stop does not wait for the receive timeout of clients stalling within a request
+	server.set_receive_timeout(20000);
+	t = start_server(server);
+	c = create_socket_client();
+	if (t.joinable() && c->connect("localhost", test_port)) {
+		c->send_data("GET /hello HTTP/1.1\r\nHost: loc");
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		start = std::chrono::steady_clock::now();
+		server.stop();
+		t.join();
+		check(std::chrono::steady_clock::now() - start < std::chrono::seconds(5), "stop with stalling client");
+	}
+	else
+		check(false, "restart");
+	c->close();
+	// web server stopped at any time during start, where stops preceding the creation of its server are repeated
+	for (int i = 0; i < 20; ++i) {
+		test_web_server ws(test_port);
+		std::atomic<bool> returned(false);
+		std::thread wt([&]() { ws.start(); returned = true; });
+		std::this_thread::sleep_for(std::chrono::microseconds(100 * i));
+		while (!returned) {
+			ws.stop();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		wt.join();
+	}
+	cgv::utils::file::remove(file_name);
+	return result;
+}
+
+bool benchmark_http_server()
+{
+	std::string file_name = create_test_file(size_t(64) << 20);
+	http_server server([&](http_request& request) { handle_test_request(request, file_name); });
+	std::thread t = start_server(server);
+	if (!t.joinable())
+		return false;
+	auto seconds = [](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) { return std::chrono::duration<double>(b - a).count(); };
+	unsigned nr_clients = 16, nr_requests = 2000, nr_downloads = 4;
+	std::atomic<unsigned> nr_failed(0);
+	// many small requests from concurrent keep alive clients
+	auto t0 = std::chrono::steady_clock::now();
+	std::vector<std::thread> clients;
+	for (unsigned i = 0; i < nr_clients; ++i)
+		clients.push_back(std::thread([&]() {
+			socket_client_ptr c = create_socket_client();
+			if (!c->connect("localhost", test_port)) {
+				++nr_failed;
+				return;
+			}
+			std::string body, line;
+			for (unsigned j = 0; j < nr_requests; ++j) {
+				c->send_data("GET /hello?name=benchmark HTTP/1.1\r\nHost: localhost\r\n\r\n");
+				if (read_response(*c, body, line) != 200) {
+					++nr_failed;
+					break;
+				}
+			}
+			c->close();
+		}));
+	for (auto& c : clients)
+		c.join();
+	auto t1 = std::chrono::steady_clock::now();
+	std::cout << nr_clients << " clients: " << nr_clients * nr_requests / seconds(t0, t1) << " requests per second" << std::endl;
+	// concurrent large downloads
+	clients.clear();
+	for (unsigned i = 0; i < nr_downloads; ++i)
+		clients.push_back(std::thread([&]() {
+			socket_client_ptr c = create_socket_client();
+			std::string body, line;
+			if (!c->connect("localhost", test_port) || !c->send_data("GET /file HTTP/1.1\r\n\r\n") ||
+				read_response(*c, body, line) != 200 || body.size() != size_t(64) << 20)
+				++nr_failed;
+			c->close();
+		}));
+	for (auto& c : clients)
+		c.join();
+	auto t2 = std::chrono::steady_clock::now();
+	std::cout << nr_downloads << " downloads of 64 MB: " << nr_downloads * 64 / seconds(t1, t2) << " MB per second" << std::endl;
+	server.stop();
+	t.join();
+	cgv::utils::file::remove(file_name);
+	if (nr_failed > 0)
+		std::cerr << nr_failed << " failed clients" << std::endl;
+	return nr_failed == 0;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_http_server_reg("cgv::os::test_http_server", test_http_server);
+extern CGV_API benchmark_registration benchmark_http_server_reg("cgv::os::benchmark_http_server", benchmark_http_server);
@@ -0,0 +1,106 @@
+#include <cgv/os/socket.h>
+#include <cgv/utils/file.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+using namespace cgv::base;
+using namespace cgv::os;
+
+/// port used by the test, which differs from the one of test_http_server
+static const int socket_test_port = 47322;
+
+/// byte at position i of the large block sent by the client
+static char block_byte(size_t i)
+{
+	return char(i * 13 + i / 4096);
+}
+
+bool test_socket()
+{
+	std::string file_name = "test_socket.bin", file_content(100000, 0);
+	for (size_t i = 0; i < file_content.size(); ++i)
+		file_content[i] = char(i % 251);
+	TEST_ASSERT(cgv::utils::file::write(file_name, file_content.data(), file_content.size()));
+	socket_server_ptr server = create_socket_server();
+	bool listening = server->bind_and_listen(socket_test_port, 4);
+	TEST_ASSERT(listening);
+	if (!listening)
+		return false;
+
+	// client sends lines, gathered buffers with a large block and a file, then waits for a line and closes
+	std::atomic<bool> client_success(false);
+	std::string block(3000000, 0);
+	for (size_t i = 0; i < block.size(); ++i)
+		block[i] = block_byte(i);
+	std::thread client_thread([&]() {
+		socket_client_ptr c = create_socket_client();
+		if (!c->connect("localhost", socket_test_port) || !c->send_line("hello"))
+			return;
+		socket::buffer buffers[3] = { socket::buffer("HDR\n", 4), socket::buffer(block.data(), block.size()), socket::buffer("line two\nrest", 13) };
+		if (!c->send_data(buffers, 3) || !c->send_file(file_name, 1000, 5000) || !c->send_file(file_name))
+			return;
+		// scattering read of a short answer into two buffers
+		char first[3], second[7];
+		socket::buffer answer[2] = { socket::buffer(first, 3), socket::buffer(second, 7) };
+		std::string line;
+		client_success = c->receive_data(answer, 2) && std::string(first, 3) == "abc" && std::string(second, 7) == "defghij" &&
+			c->receive_line(line) && line == "ping\n";
+		c->close();
+	});
+
+	// select reports the pending connection
+	socket_select sel;
+	TEST_ASSERT(sel.add(server));
+	TEST_ASSERT_EQ(sel.get_nr_sockets(), size_t(1));
+	std::vector<socket_select::event> events;
+	TEST_ASSERT_EQ(sel.wait(events, 5000), 1);
+	TEST_ASSERT(events.size() == 1 && events[0].s == server && (events[0].events & socket_select::SE_READ) != 0);
+	socket_ptr s = server->check_for_connection();
+	TEST_ASSERT(!s.empty());
+	if (s.empty()) {
+		client_thread.join();
+		return false;
+	}
+	// lines and exact reads share the receive buffer
+	std::string line;
+	TEST_ASSERT(s->receive_line(line) && line == "hello\n");
+	TEST_ASSERT(s->receive_line(line) && line == "HDR\n");
+	std::string received_block(block.size(), 0);
+	socket::buffer halves[2] = { socket::buffer(&received_block[0], 1234567), socket::buffer(&received_block[1234567], block.size() - 1234567) };
+	TEST_ASSERT(s->receive_data(halves, 2));
+	TEST_ASSERT(received_block == block);
+	TEST_ASSERT(s->receive_line(line) && line == "line two\n");
+	char rest[4];
+	TEST_ASSERT(s->receive_data(rest, 4) && std::string(rest, 4) == "rest");
+	std::string received_file;
+	TEST_ASSERT(s->receive_data(received_file, 5000));
+	TEST_ASSERT(received_file == file_content.substr(1000, 5000));
+	TEST_ASSERT(s->receive_data(received_file, unsigned(file_content.size())));
+	TEST_ASSERT(received_file == file_content);
+	// nothing is pending until the client got its answer
+	TEST_ASSERT(!s->is_data_pending());
+	TEST_ASSERT(s->send_data("abcdefghij") && s->send_line("ping"));
+
+	// select reports the closed connection as readable and receiving reports it as error
+	TEST_ASSERT(sel.add(s));
+	TEST_ASSERT(sel.remove(server));
+	TEST_ASSERT_EQ(sel.wait(events, 5000), 1);
+	TEST_ASSERT(events.size() == 1 && events[0].s == s);
+	client_thread.join();
+	TEST_ASSERT(client_success);
+	TEST_ASSERT(s->is_data_pending());
+	char buffer[16];
+	TEST_ASSERT_EQ(s->receive_available(buffer, 16), -1);
+	TEST_ASSERT(sel.remove(s));
+	TEST_ASSERT_EQ(sel.get_nr_sockets(), size_t(0));
+	s->close();
+	server->close();
+	cgv::utils::file::remove(file_name);
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_socket_reg("cgv::os::test_socket", test_socket);
@@ -0,0 +1,83 @@
+#include <point_cloud/point_cloud.h>
+#include <cgv/base/register.h>
+#include <cgv/utils/file.h>
+#include <cgv/utils/scan.h>
+#include <cgv/utils/advanced_scan.h>
+#include <cgv/utils/stopwatch.h>
+#include <iostream>
+#include <cstdio>
+
+#pragma warning(disable:4996)
+
+using namespace cgv::utils;
+using namespace cgv::base;
+
+/// reference implementation of the sequential sscanf based xyz reader that point_cloud used before switching to the parallel reader
+static size_t read_xyz_sscanf(const std::string& file_name, std::vector<point_cloud::Pnt>& P, std::vector<point_cloud::Clr>& C)
+{
+	std::string content;
+	if (!file::read(file_name, content, true))
+		return 0;
+	std::vector<line> lines;
+	split_to_lines(content, lines);
+	for (unsigned i = 0; i < lines.size(); ++i) {
+		if (lines[i].empty())
+			continue;
+		point_cloud::Pnt p;
+		int c[3], I;
+		char tmp = lines[i].end[0];
+		content[lines[i].end - content.c_str()] = 0;
+		sscanf(lines[i].begin, "%f %f %f %d %d %d %d", &p[0], &p[1], &p[2], c, c + 1, c + 2, &I);
+		content[lines[i].end - content.c_str()] = tmp;
+		P.push_back(p);
+		C.push_back(point_cloud::Clr(c[0], c[1], c[2]));
+	}
+	return P.size();
+}
+
+/// write a synthetic xyz file with the given number of points and measure throughput of the sequential and the parallel reader
+static bool benchmark_xyz(size_t nr_points)
+{
+	std::string file_name = "benchmark_ascii_reader.xyz";
+	FILE* fp = fopen(file_name.c_str(), "w");
+	if (!fp)
+		return false;
+	for (size_t i = 0; i < nr_points; ++i)
+		fprintf(fp, "%.6f %.6f %.6f %d %d %d %d\n", 0.001 * i, 0.5 * (i % 1000), -0.25 * (i % 777), int(i % 256), int(i % 128), int(i % 64), 100);
+	fclose(fp);
+	double nr_mb = file::size(file_name) / (1024.0 * 1024.0);
+
+	stopwatch watch(false);
+	std::vector<point_cloud::Pnt> P;
+	std::vector<point_cloud::Clr> C;
+	size_t n_ref = read_xyz_sscanf(file_name, P, C);
+	double t_ref = watch.restart();
+
+	point_cloud pc;
+	bool success = pc.read(file_name);
+	double t_par = watch.restart();
+	file::remove(file_name);
+
+	if (!success || pc.get_nr_points() != n_ref) {
+		std::cerr << "parallel xyz reader read " << pc.get_nr_points() << " instead of " << n_ref << " points" << std::endl;
+		return false;
+	}
+	// allow for differently rounded last bits in the parsed coordinates
+	for (size_t i = 0; i < n_ref; ++i)
+		if ((pc.pnt(i) - P[i]).length() > 1e-6f * (P[i].length() + 1.0f) || !(pc.clr(i) == C[i])) {
+			std::cerr << "parallel xyz reader differs from reference at point " << i << std::endl;
+			return false;
+		}
+	std::cout << nr_points << " points (" << nr_mb << " MB): sscanf " << nr_mb / t_ref << " MB/s, parallel " << nr_mb / t_par
+		<< " MB/s, speedup " << t_ref / t_par << std::endl;
+	return true;
+}
+
+bool benchmark_ascii_reader()
+{
+	return benchmark_xyz(100000) && benchmark_xyz(1000000) && benchmark_xyz(10000000);
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API benchmark_registration benchmark_ascii_reader_reg("point_cloud::benchmark_ascii_reader", benchmark_ascii_reader);
@@ -0,0 +1,114 @@
+#include <point_cloud/point_cloud.h>
+#include <point_cloud/ann_tree.h>
+#include <point_cloud/knn_grid.h>
+#include <point_cloud/neighbor_graph.h>
+#include <cgv/base/register.h>
+#include <cgv/utils/stopwatch.h>
+#include <iostream>
+#include <random>
+#include <cmath>
+
+using namespace cgv::base;
+using namespace cgv::utils;
+
+/// fill point cloud with a scan like point set of nearly uniform density on the surface of a unit sphere
+static void generate_sphere_scan(point_cloud& pc, size_t nr_points)
+{
+	std::mt19937 rng(7);
+	std::normal_distribution<float> normal;
+	std::uniform_real_distribution<float> noise(-0.0005f, 0.0005f);
+	pc.clear();
+	pc.resize(nr_points);
+	for (size_t i = 0; i < nr_points; ++i) {
+		point_cloud::Pnt p(normal(rng), normal(rng), normal(rng));
+		p *= (1.0f + noise(rng)) / p.length();
+		pc.pnt(i) = p;
+	}
+}
+
+/// check that the grid based neighbors have the same distances as the neighbors found by ann for a sample of points
+static bool validate_neighbors(const point_cloud& pc, const neighbor_graph& ng, const ann_tree& tree, unsigned k)
+{
+	std::vector<point_cloud::Idx> N;
+	for (size_t i = 0; i < pc.get_nr_points(); i += pc.get_nr_points() / 997 + 1) {
+		tree.extract_neighbors(point_cloud::Idx(i), k, N);
+		if (N.size() != ng[i].size())
+			return false;
+		for (unsigned j = 0; j < k; ++j) {
+			float d_ann = (pc.pnt(N[j]) - pc.pnt(i)).length();
+			float d_grid = (pc.pnt(ng[i][j]) - pc.pnt(i)).length();
+			if (std::abs(d_ann - d_grid) > 1e-6f) {
+				std::cerr << "knn of point " << i << " differs: ann distance " << d_ann << " grid distance " << d_grid << std::endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/// measure sequential ann based construction against parallel morton ordered construction with ann and with the uniform grid
+static bool benchmark_knn(size_t nr_points, unsigned k, bool measure_ann)
+{
+	point_cloud pc;
+	generate_sphere_scan(pc, nr_points);
+	point_cloud::Cnt n = point_cloud::Cnt(nr_points);
+	stopwatch watch(false);
+	std::vector<point_cloud::Idx> order;
+	knn_grid::compute_morton_order(n, &pc.pnt(0), order);
+	double t_order = watch.restart();
+	knn_grid grid;
+	grid.build(pc);
+	double t_grid_build = watch.restart();
+	neighbor_graph ng;
+	ng.build(n, k, grid, 0, &order);
+	double t_grid = watch.restart();
+	std::cout << nr_points << " points, k = " << k << ": morton order " << t_order << " s, grid build " << t_grid_build
+		<< " s, parallel grid knn " << t_grid << " s";
+	if (measure_ann) {
+		ann_tree tree;
+		tree.build(pc);
+		watch.restart();
+		// sequential reference in index order
+		neighbor_graph ng_ref;
+		ng_ref.resize(n);
+		for (point_cloud::Idx i = 0; i < point_cloud::Idx(n); ++i)
+			tree.extract_neighbors(i, k, ng_ref[i]);
+		double t_ann = watch.restart();
+		std::cout << ", sequential ann knn " << t_ann << " s, speedup " << t_ann / (t_grid_build + t_grid);
+		if (!validate_neighbors(pc, ng, tree, k)) {
+			std::cout << std::endl;
+			return false;
+		}
+	}
+	std::cout << std::endl;
+	return ng.nr_half_edges == n * k;
+}
+
+/// validate the parallel grid based construction against ann on a small point set
+bool test_knn_graph()
+{
+	point_cloud pc;
+	generate_sphere_scan(pc, 20000);
+	point_cloud::Cnt n = point_cloud::Cnt(pc.get_nr_points());
+	std::vector<point_cloud::Idx> order;
+	knn_grid::compute_morton_order(n, &pc.pnt(0), order);
+	knn_grid grid;
+	grid.build(pc);
+	neighbor_graph ng;
+	ng.build(n, 10, grid, 0, &order);
+	TEST_ASSERT_EQ(ng.nr_half_edges, n * 10);
+	ann_tree tree;
+	tree.build(pc);
+	TEST_ASSERT(validate_neighbors(pc, ng, tree, 10));
+	return true;
+}
+
+bool benchmark_knn_graph()
+{
+	return benchmark_knn(1000000, 10, true) && benchmark_knn(10000000, 10, true) && benchmark_knn(50000000, 10, false);
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_knn_graph_reg("point_cloud::test_knn_graph", test_knn_graph);
+extern CGV_API benchmark_registration benchmark_knn_graph_reg("point_cloud::benchmark_knn_graph", benchmark_knn_graph);
@@ -0,0 +1,86 @@
+#include <point_cloud/point_cloud.h>
+#include <point_cloud/compact_point_cloud.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <random>
+#include <cmath>
+
+using namespace cgv::base;
+
+/// generate point cloud with two components, normals and colors
+static void generate_point_cloud(point_cloud& pc, size_t nr_points_per_component)
+{
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	std::uniform_int_distribution<int> byte(0, 255);
+	pc.clear();
+	pc.create_normals();
+	pc.create_colors();
+	for (int ci = 0; ci < 2; ++ci) {
+		if (ci == 0)
+			pc.create_components();
+		else
+			pc.add_component();
+		for (size_t i = 0; i < nr_points_per_component; ++i) {
+			point_cloud::Pnt p(uniform(rng), uniform(rng), uniform(rng));
+			size_t pi = pc.add_point(point_cloud::Pnt(100.0f * ci) + float(ci + 1) * p);
+			pc.nml(pi) = normalize(point_cloud::Nml(uniform(rng), uniform(rng), uniform(rng)));
+			pc.clr(pi) = point_cloud::Clr(point_cloud::int_to_color_component(byte(rng)),
+				point_cloud::int_to_color_component(byte(rng)), point_cloud::int_to_color_component(byte(rng)));
+		}
+	}
+}
+
+bool test_compact_point_cloud()
+{
+	point_cloud pc;
+	generate_point_cloud(pc, 10000);
+	compact_point_cloud cpc;
+	cpc.build(pc);
+	if (cpc.get_nr_points() != pc.get_nr_points() || cpc.get_nr_components() != 2) {
+		std::cerr << "compact_point_cloud: wrong number of points or components" << std::endl;
+		return false;
+	}
+	// quantization step of the blocks of the second component is 4/65535
+	std::vector<float> X(pc.get_nr_points()), Y(pc.get_nr_points()), Z(pc.get_nr_points());
+	cpc.decode_points(0, pc.get_nr_points(), &X[0], &Y[0], &Z[0]);
+	for (size_t i = 0; i < pc.get_nr_points(); ++i) {
+		point_cloud::Pnt p = cpc.pnt(i);
+		if ((p - pc.pnt(i)).length() > 1e-4f || p != point_cloud::Pnt(X[i], Y[i], Z[i])) {
+			std::cerr << "compact_point_cloud: position error at point " << i << std::endl;
+			return false;
+		}
+		if (dot(cpc.nml(i), pc.nml(i)) < 0.99999f) {
+			std::cerr << "compact_point_cloud: normal error at point " << i << std::endl;
+			return false;
+		}
+		if (!(cpc.clr(i) == pc.clr(i))) {
+			std::cerr << "compact_point_cloud: color error at point " << i << std::endl;
+			return false;
+		}
+	}
+	cpc.decode_normals(0, pc.get_nr_points(), &X[0], &Y[0], &Z[0]);
+	for (size_t i = 0; i < pc.get_nr_points(); ++i)
+		if ((cpc.nml(i) - point_cloud::Nml(X[i], Y[i], Z[i])).length() > 1e-6f) {
+			std::cerr << "compact_point_cloud: bulk normal decoding differs at point " << i << std::endl;
+			return false;
+		}
+	point_cloud restored;
+	cpc.extract(restored);
+	if (restored.get_nr_points() != pc.get_nr_points() || restored.get_nr_components() != 2 ||
+		restored.component_point_range(1).index_of_first_point != pc.component_point_range(1).index_of_first_point) {
+		std::cerr << "compact_point_cloud: extracted point cloud differs" << std::endl;
+		return false;
+	}
+	if (sizeof(point_cloud::Clr) <= sizeof(cgv::type::uint32_type) && (cpc.get_flags() & CAF_PACKED_COLORS) != 0) {
+		std::cerr << "compact_point_cloud: packs colors that are smaller than packed colors" << std::endl;
+		return false;
+	}
+	size_t full_size = pc.get_nr_points() * (sizeof(point_cloud::Pnt) + sizeof(point_cloud::Nml) + sizeof(point_cloud::Clr));
+	std::cout << "compact_point_cloud uses " << cpc.get_memory_size() << " of " << full_size << " bytes" << std::endl;
+	return cpc.get_memory_size() < full_size;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_compact_point_cloud_reg("point_cloud::test_compact_point_cloud", test_compact_point_cloud);
@@ -0,0 +1,102 @@
+#include <point_cloud/ICP.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <random>
+#include <cmath>
+
+using namespace cgv::base;
+using namespace cgv::pointcloud;
+
+typedef point_cloud_types::Pnt Pnt;
+typedef point_cloud_types::Nml Nml;
+typedef point_cloud_types::Dir Dir;
+typedef point_cloud_types::Mat Mat;
+typedef point_cloud_types::Qat Qat;
+
+/// sample an ellipsoid with different radii, such that its registration is unique close to the identity
+static void generate_ellipsoid(point_cloud& pc, size_t nr_points, bool normals)
+{
+	const Dir radii(1.0f, 0.7f, 0.4f);
+	std::mt19937 rng(23);
+	std::normal_distribution<float> normal;
+	pc.clear();
+	if (normals)
+		pc.create_normals();
+	pc.resize(point_cloud_types::Idx(nr_points));
+	for (size_t i = 0; i < nr_points; ++i) {
+		Dir d(normal(rng), normal(rng), normal(rng));
+		d.normalize();
+		pc.pnt(i) = Pnt(radii[0] * d[0], radii[1] * d[1], radii[2] * d[2]);
+		if (normals) {
+			Nml n(d[0] / radii[0], d[1] / radii[1], d[2] / radii[2]);
+			pc.nml(i) = normalize(n);
+		}
+	}
+}
+
+/// register a moved copy of the target and return the mean distance of the registered source points to their originals
+static float registration_error(ICP& icp, const point_cloud& target, int& nr_iterations)
+{
+	Mat R = Qat(normalize(Dir(1, 2, 3)), 0.1f).get_matrix();
+	Dir t(0.05f, -0.03f, 0.02f);
+	point_cloud source = target;
+	for (point_cloud_types::Idx i = 0; i < point_cloud_types::Idx(source.get_nr_points()); ++i)
+		source.pnt(i) = R * target.pnt(i) + t;
+	icp.set_source_cloud(source);
+	icp.set_target_cloud(target);
+	icp.build_ann_tree();
+	Mat rotation;
+	rotation.identity();
+	Dir translation(0, 0, 0);
+	icp.reg_icp(rotation, translation);
+	nr_iterations = int(icp.statistics.size());
+	float error = 0;
+	for (point_cloud_types::Idx i = 0; i < point_cloud_types::Idx(source.get_nr_points()); ++i)
+		error += (rotation * source.pnt(i) + translation - target.pnt(i)).length();
+	return error / source.get_nr_points();
+}
+
+bool test_icp()
+{
+	point_cloud target;
+	generate_ellipsoid(target, 20000, true);
+	ICP icp;
+	icp.set_iterations(100);
+	icp.set_num_random(0);
+	icp.set_eps(0);
+	int nr_point_to_point, nr_point_to_plane;
+	float point_to_point_error = registration_error(icp, target, nr_point_to_point);
+	TEST_ASSERT(point_to_point_error < 1e-3f);
+	// without cost threshold iteration stops on a negligible update before the iteration limit
+	TEST_ASSERT(nr_point_to_point < 100);
+
+	// point to plane converges to the same result
+	icp.set_metric(ICP::POINT_TO_PLANE_METRIC);
+	float point_to_plane_error = registration_error(icp, target, nr_point_to_plane);
+	TEST_ASSERT(point_to_plane_error < 1e-3f);
+	TEST_ASSERT(nr_point_to_plane > 0);
+	for (const auto& s : icp.statistics)
+		TEST_ASSERT(s.nr_correspondences == target.get_nr_points());
+	TEST_ASSERT(icp.statistics.back().cost < 1e-6f);
+
+	// coarse to fine schedule with correspondence rejection
+	icp.set_pyramid(3, 0.02f);
+	icp.set_max_correspondence_distance(0.1f);
+	int nr_pyramid;
+	TEST_ASSERT(registration_error(icp, target, nr_pyramid) < 1e-3f);
+	TEST_ASSERT(icp.statistics.front().level == 2 && icp.statistics.back().level == 0);
+	TEST_ASSERT(icp.statistics.front().nr_correspondences < target.get_nr_points());
+
+	// without target normals point to plane falls back to point to point
+	point_cloud target_without_normals;
+	generate_ellipsoid(target_without_normals, 20000, false);
+	icp.set_pyramid(1, 0);
+	icp.set_max_correspondence_distance(0);
+	int nr_fallback;
+	TEST_ASSERT(registration_error(icp, target_without_normals, nr_fallback) < 1e-3f);
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_icp_reg("point_cloud::test_icp", test_icp);
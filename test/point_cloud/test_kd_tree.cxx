@@ -0,0 +1,155 @@
+#include <point_cloud/kd_tree.h>
+#include <point_cloud/ann_tree.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+using namespace cgv::base;
+
+typedef point_cloud_types::Pnt Pnt;
+typedef point_cloud_types::Idx Idx;
+typedef point_cloud_types::Crd Crd;
+
+/// squared distances of all points to q sorted by increasing distance
+static std::vector<Crd> brute_force_sqr_dists(const std::vector<Pnt>& P, const Pnt& q, Idx exclude = -1)
+{
+	std::vector<Crd> D;
+	for (Idx i = 0; i < Idx(P.size()); ++i)
+		if (i != exclude)
+			D.push_back((P[i] - q).sqr_length());
+	std::sort(D.begin(), D.end());
+	return D;
+}
+
+/// compare squared distances computed in different order
+static bool same_dist(Crd a, Crd b)
+{
+	return std::abs(a - b) <= 1e-6f;
+}
+
+bool test_kd_tree()
+{
+	// clustered points with duplicates to exercise ties
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	std::vector<Pnt> P(5000);
+	for (size_t i = 0; i < P.size(); ++i)
+		P[i] = i % 10 == 9 ? P[i - 1] : Pnt(uniform(rng), uniform(rng), 0.2f * uniform(rng));
+	kd_tree tree;
+	tree.build(P);
+	TEST_ASSERT_EQ(tree.get_nr_points(), point_cloud_types::Cnt(P.size()));
+
+	// knn and radius queries match brute force
+	std::vector<Idx> N;
+	std::vector<Crd> D;
+	for (int qi = 0; qi < 50; ++qi) {
+		Pnt q(uniform(rng), uniform(rng), uniform(rng));
+		std::vector<Crd> R = brute_force_sqr_dists(P, q);
+		tree.find_knn(q, 12, N, &D);
+		TEST_ASSERT_EQ(N.size(), size_t(12));
+		for (size_t j = 0; j < N.size(); ++j) {
+			TEST_ASSERT(same_dist(D[j], R[j]));
+			TEST_ASSERT(same_dist((P[N[j]] - q).sqr_length(), D[j]));
+		}
+		Crd radius = 0.3f;
+		tree.find_in_radius(q, radius, N, &D);
+		size_t expected = std::upper_bound(R.begin(), R.end(), radius * radius) - R.begin();
+		TEST_ASSERT_EQ(N.size(), expected);
+		TEST_ASSERT(std::is_sorted(D.begin(), D.end()));
+		for (size_t j = 0; j < N.size(); ++j)
+			TEST_ASSERT((P[N[j]] - q).sqr_length() <= radius * radius);
+		TEST_ASSERT(same_dist((P[tree.find_closest(q)] - q).sqr_length(), R[0]));
+	}
+	// more neighbors than points and empty radius
+	std::vector<Pnt> few(P.begin(), P.begin() + 5);
+	kd_tree small_tree;
+	small_tree.build(few);
+	small_tree.find_knn(Pnt(0, 0, 0), 8, N);
+	TEST_ASSERT_EQ(N.size(), size_t(5));
+	tree.find_in_radius(Pnt(10, 10, 10), 0.5f, N);
+	TEST_ASSERT(N.empty());
+
+	// batch queries return the same neighbors as single queries and pad missing neighbors
+	std::vector<Pnt> Q(3000);
+	for (auto& q : Q)
+		q = Pnt(uniform(rng), uniform(rng), uniform(rng));
+	const Idx k = 6;
+	std::vector<Idx> NB(Q.size() * k);
+	std::vector<Crd> DB(Q.size() * k);
+	tree.find_knn(point_cloud_types::Cnt(Q.size()), &Q[0], k, &NB[0], &DB[0]);
+	bool batch_equal = true;
+	for (size_t i = 0; i < Q.size(); ++i) {
+		tree.find_knn(Q[i], k, N, &D);
+		for (Idx j = 0; j < k; ++j)
+			batch_equal = batch_equal && NB[i * k + j] == N[j] && DB[i * k + j] == D[j];
+	}
+	TEST_ASSERT(batch_equal);
+	std::vector<Idx> NS(2 * 8);
+	small_tree.find_knn(2, &Q[0], 8, &NS[0]);
+	TEST_ASSERT_EQ(NS[5], -1);
+	TEST_ASSERT_EQ(NS[15], -1);
+
+	// neighbors of a point exclude the point itself but not other points at the same position
+	point_cloud pc;
+	pc.resize(Idx(P.size()));
+	for (size_t i = 0; i < P.size(); ++i)
+		pc.pnt(Idx(i)) = P[i];
+	ann_tree at;
+	at.build(pc);
+	for (Idx i = 0; i < 100; ++i) {
+		at.extract_neighbors(i, 10, N);
+		TEST_ASSERT_EQ(N.size(), size_t(10));
+		TEST_ASSERT(std::find(N.begin(), N.end(), i) == N.end());
+		std::vector<Crd> R = brute_force_sqr_dists(P, P[i], i);
+		for (size_t j = 0; j < N.size(); ++j)
+			TEST_ASSERT(same_dist((P[N[j]] - P[i]).sqr_length(), R[j]));
+		// duplicated points find their twin at distance zero
+		if (i % 10 == 8 || i % 10 == 9)
+			TEST_ASSERT_EQ((P[N[0]] - P[i]).sqr_length(), 0.0f);
+	}
+
+	// trees built from components take and return point cloud indices
+	point_cloud cpc;
+	for (int ci = 0; ci < 3; ++ci) {
+		if (ci == 0)
+			cpc.create_components();
+		else
+			cpc.add_component();
+		for (size_t i = 0; i < 50; ++i)
+			cpc.add_point(P[i] + Pnt(10.0f * ci, 0, 0));
+	}
+	std::vector<Idx> C(1, 2);
+	C.push_back(1);
+	ann_tree ct;
+	ct.build(cpc, C);
+	std::vector<Pnt> P50(P.begin(), P.begin() + 50);
+	bool no_self_neighbor = true, in_components = true, correct_dists = true;
+	for (Idx i = 50; i < 150; ++i) {
+		ct.extract_neighbors(i, 10, N);
+		no_self_neighbor = no_self_neighbor && N.size() == 10 && std::find(N.begin(), N.end(), i) == N.end();
+		for (Idx ni : N)
+			in_components = in_components && cpc.component_index(ni) == cpc.component_index(i);
+		// the points of each component are translated copies of the first 50 points
+		std::vector<Crd> R = brute_force_sqr_dists(P50, P50[i % 50], i % 50);
+		for (size_t j = 0; j < N.size(); ++j)
+			correct_dists = correct_dists && std::abs((cpc.pnt(N[j]) - cpc.pnt(i)).sqr_length() - R[j]) <= 1e-4f;
+	}
+	TEST_ASSERT(no_self_neighbor);
+	TEST_ASSERT(in_components);
+	TEST_ASSERT(correct_dists);
+	TEST_ASSERT_EQ(ct.find_closest(cpc.pnt(120)), Idx(120));
+	ct.find_knn(cpc.pnt(60), 3, N);
+	TEST_ASSERT(N.size() == 3 && N[0] == 60 && cpc.component_index(N[1]) == 1);
+	ct.find_in_radius(cpc.pnt(130), 1e-6f, N);
+	TEST_ASSERT(std::find(N.begin(), N.end(), Idx(130)) != N.end());
+	// points of components not in the tree are not excluded
+	ct.extract_neighbors(10, 10, N);
+	TEST_ASSERT_EQ(N.size(), size_t(10));
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_kd_tree_reg("point_cloud::test_kd_tree", test_kd_tree);
@@ -0,0 +1,115 @@
+#include <point_cloud/octree_file.h>
+#include <cgv/base/register.h>
+#include <cgv/utils/file.h>
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+using namespace cgv::base;
+using namespace cgv::pointcloud::octree;
+
+/// point with a normal, which differs in size from SimpleLODPoint
+typedef GenericLODPoint<0, 2, cgv::render::render_types::vec3, cgv::render::render_types::vec3, uint8_t> normal_lod_point;
+
+/// check a lod file against the points it was generated from, which are identified by their color
+static bool check_lod_file(const std::string& file_name, const std::vector<SimpleLODPoint>& points, bool compressed)
+{
+	lod_file<SimpleLODPoint> lf;
+	TEST_ASSERT(lf.open(file_name));
+	if (!lf.is_open())
+		return false;
+	TEST_ASSERT_EQ(lf.is_compressed(), compressed);
+	TEST_ASSERT_EQ(lf.get_nr_points(), points.size());
+	TEST_ASSERT(lf.get_nr_nodes() > 1);
+	TEST_ASSERT_EQ(lf.get_node_name(0), "r");
+	TEST_ASSERT_EQ(lf.find_node("r"), 0);
+	TEST_ASSERT_EQ(lf.find_node("r9"), -1);
+	std::vector<unsigned> nr_reads(points.size(), 0);
+	size_t nr_points = 0;
+	std::vector<SimpleLODPoint> node_points;
+	for (size_t i = 0; i < lf.get_nr_nodes(); ++i) {
+		const lod_file_node& node = lf.get_node(i);
+		const std::string& name = lf.get_node_name(i);
+		// nodes are stored in breadth first order and children are linked to their parents
+		if (i > 0)
+			TEST_ASSERT(lf.get_node_name(i - 1).size() <= name.size());
+		for (int c = 0; c < 8; ++c) {
+			int ci = lf.find_child(i, c);
+			if (ci != -1)
+				TEST_ASSERT_EQ(lf.get_node_name(ci), name + char('0' + c));
+		}
+		TEST_ASSERT(lf.read_node(i, node_points));
+		TEST_ASSERT_EQ(node_points.size(), size_t(node.nr_points));
+		for (const auto& p : node_points) {
+			uint32_t id = uint32_t(p.color()[0]) + (uint32_t(p.color()[1]) << 8) + (uint32_t(p.color()[2]) << 16);
+			TEST_ASSERT(id < points.size());
+			if (id >= points.size())
+				continue;
+			++nr_reads[id];
+			TEST_ASSERT_EQ(p.level(), node.level);
+			// quantized positions are reconstructed up to the resolution of the node box
+			for (int c = 0; c < 3; ++c) {
+				float tolerance = compressed ? (node.box[c + 3] - node.box[c]) / 65535.0f + 1e-5f : 0.0f;
+				TEST_ASSERT(std::abs(p.position()[c] - points[id].position()[c]) <= tolerance);
+			}
+		}
+		nr_points += node_points.size();
+	}
+	TEST_ASSERT_EQ(nr_points, points.size());
+	TEST_ASSERT(std::count(nr_reads.begin(), nr_reads.end(), 1u) == std::ptrdiff_t(points.size()));
+	TEST_ASSERT(lf.read_node("r", node_points));
+	TEST_ASSERT_EQ(node_points.size(), size_t(lf.get_node(0).nr_points));
+	return true;
+}
+
+bool test_lod_file()
+{
+	const uint32_t nr_points = 30000;
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> uniform(-5.0f, 5.0f);
+	std::vector<SimpleLODPoint> points(nr_points);
+	for (uint32_t i = 0; i < nr_points; ++i) {
+		points[i].position() = cgv::render::render_types::vec3(uniform(rng), uniform(rng), uniform(rng));
+		points[i].color() = cgv::render::render_types::rgb8(i & 255, (i >> 8) & 255, (i >> 16) & 255);
+		points[i].level() = 0;
+	}
+	octree_lod_generator<SimpleLODPoint> generator(false);
+	generator.allow_dedup() = false;
+	std::string file_name = "test_lod_file.lod";
+	TEST_ASSERT(write_lod_file(generator, points, file_name));
+	TEST_ASSERT(check_lod_file(file_name, points, false));
+	TEST_ASSERT(write_lod_file(generator, points, file_name, true));
+	TEST_ASSERT(check_lod_file(file_name, points, true));
+
+	// out-of-core variant
+	std::string input_file_name = "test_lod_file.bin";
+	TEST_ASSERT(cgv::utils::file::write(input_file_name, reinterpret_cast<const char*>(points.data()), points.size() * sizeof(SimpleLODPoint)));
+	generator.out_of_core_batch_size = 4000;
+	{
+		RawPointFileStream<SimpleLODPoint> input(input_file_name);
+		TEST_ASSERT(write_lod_file(generator, input, file_name, true));
+	}
+	TEST_ASSERT(check_lod_file(file_name, points, true));
+	cgv::utils::file::remove(input_file_name);
+
+	// files written for other point types and files that are no lod files are rejected
+	lod_file<normal_lod_point> other;
+	TEST_ASSERT(!other.open(file_name));
+	TEST_ASSERT(!other.is_open());
+	std::string content;
+	TEST_ASSERT(cgv::utils::file::read(file_name, content, false));
+	content[0] = 'X';
+	TEST_ASSERT(cgv::utils::file::write(file_name, content.data(), content.size(), false));
+	lod_file<SimpleLODPoint> lf;
+	TEST_ASSERT(!lf.open(file_name));
+	content[0] = 'L';
+	TEST_ASSERT(cgv::utils::file::write(file_name, content.data(), content.size() - 10, false));
+	TEST_ASSERT(!lf.open(file_name));
+	cgv::utils::file::remove(file_name);
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_lod_file_reg("point_cloud::test_lod_file", test_lod_file);
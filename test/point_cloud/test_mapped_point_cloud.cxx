@@ -0,0 +1,79 @@
+#include <point_cloud/mapped_point_cloud.h>
+#include <cgv/base/register.h>
+#include <cgv/utils/file.h>
+#include <iostream>
+#include <random>
+#include <cstdio>
+#include <cstring>
+
+using namespace cgv::base;
+
+bool test_mapped_point_cloud()
+{
+	typedef point_cloud_types::Pnt Pnt;
+	typedef point_cloud_types::Nml Nml;
+	typedef point_cloud_types::Clr Clr;
+	const size_t nr_points = 10000;
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	std::vector<Pnt> P(nr_points);
+	std::vector<Nml> N(nr_points);
+	std::vector<Clr> C(nr_points);
+	std::vector<GLint> L(nr_points);
+	for (size_t i = 0; i < nr_points; ++i) {
+		P[i] = Pnt(uniform(rng), uniform(rng), uniform(rng));
+		N[i] = Nml(uniform(rng), uniform(rng), uniform(rng));
+		C[i] = Clr(point_cloud_types::int_to_color_component(int(i % 256)), point_cloud_types::int_to_color_component(int(i / 256 % 256)), point_cloud_types::int_to_color_component(7));
+		L[i] = GLint(i % 13);
+	}
+	std::string file_name = "test_mapped_point_cloud.mpc";
+	// chunk size is rounded up to a multiple of the chunk granularity
+	TEST_ASSERT(mapped_point_cloud::write(file_name, nr_points, &P[0], &N[0], &C[0], &L[0], 3000));
+	{
+		mapped_point_cloud mpc;
+		TEST_ASSERT(mpc.open(file_name));
+		TEST_ASSERT_EQ(mpc.get_nr_points(), nr_points);
+		TEST_ASSERT_EQ(mpc.get_chunk_size(), size_t(MPC_CHUNK_GRANULARITY));
+		TEST_ASSERT_EQ(mpc.get_nr_chunks(), size_t(3));
+		TEST_ASSERT_EQ(mpc.chunk_nr_points(2), nr_points - 2 * MPC_CHUNK_GRANULARITY);
+		TEST_ASSERT(mpc.has_normals() && mpc.has_colors() && mpc.has_labels() && mpc.has_chunk_boxes());
+		if (mpc.is_open()) {
+			TEST_ASSERT(memcmp(mpc.positions(), &P[0], nr_points * sizeof(Pnt)) == 0);
+			TEST_ASSERT(memcmp(mpc.normals(), &N[0], nr_points * sizeof(Nml)) == 0);
+			TEST_ASSERT(memcmp(mpc.colors(), &C[0], nr_points * sizeof(Clr)) == 0);
+			TEST_ASSERT(memcmp(mpc.labels(), &L[0], nr_points * sizeof(GLint)) == 0);
+			// sections and chunks start on page boundaries
+			TEST_ASSERT_EQ(size_t(reinterpret_cast<const char*>(mpc.normals()) - reinterpret_cast<const char*>(mpc.positions())) % MPC_ALIGNMENT, size_t(0));
+			for (size_t ci = 0; ci < mpc.get_nr_chunks(); ++ci)
+				for (size_t i = mpc.chunk_begin(ci); i < mpc.chunk_begin(ci) + mpc.chunk_nr_points(ci); ++i)
+					for (int c = 0; c < 3; ++c)
+						TEST_ASSERT(mpc.chunk_box(ci).get_min_pnt()[c] <= P[i][c] && P[i][c] <= mpc.chunk_box(ci).get_max_pnt()[c]);
+			mpc.prefetch_chunks(1, 3);
+		}
+	}
+	// optional attributes are not stored
+	TEST_ASSERT(mapped_point_cloud::write(file_name, nr_points, &P[0]));
+	{
+		mapped_point_cloud mpc(file_name);
+		TEST_ASSERT(mpc.is_open() && !mpc.has_normals() && !mpc.has_colors() && !mpc.has_labels() && mpc.normals() == 0);
+	}
+	// files with different byte order and truncated files are rejected
+	std::string content;
+	TEST_ASSERT(cgv::utils::file::read(file_name, content, false));
+	std::swap(content[0], content[3]);
+	std::swap(content[1], content[2]);
+	TEST_ASSERT(cgv::utils::file::write(file_name, content.data(), content.size(), false));
+	mapped_point_cloud mpc;
+	TEST_ASSERT(!mpc.open(file_name));
+	std::swap(content[0], content[3]);
+	std::swap(content[1], content[2]);
+	TEST_ASSERT(cgv::utils::file::write(file_name, content.data(), content.size() / 2, false));
+	TEST_ASSERT(!mpc.open(file_name));
+	TEST_ASSERT(!mpc.is_open());
+	cgv::utils::file::remove(file_name);
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_mapped_point_cloud_reg("point_cloud::test_mapped_point_cloud", test_mapped_point_cloud);
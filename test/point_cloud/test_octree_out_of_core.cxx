@@ -0,0 +1,113 @@
+#include <point_cloud/octree.h>
+#include <cgv/base/register.h>
+#include <cgv/utils/file.h>
+#include <cgv/utils/dir.h>
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+
+using namespace cgv::base;
+using namespace cgv::pointcloud::octree;
+
+/// stream that returns different points in each pass
+struct changing_point_stream : public PointStream<SimpleLODPoint>
+{
+	size_t nr_points = 1000, pos = 0;
+	bool rewind() { pos = 0; ++nr_points; return true; }
+	size_t read(SimpleLODPoint* buffer, size_t max_points)
+	{
+		size_t n = std::min(max_points, nr_points - pos);
+		for (size_t i = 0; i < n; ++i, ++pos) {
+			buffer[i].position() = cgv::render::render_types::vec3(float(pos), float(pos % 7), 0.0f);
+			buffer[i].color() = cgv::render::render_types::rgb8(0, 0, 0);
+			buffer[i].level() = 0;
+		}
+		return n;
+	}
+};
+
+/// identify points by their color
+static uint32_t point_id(const SimpleLODPoint& p)
+{
+	return uint32_t(p.color()[0]) + (uint32_t(p.color()[1]) << 8) + (uint32_t(p.color()[2]) << 16);
+}
+
+bool test_octree_out_of_core()
+{
+	const uint32_t nr_points = 50000;
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> uniform(0.0f, 10.0f);
+	std::vector<SimpleLODPoint> points(nr_points);
+	for (uint32_t i = 0; i < nr_points; ++i) {
+		points[i].position() = cgv::render::render_types::vec3(uniform(rng), uniform(rng), 0.1f*uniform(rng));
+		points[i].color() = cgv::render::render_types::rgb8(i & 255, (i >> 8) & 255, (i >> 16) & 255);
+		points[i].level() = 0;
+	}
+	std::string temp_dir = "test_octree_out_of_core_tmp";
+	std::string input_file_name = temp_dir + "/input.bin";
+	std::string output_file_name = temp_dir + "/output.bin";
+	cgv::utils::dir::mkdir(temp_dir);
+	TEST_ASSERT(cgv::utils::dir::exists(temp_dir));
+	TEST_ASSERT(cgv::utils::file::write(input_file_name, reinterpret_cast<const char*>(points.data()), points.size() * sizeof(SimpleLODPoint)));
+
+	// input is streamed in several batches and each point is written exactly once
+	octree_lod_generator<SimpleLODPoint> generator(false);
+	generator.allow_dedup() = false;
+	generator.out_of_core_batch_size = 7000;
+	{
+		RawPointFileStream<SimpleLODPoint> input(input_file_name);
+		TEST_ASSERT(generator.generate_lods(input, output_file_name));
+	}
+	std::string content;
+	TEST_ASSERT(cgv::utils::file::read(output_file_name, content, false));
+	TEST_ASSERT_EQ(content.size(), nr_points * sizeof(SimpleLODPoint));
+	if (content.size() == nr_points * sizeof(SimpleLODPoint)) {
+		const SimpleLODPoint* result = reinterpret_cast<const SimpleLODPoint*>(content.data());
+		std::vector<uint32_t> ids(nr_points);
+		std::vector<unsigned> level_counts(256, 0);
+		for (uint32_t i = 0; i < nr_points; ++i) {
+			ids[i] = point_id(result[i]);
+			if (ids[i] < nr_points)
+				TEST_ASSERT(result[i].position() == points[ids[i]].position());
+			++level_counts[result[i].level()];
+		}
+		std::sort(ids.begin(), ids.end());
+		for (uint32_t i = 0; i < nr_points; ++i)
+			TEST_ASSERT_EQ(ids[i], i);
+		// points are distributed over several levels
+		TEST_ASSERT(std::count(level_counts.begin(), level_counts.end(), 0u) < 255);
+		// in-core generation distributes the same number of points to the root
+		std::vector<SimpleLODPoint> in_core = generator.generate_lods(points);
+		TEST_ASSERT_EQ(in_core.size(), size_t(nr_points));
+	}
+
+	// temporary chunks are removed, such that only input and output remain in the temp directory
+	std::vector<std::string> file_names, subdir_names;
+	cgv::utils::dir::glob(temp_dir, file_names, "*", false, true, &subdir_names);
+	TEST_ASSERT_EQ(file_names.size(), size_t(2));
+	TEST_ASSERT(subdir_names.empty());
+
+	// failures are reported to the caller
+	{
+		changing_point_stream input;
+		TEST_ASSERT(!generator.generate_lods(input, output_file_name));
+		RawPointFileStream<SimpleLODPoint> missing_input(temp_dir + "/missing.bin");
+		TEST_ASSERT(!generator.generate_lods(missing_input, output_file_name));
+		RawPointFileStream<SimpleLODPoint> valid_input(input_file_name);
+		TEST_ASSERT(!generator.generate_lods(valid_input, output_file_name, temp_dir + "/missing_dir"));
+	}
+	file_names.clear();
+	subdir_names.clear();
+	cgv::utils::dir::glob(temp_dir, file_names, "*", false, true, &subdir_names);
+	TEST_ASSERT(subdir_names.empty());
+
+	cgv::utils::file::remove(input_file_name);
+	cgv::utils::file::remove(output_file_name);
+	cgv::utils::dir::rmdir(temp_dir);
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_octree_out_of_core_reg("point_cloud::test_octree_out_of_core", test_octree_out_of_core);
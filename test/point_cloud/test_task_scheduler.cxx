@@ -0,0 +1,103 @@
+#include <point_cloud/concurrency.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+using namespace cgv::base;
+using namespace cgv::pointcloud::utility;
+
+/// compute fibonacci numbers with one task per recursive call
+static int64_t task_fibonacci(int n, TaskScheduler& scheduler)
+{
+	if (n < 2)
+		return n;
+	int64_t a = 0, b = 0;
+	TaskGroup group(scheduler);
+	group.run([&a, n, &scheduler]() { a = task_fibonacci(n - 1, scheduler); });
+	b = task_fibonacci(n - 2, scheduler);
+	group.wait();
+	return a + b;
+}
+
+/// check parallel loops and task groups on the given scheduler
+static bool check_scheduler(TaskScheduler& scheduler)
+{
+	// every index is visited exactly once for all grain sizes and also for empty ranges
+	const int64_t n = 100000;
+	std::vector<std::atomic<int>> visits(n);
+	for (int64_t grain_size : { 0, 1, 7, 1000, 200000 }) {
+		for (auto& v : visits)
+			v = 0;
+		parallel_for(0, n, [&visits](int64_t i) { ++visits[i]; }, grain_size, scheduler);
+		bool all_once = true;
+		for (auto& v : visits)
+			all_once = all_once && v == 1;
+		TEST_ASSERT(all_once);
+	}
+	std::atomic<int64_t> nr_calls(0);
+	parallel_for_range(5, 5, [&nr_calls](int64_t b, int64_t e) { ++nr_calls; }, 0, scheduler);
+	TEST_ASSERT_EQ(nr_calls.load(), 0);
+	// subranges are disjoint, respect the grain size and cover the range
+	std::atomic<int64_t> covered(0);
+	bool grain_respected = true;
+	parallel_for_range(10, 10010, [&](int64_t b, int64_t e) {
+		covered += e - b;
+		if (e - b > 64 || e <= b)
+			grain_respected = false;
+	}, 64, scheduler);
+	TEST_ASSERT_EQ(covered.load(), 10000);
+	TEST_ASSERT(grain_respected);
+	// nested loops compose without deadlock
+	std::atomic<int64_t> sum(0);
+	parallel_for(0, 100, [&sum, &scheduler](int64_t i) {
+		parallel_for(0, 100, [&sum, i](int64_t j) { sum += i * j; }, 0, scheduler);
+	}, 1, scheduler);
+	TEST_ASSERT_EQ(sum.load(), int64_t(4950) * 4950);
+	// recursive task groups
+	TEST_ASSERT_EQ(task_fibonacci(20, scheduler), 6765);
+	// thread indices are in range
+	std::atomic<bool> indices_valid(true);
+	parallel_for(0, 1000, [&indices_valid, &scheduler](int64_t i) {
+		int ti = scheduler.get_thread_index();
+		if (ti < 0 || ti >= scheduler.get_nr_threads())
+			indices_valid = false;
+	}, 1, scheduler);
+	TEST_ASSERT(indices_valid);
+	// task pools processed by parallel_for_each
+	std::vector<int> tasks(500);
+	for (int i = 0; i < 500; ++i)
+		tasks[i] = i;
+	std::atomic<int> task_sum(0);
+	std::function<void(int*)> func = [&task_sum](int* t) { task_sum += *t; };
+	parallel_for_each(tasks, func, scheduler);
+	TEST_ASSERT_EQ(task_sum.load(), 124750);
+	return true;
+}
+
+bool test_task_scheduler()
+{
+	// without workers all tasks are executed by waiting threads
+	{
+		TaskScheduler scheduler(0);
+		TEST_ASSERT_EQ(scheduler.get_nr_threads(), 1);
+		TEST_ASSERT(check_scheduler(scheduler));
+	}
+	// tasks submitted without group are finished before destruction
+	std::atomic<int> nr_executed(0);
+	{
+		TaskScheduler scheduler(3);
+		TEST_ASSERT_EQ(scheduler.get_nr_threads(), 4);
+		TEST_ASSERT(check_scheduler(scheduler));
+		for (int i = 0; i < 100; ++i)
+			scheduler.submit([&nr_executed]() { ++nr_executed; });
+	}
+	TEST_ASSERT_EQ(nr_executed.load(), 100);
+	TEST_ASSERT(check_scheduler(TaskScheduler::instance()));
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_task_scheduler_reg("point_cloud::test_task_scheduler", test_task_scheduler);
@@ -0,0 +1,99 @@
+#include <cgv/utils/async_io.h>
+#include <cgv/utils/file.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <atomic>
+
+using namespace cgv::base;
+using namespace cgv::utils;
+
+/// byte at position i of test file f
+static char test_byte(size_t i, int f)
+{
+	return char(i * 7 + f);
+}
+
+bool test_async_io()
+{
+	// files of different sizes, which are split into several pieces
+	const int nr_files = 6;
+	std::vector<std::string> file_names;
+	std::vector<size_t> file_sizes;
+	for (int f = 0; f < nr_files; ++f) {
+		file_names.push_back("test_async_io_" + std::to_string(f) + ".bin");
+		file_sizes.push_back(300000 + f * 12345);
+		std::vector<char> data(file_sizes.back());
+		for (size_t i = 0; i < data.size(); ++i)
+			data[i] = test_byte(i, f);
+		TEST_ASSERT(file::write(file_names.back(), data.data(), data.size()));
+	}
+	async_io io(3, 1 << 16);
+	TEST_ASSERT_EQ(io.get_nr_threads(), 3u);
+	TEST_ASSERT_EQ(io.get_piece_size(), size_t(1) << 16);
+	uint64_t size;
+	TEST_ASSERT(async_io::get_file_size(file_names[1], size) && size == file_sizes[1]);
+	TEST_ASSERT(!async_io::get_file_size("test_async_io_missing.bin", size));
+
+	// whole files read through futures
+	std::vector<async_io::request> batch;
+	for (const auto& file_name : file_names)
+		batch.push_back(async_io::request(file_name));
+	std::vector<std::future<async_io::result> > futures = io.read(batch);
+	TEST_ASSERT_EQ(futures.size(), size_t(nr_files));
+	for (int f = 0; f < int(futures.size()); ++f) {
+		async_io::result r = futures[f].get();
+		TEST_ASSERT(r.success);
+		TEST_ASSERT_EQ(r.nr_bytes_read, file_sizes[f]);
+		TEST_ASSERT_EQ(r.buffer.size(), file_sizes[f]);
+		bool content_matches = true;
+		for (size_t i = 0; i < r.buffer.size(); ++i)
+			content_matches = content_matches && r.buffer[i] == test_byte(i, f);
+		TEST_ASSERT(content_matches);
+	}
+
+	// ranges spanning several pieces read into given memory with completion handler
+	const size_t offset = 5000, range_size = 200000;
+	std::vector<char> destination(nr_files * range_size);
+	std::vector<int> nr_calls(nr_files, 0);
+	std::atomic<int> nr_correct(0);
+	batch.clear();
+	for (int f = 0; f < nr_files; ++f)
+		batch.push_back(async_io::request(file_names[f], offset, range_size, destination.data() + f * range_size));
+	io.read(batch, [&](size_t i, async_io::result& r) {
+		++nr_calls[i];
+		bool correct = r.success && r.nr_bytes_read == range_size && r.buffer.empty();
+		for (size_t j = 0; j < range_size; j += 997)
+			correct = correct && destination[i * range_size + j] == test_byte(offset + j, int(i));
+		if (correct)
+			++nr_correct;
+	});
+	io.wait();
+	TEST_ASSERT_EQ(nr_correct.load(), nr_files);
+	for (int f = 0; f < nr_files; ++f)
+		TEST_ASSERT_EQ(nr_calls[f], 1);
+
+	// missing files, ranges behind the end of the file and empty ranges
+	async_io::result r = io.read(async_io::request("test_async_io_missing.bin")).get();
+	TEST_ASSERT(!r.success);
+	r = io.read(async_io::request(file_names[0], file_sizes[0] - 10, 100)).get();
+	TEST_ASSERT(!r.success);
+	TEST_ASSERT_EQ(r.nr_bytes_read, size_t(10));
+	r = io.read(async_io::request(file_names[0], 100, 0)).get();
+	TEST_ASSERT(r.success);
+	TEST_ASSERT_EQ(r.nr_bytes_read, size_t(0));
+	char bytes[4];
+	TEST_ASSERT_EQ(async_io::read_range(file_names[2], 1000, 4, bytes), size_t(4));
+	TEST_ASSERT(bytes[0] == test_byte(1000, 2) && bytes[3] == test_byte(1003, 2));
+
+	// read ahead completes before wait returns
+	for (const auto& file_name : file_names)
+		io.read_ahead(file_name);
+	io.wait();
+	for (const auto& file_name : file_names)
+		file::remove(file_name);
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_async_io_reg("cgv::utils::test_async_io", test_async_io);
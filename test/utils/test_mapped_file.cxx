@@ -0,0 +1,91 @@
+#include <cgv/utils/mapped_file.h>
+#include <cgv/utils/file.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <string>
+
+using namespace cgv::base;
+using namespace cgv::utils;
+
+bool test_mapped_file()
+{
+	std::string file_name = "test_mapped_file.bin", empty_file_name = "test_mapped_file_empty.bin";
+	const size_t page_size = mapped_file::get_page_size();
+	TEST_ASSERT(page_size > 0 && (page_size & (page_size - 1)) == 0);
+
+	// write one byte per page through a read write mapping
+	const size_t nr_pages = 300;
+	{
+		mapped_file f;
+		TEST_ASSERT(f.create(file_name, nr_pages * page_size + 17));
+		if (!f.is_open())
+			return false;
+		TEST_ASSERT_EQ(f.get_mode(), mapped_file::MA_READ_WRITE);
+		TEST_ASSERT_EQ(f.get_size(), nr_pages * page_size + 17);
+		TEST_ASSERT(f.ref_data() != 0);
+		for (size_t i = 0; i < nr_pages; ++i)
+			f.ref_data()[i * page_size] = char(i);
+		f.ref_data()[f.get_size() - 1] = 'e';
+		TEST_ASSERT(f.flush());
+	}
+	TEST_ASSERT_EQ(file::size(file_name), nr_pages * page_size + 17);
+
+	// read only mapping sees the written content and clamps views
+	mapped_file f(file_name);
+	TEST_ASSERT(f.is_open());
+	TEST_ASSERT_EQ(f.get_mode(), mapped_file::MA_READ_ONLY);
+	TEST_ASSERT(f.ref_data() == 0);
+	TEST_ASSERT_EQ(f.get_file_name(), file_name);
+	bool content_matches = f.end()[-1] == 'e';
+	for (size_t i = 0; i < nr_pages; ++i)
+		content_matches = content_matches && f.begin()[i * page_size] == char(i);
+	TEST_ASSERT(content_matches);
+	mapped_file::view v = f.get_view(3 * page_size, 10);
+	TEST_ASSERT_EQ(v.size(), size_t(10));
+	TEST_ASSERT_EQ(v.begin[0], char(3));
+	v = f.get_view(f.get_size() - 5, 100);
+	TEST_ASSERT(v.end == f.end() && v.size() == 5);
+	TEST_ASSERT(f.get_view(f.get_size() + 1, 10).empty());
+	TEST_ASSERT_EQ(f.get_view().size(), f.get_size());
+
+	// hints with unaligned ranges and prefetching of overlapping and out of range parts
+	TEST_ASSERT(f.advise(mapped_file::AH_SEQUENTIAL));
+	TEST_ASSERT(f.advise(mapped_file::AH_WILL_NEED, page_size / 2 + 1, 5 * page_size));
+	f.prefetch(100, 30 * page_size);
+	f.prefetch(20 * page_size, size_t(-1));
+	f.prefetch(f.get_size() + page_size, 10);
+	f.wait_for_prefetch();
+	// closing with pending prefetch ranges stops the background thread
+	f.prefetch(0, f.get_size());
+	f.close();
+	TEST_ASSERT(!f.is_open());
+	TEST_ASSERT(f.begin() == f.end());
+
+	// empty files result in empty mappings and missing files are reported
+	{
+		mapped_file e;
+		TEST_ASSERT(e.create(empty_file_name, 0));
+	}
+	TEST_ASSERT(f.open(empty_file_name));
+	TEST_ASSERT_EQ(f.get_size(), size_t(0));
+	TEST_ASSERT(f.begin() == f.end());
+	TEST_ASSERT(f.get_view(0, 10).empty());
+	f.close();
+	TEST_ASSERT(!f.open("test_mapped_file_missing.bin"));
+	TEST_ASSERT(!f.is_open());
+
+	// resizing an existing file keeps its prefix
+	{
+		mapped_file g;
+		TEST_ASSERT(g.create(file_name, page_size));
+		TEST_ASSERT_EQ(g.get_size(), page_size);
+		TEST_ASSERT_EQ(g.begin()[0], char(0));
+	}
+	file::remove(file_name);
+	file::remove(empty_file_name);
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_mapped_file_reg("cgv::utils::test_mapped_file", test_mapped_file);
@@ -0,0 +1,56 @@
+#include <cgv/utils/parallel_for.h>
+#include <cgv/base/register.h>
+#include <iostream>
+#include <vector>
+#include <atomic>
+
+using namespace cgv::base;
+using namespace cgv::utils;
+
+bool test_parallel_for()
+{
+	// chunk counts are bounded by the thread count and the minimum chunk size
+	TEST_ASSERT_EQ(get_nr_chunks(0, 1, 4), 1u);
+	TEST_ASSERT_EQ(get_nr_chunks(100, 10, 4), 4u);
+	TEST_ASSERT_EQ(get_nr_chunks(100, 40, 4), 2u);
+	TEST_ASSERT_EQ(get_nr_chunks(100, 0, 3), 3u);
+	TEST_ASSERT(get_nr_chunks(size_t(1) << 30) >= 1u);
+
+	// chunks cover the range exactly once, also if there are more chunks than items
+	for (size_t n : { size_t(0), size_t(3), size_t(1000), size_t(12345) })
+		for (unsigned nr_chunks : { 1u, 2u, 7u, 16u }) {
+			std::vector<int> counts(n, 0);
+			std::vector<int> chunk_calls(nr_chunks, 0);
+			for_each_chunk(n, nr_chunks, [&](unsigned c, size_t begin, size_t end) {
+				++chunk_calls[c];
+				for (size_t i = begin; i < end; ++i)
+					++counts[i];
+			});
+			bool covered = true;
+			for (int c : counts)
+				covered = covered && c == 1;
+			TEST_ASSERT(covered);
+			for (int c : chunk_calls)
+				TEST_ASSERT_EQ(c, 1);
+		}
+
+	// many short calls reuse the pool
+	std::atomic<size_t> sum(0);
+	for (unsigned r = 0; r < 20000; ++r)
+		parallel_for_tasks(4, [&](unsigned i) { sum += i; });
+	TEST_ASSERT_EQ(sum.load(), size_t(20000 * 6));
+
+	// nested calls complete although all workers may be busy with the outer tasks
+	std::atomic<size_t> nr_inner(0);
+	parallel_for_tasks(8, [&](unsigned) {
+		parallel_for_tasks(8, [&](unsigned) {
+			parallel_for(1000, 10, [&](size_t begin, size_t end) { nr_inner += end - begin; });
+		});
+	});
+	TEST_ASSERT_EQ(nr_inner.load(), size_t(64000));
+	return true;
+}
+
+#include <test/lib_begin.h>
+
+extern CGV_API test_registration test_parallel_for_reg("cgv::utils::test_parallel_for", test_parallel_for);